@@ -0,0 +1,75 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace anteru {
+namespace benchmark {
+namespace {
+// A volatile store to a global is opaque enough for DoNotOptimize
+const void* volatile sink;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double Measure (const std::function<void ()>& function,
+	const int minimumRuns, const double minimumSeconds)
+{
+	return MeasureWithSetup ([] () {}, function, minimumRuns, minimumSeconds);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double MeasureWithSetup (const std::function<void ()>& setup,
+	const std::function<void ()>& function,
+	const int minimumRuns, const double minimumSeconds)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double fastest = 0;
+	double total = 0;
+
+	for (int run = 0; run < minimumRuns || total < minimumSeconds; ++run) {
+		setup ();
+
+		const auto start = Clock::now ();
+		function ();
+		const double seconds = std::chrono::duration<double> (
+			Clock::now () - start).count ();
+
+		fastest = run == 0 ? seconds : std::min (fastest, seconds);
+		total += seconds;
+	}
+
+	return fastest * 1000;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Report (const char* name, const double milliseconds,
+	const double itemCount, const char* itemName)
+{
+	if (itemCount > 0 && itemName) {
+		std::printf ("%-48s %10.3f ms %10.2f M%s/s\n", name, milliseconds,
+			itemCount / milliseconds / 1000, itemName);
+	} else {
+		std::printf ("%-48s %10.3f ms\n", name, milliseconds);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PrintEnvironment ()
+{
+#ifndef NDEBUG
+	std::printf ("Warning: built without NDEBUG, configure with "
+		"CMAKE_BUILD_TYPE=Release for meaningful numbers\n");
+#endif
+	std::printf ("Hardware threads: %u\n\n", std::thread::hardware_concurrency ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DoNotOptimize (const void* pointer)
+{
+	sink = pointer;
+}
+}
+}
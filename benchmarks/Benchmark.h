@@ -0,0 +1,46 @@
+#ifndef ANTERU_D3D12_SAMPLE_BENCHMARK_H_
+#define ANTERU_D3D12_SAMPLE_BENCHMARK_H_
+
+#include <cstddef>
+#include <functional>
+
+namespace anteru {
+namespace benchmark {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Run function at least minimumRuns times and for at least minimumSeconds,
+and return the fastest run in milliseconds. The fastest run is the one
+least disturbed by the rest of the system.
+*/
+double Measure (const std::function<void ()>& function,
+	const int minimumRuns = 5, const double minimumSeconds = 0.25);
+
+/**
+Like Measure, but call setup before each run, outside of the measured time.
+*/
+double MeasureWithSetup (const std::function<void ()>& setup,
+	const std::function<void ()>& function,
+	const int minimumRuns = 5, const double minimumSeconds = 0.25);
+
+/**
+Print a result line with the time and the throughput, if itemCount is not
+zero. itemName is in plural, for instance "keys".
+*/
+void Report (const char* name, const double milliseconds,
+	const double itemCount = 0, const char* itemName = nullptr);
+
+/**
+Print a warning if the benchmarks were built without optimizations, and
+the number of hardware threads.
+*/
+void PrintEnvironment ();
+
+/**
+Keep the compiler from optimizing away a computation whose result is not
+used otherwise.
+*/
+void DoNotOptimize (const void* pointer);
+}
+}
+
+#endif
@@ -0,0 +1,83 @@
+#include "BenchmarkMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace anteru {
+namespace benchmark {
+///////////////////////////////////////////////////////////////////////////////
+Mesh CreateTorusMesh (const int triangleCount)
+{
+	// Twice as many segments around the torus as around the tube, with two
+	// triangles per quad
+	const int tubeSegments = std::max (3,
+		static_cast<int> (std::sqrt (triangleCount / 4.0)));
+	const int ringSegments = tubeSegments * 2;
+	const float PI = 3.14159265f;
+
+	Mesh mesh;
+
+	// The last row and column repeat the first one with other texture
+	// coordinates, which makes the seam
+	for (int i = 0; i <= ringSegments; ++i) {
+		const float u = static_cast<float> (i) / ringSegments;
+		const float ringAngle = u * 2 * PI;
+
+		for (int j = 0; j <= tubeSegments; ++j) {
+			const float v = static_cast<float> (j) / tubeSegments;
+			const float tubeAngle = v * 2 * PI;
+			const float radius = 0.3f * (1 + 0.1f *
+				std::sin (ringAngle * 7) * std::sin (tubeAngle * 5));
+			const float distance = 1 + radius * std::cos (tubeAngle);
+
+			MeshVertex vertex = {};
+			vertex.position [0] = distance * std::cos (ringAngle);
+			vertex.position [1] = radius * std::sin (tubeAngle);
+			vertex.position [2] = distance * std::sin (ringAngle);
+			vertex.uv [0] = u * 4;
+			vertex.uv [1] = v;
+			mesh.vertices.push_back (vertex);
+		}
+	}
+
+	const int rowSize = tubeSegments + 1;
+	for (int i = 0; i < ringSegments; ++i) {
+		for (int j = 0; j < tubeSegments; ++j) {
+			const auto a = static_cast<std::uint32_t> (i * rowSize + j);
+			const auto b = a + rowSize;
+
+			mesh.indices.insert (mesh.indices.end (), { a, a + 1, b });
+			mesh.indices.insert (mesh.indices.end (), { b, a + 1, b + 1 });
+		}
+	}
+
+	ComputeNormals (mesh);
+	ComputeTangents (mesh);
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ShuffleTriangles (Mesh& mesh, const std::uint32_t seed)
+{
+	const auto triangleCount = mesh.indices.size () / 3;
+	std::vector<std::uint32_t> order (triangleCount);
+	for (std::size_t i = 0; i < triangleCount; ++i) {
+		order [i] = static_cast<std::uint32_t> (i);
+	}
+
+	std::mt19937 random (seed);
+	std::shuffle (order.begin (), order.end (), random);
+
+	std::vector<std::uint32_t> indices (triangleCount * 3);
+	for (std::size_t i = 0; i < triangleCount; ++i) {
+		std::copy_n (mesh.indices.begin () + order [i] * 3, 3,
+			indices.begin () + i * 3);
+	}
+
+	mesh.indices.swap (indices);
+}
+}
+}
@@ -0,0 +1,27 @@
+#ifndef ANTERU_D3D12_SAMPLE_BENCHMARKMESH_H_
+#define ANTERU_D3D12_SAMPLE_BENCHMARKMESH_H_
+
+#include <cstdint>
+
+#include "Mesh.h"
+
+namespace anteru {
+namespace benchmark {
+///////////////////////////////////////////////////////////////////////////////
+/**
+A bumpy torus with about triangleCount triangles, so the mesh benchmarks
+don't depend on a file. Normals vary all around and the texture
+coordinates have a seam, like a scanned mesh. The vertices are indexed,
+with normals and tangents, and the triangles are in grid order.
+*/
+Mesh CreateTorusMesh (const int triangleCount);
+
+/**
+Put the triangles into a random order, like a mesh exported without any
+optimization. The vertex cache hit rate drops to almost zero.
+*/
+void ShuffleTriangles (Mesh& mesh, const std::uint32_t seed = 42);
+}
+}
+
+#endif
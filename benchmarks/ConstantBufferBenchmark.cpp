@@ -0,0 +1,174 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "ConstantBufferLayout.h"
+
+using namespace anteru;
+using namespace anteru::hlsl;
+
+namespace {
+// A typical per-object buffer of 256 bytes, the alignment D3D12 requires
+// for constant buffer views
+using ObjectConstants = ConstantBufferLayout<float4x4, float4x4, float4,
+	float4, float3, float, Array<float4, 5>>;
+static_assert (ObjectConstants::SIZE == 256, "Unexpected buffer size");
+
+const std::size_t RING_SIZE = 64 << 20;
+const int BUFFER_COUNT = static_cast<int> (RING_SIZE / ObjectConstants::SIZE);
+
+struct Object
+{
+	float4x4 world;
+	float4x4 worldViewProjection;
+	float4 color;
+	float4 material;
+	float3 lightDirection;
+	float time;
+	Array<float4, 5> lights;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+Object CreateObject (const int index)
+{
+	Object object = {};
+	for (int r = 0; r < 4; ++r) {
+		for (int c = 0; c < 4; ++c) {
+			object.world.m [r][c] = static_cast<float> (index + r * 4 + c);
+			object.worldViewProjection.m [r][c] = static_cast<float> (index - r * 4 - c);
+		}
+	}
+	object.color = { { 1, 0.5f, 0.25f, 1 } };
+	object.time = static_cast<float> (index);
+	return object;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SetFields (ConstantBufferWriter<ObjectConstants>& writer,
+	const Object& object)
+{
+	writer.Set<0> (object.world);
+	writer.Set<1> (object.worldViewProjection);
+	writer.Set<2> (object.color);
+	writer.Set<3> (object.material);
+	writer.Set<4> (object.lightDirection);
+	writer.Set<5> (object.time);
+	writer.Set<6> (object.lights);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+How buffers were written before ConstantBufferLayout: one float store per
+component, straight into the mapped memory, with the matrices transposed
+element by element and the padding skipped.
+*/
+void WriteScattered (float* destination, const Object& object)
+{
+	for (int r = 0; r < 4; ++r) {
+		for (int c = 0; c < 4; ++c) {
+			destination [c * 4 + r] = object.world.m [r][c];
+			destination [16 + c * 4 + r] = object.worldViewProjection.m [r][c];
+		}
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		destination [32 + i] = object.color.v [i];
+		destination [36 + i] = object.material.v [i];
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		destination [40 + i] = object.lightDirection.v [i];
+	}
+	destination [43] = object.time;
+
+	for (int e = 0; e < 5; ++e) {
+		for (int i = 0; i < 4; ++i) {
+			destination [44 + e * 4 + i] = object.lights.elements [e].v [i];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ReportBandwidth (const char* name, const double milliseconds)
+{
+	std::printf ("%-48s %10.3f ms %10.2f GiB/s\n", name, milliseconds,
+		RING_SIZE / (milliseconds / 1000) / (1 << 30));
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	// Upload heaps are write-combined, which is not available outside of a
+	// driver, so this measures ordinary cached memory. Write-combined memory
+	// penalizes partial and out-of-order writes much more
+	std::unique_ptr<std::uint8_t []> ringStorage (new std::uint8_t [RING_SIZE + 16]);
+	const auto ring = reinterpret_cast<std::uint8_t*> (
+		(reinterpret_cast<std::uintptr_t> (ringStorage.get ()) + 15) & ~std::uintptr_t (15));
+	std::memset (ring, 0, RING_SIZE);
+
+	std::vector<Object> objects;
+	for (int i = 0; i < 1024; ++i) {
+		objects.push_back (CreateObject (i));
+	}
+
+	std::printf ("%d buffers of %d bytes, %d MiB\n", BUFFER_COUNT,
+		static_cast<int> (ObjectConstants::SIZE), static_cast<int> (RING_SIZE >> 20));
+
+	const auto writer = benchmark::Measure ([&] () {
+		ConstantBufferWriter<ObjectConstants> constants;
+		for (int i = 0; i < BUFFER_COUNT; ++i) {
+			SetFields (constants, objects [i % objects.size ()]);
+			constants.WriteTo (ring + i * ObjectConstants::SIZE);
+		}
+		FlushConstantBufferWrites ();
+	});
+	ReportBandwidth ("  ConstantBufferWriter, one flush", writer);
+
+	const auto flushEach = benchmark::Measure ([&] () {
+		ConstantBufferWriter<ObjectConstants> constants;
+		for (int i = 0; i < BUFFER_COUNT; ++i) {
+			SetFields (constants, objects [i % objects.size ()]);
+			constants.WriteTo (ring + i * ObjectConstants::SIZE);
+			FlushConstantBufferWrites ();
+		}
+	});
+	ReportBandwidth ("  ConstantBufferWriter, flush per buffer", flushEach);
+
+	const auto scattered = benchmark::Measure ([&] () {
+		for (int i = 0; i < BUFFER_COUNT; ++i) {
+			WriteScattered (reinterpret_cast<float*> (ring + i * ObjectConstants::SIZE),
+				objects [i % objects.size ()]);
+		}
+		benchmark::DoNotOptimize (ring);
+	});
+	ReportBandwidth ("  Scattered float stores", scattered);
+
+	// Upper bound: the buffers are assembled already, only the copy is left
+	std::vector<ConstantBufferWriter<ObjectConstants>> assembled (objects.size ());
+	for (std::size_t i = 0; i < objects.size (); ++i) {
+		SetFields (assembled [i], objects [i]);
+	}
+
+	const auto copy = benchmark::Measure ([&] () {
+		for (int i = 0; i < BUFFER_COUNT; ++i) {
+			assembled [i % assembled.size ()].WriteTo (ring + i * ObjectConstants::SIZE);
+		}
+		FlushConstantBufferWrites ();
+	});
+	ReportBandwidth ("  WriteConstantBuffer, assembled", copy);
+
+	const auto memcpyCopy = benchmark::Measure ([&] () {
+		for (int i = 0; i < BUFFER_COUNT; ++i) {
+			std::memcpy (ring + i * ObjectConstants::SIZE,
+				assembled [i % assembled.size ()].GetData (), ObjectConstants::SIZE);
+		}
+		benchmark::DoNotOptimize (ring);
+	});
+	ReportBandwidth ("  memcpy, assembled", memcpyCopy);
+}
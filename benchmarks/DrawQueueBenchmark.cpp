@@ -0,0 +1,127 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DrawQueue.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+State of a draw as a renderer would see it. The distribution follows a
+typical opaque pass: few root signatures, some hundred pipeline states,
+thousands of materials and random depth.
+*/
+struct DrawState
+{
+	int layer;
+	int rootSignature;
+	int pipelineState;
+	int material;
+	float depth;
+};
+
+std::vector<DrawState> CreateDraws (const std::size_t count)
+{
+	std::mt19937 random (42);
+	std::uniform_int_distribution<int> layer (0, 1);
+	std::uniform_int_distribution<int> rootSignature (0, 3);
+	std::uniform_int_distribution<int> pipelineState (0, 127);
+	std::uniform_int_distribution<int> material (0, 4095);
+	std::uniform_real_distribution<float> depth (0, 1);
+
+	std::vector<DrawState> draws (count);
+	for (auto& draw : draws) {
+		draw.layer = layer (random);
+		draw.rootSignature = rootSignature (random);
+		draw.pipelineState = pipelineState (random);
+		draw.material = material (random);
+		draw.depth = depth (random);
+	}
+
+	return draws;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	ThreadPool threadPool;
+
+	for (const std::size_t count : { 1000, 10000, 100000, 1000000 }) {
+		const auto draws = CreateDraws (count);
+		const double items = static_cast<double> (count);
+
+		std::printf ("%d draws\n", static_cast<int> (count));
+
+		std::vector<std::uint64_t> keys (count);
+		const auto pack = benchmark::Measure ([&] () {
+			for (std::size_t i = 0; i < count; ++i) {
+				const auto& draw = draws [i];
+				keys [i] = DrawKey::Pack (draw.layer, draw.rootSignature,
+					draw.pipelineState, draw.material, draw.depth);
+			}
+			benchmark::DoNotOptimize (keys.data ());
+		});
+		benchmark::Report ("  DrawKey::Pack", pack, items, "keys");
+
+		std::vector<std::uint64_t> sortedKeys (count), scratchKeys (count);
+		std::vector<std::uint32_t> values (count), scratchValues (count);
+
+		const auto radixSort = [&] (ThreadPool* pool) {
+			return benchmark::Measure ([&] () {
+				std::copy (keys.begin (), keys.end (), sortedKeys.begin ());
+				for (std::size_t i = 0; i < count; ++i) {
+					values [i] = static_cast<std::uint32_t> (i);
+				}
+
+				RadixSort (sortedKeys.data (), values.data (),
+					scratchKeys.data (), scratchValues.data (), count, pool);
+				benchmark::DoNotOptimize (values.data ());
+			});
+		};
+
+		benchmark::Report ("  RadixSort", radixSort (nullptr), items, "keys");
+
+		const std::string parallelName = "  RadixSort, " +
+			std::to_string (threadPool.GetConcurrency ()) + " threads";
+		benchmark::Report (parallelName.c_str (), radixSort (&threadPool),
+			items, "keys");
+
+		// The same key/value pairs through the standard library, std::sort
+		// is not stable but the fastest comparison sort available
+		std::vector<std::pair<std::uint64_t, std::uint32_t>> pairs (count);
+		const auto comparisonSort = [&] (const bool stable) {
+			return benchmark::Measure ([&] () {
+				for (std::size_t i = 0; i < count; ++i) {
+					pairs [i] = std::make_pair (keys [i], static_cast<std::uint32_t> (i));
+				}
+
+				const auto byKey = [] (const std::pair<std::uint64_t, std::uint32_t>& a,
+					const std::pair<std::uint64_t, std::uint32_t>& b) {
+					return a.first < b.first;
+				};
+
+				if (stable) {
+					std::stable_sort (pairs.begin (), pairs.end (), byKey);
+				} else {
+					std::sort (pairs.begin (), pairs.end (), byKey);
+				}
+				benchmark::DoNotOptimize (pairs.data ());
+			});
+		};
+
+		benchmark::Report ("  std::sort", comparisonSort (false), items, "keys");
+		benchmark::Report ("  std::stable_sort", comparisonSort (true), items, "keys");
+		std::printf ("\n");
+	}
+}
@@ -0,0 +1,99 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+
+#include "D3D12Sample.h"
+#include "NullDevice.h"
+
+using namespace anteru;
+
+namespace {
+// Frames of the short and the long run. Their difference cancels out the
+// startup and shutdown of the sample
+const int SHORT_RUN = 64;
+const int LONG_RUN = 64 + 65536;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The sample on a null device without GPU time, so fences complete as soon
+as they are signaled and only the CPU side of each frame is measured.
+Nothing is written to disk.
+*/
+std::unique_ptr<D3D12Sample> CreateSample (const bool useBundles)
+{
+	std::unique_ptr<D3D12Sample> sample (new D3D12Sample (CreateNullDevice ()));
+	sample->SetStatisticsInterval (0);
+	sample->SetFramePacing (FramePacingMode::Disabled, 0);
+	sample->SetShaderCache ("");
+	sample->SetPipelineCache ("");
+	sample->SetUseBundles (useBundles);
+	return sample;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Silences the reports the sample prints while it is alive.
+*/
+class MuteOutput final
+{
+public:
+	MuteOutput ()
+		: buffer_ (std::cout.rdbuf (nullptr))
+	{
+	}
+
+	~MuteOutput ()
+	{
+		std::cout.rdbuf (buffer_);
+	}
+
+	MuteOutput (const MuteOutput&) = delete;
+	MuteOutput& operator= (const MuteOutput&) = delete;
+
+private:
+	std::streambuf* buffer_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void Run (const char* name, const bool useBundles)
+{
+	std::printf ("%s\n", name);
+
+	const auto measure = [&] (const int frameCount) {
+		return benchmark::Measure ([&] () {
+			MuteOutput mute;
+			CreateSample (useBundles)->Run (frameCount);
+		});
+	};
+
+	const auto shortRun = measure (SHORT_RUN);
+	const auto longRun = measure (LONG_RUN);
+	const double frameCount = LONG_RUN - SHORT_RUN;
+
+	benchmark::Report ("  Startup and shutdown", shortRun - SHORT_RUN *
+		(longRun - shortRun) / frameCount);
+	benchmark::Report ("  Frame loop", longRun - shortRun, frameCount, "frames");
+	std::printf ("  %.2f us per frame\n", (longRun - shortRun) * 1000 / frameCount);
+
+	// The phases of a single run, as the sample reports them
+	auto sample = CreateSample (useBundles);
+	{
+		MuteOutput mute;
+		sample->Run (LONG_RUN);
+	}
+
+	sample->WriteFrameStatistics (std::cout, false);
+	std::cout << std::endl;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	Run ("Null device, bundles", true);
+	Run ("Null device, draws recorded every frame", false);
+}
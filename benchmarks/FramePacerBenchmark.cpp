@@ -0,0 +1,150 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "FramePacer.h"
+
+using namespace anteru;
+
+namespace {
+const int FRAME_COUNT = 2000;
+// Frames at the start which are not measured, while the history fills up
+const int WARM_UP_FRAMES = 100;
+
+///////////////////////////////////////////////////////////////////////////////
+struct Workload
+{
+	const char* name;
+	// Milliseconds of CPU and GPU work per frame
+	double cpuTime;
+	double gpuTime;
+	// Each frame takes up to this fraction more or less time
+	double jitter;
+	int framesInFlight;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Queue with frames that take a fixed amount of GPU time each, executed in
+submission order. Completions are reported to the pacer at the time they
+happen, as if the fence was polled continuously.
+*/
+class SimulatedGpu
+{
+public:
+	SimulatedGpu (SimulatedClock& clock, FramePacer& pacer)
+		: clock_ (clock)
+		, pacer_ (pacer)
+	{
+	}
+
+	void AdvanceTo (const double time)
+	{
+		while (completedCount_ < completionTimes_.size () &&
+			completionTimes_ [completedCount_] <= time) {
+			clock_.Advance (completionTimes_ [completedCount_] - clock_.Now ());
+			++completedCount_;
+			pacer_.OnFenceCompleted (completedCount_);
+		}
+
+		clock_.Advance (std::max (time - clock_.Now (), 0.0));
+	}
+
+	/**
+	Returns the time at which the frame completes.
+	*/
+	double Submit (const double gpuTime)
+	{
+		const double start = completionTimes_.empty ()
+			? clock_.Now ()
+			: std::max (clock_.Now (), completionTimes_.back ());
+		completionTimes_.push_back (start + gpuTime);
+		return completionTimes_.back ();
+	}
+
+	double GetCompletionTime (const std::size_t frame) const
+	{
+		return completionTimes_ [frame];
+	}
+
+private:
+	SimulatedClock& clock_;
+	FramePacer& pacer_;
+	std::vector<double> completionTimes_;
+	std::size_t completedCount_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Run the frame loop of the sample against a simulated clock and GPU, and
+print the mean latency from the start of CPU work to GPU completion and
+the mean frame interval.
+*/
+void Run (const Workload& workload, const char* name,
+	const FramePacingMode mode, const double target)
+{
+	SimulatedClock clock;
+	FramePacer pacer (clock, mode, target / 1000);
+	SimulatedGpu gpu (clock, pacer);
+
+	std::mt19937 random (42);
+	std::uniform_real_distribution<double> jitter (
+		1 - workload.jitter, 1 + workload.jitter);
+
+	double latency = 0;
+	double firstCompletion = 0, lastCompletion = 0;
+
+	for (int frame = 0; frame < FRAME_COUNT; ++frame) {
+		// Wait for the frame slot
+		if (frame >= workload.framesInFlight) {
+			gpu.AdvanceTo (gpu.GetCompletionTime (frame - workload.framesInFlight));
+		}
+
+		gpu.AdvanceTo (pacer.GetPredictedFrameStart ());
+		const double start = pacer.WaitForFrameStart ();
+
+		gpu.AdvanceTo (start + workload.cpuTime / 1000 * jitter (random));
+		const double completion = gpu.Submit (workload.gpuTime / 1000 * jitter (random));
+		pacer.OnFrameSubmitted (frame + 1);
+
+		if (frame == WARM_UP_FRAMES) {
+			firstCompletion = completion;
+		} else if (frame > WARM_UP_FRAMES) {
+			latency += completion - start;
+			lastCompletion = completion;
+		}
+	}
+
+	const int measuredFrames = FRAME_COUNT - WARM_UP_FRAMES - 1;
+	std::printf ("  %-28s latency %6.2f ms   frame interval %6.2f ms\n", name,
+		latency / measuredFrames * 1000,
+		(lastCompletion - firstCompletion) / measuredFrames * 1000);
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	const Workload workloads [] = {
+		{ "GPU bound", 4, 10, 0, 2 },
+		{ "GPU bound, 10% jitter", 4, 10, 0.1, 2 },
+		{ "GPU bound, 3 frames in flight", 4, 10, 0.1, 3 },
+		{ "CPU bound", 10, 4, 0.1, 2 }
+	};
+
+	for (const auto& workload : workloads) {
+		std::printf ("%s: %g ms CPU, %g ms GPU, %d frames in flight\n",
+			workload.name, workload.cpuTime, workload.gpuTime,
+			workload.framesInFlight);
+
+		Run (workload, "Unpaced", FramePacingMode::Disabled, 0);
+		Run (workload, "Just in time", FramePacingMode::TargetLatency, 0);
+		Run (workload, "Target latency 20 ms", FramePacingMode::TargetLatency, 20);
+		Run (workload, "Target frame rate 60 Hz", FramePacingMode::TargetFrameRate,
+			1000.0 / 60);
+	}
+}
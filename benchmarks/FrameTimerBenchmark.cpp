@@ -0,0 +1,101 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "FrameTimer.h"
+#include "Trace.h"
+
+using namespace anteru;
+
+namespace {
+// Scopes per measured run. The trace buffers are emptied before each run,
+// and have to hold the two events of every scope, as dropping an event is
+// cheaper than recording it
+const int SCOPE_COUNT = 4096;
+
+// The overhead each scope may add to the frame
+const double BUDGET_NS = 100;
+
+///////////////////////////////////////////////////////////////////////////////
+void ReportPerScope (const char* name, const double milliseconds)
+{
+	const double nanoseconds = milliseconds * 1e6 / SCOPE_COUNT;
+	std::printf ("%-48s %10.1f ns %s\n", name, nanoseconds,
+		nanoseconds < BUDGET_NS ? "" : "over budget");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MeasureScopes (const char* suffix)
+{
+	FrameTimer timer;
+	char name [64];
+
+	const auto clearTrace = [] () {
+		Tracer::Clear ();
+	};
+
+	std::snprintf (name, sizeof (name), "ScopedPhaseTimer, %s", suffix);
+	ReportPerScope (name, benchmark::MeasureWithSetup (clearTrace, [&] () {
+		for (int i = 0; i < SCOPE_COUNT; ++i) {
+			ScopedPhaseTimer scope (timer, FramePhase::RecordCommands);
+		}
+	}));
+
+	std::snprintf (name, sizeof (name), "TraceScope, %s", suffix);
+	ReportPerScope (name, benchmark::MeasureWithSetup (clearTrace, [&] () {
+		for (int i = 0; i < SCOPE_COUNT; ++i) {
+			TraceScope scope ("Benchmark", "index", i);
+		}
+	}));
+
+	// The sample ends a frame after a handful of scopes, so this is part of
+	// the cost as well
+	ReportPerScope ("FrameTimer::EndFrame", benchmark::Measure ([&] () {
+		for (int i = 0; i < SCOPE_COUNT; ++i) {
+			timer.AddPhaseTime (FramePhase::RecordCommands, i);
+			timer.EndFrame ();
+		}
+	}));
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+	std::printf ("Cost per scope, budget %.0f ns\n", BUDGET_NS);
+
+	MeasureScopes ("tracing off");
+
+	Tracer::Start ();
+	MeasureScopes ("tracing on");
+	Tracer::Stop ();
+
+	std::printf ("Dropped trace events: %d\n\n",
+		static_cast<int> (Tracer::GetDroppedEventCount ()));
+	Tracer::Clear ();
+
+	// Durations spread over several orders of magnitude, like frame phases
+	std::mt19937_64 random (42);
+	std::vector<std::uint64_t> durations (SCOPE_COUNT);
+	for (auto& duration : durations) {
+		duration = random () % (1ull << (10 + random () % 20));
+	}
+
+	LatencyHistogram histogram;
+	ReportPerScope ("LatencyHistogram::Record", benchmark::Measure ([&] () {
+		for (const auto duration : durations) {
+			histogram.Record (duration);
+		}
+	}));
+
+	std::uint64_t percentiles = 0;
+	const auto percentile = benchmark::Measure ([&] () {
+		percentiles += histogram.GetPercentile (0.5)
+			+ histogram.GetPercentile (0.95) + histogram.GetPercentile (0.99);
+	});
+	benchmark::DoNotOptimize (&percentiles);
+	benchmark::Report ("LatencyHistogram::GetPercentile, three", percentile);
+}
@@ -0,0 +1,135 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "ImageEncoder.h"
+#include "ImageIO.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Large flat areas and smooth gradients, like a rendered frame.
+*/
+std::vector<std::uint8_t> CreateRenderedImage (const int width, const int height)
+{
+	std::vector<std::uint8_t> pixels (width * height * 4);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			auto pixel = &pixels [(y * width + x) * 4];
+			// Eight by four blocks at any resolution
+			const bool inside = (x * 8 / width + y * 4 / height) % 3 == 0;
+			pixel [0] = static_cast<std::uint8_t> (inside ? 200 : x * 255 / width);
+			pixel [1] = static_cast<std::uint8_t> (inside ? 80 : y * 255 / height);
+			pixel [2] = 64;
+			pixel [3] = 255;
+		}
+	}
+
+	return pixels;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Gradients with noise in the low bits, like a photographed texture.
+*/
+std::vector<std::uint8_t> CreateTextureImage (const int width, const int height)
+{
+	std::mt19937 random (42);
+	std::uniform_int_distribution<int> noise (-2, 2);
+
+	std::vector<std::uint8_t> pixels (width * height * 4);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			auto pixel = &pixels [(y * width + x) * 4];
+			const int base [3] = {
+				x * 200 / width + 20, y * 200 / height + 20, (x + y) % 200 + 20
+			};
+			for (int c = 0; c < 3; ++c) {
+				pixel [c] = static_cast<std::uint8_t> (base [c] + noise (random));
+			}
+			pixel [3] = 255;
+		}
+	}
+
+	return pixels;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Run (const char* name, const std::vector<std::uint8_t>& pixels,
+	const int width, const int height, ThreadPool& threadPool)
+{
+	const int rowPitch = width * 4;
+	const double pixelCount = static_cast<double> (width) * height;
+
+	std::printf ("%s, %dx%d\n", name, width, height);
+
+	struct Format
+	{
+		const char* name;
+		std::vector<std::uint8_t> (*encode) (const void*, const int,
+			const int, const int);
+	};
+
+	const Format formats [] = {
+		{ "PNG", [] (const void* data, const int width, const int height,
+			const int rowPitch) {
+			return EncodePng (data, width, height, rowPitch);
+		} },
+		{ "QOI", EncodeQoi },
+		{ "Raw", EncodeRaw }
+	};
+
+	for (const auto& format : formats) {
+		std::vector<std::uint8_t> encoded;
+		const auto encode = benchmark::Measure ([&] () {
+			encoded = format.encode (pixels.data (), width, height, rowPitch);
+		});
+
+		char line [64];
+		std::snprintf (line, sizeof (line), "  Encode %s (%d KiB)", format.name,
+			static_cast<int> (encoded.size () / 1024));
+		benchmark::Report (line, encode, pixelCount, "pixels");
+
+		const auto decode = benchmark::Measure ([&] () {
+			int width, height;
+			const auto decoded = LoadImageFromMemory (encoded.data (),
+				encoded.size (), 64, &width, &height);
+			benchmark::DoNotOptimize (decoded.data ());
+		});
+
+		std::snprintf (line, sizeof (line), "  Decode %s", format.name);
+		benchmark::Report (line, decode, pixelCount, "pixels");
+	}
+
+	const auto pngParallel = benchmark::Measure ([&] () {
+		const auto encoded = EncodePng (pixels.data (), width, height,
+			rowPitch, &threadPool);
+		benchmark::DoNotOptimize (encoded.data ());
+	});
+	benchmark::Report ("  Encode PNG on the thread pool", pngParallel,
+		pixelCount, "pixels");
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	ThreadPool threadPool;
+
+	// 1080p and 4K
+	const int sizes [][2] = { { 1920, 1080 }, { 3840, 2160 } };
+	for (const auto& size : sizes) {
+		Run ("Rendered", CreateRenderedImage (size [0], size [1]),
+			size [0], size [1], threadPool);
+		Run ("Texture", CreateTextureImage (size [0], size [1]),
+			size [0], size [1], threadPool);
+	}
+}
@@ -0,0 +1,112 @@
+#include "Benchmark.h"
+#include "BenchmarkMesh.h"
+
+#include <cstdio>
+
+#include "MeshOptimizer.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+void PrintCacheStatistics (const char* name, const Mesh& mesh)
+{
+	const auto statistics = AnalyzeVertexCache (mesh.indices, mesh.vertices.size ());
+	std::printf ("  %-46s ACMR %.3f, ATVR %.3f\n", name,
+		statistics.acmr, statistics.atvr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Every triangle corner gets its own vertex, as LoadObj returns them.
+*/
+Mesh Unindex (const Mesh& mesh)
+{
+	Mesh result;
+	for (const auto index : mesh.indices) {
+		result.indices.push_back (static_cast<std::uint32_t> (result.vertices.size ()));
+		result.vertices.push_back (mesh.vertices [index]);
+	}
+
+	return result;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	const auto ordered = benchmark::CreateTorusMesh (270000);
+	auto shuffled = ordered;
+	benchmark::ShuffleTriangles (shuffled);
+	const auto unindexed = Unindex (shuffled);
+
+	const double triangleCount = static_cast<double> (ordered.indices.size () / 3);
+	std::printf ("Torus with %d vertices and %d triangles, FIFO cache of 16\n",
+		static_cast<int> (ordered.vertices.size ()), static_cast<int> (triangleCount));
+
+	auto vertexCacheOptimized = shuffled;
+	OptimizeVertexCache (vertexCacheOptimized.indices, vertexCacheOptimized.vertices.size ());
+
+	auto optimized = unindexed;
+	OptimizeMesh (optimized);
+
+	PrintCacheStatistics ("Shuffled", shuffled);
+	PrintCacheStatistics ("Grid order", ordered);
+	PrintCacheStatistics ("OptimizeVertexCache", vertexCacheOptimized);
+	PrintCacheStatistics ("OptimizeMesh", optimized);
+
+	Mesh mesh;
+	const auto deduplicate = benchmark::MeasureWithSetup ([&] () {
+		mesh = unindexed;
+	}, [&] () {
+		DeduplicateVertices (mesh);
+	});
+	benchmark::Report ("  DeduplicateVertices", deduplicate, triangleCount, "triangles");
+
+	const auto vertexCache = benchmark::MeasureWithSetup ([&] () {
+		mesh = shuffled;
+	}, [&] () {
+		OptimizeVertexCache (mesh.indices, mesh.vertices.size ());
+	});
+	benchmark::Report ("  OptimizeVertexCache", vertexCache, triangleCount, "triangles");
+
+	const auto overdraw = benchmark::MeasureWithSetup ([&] () {
+		mesh = vertexCacheOptimized;
+	}, [&] () {
+		OptimizeOverdraw (mesh.indices, mesh.vertices);
+	});
+	benchmark::Report ("  OptimizeOverdraw", overdraw, triangleCount, "triangles");
+
+	const auto vertexFetch = benchmark::MeasureWithSetup ([&] () {
+		mesh = vertexCacheOptimized;
+	}, [&] () {
+		OptimizeVertexFetch (mesh);
+	});
+	benchmark::Report ("  OptimizeVertexFetch", vertexFetch, triangleCount, "triangles");
+
+	const auto indexedInput = benchmark::MeasureWithSetup ([&] () {
+		mesh = shuffled;
+	}, [&] () {
+		OptimizeMesh (mesh);
+	});
+	benchmark::Report ("  OptimizeMesh, indexed input", indexedInput,
+		triangleCount, "triangles");
+
+	// As the sample does after loading an OBJ file
+	const auto unindexedInput = benchmark::MeasureWithSetup ([&] () {
+		mesh = unindexed;
+	}, [&] () {
+		OptimizeMesh (mesh);
+	});
+	benchmark::Report ("  OptimizeMesh, unindexed input", unindexedInput,
+		triangleCount, "triangles");
+
+	const auto analyze = benchmark::Measure ([&] () {
+		const auto statistics = AnalyzeVertexCache (optimized.indices,
+			optimized.vertices.size ());
+		benchmark::DoNotOptimize (&statistics);
+	});
+	benchmark::Report ("  AnalyzeVertexCache", analyze, triangleCount, "triangles");
+}
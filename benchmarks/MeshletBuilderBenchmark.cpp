@@ -0,0 +1,127 @@
+#include "Benchmark.h"
+#include "BenchmarkMesh.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+A torus prepared like the sample prepares a loaded mesh, shuffled first
+so OptimizeMesh has something to do.
+*/
+Mesh CreateOptimizedMesh (const int triangleCount, const std::uint32_t seed)
+{
+	auto mesh = benchmark::CreateTorusMesh (triangleCount);
+	benchmark::ShuffleTriangles (mesh, seed);
+	OptimizeMesh (mesh);
+	return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PrintStatistics (const char* name, const MeshletData& meshlets)
+{
+	const auto statistics = AnalyzeMeshlets (meshlets);
+	std::printf ("  %-46s %d meshlets, %.1f vertices, %.1f triangles\n",
+		name, statistics.meshletCount, statistics.averageVertices,
+		statistics.averageTriangles);
+	std::printf ("  %-46s vertex duplication %.2f, cone %.1f degrees, "
+		"%.0f%% cullable, %.1f%% culled\n", "",
+		statistics.vertexDuplication, statistics.averageConeAngle,
+		statistics.cullableShare * 100, statistics.backfaceCulledShare * 100);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool IsEqual (const MeshletData& a, const MeshletData& b)
+{
+	return a.meshlets.size () == b.meshlets.size ()
+		&& std::memcmp (a.meshlets.data (), b.meshlets.data (),
+			a.meshlets.size () * sizeof (Meshlet)) == 0
+		&& a.vertices == b.vertices
+		&& a.triangles == b.triangles;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	const auto mesh = CreateOptimizedMesh (640000, 42);
+	const double triangleCount = static_cast<double> (mesh.indices.size () / 3);
+	std::printf ("Torus with %d vertices and %d triangles, after OptimizeMesh\n",
+		static_cast<int> (mesh.vertices.size ()), static_cast<int> (triangleCount));
+
+	MeshletData meshlets;
+	const auto build = benchmark::Measure ([&] () {
+		meshlets = BuildMeshlets (mesh.indices, mesh.vertices);
+	});
+
+	PrintStatistics ("64 vertices, 124 triangles", meshlets);
+	PrintStatistics ("64 vertices, 64 triangles",
+		BuildMeshlets (mesh.indices, mesh.vertices, 64, 64));
+	PrintStatistics ("32 vertices, 64 triangles",
+		BuildMeshlets (mesh.indices, mesh.vertices, 32, 64));
+
+	benchmark::Report ("  BuildMeshlets", build, triangleCount, "triangles");
+
+	const auto analyze = benchmark::Measure ([&] () {
+		const auto statistics = AnalyzeMeshlets (meshlets);
+		benchmark::DoNotOptimize (&statistics);
+	});
+	benchmark::Report ("  AnalyzeMeshlets", analyze, triangleCount, "triangles");
+
+	const auto pack = benchmark::Measure ([&] () {
+		const auto packed = PackMeshlets (meshlets, mesh.vertices.size ());
+		benchmark::DoNotOptimize (packed.triangles.data ());
+	});
+	benchmark::Report ("  PackMeshlets", pack, triangleCount, "triangles");
+
+	// Several meshes of different sizes at once, as a scene with many parts
+	// is built
+	const int meshCount = 8;
+	std::vector<Mesh> parts;
+	std::vector<const Mesh*> partPointers;
+	double partTriangleCount = 0;
+	for (int i = 0; i < meshCount; ++i) {
+		parts.push_back (CreateOptimizedMesh (40000 + 10000 * i, i));
+		partTriangleCount += static_cast<double> (parts.back ().indices.size () / 3);
+	}
+
+	for (const auto& part : parts) {
+		partPointers.push_back (&part);
+	}
+
+	std::printf ("%d tori with %d triangles in total\n", meshCount,
+		static_cast<int> (partTriangleCount));
+
+	ThreadPool threadPool;
+
+	std::vector<MeshletData> serial, parallel;
+	const auto buildSerial = benchmark::Measure ([&] () {
+		serial = BuildMeshlets (partPointers);
+	});
+	benchmark::Report ("  BuildMeshlets", buildSerial, partTriangleCount, "triangles");
+
+	const auto buildParallel = benchmark::Measure ([&] () {
+		parallel = BuildMeshlets (partPointers, &threadPool);
+	});
+	const std::string parallelName = "  BuildMeshlets, " +
+		std::to_string (threadPool.GetConcurrency ()) + " threads";
+	benchmark::Report (parallelName.c_str (), buildParallel,
+		partTriangleCount, "triangles");
+
+	bool identical = serial.size () == parallel.size ();
+	for (std::size_t i = 0; identical && i < serial.size (); ++i) {
+		identical = IsEqual (serial [i], parallel [i]);
+	}
+	std::printf ("  Parallel result %s\n",
+		identical ? "identical" : "DIFFERENT");
+}
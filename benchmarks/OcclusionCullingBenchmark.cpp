@@ -0,0 +1,228 @@
+#include "Benchmark.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OcclusionCulling.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+// City blocks per side, each one building, and the distance between them
+const int BLOCKS = 32;
+const float BLOCK_SIZE = 20;
+const float BUILDING_SIZE = 14;
+const int BOX_COUNT = 100000;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+A synthetic city: a grid of box-shaped buildings of random height, which
+are the occluders, and many small boxes scattered over the streets, which
+are the objects to cull.
+*/
+struct Scene
+{
+	// World matrices which place the unit cube, row-major
+	std::vector<std::vector<float>> buildings;
+	std::vector<BoundingBox> boxes;
+};
+
+Scene CreateScene ()
+{
+	std::mt19937 random (42);
+	std::uniform_real_distribution<float> height (8, 60);
+	std::uniform_int_distribution<int> block (0, BLOCKS - 1);
+	std::uniform_real_distribution<float> street (0, BLOCK_SIZE - BUILDING_SIZE);
+	std::uniform_real_distribution<float> along (0, BLOCK_SIZE);
+	std::uniform_real_distribution<float> size (0.5f, 3);
+
+	Scene scene;
+	for (int z = 0; z < BLOCKS; ++z) {
+		for (int x = 0; x < BLOCKS; ++x) {
+			const float offset = (BLOCK_SIZE - BUILDING_SIZE) / 2;
+			scene.buildings.push_back ({
+				BUILDING_SIZE, 0, 0, x * BLOCK_SIZE + offset,
+				0, height (random), 0, 0,
+				0, 0, BUILDING_SIZE, z * BLOCK_SIZE + offset,
+				0, 0, 0, 1
+			});
+		}
+	}
+
+	for (int i = 0; i < BOX_COUNT; ++i) {
+		// Along a street in x or z direction
+		float x = block (random) * BLOCK_SIZE + along (random);
+		float z = block (random) * BLOCK_SIZE + street (random);
+		if (i % 2) {
+			std::swap (x, z);
+		}
+
+		const float s = size (random);
+		scene.boxes.push_back ({ { x, 0, z }, { x + s, s, z + s } });
+	}
+
+	return scene;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Left-handed view and perspective projection with D3D depth, for a camera
+at eye looking at target.
+*/
+void CreateViewProjection (const float* eye, const float* target,
+	const float aspectRatio, float* matrix)
+{
+	float forward [3], right [3], up [3];
+	float length = 0;
+	for (int i = 0; i < 3; ++i) {
+		forward [i] = target [i] - eye [i];
+		length += forward [i] * forward [i];
+	}
+	for (int i = 0; i < 3; ++i) {
+		forward [i] /= std::sqrt (length);
+	}
+
+	// right = (0, 1, 0) x forward, up = forward x right
+	right [0] = forward [2];
+	right [1] = 0;
+	right [2] = -forward [0];
+	length = std::sqrt (right [0] * right [0] + right [2] * right [2]);
+	right [0] /= length;
+	right [2] /= length;
+
+	up [0] = forward [1] * right [2] - forward [2] * right [1];
+	up [1] = forward [2] * right [0] - forward [0] * right [2];
+	up [2] = forward [0] * right [1] - forward [1] * right [0];
+
+	// 60 degrees vertical field of view
+	const float yScale = 1 / std::tan (30 * 3.14159265f / 180);
+	const float xScale = yScale / aspectRatio;
+	const float n = 0.5f, f = 2000.0f;
+
+	const float* axes [3] = { right, up, forward };
+	const float scales [3] = { xScale, yScale, f / (f - n) };
+	for (int row = 0; row < 3; ++row) {
+		float translation = 0;
+		for (int i = 0; i < 3; ++i) {
+			matrix [row * 4 + i] = axes [row][i] * scales [row];
+			translation -= axes [row][i] * eye [i];
+		}
+		matrix [row * 4 + 3] = translation * scales [row];
+	}
+	matrix [2 * 4 + 3] -= n * f / (f - n);
+
+	// w is the view space depth
+	for (int i = 0; i < 3; ++i) {
+		matrix [3 * 4 + i] = forward [i];
+	}
+	matrix [3 * 4 + 3] = -(forward [0] * eye [0] + forward [1] * eye [1]
+		+ forward [2] * eye [2]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Run (const Scene& scene, const int width, const int height,
+	ThreadPool& threadPool)
+{
+	// Above a corner of the city, looking diagonally across it
+	const float eye [] = { -20, 40, -20 };
+	const float target [] = { BLOCKS * BLOCK_SIZE / 2, 2, BLOCKS * BLOCK_SIZE / 2 };
+	float viewProjection [16];
+	CreateViewProjection (eye, target,
+		static_cast<float> (width) / static_cast<float> (height), viewProjection);
+
+	// The unit cube, 12 triangles
+	const float cube [] = {
+		0, 0, 0,  1, 0, 0,  1, 1, 0,  0, 1, 0,
+		0, 0, 1,  1, 0, 1,  1, 1, 1,  0, 1, 1
+	};
+	const std::uint32_t cubeIndices [] = {
+		0, 1, 2,  0, 2, 3,  5, 4, 7,  5, 7, 6,
+		4, 0, 3,  4, 3, 7,  1, 5, 6,  1, 6, 2,
+		3, 2, 6,  3, 6, 7,  4, 5, 1,  4, 1, 0
+	};
+
+	const double triangleCount = static_cast<double> (scene.buildings.size () * 12);
+	const double boxCount = static_cast<double> (scene.boxes.size ());
+
+	std::printf ("%dx%d, %d occluder triangles, %d boxes\n", width, height,
+		static_cast<int> (triangleCount), static_cast<int> (boxCount));
+
+	OcclusionBuffer serial (width, height);
+	OcclusionBuffer parallel (width, height, &threadPool);
+
+	const auto rasterize = [&] (OcclusionBuffer& buffer) {
+		return benchmark::Measure ([&] () {
+			buffer.Clear ();
+			buffer.SetViewProjection (viewProjection);
+			for (const auto& building : scene.buildings) {
+				buffer.AddOccluder (cube, 3 * sizeof (float), 8,
+					cubeIndices, 36, building.data ());
+			}
+			buffer.Rasterize ();
+		});
+	};
+
+	benchmark::Report ("  Rasterize occluders", rasterize (serial),
+		triangleCount, "triangles");
+	const std::string parallelName = "  Rasterize occluders, " +
+		std::to_string (threadPool.GetConcurrency ()) + " threads";
+	benchmark::Report (parallelName.c_str (), rasterize (parallel),
+		triangleCount, "triangles");
+
+	// Without occluders, Rasterize only builds the depth hierarchy over the
+	// cleared tiles
+	OcclusionBuffer empty (width, height);
+	const auto hierarchy = benchmark::Measure ([&] () {
+		empty.Clear ();
+		empty.Rasterize ();
+	});
+	benchmark::Report ("  Clear and build hierarchy", hierarchy);
+
+	// Fill the buffers again for the tests
+	rasterize (serial);
+	rasterize (parallel);
+
+	int hidden = 0;
+	const auto isVisible = benchmark::Measure ([&] () {
+		hidden = 0;
+		for (const auto& box : scene.boxes) {
+			hidden += serial.IsVisible (box) ? 0 : 1;
+		}
+	});
+	benchmark::Report ("  IsVisible", isVisible, boxCount, "boxes");
+
+	std::vector<std::uint8_t> visible (scene.boxes.size ());
+	const auto testVisibility = benchmark::Measure ([&] () {
+		parallel.TestVisibility (scene.boxes.data (),
+			static_cast<int> (scene.boxes.size ()), visible.data ());
+		benchmark::DoNotOptimize (visible.data ());
+	});
+	const std::string testVisibilityName = "  TestVisibility, " +
+		std::to_string (threadPool.GetConcurrency ()) + " threads";
+	benchmark::Report (testVisibilityName.c_str (), testVisibility,
+		boxCount, "boxes");
+
+	std::printf ("  %.1f%% of the boxes are hidden\n",
+		100.0 * hidden / boxCount);
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	const auto scene = CreateScene ();
+	ThreadPool threadPool;
+
+	// A quarter of the resolution in each direction, as the sample does, for
+	// 1080p and 4K
+	Run (scene, 480, 270, threadPool);
+	Run (scene, 960, 540, threadPool);
+}
@@ -0,0 +1,175 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "NullDevice.h"
+#include "PipelineCache.h"
+#include "PipelineStateManager.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+const int PERMUTATION_COUNT = 4096;
+
+const char SHADER_CACHE_PATH [] = "PipelineStateBenchmark.shadercache";
+const char PIPELINE_CACHE_PATH [] = "PipelineStateBenchmark.pipelinecache";
+
+const char SHADER_SOURCE [] =
+	"cbuffer PerObject : register(b0) { float4x4 world; float4 color; };\n"
+	"float4 VS_main (float3 p : POSITION) : SV_Position\n"
+	"{\n"
+	"	return mul (world, float4 (p, 1));\n"
+	"}\n"
+	"// Pixel shader with a few permutations\n"
+	"float4 PS_main () : SV_Target\n"
+	"{\n"
+	"#if VARIANT & 1\n"
+	"	return color * 2;\n"
+	"#else\n"
+	"	return color;\n"
+	"#endif\n"
+	"}\n";
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Descriptions which differ in a define of the pixel shader, like the
+material permutations of a real renderer.
+*/
+std::vector<PipelineStateDesc> CreateDescs (IRootSignature* rootSignature,
+	const std::vector<std::string>& variants)
+{
+	std::vector<PipelineStateDesc> descs (variants.size ());
+	for (std::size_t i = 0; i < variants.size (); ++i) {
+		auto& desc = descs [i];
+		desc.rootSignature = rootSignature;
+		desc.vertexShader = { SHADER_SOURCE, sizeof (SHADER_SOURCE) - 1,
+			"VS_main", "vs_5_0", {}, nullptr, 0 };
+		desc.pixelShader = { SHADER_SOURCE, sizeof (SHADER_SOURCE) - 1,
+			"PS_main", "ps_5_0", { { "VARIANT", variants [i].c_str () } }, nullptr, 0 };
+		desc.inputLayout = { { "POSITION", 0, PixelFormat::R32G32B32_Float, 0 } };
+		desc.renderTargetFormat = PixelFormat::R8G8B8A8_UNorm;
+		desc.blendMode = BlendMode::Opaque;
+	}
+
+	return descs;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Request all descs from a new manager and wait until they are created.
+*/
+void RequestAll (IRenderDevice& device, ThreadPool& threadPool,
+	const std::vector<PipelineStateDesc>& descs, const int repeatCount,
+	ShaderCache* shaderCache, PipelineCache* pipelineCache = nullptr)
+{
+	PipelineStateManager manager (device, threadPool, shaderCache,
+		pipelineCache);
+	for (int i = 0; i < repeatCount; ++i) {
+		for (const auto& desc : descs) {
+			manager.Request (desc);
+		}
+	}
+	manager.WaitIdle ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Start like the sample does: open the shader and pipeline caches, request
+all descs and save the caches.
+*/
+void Start (IRenderDevice& device, ThreadPool& threadPool,
+	IShaderCompiler& compiler, const std::vector<PipelineStateDesc>& descs)
+{
+	ShaderCache shaderCache (compiler, SHADER_CACHE_PATH);
+	PipelineCache pipelineCache (PIPELINE_CACHE_PATH,
+		device.GetAdapterIdentity ());
+	RequestAll (device, threadPool, descs, 1, &shaderCache, &pipelineCache);
+	shaderCache.Save ();
+	pipelineCache.Save ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void RemoveCaches ()
+{
+	std::remove (SHADER_CACHE_PATH);
+	std::remove (PIPELINE_CACHE_PATH);
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	auto device = CreateNullDevice ();
+
+	RootSignatureDesc rootSignatureDesc;
+	rootSignatureDesc.parameters.push_back ({ RootParameterType::ConstantBufferView,
+		0, 0, ShaderVisibility::All });
+	const auto rootSignature = device->CreateRootSignature (rootSignatureDesc);
+
+	std::vector<std::string> variants (PERMUTATION_COUNT);
+	for (int i = 0; i < PERMUTATION_COUNT; ++i) {
+		variants [i] = std::to_string (i);
+	}
+	const auto descs = CreateDescs (rootSignature.get (), variants);
+	const double items = PERMUTATION_COUNT;
+
+	std::printf ("%d pipeline states on the null device\n", PERMUTATION_COUNT);
+
+	const auto hash = benchmark::Measure ([&] () {
+		for (const auto& desc : descs) {
+			const auto key = PipelineStateManager::ComputeHash (desc);
+			benchmark::DoNotOptimize (&key);
+		}
+	});
+	benchmark::Report ("  ComputeHash", hash, items, "descs");
+
+	ThreadPool inlinePool (0);
+	ThreadPool threadPool;
+
+	for (ThreadPool* pool : { &inlinePool, &threadPool }) {
+		std::printf ("%s\n", pool == &inlinePool ? "Inline" : "Thread pool");
+
+		const auto create = benchmark::Measure ([&] () {
+			RequestAll (*device, *pool, descs, 1, nullptr);
+		});
+		benchmark::Report ("  Request distinct", create, items, "requests");
+
+		// Every request after the first one of a desc is a duplicate
+		const auto duplicates = benchmark::Measure ([&] () {
+			RequestAll (*device, *pool, descs, 8, nullptr);
+		});
+		benchmark::Report ("  Request each 8 times", duplicates,
+			items * 8, "requests");
+
+		// The cache is never saved, each run starts with an empty one
+		StubShaderCompiler compiler;
+		const auto compile = benchmark::Measure ([&] () {
+			ShaderCache shaderCache (compiler, SHADER_CACHE_PATH);
+			RequestAll (*device, *pool, descs, 1, &shaderCache);
+		});
+		benchmark::Report ("  Request distinct, stub compiler", compile,
+			items, "requests");
+
+		// Startup with both caches, from empty files and from the files of
+		// the previous run. On the null device, pipeline state creation is
+		// free, so this is the overhead of the caches and the stub compiler
+		const auto cold = benchmark::MeasureWithSetup (RemoveCaches, [&] () {
+			Start (*device, *pool, compiler, descs);
+		});
+		benchmark::Report ("  Cold start, both caches", cold, items, "requests");
+
+		const auto warm = benchmark::Measure ([&] () {
+			Start (*device, *pool, compiler, descs);
+		});
+		benchmark::Report ("  Warm start, both caches", warm, items, "requests");
+	}
+
+	RemoveCaches ();
+}
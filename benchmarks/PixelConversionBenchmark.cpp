@@ -0,0 +1,79 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "PixelConversion.h"
+#include "Simd.h"
+
+using namespace anteru;
+
+namespace {
+const int WIDTH = 1920;
+const int HEIGHT = 1080;
+
+///////////////////////////////////////////////////////////////////////////////
+const char* GetCodePath ()
+{
+#if ANTERU_F16C
+	return "F16C";
+#elif ANTERU_NEON
+	return "NEON";
+#elif ANTERU_SSE2
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	const std::size_t pixelCount = static_cast<std::size_t> (WIDTH) * HEIGHT;
+	const double items = static_cast<double> (pixelCount);
+
+	// HDR content: mostly in [0, 4], some highlights up to 1000
+	std::mt19937 random (42);
+	std::uniform_real_distribution<float> value (0, 4);
+	std::uniform_real_distribution<float> highlight (0, 1000);
+
+	std::vector<float> pixels (pixelCount * 4);
+	for (std::size_t i = 0; i < pixels.size (); ++i) {
+		pixels [i] = (i % 97 == 0) ? highlight (random) : value (random);
+	}
+
+	std::vector<std::uint16_t> halves (pixelCount * 4);
+	std::vector<float> floats (pixelCount * 4);
+	std::vector<std::uint32_t> packed (pixelCount);
+
+	std::printf ("%dx%d RGBA float, %s code path\n", WIDTH, HEIGHT, GetCodePath ());
+
+	const auto floatToHalf = benchmark::Measure ([&] () {
+		ConvertFloatToHalf (pixels.data (), halves.data (), pixels.size ());
+		benchmark::DoNotOptimize (halves.data ());
+	});
+	benchmark::Report ("  ConvertFloatToHalf", floatToHalf, items, "pixels");
+
+	const auto halfToFloat = benchmark::Measure ([&] () {
+		ConvertHalfToFloat (halves.data (), floats.data (), halves.size ());
+		benchmark::DoNotOptimize (floats.data ());
+	});
+	benchmark::Report ("  ConvertHalfToFloat", halfToFloat, items, "pixels");
+
+	const auto r11g11b10 = benchmark::Measure ([&] () {
+		PackR11G11B10 (pixels.data (), packed.data (), pixelCount);
+		benchmark::DoNotOptimize (packed.data ());
+	});
+	benchmark::Report ("  PackR11G11B10", r11g11b10, items, "pixels");
+
+	const auto r9g9b9e5 = benchmark::Measure ([&] () {
+		PackR9G9B9E5 (pixels.data (), packed.data (), pixelCount);
+		benchmark::DoNotOptimize (packed.data ());
+	});
+	benchmark::Report ("  PackR9G9B9E5", r9g9b9e5, items, "pixels");
+}
@@ -0,0 +1,109 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+#include "SoftwareRasterizer.h"
+#include "SoftwareShaders.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+const int WIDTH = 1920;
+const int HEIGHT = 1080;
+const int TEXTURE_SIZE = 256;
+// Full screen quads per run, drawn on top of each other
+const int LAYERS = 8;
+
+///////////////////////////////////////////////////////////////////////////////
+void ConstantPixelShader (const ShaderBindings&, const float*, float* color)
+{
+	for (int i = 0; i < 16; ++i) {
+		color [i] = 0.5f;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Measure LAYERS full screen quads with pixelShader, and report the shaded
+pixels per second.
+*/
+void Run (const char* name, ThreadPool* threadPool,
+	const SoftwarePixelShader pixelShader, const BlendMode blendMode,
+	const RasterImage& texture)
+{
+	std::vector<std::uint8_t> pixels (WIDTH * HEIGHT * 4);
+	const RasterImage target = {
+		pixels.data (), WIDTH, HEIGHT, WIDTH * 4, true,
+		IDENTITY_COMPONENT_MAPPING
+	};
+
+	RasterState state = {};
+	state.pixelShader = pixelShader;
+	state.bindings.textures [0] = texture;
+	state.bindings.samplers [0] = SamplerFilter::Linear;
+	state.varyingCount = 2;
+	state.blendMode = blendMode;
+	state.viewport = { 0, 0, WIDTH, HEIGHT, 0, 1 };
+	state.scissor = { 0, 0, WIDTH, HEIGHT };
+
+	// Clockwise on screen, the texture repeats four times
+	RasterVertex vertices [4] = {};
+	const float corners [4][2] = { { -1, 1 }, { 1, 1 }, { 1, -1 }, { -1, -1 } };
+	for (int i = 0; i < 4; ++i) {
+		vertices [i].position [0] = corners [i][0];
+		vertices [i].position [1] = corners [i][1];
+		vertices [i].position [3] = 1;
+		vertices [i].varyings [0] = corners [i][0] * 2 + 2;
+		vertices [i].varyings [1] = corners [i][1] * 2 + 2;
+	}
+	const std::uint32_t indices [] = { 0, 1, 2, 0, 2, 3 };
+
+	SoftwareRasterizer rasterizer (threadPool);
+	rasterizer.SetRenderTarget (target);
+
+	const auto milliseconds = benchmark::Measure ([&] () {
+		for (int i = 0; i < LAYERS; ++i) {
+			rasterizer.DrawTriangles (state, vertices, indices, 6);
+		}
+		rasterizer.Flush ();
+	});
+
+	benchmark::Report (name, milliseconds,
+		static_cast<double> (WIDTH) * HEIGHT * LAYERS, "pixels");
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	std::vector<std::uint8_t> texels (TEXTURE_SIZE * TEXTURE_SIZE * 4);
+	for (std::size_t i = 0; i < texels.size (); ++i) {
+		texels [i] = static_cast<std::uint8_t> (i * 7919 >> 3);
+	}
+	const RasterImage texture = {
+		texels.data (), TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_SIZE * 4, true,
+		IDENTITY_COMPONENT_MAPPING
+	};
+
+	const auto textured = FindSoftwareShader ("PS_main")->pixelShader;
+
+	ThreadPool threadPool;
+
+	std::printf ("%dx%d, %d full screen quads\n", WIDTH, HEIGHT, LAYERS);
+
+	for (ThreadPool* pool : { static_cast<ThreadPool*> (nullptr), &threadPool }) {
+		std::printf ("%s\n", pool ? "Thread pool" : "Single thread");
+
+		Run ("  Constant", pool, ConstantPixelShader,
+			BlendMode::Opaque, texture);
+		Run ("  Constant, alpha blended", pool, ConstantPixelShader,
+			BlendMode::AlphaBlend, texture);
+		Run ("  Bilinear sRGB texture (PS_main)", pool, textured,
+			BlendMode::Opaque, texture);
+	}
+}
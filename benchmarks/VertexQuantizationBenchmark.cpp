@@ -0,0 +1,110 @@
+#include "Benchmark.h"
+#include "BenchmarkMesh.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "Deflate.h"
+#include "Simd.h"
+#include "VertexQuantization.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+void Normalize (float* vector)
+{
+	const float length = std::sqrt (vector [0] * vector [0] +
+		vector [1] * vector [1] + vector [2] * vector [2]);
+	for (int i = 0; i < 3; ++i) {
+		vector [i] /= length;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Vertices with uniformly distributed normals and tangents, to find the
+largest error of the octahedral encoding.
+*/
+std::vector<MeshVertex> CreateRandomDirections (const int count)
+{
+	std::mt19937 random (42);
+	std::normal_distribution<float> distribution;
+
+	std::vector<MeshVertex> vertices (count);
+	for (auto& vertex : vertices) {
+		for (int i = 0; i < 3; ++i) {
+			vertex.normal [i] = distribution (random);
+			vertex.tangent [i] = distribution (random);
+		}
+
+		Normalize (vertex.normal);
+		Normalize (vertex.tangent);
+		vertex.tangent [3] = vertex.normal [0] < 0 ? -1.0f : 1.0f;
+	}
+
+	return vertices;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Run (const char* name, const std::vector<MeshVertex>& vertices,
+	const VertexFormat& format)
+{
+	const auto quantize = benchmark::Measure ([&] () {
+		const auto quantized = QuantizeVertices (vertices, format);
+		benchmark::DoNotOptimize (quantized.data.data ());
+	});
+
+	const auto quantized = QuantizeVertices (vertices, format);
+	const auto error = MeasureQuantizationError (vertices, quantized);
+
+	benchmark::Report (name, quantize, static_cast<double> (vertices.size ()),
+		"vertices");
+	std::printf ("    %d bytes per vertex, position error max %.2g, rms %.2g "
+		"of the diagonal, uv %.2g, normal %.4f, tangent %.4f degrees\n",
+		quantized.stride, error.maxPosition, error.rmsPosition, error.maxUv,
+		error.maxNormal, error.maxTangent);
+
+	// The scalar and SIMD code paths must produce the same bytes
+	std::printf ("    CRC-32 of the vertex data %08x\n", static_cast<unsigned int> (
+		Crc32 (quantized.data.data (), quantized.data.size ())));
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+#if ANTERU_SSE2
+	std::printf ("SSE2 code path\n");
+#else
+	std::printf ("Scalar code path\n");
+#endif
+
+	const auto mesh = benchmark::CreateTorusMesh (640000);
+	std::printf ("Torus with %d vertices, 48 bytes per MeshVertex\n",
+		static_cast<int> (mesh.vertices.size ()));
+
+	VertexFormat floats;
+	floats.position = PositionEncoding::Float;
+	floats.uv = UvEncoding::Float;
+	Run ("  Float positions and uvs", mesh.vertices, floats);
+
+	const VertexFormat positionsAndUvs;
+	Run ("  UNorm16 positions and uvs", mesh.vertices, positionsAndUvs);
+
+	VertexFormat halfUvs;
+	halfUvs.uv = UvEncoding::Half;
+	Run ("  UNorm16 positions, half uvs", mesh.vertices, halfUvs);
+
+	VertexFormat everything;
+	everything.normals = true;
+	everything.tangents = true;
+	Run ("  With octahedral normals and tangents", mesh.vertices, everything);
+
+	std::printf ("2M random directions\n");
+	Run ("  Octahedral normals and tangents", CreateRandomDirections (2 << 20),
+		everything);
+}
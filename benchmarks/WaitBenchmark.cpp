@@ -0,0 +1,68 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "WaitableEvent.h"
+
+using namespace anteru;
+
+namespace {
+const int SIGNAL_COUNT = 500;
+// Time between two signals, long enough for a blocked waiter to go to sleep
+const auto SIGNAL_INTERVAL = std::chrono::microseconds (500);
+
+typedef std::chrono::high_resolution_clock Clock;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Signal a CpuTimeline from another thread, like a GPU completing frames,
+and measure how long it takes until the waiting thread runs again.
+*/
+void Run (const char* name, const WaitStrategy strategy)
+{
+	CpuTimeline timeline;
+	WaitableEvent event;
+
+	std::vector<Clock::time_point> signalTimes (SIGNAL_COUNT);
+	std::vector<double> latencies (SIGNAL_COUNT);
+
+	std::thread gpu ([&] () {
+		for (int i = 0; i < SIGNAL_COUNT; ++i) {
+			std::this_thread::sleep_for (SIGNAL_INTERVAL);
+			signalTimes [i] = Clock::now ();
+			timeline.Signal (i + 1);
+		}
+	});
+
+	for (int i = 0; i < SIGNAL_COUNT; ++i) {
+		WaitForValue (timeline, i + 1, event, strategy);
+		const auto wakeUp = Clock::now ();
+		latencies [i] = std::chrono::duration<double, std::micro> (
+			wakeUp - signalTimes [i]).count ();
+	}
+
+	gpu.join ();
+
+	std::sort (latencies.begin (), latencies.end ());
+	std::printf ("  %-30s p50 %8.1f us   p99 %8.1f us   max %8.1f us\n", name,
+		latencies [SIGNAL_COUNT / 2], latencies [SIGNAL_COUNT * 99 / 100],
+		latencies.back ());
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ()
+{
+	benchmark::PrintEnvironment ();
+
+	std::printf ("Wake-up latency after a timeline signal, %d signals\n",
+		SIGNAL_COUNT);
+
+	Run ("Block", WaitStrategy::Block);
+	Run ("SpinThenBlock", WaitStrategy::SpinThenBlock);
+	Run ("Spin", WaitStrategy::Spin);
+}
@@ -0,0 +1,30 @@
+#ifndef ANTERU_D3D12_SAMPLE_BLOCKCOMPRESSION_H_
+#define ANTERU_D3D12_SAMPLE_BLOCKCOMPRESSION_H_
+
+#include <cstdint>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Compress a 4x4 block of RGBA8 pixels, stored row by row in 64 bytes, into
+the 8 bytes of a BC1 block. Alpha is ignored, the block always uses the
+four color mode. Returns the sum of squared errors over red, green and
+blue.
+*/
+int EncodeBc1Block (const std::uint8_t* pixels, std::uint8_t* block);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Compress a 4x4 block of RGBA8 pixels into the 16 bytes of a BC3 block.
+Returns the sum of squared errors over all four channels.
+*/
+int EncodeBc3Block (const std::uint8_t* pixels, std::uint8_t* block);
+
+///////////////////////////////////////////////////////////////////////////////
+void DecodeBc1Block (const std::uint8_t* block, std::uint8_t* pixels);
+
+///////////////////////////////////////////////////////////////////////////////
+void DecodeBc3Block (const std::uint8_t* block, std::uint8_t* pixels);
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef ANTERU_D3D12_SAMPLE_BUNDLECACHE_H_
+#define ANTERU_D3D12_SAMPLE_BUNDLECACHE_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Keeps static draw sequences recorded as bundles, so they don't have to be
+recorded again every frame.
+
+A bundle is identified by a key which describes the sequence, and depends
+on the objects it references, such as buffers, pipeline states and
+descriptor heaps. It is recorded again once the list of objects changes,
+or one of them has been marked as changed with Invalidate since the
+bundle was recorded. Objects are only compared by address, the cache
+keeps no state for them.
+
+Bundles which have been replaced or went unused are destroyed once the
+GPU is done with the last frame which executed them. The frame is
+identified by the fence value signaled after it, as passed to BeginFrame.
+*/
+class BundleCache final
+{
+public:
+	using RecordFunction = std::function<void (ICommandList* bundle)>;
+
+	/**
+	Bundles which were not used for maxUnusedFrames frames are removed.
+	*/
+	explicit BundleCache (IRenderDevice& device, const int maxUnusedFrames = 16);
+	~BundleCache ();
+
+	BundleCache (const BundleCache&) = delete;
+	BundleCache& operator= (const BundleCache&) = delete;
+
+	/**
+	Start a frame which completes once frameFenceValue is signaled.
+	Bundles which are no longer needed and were last used by frames up to
+	completedFenceValue are destroyed.
+	*/
+	void BeginFrame (const std::uint64_t frameFenceValue,
+		const std::uint64_t completedFenceValue);
+
+	/**
+	The bundle for key, recorded by record if there is none yet or one of
+	the objects has changed. record gets a bundle which has been reset
+	already, and must not close it. The bundle stays valid until the next
+	BeginFrame.
+	*/
+	ICommandList* Get (const std::uint64_t key,
+		const std::vector<const void*>& dependencies,
+		const RecordFunction& record);
+
+	/**
+	Mark object as changed, all bundles which depend on it are retired
+	right away and recorded again by the next Get. This must also be
+	called when an object a bundle depends on is destroyed, as a new
+	object may get the same address.
+	*/
+	void Invalidate (const void* object);
+
+	/**
+	Number of bundles recorded so far.
+	*/
+	int GetRecordCount () const
+	{
+		return recordCount_;
+	}
+
+	int GetBundleCount () const
+	{
+		return static_cast<int> (bundles_.size ());
+	}
+
+private:
+	struct Bundle
+	{
+		std::unique_ptr<ICommandList> commandList;
+		std::vector<const void*> dependencies;
+		std::uint64_t lastUsedFrame;
+		std::uint64_t lastUsedFenceValue;
+	};
+
+	struct RetiredBundle
+	{
+		std::unique_ptr<ICommandList> commandList;
+		std::uint64_t fenceValue;
+	};
+
+	void Retire (Bundle& bundle);
+
+	IRenderDevice& device_;
+	int maxUnusedFrames_;
+
+	std::map<std::uint64_t, Bundle> bundles_;
+	std::vector<RetiredBundle> retiredBundles_;
+
+	std::uint64_t frame_ = 0;
+	std::uint64_t frameFenceValue_ = 0;
+	int recordCount_ = 0;
+};
+}
+
+#endif
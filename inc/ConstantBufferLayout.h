@@ -0,0 +1,285 @@
+#ifndef ANTERU_D3D12_SAMPLE_CONSTANTBUFFERLAYOUT_H_
+#define ANTERU_D3D12_SAMPLE_CONSTANTBUFFERLAYOUT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+
+namespace anteru {
+namespace hlsl {
+// C++ counterparts of the HLSL types which can be placed in a constant
+// buffer. bool is 32 bits wide in HLSL, use uint for it.
+template <typename T, int Size>
+struct Vector
+{
+	T v [Size];
+};
+
+using float1 = Vector<float, 1>;
+using float2 = Vector<float, 2>;
+using float3 = Vector<float, 3>;
+using float4 = Vector<float, 4>;
+using int1 = Vector<std::int32_t, 1>;
+using int2 = Vector<std::int32_t, 2>;
+using int3 = Vector<std::int32_t, 3>;
+using int4 = Vector<std::int32_t, 4>;
+using uint1 = Vector<std::uint32_t, 1>;
+using uint2 = Vector<std::uint32_t, 2>;
+using uint3 = Vector<std::uint32_t, 3>;
+using uint4 = Vector<std::uint32_t, 4>;
+
+/**
+m is indexed [row][column] on the CPU. HLSL stores matrices column major
+unless they are declared row_major, one register per column or row.
+*/
+template <typename T, int Rows, int Columns, bool RowMajor = false>
+struct Matrix
+{
+	T m [Rows][Columns];
+};
+
+using float4x4 = Matrix<float, 4, 4>;
+using float3x4 = Matrix<float, 3, 4>;
+using float4x3 = Matrix<float, 4, 3>;
+
+/**
+Every element of an array starts a new register.
+*/
+template <typename T, int Size>
+struct Array
+{
+	T elements [Size];
+};
+}
+
+namespace detail {
+const std::size_t REGISTER_SIZE = 16;
+
+constexpr std::size_t AlignToRegister (const std::size_t offset)
+{
+	return (offset + REGISTER_SIZE - 1) & ~(REGISTER_SIZE - 1);
+}
+
+// SIZE is the size without the padding after the last component, as
+// following scalars and vectors can be packed into the same register.
+// Types with NEW_REGISTER set always start at a register boundary.
+template <typename T>
+struct TypeLayout;
+
+template <typename T>
+struct ScalarLayout
+{
+	static const std::size_t SIZE = 4;
+	static const bool NEW_REGISTER = false;
+
+	static void Write (std::uint8_t* destination, const T& value)
+	{
+		std::memcpy (destination, &value, SIZE);
+	}
+};
+
+template <> struct TypeLayout<float> : ScalarLayout<float> {};
+template <> struct TypeLayout<std::int32_t> : ScalarLayout<std::int32_t> {};
+template <> struct TypeLayout<std::uint32_t> : ScalarLayout<std::uint32_t> {};
+
+template <typename T, int Size>
+struct TypeLayout<hlsl::Vector<T, Size>>
+{
+	static_assert (Size >= 1 && Size <= 4, "Vectors have one to four components");
+
+	static const std::size_t SIZE = Size * TypeLayout<T>::SIZE;
+	static const bool NEW_REGISTER = false;
+
+	static void Write (std::uint8_t* destination, const hlsl::Vector<T, Size>& value)
+	{
+		std::memcpy (destination, value.v, SIZE);
+	}
+};
+
+template <typename T, int Rows, int Columns, bool RowMajor>
+struct TypeLayout<hlsl::Matrix<T, Rows, Columns, RowMajor>>
+{
+	static_assert (Rows >= 1 && Rows <= 4 && Columns >= 1 && Columns <= 4,
+		"Matrices have one to four rows and columns");
+
+	static const int REGISTERS = RowMajor ? Rows : Columns;
+	static const int COMPONENTS = RowMajor ? Columns : Rows;
+	static const std::size_t SIZE = (REGISTERS - 1) * REGISTER_SIZE
+		+ COMPONENTS * TypeLayout<T>::SIZE;
+	static const bool NEW_REGISTER = true;
+
+	static void Write (std::uint8_t* destination,
+		const hlsl::Matrix<T, Rows, Columns, RowMajor>& value)
+	{
+		// Assemble each register first, so it's written with a single store
+		for (int r = 0; r < REGISTERS; ++r) {
+			T elements [COMPONENTS];
+			for (int c = 0; c < COMPONENTS; ++c) {
+				elements [c] = RowMajor ? value.m [r][c] : value.m [c][r];
+			}
+
+			std::memcpy (destination + r * REGISTER_SIZE, elements, sizeof (elements));
+		}
+	}
+};
+
+template <typename T, int Size>
+struct TypeLayout<hlsl::Array<T, Size>>
+{
+	static_assert (Size >= 1, "Arrays must not be empty");
+
+	static const std::size_t STRIDE = AlignToRegister (TypeLayout<T>::SIZE);
+	static const std::size_t SIZE = (Size - 1) * STRIDE + TypeLayout<T>::SIZE;
+	static const bool NEW_REGISTER = true;
+
+	static void Write (std::uint8_t* destination, const hlsl::Array<T, Size>& value)
+	{
+		for (int i = 0; i < Size; ++i) {
+			TypeLayout<T>::Write (destination + i * STRIDE, value.elements [i]);
+		}
+	}
+};
+
+/**
+Offset at which a field starts if the previous one ended at end. A field
+which would straddle a register boundary moves to the next register.
+*/
+constexpr std::size_t PlaceField (const std::size_t end, const std::size_t size,
+	const bool newRegister)
+{
+	return (end % REGISTER_SIZE != 0 &&
+		(newRegister || end % REGISTER_SIZE + size > REGISTER_SIZE))
+		? AlignToRegister (end) : end;
+}
+
+// Recursive, as Visual Studio 2015 does not support loops in constexpr
+// functions
+template <typename... Fields>
+struct PackedLayout;
+
+template <>
+struct PackedLayout<>
+{
+	static constexpr std::size_t GetOffset (const std::size_t end, const int)
+	{
+		return end;
+	}
+};
+
+template <typename First, typename... Rest>
+struct PackedLayout<First, Rest...>
+{
+	static constexpr std::size_t GetStart (const std::size_t end)
+	{
+		return PlaceField (end, TypeLayout<First>::SIZE,
+			TypeLayout<First>::NEW_REGISTER);
+	}
+
+	/**
+	Offset of field index, or the end of the last field if index is the
+	number of fields.
+	*/
+	static constexpr std::size_t GetOffset (const std::size_t end, const int index)
+	{
+		return index == 0 ? GetStart (end) : PackedLayout<Rest...>::GetOffset (
+			GetStart (end) + TypeLayout<First>::SIZE, index - 1);
+	}
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Layout of a cbuffer with the given field types, in declaration order,
+computed at compile time with the HLSL packing rules: fields are packed
+into 16-byte registers, but never straddle a register boundary, and arrays
+and matrices start a new register. Check the result against the offsets
+which tools/cbufferLayout.py extracts from the shader source, so the
+build fails if the C++ and HLSL declarations diverge.
+*/
+template <typename... Fields>
+class ConstantBufferLayout final
+{
+public:
+	static_assert (sizeof... (Fields) > 0, "A constant buffer needs at least one field");
+
+	static const int FIELD_COUNT = static_cast<int> (sizeof... (Fields));
+
+	template <int Index>
+	using FieldType = typename std::tuple_element<Index, std::tuple<Fields...>>::type;
+
+	static constexpr std::size_t GetOffset (const int index)
+	{
+		return detail::PackedLayout<Fields...>::GetOffset (0, index);
+	}
+
+	template <int Index>
+	static constexpr std::size_t GetSize ()
+	{
+		return detail::TypeLayout<FieldType<Index>>::SIZE;
+	}
+
+	/**
+	Size of the buffer, which is always a multiple of the register size.
+	*/
+	static constexpr std::size_t SIZE =
+		detail::AlignToRegister (GetOffset (FIELD_COUNT));
+};
+
+template <typename... Fields>
+constexpr std::size_t ConstantBufferLayout<Fields...>::SIZE;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Copy size bytes, a multiple of 16, with aligned 16-byte stores from first
+to last. Constant buffers in upload heaps are write-combined, where
+reads, partial and out-of-order writes are expensive, so updates should
+always go through here. Call FlushConstantBufferWrites once all buffers
+for a submission have been written.
+*/
+void WriteConstantBuffer (void* destination, const void* source,
+	const std::size_t size);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Make all previous WriteConstantBuffer calls visible to other threads and
+the GPU. This drains the write-combining buffers, so it should be called
+once before the command lists are submitted, not after every buffer.
+*/
+void FlushConstantBufferWrites ();
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Assembles the contents of a constant buffer in cached memory, to be
+written to mapped memory in one go with WriteTo. Padding is zero.
+*/
+template <typename Layout>
+class ConstantBufferWriter final
+{
+public:
+	template <int Index>
+	void Set (const typename Layout::template FieldType<Index>& value)
+	{
+		// Without the constant, the offset may be computed at runtime
+		static const std::size_t OFFSET = Layout::GetOffset (Index);
+
+		detail::TypeLayout<typename Layout::template FieldType<Index>>::Write (
+			data_ + OFFSET, value);
+	}
+
+	void WriteTo (void* destination) const
+	{
+		WriteConstantBuffer (destination, data_, Layout::SIZE);
+	}
+
+	const void* GetData () const
+	{
+		return data_;
+	}
+
+private:
+	alignas (16) std::uint8_t data_ [Layout::SIZE] = {};
+};
+}
+
+#endif
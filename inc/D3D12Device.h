@@ -0,0 +1,18 @@
+#ifndef ANTERU_D3D12_SAMPLE_D3D12DEVICE_H_
+#define ANTERU_D3D12_SAMPLE_D3D12DEVICE_H_
+
+#include <memory>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Create a D3D12 device on the default adapter, with feature level 11.0 or
+higher. In debug builds, the debug layer is enabled if it is installed.
+Only available on Windows.
+*/
+std::unique_ptr<IRenderDevice> CreateD3D12Device ();
+}
+
+#endif
@@ -1,13 +1,31 @@
 #ifndef ANTERU_D3D12_SAMPLE_D3D12SAMPLE_H_
 #define ANTERU_D3D12_SAMPLE_D3D12SAMPLE_H_
 
-#include <d3d12.h>
-#include <wrl.h>
+#include <iosfwd>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "BundleCache.h"
+#include "DrawQueue.h"
+#include "FramePacer.h"
+#include "FrameReadback.h"
+#include "FrameRing.h"
+#include "FrameTimer.h"
+#include "GpuProfiler.h"
+#include "OcclusionCulling.h"
+#include "PipelineStateManager.h"
+#include "RenderDevice.h"
+#include "RootSignatureBuilder.h"
+#include "TexturePacking.h"
+#include "VertexQuantization.h"
+#include "WaitableEvent.h"
+
 namespace anteru {
-class Window;
+class IShaderCompiler;
+class PipelineCache;
+class ShaderCache;
+class ThreadPool;
 
 ///////////////////////////////////////////////////////////////////////////////
 class D3D12Sample
@@ -15,88 +33,262 @@ class D3D12Sample
 private:
 public:
 
-	D3D12Sample ();
+	/**
+	framesInFlight is the number of frames the CPU may record ahead of the
+	GPU, backBufferCount the number of swap chain buffers. Both can be
+	chosen independently, trading latency for throughput.
+
+	All rendering goes through device, which can be a D3D12 device or a
+	null device to run the frame loop without a GPU.
+	*/
+	D3D12Sample (std::unique_ptr<IRenderDevice> device,
+		const int framesInFlight = 3, const int backBufferCount = 3);
 	~D3D12Sample ();
 
 	void Run (const int frameCount);
 
+	/**
+	Select how the start of CPU work for each frame is scheduled, see
+	FramePacingMode for details. Must be called before Run.
+	*/
+	void SetFramePacing (const FramePacingMode mode, const double target);
+
+	/**
+	Render into an offscreen target of width x height instead of a swap
+	chain, so no window is needed. Every frame is copied into a ring of
+	readback buffers and passed to callback once the GPU is done with it,
+	a few frames later, in order. Must be called before Run.
+	*/
+	void SetOffscreen (const int width, const int height,
+		const ReadbackCallback& callback);
+
+	/**
+	Select how the texture is stored on the GPU, see PackTexture. Must be
+	called before Run.
+	*/
+	void SetTexturePacking (const TexturePackingOptions& options);
+
+	/**
+	Draw the .obj or .glb mesh at path instead of the built-in quad. The
+	mesh is optimized when it is loaded, see OptimizeMesh. Must be called
+	before Run.
+	*/
+	void SetMesh (const std::string& path);
+
+	/**
+	Select how the mesh vertices are stored on the GPU, see
+	QuantizeVertices. The shaders don't read normals or tangents, so they
+	should not be requested. Must be called before Run.
+	*/
+	void SetVertexFormat (const VertexFormat& format);
+
+	/**
+	Store compiled shaders in a ShaderCache at path, so later runs skip
+	the compiler. An empty path disables the cache. Must be called before
+	Run.
+	*/
+	void SetShaderCache (const std::string& path);
+
+	/**
+	Use the shader permutations precompiled into the executable. If
+	disabled, the shaders are compiled at runtime, through the shader cache
+	if there is one. Outside of Windows the archive only holds placeholder
+	bytecode, so this is the only way to exercise the cache there. Enabled
+	by default. Must be called before Run.
+	*/
+	void SetUseShaderArchive (const bool useShaderArchive);
+
+	/**
+	Store compiled pipeline states in a PipelineCache at path, so later
+	runs on the same adapter and driver create them faster. An empty path
+	disables the cache. Must be called before Run.
+	*/
+	void SetPipelineCache (const std::string& path);
+
+	/**
+	Print the per-phase frame timings for the recent frames every
+	frameCount frames. 0 disables the periodic report; the report for all
+	frames is always written at shutdown.
+	*/
+	void SetStatisticsInterval (const int frameCount);
+
+	/**
+	Record the draws into bundles which are kept across frames as long as
+	the draw list doesn't change, instead of recording them every frame.
+	Enabled by default. Must be called before Run.
+	*/
+	void SetUseBundles (const bool useBundles);
+
+	void WriteFrameStatistics (std::ostream& output, const bool rolling) const;
+
 protected:
+	/**
+	Slot of the per-frame resources (command lists, constant buffers, ...)
+	used by the frame which is currently recorded.
+	*/
 	int GetQueueSlot () const
 	{
-		return currentBackBuffer_;
+		return frameRing_.GetCurrentSlot ();
 	}
 
-	static const int QUEUE_SLOT_COUNT = 3;
+	int GetQueueSlotCount () const
+	{
+		return frameRing_.GetFramesInFlight ();
+	}
 
-	static constexpr int GetQueueSlotCount ()
+	int GetBackBufferCount () const
 	{
-		return QUEUE_SLOT_COUNT;
+		return backBufferCount_;
 	}
 
-	D3D12_VIEWPORT viewport_;
-	D3D12_RECT rectScissor_;
-	Microsoft::WRL::ComPtr<IDXGISwapChain> swapChain_;
-	Microsoft::WRL::ComPtr<ID3D12Device> device_;
-	Microsoft::WRL::ComPtr<ID3D12Resource> renderTargets_ [QUEUE_SLOT_COUNT];
-	Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue_;
+	Viewport viewport_;
+	ScissorRect rectScissor_;
+	std::unique_ptr<IRenderDevice> device_;
+	std::unique_ptr<ISwapChain> swapChain_;
+	ICommandQueue* commandQueue_ = nullptr;
 
-	HANDLE frameFenceEvents_ [QUEUE_SLOT_COUNT];
-	Microsoft::WRL::ComPtr<ID3D12Fence> frameFences_ [QUEUE_SLOT_COUNT];
-	UINT64 currentFenceValue_;
-	UINT64 fenceValues_[QUEUE_SLOT_COUNT];
+	FrameRing frameRing_;
+	int backBufferCount_;
 
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> renderTargetDescriptorHeap_;
+	// A single fence per queue, signaled with increasing values. Frames and
+	// uploads wait for the value signaled after their work
+	std::unique_ptr<IFence> fence_;
+	WaitableEvent fenceEvent_;
+	WaitStrategy fenceWaitStrategy_ = WaitStrategy::SpinThenBlock;
+	std::uint64_t currentFenceValue_;
 
 private:
 	void Initialize ();
 	void Shutdown ();
 
+	std::uint64_t SignalFence ();
+	void WaitForFence (const std::uint64_t value);
+
 	void PrepareRender ();
 	void FinalizeRender ();
 
 	void Render ();
 	void Present ();
+	void DeliverFrames ();
+
+	// Either the current swap chain buffer or the offscreen target
+	IResource* GetRenderTarget ();
+	// State of the render target outside of the frame
+	ResourceState GetRenderTargetIdleState () const;
 	void UpdateConstantBuffer ();
+	void BuildDrawList ();
+	void RecordCommands (ICommandList* commandList);
+	void SetPerFrameConstants (ICommandList* commandList);
+	void RecordDraws (ICommandList* commandList, const bool setPerFrameConstants);
+	std::uint64_t GetDrawListKey () const;
 
-	void CreateDeviceAndSwapChain ();
-	void CreateAllocatorsAndCommandLists ();
+	void CreateSwapChain ();
+	void CreateOffscreenTarget ();
+	void CreateCommandLists ();
+	void CreateGpuProfiler ();
 	void CreateViewportScissor ();
 	void CreateRootSignature ();
-	void CreateMeshBuffers (ID3D12GraphicsCommandList* uploadCommandList);
+	void CreateMeshBuffers (ICommandList* uploadCommandList);
 	void CreatePipelineStateObject ();
+	void WaitForPipelineStates ();
 	void CreateConstantBuffer ();
-	void CreateTexture (ID3D12GraphicsCommandList* uploadCommandList);
+	void CreateTexture (ICommandList* uploadCommandList);
 	void SetupSwapChain ();
-	void SetupRenderTargets ();
 
-	std::unique_ptr<Window> window_;
+	SystemClock clock_;
+	std::unique_ptr<FramePacer> framePacer_;
+	FramePacingMode framePacingMode_ = FramePacingMode::TargetLatency;
+	double framePacingTarget_ = 0;
+
+	FrameTimer frameTimer_;
+	int statisticsInterval_ = 0;
+	std::unique_ptr<ThreadPool> threadPool_;
 
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocators_[QUEUE_SLOT_COUNT];
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandLists_[QUEUE_SLOT_COUNT];
+	std::vector<std::unique_ptr<ICommandList>> commandLists_;
+
+	std::unique_ptr<IGpuTimestampBackend> gpuTimestamps_;
+	std::unique_ptr<GpuProfiler> gpuProfiler_;
 
 	int currentBackBuffer_ = 0;
 
-	Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature_;
-	Microsoft::WRL::ComPtr<ID3D12PipelineState> pso_;
+	int renderTargetWidth_ = 0;
+	int renderTargetHeight_ = 0;
+	PixelFormat renderTargetFormat_ = PixelFormat::Unknown;
+
+	int offscreenWidth_ = 0;
+	int offscreenHeight_ = 0;
+	ReadbackCallback readbackCallback_;
+	std::unique_ptr<IResource> offscreenTarget_;
+	std::unique_ptr<FrameReadback> frameReadback_;
+
+	std::unique_ptr<RootSignatureCache> rootSignatures_;
+	RootSignatureLayout rootSignatureLayout_;
+	// Owned by rootSignatures_
+	IRootSignature* rootSignature_ = nullptr;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> vertexBuffer_;
-	D3D12_VERTEX_BUFFER_VIEW vertexBufferView_;
+	// Pipeline states are created in the background and owned by
+	// pipelineStates_, which is destroyed first as its tasks use the caches
+	std::string shaderCachePath_;
+	bool useShaderArchive_ = true;
+	std::unique_ptr<IShaderCompiler> shaderCompiler_;
+	std::unique_ptr<ShaderCache> shaderCache_;
+	std::string pipelineCachePath_;
+	std::unique_ptr<PipelineCache> pipelineCache_;
+	std::unique_ptr<PipelineStateManager> pipelineStates_;
+	PipelineStateHandle pso_;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> indexBuffer_;
-	D3D12_INDEX_BUFFER_VIEW indexBufferView_;
+	std::string meshPath_;
+	VertexFormat vertexFormat_;
+	int meshIndexCount_ = 0;
+	BoundingBox meshBounds_;
+	// Decode constants for the quantized vertices, written once
+	std::unique_ptr<IResource> meshConstantBuffer_;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer_;
+	std::unique_ptr<IResource> vertexBuffer_;
+	VertexBufferView vertexBufferView_;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> constantBuffers_ [QUEUE_SLOT_COUNT];
+	std::unique_ptr<IResource> indexBuffer_;
+	IndexBufferView indexBufferView_;
 
-	Microsoft::WRL::ComPtr<ID3D12Resource> image_;
-	Microsoft::WRL::ComPtr<ID3D12Resource> uploadImage_;
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>    srvDescriptorHeap_;
+	std::unique_ptr<IResource> uploadBuffer_;
 
-	Microsoft::WRL::ComPtr<ID3D12Fence> uploadFence_;
+	// Only used if the per-frame constants don't fit into the root
+	// signature, otherwise they are recorded into the command list
+	std::vector<std::unique_ptr<IResource>> constantBuffers_;
+	std::vector<std::uint32_t> perFrameRootConstants_;
+
+	TexturePackingOptions texturePacking_;
+	std::unique_ptr<IResource> image_;
+	std::unique_ptr<IResource> uploadImage_;
+	std::unique_ptr<IDescriptorHeap> srvDescriptorHeap_;
 
 	std::vector<std::uint8_t> imageData_;
-	std::int32_t renderTargetViewDescriptorSize_;
+
+	struct DrawCommand
+	{
+		BoundingBox bounds;
+		int indexCount;
+		int startIndex;
+		int baseVertex;
+
+		IRootSignature* rootSignature;
+		IPipelineState* pipelineState;
+		GpuDescriptorHandle material;
+		std::uint64_t sortKey;
+	};
+
+	float currentScale_ = 0;
+
+	std::unique_ptr<OcclusionBuffer> occlusionBuffer_;
+	std::vector<DrawCommand> drawCandidates_;
+	std::vector<BoundingBox> drawCandidateBounds_;
+	std::vector<std::uint8_t> drawCandidateVisible_;
+	std::vector<DrawCommand> drawList_;
+	std::unique_ptr<DrawQueue> drawQueue_;
+	DrawStateIds drawStateIds_;
+
+	bool useBundles_ = true;
+	std::unique_ptr<BundleCache> bundles_;
 };
 }
 
@@ -0,0 +1,61 @@
+#ifndef ANTERU_D3D12_SAMPLE_DEFLATE_H_
+#define ANTERU_D3D12_SAMPLE_DEFLATE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace anteru {
+class ThreadPool;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Decompress a zlib stream (RFC 1950) containing deflate data (RFC 1951).
+The Adler-32 checksum at the end of the stream is verified. Throws
+std::runtime_error if the stream is malformed or truncated.
+
+expectedSize is only used to reserve the output.
+*/
+std::vector<std::uint8_t> ZlibDecompress (const void* data, const std::size_t size,
+	const std::size_t expectedSize = 0);
+
+/**
+Compress data into a zlib stream. The input is split into chunks which
+are compressed in parallel on threadPool, if provided. Each chunk may
+reference the 32 KiB before it, so the ratio is close to compressing
+everything in one go.
+*/
+std::vector<std::uint8_t> ZlibCompress (const void* data, const std::size_t size,
+	ThreadPool* threadPool = nullptr);
+
+/**
+Append the deflate blocks for size bytes at data to output. Matches may
+reference the dictionarySize bytes before data, which must be readable;
+at most 32 KiB of them are used.
+
+If final is false, the output ends with an empty stored block, which
+aligns it to a byte boundary, so the compressed data of the following
+bytes can be appended directly.
+*/
+void Deflate (const std::uint8_t* data, const std::size_t size,
+	const std::size_t dictionarySize, const bool final,
+	std::vector<std::uint8_t>& output);
+
+std::uint32_t Adler32 (const void* data, const std::size_t size,
+	const std::uint32_t adler = 1);
+
+/**
+Checksum of the concatenation of two blocks, given the checksums of both
+and the size of the second one.
+*/
+std::uint32_t Adler32Combine (const std::uint32_t adler1,
+	const std::uint32_t adler2, const std::size_t size2);
+
+/**
+The CRC-32 used by PNG, zip and gzip.
+*/
+std::uint32_t Crc32 (const void* data, const std::size_t size,
+	const std::uint32_t crc = 0);
+}
+
+#endif
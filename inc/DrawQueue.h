@@ -0,0 +1,186 @@
+#ifndef ANTERU_D3D12_SAMPLE_DRAWQUEUE_H_
+#define ANTERU_D3D12_SAMPLE_DRAWQUEUE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace anteru {
+class ThreadPool;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+64-bit draw sort key. Fields are ordered by the cost of changing them, so
+sorting by key groups draws with the same expensive state together. From
+most to least significant bit:
+
+- layer (4 bits): render pass ordering, e.g. opaque before translucent
+- root signature (6 bits): a change invalidates all root bindings
+- pipeline state (10 bits)
+- material (20 bits): descriptor tables and per-material data
+- depth (24 bits): quantized z/w, front-to-back or back-to-front
+*/
+struct DrawKey
+{
+	static const int LAYER_BITS = 4;
+	static const int ROOT_SIGNATURE_BITS = 6;
+	static const int PIPELINE_STATE_BITS = 10;
+	static const int MATERIAL_BITS = 20;
+	static const int DEPTH_BITS = 24;
+
+	static const int DEPTH_SHIFT = 0;
+	static const int MATERIAL_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+	static const int PIPELINE_STATE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+	static const int ROOT_SIGNATURE_SHIFT = PIPELINE_STATE_SHIFT + PIPELINE_STATE_BITS;
+	static const int LAYER_SHIFT = ROOT_SIGNATURE_SHIFT + ROOT_SIGNATURE_BITS;
+
+	static_assert (LAYER_SHIFT + LAYER_BITS == 64,
+		"Draw key fields must fill exactly 64 bits");
+
+	enum class DepthOrder
+	{
+		FrontToBack,
+		BackToFront
+	};
+
+	/**
+	Pack the fields into a key. Identifiers which do not fit into their
+	field are truncated, see DrawStateIds. depth is expected in [0,1] and
+	clamped, NaN is treated as 0.
+	*/
+	static std::uint64_t Pack (const int layer, const int rootSignature,
+		const int pipelineState, const int material, const float depth,
+		const DepthOrder depthOrder = DepthOrder::FrontToBack);
+
+	static int GetLayer (const std::uint64_t key)
+	{
+		return GetField (key, LAYER_SHIFT, LAYER_BITS);
+	}
+
+	static int GetRootSignature (const std::uint64_t key)
+	{
+		return GetField (key, ROOT_SIGNATURE_SHIFT, ROOT_SIGNATURE_BITS);
+	}
+
+	static int GetPipelineState (const std::uint64_t key)
+	{
+		return GetField (key, PIPELINE_STATE_SHIFT, PIPELINE_STATE_BITS);
+	}
+
+	static int GetMaterial (const std::uint64_t key)
+	{
+		return GetField (key, MATERIAL_SHIFT, MATERIAL_BITS);
+	}
+
+private:
+	static int GetField (const std::uint64_t key, const int shift, const int bits)
+	{
+		return static_cast<int> ((key >> shift) & ((1ull << bits) - 1));
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Assigns identifiers for the state fields of DrawKey to the objects used in
+a frame, densely and in the order they are first seen. DrawQueue::Submit
+only compares identifiers, so two objects must never share one. Instead of
+truncating, the Get functions throw once a field runs out of identifiers.
+
+Objects are identified by their address, so the identifiers must be
+cleared whenever an object may have been replaced, for instance once per
+frame.
+*/
+class DrawStateIds final
+{
+public:
+	void Clear ();
+
+	int GetRootSignature (const void* rootSignature);
+	int GetPipelineState (const void* pipelineState);
+	int GetMaterial (const std::uint64_t material);
+
+private:
+	static int GetId (std::unordered_map<std::uint64_t, int>& ids,
+		const std::uint64_t object, const int bits);
+
+	std::unordered_map<std::uint64_t, int> rootSignatures_;
+	std::unordered_map<std::uint64_t, int> pipelineStates_;
+	std::unordered_map<std::uint64_t, int> materials_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Stable LSD radix sort of 64-bit keys with an attached 32-bit value, one
+byte per pass. Passes in which all keys share the same byte are skipped,
+so keys which only use a few distinct fields sort in fewer passes. Short
+inputs are insertion sorted instead.
+
+The scratch arrays must hold count elements each. The sorted result is
+always returned in keys/values. If a thread pool is provided, histogram
+and scatter are split into independent blocks.
+*/
+void RadixSort (std::uint64_t* keys, std::uint32_t* values,
+	std::uint64_t* scratchKeys, std::uint32_t* scratchValues,
+	const std::size_t count, ThreadPool* threadPool = nullptr);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Collects draws with their sort keys for a frame, sorts them and hands them
+back in key order, telling the caller which state has to be set again.
+*/
+class DrawQueue final
+{
+public:
+	explicit DrawQueue (ThreadPool* threadPool = nullptr);
+
+	struct StateChanges
+	{
+		bool rootSignature;
+		bool pipelineState;
+		bool material;
+	};
+
+	void Clear ();
+
+	/**
+	Queue a draw. drawIndex is opaque to the queue and identifies the draw
+	in the caller's storage.
+	*/
+	void Add (const std::uint64_t key, const std::uint32_t drawIndex);
+
+	void Sort ();
+
+	/**
+	Call submit (drawIndex, changes) for each draw in key order. The first
+	draw always reports all state as changed.
+	*/
+	void Submit (const std::function<void (std::uint32_t, const StateChanges&)>& submit) const;
+
+	std::size_t GetSize () const
+	{
+		return keys_.size ();
+	}
+
+	/**
+	Number of state changes issued by the last Submit call.
+	*/
+	int GetStateChangeCount () const
+	{
+		return stateChangeCount_;
+	}
+
+private:
+	std::vector<std::uint64_t> keys_;
+	std::vector<std::uint32_t> drawIndices_;
+	std::vector<std::uint64_t> scratchKeys_;
+	std::vector<std::uint32_t> scratchDrawIndices_;
+
+	mutable int stateChangeCount_ = 0;
+
+	ThreadPool* threadPool_;
+};
+}
+
+#endif
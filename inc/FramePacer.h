@@ -0,0 +1,169 @@
+#ifndef ANTERU_D3D12_SAMPLE_FRAMEPACER_H_
+#define ANTERU_D3D12_SAMPLE_FRAMEPACER_H_
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Time source used by the frame pacer. All times are in seconds.
+*/
+class IClock
+{
+public:
+	IClock () = default;
+	IClock (const IClock&) = delete;
+	IClock& operator= (const IClock&) = delete;
+
+	virtual ~IClock ();
+
+	virtual double Now () = 0;
+	virtual void SleepUntil (const double time) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Monotonic wall clock. SleepUntil sleeps coarsely and spins for the last
+part, as OS sleep granularity is often around a millisecond.
+*/
+class SystemClock final : public IClock
+{
+public:
+	SystemClock ();
+
+	double Now () override;
+	void SleepUntil (const double time) override;
+
+private:
+	std::int64_t start_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Clock which only moves when told to. SleepUntil jumps forward in time, so
+a pacer driven by this clock runs deterministically.
+*/
+class SimulatedClock final : public IClock
+{
+public:
+	double Now () override
+	{
+		return now_;
+	}
+
+	void SleepUntil (const double time) override;
+
+	void Advance (const double seconds)
+	{
+		now_ += seconds;
+	}
+
+private:
+	double now_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class FramePacingMode
+{
+	// Start CPU work as soon as the frame slot is available
+	Disabled,
+	// Keep the time from starting CPU work to GPU completion at or below
+	// the target, as far as the GPU throughput allows. A target of zero
+	// starts every frame just in time for the GPU.
+	TargetLatency,
+	// Start frames at a fixed interval, but never earlier than needed to
+	// keep the GPU busy
+	TargetFrameRate
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Decides when the CPU should start working on the next frame.
+
+The pacer keeps a short history of CPU and GPU frame durations and
+predicts when the GPU will have finished all queued work. CPU work is
+then delayed so the new frame is submitted just before the GPU runs dry,
+which keeps input sampling as close to display as possible without
+starving the GPU.
+
+The pacer does not talk to the GPU. The caller reports submissions and
+completions using fence values, so it can be driven by a real queue or
+by a simulation.
+*/
+class FramePacer final
+{
+public:
+	/**
+	target is the latency in seconds for TargetLatency, and the frame
+	interval in seconds for TargetFrameRate.
+	*/
+	FramePacer (IClock& clock, const FramePacingMode mode,
+		const double target, const int historyLength = 16);
+
+	/**
+	Sleep until the predicted best start time for the next frame, and
+	return the time at which the frame starts.
+	*/
+	double WaitForFrameStart ();
+
+	/**
+	The time WaitForFrameStart would sleep until.
+	*/
+	double GetPredictedFrameStart ();
+
+	/**
+	Called once the CPU work for the frame has been submitted to the GPU.
+	The frame is complete once the GPU reaches fenceValue.
+	*/
+	void OnFrameSubmitted (const std::uint64_t fenceValue);
+
+	/**
+	Report the currently completed fence value. All frames up to this
+	value are considered complete at the current time, so this should be
+	called as often as the value is queried anyway.
+	*/
+	void OnFenceCompleted (const std::uint64_t completedValue);
+
+	double GetPredictedCpuTime () const;
+	double GetPredictedGpuTime () const;
+
+	/**
+	Extra time reserved between the predicted end of CPU work and the
+	predicted start of GPU work, to absorb prediction errors.
+	*/
+	void SetSafetyMargin (const double seconds)
+	{
+		safetyMargin_ = seconds;
+	}
+
+private:
+	struct PendingFrame
+	{
+		std::uint64_t fenceValue;
+		double submitTime;
+	};
+
+	double PredictGpuIdleTime (const double now) const;
+	static double Predict (const std::vector<double>& history);
+	void AddSample (std::vector<double>& history, int& next, const double value);
+
+	IClock& clock_;
+	FramePacingMode mode_;
+	double target_;
+	double safetyMargin_ = 0.0005;
+
+	int historyLength_;
+	std::vector<double> cpuTimes_, gpuTimes_;
+	int nextCpuTime_ = 0, nextGpuTime_ = 0;
+
+	std::deque<PendingFrame> pendingFrames_;
+	double lastCompletionTime_ = 0;
+
+	double frameStart_ = 0;
+	double scheduledStart_ = -1;
+};
+}
+
+#endif
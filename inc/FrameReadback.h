@@ -0,0 +1,101 @@
+#ifndef ANTERU_D3D12_SAMPLE_FRAMEREADBACK_H_
+#define ANTERU_D3D12_SAMPLE_FRAMEREADBACK_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+A rendered frame in host memory. data is only valid during the callback.
+*/
+struct ReadbackFrame
+{
+	std::uint64_t frameIndex;
+	int width;
+	int height;
+	int rowPitch;
+	PixelFormat format;
+	const std::uint8_t* data;
+};
+
+typedef std::function<void (const ReadbackFrame&)> ReadbackCallback;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Ring of readback buffers which gets rendered frames back to the CPU
+without stalling.
+
+Each frame is copied into the next buffer of the ring and handed out once
+the fence value signaled after the copy is reached, which is usually a few
+frames later. The CPU only has to wait if all buffers are still in use,
+which never happens with at least as many buffers as frames in flight.
+Buffers stay mapped for their whole lifetime.
+*/
+class FrameReadback final
+{
+public:
+	FrameReadback (IRenderDevice& device, const int width, const int height,
+		const PixelFormat format, const int bufferCount);
+	~FrameReadback ();
+
+	FrameReadback (const FrameReadback&) = delete;
+	FrameReadback& operator= (const FrameReadback&) = delete;
+
+	/**
+	Fence value which must be reached before Copy can reuse the next
+	buffer. 0 if the next buffer is free.
+	*/
+	std::uint64_t GetWaitValue () const;
+
+	/**
+	Record a copy of source into the next buffer. source must be in the
+	CopySource state and match the size and format of the ring. fenceValue
+	is the value which gets signaled once the command list has executed.
+
+	Throws if the next buffer has not been delivered yet.
+	*/
+	void Copy (ICommandList* commandList, IResource* source,
+		const std::uint64_t frameIndex, const std::uint64_t fenceValue);
+
+	/**
+	Call callback for all frames whose copy is complete at completedValue,
+	oldest first. Returns the number of delivered frames.
+	*/
+	int Deliver (const std::uint64_t completedValue,
+		const ReadbackCallback& callback);
+
+	/**
+	Number of frames which have been copied, but not delivered yet.
+	*/
+	int GetPendingCount () const
+	{
+		return pendingCount_;
+	}
+
+private:
+	struct Buffer
+	{
+		std::unique_ptr<IResource> resource;
+		const std::uint8_t* data;
+		std::uint64_t frameIndex;
+		std::uint64_t fenceValue;
+	};
+
+	std::vector<Buffer> buffers_;
+	int width_;
+	int height_;
+	int rowPitch_;
+	PixelFormat format_;
+
+	// The pending buffers are oldest_, oldest_ + 1, ... in ring order
+	int oldest_ = 0;
+	int pendingCount_ = 0;
+};
+}
+
+#endif
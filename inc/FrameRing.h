@@ -0,0 +1,80 @@
+#ifndef ANTERU_D3D12_SAMPLE_FRAMERING_H_
+#define ANTERU_D3D12_SAMPLE_FRAMERING_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Book-keeping for per-frame resources which are reused in a ring.
+
+Each frame in flight owns one slot. When a frame has been submitted, the
+fence value signaled after it is stored with its slot, and before the slot
+is recorded into again, that value has to be waited for. The ring does not
+know anything about the GPU, so it can be driven by any queue which hands
+out increasing fence values.
+*/
+class FrameRing final
+{
+public:
+	explicit FrameRing (const int framesInFlight);
+
+	int GetFramesInFlight () const
+	{
+		return static_cast<int> (slotFenceValues_.size ());
+	}
+
+	/**
+	Number of frames which have been finished with EndFrame so far.
+	*/
+	std::uint64_t GetFrameIndex () const
+	{
+		return frameIndex_;
+	}
+
+	/**
+	Slot of the frame which is currently being recorded.
+	*/
+	int GetCurrentSlot () const
+	{
+		return static_cast<int> (frameIndex_ % slotFenceValues_.size ());
+	}
+
+	/**
+	Fence value which must be complete before the current slot may be
+	reused. 0 if the slot has never been submitted.
+	*/
+	std::uint64_t GetWaitValue () const
+	{
+		return slotFenceValues_ [GetCurrentSlot ()];
+	}
+
+	std::uint64_t GetSlotFenceValue (const int slot) const
+	{
+		return slotFenceValues_ [slot];
+	}
+
+	/**
+	Fence value which must be complete for all submitted frames to be done.
+	*/
+	std::uint64_t GetLastSubmittedValue () const
+	{
+		return lastSubmittedValue_;
+	}
+
+	/**
+	Record that the current frame was submitted and will be complete once
+	fenceValue is reached, then advance to the next slot. Fence values must
+	be increasing.
+	*/
+	void EndFrame (const std::uint64_t fenceValue);
+
+private:
+	std::vector<std::uint64_t> slotFenceValues_;
+	std::uint64_t frameIndex_ = 0;
+	std::uint64_t lastSubmittedValue_ = 0;
+};
+}
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef ANTERU_D3D12_SAMPLE_FRAMETIMER_H_
+#define ANTERU_D3D12_SAMPLE_FRAMETIMER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "Trace.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Histogram of durations in nanoseconds with logarithmic buckets, each
+power of two being split into 32 linear sub-buckets. This keeps the
+relative error of percentiles at around 3% over the whole range, while
+recording is a couple of bit operations and an increment.
+*/
+class LatencyHistogram final
+{
+public:
+	LatencyHistogram ();
+
+	void Record (const std::uint64_t value);
+	void Add (const LatencyHistogram& other);
+	void Clear ();
+
+	/**
+	Value below which the given fraction (in [0,1]) of all samples lies.
+	*/
+	std::uint64_t GetPercentile (const double fraction) const;
+
+	std::uint64_t GetCount () const
+	{
+		return count_;
+	}
+
+	std::uint64_t GetMax () const
+	{
+		return max_;
+	}
+
+	std::uint64_t GetTotal () const
+	{
+		return total_;
+	}
+
+private:
+	std::vector<std::uint32_t> buckets_;
+	std::uint64_t count_ = 0;
+	std::uint64_t total_ = 0;
+	std::uint64_t max_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class FramePhase
+{
+	WaitForFence,
+	Readback,
+	FramePacing,
+	PrepareRender,
+	UpdateConstantBuffer,
+	RecordCommands,
+	ExecuteCommandLists,
+	Present,
+	Count
+};
+
+const char* GetFramePhaseName (const FramePhase phase);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Collects how much CPU time each phase of a frame takes.
+
+Time spent in a phase is summed up over the frame, and on EndFrame the
+per-frame sums are recorded into one histogram per phase. There is an
+all-time histogram, and a rolling one which covers the most recent frames
+in a few windows that are recycled in turn.
+*/
+class FrameTimer final
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	explicit FrameTimer (const int framesPerWindow = 256, const int windowCount = 4);
+
+	static std::int64_t GetTicks ()
+	{
+		return Clock::now ().time_since_epoch ().count ();
+	}
+
+	static std::int64_t TicksToNanoseconds (const std::int64_t ticks)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds> (
+			Clock::duration (ticks)).count ();
+	}
+
+	void AddPhaseTime (const FramePhase phase, const std::int64_t ticks)
+	{
+		currentFrame_ [static_cast<int> (phase)] += ticks;
+	}
+
+	void EndFrame ();
+
+	/**
+	Write p50/p95/p99/max per phase and the time spent waiting for the
+	fence. If rolling is set, only the recent windows are reported,
+	otherwise everything since the start.
+	*/
+	void WriteReport (std::ostream& output, const bool rolling) const;
+
+	std::uint64_t GetFrameCount () const
+	{
+		return frameCount_;
+	}
+
+private:
+	static const int PHASE_COUNT = static_cast<int> (FramePhase::Count);
+
+	struct PhaseHistograms
+	{
+		LatencyHistogram total;
+		std::vector<LatencyHistogram> windows;
+	};
+
+	// One entry per phase, plus one for the whole frame
+	std::vector<PhaseHistograms> histograms_;
+	std::int64_t currentFrame_ [PHASE_COUNT];
+
+	int framesPerWindow_;
+	int currentWindow_ = 0;
+	int framesInCurrentWindow_ = 0;
+	std::uint64_t frameCount_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Adds the time from construction to destruction to a phase. The phase also
+shows up as a scope in the trace if tracing is enabled, with the same
+timestamps, so the clock is only read twice either way.
+*/
+class ScopedPhaseTimer final
+{
+public:
+	ScopedPhaseTimer (FrameTimer& timer, const FramePhase phase)
+		: timer_ (timer)
+		, phase_ (phase)
+		, start_ (FrameTimer::GetTicks ())
+	{
+		if (Tracer::IsEnabled ()) {
+			Tracer::RecordAt (FrameTimer::TicksToNanoseconds (start_),
+				TraceEventType::Begin, GetFramePhaseName (phase));
+		}
+	}
+
+	~ScopedPhaseTimer ()
+	{
+		const auto end = FrameTimer::GetTicks ();
+		timer_.AddPhaseTime (phase_, end - start_);
+		if (Tracer::IsEnabled ()) {
+			Tracer::RecordAt (FrameTimer::TicksToNanoseconds (end),
+				TraceEventType::End, GetFramePhaseName (phase_));
+		}
+	}
+
+	ScopedPhaseTimer (const ScopedPhaseTimer&) = delete;
+	ScopedPhaseTimer& operator= (const ScopedPhaseTimer&) = delete;
+
+private:
+	FrameTimer& timer_;
+	FramePhase phase_;
+	std::int64_t start_;
+};
+}
+
+#endif
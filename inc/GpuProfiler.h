@@ -0,0 +1,220 @@
+#ifndef ANTERU_D3D12_SAMPLE_GPUPROFILER_H_
+#define ANTERU_D3D12_SAMPLE_GPUPROFILER_H_
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "FrameTimer.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Writes GPU timestamps into query storage and resolves them into host
+visible memory. The queries are split into one range per frame in flight
+(a slot), so a frame can write its queries while the results of earlier
+frames are still being read.
+*/
+class IGpuTimestampBackend
+{
+public:
+	virtual ~IGpuTimestampBackend ();
+
+	/**
+	Write the GPU time at which all previously recorded work has finished
+	into query index of slot.
+	*/
+	virtual void WriteTimestamp (const int slot, const int query) = 0;
+
+	/**
+	Copy the first queryCount timestamps of slot into the readback memory.
+	*/
+	virtual void Resolve (const int slot, const int queryCount) = 0;
+
+	/**
+	Readback memory of slot. The contents are only valid once the GPU has
+	finished the frame which resolved them.
+	*/
+	virtual const std::uint64_t* GetResolvedTimestamps (const int slot) const = 0;
+
+	/**
+	Timestamp ticks per second.
+	*/
+	virtual std::uint64_t GetFrequency () const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Timestamp backend without a GPU. Every timestamp advances a synthetic clock
+by a fixed number of ticks, and resolving copies the values immediately.
+*/
+class NullTimestampBackend final : public IGpuTimestampBackend
+{
+public:
+	NullTimestampBackend (const int slotCount, const int queriesPerSlot,
+		const std::uint64_t frequency = 1000000000,
+		const std::uint64_t ticksPerTimestamp = 1000);
+
+	void WriteTimestamp (const int slot, const int query) override;
+	void Resolve (const int slot, const int queryCount) override;
+	const std::uint64_t* GetResolvedTimestamps (const int slot) const override;
+	std::uint64_t GetFrequency () const override;
+
+	void SetTicksPerTimestamp (const std::uint64_t ticks)
+	{
+		ticksPerTimestamp_ = ticks;
+	}
+
+private:
+	int queriesPerSlot_;
+	std::uint64_t frequency_;
+	std::uint64_t ticksPerTimestamp_;
+	std::uint64_t currentTime_ = 0;
+
+	std::vector<std::uint64_t> queries_;
+	std::vector<std::uint64_t> readback_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct GpuTiming
+{
+	const char* name;
+	// Nesting level, 0 for scopes which are not inside another scope
+	int depth;
+	double milliseconds;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Measures GPU time of nested scopes.
+
+Each scope writes a timestamp at its begin and end. At the end of a frame
+the timestamps are resolved into readback memory, and read when the slot
+is used again, that is, once per frame-in-flight count frames later. At
+that point the CPU has already waited for the frame on the GPU, so reading
+the results never stalls.
+
+Scope names must be string literals or otherwise outlive the profiler.
+*/
+class GpuProfiler final
+{
+public:
+	GpuProfiler (IGpuTimestampBackend& backend, const int slotCount,
+		const int maxScopesPerFrame);
+
+	GpuProfiler (const GpuProfiler&) = delete;
+	GpuProfiler& operator= (const GpuProfiler&) = delete;
+
+	/**
+	Two queries per scope.
+	*/
+	static int GetQueryCount (const int maxScopesPerFrame)
+	{
+		return maxScopesPerFrame * 2;
+	}
+
+	/**
+	Start recording timestamps for a frame into slot. The GPU must have
+	finished the previous frame which used slot, its timings are read back
+	here.
+	*/
+	void BeginFrame (const int slot, const std::uint64_t frameIndex);
+
+	/**
+	Returns -1 if the frame has no more queries left, in which case the
+	scope is not measured.
+	*/
+	int BeginScope (const char* name);
+	void EndScope (const int scope);
+
+	/**
+	End all open scopes and resolve the timestamps of the frame.
+	*/
+	void EndFrame ();
+
+	/**
+	Timings of the most recently read back frame, in the order the scopes
+	were opened.
+	*/
+	const std::vector<GpuTiming>& GetTimings () const
+	{
+		return timings_;
+	}
+
+	/**
+	Frame index of the timings returned by GetTimings, or UINT64_MAX if no
+	frame was read back yet.
+	*/
+	std::uint64_t GetTimingsFrameIndex () const
+	{
+		return timingsFrameIndex_;
+	}
+
+	/**
+	Write mean/p50/p95/p99/max for every scope name over all frames read
+	back so far.
+	*/
+	void WriteReport (std::ostream& output) const;
+
+private:
+	struct Scope
+	{
+		const char* name;
+		int depth;
+		bool open;
+	};
+
+	struct Slot
+	{
+		std::vector<Scope> scopes;
+		std::uint64_t frameIndex = 0;
+		bool pending = false;
+	};
+
+	struct ScopeHistogram
+	{
+		const char* name;
+		int depth;
+		LatencyHistogram histogram;
+	};
+
+	void ReadBack (Slot& slot, const int slotIndex);
+
+	IGpuTimestampBackend& backend_;
+	int maxScopesPerFrame_;
+
+	std::vector<Slot> slots_;
+	int currentSlot_ = -1;
+	int currentDepth_ = 0;
+
+	std::vector<GpuTiming> timings_;
+	std::uint64_t timingsFrameIndex_ = UINT64_MAX;
+
+	std::vector<ScopeHistogram> histograms_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class ScopedGpuMarker final
+{
+public:
+	ScopedGpuMarker (GpuProfiler& profiler, const char* name)
+		: profiler_ (profiler)
+		, scope_ (profiler.BeginScope (name))
+	{
+	}
+
+	~ScopedGpuMarker ()
+	{
+		profiler_.EndScope (scope_);
+	}
+
+	ScopedGpuMarker (const ScopedGpuMarker&) = delete;
+	ScopedGpuMarker& operator= (const ScopedGpuMarker&) = delete;
+
+private:
+	GpuProfiler& profiler_;
+	int scope_;
+};
+}
+
+#endif
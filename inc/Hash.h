@@ -0,0 +1,66 @@
+#ifndef ANTERU_D3D12_SAMPLE_HASH_H_
+#define ANTERU_D3D12_SAMPLE_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+128-bit hash, wide enough to use as the identity of the hashed content
+without storing the content itself.
+*/
+struct Hash128
+{
+	std::uint64_t low;
+	std::uint64_t high;
+};
+
+inline bool operator== (const Hash128& a, const Hash128& b)
+{
+	return a.low == b.low && a.high == b.high;
+}
+
+inline bool operator!= (const Hash128& a, const Hash128& b)
+{
+	return ! (a == b);
+}
+
+inline bool operator< (const Hash128& a, const Hash128& b)
+{
+	return a.high < b.high || (a.high == b.high && a.low < b.low);
+}
+
+/**
+MurmurHash3 x64 128-bit variant. Not cryptographic, so it must not be used
+where an attacker controls the input.
+*/
+Hash128 ComputeHash128 (const void* data, const std::size_t size,
+	const std::uint64_t seed = 0);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Collects the parts of a key into one buffer which is then hashed as a
+whole. Strings and blobs are prefixed with their size, so ("ab", "c")
+and ("a", "bc") produce different keys.
+*/
+class HashBuilder final
+{
+public:
+	HashBuilder& Add (const void* data, const std::size_t size);
+	HashBuilder& Add (const char* text);
+	HashBuilder& Add (const std::string& text);
+	HashBuilder& Add (const std::uint64_t value);
+
+	Hash128 Get () const
+	{
+		return ComputeHash128 (buffer_.data (), buffer_.size ());
+	}
+
+private:
+	std::string buffer_;
+};
+}
+
+#endif
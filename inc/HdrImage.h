@@ -0,0 +1,43 @@
+#ifndef ANTERU_D3D12_SAMPLE_HDRIMAGE_H_
+#define ANTERU_D3D12_SAMPLE_HDRIMAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Texels of an HDR image, with rows starting every rowPitch bytes. The pitch
+is a multiple of TEXTURE_DATA_PITCH_ALIGNMENT, so data can be copied into
+an upload buffer and onto a texture of the same format in one go.
+*/
+struct HdrImage
+{
+	std::vector<std::uint8_t> data;
+	int width;
+	int height;
+	int rowPitch;
+	PixelFormat format;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Load a Radiance RGBE (.hdr) or OpenEXR image, detected by its magic bytes,
+and convert it to format, which must be R16G16B16A16_Float,
+R11G11B10_Float or R9G9B9E5_SharedExp. The last two drop alpha.
+
+For OpenEXR, single-part scanline images which are uncompressed or use
+ZIPS, ZIP or PIZ compression are supported. The R, G, B and A channels are
+read, missing color channels are 0 and missing alpha is 1.
+*/
+HdrImage LoadHdrImageFromMemory (const void* data, const std::size_t size,
+	const PixelFormat format);
+
+///////////////////////////////////////////////////////////////////////////////
+HdrImage LoadHdrImageFromFile (const char* path, const PixelFormat format);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef ANTERU_D3D12_SAMPLE_IMAGEENCODER_H_
+#define ANTERU_D3D12_SAMPLE_IMAGEENCODER_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace anteru {
+class ThreadPool;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Encode 8-bit RGBA pixels as PNG. Rows start every rowPitch bytes, so
+frames can be encoded straight from a readback buffer.
+
+Each row uses the filter with the smallest sum of absolute differences.
+Filtering and compression run in parallel on threadPool, if provided.
+*/
+std::vector<std::uint8_t> EncodePng (const void* pixels, const int width,
+	const int height, const int rowPitch, ThreadPool* threadPool = nullptr);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Encode 8-bit RGBA pixels in the QOI format. This is lossless like PNG, but
+a single pass over the pixels without entropy coding, so it is many times
+faster at a somewhat larger size.
+*/
+std::vector<std::uint8_t> EncodeQoi (const void* pixels, const int width,
+	const int height, const int rowPitch);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Store 8-bit RGBA pixels in the raw container described in ImageIO.h. The
+rows are copied as-is, including the padding up to rowPitch.
+*/
+std::vector<std::uint8_t> EncodeRaw (const void* pixels, const int width,
+	const int height, const int rowPitch);
+}
+
+#endif
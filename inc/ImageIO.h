@@ -8,6 +8,20 @@
 #undef LoadImage
 #endif
 
+/**
+Magic bytes of the raw image container. The header is 16 bytes: the magic,
+followed by width, height and row pitch in bytes, all as little-endian
+32-bit integers. The RGBA8 rows follow, with rows starting every row pitch
+bytes, so a readback footprint can be stored as-is. Loading is a copy.
+*/
+const char RAW_IMAGE_MAGIC [4] = { 'R', 'G', 'B', 'A' };
+
+/**
+Load an image as RGBA8, with rows padded to rowAlignment pixels. QOI and
+raw images are recognized by their magic bytes and decoded directly, which
+is several times faster than PNG. Everything else goes through WIC
+on Windows, and the PNG decoder elsewhere.
+*/
 std::vector<std::uint8_t> LoadImageFromFile (const char* path, const int rowAlignment,
 	int* width, int* height);
 
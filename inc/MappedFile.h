@@ -0,0 +1,64 @@
+#ifndef ANTERU_D3D12_SAMPLE_MAPPEDFILE_H_
+#define ANTERU_D3D12_SAMPLE_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Read-only memory mapping of a whole file. Pages are only read from disk
+once they are touched, so looking up a few entries in a large file is
+cheap.
+
+A file which does not exist, is empty or cannot be mapped results in a
+closed mapping rather than an error, as callers treat all of these as a
+missing file.
+*/
+class MappedFile final
+{
+public:
+	explicit MappedFile (const char* path);
+	~MappedFile ();
+
+	MappedFile (const MappedFile&) = delete;
+	MappedFile& operator= (const MappedFile&) = delete;
+
+	bool IsOpen () const
+	{
+		return data_ != nullptr;
+	}
+
+	const std::uint8_t* GetData () const
+	{
+		return data_;
+	}
+
+	std::size_t GetSize () const
+	{
+		return size_;
+	}
+
+private:
+	const std::uint8_t* data_ = nullptr;
+	std::size_t size_ = 0;
+
+#ifdef _WIN32
+	void* file_ = nullptr;
+	void* mapping_ = nullptr;
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Replace the contents of path with data, such that other processes either
+see the old or the new file, but never a partially written one. The data
+is written into a temporary file next to path, flushed to disk and then
+renamed over path.
+
+Returns false if any step fails, in which case path is unchanged.
+*/
+bool WriteFileAtomic (const char* path, const void* data, const std::size_t size);
+}
+
+#endif
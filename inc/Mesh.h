@@ -0,0 +1,78 @@
+#ifndef ANTERU_D3D12_SAMPLE_MESH_H_
+#define ANTERU_D3D12_SAMPLE_MESH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+struct MeshVertex
+{
+	float position [3];
+	float normal [3];
+	// Origin in the upper left corner, as in D3D
+	float uv [2];
+	// Direction of increasing u. w is 1 or -1, the bitangent is
+	// cross (normal, tangent) * w
+	float tangent [4];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Indexed triangle list.
+*/
+struct Mesh
+{
+	std::vector<MeshVertex> vertices;
+	std::vector<std::uint32_t> indices;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Load a Wavefront OBJ mesh from text. Positions, texture coordinates,
+normals and faces are read, polygons are split into triangle fans, and
+everything else (groups, materials, ...) is ignored.
+
+The vertices are not indexed yet, every face corner gets its own vertex;
+DeduplicateVertices merges them. If the file has no normals, they are
+computed from the faces, weighted by area. Tangents are always computed.
+
+Throws if a face refers to a vertex which does not exist, or if there
+are no faces with at least three vertices.
+*/
+Mesh LoadObj (const char* text, const std::size_t size);
+
+/**
+Load the triangles of all meshes in a binary glTF 2.0 file. Node
+transforms are ignored, so all meshes are in their own space. Attributes
+may be floats or normalized integers. Missing normals and tangents are
+computed as for OBJ, missing texture coordinates are 0.
+
+Throws if the file is not a valid binary glTF file, references external
+buffers, uses primitives other than triangle lists, or contains no
+triangles.
+*/
+Mesh LoadGlb (const void* data, const std::size_t size);
+
+/**
+Load an .obj or .glb file, selected by the extension. Throws if the file
+cannot be read.
+*/
+Mesh LoadMeshFromFile (const char* path);
+
+/**
+Replace the normals with area-weighted face normals, accumulated over all
+vertices which share a position.
+*/
+void ComputeNormals (Mesh& mesh);
+
+/**
+Replace the tangents with ones derived from the texture coordinates,
+accumulated over all vertices which share position, normal and texture
+coordinates, and made orthogonal to the normal.
+*/
+void ComputeTangents (Mesh& mesh);
+}
+
+#endif
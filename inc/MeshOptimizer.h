@@ -0,0 +1,89 @@
+#ifndef ANTERU_D3D12_SAMPLE_MESHOPTIMIZER_H_
+#define ANTERU_D3D12_SAMPLE_MESHOPTIMIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Merge vertices which are identical bit for bit, using a hash table over
+the vertex data, and rewrite the indices to use the remaining ones.
+*/
+void DeduplicateVertices (Mesh& mesh);
+
+/**
+Reorder the triangles so the vertices of consecutive triangles hit the
+post-transform vertex cache, using Tipsify (Sander, Nehab, Barczak, "Fast
+Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007). The
+triangles are emitted as fans around a vertex, and the next fan is picked
+among the vertices just emitted which will still be in a FIFO cache of
+cacheSize entries. Runs in linear time.
+*/
+void OptimizeVertexCache (std::vector<std::uint32_t>& indices,
+	const std::size_t vertexCount, const int cacheSize = 16);
+
+/**
+Reorder clusters of triangles so those facing outwards, which are likely
+to occlude the rest, come first. This reduces overdraw for any view
+direction.
+
+Clusters start where the vertex cache of cacheSize entries misses all
+vertices of a triangle, and are split further as long as the vertex cache
+efficiency stays within threshold of the one of the input, so threshold
+trades cache efficiency for overdraw. Front faces are expected to be
+counter-clockwise, as in OBJ and glTF. Should run after
+OptimizeVertexCache.
+*/
+void OptimizeOverdraw (std::vector<std::uint32_t>& indices,
+	const std::vector<MeshVertex>& vertices, const int cacheSize = 16,
+	const float threshold = 1.05f);
+
+/**
+Reorder the vertices in the order they are first used by the indices, so
+the vertex fetch reads memory sequentially. Unused vertices are removed.
+*/
+void OptimizeVertexFetch (Mesh& mesh);
+
+/**
+Deduplicate, then optimize for the vertex cache, overdraw and vertex
+fetch, in this order.
+*/
+void OptimizeMesh (Mesh& mesh);
+
+///////////////////////////////////////////////////////////////////////////////
+struct VertexCacheStatistics
+{
+	// Average cache miss ratio, vertex shader invocations per triangle.
+	// 3 without any reuse, approaching 0.5 for large regular meshes
+	float acmr;
+	// Average transform to vertex ratio, vertex shader invocations per
+	// vertex. 1 is optimal
+	float atvr;
+};
+
+/**
+Simulate a FIFO vertex cache with cacheSize entries.
+*/
+VertexCacheStatistics AnalyzeVertexCache (const std::vector<std::uint32_t>& indices,
+	const std::size_t vertexCount, const int cacheSize = 16);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+16-bit indices if they can address all vertices, 32-bit otherwise. The
+index 0xFFFF is never used, as it cuts strips on some configurations.
+*/
+IndexFormat SelectIndexFormat (const std::size_t vertexCount);
+
+/**
+Indices stored in format, ready to copy into an index buffer.
+*/
+std::vector<std::uint8_t> PackIndices (const std::vector<std::uint32_t>& indices,
+	const IndexFormat format);
+}
+
+#endif
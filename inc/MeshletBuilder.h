@@ -0,0 +1,140 @@
+#ifndef ANTERU_D3D12_SAMPLE_MESHLETBUILDER_H_
+#define ANTERU_D3D12_SAMPLE_MESHLETBUILDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+#include "RenderDevice.h"
+
+namespace anteru {
+class ThreadPool;
+
+// Limits recommended for mesh shaders, a meshlet fits into a single wave
+// of outputs
+const int MAX_MESHLET_VERTICES = 64;
+const int MAX_MESHLET_TRIANGLES = 124;
+
+///////////////////////////////////////////////////////////////////////////////
+struct Meshlet
+{
+	// Ranges in MeshletData::vertices and MeshletData::triangles, the
+	// latter counted in triangles
+	std::uint32_t vertexOffset;
+	std::uint32_t vertexCount;
+	std::uint32_t triangleOffset;
+	std::uint32_t triangleCount;
+
+	// Bounding sphere of the vertices
+	float center [3];
+	float radius;
+
+	// Normal cone. The meshlet is facing away from a camera at position p
+	// if coneCutoff < 1 and dot (normalize (coneApex - p), coneAxis) >=
+	// coneCutoff. The cutoff is 1 if the triangles face in too many
+	// directions
+	float coneApex [3];
+	float coneAxis [3];
+	float coneCutoff;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	// Indices into the vertex buffer
+	std::vector<std::uint32_t> vertices;
+	// Three indices into the vertices of the meshlet per triangle
+	std::vector<std::uint8_t> triangles;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Split an indexed triangle list into meshlets of at most maxVertices
+vertices and maxTriangles triangles, which must not exceed the limits
+above.
+
+Meshlets are grown greedily from a seed triangle, adding the neighbor
+which needs the fewest new vertices, and among those the one closest to
+the meshlet which faces the same way, so meshlets stay compact and their
+normal cones narrow. If no neighbor is left, the next unused triangle in
+index order continues the meshlet, so the input should be optimized for
+the vertex cache first. The result only depends on the input.
+
+Throws if an index is out of range.
+*/
+MeshletData BuildMeshlets (const std::vector<std::uint32_t>& indices,
+	const std::vector<MeshVertex>& vertices,
+	const int maxVertices = MAX_MESHLET_VERTICES,
+	const int maxTriangles = MAX_MESHLET_TRIANGLES);
+
+/**
+Build the meshlets of several meshes in parallel on threadPool, if
+provided. The result is the same as building them one after the other.
+*/
+std::vector<MeshletData> BuildMeshlets (const std::vector<const Mesh*>& meshes,
+	ThreadPool* threadPool = nullptr,
+	const int maxVertices = MAX_MESHLET_VERTICES,
+	const int maxTriangles = MAX_MESHLET_TRIANGLES);
+
+///////////////////////////////////////////////////////////////////////////////
+// Element of a structured buffer, 16 bytes
+struct GpuMeshlet
+{
+	std::uint32_t vertexOffset;
+	std::uint32_t vertexCount;
+	std::uint32_t triangleOffset;
+	std::uint32_t triangleCount;
+};
+
+// Element of a structured buffer, 24 bytes
+struct GpuMeshletBounds
+{
+	float center [3];
+	float radius;
+	// Cone axis as 8-bit SNorm in the low three bytes, cutoff as 8-bit
+	// UNorm in the high byte, widened to account for the rounding
+	std::uint32_t cone;
+	// The apex is center - axis * apexOffset
+	float apexOffset;
+};
+
+/**
+Meshlets in buffers ready for upload. Vertex indices are 16-bit if they
+can address all vertices, see SelectIndexFormat, and each triangle is
+packed into 32 bits, one byte per index.
+*/
+struct PackedMeshlets
+{
+	std::vector<GpuMeshlet> meshlets;
+	std::vector<GpuMeshletBounds> bounds;
+	IndexFormat vertexIndexFormat;
+	std::vector<std::uint8_t> vertexIndices;
+	std::vector<std::uint32_t> triangles;
+};
+
+PackedMeshlets PackMeshlets (const MeshletData& meshlets, const std::size_t vertexCount);
+
+///////////////////////////////////////////////////////////////////////////////
+struct MeshletStatistics
+{
+	int meshletCount;
+	float averageVertices;
+	float averageTriangles;
+	// Vertices of all meshlets over the vertices they reference. Vertices
+	// shared by several meshlets are transformed once per meshlet
+	float vertexDuplication;
+	// Average half angle of the cones which can cull, in degrees
+	float averageConeAngle;
+	// Meshlets whose cone can cull at all
+	float cullableShare;
+	// Meshlets culled by their cone, averaged over orthographic views from
+	// evenly distributed directions
+	float backfaceCulledShare;
+};
+
+MeshletStatistics AnalyzeMeshlets (const MeshletData& meshlets);
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef ANTERU_D3D12_SAMPLE_NULLDEVICE_H_
+#define ANTERU_D3D12_SAMPLE_NULLDEVICE_H_
+
+#include <memory>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Create a device which does not render anything. Resources live in host
+memory, copies are performed when a command list is executed, and draws
+and clears are dropped. Fences complete on a simulated GPU timeline: each
+executed command list keeps the GPU busy for commandListTime plus drawTime
+per draw (both in microseconds) after the previous work has finished.
+
+With both times at 0, fences complete right away, which measures the pure
+CPU cost of recording and submitting frames.
+*/
+std::unique_ptr<IRenderDevice> CreateNullDevice (
+	const double commandListTime = 0, const double drawTime = 0);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Create a null device which also executes clears and draws with the
+software rasterizer, using C++ versions of the shaders (SoftwareShaders.h).
+Command lists are executed on a separate thread, which renders with its
+own thread pool of threadCount workers, see ThreadPool, and timestamp
+queries measure the actual rendering time. The output does not depend on
+the number of threads.
+*/
+std::unique_ptr<IRenderDevice> CreateSoftwareDevice (const int threadCount = -1);
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef ANTERU_D3D12_SAMPLE_OCCLUSIONCULLING_H_
+#define ANTERU_D3D12_SAMPLE_OCCLUSIONCULLING_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace anteru {
+class ThreadPool;
+
+///////////////////////////////////////////////////////////////////////////////
+struct BoundingBox
+{
+	float min [3];
+	float max [3];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Low-resolution software depth buffer for occlusion culling.
+
+Occluder triangles are transformed into screen space, binned into rows of
+tiles and rasterized in parallel, one tile row per task. Each tile keeps
+the farthest depth stored in it, and a pyramid above the tiles keeps the
+farthest depth of 2x2 blocks of the level below. Bounding box tests start
+at the level where the box covers at most 2x2 entries and only descend
+into the entries which are farther away than the box, so most tests are
+answered without touching individual pixels.
+
+Depth follows the D3D convention, that is, z/w in [0,1] with 0 being the
+near plane. Matrices are row-major and transform column vectors, i.e.
+clip = M * (x, y, z, 1).
+
+All tests are conservative: anything which cannot be proven hidden --
+including boxes which intersect the near plane or lie outside the screen --
+is reported as visible. Occluder triangles which cross the near plane are
+dropped instead of clipped, which can only make the buffer less occluding.
+*/
+class OcclusionBuffer final
+{
+public:
+	static const int TILE_WIDTH = 8;
+	static const int TILE_HEIGHT = 8;
+
+	/**
+	The width and height are rounded up to a multiple of the tile size. If
+	threadPool is null, everything runs on the calling thread.
+	*/
+	OcclusionBuffer (const int width, const int height,
+		ThreadPool* threadPool = nullptr);
+
+	OcclusionBuffer (const OcclusionBuffer&) = delete;
+	OcclusionBuffer& operator= (const OcclusionBuffer&) = delete;
+
+	/**
+	Reset the depth to the far plane and remove all queued occluders.
+	*/
+	void Clear ();
+
+	void SetViewProjection (const float* matrix);
+
+	/**
+	Queue an occluder mesh for rasterization. Positions are three floats
+	each, positionStride is in bytes. If worldMatrix is null, the positions
+	are assumed to be in world space already.
+	*/
+	void AddOccluder (const float* positions, const int positionStride,
+		const int vertexCount,
+		const std::uint32_t* indices, const int indexCount,
+		const float* worldMatrix = nullptr);
+
+	/**
+	Rasterize all queued occluders into the depth buffer.
+	*/
+	void Rasterize ();
+
+	/**
+	Test a world-space bounding box against the depth buffer. Returns false
+	only if the box is guaranteed to be hidden behind the occluders.
+	*/
+	bool IsVisible (const BoundingBox& box) const;
+
+	/**
+	Test many boxes at once, in parallel if a thread pool is available.
+	visible [i] is set to 1 if boxes [i] may be visible, 0 otherwise.
+	*/
+	void TestVisibility (const BoundingBox* boxes, const int count,
+		std::uint8_t* visible) const;
+
+	int GetWidth () const
+	{
+		return width_;
+	}
+
+	int GetHeight () const
+	{
+		return height_;
+	}
+
+	float GetDepth (const int x, const int y) const;
+
+private:
+	struct Triangle
+	{
+		// Screen space positions and z/w of the three vertices
+		float x [3], y [3], z [3];
+		int minX, minY, maxX, maxY;
+	};
+
+	// Farthest depth of each entry, level 0 holds one entry per tile
+	struct DepthLevel
+	{
+		int width, height;
+		std::vector<float> maxDepth;
+	};
+
+	void RasterizeTileRow (const int tileRow);
+	void RasterizeTriangle (const Triangle& triangle, const int tileRow);
+	void UpdateHierarchy ();
+
+	bool IsRegionVisible (const int level, const int x, const int y,
+		const int* pixelRect, const float minZ) const;
+
+	float* GetTile (const int tileX, const int tileY)
+	{
+		return depth_.data () +
+			(tileY * tilesX_ + tileX) * TILE_WIDTH * TILE_HEIGHT;
+	}
+
+	const float* GetTile (const int tileX, const int tileY) const
+	{
+		return depth_.data () +
+			(tileY * tilesX_ + tileX) * TILE_WIDTH * TILE_HEIGHT;
+	}
+
+	int width_, height_;
+	int tilesX_, tilesY_;
+
+	float viewProjection_ [16];
+
+	// Tile-major storage, TILE_WIDTH * TILE_HEIGHT depth values per tile
+	std::vector<float> depth_;
+	std::vector<DepthLevel> levels_;
+
+	std::vector<Triangle> triangles_;
+	std::vector<std::vector<int>> tileRowBins_;
+
+	ThreadPool* threadPool_;
+};
+}
+
+#endif
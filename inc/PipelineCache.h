@@ -0,0 +1,113 @@
+#ifndef ANTERU_D3D12_SAMPLE_PIPELINECACHE_H_
+#define ANTERU_D3D12_SAMPLE_PIPELINECACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Hash.h"
+#include "MappedFile.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Compiled pipeline state blobs on disk, keyed by the hash of their
+description (see PipelineStateManager::ComputeHash). Creating a pipeline
+state from its blob skips most of the driver's compilation.
+
+Blobs are only valid for the adapter and driver which created them, so
+the file stores a hash of the adapter identity, and a file written for a
+different identity is ignored and eventually replaced. The file is memory
+mapped, so only the index and the blobs which are looked up are read.
+
+New blobs are kept in memory until Save, which merges them into the file
+on disk and replaces it atomically. Every save starts a new generation,
+and blobs which were not used during the last maxUnusedGenerations
+generations are pruned, as are the least recently used ones beyond
+maxSize bytes.
+*/
+class PipelineCache final
+{
+public:
+	PipelineCache (const std::string& path, const std::string& adapterIdentity,
+		const int maxUnusedGenerations = 8,
+		const std::size_t maxSize = 64 << 20);
+	~PipelineCache ();
+
+	PipelineCache (const PipelineCache&) = delete;
+	PipelineCache& operator= (const PipelineCache&) = delete;
+
+	/**
+	Copy the blob stored for key into blob. Returns false if there is none,
+	or it is damaged. Can be called from several threads at once.
+	*/
+	bool Find (const Hash128& key, std::vector<std::uint8_t>& blob);
+
+	/**
+	Store blob for key. Empty blobs are ignored, as some drivers do not
+	provide any.
+	*/
+	void Add (const Hash128& key, std::vector<std::uint8_t> blob);
+
+	/**
+	Write added blobs and prune stale ones. Does nothing if no blob was
+	added. Returns false if the file could not be written; the blobs are
+	kept for the next attempt.
+	*/
+	bool Save ();
+
+	int GetHitCount () const;
+	int GetMissCount () const;
+
+	/**
+	Number of blobs dropped by the last Save.
+	*/
+	int GetPrunedCount () const;
+
+	/**
+	True if the file existed, but was written for a different adapter or
+	driver, or is damaged.
+	*/
+	bool WasInvalidated () const;
+
+private:
+	struct Entry
+	{
+		Hash128 key;
+		std::uint64_t offset;
+		std::uint32_t size;
+		std::uint32_t checksum;
+		std::uint32_t lastUsed;
+		std::uint32_t reserved;
+	};
+
+	void OpenFile ();
+	Entry GetFileEntry (const int index) const;
+	bool IsEntryValid (const Entry& entry) const;
+
+	std::string path_;
+	Hash128 identity_;
+	int maxUnusedGenerations_;
+	std::size_t maxSize_;
+
+	mutable std::mutex mutex_;
+	std::unique_ptr<MappedFile> file_;
+	int fileEntryCount_ = 0;
+	std::uint32_t fileGeneration_ = 0;
+	bool invalidated_ = false;
+
+	std::map<Hash128, std::vector<std::uint8_t>> addedEntries_;
+	std::set<Hash128> usedKeys_;
+
+	int hitCount_ = 0;
+	int missCount_ = 0;
+	int prunedCount_ = 0;
+};
+}
+
+#endif
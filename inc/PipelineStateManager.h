@@ -0,0 +1,136 @@
+#ifndef ANTERU_D3D12_SAMPLE_PIPELINESTATEMANAGER_H_
+#define ANTERU_D3D12_SAMPLE_PIPELINESTATEMANAGER_H_
+
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "Hash.h"
+#include "RenderDevice.h"
+
+namespace anteru {
+class PipelineCache;
+class ShaderCache;
+class ThreadPool;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Result of PipelineStateManager::Request. Handles are cheap to copy and stay
+valid as long as the manager which returned them.
+*/
+class PipelineStateHandle final
+{
+public:
+	PipelineStateHandle () = default;
+
+	bool IsValid () const
+	{
+		return entry_ != nullptr;
+	}
+
+	/**
+	True once the pipeline state has been created, or creation has failed.
+	*/
+	bool IsReady () const;
+
+	/**
+	The pipeline state if it is ready, fallback otherwise. This never
+	blocks, so it can be called while recording a frame, with a simpler
+	pipeline state standing in until the requested one is available.
+	Failed creations also return fallback.
+	*/
+	IPipelineState* Get (IPipelineState* fallback = nullptr) const;
+
+	/**
+	Block until the pipeline state is ready. Throws if creating it failed.
+	*/
+	IPipelineState* Wait () const;
+
+private:
+	friend class PipelineStateManager;
+
+	struct Entry
+	{
+		std::atomic<IPipelineState*> pipelineState { nullptr };
+		std::unique_ptr<IPipelineState> owner;
+		std::shared_future<void> done;
+	};
+
+	explicit PipelineStateHandle (const Entry* entry)
+		: entry_ (entry)
+	{
+	}
+
+	const Entry* entry_ = nullptr;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Creates pipeline states on a thread pool and keeps them for the lifetime
+of the manager.
+
+Requests are identified by a hash of everything which ends up in the
+pipeline state: root signature layout, shaders, input layout, render
+target format and blend mode. An identical request returns the handle of
+the first one instead of creating a second pipeline state, no matter
+whether that one is still being created.
+
+If a ShaderCache is provided, shaders without bytecode are looked up and
+compiled through it on the worker, so compilation runs in parallel too.
+With a PipelineCache, pipeline states are created from the blob of an
+earlier run if there is one, and new blobs are added to it.
+*/
+class PipelineStateManager final
+{
+public:
+	PipelineStateManager (IRenderDevice& device, ThreadPool& threadPool,
+		ShaderCache* shaderCache = nullptr,
+		PipelineCache* pipelineCache = nullptr);
+
+	/**
+	Waits for all pipeline states which are still being created.
+	*/
+	~PipelineStateManager ();
+
+	PipelineStateManager (const PipelineStateManager&) = delete;
+	PipelineStateManager& operator= (const PipelineStateManager&) = delete;
+
+	/**
+	Start creating a pipeline state for desc in the background. The shader
+	source and bytecode desc points to must stay valid until the handle is
+	ready; everything else is copied.
+	*/
+	PipelineStateHandle Request (const PipelineStateDesc& desc);
+
+	/**
+	Block until all requested pipeline states are ready.
+	*/
+	void WaitIdle ();
+
+	int GetRequestCount () const;
+	int GetPipelineStateCount () const;
+
+	/**
+	The root signature is hashed by its layout, not its identity, as root
+	signatures with the same layout are interchangeable. This keeps the
+	hash stable across runs.
+	*/
+	static Hash128 ComputeHash (const PipelineStateDesc& desc);
+
+private:
+	void Create (PipelineStateDesc desc, PipelineStateHandle::Entry* entry);
+
+	IRenderDevice& device_;
+	ThreadPool& threadPool_;
+	ShaderCache* shaderCache_;
+	PipelineCache* pipelineCache_;
+
+	mutable std::mutex mutex_;
+	std::map<Hash128, std::unique_ptr<PipelineStateHandle::Entry>> entries_;
+	int requestCount_ = 0;
+};
+}
+
+#endif
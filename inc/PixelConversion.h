@@ -0,0 +1,39 @@
+#ifndef ANTERU_D3D12_SAMPLE_PIXELCONVERSION_H_
+#define ANTERU_D3D12_SAMPLE_PIXELCONVERSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Convert floats to half floats, rounding to nearest even. Values beyond the
+half range become infinity, like the hardware conversion does.
+*/
+void ConvertFloatToHalf (const float* input, std::uint16_t* output,
+	const std::size_t count);
+
+///////////////////////////////////////////////////////////////////////////////
+void ConvertHalfToFloat (const std::uint16_t* input, float* output,
+	const std::size_t count);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Pack RGBA float pixels into R11G11B10_FLOAT, ignoring alpha. The format
+has no sign bit, so negative values and NaN become 0, and values beyond the
+largest finite value are clamped to it.
+*/
+void PackR11G11B10 (const float* input, std::uint32_t* output,
+	const std::size_t pixelCount);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Pack RGBA float pixels into R9G9B9E5_SHAREDEXP, ignoring alpha: three 9-bit
+mantissas which share the exponent of the largest component. Negative
+values and NaN become 0, large values are clamped.
+*/
+void PackR9G9B9E5 (const float* input, std::uint32_t* output,
+	const std::size_t pixelCount);
+}
+
+#endif
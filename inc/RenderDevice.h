@@ -0,0 +1,566 @@
+#ifndef ANTERU_D3D12_SAMPLE_RENDERDEVICE_H_
+#define ANTERU_D3D12_SAMPLE_RENDERDEVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "WaitableEvent.h"
+
+namespace anteru {
+class IGpuTimestampBackend;
+class IShaderCompiler;
+
+/**
+A thin layer over the parts of D3D12 the sample uses. The interfaces map
+one-to-one onto D3D12 objects and calls, so the D3D12 backend is a direct
+translation, while other backends can run the same frame loop without a
+GPU.
+
+Resources, descriptors and command lists follow the D3D12 rules: upload and
+readback buffers can be mapped, everything else is only accessed through
+command lists, and the application tracks resource states and lifetimes
+with fences.
+*/
+
+///////////////////////////////////////////////////////////////////////////////
+enum class PixelFormat
+{
+	Unknown,
+	R8G8B8A8_UNorm,
+	R8G8B8A8_UNorm_sRGB,
+	R32_UInt,
+	R32G32_Float,
+	R32G32B32_Float,
+	R16G16B16A16_Float,
+	R11G11B10_Float,
+	R9G9B9E5_SharedExp,
+	R8_UNorm,
+	R8G8_UNorm,
+	// Vertex formats for quantized attributes
+	R16G16B16A16_UNorm,
+	R16G16_UNorm,
+	R16G16_SNorm,
+	R16G16_Float,
+	// Block compressed formats store 4x4 texel blocks, so textures using
+	// them must have a width and height which are multiples of 4
+	BC1_UNorm,
+	BC1_UNorm_sRGB,
+	BC3_UNorm,
+	BC3_UNorm_sRGB
+};
+
+/**
+0 for block compressed formats.
+*/
+int GetBytesPerPixel (const PixelFormat format);
+
+bool IsBlockCompressed (const PixelFormat format);
+
+/**
+Size of one row of a width texels wide texture in a buffer, which is a row
+of 4x4 blocks for block compressed formats. 0 if the format is unknown.
+*/
+int GetRowSize (const PixelFormat format, const int width);
+
+/**
+Number of rows of a texture in a buffer, see GetRowSize.
+*/
+int GetRowCount (const PixelFormat format, const int height);
+
+const char* GetPixelFormatName (const PixelFormat format);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Where a shader resource view takes each component from: one of the
+components in memory, or a constant.
+*/
+enum class ComponentSource
+{
+	Red,
+	Green,
+	Blue,
+	Alpha,
+	Zero,
+	One
+};
+
+struct ComponentMapping
+{
+	ComponentSource red;
+	ComponentSource green;
+	ComponentSource blue;
+	ComponentSource alpha;
+};
+
+const ComponentMapping IDENTITY_COMPONENT_MAPPING = {
+	ComponentSource::Red, ComponentSource::Green,
+	ComponentSource::Blue, ComponentSource::Alpha
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class HeapType
+{
+	// GPU memory, not accessible from the CPU
+	Default,
+	// CPU write, GPU read
+	Upload,
+	// GPU write, CPU read
+	Readback
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class ResourceState
+{
+	Common,
+	VertexAndConstantBuffer,
+	IndexBuffer,
+	RenderTarget,
+	PixelShaderResource,
+	CopyDestination,
+	CopySource,
+	GenericRead,
+	Present
+};
+
+// Rows of texture data in buffers must start at multiples of this
+const int TEXTURE_DATA_PITCH_ALIGNMENT = 256;
+
+// Flip model swap chains support at most this many buffers
+const int MAX_SWAP_CHAIN_BUFFERS = 16;
+
+///////////////////////////////////////////////////////////////////////////////
+class IResource
+{
+public:
+	IResource () = default;
+	IResource (const IResource&) = delete;
+	IResource& operator= (const IResource&) = delete;
+
+	virtual ~IResource ();
+
+	/**
+	Map the whole resource. Only valid for upload and readback buffers.
+	Mapping may be kept across frames.
+	*/
+	virtual void* Map () = 0;
+	virtual void Unmap () = 0;
+
+	virtual std::uint64_t GetGpuAddress () const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct GpuDescriptorHandle
+{
+	std::uint64_t ptr;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Shader visible heap for shader resource views.
+*/
+class IDescriptorHeap
+{
+public:
+	IDescriptorHeap () = default;
+	IDescriptorHeap (const IDescriptorHeap&) = delete;
+	IDescriptorHeap& operator= (const IDescriptorHeap&) = delete;
+
+	virtual ~IDescriptorHeap ();
+
+	virtual void CreateShaderResourceView (const int index,
+		IResource* texture, const PixelFormat format,
+		const ComponentMapping& mapping = IDENTITY_COMPONENT_MAPPING) = 0;
+	virtual GpuDescriptorHandle GetGpuHandle (const int index) const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class RootParameterType
+{
+	// A range of shader resource views, starting at shaderRegister
+	DescriptorTable,
+	ConstantBufferView,
+	// 32-bit values stored in the root signature itself, which the shader
+	// sees as a constant buffer
+	Constants
+};
+
+enum class ShaderVisibility
+{
+	All,
+	Vertex,
+	Pixel
+};
+
+struct RootParameter
+{
+	RootParameterType type;
+	int shaderRegister;
+	// Number of descriptors for tables, or 32-bit values for constants,
+	// ignored otherwise
+	int count;
+	ShaderVisibility visibility;
+};
+
+enum class SamplerFilter
+{
+	Point,
+	MinMagLinearMipPoint,
+	Linear
+};
+
+struct StaticSampler
+{
+	SamplerFilter filter;
+	int shaderRegister;
+};
+
+struct RootSignatureDesc
+{
+	std::vector<RootParameter> parameters;
+	std::vector<StaticSampler> staticSamplers;
+};
+
+// Root signatures may use at most this many DWORDs
+const int MAX_ROOT_SIGNATURE_SIZE = 64;
+
+/**
+Size in DWORDs: tables take one, root descriptors two, and constants one
+per value.
+*/
+int GetRootParameterSize (const RootParameter& parameter);
+int GetRootSignatureSize (const RootSignatureDesc& desc);
+
+///////////////////////////////////////////////////////////////////////////////
+class IRootSignature
+{
+public:
+	IRootSignature () = default;
+	IRootSignature (const IRootSignature&) = delete;
+	IRootSignature& operator= (const IRootSignature&) = delete;
+
+	virtual ~IRootSignature ();
+
+	virtual const RootSignatureDesc& GetDesc () const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct InputElement
+{
+	const char* semanticName;
+	int semanticIndex;
+	PixelFormat format;
+	int offset;
+};
+
+enum class BlendMode
+{
+	Opaque,
+	// Color is blended with source alpha, alpha is written unchanged
+	AlphaBlend
+};
+
+struct ShaderDefine
+{
+	const char* name;
+	const char* value;
+};
+
+struct ShaderDesc
+{
+	// HLSL source, not necessarily null-terminated
+	const char* source;
+	std::size_t sourceSize;
+	const char* entryPoint;
+	const char* profile;
+	std::vector<ShaderDefine> defines;
+	// Precompiled bytecode, for instance from a ShaderCache. If set, the
+	// device uses it instead of compiling source
+	const void* bytecode;
+	std::size_t bytecodeSize;
+};
+
+struct PipelineStateDesc
+{
+	IRootSignature* rootSignature;
+	ShaderDesc vertexShader;
+	ShaderDesc pixelShader;
+	std::vector<InputElement> inputLayout;
+	PixelFormat renderTargetFormat;
+	BlendMode blendMode;
+	// Blob from IPipelineState::GetCachedBlob of an earlier run, for
+	// instance from a PipelineCache. Devices ignore blobs which do not
+	// match the adapter, driver or the rest of the description
+	const void* cachedBlob = nullptr;
+	std::size_t cachedBlobSize = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class IPipelineState
+{
+public:
+	IPipelineState () = default;
+	IPipelineState (const IPipelineState&) = delete;
+	IPipelineState& operator= (const IPipelineState&) = delete;
+
+	virtual ~IPipelineState ();
+
+	/**
+	Driver-specific compiled form of the pipeline state, which speeds up
+	creating the same pipeline state again. May be empty.
+	*/
+	virtual std::vector<std::uint8_t> GetCachedBlob () const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct ResourceTransition
+{
+	IResource* resource;
+	ResourceState before;
+	ResourceState after;
+};
+
+struct Viewport
+{
+	float x, y, width, height;
+	float minDepth, maxDepth;
+};
+
+struct ScissorRect
+{
+	int left, top, right, bottom;
+};
+
+enum class IndexFormat
+{
+	UInt16,
+	UInt32
+};
+
+struct VertexBufferView
+{
+	std::uint64_t gpuAddress;
+	int size;
+	int stride;
+};
+
+struct IndexBufferView
+{
+	std::uint64_t gpuAddress;
+	int size;
+	IndexFormat format;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class CommandListType
+{
+	Direct,
+	/**
+	A sequence of draws which is recorded once and executed from direct
+	command lists with ExecuteBundle. Bundles can't clear, copy, set
+	barriers, render targets, viewports or scissors.
+	*/
+	Bundle
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+A command list together with its allocator. Command lists are created
+closed; Reset releases the memory of the previous recording, so it must
+only be called once the GPU is done with it. Primitives are always
+triangle lists.
+*/
+class ICommandList
+{
+public:
+	ICommandList () = default;
+	ICommandList (const ICommandList&) = delete;
+	ICommandList& operator= (const ICommandList&) = delete;
+
+	virtual ~ICommandList ();
+
+	virtual void Reset () = 0;
+	virtual void Close () = 0;
+
+	virtual void ResourceBarrier (const ResourceTransition* transitions,
+		const int count) = 0;
+
+	virtual void CopyBufferRegion (IResource* destination,
+		const std::uint64_t destinationOffset,
+		IResource* source, const std::uint64_t sourceOffset,
+		const std::uint64_t size) = 0;
+
+	/**
+	Copy a whole texture from a buffer. Rows start every rowPitch bytes,
+	which must be a multiple of TEXTURE_DATA_PITCH_ALIGNMENT.
+	*/
+	virtual void CopyBufferToTexture (IResource* destination,
+		IResource* source, const std::uint64_t sourceOffset,
+		const int rowPitch) = 0;
+
+	/**
+	Copy a whole texture into a buffer, the counterpart of
+	CopyBufferToTexture with the same rules for rowPitch.
+	*/
+	virtual void CopyTextureToBuffer (IResource* destination,
+		const std::uint64_t destinationOffset, IResource* source,
+		const int rowPitch) = 0;
+
+	/**
+	renderTarget must be a swap chain buffer or a texture created as a
+	render target.
+	*/
+	virtual void SetRenderTarget (IResource* renderTarget) = 0;
+	virtual void ClearRenderTarget (IResource* renderTarget,
+		const float* color) = 0;
+	virtual void SetViewport (const Viewport& viewport) = 0;
+	virtual void SetScissorRect (const ScissorRect& rect) = 0;
+
+	virtual void SetDescriptorHeap (IDescriptorHeap* heap) = 0;
+	virtual void SetGraphicsRootSignature (IRootSignature* rootSignature) = 0;
+	virtual void SetPipelineState (IPipelineState* pipelineState) = 0;
+	virtual void SetGraphicsRootConstantBufferView (const int parameter,
+		const std::uint64_t gpuAddress) = 0;
+	virtual void SetGraphicsRootDescriptorTable (const int parameter,
+		const GpuDescriptorHandle handle) = 0;
+	/**
+	Set count 32-bit values of a Constants parameter, starting at the
+	value offset. The values are copied.
+	*/
+	virtual void SetGraphicsRoot32BitConstants (const int parameter,
+		const int count, const void* data, const int offset = 0) = 0;
+
+	virtual void SetVertexBuffer (const VertexBufferView& view) = 0;
+	virtual void SetIndexBuffer (const IndexBufferView& view) = 0;
+
+	virtual void DrawIndexedInstanced (const int indexCountPerInstance,
+		const int instanceCount, const int startIndex,
+		const int baseVertex, const int startInstance) = 0;
+
+	/**
+	Execute a closed bundle. The bundle uses the render target, viewport,
+	scissor, descriptor heap and root arguments of this list. To set root
+	arguments, the bundle has to set the same root signature as this list
+	first, which keeps the arguments it doesn't set. The pipeline state
+	the bundle sets last stays set afterwards. The bundle must stay alive
+	until the GPU is done with this list.
+	*/
+	virtual void ExecuteBundle (ICommandList* bundle) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+A fence, which can be waited on with the functions from WaitableEvent.h.
+*/
+class IFence : public ITimeline
+{
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class ICommandQueue
+{
+public:
+	ICommandQueue () = default;
+	ICommandQueue (const ICommandQueue&) = delete;
+	ICommandQueue& operator= (const ICommandQueue&) = delete;
+
+	virtual ~ICommandQueue ();
+
+	virtual void ExecuteCommandLists (ICommandList* const* commandLists,
+		const int count) = 0;
+
+	/**
+	Set fence to value once all work submitted so far has finished.
+	*/
+	virtual void Signal (IFence* fence, const std::uint64_t value) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class ISwapChain
+{
+public:
+	ISwapChain () = default;
+	ISwapChain (const ISwapChain&) = delete;
+	ISwapChain& operator= (const ISwapChain&) = delete;
+
+	virtual ~ISwapChain ();
+
+	virtual int GetBufferCount () const = 0;
+	virtual IResource* GetBuffer (const int index) = 0;
+	virtual int GetCurrentBufferIndex () const = 0;
+
+	/**
+	Format to use for render targets and pipelines which write into the
+	buffers.
+	*/
+	virtual PixelFormat GetRenderTargetFormat () const = 0;
+
+	virtual int GetWidth () const = 0;
+	virtual int GetHeight () const = 0;
+
+	virtual void Present (const int syncInterval) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class IRenderDevice
+{
+public:
+	IRenderDevice () = default;
+	IRenderDevice (const IRenderDevice&) = delete;
+	IRenderDevice& operator= (const IRenderDevice&) = delete;
+
+	virtual ~IRenderDevice ();
+
+	/**
+	The direct queue of the device.
+	*/
+	virtual ICommandQueue* GetQueue () = 0;
+
+	/**
+	Create a swap chain which presents on the queue. The D3D12 backend
+	opens a window of the requested size for it.
+	*/
+	virtual std::unique_ptr<ISwapChain> CreateSwapChain (const int width,
+		const int height, const int bufferCount) = 0;
+
+	virtual std::unique_ptr<IFence> CreateFence (const std::uint64_t initialValue) = 0;
+	virtual std::unique_ptr<ICommandList> CreateCommandList (
+		const CommandListType type = CommandListType::Direct) = 0;
+
+	virtual std::unique_ptr<IResource> CreateBuffer (const std::size_t size,
+		const HeapType heapType, const ResourceState initialState) = 0;
+	virtual std::unique_ptr<IResource> CreateTexture2D (const int width,
+		const int height, const PixelFormat format,
+		const ResourceState initialState, const bool renderTarget = false) = 0;
+
+	virtual std::unique_ptr<IDescriptorHeap> CreateDescriptorHeap (
+		const int descriptorCount) = 0;
+	virtual std::unique_ptr<IRootSignature> CreateRootSignature (
+		const RootSignatureDesc& desc) = 0;
+	virtual std::unique_ptr<IPipelineState> CreatePipelineState (
+		const PipelineStateDesc& desc) = 0;
+
+	/**
+	Compiler for the shaders of pipeline states created on this device.
+	*/
+	virtual std::unique_ptr<IShaderCompiler> CreateShaderCompiler () = 0;
+
+	/**
+	Identifies the adapter and driver version. Cached pipeline state blobs
+	are only valid on a device with the same identity.
+	*/
+	virtual std::string GetAdapterIdentity () const = 0;
+
+	/**
+	Timestamp queries for GpuProfiler, with queriesPerSlot queries for each
+	command list. Timestamps for slot i are written into commandLists [i].
+	*/
+	virtual std::unique_ptr<IGpuTimestampBackend> CreateTimestampBackend (
+		const std::vector<ICommandList*>& commandLists,
+		const int queriesPerSlot) = 0;
+};
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef ANTERU_D3D12_SAMPLE_ROOTSIGNATUREBUILDER_H_
+#define ANTERU_D3D12_SAMPLE_ROOTSIGNATUREBUILDER_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+How often a binding changes, from most to least frequent.
+*/
+enum class UpdateFrequency
+{
+	PerDraw,
+	PerMaterial,
+	PerFrame,
+	Static
+};
+
+enum class BindingType
+{
+	ConstantBuffer,
+	Texture
+};
+
+struct ShaderBinding
+{
+	BindingType type;
+	int shaderRegister;
+	// Size in bytes for constant buffers, number of textures otherwise
+	int size;
+	UpdateFrequency frequency;
+	ShaderVisibility visibility;
+};
+
+// Larger constant buffers are never placed in the root signature
+const int MAX_ROOT_CONSTANT_BUFFER_SIZE = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+struct RootSignatureLayout
+{
+	struct Binding
+	{
+		int parameter;
+		RootParameterType type;
+		// Offset of the first texture in the descriptor table
+		int tableOffset;
+	};
+
+	RootSignatureDesc desc;
+	// Where each binding ended up, in the order they were passed in
+	std::vector<Binding> bindings;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Choose the root parameters for a set of bindings.
+
+Textures with the same frequency and visibility and consecutive registers
+share a descriptor table. Constant buffers become root descriptors,
+except that the ones which change at least once per frame and are at most
+MAX_ROOT_CONSTANT_BUFFER_SIZE bytes are stored as root constants, which
+skips the upload heap. If not all of them fit into maxSize DWORDs, the
+most frequently changing ones are preferred, then the smaller ones.
+
+Parameters are ordered from most to least frequently changing, as some
+hardware handles the first parameters faster. Throws if the bindings
+don't fit even without root constants.
+*/
+RootSignatureLayout BuildRootSignatureLayout (
+	const std::vector<ShaderBinding>& bindings,
+	const std::vector<StaticSampler>& staticSamplers,
+	const int maxSize = MAX_ROOT_SIGNATURE_SIZE);
+
+/**
+Canonical binary form of desc, equal descs produce identical bytes.
+*/
+std::vector<std::uint8_t> SerializeRootSignature (const RootSignatureDesc& desc);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Creates each distinct root signature only once. Root signatures are
+compared by their serialized form, so layouts built from different
+bindings share a root signature if they end up identical. Thread-safe.
+*/
+class RootSignatureCache final
+{
+public:
+	explicit RootSignatureCache (IRenderDevice& device);
+	~RootSignatureCache ();
+
+	RootSignatureCache (const RootSignatureCache&) = delete;
+	RootSignatureCache& operator= (const RootSignatureCache&) = delete;
+
+	/**
+	The returned root signature is owned by the cache.
+	*/
+	IRootSignature* Get (const RootSignatureDesc& desc);
+
+	int GetRootSignatureCount () const;
+
+private:
+	IRenderDevice& device_;
+
+	mutable std::mutex mutex_;
+	std::map<std::vector<std::uint8_t>, std::unique_ptr<IRootSignature>> rootSignatures_;
+};
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef ANTERU_D3D12_SAMPLE_SHADERARCHIVE_H_
+#define ANTERU_D3D12_SAMPLE_SHADERARCHIVE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace anteru {
+namespace detail {
+constexpr std::uint32_t HashEntryPoint (const char* s,
+	const std::uint32_t hash = 2166136261u)
+{
+	return *s ? HashEntryPoint (s + 1,
+		(hash ^ static_cast<std::uint8_t> (*s)) * 16777619u) : hash;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Key of one permutation of a shader. keywords is the bit mask of the
+active keywords, in the order they are declared in the //!permutation
+line of the source. Matches GetPermutationKey in buildShaderArchive.py.
+*/
+constexpr std::uint64_t GetShaderPermutationKey (const char* entryPoint,
+	const std::uint32_t keywords)
+{
+	return (static_cast<std::uint64_t> (detail::HashEntryPoint (entryPoint)) << 32)
+		| keywords;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Read-only view of the shader permutations precompiled at build time by
+buildShaderArchive.py. The archive is not copied, data must stay valid
+as long as the archive is used.
+*/
+class ShaderArchive final
+{
+public:
+	struct Shader
+	{
+		const void* data;
+		std::size_t size;
+	};
+
+	/**
+	Throws if data is not a valid archive.
+	*/
+	ShaderArchive (const void* data, const std::size_t size);
+
+	/**
+	Bytecode for key, or a null shader if the permutation was not compiled.
+	Lookup is a binary search over the sorted index, so it's cheap enough
+	to be called whenever a pipeline state is created.
+	*/
+	Shader Find (const std::uint64_t key) const;
+
+	int GetShaderCount () const
+	{
+		return count_;
+	}
+
+private:
+	const std::uint8_t* data_;
+	std::size_t size_;
+	int count_ = 0;
+};
+}
+
+#endif
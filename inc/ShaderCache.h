@@ -0,0 +1,88 @@
+#ifndef ANTERU_D3D12_SAMPLE_SHADERCACHE_H_
+#define ANTERU_D3D12_SAMPLE_SHADERCACHE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Hash.h"
+#include "MappedFile.h"
+#include "RenderDevice.h"
+
+namespace anteru {
+class IShaderCompiler;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Content-addressed cache of shader bytecode on disk.
+
+Every shader is identified by a hash of the compiler version, the
+preprocessed source, entry point, profile and defines, so editing a
+comment or an unrelated shader keeps the entry valid, while anything
+which changes the output produces a new key. The compiler is only called
+if the key is not in the cache.
+
+The cache file is memory mapped, so only the index and the entries which
+are actually used are read. New entries are kept in memory until Save,
+which merges them with the current file on disk and replaces it
+atomically, so concurrent processes never see a partially written cache.
+Entries are checksummed, and a damaged or outdated file is treated like
+an empty one.
+*/
+class ShaderCache final
+{
+public:
+	ShaderCache (IShaderCompiler& compiler, const std::string& path);
+	~ShaderCache ();
+
+	ShaderCache (const ShaderCache&) = delete;
+	ShaderCache& operator= (const ShaderCache&) = delete;
+
+	/**
+	Bytecode for desc, from the cache or freshly compiled. Throws if the
+	shader has to be compiled and fails. Can be called from several
+	threads at once; threads which miss the same shader at the same time
+	each compile it.
+	*/
+	std::vector<std::uint8_t> GetBytecode (const ShaderDesc& desc);
+
+	/**
+	Write entries added since the last save. Returns false if the file
+	could not be written; the entries are kept for the next attempt.
+	*/
+	bool Save ();
+
+	int GetHitCount () const;
+	int GetMissCount () const;
+
+private:
+	struct Entry
+	{
+		Hash128 key;
+		std::uint64_t offset;
+		std::uint32_t size;
+		std::uint32_t checksum;
+	};
+
+	Hash128 GetKey (const ShaderDesc& desc) const;
+	bool FindInFile (const Hash128& key, std::vector<std::uint8_t>& bytecode) const;
+	void OpenFile ();
+
+	IShaderCompiler& compiler_;
+	std::string compilerVersion_;
+	std::string path_;
+
+	mutable std::mutex mutex_;
+	std::unique_ptr<MappedFile> file_;
+	int fileEntryCount_ = 0;
+	std::map<Hash128, std::vector<std::uint8_t>> addedEntries_;
+
+	int hitCount_ = 0;
+	int missCount_ = 0;
+};
+}
+
+#endif
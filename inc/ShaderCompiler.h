@@ -0,0 +1,66 @@
+#ifndef ANTERU_D3D12_SAMPLE_SHADERCOMPILER_H_
+#define ANTERU_D3D12_SAMPLE_SHADERCOMPILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Turns the HLSL source of a ShaderDesc into bytecode for a device. Both
+methods may be called from several threads at once.
+*/
+class IShaderCompiler
+{
+public:
+	virtual ~IShaderCompiler ();
+
+	/**
+	Identifies the compiler and its options. It is part of every cache key,
+	so updating the compiler invalidates all cached bytecode.
+	*/
+	virtual std::string GetVersion () const = 0;
+
+	/**
+	Source with the defines applied and macros expanded. Changes which do
+	not affect the output, like comments, should not show up here. Throws
+	if the source cannot be preprocessed.
+	*/
+	virtual std::string Preprocess (const ShaderDesc& desc) = 0;
+
+	/**
+	Throws if the shader fails to compile.
+	*/
+	virtual std::vector<std::uint8_t> Compile (const ShaderDesc& desc) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Compiler for devices which do not execute bytecode, like the null device.
+Preprocessing strips comments and prepends the defines, and the
+"bytecode" is the preprocessed source behind a small header, so the
+output changes whenever the input does. Compiling counts the calls, which
+makes it easy to check when a ShaderCache compiles.
+*/
+class StubShaderCompiler final : public IShaderCompiler
+{
+public:
+	std::string GetVersion () const override;
+	std::string Preprocess (const ShaderDesc& desc) override;
+	std::vector<std::uint8_t> Compile (const ShaderDesc& desc) override;
+
+	int GetCompileCount () const
+	{
+		return compileCount_;
+	}
+
+private:
+	std::atomic<int> compileCount_ { 0 };
+};
+}
+
+#endif
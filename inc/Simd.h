@@ -0,0 +1,28 @@
+#ifndef ANTERU_D3D12_SAMPLE_SIMD_H_
+#define ANTERU_D3D12_SAMPLE_SIMD_H_
+
+// Instruction set detection for the vectorized CPU code paths. Every user
+// of these macros has to provide a scalar fallback. Define ANTERU_NO_SIMD to
+// build only the fallbacks, for instance to compare them in a benchmark.
+
+#ifndef ANTERU_NO_SIMD
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANTERU_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// F16C is not part of the x86-64 baseline, and has to be enabled with
+// -mf16c or /arch:AVX2
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define ANTERU_F16C 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define ANTERU_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#endif
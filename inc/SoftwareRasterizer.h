@@ -0,0 +1,185 @@
+#ifndef ANTERU_D3D12_SAMPLE_SOFTWARERASTERIZER_H_
+#define ANTERU_D3D12_SAMPLE_SOFTWARERASTERIZER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+class ThreadPool;
+
+const int MAX_SHADER_CONSTANT_BUFFERS = 4;
+const int MAX_SHADER_TEXTURES = 4;
+const int MAX_SHADER_SAMPLERS = 2;
+// Scalar attributes passed from the vertex to the pixel shader
+const int MAX_VARYINGS = 16;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+8-bit RGBA image in memory, used for both render targets and textures.
+sRGB images are converted to linear on read and back to sRGB on write.
+mapping is applied when sampling textures, like a shader resource view
+does on the GPU.
+*/
+struct RasterImage
+{
+	std::uint8_t* data;
+	int width;
+	int height;
+	int rowPitch;
+	bool srgb;
+	ComponentMapping mapping;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Resources visible to software shaders, indexed by shader register.
+*/
+struct ShaderBindings
+{
+	const float* constantBuffers [MAX_SHADER_CONSTANT_BUFFERS];
+	RasterImage textures [MAX_SHADER_TEXTURES];
+	SamplerFilter samplers [MAX_SHADER_SAMPLERS];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Sample a texture at (u, v) with wrap addressing and write the linear RGBA
+result to color. Textures have a single mip level, so all filters apart
+from Point are bilinear.
+*/
+void SampleTexture (const RasterImage& texture, const SamplerFilter filter,
+	const float u, const float v, float* color);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Output of a vertex shader: clip space position plus the attributes which
+get interpolated for the pixel shader.
+*/
+struct RasterVertex
+{
+	float position [4];
+	float varyings [MAX_VARYINGS];
+};
+
+/**
+inputs contains one four-component register per shader input, with
+missing components filled in as (0, 0, 0, 1) like on the GPU.
+*/
+typedef void (*SoftwareVertexShader) (const ShaderBindings& bindings,
+	const float (*inputs) [4], RasterVertex& output);
+
+/**
+Shade four pixels at once. Varyings are passed component by component,
+that is, varyings [i * 4 + lane], and the shader writes r, g, b, a the
+same way to color. Pixels outside of the triangle are shaded as well and
+discarded afterwards.
+*/
+typedef void (*SoftwarePixelShader) (const ShaderBindings& bindings,
+	const float* varyings, float* color);
+
+///////////////////////////////////////////////////////////////////////////////
+struct RasterState
+{
+	SoftwarePixelShader pixelShader;
+	ShaderBindings bindings;
+	int varyingCount;
+	BlendMode blendMode;
+	Viewport viewport;
+	ScissorRect scissor;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Sort-middle tiled rasterizer. Triangles are clipped, set up and binned
+into TILE_SIZE x TILE_SIZE tiles as they are submitted. Flush then
+processes the tiles in parallel, each tile handling its triangles in
+submission order, so blending is deterministic and the result does not
+depend on the number of threads.
+
+Rasterization follows the D3D rules: vertices are snapped to 1/256 pixel,
+pixel centers are sampled with a top-left fill rule, clockwise triangles
+are front facing and back faces are culled. Within a flush, tiles are kept
+in linear floating point, and written back to the target once at the end.
+*/
+class SoftwareRasterizer final
+{
+public:
+	static const int TILE_SIZE = 64;
+	static const int BLOCK_SIZE = 8;
+
+	explicit SoftwareRasterizer (ThreadPool* threadPool = nullptr);
+
+	/**
+	Set the target for the following commands. Pending work is flushed if
+	the target changes.
+	*/
+	void SetRenderTarget (const RasterImage& target);
+
+	void Clear (const float* color);
+
+	/**
+	Queue a triangle list. The vertices have already been transformed by
+	the vertex shader and are only read during this call. The pixel shader
+	runs during Flush, so the resources bound in state must stay alive
+	until then.
+	*/
+	void DrawTriangles (const RasterState& state, const RasterVertex* vertices,
+		const std::uint32_t* indices, const int indexCount);
+
+	/**
+	Rasterize everything queued so far into the render target.
+	*/
+	void Flush ();
+
+	/**
+	Pixels which passed the coverage test since the last call.
+	*/
+	std::uint64_t GetShadedPixelCount ();
+
+private:
+	struct Triangle
+	{
+		// Edge functions a*x + b*y + c in 1/256 pixel units, with the fill
+		// rule bias applied, so pixels with E >= 0 for all edges are inside
+		std::int64_t a [3], b [3], c [3];
+		int minX, minY, maxX, maxY;
+		// Edge values within a partially covered block fit into 32 bits
+		bool smallEdges;
+
+		// Interpolation planes for 1/w and varyings/w, relative to (x0, y0)
+		float x0, y0;
+		float planes [MAX_VARYINGS + 1][3];
+
+		int state;
+	};
+
+	void SetupTriangle (const RasterVertex* vertices [3], const int state);
+	void ClipAndSetupTriangle (const RasterVertex& v0, const RasterVertex& v1,
+		const RasterVertex& v2, const int state);
+
+	void ProcessTile (const int tile, float* pixels) const;
+	void RasterizeTriangle (const Triangle& triangle, const int tileX,
+		const int tileY, float* pixels) const;
+	void ShadePixels (const Triangle& triangle, const int x, const int y,
+		const int mask, float* pixels) const;
+
+	RasterImage target_;
+	int tilesX_ = 0, tilesY_ = 0;
+
+	std::vector<RasterState> states_;
+	std::vector<Triangle> triangles_;
+	std::vector<float> clearColors_;
+
+	// Per tile list of commands, either a triangle index or a clear
+	std::vector<std::vector<std::uint32_t>> bins_;
+	std::vector<int> activeTiles_;
+
+	mutable std::vector<std::uint64_t> shadedPixelCounts_;
+
+	ThreadPool* threadPool_;
+};
+}
+
+#endif
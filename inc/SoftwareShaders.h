@@ -0,0 +1,33 @@
+#ifndef ANTERU_D3D12_SAMPLE_SOFTWARESHADERS_H_
+#define ANTERU_D3D12_SAMPLE_SOFTWARESHADERS_H_
+
+#include "SoftwareRasterizer.h"
+
+namespace anteru {
+const int MAX_SOFTWARE_SHADER_INPUTS = 8;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+C++ version of an HLSL entry point for the software device. Vertex shaders
+list the semantics of their inputs, which are matched against the input
+layout by name, and the number of scalar varyings they write. Pixel
+shaders read the same number of varyings.
+*/
+struct SoftwareShader
+{
+	const char* entryPoint;
+	SoftwareVertexShader vertexShader;
+	SoftwarePixelShader pixelShader;
+	const char* inputSemantics [MAX_SOFTWARE_SHADER_INPUTS];
+	int inputCount;
+	int varyingCount;
+};
+
+/**
+Find the C++ implementation of an entry point from shaders.hlsl, returns
+nullptr if there is none.
+*/
+const SoftwareShader* FindSoftwareShader (const char* entryPoint);
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef ANTERU_D3D12_SAMPLE_TEXTUREPACKING_H_
+#define ANTERU_D3D12_SAMPLE_TEXTUREPACKING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+class ThreadPool;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Properties of an RGBA8 image which decide how it can be stored.
+*/
+struct TextureContent
+{
+	// Range of each channel
+	std::uint8_t minimum [4];
+	std::uint8_t maximum [4];
+	// Red, green and blue are equal for every pixel
+	bool grayscale;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+TextureContent AnalyzeTextureContent (const std::uint8_t* pixels,
+	const int width, const int height, const int rowPitch);
+
+///////////////////////////////////////////////////////////////////////////////
+struct TexturePackingOptions
+{
+	// The color channels are sRGB encoded
+	bool srgb = true;
+	// Allow the lossy BC1 and BC3 formats
+	bool allowBlockCompression = false;
+	// Largest root mean square error, in 8-bit steps over all stored
+	// channels, at which block compression is used
+	float maxBlockCompressionError = 4.0f;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Texture data in the format picked by PackTexture. Rows, or rows of blocks,
+start every rowPitch bytes, which is a multiple of
+TEXTURE_DATA_PITCH_ALIGNMENT, so data can be copied into an upload buffer
+as-is. The shader resource view must use mapping to return the original
+RGBA values.
+*/
+struct PackedTexture
+{
+	std::vector<std::uint8_t> data;
+	int width;
+	int height;
+	int rowPitch;
+	PixelFormat format;
+	ComponentMapping mapping;
+	// Texture sizes without row padding, as RGBA8 and as packed
+	std::size_t originalSize;
+	std::size_t packedSize;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Choose the smallest format which can hold an RGBA8 image, and repack it.
+
+Lossless options come first: grayscale images are stored as R8, or R8G8
+with alpha in green, and images whose blue and alpha channels are
+constant at 0 or 255 as R8G8, with the constants supplied by the view.
+There are no sRGB variants of R8 and R8G8, so this only applies to linear
+images. Otherwise, if block compression is allowed and the size is a
+multiple of 4, the image is compressed to BC1 if it is opaque and BC3 if
+not, as long as the error stays below maxBlockCompressionError, which
+holds for smooth, low contrast content. Everything else stays RGBA8.
+
+Block compression runs on threadPool, if provided.
+*/
+PackedTexture PackTexture (const std::uint8_t* pixels, const int width,
+	const int height, const int rowPitch, const TexturePackingOptions& options,
+	ThreadPool* threadPool = nullptr);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Expand texture data in one of the formats PackTexture produces to tightly
+packed RGBA8, filling in missing channels like the GPU does: 0 for color
+and 255 for alpha. No component mapping is applied.
+*/
+void UnpackTexture (const std::uint8_t* data, const int width,
+	const int height, const int rowPitch, const PixelFormat format,
+	std::uint8_t* pixels);
+}
+
+#endif
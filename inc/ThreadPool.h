@@ -0,0 +1,111 @@
+#ifndef ANTERU_D3D12_SAMPLE_THREADPOOL_H_
+#define ANTERU_D3D12_SAMPLE_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+A fixed set of worker threads used for data-parallel CPU work, and for
+long-running tasks which complete in the background.
+
+The calling thread participates in ParallelFor, so a pool with zero workers
+simply runs everything inline.
+*/
+class ThreadPool final
+{
+public:
+	/**
+	If threadCount is negative, one worker per hardware thread minus one
+	(for the calling thread) is created.
+	*/
+	explicit ThreadPool (int threadCount = -1);
+	~ThreadPool ();
+
+	ThreadPool (const ThreadPool&) = delete;
+	ThreadPool& operator= (const ThreadPool&) = delete;
+
+	/**
+	Invoke function (i) for all i in [0, count), and return once all
+	invocations have finished. Indices are handed out dynamically, so the
+	work items may have uneven cost.
+
+	If function throws, no further indices are handed out, and the first
+	exception is rethrown on the calling thread once all invocations which
+	already started have finished. Calls from within a ParallelFor or a
+	task of the same pool run inline on the calling thread.
+	*/
+	void ParallelFor (const int count, const std::function<void (int)>& function);
+
+	/**
+	Run function on a worker and return a future for its result, which
+	also receives any exception it throws. Workers prefer ParallelFor work
+	over tasks, so tasks do not delay the frame. Without workers, function
+	runs right away on the calling thread. Tasks which are still queued
+	when the pool is destroyed run before the workers exit.
+	*/
+	template <typename Function>
+	auto Submit (Function function) -> std::future<decltype (function ())>
+	{
+		typedef decltype (function ()) Result;
+
+		// std::function needs a copyable target, the task is move-only
+		const auto task = std::make_shared<std::packaged_task<Result ()>> (
+			std::move (function));
+		auto result = task->get_future ();
+		Enqueue ([task] () { (*task) (); });
+
+		return result;
+	}
+
+	/**
+	Number of threads which execute work in ParallelFor, including the
+	calling thread.
+	*/
+	int GetConcurrency () const
+	{
+		return static_cast<int> (workers_.size ()) + 1;
+	}
+
+private:
+	struct Job
+	{
+		const std::function<void (int)>* function = nullptr;
+		std::atomic<int> next;
+		int count = 0;
+
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	};
+
+	void WorkerMain ();
+	void Enqueue (std::function<void ()> task);
+	static void Execute (Job& job);
+
+	std::vector<std::thread> workers_;
+
+	std::mutex mutex_;
+	std::condition_variable wakeWorkers_;
+	std::condition_variable jobDone_;
+	Job* currentJob_ = nullptr;
+	std::deque<std::function<void ()>> tasks_;
+	std::uint64_t jobGeneration_ = 0;
+	int activeWorkers_ = 0;
+	bool shutdown_ = false;
+
+	// Serializes concurrent ParallelFor calls from different threads
+	std::mutex submitMutex_;
+};
+}
+
+#endif
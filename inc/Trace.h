@@ -0,0 +1,162 @@
+#ifndef ANTERU_D3D12_SAMPLE_TRACE_H_
+#define ANTERU_D3D12_SAMPLE_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+enum class TraceEventType : std::uint8_t
+{
+	Begin,
+	End,
+	Instant,
+	Counter
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+A single trace event. Names must be string literals or otherwise outlive
+the tracer, as only the pointers are stored.
+*/
+struct TraceEvent
+{
+	const char* name;
+	const char* argNames [2];
+	std::int64_t argValues [2];
+	std::int64_t timestamp;
+	std::uint32_t threadId;
+	TraceEventType type;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Timeline tracing which can stay compiled into production builds.
+
+Every thread writes into its own lock-free ring buffer, so recording an
+event is a timestamp and a few stores. A background thread periodically
+moves events from the ring buffers into a central list, from which they
+can be exported as Chrome trace-event JSON, which can be loaded into
+chrome://tracing or Perfetto. If a ring buffer runs full because the
+flusher cannot keep up, new events are dropped and counted.
+
+While tracing is stopped, recording an event costs one relaxed load.
+*/
+class Tracer final
+{
+public:
+	/**
+	Start recording. If flushInterval is positive, a background thread
+	drains the per-thread buffers every flushInterval milliseconds.
+	*/
+	static void Start (const int flushInterval = 10);
+
+	/**
+	Stop recording and the background flusher. Recorded events are kept
+	until Clear is called.
+	*/
+	static void Stop ();
+
+	static void Clear ();
+
+	static bool IsEnabled ()
+	{
+		return enabled_.load (std::memory_order_relaxed);
+	}
+
+	/**
+	Name the calling thread in the exported trace.
+	*/
+	static void SetThreadName (const char* name);
+
+	static void Record (const TraceEventType type, const char* name,
+		const char* argName0 = nullptr, const std::int64_t argValue0 = 0,
+		const char* argName1 = nullptr, const std::int64_t argValue1 = 0)
+	{
+		if (IsEnabled ()) {
+			RecordImpl (type, name, argName0, argValue0, argName1, argValue1);
+		}
+	}
+
+	/**
+	Record an event with a timestamp the caller has taken already, which
+	saves reading the clock again. timestamp is in nanoseconds of
+	std::chrono::steady_clock.
+	*/
+	static void RecordAt (const std::int64_t timestamp,
+		const TraceEventType type, const char* name)
+	{
+		if (IsEnabled ()) {
+			RecordAtImpl (timestamp, type, name);
+		}
+	}
+
+	/**
+	Move all pending events out of the per-thread buffers.
+	*/
+	static void Flush ();
+
+	/**
+	Number of events which were lost because a buffer was full.
+	*/
+	static std::uint64_t GetDroppedEventCount ();
+
+	static void WriteChromeTrace (std::ostream& output);
+	static bool WriteChromeTrace (const char* filename);
+
+private:
+	static void RecordImpl (const TraceEventType type, const char* name,
+		const char* argName0, const std::int64_t argValue0,
+		const char* argName1, const std::int64_t argValue1);
+	static void RecordAtImpl (const std::int64_t timestamp,
+		const TraceEventType type, const char* name);
+
+	static std::atomic<bool> enabled_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Records a begin event on construction and an end event on destruction.
+*/
+class TraceScope final
+{
+public:
+	explicit TraceScope (const char* name,
+		const char* argName0 = nullptr, const std::int64_t argValue0 = 0,
+		const char* argName1 = nullptr, const std::int64_t argValue1 = 0)
+		: name_ (name)
+	{
+		Tracer::Record (TraceEventType::Begin, name,
+			argName0, argValue0, argName1, argValue1);
+	}
+
+	~TraceScope ()
+	{
+		Tracer::Record (TraceEventType::End, name_);
+	}
+
+	TraceScope (const TraceScope&) = delete;
+	TraceScope& operator= (const TraceScope&) = delete;
+
+private:
+	const char* name_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+inline void TraceInstant (const char* name,
+	const char* argName0 = nullptr, const std::int64_t argValue0 = 0,
+	const char* argName1 = nullptr, const std::int64_t argValue1 = 0)
+{
+	Tracer::Record (TraceEventType::Instant, name,
+		argName0, argValue0, argName1, argValue1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void TraceCounter (const char* name, const std::int64_t value)
+{
+	Tracer::Record (TraceEventType::Counter, name, name, value);
+}
+}
+
+#endif
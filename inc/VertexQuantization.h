@@ -0,0 +1,132 @@
+#ifndef ANTERU_D3D12_SAMPLE_VERTEXQUANTIZATION_H_
+#define ANTERU_D3D12_SAMPLE_VERTEXQUANTIZATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+enum class PositionEncoding
+{
+	// R32G32B32_Float, 12 bytes
+	Float,
+	// R16G16B16A16_UNorm relative to the bounds of the mesh, 8 bytes. The
+	// fourth component holds the handedness of the tangent
+	UNorm16
+};
+
+enum class UvEncoding
+{
+	// R32G32_Float, 8 bytes
+	Float,
+	// R16G16_Float, 4 bytes. Exact for texture coordinates which are
+	// multiples of 1/1024 in [-2,2]
+	Half,
+	// R16G16_UNorm relative to the bounds of the texture coordinates, 4
+	// bytes
+	UNorm16
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Which attributes are stored, and how. Normals and tangents are only
+stored on request, as octahedral R16G16_SNorm, 4 bytes each, see
+EncodeOctahedral.
+*/
+struct VertexFormat
+{
+	PositionEncoding position = PositionEncoding::UNorm16;
+	UvEncoding uv = UvEncoding::UNorm16;
+	bool normals = false;
+	// Requires UNorm16 positions, which hold the handedness
+	bool tangents = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Input layout of vertices in format, with the semantics POSITION, NORMAL,
+TANGENT and TEXCOORD, in this order, interleaved in a single buffer.
+*/
+std::vector<InputElement> GetInputLayout (const VertexFormat& format);
+
+/**
+Size of a vertex in format, in bytes.
+*/
+int GetVertexStride (const VertexFormat& format);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Interleaved vertex data, see GetInputLayout.
+
+Shaders decode the position as position.xyz * positionScale +
+positionOffset, and the texture coordinate as uv * uvScale + uvOffset. For
+unquantized attributes, the scale is 1 and the offset is 0. The handedness
+of the tangent is position.w * 2 - 1.
+*/
+struct QuantizedVertices
+{
+	VertexFormat format;
+	std::vector<std::uint8_t> data;
+	int stride;
+
+	float positionScale [3];
+	float positionOffset [3];
+	float uvScale [2];
+	float uvOffset [2];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Quantize vertices into format. UNorm16 positions and texture coordinates
+are scaled to the bounds of all vertices per axis, so the error is at
+most 1/131070 of the extent of the mesh along each axis. Normals and
+tangents are expected to be normalized.
+
+Positions and normals are converted with SSE2 where available. Throws if
+format asks for tangents without UNorm16 positions.
+*/
+QuantizedVertices QuantizeVertices (const std::vector<MeshVertex>& vertices,
+	const VertexFormat& format);
+
+/**
+Decode a vertex like the shader does. Attributes which are not stored are
+0, the tangent w is 1 without tangents.
+*/
+MeshVertex DecodeVertex (const QuantizedVertices& vertices, const std::size_t index);
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Encode a unit vector into two components in [-1,1] by projecting it onto
+an octahedron and folding the lower half over the upper one. The error is
+below 0.005 degrees at 16 bits. See Cigolle et al., "A Survey of Efficient
+Representations for Independent Unit Vectors", 2014.
+*/
+void EncodeOctahedral (const float* vector, float* encoded);
+void DecodeOctahedral (const float* encoded, float* vector);
+
+///////////////////////////////////////////////////////////////////////////////
+struct QuantizationError
+{
+	// Distance between original and decoded position, relative to the
+	// diagonal of the bounds of the mesh
+	float maxPosition;
+	float rmsPosition;
+	float maxUv;
+	// Angle between original and decoded vector, in degrees
+	float maxNormal;
+	float maxTangent;
+};
+
+/**
+Compare the decoded vertices against the ones they were quantized from.
+Attributes which are not stored count as error-free.
+*/
+QuantizationError MeasureQuantizationError (const std::vector<MeshVertex>& vertices,
+	const QuantizedVertices& quantized);
+}
+
+#endif
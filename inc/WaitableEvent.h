@@ -0,0 +1,176 @@
+#ifndef ANTERU_D3D12_SAMPLE_WAITABLEEVENT_H_
+#define ANTERU_D3D12_SAMPLE_WAITABLEEVENT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(__linux__)
+#include <condition_variable>
+#endif
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Auto-reset event. A Signal wakes up at most one waiter; if nobody is
+waiting, the event stays signaled until the next Wait.
+
+Implemented with a Win32 event on Windows, so it can be passed to APIs such
+as ID3D12Fence::SetEventOnCompletion, and with a futex on Linux.
+*/
+class WaitableEvent final
+{
+public:
+	WaitableEvent ();
+	~WaitableEvent ();
+
+	WaitableEvent (const WaitableEvent&) = delete;
+	WaitableEvent& operator= (const WaitableEvent&) = delete;
+
+	void Signal ();
+	void Wait ();
+
+#ifdef _WIN32
+	/**
+	The HANDLE of the underlying Win32 event.
+	*/
+	void* GetNativeHandle () const
+	{
+		return handle_;
+	}
+#endif
+
+private:
+#if defined(_WIN32)
+	void* handle_;
+#elif defined(__linux__)
+	std::atomic<std::uint32_t> state_;
+	std::atomic<std::uint32_t> waiters_;
+#else
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	bool signaled_ = false;
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+A monotonically increasing 64-bit value, for instance a GPU fence which is
+signaled with increasing values as work completes.
+*/
+class ITimeline
+{
+public:
+	ITimeline () = default;
+	ITimeline (const ITimeline&) = delete;
+	ITimeline& operator= (const ITimeline&) = delete;
+
+	virtual ~ITimeline ();
+
+	virtual std::uint64_t GetCompletedValue () const = 0;
+
+	/**
+	Signal event once the timeline reaches value, or right away if it has
+	already. The event must stay alive until it has been signaled, or the
+	request has been cancelled with CancelEventOnCompletion.
+	*/
+	virtual void SetEventOnCompletion (const std::uint64_t value,
+		WaitableEvent& event) = 0;
+
+	/**
+	Remove all requests to signal event which are still pending. The event
+	may have been signaled already.
+	*/
+	virtual void CancelEventOnCompletion (WaitableEvent& event) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Timeline which is advanced from the CPU, for instance by a thread that
+simulates a GPU queue.
+*/
+class CpuTimeline final : public ITimeline
+{
+public:
+	explicit CpuTimeline (const std::uint64_t initialValue = 0);
+
+	/**
+	Waiters can see the new value before Signal has returned, so the
+	destructor waits for a Signal call that is still in progress.
+	*/
+	~CpuTimeline ();
+
+	std::uint64_t GetCompletedValue () const override;
+	void SetEventOnCompletion (const std::uint64_t value,
+		WaitableEvent& event) override;
+	void CancelEventOnCompletion (WaitableEvent& event) override;
+
+	/**
+	Advance the timeline to value and signal all events waiting for it.
+	Values lower than the current one are ignored.
+	*/
+	void Signal (const std::uint64_t value);
+
+private:
+	struct PendingEvent
+	{
+		std::uint64_t value;
+		WaitableEvent* event;
+	};
+
+	std::atomic<std::uint64_t> completedValue_;
+	std::mutex mutex_;
+	std::vector<PendingEvent> pendingEvents_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+enum class WaitStrategy
+{
+	// Go to sleep right away
+	Block,
+	// Poll the timeline until the value is reached, never sleep
+	Spin,
+	// Poll for a while, then go to sleep. Best for waits which are usually
+	// short but occasionally long
+	SpinThenBlock
+};
+
+struct TimelineWait
+{
+	ITimeline* timeline;
+	std::uint64_t value;
+};
+
+static const int DEFAULT_WAIT_SPIN_COUNT = 4096;
+
+/**
+Wait until timeline reaches value. event is only used if the strategy
+needs to block.
+*/
+void WaitForValue (ITimeline& timeline, const std::uint64_t value,
+	WaitableEvent& event,
+	const WaitStrategy strategy = WaitStrategy::SpinThenBlock,
+	const int spinCount = DEFAULT_WAIT_SPIN_COUNT);
+
+/**
+Wait until every timeline has reached its value.
+*/
+void WaitForAll (const TimelineWait* waits, const int count,
+	WaitableEvent& event,
+	const WaitStrategy strategy = WaitStrategy::SpinThenBlock,
+	const int spinCount = DEFAULT_WAIT_SPIN_COUNT);
+
+/**
+Wait until at least one timeline has reached its value and return the index
+of one which did. The event is removed from all timelines before returning,
+but may be left signaled. All waits re-check their condition after waking
+up, so this only results in a spurious wake-up.
+*/
+int WaitForAny (const TimelineWait* waits, const int count,
+	WaitableEvent& event,
+	const WaitStrategy strategy = WaitStrategy::SpinThenBlock,
+	const int spinCount = DEFAULT_WAIT_SPIN_COUNT);
+}
+
+#endif
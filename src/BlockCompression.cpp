@@ -0,0 +1,526 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace anteru {
+namespace {
+const int BLOCK_PIXEL_COUNT = 16;
+const int POWER_ITERATIONS = 8;
+const int REFINE_ITERATIONS = 2;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Expand a 5 or 6-bit value to 8 bits by replicating the top bits.
+*/
+int ExpandBits (const int value, const int bits)
+{
+	return (value << (8 - bits)) | (value >> (2 * bits - 8));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Expand565 (const std::uint16_t color, int* rgb)
+{
+	const int r = (color >> 11) & 31;
+	const int g = (color >> 5) & 63;
+	const int b = color & 31;
+
+	rgb [0] = (r << 3) | (r >> 2);
+	rgb [1] = (g << 2) | (g >> 4);
+	rgb [2] = (b << 3) | (b >> 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint16_t Quantize565 (const float* rgb)
+{
+	const auto quantize = [] (const float value, const int maximum) {
+		const float scaled = std::round (value * maximum / 255.0f);
+		return static_cast<int> (std::min (std::max (scaled, 0.0f),
+			static_cast<float> (maximum)));
+	};
+
+	return static_cast<std::uint16_t> ((quantize (rgb [0], 31) << 11) |
+		(quantize (rgb [1], 63) << 5) | quantize (rgb [2], 31));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Optimal endpoints for blocks of a single color, like the tables of stb_dxt
+and other BC1 encoders: for each 8-bit value, the pair of 5 or 6-bit
+endpoints whose 2/3 : 1/3 interpolation comes closest to it. Many values
+are only exact between two endpoints, 77 for instance is 2/3 * 74 +
+1/3 * 82 with 5 bits.
+*/
+struct SingleColorTables
+{
+	SingleColorTables ()
+	{
+		Build (5, endpoints5);
+		Build (6, endpoints6);
+	}
+
+	static void Build (const int bits, std::uint8_t endpoints [256][2])
+	{
+		for (int value = 0; value < 256; ++value) {
+			int bestError = 0x7FFFFFFF;
+
+			for (int a = 0; a < (1 << bits); ++a) {
+				for (int b = 0; b < (1 << bits); ++b) {
+					const int expandedA = ExpandBits (a, bits);
+					const int expandedB = ExpandBits (b, bits);
+
+					// Ties go to the closest endpoints, where hardware which
+					// interpolates slightly differently deviates least
+					const int error = 256 * std::abs ((2 * expandedA + expandedB + 1) / 3 - value) +
+						std::abs (expandedA - expandedB);
+
+					if (error < bestError) {
+						bestError = error;
+						endpoints [value][0] = static_cast<std::uint8_t> (a);
+						endpoints [value][1] = static_cast<std::uint8_t> (b);
+					}
+				}
+			}
+		}
+	}
+
+	std::uint8_t endpoints5 [256][2];
+	std::uint8_t endpoints6 [256][2];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+const SingleColorTables& GetSingleColorTables ()
+{
+	static const SingleColorTables tables;
+	return tables;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The colors a BC1 block can represent. With color0 <= color1, the block
+uses three colors plus transparent black, unless fourColors is set, as for
+the color part of BC3 blocks.
+*/
+void BuildColorPalette (const std::uint16_t color0, const std::uint16_t color1,
+	const bool fourColors, int palette [4][4])
+{
+	Expand565 (color0, palette [0]);
+	Expand565 (color1, palette [1]);
+	palette [0][3] = palette [1][3] = 255;
+
+	if (fourColors || color0 > color1) {
+		for (int c = 0; c < 3; ++c) {
+			palette [2][c] = (2 * palette [0][c] + palette [1][c] + 1) / 3;
+			palette [3][c] = (palette [0][c] + 2 * palette [1][c] + 1) / 3;
+		}
+		palette [2][3] = palette [3][3] = 255;
+	} else {
+		for (int c = 0; c < 3; ++c) {
+			palette [2][c] = (palette [0][c] + palette [1][c] + 1) / 2;
+			palette [3][c] = 0;
+		}
+		palette [2][3] = 255;
+		palette [3][3] = 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Pick the closest palette entry for each pixel. Returns the squared error,
+indices holds two bits per pixel, the first pixel in the lowest bits.
+*/
+int SelectColorIndices (const std::uint8_t* pixels, const int palette [4][4],
+	const int paletteSize, std::uint32_t& indices)
+{
+	int error = 0;
+	indices = 0;
+
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i) {
+		const auto pixel = pixels + 4 * i;
+
+		int bestIndex = 0;
+		int bestError = 0x7FFFFFFF;
+		for (int j = 0; j < paletteSize; ++j) {
+			int e = 0;
+			for (int c = 0; c < 3; ++c) {
+				const int d = pixel [c] - palette [j][c];
+				e += d * d;
+			}
+
+			if (e < bestError) {
+				bestError = e;
+				bestIndex = j;
+			}
+		}
+
+		error += bestError;
+		indices |= static_cast<std::uint32_t> (bestIndex) << (2 * i);
+	}
+
+	return error;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Evaluate a pair of endpoints in the four color mode. The endpoints are
+swapped if necessary, if both are equal, only the first entry is used.
+*/
+int EvaluateEndpoints (const std::uint8_t* pixels, std::uint16_t color0,
+	std::uint16_t color1, std::uint16_t& outColor0, std::uint16_t& outColor1,
+	std::uint32_t& indices)
+{
+	if (color0 < color1) {
+		std::swap (color0, color1);
+	}
+
+	int palette [4][4];
+	BuildColorPalette (color0, color1, false, palette);
+
+	outColor0 = color0;
+	outColor1 = color1;
+	return SelectColorIndices (pixels, palette, color0 == color1 ? 1 : 4, indices);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Endpoints which minimize the squared error for fixed indices, by solving
+the normal equations of sum |w_i * a + (1 - w_i) * b - x_i|^2.
+*/
+bool SolveEndpoints (const std::uint8_t* pixels, const std::uint32_t indices,
+	float* endpoint0, float* endpoint1)
+{
+	static const float WEIGHTS [4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	float aa = 0, ab = 0, bb = 0;
+	float ax [3] = {}, bx [3] = {};
+
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i) {
+		const float w = WEIGHTS [(indices >> (2 * i)) & 3];
+		const float v = 1 - w;
+
+		aa += w * w;
+		ab += w * v;
+		bb += v * v;
+
+		for (int c = 0; c < 3; ++c) {
+			ax [c] += w * pixels [4 * i + c];
+			bx [c] += v * pixels [4 * i + c];
+		}
+	}
+
+	const float determinant = aa * bb - ab * ab;
+	if (std::abs (determinant) < 1e-6f) {
+		return false;
+	}
+
+	for (int c = 0; c < 3; ++c) {
+		endpoint0 [c] = (ax [c] * bb - bx [c] * ab) / determinant;
+		endpoint1 [c] = (bx [c] * aa - ax [c] * ab) / determinant;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WriteColorBlock (const std::uint16_t color0, const std::uint16_t color1,
+	const std::uint32_t indices, std::uint8_t* block)
+{
+	block [0] = static_cast<std::uint8_t> (color0);
+	block [1] = static_cast<std::uint8_t> (color0 >> 8);
+	block [2] = static_cast<std::uint8_t> (color1);
+	block [3] = static_cast<std::uint8_t> (color1 >> 8);
+	for (int i = 0; i < 4; ++i) {
+		block [4 + i] = static_cast<std::uint8_t> (indices >> (8 * i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Endpoints are found along the principal axis of the colors, and then
+refined with a least squares fit for the chosen indices. Blocks of a single
+color use the optimal single color endpoints instead.
+*/
+int EncodeColorBlock (const std::uint8_t* pixels, std::uint8_t* block)
+{
+	float mean [3] = {};
+	int minimum [3] = { 255, 255, 255 }, maximum [3] = {};
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			mean [c] += pixels [4 * i + c];
+			minimum [c] = std::min<int> (minimum [c], pixels [4 * i + c]);
+			maximum [c] = std::max<int> (maximum [c], pixels [4 * i + c]);
+		}
+	}
+
+	std::uint16_t color0, color1;
+	std::uint32_t indices;
+
+	if (minimum [0] == maximum [0] && minimum [1] == maximum [1] &&
+		minimum [2] == maximum [2]) {
+		const auto& tables = GetSingleColorTables ();
+		const auto r = tables.endpoints5 [minimum [0]];
+		const auto g = tables.endpoints6 [minimum [1]];
+		const auto b = tables.endpoints5 [minimum [2]];
+
+		// Evaluating picks the interpolated color for every pixel, or an
+		// endpoint if it is just as close
+		const int error = EvaluateEndpoints (pixels,
+			static_cast<std::uint16_t> ((r [0] << 11) | (g [0] << 5) | b [0]),
+			static_cast<std::uint16_t> ((r [1] << 11) | (g [1] << 5) | b [1]),
+			color0, color1, indices);
+		WriteColorBlock (color0, color1, indices, block);
+		return error;
+	}
+
+	for (int c = 0; c < 3; ++c) {
+		mean [c] /= BLOCK_PIXEL_COUNT;
+	}
+
+	float covariance [6] = {};
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i) {
+		const float r = pixels [4 * i + 0] - mean [0];
+		const float g = pixels [4 * i + 1] - mean [1];
+		const float b = pixels [4 * i + 2] - mean [2];
+
+		covariance [0] += r * r;
+		covariance [1] += r * g;
+		covariance [2] += r * b;
+		covariance [3] += g * g;
+		covariance [4] += g * b;
+		covariance [5] += b * b;
+	}
+
+	float axis [3] = {
+		static_cast<float> (maximum [0] - minimum [0]),
+		static_cast<float> (maximum [1] - minimum [1]),
+		static_cast<float> (maximum [2] - minimum [2])
+	};
+
+	for (int i = 0; i < POWER_ITERATIONS; ++i) {
+		const float x = axis [0] * covariance [0] + axis [1] * covariance [1] + axis [2] * covariance [2];
+		const float y = axis [0] * covariance [1] + axis [1] * covariance [3] + axis [2] * covariance [4];
+		const float z = axis [0] * covariance [2] + axis [1] * covariance [4] + axis [2] * covariance [5];
+
+		const float length = std::max (std::max (std::abs (x), std::abs (y)), std::abs (z));
+		if (length < 1e-6f) {
+			break;
+		}
+
+		axis [0] = x / length;
+		axis [1] = y / length;
+		axis [2] = z / length;
+	}
+
+	// The axis starts at the extent of the block, which is not zero as solid
+	// blocks are handled above, and a power iteration never shrinks it to zero
+	const float axisLength = std::sqrt (axis [0] * axis [0] +
+		axis [1] * axis [1] + axis [2] * axis [2]);
+	for (int c = 0; c < 3; ++c) {
+		axis [c] /= axisLength;
+	}
+
+	float minimumT = 0, maximumT = 0;
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i) {
+		float t = 0;
+		for (int c = 0; c < 3; ++c) {
+			t += (pixels [4 * i + c] - mean [c]) * axis [c];
+		}
+
+		minimumT = std::min (minimumT, t);
+		maximumT = std::max (maximumT, t);
+	}
+
+	float endpoint0 [3], endpoint1 [3];
+	for (int c = 0; c < 3; ++c) {
+		endpoint0 [c] = mean [c] + axis [c] * maximumT;
+		endpoint1 [c] = mean [c] + axis [c] * minimumT;
+	}
+
+	int error = EvaluateEndpoints (pixels, Quantize565 (endpoint0),
+		Quantize565 (endpoint1), color0, color1, indices);
+
+	for (int i = 0; i < REFINE_ITERATIONS && error > 0; ++i) {
+		if (! SolveEndpoints (pixels, indices, endpoint0, endpoint1)) {
+			break;
+		}
+
+		std::uint16_t refined0, refined1;
+		std::uint32_t refinedIndices;
+		const int refinedError = EvaluateEndpoints (pixels, Quantize565 (endpoint0),
+			Quantize565 (endpoint1), refined0, refined1, refinedIndices);
+
+		if (refinedError >= error) {
+			break;
+		}
+
+		error = refinedError;
+		color0 = refined0;
+		color1 = refined1;
+		indices = refinedIndices;
+	}
+
+	WriteColorBlock (color0, color1, indices, block);
+	return error;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The alpha values a BC3 block can represent. With alpha0 <= alpha1, six
+interpolated values are followed by 0 and 255.
+*/
+void BuildAlphaPalette (const int alpha0, const int alpha1, int palette [8])
+{
+	palette [0] = alpha0;
+	palette [1] = alpha1;
+
+	if (alpha0 > alpha1) {
+		for (int i = 1; i < 7; ++i) {
+			palette [i + 1] = ((7 - i) * alpha0 + i * alpha1 + 3) / 7;
+		}
+	} else {
+		for (int i = 1; i < 5; ++i) {
+			palette [i + 1] = ((5 - i) * alpha0 + i * alpha1 + 2) / 5;
+		}
+		palette [6] = 0;
+		palette [7] = 255;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int SelectAlphaIndices (const std::uint8_t* pixels, const int alpha0,
+	const int alpha1, std::uint64_t& indices)
+{
+	int palette [8];
+	BuildAlphaPalette (alpha0, alpha1, palette);
+
+	int error = 0;
+	indices = 0;
+
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i) {
+		const int alpha = pixels [4 * i + 3];
+
+		int bestIndex = 0;
+		int bestError = 0x7FFFFFFF;
+		for (int j = 0; j < 8; ++j) {
+			const int e = (alpha - palette [j]) * (alpha - palette [j]);
+			if (e < bestError) {
+				bestError = e;
+				bestIndex = j;
+			}
+		}
+
+		error += bestError;
+		indices |= static_cast<std::uint64_t> (bestIndex) << (3 * i);
+	}
+
+	return error;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Use the eight value mode over the full range, unless the block contains
+0 or 255, in which case the six value mode spanning the remaining values
+may be more precise.
+*/
+int EncodeAlphaBlock (const std::uint8_t* pixels, std::uint8_t* block)
+{
+	int minimum = 255, maximum = 0;
+	int innerMinimum = 255, innerMaximum = 0;
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i) {
+		const int alpha = pixels [4 * i + 3];
+		minimum = std::min (minimum, alpha);
+		maximum = std::max (maximum, alpha);
+
+		if (alpha != 0 && alpha != 255) {
+			innerMinimum = std::min (innerMinimum, alpha);
+			innerMaximum = std::max (innerMaximum, alpha);
+		}
+	}
+
+	int alpha0 = maximum, alpha1 = minimum;
+	std::uint64_t indices;
+	int error = SelectAlphaIndices (pixels, alpha0, alpha1, indices);
+
+	if (error > 0 && (minimum == 0 || maximum == 255)) {
+		if (innerMinimum > innerMaximum) {
+			innerMinimum = innerMaximum = 0;
+		}
+
+		std::uint64_t innerIndices;
+		const int innerError = SelectAlphaIndices (pixels, innerMinimum,
+			innerMaximum, innerIndices);
+
+		if (innerError < error) {
+			error = innerError;
+			alpha0 = innerMinimum;
+			alpha1 = innerMaximum;
+			indices = innerIndices;
+		}
+	}
+
+	block [0] = static_cast<std::uint8_t> (alpha0);
+	block [1] = static_cast<std::uint8_t> (alpha1);
+	for (int i = 0; i < 6; ++i) {
+		block [2 + i] = static_cast<std::uint8_t> (indices >> (8 * i));
+	}
+
+	return error;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DecodeColorBlock (const std::uint8_t* block, const bool fourColors,
+	std::uint8_t* pixels)
+{
+	const auto color0 = static_cast<std::uint16_t> (block [0] | (block [1] << 8));
+	const auto color1 = static_cast<std::uint16_t> (block [2] | (block [3] << 8));
+
+	int palette [4][4];
+	BuildColorPalette (color0, color1, fourColors, palette);
+
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i) {
+		const int index = (block [4 + i / 4] >> (2 * (i % 4))) & 3;
+		for (int c = 0; c < 4; ++c) {
+			pixels [4 * i + c] = static_cast<std::uint8_t> (palette [index][c]);
+		}
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int EncodeBc1Block (const std::uint8_t* pixels, std::uint8_t* block)
+{
+	return EncodeColorBlock (pixels, block);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int EncodeBc3Block (const std::uint8_t* pixels, std::uint8_t* block)
+{
+	const int alphaError = EncodeAlphaBlock (pixels, block);
+	return alphaError + EncodeColorBlock (pixels, block + 8);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DecodeBc1Block (const std::uint8_t* block, std::uint8_t* pixels)
+{
+	DecodeColorBlock (block, false, pixels);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DecodeBc3Block (const std::uint8_t* block, std::uint8_t* pixels)
+{
+	DecodeColorBlock (block + 8, true, pixels);
+
+	int palette [8];
+	BuildAlphaPalette (block [0], block [1], palette);
+
+	std::uint64_t indices = 0;
+	for (int i = 0; i < 6; ++i) {
+		indices |= static_cast<std::uint64_t> (block [2 + i]) << (8 * i);
+	}
+
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i) {
+		pixels [4 * i + 3] = static_cast<std::uint8_t> (palette [(indices >> (3 * i)) & 7]);
+	}
+}
+}
@@ -0,0 +1,97 @@
+#include "BundleCache.h"
+
+#include <algorithm>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+BundleCache::BundleCache (IRenderDevice& device, const int maxUnusedFrames)
+	: device_ (device)
+	, maxUnusedFrames_ (maxUnusedFrames)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+BundleCache::~BundleCache ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BundleCache::BeginFrame (const std::uint64_t frameFenceValue,
+	const std::uint64_t completedFenceValue)
+{
+	++frame_;
+	frameFenceValue_ = frameFenceValue;
+
+	for (auto it = bundles_.begin (); it != bundles_.end ();) {
+		if (frame_ - it->second.lastUsedFrame > static_cast<std::uint64_t> (maxUnusedFrames_)) {
+			Retire (it->second);
+			it = bundles_.erase (it);
+		} else {
+			++it;
+		}
+	}
+
+	retiredBundles_.erase (std::remove_if (retiredBundles_.begin (),
+		retiredBundles_.end (), [=] (const RetiredBundle& bundle) {
+		return bundle.fenceValue <= completedFenceValue;
+	}), retiredBundles_.end ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ICommandList* BundleCache::Get (const std::uint64_t key,
+	const std::vector<const void*>& dependencies,
+	const RecordFunction& record)
+{
+	auto it = bundles_.find (key);
+	if (it != bundles_.end () && it->second.dependencies != dependencies) {
+		// May still be in use by a frame in flight
+		Retire (it->second);
+		bundles_.erase (it);
+		it = bundles_.end ();
+	}
+
+	if (it == bundles_.end ()) {
+		Bundle bundle;
+		bundle.commandList = device_.CreateCommandList (CommandListType::Bundle);
+		bundle.dependencies = dependencies;
+
+		bundle.commandList->Reset ();
+		record (bundle.commandList.get ());
+		bundle.commandList->Close ();
+		++recordCount_;
+
+		it = bundles_.emplace (key, std::move (bundle)).first;
+	}
+
+	it->second.lastUsedFrame = frame_;
+	it->second.lastUsedFenceValue = frameFenceValue_;
+
+	return it->second.commandList.get ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BundleCache::Invalidate (const void* object)
+{
+	// Retiring the bundles right away, instead of remembering a version
+	// per object, means an object created at the same address later on
+	// can't match a bundle recorded for the old one
+	for (auto it = bundles_.begin (); it != bundles_.end ();) {
+		const auto& dependencies = it->second.dependencies;
+		if (std::find (dependencies.begin (), dependencies.end (), object) != dependencies.end ()) {
+			Retire (it->second);
+			it = bundles_.erase (it);
+		} else {
+			++it;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BundleCache::Retire (Bundle& bundle)
+{
+	RetiredBundle retired;
+	retired.commandList = std::move (bundle.commandList);
+	retired.fenceValue = bundle.lastUsedFenceValue;
+	retiredBundles_.push_back (std::move (retired));
+}
+}
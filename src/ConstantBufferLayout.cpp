@@ -0,0 +1,75 @@
+#include "ConstantBufferLayout.h"
+
+#include "Simd.h"
+
+namespace anteru {
+namespace {
+// The packing rules from the HLSL documentation, checked on a few layouts.
+// tools/cbufferLayout.py must agree with these.
+using namespace hlsl;
+
+using Packed = ConstantBufferLayout<float4, float2, float2>;
+static_assert (Packed::GetOffset (1) == 16 && Packed::GetOffset (2) == 24 &&
+	Packed::SIZE == 32, "Vectors must share a register");
+
+using Straddling = ConstantBufferLayout<float2, float4, float2>;
+static_assert (Straddling::GetOffset (1) == 16 && Straddling::GetOffset (2) == 32 &&
+	Straddling::SIZE == 48, "Vectors must not straddle a register boundary");
+
+using Scalars = ConstantBufferLayout<float3, float, float, float2>;
+static_assert (Scalars::GetOffset (1) == 12 && Scalars::GetOffset (2) == 16 &&
+	Scalars::GetOffset (3) == 20 && Scalars::SIZE == 32,
+	"Scalars must fill up registers");
+
+using Arrays = ConstantBufferLayout<float, Array<float, 4>, float>;
+static_assert (Arrays::GetOffset (1) == 16 && Arrays::GetOffset (2) == 68 &&
+	Arrays::SIZE == 80, "Array elements must start a register each");
+
+using Matrices = ConstantBufferLayout<float, float3x4, float,
+	Matrix<float, 3, 4, true>, float2>;
+static_assert (Matrices::GetOffset (1) == 16 && Matrices::GetOffset (2) == 76 &&
+	Matrices::GetOffset (3) == 80 && Matrices::GetOffset (4) == 128 &&
+	Matrices::SIZE == 144, "Matrices must use one register per column");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WriteConstantBuffer (void* destination, const void* source,
+	const std::size_t size)
+{
+	auto output = static_cast<std::uint8_t*> (destination);
+	auto input = static_cast<const std::uint8_t*> (source);
+
+#if ANTERU_SSE2
+	// Streaming stores bypass the cache and fill the write-combining
+	// buffers in order, but require an aligned destination. They are
+	// weakly ordered, see FlushConstantBufferWrites
+	if (reinterpret_cast<std::uintptr_t> (output) % 16 == 0) {
+		for (std::size_t i = 0; i < size; i += 16) {
+			_mm_stream_si128 (reinterpret_cast<__m128i*> (output + i),
+				_mm_loadu_si128 (reinterpret_cast<const __m128i*> (input + i)));
+		}
+
+		return;
+	}
+
+	for (std::size_t i = 0; i < size; i += 16) {
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (output + i),
+			_mm_loadu_si128 (reinterpret_cast<const __m128i*> (input + i)));
+	}
+#elif ANTERU_NEON
+	for (std::size_t i = 0; i < size; i += 16) {
+		vst1q_u8 (output + i, vld1q_u8 (input + i));
+	}
+#else
+	std::memcpy (output, input, size);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FlushConstantBufferWrites ()
+{
+#if ANTERU_SSE2
+	_mm_sfence ();
+#endif
+}
+}
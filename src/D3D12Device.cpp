@@ -0,0 +1,1208 @@
+#include "D3D12Device.h"
+
+#include <d3d12.h>
+#include <dxgi1_4.h>
+#include <d3dx12.h>
+#include <d3dcompiler.h>
+#include <wrl.h>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "GpuProfiler.h"
+#include "ShaderCompiler.h"
+#include "Window.h"
+
+#ifdef min
+#undef min
+#endif
+
+using namespace Microsoft::WRL;
+
+namespace anteru {
+namespace {
+// Render target views are only needed for swap chain buffers and the odd
+// offscreen target, so a small fixed heap is enough
+const int MAX_RENDER_TARGET_VIEWS = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+DXGI_FORMAT ToDxgiFormat (const PixelFormat format)
+{
+	switch (format) {
+	case PixelFormat::R8G8B8A8_UNorm: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case PixelFormat::R8G8B8A8_UNorm_sRGB: return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	case PixelFormat::R32_UInt: return DXGI_FORMAT_R32_UINT;
+	case PixelFormat::R32G32_Float: return DXGI_FORMAT_R32G32_FLOAT;
+	case PixelFormat::R32G32B32_Float: return DXGI_FORMAT_R32G32B32_FLOAT;
+	case PixelFormat::R16G16B16A16_Float: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case PixelFormat::R11G11B10_Float: return DXGI_FORMAT_R11G11B10_FLOAT;
+	case PixelFormat::R9G9B9E5_SharedExp: return DXGI_FORMAT_R9G9B9E5_SHAREDEXP;
+	case PixelFormat::R8_UNorm: return DXGI_FORMAT_R8_UNORM;
+	case PixelFormat::R8G8_UNorm: return DXGI_FORMAT_R8G8_UNORM;
+	case PixelFormat::R16G16B16A16_UNorm: return DXGI_FORMAT_R16G16B16A16_UNORM;
+	case PixelFormat::R16G16_UNorm: return DXGI_FORMAT_R16G16_UNORM;
+	case PixelFormat::R16G16_SNorm: return DXGI_FORMAT_R16G16_SNORM;
+	case PixelFormat::R16G16_Float: return DXGI_FORMAT_R16G16_FLOAT;
+	case PixelFormat::BC1_UNorm: return DXGI_FORMAT_BC1_UNORM;
+	case PixelFormat::BC1_UNorm_sRGB: return DXGI_FORMAT_BC1_UNORM_SRGB;
+	case PixelFormat::BC3_UNorm: return DXGI_FORMAT_BC3_UNORM;
+	case PixelFormat::BC3_UNorm_sRGB: return DXGI_FORMAT_BC3_UNORM_SRGB;
+	default: return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+D3D12_SHADER_COMPONENT_MAPPING ToD3D12ComponentMapping (const ComponentSource source)
+{
+	switch (source) {
+	case ComponentSource::Red:
+		return D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_0;
+	case ComponentSource::Green:
+		return D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_1;
+	case ComponentSource::Blue:
+		return D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_2;
+	case ComponentSource::Alpha:
+		return D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_3;
+	case ComponentSource::Zero:
+		return D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0;
+	default:
+		return D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+D3D12_RESOURCE_STATES ToD3D12State (const ResourceState state)
+{
+	switch (state) {
+	case ResourceState::VertexAndConstantBuffer:
+		return D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+	case ResourceState::IndexBuffer: return D3D12_RESOURCE_STATE_INDEX_BUFFER;
+	case ResourceState::RenderTarget: return D3D12_RESOURCE_STATE_RENDER_TARGET;
+	case ResourceState::PixelShaderResource:
+		return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	case ResourceState::CopyDestination: return D3D12_RESOURCE_STATE_COPY_DEST;
+	case ResourceState::CopySource: return D3D12_RESOURCE_STATE_COPY_SOURCE;
+	case ResourceState::GenericRead: return D3D12_RESOURCE_STATE_GENERIC_READ;
+	case ResourceState::Present: return D3D12_RESOURCE_STATE_PRESENT;
+	default: return D3D12_RESOURCE_STATE_COMMON;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+D3D12_SHADER_VISIBILITY ToD3D12Visibility (const ShaderVisibility visibility)
+{
+	switch (visibility) {
+	case ShaderVisibility::Vertex: return D3D12_SHADER_VISIBILITY_VERTEX;
+	case ShaderVisibility::Pixel: return D3D12_SHADER_VISIBILITY_PIXEL;
+	default: return D3D12_SHADER_VISIBILITY_ALL;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+D3D12_FILTER ToD3D12Filter (const SamplerFilter filter)
+{
+	switch (filter) {
+	case SamplerFilter::Point: return D3D12_FILTER_MIN_MAG_MIP_POINT;
+	case SamplerFilter::MinMagLinearMipPoint: return D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT;
+	default: return D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+class D3D12Resource final : public IResource
+{
+public:
+	explicit D3D12Resource (const ComPtr<ID3D12Resource>& resource)
+		: resource_ (resource)
+	{
+		renderTargetView_.ptr = 0;
+	}
+
+	void* Map () override
+	{
+		void* p = nullptr;
+		if (FAILED (resource_->Map (0, nullptr, &p))) {
+			throw std::runtime_error ("Resource mapping failed.");
+		}
+
+		return p;
+	}
+
+	void Unmap () override
+	{
+		resource_->Unmap (0, nullptr);
+	}
+
+	std::uint64_t GetGpuAddress () const override
+	{
+		return resource_->GetGPUVirtualAddress ();
+	}
+
+	ID3D12Resource* Get () const
+	{
+		return resource_.Get ();
+	}
+
+	D3D12_CPU_DESCRIPTOR_HANDLE GetRenderTargetView () const
+	{
+		return renderTargetView_;
+	}
+
+	void SetRenderTargetView (const D3D12_CPU_DESCRIPTOR_HANDLE handle)
+	{
+		renderTargetView_ = handle;
+	}
+
+private:
+	ComPtr<ID3D12Resource> resource_;
+	D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class D3D12Fence final : public IFence
+{
+public:
+	explicit D3D12Fence (const ComPtr<ID3D12Fence>& fence)
+		: fence_ (fence)
+	{
+	}
+
+	std::uint64_t GetCompletedValue () const override
+	{
+		return fence_->GetCompletedValue ();
+	}
+
+	void SetEventOnCompletion (const std::uint64_t value,
+		WaitableEvent& event) override
+	{
+		fence_->SetEventOnCompletion (value, event.GetNativeHandle ());
+	}
+
+	void CancelEventOnCompletion (WaitableEvent&) override
+	{
+		// D3D12 cannot cancel a completion event. The fence only holds the
+		// Win32 handle, so a late signal never touches freed memory; at
+		// worst, it sets an unrelated event which reuses the handle
+	}
+
+	ID3D12Fence* Get () const
+	{
+		return fence_.Get ();
+	}
+
+private:
+	ComPtr<ID3D12Fence> fence_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class D3D12DescriptorHeap final : public IDescriptorHeap
+{
+public:
+	D3D12DescriptorHeap (ID3D12Device* device, const int descriptorCount)
+		: device_ (device)
+	{
+		// This heap contains SRV, UAV or CBVs, and must be shader visible
+		// so descriptor tables can point into it
+		D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
+		descriptorHeapDesc.NumDescriptors = descriptorCount;
+		descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+		descriptorHeapDesc.NodeMask = 0;
+		descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+		if (FAILED (device->CreateDescriptorHeap (&descriptorHeapDesc,
+			IID_PPV_ARGS (&heap_)))) {
+			throw std::runtime_error ("Descriptor heap creation failed.");
+		}
+
+		descriptorSize_ = device->GetDescriptorHandleIncrementSize (
+			D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	}
+
+	void CreateShaderResourceView (const int index, IResource* texture,
+		const PixelFormat format, const ComponentMapping& mapping) override
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc = {};
+		shaderResourceViewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		shaderResourceViewDesc.Shader4ComponentMapping =
+			D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING (
+				ToD3D12ComponentMapping (mapping.red),
+				ToD3D12ComponentMapping (mapping.green),
+				ToD3D12ComponentMapping (mapping.blue),
+				ToD3D12ComponentMapping (mapping.alpha));
+		shaderResourceViewDesc.Format = ToDxgiFormat (format);
+		shaderResourceViewDesc.Texture2D.MipLevels = 1;
+		shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
+		shaderResourceViewDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle (
+			heap_->GetCPUDescriptorHandleForHeapStart (), index, descriptorSize_);
+		device_->CreateShaderResourceView (
+			static_cast<D3D12Resource*> (texture)->Get (),
+			&shaderResourceViewDesc, handle);
+	}
+
+	GpuDescriptorHandle GetGpuHandle (const int index) const override
+	{
+		GpuDescriptorHandle result;
+		result.ptr = heap_->GetGPUDescriptorHandleForHeapStart ().ptr
+			+ index * descriptorSize_;
+		return result;
+	}
+
+	ID3D12DescriptorHeap* Get () const
+	{
+		return heap_.Get ();
+	}
+
+private:
+	ID3D12Device* device_;
+	ComPtr<ID3D12DescriptorHeap> heap_;
+	UINT descriptorSize_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class D3D12RootSignature final : public IRootSignature
+{
+public:
+	D3D12RootSignature (ID3D12Device* device, const RootSignatureDesc& desc)
+		: desc_ (desc)
+	{
+		std::vector<CD3DX12_ROOT_PARAMETER> parameters (desc.parameters.size ());
+		// Descriptor tables point at their ranges, which have to stay alive
+		// until the root signature is serialized
+		std::vector<CD3DX12_DESCRIPTOR_RANGE> ranges (desc.parameters.size ());
+
+		for (std::size_t i = 0; i < desc.parameters.size (); ++i) {
+			const auto& parameter = desc.parameters [i];
+			const auto visibility = ToD3D12Visibility (parameter.visibility);
+
+			switch (parameter.type) {
+			case RootParameterType::DescriptorTable:
+				ranges [i].Init (D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+					parameter.count, parameter.shaderRegister);
+				parameters [i].InitAsDescriptorTable (1, &ranges [i], visibility);
+				break;
+
+			case RootParameterType::ConstantBufferView:
+				parameters [i].InitAsConstantBufferView (
+					parameter.shaderRegister, 0, visibility);
+				break;
+
+			case RootParameterType::Constants:
+				parameters [i].InitAsConstants (parameter.count,
+					parameter.shaderRegister, 0, visibility);
+				break;
+			}
+		}
+
+		std::vector<CD3DX12_STATIC_SAMPLER_DESC> samplers (desc.staticSamplers.size ());
+		for (std::size_t i = 0; i < desc.staticSamplers.size (); ++i) {
+			samplers [i].Init (desc.staticSamplers [i].shaderRegister,
+				ToD3D12Filter (desc.staticSamplers [i].filter));
+		}
+
+		CD3DX12_ROOT_SIGNATURE_DESC descRootSignature;
+		descRootSignature.Init (static_cast<UINT> (parameters.size ()),
+			parameters.data (),
+			static_cast<UINT> (samplers.size ()), samplers.data (),
+			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+		ComPtr<ID3DBlob> rootBlob;
+		ComPtr<ID3DBlob> errorBlob;
+		if (FAILED (D3D12SerializeRootSignature (&descRootSignature,
+			D3D_ROOT_SIGNATURE_VERSION_1, &rootBlob, &errorBlob))) {
+			throw std::runtime_error ("Root signature serialization failed.");
+		}
+
+		if (FAILED (device->CreateRootSignature (0,
+			rootBlob->GetBufferPointer (),
+			rootBlob->GetBufferSize (), IID_PPV_ARGS (&rootSignature_)))) {
+			throw std::runtime_error ("Root signature creation failed.");
+		}
+	}
+
+	const RootSignatureDesc& GetDesc () const override
+	{
+		return desc_;
+	}
+
+	ID3D12RootSignature* Get () const
+	{
+		return rootSignature_.Get ();
+	}
+
+private:
+	RootSignatureDesc desc_;
+	ComPtr<ID3D12RootSignature> rootSignature_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<D3D_SHADER_MACRO> ToD3DShaderMacros (const ShaderDesc& desc)
+{
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const auto& define : desc.defines) {
+		D3D_SHADER_MACRO macro = { define.name, define.value ? define.value : "1" };
+		macros.push_back (macro);
+	}
+
+	// The list is terminated by an empty entry
+	D3D_SHADER_MACRO end = { nullptr, nullptr };
+	macros.push_back (end);
+
+	return macros;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ReportShaderErrors (ID3DBlob* errors)
+{
+	if (errors) {
+		OutputDebugStringA (static_cast<const char*> (errors->GetBufferPointer ()));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+class D3DShaderCompiler final : public IShaderCompiler
+{
+public:
+	std::string GetVersion () const override
+	{
+		std::string version = "d3dcompiler " +
+			std::to_string (D3D_COMPILER_VERSION) +
+			" flags " + std::to_string (COMPILE_FLAGS);
+
+		// d3dcompiler_47.dll keeps its name when it is updated, so the size
+		// and time stamp of the loaded DLL identify the actual build
+		char path [MAX_PATH];
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		const auto module = GetModuleHandleA (D3DCOMPILER_DLL_A);
+		if (module && GetModuleFileNameA (module, path, MAX_PATH) &&
+			GetFileAttributesExA (path, GetFileExInfoStandard, &attributes)) {
+			version += " size " + std::to_string (attributes.nFileSizeLow) +
+				" time " + std::to_string (
+					(static_cast<std::uint64_t> (attributes.ftLastWriteTime.dwHighDateTime) << 32) |
+					attributes.ftLastWriteTime.dwLowDateTime);
+		}
+
+		return version;
+	}
+
+	std::string Preprocess (const ShaderDesc& desc) override
+	{
+		ComPtr<ID3DBlob> result;
+		ComPtr<ID3DBlob> errors;
+
+		const auto macros = ToD3DShaderMacros (desc);
+		if (FAILED (D3DPreprocess (desc.source, desc.sourceSize, "",
+			macros.data (), nullptr, &result, &errors))) {
+			ReportShaderErrors (errors.Get ());
+			throw std::runtime_error ("Shader preprocessing failed.");
+		}
+
+		return std::string (static_cast<const char*> (result->GetBufferPointer ()),
+			result->GetBufferSize ());
+	}
+
+	std::vector<std::uint8_t> Compile (const ShaderDesc& desc) override
+	{
+		ComPtr<ID3DBlob> result;
+		ComPtr<ID3DBlob> errors;
+
+		const auto macros = ToD3DShaderMacros (desc);
+		if (FAILED (D3DCompile (desc.source, desc.sourceSize, "",
+			macros.data (), nullptr, desc.entryPoint, desc.profile,
+			COMPILE_FLAGS, 0, &result, &errors))) {
+			ReportShaderErrors (errors.Get ());
+			throw std::runtime_error ("Shader compilation failed.");
+		}
+
+		const auto bytecode = static_cast<const std::uint8_t*> (
+			result->GetBufferPointer ());
+		return std::vector<std::uint8_t> (bytecode, bytecode + result->GetBufferSize ());
+	}
+
+private:
+	static const UINT COMPILE_FLAGS = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class D3D12PipelineState final : public IPipelineState
+{
+public:
+	D3D12PipelineState (ID3D12Device* device, const PipelineStateDesc& desc)
+	{
+		std::vector<D3D12_INPUT_ELEMENT_DESC> layout;
+		for (const auto& element : desc.inputLayout) {
+			D3D12_INPUT_ELEMENT_DESC elementDesc = { element.semanticName,
+				static_cast<UINT> (element.semanticIndex),
+				ToDxgiFormat (element.format), 0,
+				static_cast<UINT> (element.offset),
+				D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+			layout.push_back (elementDesc);
+		}
+
+		// Shaders without precompiled bytecode are compiled here
+		D3DShaderCompiler compiler;
+		std::vector<std::uint8_t> vertexShader;
+		std::vector<std::uint8_t> pixelShader;
+		if (! desc.vertexShader.bytecode) {
+			vertexShader = compiler.Compile (desc.vertexShader);
+		}
+		if (! desc.pixelShader.bytecode) {
+			pixelShader = compiler.Compile (desc.pixelShader);
+		}
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+		psoDesc.VS = GetBytecode (desc.vertexShader, vertexShader);
+		psoDesc.PS = GetBytecode (desc.pixelShader, pixelShader);
+		psoDesc.pRootSignature = static_cast<D3D12RootSignature*> (
+			desc.rootSignature)->Get ();
+		psoDesc.NumRenderTargets = 1;
+		psoDesc.RTVFormats [0] = ToDxgiFormat (desc.renderTargetFormat);
+		psoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
+		psoDesc.InputLayout.NumElements = static_cast<UINT> (layout.size ());
+		psoDesc.InputLayout.pInputElementDescs = layout.data ();
+		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC (D3D12_DEFAULT);
+		psoDesc.BlendState = CD3DX12_BLEND_DESC (D3D12_DEFAULT);
+
+		if (desc.blendMode == BlendMode::AlphaBlend) {
+			psoDesc.BlendState.RenderTarget [0].BlendEnable = true;
+			psoDesc.BlendState.RenderTarget [0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+			psoDesc.BlendState.RenderTarget [0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+			psoDesc.BlendState.RenderTarget [0].BlendOp = D3D12_BLEND_OP_ADD;
+			psoDesc.BlendState.RenderTarget [0].SrcBlendAlpha = D3D12_BLEND_ONE;
+			psoDesc.BlendState.RenderTarget [0].DestBlendAlpha = D3D12_BLEND_ZERO;
+			psoDesc.BlendState.RenderTarget [0].BlendOpAlpha = D3D12_BLEND_OP_ADD;
+			psoDesc.BlendState.RenderTarget [0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+		}
+
+		psoDesc.SampleDesc.Count = 1;
+		psoDesc.DepthStencilState.DepthEnable = false;
+		psoDesc.DepthStencilState.StencilEnable = false;
+		psoDesc.SampleMask = 0xFFFFFFFF;
+		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		psoDesc.CachedPSO.pCachedBlob = desc.cachedBlob;
+		psoDesc.CachedPSO.CachedBlobSizeInBytes = desc.cachedBlobSize;
+
+		auto result = device->CreateGraphicsPipelineState (&psoDesc,
+			IID_PPV_ARGS (&pipelineState_));
+
+		// The blob is rejected if it was created by a different adapter or
+		// driver, or for a different description. Creating the pipeline
+		// state from scratch works in all of these cases
+		if (FAILED (result) && desc.cachedBlob) {
+			psoDesc.CachedPSO = {};
+			result = device->CreateGraphicsPipelineState (&psoDesc,
+				IID_PPV_ARGS (&pipelineState_));
+		}
+
+		if (FAILED (result)) {
+			throw std::runtime_error ("Pipeline state creation failed.");
+		}
+	}
+
+	std::vector<std::uint8_t> GetCachedBlob () const override
+	{
+		ComPtr<ID3DBlob> blob;
+		if (FAILED (pipelineState_->GetCachedBlob (&blob))) {
+			return std::vector<std::uint8_t> ();
+		}
+
+		const auto data = static_cast<const std::uint8_t*> (blob->GetBufferPointer ());
+		return std::vector<std::uint8_t> (data, data + blob->GetBufferSize ());
+	}
+
+	ID3D12PipelineState* Get () const
+	{
+		return pipelineState_.Get ();
+	}
+
+private:
+	static D3D12_SHADER_BYTECODE GetBytecode (const ShaderDesc& desc,
+		const std::vector<std::uint8_t>& compiled)
+	{
+		if (desc.bytecode) {
+			return { desc.bytecode, desc.bytecodeSize };
+		}
+
+		return { compiled.data (), compiled.size () };
+	}
+
+	ComPtr<ID3D12PipelineState> pipelineState_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class D3D12CommandList final : public ICommandList
+{
+public:
+	D3D12CommandList (ID3D12Device* device, const CommandListType type)
+	{
+		// Bundles need their own allocator type
+		const auto listType = type == CommandListType::Bundle
+			? D3D12_COMMAND_LIST_TYPE_BUNDLE : D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+		device->CreateCommandAllocator (listType,
+			IID_PPV_ARGS (&commandAllocator_));
+		device->CreateCommandList (0, listType,
+			commandAllocator_.Get (), nullptr,
+			IID_PPV_ARGS (&commandList_));
+		commandList_->Close ();
+	}
+
+	void Reset () override
+	{
+		commandAllocator_->Reset ();
+		commandList_->Reset (commandAllocator_.Get (), nullptr);
+		commandList_->IASetPrimitiveTopology (D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	}
+
+	void Close () override
+	{
+		commandList_->Close ();
+	}
+
+	void ResourceBarrier (const ResourceTransition* transitions,
+		const int count) override
+	{
+		// Barriers are submitted in batches, as every call may flush caches
+		static const int BATCH_SIZE = 16;
+		D3D12_RESOURCE_BARRIER barriers [BATCH_SIZE];
+
+		for (int first = 0; first < count; first += BATCH_SIZE) {
+			const int batchCount = std::min (count - first, BATCH_SIZE);
+			for (int i = 0; i < batchCount; ++i) {
+				const auto& transition = transitions [first + i];
+				barriers [i] = CD3DX12_RESOURCE_BARRIER::Transition (
+					static_cast<D3D12Resource*> (transition.resource)->Get (),
+					ToD3D12State (transition.before),
+					ToD3D12State (transition.after));
+			}
+
+			commandList_->ResourceBarrier (batchCount, barriers);
+		}
+	}
+
+	void CopyBufferRegion (IResource* destination,
+		const std::uint64_t destinationOffset,
+		IResource* source, const std::uint64_t sourceOffset,
+		const std::uint64_t size) override
+	{
+		commandList_->CopyBufferRegion (
+			static_cast<D3D12Resource*> (destination)->Get (), destinationOffset,
+			static_cast<D3D12Resource*> (source)->Get (), sourceOffset, size);
+	}
+
+	void CopyBufferToTexture (IResource* destination,
+		IResource* source, const std::uint64_t sourceOffset,
+		const int rowPitch) override
+	{
+		auto texture = static_cast<D3D12Resource*> (destination)->Get ();
+		const auto textureDesc = texture->GetDesc ();
+
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+		footprint.Offset = sourceOffset;
+		footprint.Footprint.Format = textureDesc.Format;
+		footprint.Footprint.Width = static_cast<UINT> (textureDesc.Width);
+		footprint.Footprint.Height = textureDesc.Height;
+		footprint.Footprint.Depth = 1;
+		footprint.Footprint.RowPitch = rowPitch;
+
+		const CD3DX12_TEXTURE_COPY_LOCATION destinationLocation (texture, 0);
+		const CD3DX12_TEXTURE_COPY_LOCATION sourceLocation (
+			static_cast<D3D12Resource*> (source)->Get (), footprint);
+
+		commandList_->CopyTextureRegion (&destinationLocation, 0, 0, 0,
+			&sourceLocation, nullptr);
+	}
+
+	void CopyTextureToBuffer (IResource* destination,
+		const std::uint64_t destinationOffset, IResource* source,
+		const int rowPitch) override
+	{
+		auto texture = static_cast<D3D12Resource*> (source)->Get ();
+		const auto textureDesc = texture->GetDesc ();
+
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+		footprint.Offset = destinationOffset;
+		footprint.Footprint.Format = textureDesc.Format;
+		footprint.Footprint.Width = static_cast<UINT> (textureDesc.Width);
+		footprint.Footprint.Height = textureDesc.Height;
+		footprint.Footprint.Depth = 1;
+		footprint.Footprint.RowPitch = rowPitch;
+
+		const CD3DX12_TEXTURE_COPY_LOCATION destinationLocation (
+			static_cast<D3D12Resource*> (destination)->Get (), footprint);
+		const CD3DX12_TEXTURE_COPY_LOCATION sourceLocation (texture, 0);
+
+		commandList_->CopyTextureRegion (&destinationLocation, 0, 0, 0,
+			&sourceLocation, nullptr);
+	}
+
+	void SetRenderTarget (IResource* renderTarget) override
+	{
+		const auto handle = static_cast<D3D12Resource*> (renderTarget)->GetRenderTargetView ();
+		commandList_->OMSetRenderTargets (1, &handle, true, nullptr);
+	}
+
+	void ClearRenderTarget (IResource* renderTarget,
+		const float* color) override
+	{
+		commandList_->ClearRenderTargetView (
+			static_cast<D3D12Resource*> (renderTarget)->GetRenderTargetView (),
+			color, 0, nullptr);
+	}
+
+	void SetViewport (const Viewport& viewport) override
+	{
+		const D3D12_VIEWPORT d3d12Viewport = {
+			viewport.x, viewport.y, viewport.width, viewport.height,
+			viewport.minDepth, viewport.maxDepth
+		};
+		commandList_->RSSetViewports (1, &d3d12Viewport);
+	}
+
+	void SetScissorRect (const ScissorRect& rect) override
+	{
+		const D3D12_RECT d3d12Rect = { rect.left, rect.top, rect.right, rect.bottom };
+		commandList_->RSSetScissorRects (1, &d3d12Rect);
+	}
+
+	void SetDescriptorHeap (IDescriptorHeap* heap) override
+	{
+		ID3D12DescriptorHeap* heaps [] = {
+			static_cast<D3D12DescriptorHeap*> (heap)->Get ()
+		};
+		commandList_->SetDescriptorHeaps (1, heaps);
+	}
+
+	void SetGraphicsRootSignature (IRootSignature* rootSignature) override
+	{
+		commandList_->SetGraphicsRootSignature (
+			static_cast<D3D12RootSignature*> (rootSignature)->Get ());
+	}
+
+	void SetPipelineState (IPipelineState* pipelineState) override
+	{
+		commandList_->SetPipelineState (
+			static_cast<D3D12PipelineState*> (pipelineState)->Get ());
+	}
+
+	void SetGraphicsRootConstantBufferView (const int parameter,
+		const std::uint64_t gpuAddress) override
+	{
+		commandList_->SetGraphicsRootConstantBufferView (parameter, gpuAddress);
+	}
+
+	void SetGraphicsRootDescriptorTable (const int parameter,
+		const GpuDescriptorHandle handle) override
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE d3d12Handle;
+		d3d12Handle.ptr = handle.ptr;
+		commandList_->SetGraphicsRootDescriptorTable (parameter, d3d12Handle);
+	}
+
+	void SetGraphicsRoot32BitConstants (const int parameter, const int count,
+		const void* data, const int offset) override
+	{
+		commandList_->SetGraphicsRoot32BitConstants (parameter, count, data, offset);
+	}
+
+	void SetVertexBuffer (const VertexBufferView& view) override
+	{
+		D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+		vertexBufferView.BufferLocation = view.gpuAddress;
+		vertexBufferView.SizeInBytes = view.size;
+		vertexBufferView.StrideInBytes = view.stride;
+		commandList_->IASetVertexBuffers (0, 1, &vertexBufferView);
+	}
+
+	void SetIndexBuffer (const IndexBufferView& view) override
+	{
+		D3D12_INDEX_BUFFER_VIEW indexBufferView;
+		indexBufferView.BufferLocation = view.gpuAddress;
+		indexBufferView.SizeInBytes = view.size;
+		indexBufferView.Format = view.format == IndexFormat::UInt16
+			? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		commandList_->IASetIndexBuffer (&indexBufferView);
+	}
+
+	void DrawIndexedInstanced (const int indexCountPerInstance,
+		const int instanceCount, const int startIndex,
+		const int baseVertex, const int startInstance) override
+	{
+		commandList_->DrawIndexedInstanced (indexCountPerInstance,
+			instanceCount, startIndex, baseVertex, startInstance);
+	}
+
+	void ExecuteBundle (ICommandList* bundle) override
+	{
+		commandList_->ExecuteBundle (static_cast<D3D12CommandList*> (bundle)->Get ());
+	}
+
+	ID3D12GraphicsCommandList* Get () const
+	{
+		return commandList_.Get ();
+	}
+
+private:
+	ComPtr<ID3D12CommandAllocator> commandAllocator_;
+	ComPtr<ID3D12GraphicsCommandList> commandList_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class D3D12CommandQueue final : public ICommandQueue
+{
+public:
+	explicit D3D12CommandQueue (ID3D12Device* device)
+	{
+		D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+		queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+		if (FAILED (device->CreateCommandQueue (&queueDesc, IID_PPV_ARGS (&queue_)))) {
+			throw std::runtime_error ("Command queue creation failed.");
+		}
+	}
+
+	void ExecuteCommandLists (ICommandList* const* commandLists,
+		const int count) override
+	{
+		std::vector<ID3D12CommandList*> d3d12CommandLists (count);
+		for (int i = 0; i < count; ++i) {
+			d3d12CommandLists [i] = static_cast<D3D12CommandList*> (commandLists [i])->Get ();
+		}
+
+		queue_->ExecuteCommandLists (count, d3d12CommandLists.data ());
+	}
+
+	void Signal (IFence* fence, const std::uint64_t value) override
+	{
+		queue_->Signal (static_cast<D3D12Fence*> (fence)->Get (), value);
+	}
+
+	ID3D12CommandQueue* Get () const
+	{
+		return queue_.Get ();
+	}
+
+private:
+	ComPtr<ID3D12CommandQueue> queue_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Hands out render target views from a fixed size heap. Views are never
+freed, which is fine for the handful of render targets we create.
+*/
+class RenderTargetViewAllocator final
+{
+public:
+	explicit RenderTargetViewAllocator (ID3D12Device* device)
+		: device_ (device)
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+		heapDesc.NumDescriptors = MAX_RENDER_TARGET_VIEWS;
+		heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+		heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		device->CreateDescriptorHeap (&heapDesc, IID_PPV_ARGS (&heap_));
+
+		descriptorSize_ = device->GetDescriptorHandleIncrementSize (
+			D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+	}
+
+	void CreateRenderTargetView (D3D12Resource* resource, const DXGI_FORMAT format)
+	{
+		if (count_ == MAX_RENDER_TARGET_VIEWS) {
+			throw std::runtime_error ("Out of render target views.");
+		}
+
+		D3D12_RENDER_TARGET_VIEW_DESC viewDesc;
+		viewDesc.Format = format;
+		viewDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
+		viewDesc.Texture2D.MipSlice = 0;
+		viewDesc.Texture2D.PlaneSlice = 0;
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle (
+			heap_->GetCPUDescriptorHandleForHeapStart (), count_++, descriptorSize_);
+		device_->CreateRenderTargetView (resource->Get (), &viewDesc, handle);
+		resource->SetRenderTargetView (handle);
+	}
+
+private:
+	ID3D12Device* device_;
+	ComPtr<ID3D12DescriptorHeap> heap_;
+	UINT descriptorSize_;
+	int count_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class D3D12SwapChain final : public ISwapChain
+{
+public:
+	D3D12SwapChain (ID3D12CommandQueue* queue,
+		RenderTargetViewAllocator& renderTargetViews,
+		const int width, const int height, const int bufferCount)
+		: window_ (new Window ("Anteru's D3D12 sample", width, height))
+	{
+		ComPtr<IDXGIFactory4> dxgiFactory;
+		if (FAILED (CreateDXGIFactory1 (IID_PPV_ARGS (&dxgiFactory)))) {
+			throw std::runtime_error ("DXGI factory creation failed.");
+		}
+
+		DXGI_SWAP_CHAIN_DESC swapChainDesc;
+		::ZeroMemory (&swapChainDesc, sizeof (swapChainDesc));
+
+		swapChainDesc.BufferCount = bufferCount;
+		// This is _UNORM but we'll use a _SRGB view on this. See
+		// GetRenderTargetFormat () for details, it must match what
+		// we specify here
+		swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		swapChainDesc.BufferDesc.Width = width;
+		swapChainDesc.BufferDesc.Height = height;
+		swapChainDesc.OutputWindow = window_->GetHWND ();
+		swapChainDesc.SampleDesc.Count = 1;
+		swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+		swapChainDesc.Windowed = true;
+
+		ComPtr<IDXGISwapChain> swapChain;
+		if (FAILED (dxgiFactory->CreateSwapChain (queue, &swapChainDesc, &swapChain))) {
+			throw std::runtime_error ("Swap chain creation failed.");
+		}
+
+		// We need IDXGISwapChain3 to query the current back buffer index
+		if (FAILED (swapChain.As (&swapChain_))) {
+			throw std::runtime_error ("IDXGISwapChain3 is not supported.");
+		}
+
+		// The swap chain buffers are _UNORM, but we render through _SRGB
+		// views so the output is gamma corrected
+		for (int i = 0; i < bufferCount; ++i) {
+			ComPtr<ID3D12Resource> buffer;
+			swapChain_->GetBuffer (i, IID_PPV_ARGS (&buffer));
+			buffers_.emplace_back (new D3D12Resource (buffer));
+			renderTargetViews.CreateRenderTargetView (buffers_.back ().get (),
+				DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+		}
+	}
+
+	int GetBufferCount () const override
+	{
+		return static_cast<int> (buffers_.size ());
+	}
+
+	IResource* GetBuffer (const int index) override
+	{
+		return buffers_ [index].get ();
+	}
+
+	int GetCurrentBufferIndex () const override
+	{
+		return swapChain_->GetCurrentBackBufferIndex ();
+	}
+
+	PixelFormat GetRenderTargetFormat () const override
+	{
+		return PixelFormat::R8G8B8A8_UNorm_sRGB;
+	}
+
+	int GetWidth () const override
+	{
+		return window_->GetWidth ();
+	}
+
+	int GetHeight () const override
+	{
+		return window_->GetHeight ();
+	}
+
+	void Present (const int syncInterval) override
+	{
+		swapChain_->Present (syncInterval, 0);
+	}
+
+private:
+	std::unique_ptr<Window> window_;
+	ComPtr<IDXGISwapChain3> swapChain_;
+	std::vector<std::unique_ptr<D3D12Resource>> buffers_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+One timestamp query heap per frame in flight. Timestamps are written into
+the command list of the slot, and resolved into a readback buffer which
+stays mapped for the whole lifetime.
+*/
+class D3D12TimestampBackend final : public IGpuTimestampBackend
+{
+public:
+	D3D12TimestampBackend (ID3D12Device* device, ID3D12CommandQueue* queue,
+		const std::vector<ICommandList*>& commandLists,
+		const int queriesPerSlot)
+		: queriesPerSlot_ (queriesPerSlot)
+		, queryHeaps_ (commandLists.size ())
+	{
+		for (auto commandList : commandLists) {
+			commandLists_.push_back (static_cast<D3D12CommandList*> (commandList)->Get ());
+		}
+
+		if (FAILED (queue->GetTimestampFrequency (&frequency_))) {
+			throw std::runtime_error ("Timestamp frequency query failed.");
+		}
+
+		D3D12_QUERY_HEAP_DESC heapDesc = {};
+		heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		heapDesc.Count = queriesPerSlot;
+
+		for (auto& queryHeap : queryHeaps_) {
+			if (FAILED (device->CreateQueryHeap (&heapDesc, IID_PPV_ARGS (&queryHeap)))) {
+				throw std::runtime_error ("Query heap creation failed.");
+			}
+		}
+
+		device->CreateCommittedResource (&CD3DX12_HEAP_PROPERTIES (D3D12_HEAP_TYPE_READBACK),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer (
+				queryHeaps_.size () * queriesPerSlot * sizeof (std::uint64_t)),
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS (&readbackBuffer_));
+
+		void* p;
+		readbackBuffer_->Map (0, nullptr, &p);
+		readback_ = static_cast<const std::uint64_t*> (p);
+	}
+
+	~D3D12TimestampBackend ()
+	{
+		D3D12_RANGE writtenRange = { 0, 0 };
+		readbackBuffer_->Unmap (0, &writtenRange);
+	}
+
+	void WriteTimestamp (const int slot, const int query) override
+	{
+		commandLists_ [slot]->EndQuery (queryHeaps_ [slot].Get (),
+			D3D12_QUERY_TYPE_TIMESTAMP, query);
+	}
+
+	void Resolve (const int slot, const int queryCount) override
+	{
+		commandLists_ [slot]->ResolveQueryData (queryHeaps_ [slot].Get (),
+			D3D12_QUERY_TYPE_TIMESTAMP, 0, queryCount, readbackBuffer_.Get (),
+			slot * queriesPerSlot_ * sizeof (std::uint64_t));
+	}
+
+	const std::uint64_t* GetResolvedTimestamps (const int slot) const override
+	{
+		return readback_ + slot * queriesPerSlot_;
+	}
+
+	std::uint64_t GetFrequency () const override
+	{
+		return frequency_;
+	}
+
+private:
+	std::vector<ID3D12GraphicsCommandList*> commandLists_;
+	int queriesPerSlot_;
+	UINT64 frequency_;
+
+	std::vector<ComPtr<ID3D12QueryHeap>> queryHeaps_;
+	ComPtr<ID3D12Resource> readbackBuffer_;
+	const std::uint64_t* readback_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+ComPtr<ID3D12Device> CreateDevice ()
+{
+	// Enable the debug layers when in debug mode
+	// If this fails, install the Graphics Tools for Windows. On Windows 10,
+	// open settings, Apps, Apps & Features, Optional features, Add Feature,
+	// and add the graphics tools
+#ifdef _DEBUG
+	ComPtr<ID3D12Debug> debugController;
+	D3D12GetDebugInterface (IID_PPV_ARGS (&debugController));
+
+	if (debugController) {
+		debugController->EnableDebugLayer ();
+	}
+#endif
+
+	ComPtr<ID3D12Device> device;
+	if (FAILED (D3D12CreateDevice (nullptr, D3D_FEATURE_LEVEL_11_0,
+		IID_PPV_ARGS (&device)))) {
+		throw std::runtime_error ("Device creation failed.");
+	}
+
+	return device;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+class D3D12RenderDevice final : public IRenderDevice
+{
+public:
+	D3D12RenderDevice ()
+		: device_ (CreateDevice ())
+		, queue_ (device_.Get ())
+		, renderTargetViews_ (device_.Get ())
+	{
+	}
+
+	ICommandQueue* GetQueue () override
+	{
+		return &queue_;
+	}
+
+	std::unique_ptr<ISwapChain> CreateSwapChain (const int width,
+		const int height, const int bufferCount) override
+	{
+		return std::unique_ptr<ISwapChain> (new D3D12SwapChain (queue_.Get (),
+			renderTargetViews_, width, height, bufferCount));
+	}
+
+	std::unique_ptr<IFence> CreateFence (const std::uint64_t initialValue) override
+	{
+		ComPtr<ID3D12Fence> fence;
+		if (FAILED (device_->CreateFence (initialValue, D3D12_FENCE_FLAG_NONE,
+			IID_PPV_ARGS (&fence)))) {
+			throw std::runtime_error ("Fence creation failed.");
+		}
+
+		return std::unique_ptr<IFence> (new D3D12Fence (fence));
+	}
+
+	std::unique_ptr<ICommandList> CreateCommandList (
+		const CommandListType type) override
+	{
+		return std::unique_ptr<ICommandList> (new D3D12CommandList (device_.Get (), type));
+	}
+
+	std::unique_ptr<IResource> CreateBuffer (const std::size_t size,
+		const HeapType heapType, const ResourceState initialState) override
+	{
+		D3D12_HEAP_TYPE d3d12HeapType = D3D12_HEAP_TYPE_DEFAULT;
+		if (heapType == HeapType::Upload) {
+			d3d12HeapType = D3D12_HEAP_TYPE_UPLOAD;
+		} else if (heapType == HeapType::Readback) {
+			d3d12HeapType = D3D12_HEAP_TYPE_READBACK;
+		}
+
+		ComPtr<ID3D12Resource> buffer;
+		if (FAILED (device_->CreateCommittedResource (&CD3DX12_HEAP_PROPERTIES (d3d12HeapType),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer (size),
+			ToD3D12State (initialState),
+			nullptr,
+			IID_PPV_ARGS (&buffer)))) {
+			throw std::runtime_error ("Buffer creation failed.");
+		}
+
+		return std::unique_ptr<IResource> (new D3D12Resource (buffer));
+	}
+
+	std::unique_ptr<IResource> CreateTexture2D (const int width,
+		const int height, const PixelFormat format,
+		const ResourceState initialState, const bool renderTarget) override
+	{
+		const auto d3d12Format = ToDxgiFormat (format);
+
+		ComPtr<ID3D12Resource> texture;
+		if (FAILED (device_->CreateCommittedResource (&CD3DX12_HEAP_PROPERTIES (D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Tex2D (d3d12Format, width, height, 1, 1, 1, 0,
+				renderTarget ? D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET : D3D12_RESOURCE_FLAG_NONE),
+			ToD3D12State (initialState),
+			nullptr,
+			IID_PPV_ARGS (&texture)))) {
+			throw std::runtime_error ("Texture creation failed.");
+		}
+
+		std::unique_ptr<D3D12Resource> result (new D3D12Resource (texture));
+		if (renderTarget) {
+			renderTargetViews_.CreateRenderTargetView (result.get (), d3d12Format);
+		}
+
+		return result;
+	}
+
+	std::unique_ptr<IDescriptorHeap> CreateDescriptorHeap (
+		const int descriptorCount) override
+	{
+		return std::unique_ptr<IDescriptorHeap> (
+			new D3D12DescriptorHeap (device_.Get (), descriptorCount));
+	}
+
+	std::unique_ptr<IRootSignature> CreateRootSignature (
+		const RootSignatureDesc& desc) override
+	{
+		return std::unique_ptr<IRootSignature> (
+			new D3D12RootSignature (device_.Get (), desc));
+	}
+
+	std::unique_ptr<IPipelineState> CreatePipelineState (
+		const PipelineStateDesc& desc) override
+	{
+		return std::unique_ptr<IPipelineState> (
+			new D3D12PipelineState (device_.Get (), desc));
+	}
+
+	std::unique_ptr<IShaderCompiler> CreateShaderCompiler () override
+	{
+		return std::unique_ptr<IShaderCompiler> (new D3DShaderCompiler);
+	}
+
+	/**
+	PCI ids of the adapter and the version of its user mode driver, which
+	changes with every driver update.
+	*/
+	std::string GetAdapterIdentity () const override
+	{
+		ComPtr<IDXGIFactory4> dxgiFactory;
+		ComPtr<IDXGIAdapter1> adapter;
+		DXGI_ADAPTER_DESC1 adapterDesc;
+		LARGE_INTEGER driverVersion = {};
+
+		if (FAILED (CreateDXGIFactory1 (IID_PPV_ARGS (&dxgiFactory))) ||
+			FAILED (dxgiFactory->EnumAdapterByLuid (device_->GetAdapterLuid (),
+				IID_PPV_ARGS (&adapter))) ||
+			FAILED (adapter->GetDesc1 (&adapterDesc))) {
+			throw std::runtime_error ("Adapter query failed.");
+		}
+
+		// Meant for D3D10 interfaces, but IDXGIDevice reports the user mode
+		// driver version on all drivers
+		adapter->CheckInterfaceSupport (__uuidof (IDXGIDevice), &driverVersion);
+
+		char identity [128];
+		std::snprintf (identity, sizeof (identity),
+			"%04x:%04x:%08x:%02x driver %u.%u.%u.%u",
+			adapterDesc.VendorId, adapterDesc.DeviceId, adapterDesc.SubSysId,
+			adapterDesc.Revision,
+			HIWORD (driverVersion.HighPart), LOWORD (driverVersion.HighPart),
+			HIWORD (driverVersion.LowPart), LOWORD (driverVersion.LowPart));
+
+		return identity;
+	}
+
+	std::unique_ptr<IGpuTimestampBackend> CreateTimestampBackend (
+		const std::vector<ICommandList*>& commandLists,
+		const int queriesPerSlot) override
+	{
+		return std::unique_ptr<IGpuTimestampBackend> (new D3D12TimestampBackend (
+			device_.Get (), queue_.Get (), commandLists, queriesPerSlot));
+	}
+
+private:
+	ComPtr<ID3D12Device> device_;
+	D3D12CommandQueue queue_;
+	RenderTargetViewAllocator renderTargetViews_;
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IRenderDevice> CreateD3D12Device ()
+{
+	return std::unique_ptr<IRenderDevice> (new D3D12RenderDevice);
+}
+}
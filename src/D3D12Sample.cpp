@@ -1,86 +1,120 @@
 #include "D3D12Sample.h"
 
-#include <dxgi1_4.h>
-#include <d3dx12.h>
 #include <iostream>
-#include <d3dcompiler.h>
 #include <shaders.h>
+#include <shader_archive.h>
+#include <shader_layouts.h>
 #include <sample_texture.h>
 #include <algorithm>
-
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "ConstantBufferLayout.h"
+#include "Hash.h"
 #include "ImageIO.h"
-#include "Window.h"
-
-#ifdef max 
-#undef max
-#endif
-
-using namespace Microsoft::WRL;
+#include "Mesh.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "PipelineCache.h"
+#include "ShaderArchive.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Utility.h"
+#include "VertexQuantization.h"
 
 namespace anteru {
 namespace {
-struct RenderEnvironment
-{
-	ComPtr<ID3D12Device> device;
-	ComPtr<ID3D12CommandQueue> queue;
-	ComPtr<IDXGISwapChain> swapChain;
-};
+const int MAX_GPU_SCOPES_PER_FRAME = 16;
+
+const int WINDOW_WIDTH = 512;
+const int WINDOW_HEIGHT = 512;
+
+// cbuffer PerFrameConstants in shaders.hlsl. The layout generated from the
+// shader source has to match field by field
+using PerFrameConstants = ConstantBufferLayout<hlsl::float4>;
+const int PER_FRAME_SCALE = 0;
+
+// cbuffer MeshConstants, see QuantizedVertices
+using MeshConstants = ConstantBufferLayout<hlsl::float4, hlsl::float4, hlsl::float4>;
+const int MESH_POSITION_SCALE = 0;
+const int MESH_POSITION_OFFSET = 1;
+const int MESH_UV_SCALE_OFFSET = 2;
+
+// Shader bindings, see CreateRootSignature
+const int TEXTURE_BINDING = 0;
+const int PER_FRAME_BINDING = 1;
+const int MESH_BINDING = 2;
+
+static_assert (PerFrameConstants::FIELD_COUNT == ShaderLayouts::PerFrameConstants::FIELD_COUNT &&
+	PerFrameConstants::SIZE == ShaderLayouts::PerFrameConstants::SIZE,
+	"PerFrameConstants does not match shaders.hlsl");
+static_assert (PerFrameConstants::GetOffset (PER_FRAME_SCALE) == ShaderLayouts::PerFrameConstants::scale::OFFSET &&
+	PerFrameConstants::GetSize<PER_FRAME_SCALE> () == ShaderLayouts::PerFrameConstants::scale::SIZE,
+	"PerFrameConstants::scale does not match shaders.hlsl");
+
+static_assert (MeshConstants::FIELD_COUNT == ShaderLayouts::MeshConstants::FIELD_COUNT &&
+	MeshConstants::SIZE == ShaderLayouts::MeshConstants::SIZE,
+	"MeshConstants does not match shaders.hlsl");
+static_assert (MeshConstants::GetOffset (MESH_POSITION_SCALE) == ShaderLayouts::MeshConstants::positionScale::OFFSET &&
+	MeshConstants::GetOffset (MESH_POSITION_OFFSET) == ShaderLayouts::MeshConstants::positionOffset::OFFSET &&
+	MeshConstants::GetOffset (MESH_UV_SCALE_OFFSET) == ShaderLayouts::MeshConstants::uvScaleOffset::OFFSET,
+	"MeshConstants fields do not match shaders.hlsl");
 
 ///////////////////////////////////////////////////////////////////////////////
 /**
-Create everything we need for rendering, this includes a device, a command queue,
-and a swap chain.
+Center the mesh and scale it uniformly, such that it spans [-1,1] in x
+and y and [0,1] in z along its largest axis.
 */
-RenderEnvironment CreateDeviceAndSwapChainHelper (
-	_In_opt_ IDXGIAdapter* adapter,
-	D3D_FEATURE_LEVEL minimumFeatureLevel,
-	_In_opt_ const DXGI_SWAP_CHAIN_DESC* swapChainDesc)
+void FitIntoClipSpace (Mesh& mesh)
 {
-	RenderEnvironment result;
-
-	auto hr = D3D12CreateDevice (adapter, minimumFeatureLevel,
-		IID_PPV_ARGS (&result.device));
-
-	if (FAILED (hr)) {
-		throw std::runtime_error ("Device creation failed.");
+	if (mesh.vertices.empty ()) {
+		return;
 	}
 
-	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
-	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-
-	hr = result.device->CreateCommandQueue (&queueDesc, IID_PPV_ARGS (&result.queue));
-
-	if (FAILED (hr)) {
-		throw std::runtime_error ("Command queue creation failed.");
+	float minimum [3], maximum [3];
+	for (int i = 0; i < 3; ++i) {
+		minimum [i] = maximum [i] = mesh.vertices [0].position [i];
 	}
 
-	ComPtr<IDXGIFactory4> dxgiFactory;
-	hr = CreateDXGIFactory1 (IID_PPV_ARGS (&dxgiFactory));
-
-	if (FAILED (hr)) {
-		throw std::runtime_error ("DXGI factory creation failed.");
+	for (const auto& vertex : mesh.vertices) {
+		for (int i = 0; i < 3; ++i) {
+			minimum [i] = std::min (minimum [i], vertex.position [i]);
+			maximum [i] = std::max (maximum [i], vertex.position [i]);
+		}
 	}
 
-	// Must copy into non-const space
-	DXGI_SWAP_CHAIN_DESC swapChainDescCopy = *swapChainDesc;
-	hr = dxgiFactory->CreateSwapChain (
-		result.queue.Get (),
-		&swapChainDescCopy,
-		&result.swapChain
-		);
+	const float extent = std::max (std::max (maximum [0] - minimum [0],
+		maximum [1] - minimum [1]), maximum [2] - minimum [2]);
+	const float scale = extent > 0 ? 2 / extent : 1;
 
-	if (FAILED (hr)) {
-		throw std::runtime_error ("Swap chain creation failed.");
+	for (auto& vertex : mesh.vertices) {
+		auto& position = vertex.position;
+		position [0] = (position [0] - (minimum [0] + maximum [0]) / 2) * scale;
+		position [1] = (position [1] - (minimum [1] + maximum [1]) / 2) * scale;
+		// Half the scale, as clip space z is only half as deep
+		position [2] = (position [2] - minimum [2]) * scale / 2;
 	}
-
-	return result;
 }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-D3D12Sample::D3D12Sample ()
+D3D12Sample::D3D12Sample (std::unique_ptr<IRenderDevice> device,
+	const int framesInFlight, const int backBufferCount)
+	: device_ (std::move (device))
+	, frameRing_ (framesInFlight)
+	, backBufferCount_ (backBufferCount)
 {
+	// Flip model swap chains need at least two and at most 16 buffers
+	if (backBufferCount < 2 || backBufferCount > MAX_SWAP_CHAIN_BUFFERS) {
+		throw std::runtime_error ("Invalid number of back buffers.");
+	}
+
+	commandQueue_ = device_->GetQueue ();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -91,120 +125,408 @@ D3D12Sample::~D3D12Sample ()
 ///////////////////////////////////////////////////////////////////////////////
 void D3D12Sample::PrepareRender ()
 {
-	commandAllocators_ [currentBackBuffer_]->Reset ();
+	auto commandList = commandLists_ [GetQueueSlot ()].get ();
+	commandList->Reset ();
+
+	// We waited for the frame which used this slot before, so its GPU
+	// timings are available now
+	gpuProfiler_->BeginFrame (GetQueueSlot (), frameRing_.GetFrameIndex ());
+	if (! gpuProfiler_->GetTimings ().empty ()) {
+		TraceCounter ("GPU frame [us]", static_cast<std::int64_t> (
+			gpuProfiler_->GetTimings ().front ().milliseconds * 1000));
+	}
 
-	auto commandList = commandLists_ [currentBackBuffer_].Get ();
-	commandList->Reset (
-		commandAllocators_ [currentBackBuffer_].Get (), nullptr);
+	// Closed by GpuProfiler::EndFrame in FinalizeRender
+	gpuProfiler_->BeginScope ("Frame");
 
-	D3D12_CPU_DESCRIPTOR_HANDLE renderTargetHandle;
-	CD3DX12_CPU_DESCRIPTOR_HANDLE::InitOffsetted (renderTargetHandle,
-		renderTargetDescriptorHeap_->GetCPUDescriptorHandleForHeapStart (),
-		currentBackBuffer_, renderTargetViewDescriptorSize_);
+	auto renderTarget = GetRenderTarget ();
 
-	commandList->OMSetRenderTargets (1, &renderTargetHandle, true, nullptr);
-	commandList->RSSetViewports (1, &viewport_);
-	commandList->RSSetScissorRects (1, &rectScissor_);
+	commandList->SetRenderTarget (renderTarget);
+	commandList->SetViewport (viewport_);
+	commandList->SetScissorRect (rectScissor_);
 
 	// Transition back buffer
-	D3D12_RESOURCE_BARRIER barrier;
-	barrier.Transition.pResource = renderTargets_ [currentBackBuffer_].Get ();
-	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	const ResourceTransition barrier = {
+		renderTarget, GetRenderTargetIdleState (), ResourceState::RenderTarget
+	};
 
-	commandList->ResourceBarrier (1, &barrier);
+	commandList->ResourceBarrier (&barrier, 1);
 
 	static const float clearColor [] = {
 		0.042f, 0.042f, 0.042f,
 		1
 	};
 
-	commandList->ClearRenderTargetView (renderTargetHandle,
-		clearColor, 0, nullptr);
+	ScopedGpuMarker marker (*gpuProfiler_, "Clear");
+	commandList->ClearRenderTarget (renderTarget, clearColor);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void D3D12Sample::UpdateConstantBuffer ()
 {
-	static int counter = 0;
-	counter++;
+	// Animated by the frame index, so every run renders the same frames
+	const auto counter = frameRing_.GetFrameIndex () + 1;
+	currentScale_ = std::abs (std::sin (static_cast<float> (counter) / 64.0f));
+
+	ConstantBufferWriter<PerFrameConstants> constants;
+	constants.Set<PER_FRAME_SCALE> ({ currentScale_, 0, 0, 0 });
+
+	// Root constants are copied into the command list when they are set
+	if (rootSignatureLayout_.bindings [PER_FRAME_BINDING].type == RootParameterType::Constants) {
+		perFrameRootConstants_.resize (PerFrameConstants::SIZE / 4);
+		std::memcpy (perFrameRootConstants_.data (), constants.GetData (),
+			PerFrameConstants::SIZE);
+		return;
+	}
+
+	constants.WriteTo (constantBuffers_ [GetQueueSlot ()]->Map ());
+	constantBuffers_ [GetQueueSlot ()]->Unmap ();
+	FlushConstantBufferWrites ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Collect the draws for this frame. All candidates are tested against the
+software occlusion buffer, and only those which may be visible end up in
+drawList_.
+*/
+void D3D12Sample::BuildDrawList ()
+{
+	DrawCommand mesh;
+	mesh.bounds = meshBounds_;
+	mesh.indexCount = meshIndexCount_;
+	mesh.startIndex = 0;
+	mesh.baseVertex = 0;
+	mesh.rootSignature = rootSignature_;
+	mesh.pipelineState = pso_.Get ();
+	mesh.material = srvDescriptorHeap_->GetGpuHandle (0);
+
+	// Submit only sets state when the identifiers in the key change, so
+	// they have to be derived from the objects the draw actually uses
+	drawStateIds_.Clear ();
+	mesh.sortKey = DrawKey::Pack (0,
+		drawStateIds_.GetRootSignature (mesh.rootSignature),
+		drawStateIds_.GetPipelineState (mesh.pipelineState),
+		drawStateIds_.GetMaterial (mesh.material.ptr),
+		mesh.bounds.min [2]);
+
+	drawCandidates_.clear ();
+	drawCandidates_.push_back (mesh);
+
+	// The mesh is drawn in clip space, x and y scaled by the per-frame
+	// constant, which is all the camera there is
+	const float scale = currentScale_;
+	const float viewProjection [16] = {
+		scale, 0, 0, 0,
+		0, scale, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	};
+	occlusionBuffer_->SetViewProjection (viewProjection);
+
+	// The sample does not contain any occluders, so the buffer stays at the
+	// far plane. Scenes with occluders would Clear the buffer, queue them
+	// with AddOccluder and Rasterize here
+
+	drawCandidateBounds_.clear ();
+	for (const auto& candidate : drawCandidates_) {
+		drawCandidateBounds_.push_back (candidate.bounds);
+	}
+
+	drawCandidateVisible_.resize (drawCandidates_.size ());
+	occlusionBuffer_->TestVisibility (drawCandidateBounds_.data (),
+		static_cast<int> (drawCandidateBounds_.size ()),
+		drawCandidateVisible_.data ());
+
+	drawList_.clear ();
+	drawQueue_->Clear ();
+	for (std::size_t i = 0; i < drawCandidates_.size (); ++i) {
+		if (drawCandidateVisible_ [i]) {
+			drawQueue_->Add (drawCandidates_ [i].sortKey,
+				static_cast<std::uint32_t> (drawList_.size ()));
+			drawList_.push_back (drawCandidates_ [i]);
+		}
+	}
+
+	drawQueue_->Sort ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Build the draw list for this frame and record it into the command list.
+
+With bundles, the draws are recorded into a bundle which is reused as long
+as the draw list stays the same. Only the per-frame constants are set on
+the command list, and the bundle inherits them.
+*/
+void D3D12Sample::RecordCommands (ICommandList* commandList)
+{
+	BuildDrawList ();
+
+	ScopedGpuMarker marker (*gpuProfiler_, "Draws");
+
+	if (! bundles_) {
+		RecordDraws (commandList, true);
+		return;
+	}
 
-	void* p;
-	constantBuffers_ [GetQueueSlot ()]->Map (0, nullptr, &p);
-	float* f = static_cast<float*>(p);
-	f [0] = std::abs (std::sin (static_cast<float> (counter) / 64.0f));
-	constantBuffers_ [GetQueueSlot ()]->Unmap (0, nullptr);
+	// The bundle sets the same root signature, so it keeps the per-frame
+	// constants set here
+	commandList->SetDescriptorHeap (srvDescriptorHeap_.get ());
+	commandList->SetGraphicsRootSignature (rootSignature_);
+	SetPerFrameConstants (commandList);
+
+	std::vector<const void*> dependencies = {
+		vertexBuffer_.get (), indexBuffer_.get (), meshConstantBuffer_.get (),
+		image_.get (), srvDescriptorHeap_.get ()
+	};
+
+	for (const auto& draw : drawList_) {
+		dependencies.push_back (draw.rootSignature);
+		dependencies.push_back (draw.pipelineState);
+	}
+
+	bundles_->BeginFrame (currentFenceValue_, fence_->GetCompletedValue ());
+	commandList->ExecuteBundle (bundles_->Get (GetDrawListKey (), dependencies,
+		[this] (ICommandList* bundle) {
+		RecordDraws (bundle, false);
+	}));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The per-frame constants go either directly into the root signature or into
+a constant buffer.
+*/
+void D3D12Sample::SetPerFrameConstants (ICommandList* commandList)
+{
+	const auto& perFrame = rootSignatureLayout_.bindings [PER_FRAME_BINDING];
+	if (perFrame.type == RootParameterType::Constants) {
+		commandList->SetGraphicsRoot32BitConstants (perFrame.parameter,
+			static_cast<int> (perFrameRootConstants_.size ()),
+			perFrameRootConstants_.data ());
+	} else {
+		commandList->SetGraphicsRootConstantBufferView (perFrame.parameter,
+			constantBuffers_ [GetQueueSlot ()]->GetGpuAddress ());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Identifies the draw list for the bundle cache. Everything which ends up in
+the recorded commands is part of the key, the objects themselves are
+tracked as dependencies.
+*/
+std::uint64_t D3D12Sample::GetDrawListKey () const
+{
+	HashBuilder hash;
+	for (const auto& draw : drawList_) {
+		hash.Add (draw.sortKey)
+			.Add (static_cast<std::uint64_t> (draw.indexCount))
+			.Add (static_cast<std::uint64_t> (draw.startIndex))
+			.Add (static_cast<std::uint64_t> (draw.baseVertex))
+			.Add (draw.material.ptr);
+	}
+
+	return hash.Get ().low;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::RecordDraws (ICommandList* commandList,
+	const bool setPerFrameConstants)
+{
+	// Set the descriptor heap containing the texture srv. Bundles have to
+	// use the same one as the command list which executes them
+	commandList->SetDescriptorHeap (srvDescriptorHeap_.get ());
+
+	commandList->SetVertexBuffer (vertexBufferView_);
+	commandList->SetIndexBuffer (indexBufferView_);
+
+	// Draws arrive sorted by their key, so we only have to set the state
+	// which differs from the previous draw
+	drawQueue_->Submit ([&] (const std::uint32_t drawIndex,
+		const DrawQueue::StateChanges& changes) {
+		const auto& draw = drawList_ [drawIndex];
+
+		if (changes.rootSignature) {
+			// Set our root signature
+			commandList->SetGraphicsRootSignature (draw.rootSignature);
+
+			if (setPerFrameConstants) {
+				SetPerFrameConstants (commandList);
+			}
+
+			// Static constant buffers are always root descriptors
+			commandList->SetGraphicsRootConstantBufferView (
+				rootSignatureLayout_.bindings [MESH_BINDING].parameter,
+				meshConstantBuffer_->GetGpuAddress ());
+		}
+
+		if (changes.pipelineState) {
+			// Set our state (shaders, etc.)
+			commandList->SetPipelineState (draw.pipelineState);
+		}
+
+		if (changes.material) {
+			// Point the texture table at our descriptor heap with the
+			// texture SRV
+			commandList->SetGraphicsRootDescriptorTable (
+				rootSignatureLayout_.bindings [TEXTURE_BINDING].parameter,
+				draw.material);
+		}
+
+		commandList->DrawIndexedInstanced (draw.indexCount, 1,
+			draw.startIndex, draw.baseVertex, 0);
+	});
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void D3D12Sample::Render ()
 {
-	PrepareRender ();
+	{
+		ScopedPhaseTimer timer (frameTimer_, FramePhase::PrepareRender);
+		PrepareRender ();
+	}
 	
-	auto commandList = commandLists_ [currentBackBuffer_].Get ();
+	auto commandList = commandLists_ [GetQueueSlot ()].get ();
 
-	UpdateConstantBuffer ();
+	{
+		ScopedPhaseTimer timer (frameTimer_, FramePhase::UpdateConstantBuffer);
+		UpdateConstantBuffer ();
+	}
 
-	// Set our state (shaders, etc.)
-	commandList->SetPipelineState (pso_.Get ());
-	
-	// Set our root signature
-	commandList->SetGraphicsRootSignature (rootSignature_.Get ());
-	
-	// Set the descriptor heap containing the texture srv
-	ID3D12DescriptorHeap* heaps [] = { srvDescriptorHeap_.Get () };
-	commandList->SetDescriptorHeaps (1, heaps);
-
-	// Set slot 0 of our root signature to point to our descriptor heap with
-	// the texture SRV
-	commandList->SetGraphicsRootDescriptorTable (0,
-		srvDescriptorHeap_->GetGPUDescriptorHandleForHeapStart ());
-
-	// Set slot 1 of our root signature to the constant buffer view
-	commandList->SetGraphicsRootConstantBufferView (1,
-		constantBuffers_ [GetQueueSlot ()]->GetGPUVirtualAddress ());
-
-	commandList->IASetPrimitiveTopology (D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	commandList->IASetVertexBuffers (0, 1, &vertexBufferView_);
-	commandList->IASetIndexBuffer (&indexBufferView_);
-	commandList->DrawIndexedInstanced (6, 1, 0, 0, 0);
+	{
+		ScopedPhaseTimer timer (frameTimer_, FramePhase::RecordCommands);
+		RecordCommands (commandList);
+	}
 	
 	FinalizeRender ();
 }
 
+
 ///////////////////////////////////////////////////////////////////////////////
 void D3D12Sample::FinalizeRender ()
 {
-	// Transition the swap chain back to present
-	D3D12_RESOURCE_BARRIER barrier;
-	barrier.Transition.pResource = renderTargets_ [currentBackBuffer_].Get ();
-	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	// Transition the swap chain back to present, or the offscreen target
+	// to copy source for the readback
+	const ResourceTransition barrier = {
+		GetRenderTarget (),
+		ResourceState::RenderTarget, GetRenderTargetIdleState ()
+	};
 
-	auto commandList = commandLists_ [currentBackBuffer_].Get ();
-	commandList->ResourceBarrier (1, &barrier);
+	auto commandList = commandLists_ [GetQueueSlot ()].get ();
 
-	commandList->Close ();
+	{
+		ScopedPhaseTimer timer (frameTimer_, FramePhase::RecordCommands);
+		commandList->ResourceBarrier (&barrier, 1);
+
+		if (frameReadback_) {
+			// The fence value is the one Present will signal for this frame
+			ScopedGpuMarker marker (*gpuProfiler_, "Readback");
+			frameReadback_->Copy (commandList, offscreenTarget_.get (),
+				frameRing_.GetFrameIndex (), currentFenceValue_);
+		}
+
+		gpuProfiler_->EndFrame ();
+		commandList->Close ();
+	}
 
 	// Execute our commands
-	ID3D12CommandList* commandLists [] = { commandList };
-	commandQueue_->ExecuteCommandLists (std::extent<decltype(commandLists)>::value, commandLists);
+	ScopedPhaseTimer timer (frameTimer_, FramePhase::ExecuteCommandLists);
+	commandQueue_->ExecuteCommandLists (&commandList, 1);
 }
 
-namespace {
-void WaitForFence (ID3D12Fence* fence, UINT64 completionValue, HANDLE waitEvent)
+///////////////////////////////////////////////////////////////////////////////
+/**
+Signal the fence on the command queue with the next value of the timeline.
+All work submitted so far is complete once the fence reaches that value.
+*/
+std::uint64_t D3D12Sample::SignalFence ()
 {
-	if (fence->GetCompletedValue () < completionValue) {
-		fence->SetEventOnCompletion (completionValue, waitEvent);
-		WaitForSingleObject (waitEvent, INFINITE);
-	}
+	const auto fenceValue = currentFenceValue_++;
+	commandQueue_->Signal (fence_.get (), fenceValue);
+	return fenceValue;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::WaitForFence (const std::uint64_t value)
+{
+	WaitForValue (*fence_, value, fenceEvent_, fenceWaitStrategy_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetFramePacing (const FramePacingMode mode, const double target)
+{
+	framePacingMode_ = mode;
+	framePacingTarget_ = target;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetOffscreen (const int width, const int height,
+	const ReadbackCallback& callback)
+{
+	offscreenWidth_ = width;
+	offscreenHeight_ = height;
+	readbackCallback_ = callback;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetTexturePacking (const TexturePackingOptions& options)
+{
+	texturePacking_ = options;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetMesh (const std::string& path)
+{
+	meshPath_ = path;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetVertexFormat (const VertexFormat& format)
+{
+	vertexFormat_ = format;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetShaderCache (const std::string& path)
+{
+	shaderCachePath_ = path;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetUseShaderArchive (const bool useShaderArchive)
+{
+	useShaderArchive_ = useShaderArchive;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetPipelineCache (const std::string& path)
+{
+	pipelineCachePath_ = path;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetStatisticsInterval (const int frameCount)
+{
+	statisticsInterval_ = frameCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::SetUseBundles (const bool useBundles)
+{
+	useBundles_ = useBundles;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::WriteFrameStatistics (std::ostream& output, const bool rolling) const
+{
+	output << (rolling ? "Recent frames\n" : "All frames\n");
+	frameTimer_.WriteReport (output, rolling);
+
+	if (gpuProfiler_) {
+		gpuProfiler_->WriteReport (output);
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -212,17 +534,53 @@ void D3D12Sample::Run (const int frameCount)
 {
 	Initialize ();
 
+	Tracer::SetThreadName ("Render");
+
 	for (int i = 0; i < frameCount; ++i) {
-		WaitForFence (frameFences_[GetQueueSlot ()].Get (), 
-			fenceValues_[GetQueueSlot ()], frameFenceEvents_[GetQueueSlot ()]);
+		TraceScope frameScope ("Frame",
+			"frame", static_cast<std::int64_t> (frameRing_.GetFrameIndex ()),
+			"queue slot", GetQueueSlot ());
+
+		{
+			ScopedPhaseTimer timer (frameTimer_, FramePhase::WaitForFence);
+			WaitForFence (frameRing_.GetWaitValue ());
+		}
+
+		if (frameReadback_) {
+			ScopedPhaseTimer timer (frameTimer_, FramePhase::Readback);
+			DeliverFrames ();
+		}
+
+		{
+			// Delay the CPU work until it is needed to keep the GPU busy
+			ScopedPhaseTimer timer (frameTimer_, FramePhase::FramePacing);
+			const auto completedValue = fence_->GetCompletedValue ();
+			TraceCounter ("Fence completed", static_cast<std::int64_t> (completedValue));
+			framePacer_->OnFenceCompleted (completedValue);
+			framePacer_->WaitForFrameStart ();
+		}
 		
 		Render ();
-		Present ();
+
+		{
+			ScopedPhaseTimer timer (frameTimer_, FramePhase::Present);
+			Present ();
+		}
+
+		framePacer_->OnFrameSubmitted (frameRing_.GetLastSubmittedValue ());
+
+		frameTimer_.EndFrame ();
+		if (statisticsInterval_ > 0 &&
+			frameTimer_.GetFrameCount () % statisticsInterval_ == 0) {
+			WriteFrameStatistics (std::cout, true);
+		}
 	}
 
 	// Drain the queue, wait for everything to finish
-	for (int i = 0; i < GetQueueSlotCount (); ++i) {
-		WaitForFence (frameFences_[i].Get (), fenceValues_[i], frameFenceEvents_[i]);
+	WaitForFence (frameRing_.GetLastSubmittedValue ());
+
+	if (frameReadback_) {
+		DeliverFrames ();
 	}
 
 	Shutdown ();
@@ -230,60 +588,67 @@ void D3D12Sample::Run (const int frameCount)
 
 ///////////////////////////////////////////////////////////////////////////////
 /**
-Setup all render targets. This creates the render target descriptor heap and
-render target views for all render targets.
+Present the current frame by swapping the back buffer, then move to the
+next back buffer and also signal the fence for the current queue slot entry.
 
-This function does not use a default view but instead changes the format to
-_SRGB.
+The back buffer index comes from the swap chain, while the queue slot
+advances with every frame, so the two counts are independent.
 */
-void D3D12Sample::SetupRenderTargets ()
+void D3D12Sample::Present ()
 {
-	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-	heapDesc.NumDescriptors = GetQueueSlotCount ();
-	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-	device_->CreateDescriptorHeap (&heapDesc, IID_PPV_ARGS (&renderTargetDescriptorHeap_));
-
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle{ 
-		renderTargetDescriptorHeap_->GetCPUDescriptorHandleForHeapStart () };
-
-	for (int i = 0; i < GetQueueSlotCount (); ++i) {
-		D3D12_RENDER_TARGET_VIEW_DESC viewDesc;
-		viewDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-		viewDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
-		viewDesc.Texture2D.MipSlice = 0;
-		viewDesc.Texture2D.PlaneSlice = 0;
+	if (swapChain_) {
+		swapChain_->Present (1);
+	}
 
-		device_->CreateRenderTargetView (renderTargets_ [i].Get (), &viewDesc,
-			rtvHandle);
+	// Mark the fence for the current frame.
+	const auto fenceValue = SignalFence ();
+	TraceInstant ("Signal fence", "value", static_cast<std::int64_t> (fenceValue),
+		"queue slot", GetQueueSlot ());
+	frameRing_.EndFrame (fenceValue);
 
-		rtvHandle.Offset (renderTargetViewDescriptorSize_);
+	// Take the next back buffer from our chain
+	if (swapChain_) {
+		currentBackBuffer_ = swapChain_->GetCurrentBufferIndex ();
 	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 /**
-Present the current frame by swapping the back buffer, then move to the
-next back buffer and also signal the fence for the current queue slot entry.
+Hand out all frames whose readback has finished. Readback buffers are
+only all in use with fewer of them than frames in flight, in which case
+we have to wait for the oldest one.
 */
-void D3D12Sample::Present ()
+void D3D12Sample::DeliverFrames ()
 {
-	swapChain_->Present (1, 0);
+	const auto waitValue = frameReadback_->GetWaitValue ();
+	if (waitValue) {
+		WaitForFence (waitValue);
+	}
 
-	// Mark the fence for the current frame.
-	const auto fenceValue = currentFenceValue_;
-	commandQueue_->Signal (frameFences_ [currentBackBuffer_].Get (), fenceValue);
-	fenceValues_[currentBackBuffer_] = fenceValue;
-	++currentFenceValue_;
+	frameReadback_->Deliver (fence_->GetCompletedValue (), readbackCallback_);
+}
 
-	// Take the next back buffer from our chain
-	currentBackBuffer_ = (currentBackBuffer_ + 1) % GetQueueSlotCount ();
+///////////////////////////////////////////////////////////////////////////////
+IResource* D3D12Sample::GetRenderTarget ()
+{
+	if (swapChain_) {
+		return swapChain_->GetBuffer (currentBackBuffer_);
+	} else {
+		return offscreenTarget_.get ();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ResourceState D3D12Sample::GetRenderTargetIdleState () const
+{
+	return swapChain_ ? ResourceState::Present : ResourceState::CopySource;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 /**
-Set up swap chain related resources, that is, the render target view, the
-fences, and the descriptor heap for the render target.
+Set up swap chain related resources, that is, the fence and the current
+back buffer if there is a swap chain. Render target views for the swap
+chain buffers are created by the device.
 */
 void D3D12Sample::SetupSwapChain ()
 {
@@ -291,141 +656,146 @@ void D3D12Sample::SetupSwapChain ()
 	// below so we can wait on the first fence correctly
 	currentFenceValue_ = 1;
 
-	// Create fences for each frame so we can protect resources and wait for
-	// any given frame
-	for (int i = 0; i < GetQueueSlotCount (); ++i) {
-		frameFenceEvents_ [i] = CreateEvent (nullptr, FALSE, FALSE, nullptr);
-		fenceValues_ [i] = 0;
-		device_->CreateFence (0, D3D12_FENCE_FLAG_NONE, 
-			IID_PPV_ARGS (&frameFences_ [i]));
-	}
+	// One fence for the whole queue. Each frame signals a new value, so we
+	// can protect resources and wait for any given frame
+	fence_ = device_->CreateFence (0);
 
-	for (int i = 0; i < GetQueueSlotCount (); ++i) {
-		swapChain_->GetBuffer (i, IID_PPV_ARGS (&renderTargets_ [i]));
+	if (swapChain_) {
+		currentBackBuffer_ = swapChain_->GetCurrentBufferIndex ();
 	}
-
-	SetupRenderTargets ();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void D3D12Sample::Initialize ()
 {
-	window_.reset (new Window ("Anteru's D3D12 sample", 512, 512));
+	threadPool_.reset (new ThreadPool);
+
+	if (readbackCallback_) {
+		CreateOffscreenTarget ();
+	} else {
+		CreateSwapChain ();
+	}
+
+	// The occlusion buffer runs at a quarter of the window resolution
+	occlusionBuffer_.reset (new OcclusionBuffer (
+		renderTargetWidth_ / 4, renderTargetHeight_ / 4, threadPool_.get ()));
+	drawQueue_.reset (new DrawQueue (threadPool_.get ()));
+	if (useBundles_) {
+		bundles_.reset (new BundleCache (*device_));
+	}
+	framePacer_.reset (new FramePacer (clock_, framePacingMode_, framePacingTarget_));
 
-	CreateDeviceAndSwapChain ();
-	CreateAllocatorsAndCommandLists ();
+	CreateCommandLists ();
+	CreateGpuProfiler ();
 	CreateViewportScissor ();
 	CreateRootSignature ();
 
 	CreatePipelineStateObject ();
 	CreateConstantBuffer ();
 
-	// Create our upload fence, command list and command allocator
+	// Create our upload command list
 	// This will be only used while creating the mesh buffer and the texture
 	// to upload data to the GPU.
-	device_->CreateFence (0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS (&uploadFence_));
-
-	ComPtr<ID3D12CommandAllocator> uploadCommandAllocator;
-	device_->CreateCommandAllocator (D3D12_COMMAND_LIST_TYPE_DIRECT,
-		IID_PPV_ARGS (&uploadCommandAllocator));
-	ComPtr<ID3D12GraphicsCommandList> uploadCommandList;
-	device_->CreateCommandList (0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-		uploadCommandAllocator.Get (), nullptr,
-		IID_PPV_ARGS (&uploadCommandList));
+	auto uploadCommandList = device_->CreateCommandList ();
+	uploadCommandList->Reset ();
 
-	CreateMeshBuffers (uploadCommandList.Get ());
-	CreateTexture (uploadCommandList.Get ());
+	CreateMeshBuffers (uploadCommandList.get ());
+	CreateTexture (uploadCommandList.get ());
 
 	uploadCommandList->Close ();
 
 	// Execute the upload and finish the command list
-	ID3D12CommandList* commandLists [] = { uploadCommandList.Get () };
-	commandQueue_->ExecuteCommandLists (std::extent<decltype(commandLists)>::value, commandLists);
-	commandQueue_->Signal (uploadFence_.Get (), 1);
+	ICommandList* commandLists [] = { uploadCommandList.get () };
+	commandQueue_->ExecuteCommandLists (commandLists, 1);
+	WaitForFence (SignalFence ());
 
-	auto waitEvent = CreateEvent (nullptr, FALSE, FALSE, nullptr);
-	WaitForFence (uploadFence_.Get (), 1, waitEvent);
-
-	// Cleanup our upload handle
-	uploadCommandAllocator->Reset ();
-
-	CloseHandle (waitEvent);
+	WaitForPipelineStates ();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void D3D12Sample::Shutdown ()
 {
-	for (auto event : frameFenceEvents_) {
-		CloseHandle (event);
+	WriteFrameStatistics (std::cout, false);
+
+	if (bundles_) {
+		std::cout << "Draw bundles: " << bundles_->GetRecordCount ()
+			<< " recorded" << std::endl;
 	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void D3D12Sample::CreateDeviceAndSwapChain ()
+void D3D12Sample::CreateSwapChain ()
 {
-	// Enable the debug layers when in debug mode
-	// If this fails, install the Graphics Tools for Windows. On Windows 10,
-	// open settings, Apps, Apps & Features, Optional features, Add Feature,
-	// and add the graphics tools
-#ifdef _DEBUG
-	ComPtr<ID3D12Debug> debugController;
-	D3D12GetDebugInterface (IID_PPV_ARGS (&debugController));
+	swapChain_ = device_->CreateSwapChain (WINDOW_WIDTH, WINDOW_HEIGHT,
+		GetBackBufferCount ());
 
-	if (debugController) {
-		debugController->EnableDebugLayer ();
-	}
-#endif
+	renderTargetWidth_ = swapChain_->GetWidth ();
+	renderTargetHeight_ = swapChain_->GetHeight ();
+	renderTargetFormat_ = swapChain_->GetRenderTargetFormat ();
 
-	DXGI_SWAP_CHAIN_DESC swapChainDesc;
-	::ZeroMemory (&swapChainDesc, sizeof (swapChainDesc));
-
-	swapChainDesc.BufferCount = GetQueueSlotCount ();
-	// This is _UNORM but we'll use a _SRGB view on this. See 
-	// CreateRenderTargetView() for details, it must match what
-	// we specify here
-	swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	swapChainDesc.BufferDesc.Width = window_->GetWidth ();
-	swapChainDesc.BufferDesc.Height = window_->GetHeight ();
-	swapChainDesc.OutputWindow = window_->GetHWND ();
-	swapChainDesc.SampleDesc.Count = 1;
-	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-	swapChainDesc.Windowed = true;
+	SetupSwapChain ();
+}
 
-	auto renderEnv = CreateDeviceAndSwapChainHelper (nullptr, D3D_FEATURE_LEVEL_11_0,
-		&swapChainDesc);
+///////////////////////////////////////////////////////////////////////////////
+/**
+A single offscreen target is enough, as the queue executes the readback
+copy of a frame before the next frame renders into the target. The target
+rests in the copy source state between frames.
+*/
+void D3D12Sample::CreateOffscreenTarget ()
+{
+	renderTargetWidth_ = offscreenWidth_;
+	renderTargetHeight_ = offscreenHeight_;
+	renderTargetFormat_ = PixelFormat::R8G8B8A8_UNorm_sRGB;
 
-	device_ = renderEnv.device;
-	commandQueue_ = renderEnv.queue;
-	swapChain_ = renderEnv.swapChain;
+	offscreenTarget_ = device_->CreateTexture2D (renderTargetWidth_,
+		renderTargetHeight_, renderTargetFormat_, ResourceState::CopySource, true);
 
-	renderTargetViewDescriptorSize_ =
-		device_->GetDescriptorHandleIncrementSize (D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+	// One buffer per frame in flight, so the buffer is always free by the
+	// time we waited for the frame which used it before
+	frameReadback_.reset (new FrameReadback (*device_, renderTargetWidth_,
+		renderTargetHeight_, renderTargetFormat_, GetQueueSlotCount ()));
 
 	SetupSwapChain ();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void D3D12Sample::CreateAllocatorsAndCommandLists ()
+void D3D12Sample::CreateCommandLists ()
 {
+	commandLists_.resize (GetQueueSlotCount ());
+
 	for (int i = 0; i < GetQueueSlotCount (); ++i) {
-		device_->CreateCommandAllocator (D3D12_COMMAND_LIST_TYPE_DIRECT,
-			IID_PPV_ARGS (&commandAllocators_ [i]));
-		device_->CreateCommandList (0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-			commandAllocators_ [i].Get (), nullptr,
-			IID_PPV_ARGS (&commandLists_ [i]));
-		commandLists_ [i]->Close ();
+		commandLists_ [i] = device_->CreateCommandList ();
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/**
+Timestamps are written into commandLists_, so there is one query range per
+frame in flight, and results are read back when the slot is reused.
+*/
+void D3D12Sample::CreateGpuProfiler ()
+{
+	const auto queryCount = GpuProfiler::GetQueryCount (MAX_GPU_SCOPES_PER_FRAME);
+
+	std::vector<ICommandList*> commandLists;
+	for (const auto& commandList : commandLists_) {
+		commandLists.push_back (commandList.get ());
+	}
+
+	gpuTimestamps_ = device_->CreateTimestampBackend (commandLists, queryCount);
+	gpuProfiler_.reset (new GpuProfiler (*gpuTimestamps_,
+		GetQueueSlotCount (), MAX_GPU_SCOPES_PER_FRAME));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void D3D12Sample::CreateViewportScissor ()
 {
-	rectScissor_ = { 0, 0, window_->GetWidth (), window_->GetHeight () };
+	rectScissor_ = { 0, 0, renderTargetWidth_, renderTargetHeight_ };
 
 	viewport_ = { 0.0f, 0.0f,
-		static_cast<float>(window_->GetWidth ()),
-		static_cast<float>(window_->GetHeight ()),
+		static_cast<float>(renderTargetWidth_),
+		static_cast<float>(renderTargetHeight_),
 		0.0f, 1.0f
 	};
 }
@@ -435,257 +805,351 @@ void D3D12Sample::CreateRootSignature ()
 {
 	// We need one descriptor heap to store our texture SRV which cannot go
 	// into the root signature. So create a SRV type heap with one entry
-	D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
-	descriptorHeapDesc.NumDescriptors = 1;
-	// This heap contains SRV, UAV or CBVs -- in our case one SRV
-	descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	descriptorHeapDesc.NodeMask = 0;
-	descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-
-	device_->CreateDescriptorHeap (&descriptorHeapDesc, IID_PPV_ARGS (&srvDescriptorHeap_));
-
-	ComPtr<ID3DBlob> rootBlob;
-	ComPtr<ID3DBlob> errorBlob;
-
-	// We have two root parameters, one is a pointer to a descriptor heap
-	// with a SRV, the second is a constant buffer view
-	CD3DX12_ROOT_PARAMETER parameters [2];
-
-	// Create a descriptor table with one entry in our descriptor heap
-	CD3DX12_DESCRIPTOR_RANGE range{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0 };
-	parameters [0].InitAsDescriptorTable (1, &range);
-	
-	// Our constant buffer view
-	parameters [1].InitAsConstantBufferView (0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+	srvDescriptorHeap_ = device_->CreateDescriptorHeap (1);
+
+	// We bind the texture and the mesh constants, which never change, and
+	// the per-frame constants. The builder decides how they are passed,
+	// the per-frame constants are small enough to be stored in the root
+	// signature directly
+	std::vector<ShaderBinding> bindings (3);
+	bindings [TEXTURE_BINDING] = { BindingType::Texture, 0, 1,
+		UpdateFrequency::Static, ShaderVisibility::All };
+	bindings [PER_FRAME_BINDING] = { BindingType::ConstantBuffer, 0,
+		static_cast<int> (PerFrameConstants::SIZE), UpdateFrequency::PerFrame,
+		ShaderVisibility::Vertex };
+	bindings [MESH_BINDING] = { BindingType::ConstantBuffer, 1,
+		static_cast<int> (MeshConstants::SIZE), UpdateFrequency::Static,
+		ShaderVisibility::Vertex };
 
 	// We don't use another descriptor heap for the sampler, instead we use a
 	// static sampler
-	CD3DX12_STATIC_SAMPLER_DESC samplers [1];
-	samplers [0].Init (0, D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT);
+	const StaticSampler sampler = { SamplerFilter::MinMagLinearMipPoint, 0 };
 
-	CD3DX12_ROOT_SIGNATURE_DESC descRootSignature;
+	rootSignatureLayout_ = BuildRootSignatureLayout (bindings, { sampler });
 
 	// Create the root signature
-	descRootSignature.Init (2, parameters, 
-		1, samplers, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-	D3D12SerializeRootSignature (&descRootSignature,
-		D3D_ROOT_SIGNATURE_VERSION_1, &rootBlob, &errorBlob);
-	device_->CreateRootSignature (0,
-		rootBlob->GetBufferPointer (),
-		rootBlob->GetBufferSize (), IID_PPV_ARGS (&rootSignature_));
+	rootSignatures_.reset (new RootSignatureCache (*device_));
+	rootSignature_ = rootSignatures_->Get (rootSignatureLayout_.desc);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void D3D12Sample::CreateConstantBuffer ()
 {
-	struct ConstantBuffer
-	{
-		float x, y, z, w;
-	};
+	if (rootSignatureLayout_.bindings [PER_FRAME_BINDING].type == RootParameterType::Constants) {
+		return;
+	}
 
-	static const ConstantBuffer cb = { 0, 0, 0, 0 };
+	// All zero
+	ConstantBufferWriter<PerFrameConstants> constants;
 
+	constantBuffers_.resize (GetQueueSlotCount ());
 	for (int i = 0; i < GetQueueSlotCount (); ++i) {
 		// These will remain in upload heap because we use them only once per
 		// frame.
-		device_->CreateCommittedResource (&CD3DX12_HEAP_PROPERTIES (D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer (sizeof (ConstantBuffer)),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS (&constantBuffers_ [i]));
+		constantBuffers_ [i] = device_->CreateBuffer (PerFrameConstants::SIZE,
+			HeapType::Upload, ResourceState::GenericRead);
 
-		void* p;
-		constantBuffers_ [i]->Map (0, nullptr, &p);
-		::memcpy (p, &cb, sizeof (cb));
-		constantBuffers_ [i]->Unmap (0, nullptr);
+		constants.WriteTo (constantBuffers_ [i]->Map ());
+		constantBuffers_ [i]->Unmap ();
 	}
+
+	FlushConstantBufferWrites ();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void D3D12Sample::CreateMeshBuffers (ID3D12GraphicsCommandList* uploadCommandList)
+/**
+Load the mesh, or use the built-in quad, optimize it for the vertex cache,
+overdraw and vertex fetch, quantize and upload it. Loaded meshes are
+centered and scaled uniformly to fit into [-1,1] in x and y, and [0,1] in
+z, as the vertex shader doesn't transform the positions.
+*/
+void D3D12Sample::CreateMeshBuffers (ICommandList* uploadCommandList)
 {
-	struct Vertex
-	{
-		float position [3];
-		float uv [2];
-	};
-
-	static const Vertex vertices [4] = {
-		// Upper Left
-		{ { -1.0f, 1.0f, 0 },{ 0, 0 } },
-		// Upper Right
-		{ { 1.0f, 1.0f, 0 },{ 1, 0 } },
-		// Bottom right
-		{ { 1.0f, -1.0f, 0 },{ 1, 1 } },
-		// Bottom left
-		{ { -1.0f, -1.0f, 0 },{ 0, 1 } }
-	};
+	const auto loadStart = clock_.Now ();
+
+	Mesh mesh;
+	if (meshPath_.empty ()) {
+		static const MeshVertex quad [4] = {
+			// Upper Left
+			{ { -1.0f, 1.0f, 0 }, { 0, 0, -1 }, { 0, 0 }, { 1, 0, 0, 1 } },
+			// Upper Right
+			{ { 1.0f, 1.0f, 0 }, { 0, 0, -1 }, { 1, 0 }, { 1, 0, 0, 1 } },
+			// Bottom right
+			{ { 1.0f, -1.0f, 0 }, { 0, 0, -1 }, { 1, 1 }, { 1, 0, 0, 1 } },
+			// Bottom left
+			{ { -1.0f, -1.0f, 0 }, { 0, 0, -1 }, { 0, 1 }, { 1, 0, 0, 1 } }
+		};
+
+		mesh.vertices.assign (std::begin (quad), std::end (quad));
+		mesh.indices = { 0, 1, 2, 2, 3, 0 };
+	} else {
+		mesh = LoadMeshFromFile (meshPath_.c_str ());
+		FitIntoClipSpace (mesh);
+	}
 
-	static const int indices [6] = {
-		0, 1, 2, 2, 3, 0
-	};
+	const auto optimizeStart = clock_.Now ();
+	const auto inputStatistics = AnalyzeVertexCache (mesh.indices, mesh.vertices.size ());
+	OptimizeMesh (mesh);
+	const auto statistics = AnalyzeVertexCache (mesh.indices, mesh.vertices.size ());
+	const auto optimizeEnd = clock_.Now ();
+
+	// Not drawn yet, built to report how the mesh would do with cluster
+	// culling
+	const auto meshletStart = clock_.Now ();
+	const auto meshlets = BuildMeshlets (mesh.indices, mesh.vertices);
+	const auto meshletStatistics = AnalyzeMeshlets (meshlets);
+	const auto meshletEnd = clock_.Now ();
+
+	const auto indexFormat = SelectIndexFormat (mesh.vertices.size ());
+	const auto indices = PackIndices (mesh.indices, indexFormat);
+
+	const auto vertices = QuantizeVertices (mesh.vertices, vertexFormat_);
+	const auto error = MeasureQuantizationError (mesh.vertices, vertices);
+
+	meshIndexCount_ = static_cast<int> (mesh.indices.size ());
+	meshBounds_ = { { 0, 0, 0 }, { 0, 0, 0 } };
+	for (std::size_t i = 0; i < mesh.vertices.size (); ++i) {
+		for (int j = 0; j < 3; ++j) {
+			const auto value = mesh.vertices [i].position [j];
+			meshBounds_.min [j] = i == 0 ? value : std::min (meshBounds_.min [j], value);
+			meshBounds_.max [j] = i == 0 ? value : std::max (meshBounds_.max [j], value);
+		}
+	}
 
-	static const int uploadBufferSize = sizeof (vertices) + sizeof (indices);
+	char line [256];
+	std::snprintf (line, sizeof (line), "Mesh: %d vertices, %d triangles, "
+		"%s indices, ACMR %.2f -> %.2f, loaded in %.1f ms, optimized in %.1f ms",
+		static_cast<int> (mesh.vertices.size ()), meshIndexCount_ / 3,
+		indexFormat == IndexFormat::UInt16 ? "16-bit" : "32-bit",
+		inputStatistics.acmr, statistics.acmr,
+		(optimizeStart - loadStart) * 1000, (optimizeEnd - optimizeStart) * 1000);
+	std::cout << line << std::endl;
+
+	// Every vertex shader invocation fetches one vertex, compared against
+	// float positions and texture coordinates
+	const int floatStride = 20;
+	const auto fetched = statistics.acmr * (meshIndexCount_ / 3) / 1024;
+	std::snprintf (line, sizeof (line), "Vertices: %d bytes instead of %d, "
+		"%.0f KiB fetched per draw instead of %.0f KiB, max error %.2g "
+		"of the bounds for positions, %.2g for texture coordinates",
+		vertices.stride, floatStride, fetched * vertices.stride, fetched * floatStride,
+		error.maxPosition, error.maxUv);
+	std::cout << line << std::endl;
+
+	std::snprintf (line, sizeof (line), "Meshlets: %d with %.1f vertices and "
+		"%.1f triangles on average, vertices duplicated %.2fx, %.0f%% culled by "
+		"their normal cones on average, built in %.1f ms",
+		meshletStatistics.meshletCount, meshletStatistics.averageVertices,
+		meshletStatistics.averageTriangles, meshletStatistics.vertexDuplication,
+		meshletStatistics.backfaceCulledShare * 100, (meshletEnd - meshletStart) * 1000);
+	std::cout << line << std::endl;
+
+	ConstantBufferWriter<MeshConstants> constants;
+	constants.Set<MESH_POSITION_SCALE> ({ vertices.positionScale [0],
+		vertices.positionScale [1], vertices.positionScale [2], 0 });
+	constants.Set<MESH_POSITION_OFFSET> ({ vertices.positionOffset [0],
+		vertices.positionOffset [1], vertices.positionOffset [2], 0 });
+	constants.Set<MESH_UV_SCALE_OFFSET> ({ vertices.uvScale [0],
+		vertices.uvScale [1], vertices.uvOffset [0], vertices.uvOffset [1] });
+
+	// Read by every draw, but small enough to stay in the upload heap
+	meshConstantBuffer_ = device_->CreateBuffer (MeshConstants::SIZE,
+		HeapType::Upload, ResourceState::GenericRead);
+	constants.WriteTo (meshConstantBuffer_->Map ());
+	meshConstantBuffer_->Unmap ();
+	FlushConstantBufferWrites ();
+
+	const auto vertexBufferSize = static_cast<int> (vertices.data.size ());
+	const auto indexBufferSize = static_cast<int> (indices.size ());
+	const auto uploadBufferSize = vertexBufferSize + indexBufferSize;
 
 	// Create upload buffer on CPU
-	device_->CreateCommittedResource (&CD3DX12_HEAP_PROPERTIES (D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer (uploadBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS (&uploadBuffer_));
+	uploadBuffer_ = device_->CreateBuffer (uploadBufferSize,
+		HeapType::Upload, ResourceState::GenericRead);
 
 	// Create vertex & index buffer on the GPU
-	// HEAP_TYPE_DEFAULT is on GPU, we also initialize with COPY_DEST state
-	// so we don't have to transition into this before copying into them
-	device_->CreateCommittedResource (&CD3DX12_HEAP_PROPERTIES (D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer (sizeof (vertices)),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS (&vertexBuffer_));
-
-	device_->CreateCommittedResource (&CD3DX12_HEAP_PROPERTIES (D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer (sizeof (indices)),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS (&indexBuffer_));
+	// HeapType::Default is on GPU, we also initialize with CopyDestination
+	// state so we don't have to transition into this before copying into them
+	vertexBuffer_ = device_->CreateBuffer (vertexBufferSize,
+		HeapType::Default, ResourceState::CopyDestination);
+
+	indexBuffer_ = device_->CreateBuffer (indexBufferSize,
+		HeapType::Default, ResourceState::CopyDestination);
 
 	// Create buffer views
-	vertexBufferView_.BufferLocation = vertexBuffer_->GetGPUVirtualAddress ();
-	vertexBufferView_.SizeInBytes = sizeof (vertices);
-	vertexBufferView_.StrideInBytes = sizeof (Vertex);
+	vertexBufferView_.gpuAddress = vertexBuffer_->GetGpuAddress ();
+	vertexBufferView_.size = vertexBufferSize;
+	vertexBufferView_.stride = vertices.stride;
 
-	indexBufferView_.BufferLocation = indexBuffer_->GetGPUVirtualAddress ();
-	indexBufferView_.SizeInBytes = sizeof (indices);
-	indexBufferView_.Format = DXGI_FORMAT_R32_UINT;
+	indexBufferView_.gpuAddress = indexBuffer_->GetGpuAddress ();
+	indexBufferView_.size = indexBufferSize;
+	indexBufferView_.format = indexFormat;
 
 	// Copy data on CPU into the upload buffer
-	void* p;
-	uploadBuffer_->Map (0, nullptr, &p);
-	::memcpy (p, vertices, sizeof (vertices));
-	::memcpy (static_cast<unsigned char*>(p) + sizeof (vertices), 
-		indices, sizeof (indices));
-	uploadBuffer_->Unmap (0, nullptr);
+	void* p = uploadBuffer_->Map ();
+	::memcpy (p, vertices.data.data (), vertexBufferSize);
+	::memcpy (static_cast<unsigned char*>(p) + vertexBufferSize, 
+		indices.data (), indexBufferSize);
+	uploadBuffer_->Unmap ();
 
 	// Copy data from upload buffer on CPU into the index/vertex buffer on 
 	// the GPU
-	uploadCommandList->CopyBufferRegion (vertexBuffer_.Get (), 0,
-		uploadBuffer_.Get (), 0, sizeof (vertices));
-	uploadCommandList->CopyBufferRegion (indexBuffer_.Get (), 0,
-		uploadBuffer_.Get (), sizeof (vertices), sizeof (indices));
+	uploadCommandList->CopyBufferRegion (vertexBuffer_.get (), 0,
+		uploadBuffer_.get (), 0, vertexBufferSize);
+	uploadCommandList->CopyBufferRegion (indexBuffer_.get (), 0,
+		uploadBuffer_.get (), vertexBufferSize, indexBufferSize);
 
 	// Barriers, batch them together
-	CD3DX12_RESOURCE_BARRIER barriers [2] = {
-		CD3DX12_RESOURCE_BARRIER::Transition (vertexBuffer_.Get (),
-		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
-		CD3DX12_RESOURCE_BARRIER::Transition (indexBuffer_.Get (),
-			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER)
+	const ResourceTransition barriers [2] = {
+		{ vertexBuffer_.get (),
+			ResourceState::CopyDestination, ResourceState::VertexAndConstantBuffer },
+		{ indexBuffer_.get (),
+			ResourceState::CopyDestination, ResourceState::IndexBuffer }
 	};
 
-	uploadCommandList->ResourceBarrier (2, barriers);
+	uploadCommandList->ResourceBarrier (barriers, 2);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void D3D12Sample::CreateTexture (ID3D12GraphicsCommandList* uploadCommandList)
+void D3D12Sample::CreateTexture (ICommandList* uploadCommandList)
 {
 	int width = 0, height = 0;
 
-	imageData_ = LoadImageFromMemory (SampleTexture, sizeof (SampleTexture),
-		1 /* tight row packing */, &width, &height);
-	device_->CreateCommittedResource (&CD3DX12_HEAP_PROPERTIES (D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Tex2D (DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, width, height, 1, 1),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS (&image_));
-
-	const auto uploadBufferSize = GetRequiredIntermediateSize (image_.Get (), 0, 1);
-	device_->CreateCommittedResource (&CD3DX12_HEAP_PROPERTIES (D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer (uploadBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS (&uploadImage_));
-
-	D3D12_SUBRESOURCE_DATA srcData;
-	srcData.pData = imageData_.data ();
-	srcData.RowPitch = width * 4;
-	srcData.SlicePitch = width * height * 4;
-
-	UpdateSubresources (uploadCommandList, image_.Get (), uploadImage_.Get (), 0, 0, 1, &srcData);
-	uploadCommandList->ResourceBarrier (1, &CD3DX12_RESOURCE_BARRIER::Transition (image_.Get (),
-		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc = {};
-	shaderResourceViewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	shaderResourceViewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	shaderResourceViewDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-	shaderResourceViewDesc.Texture2D.MipLevels = 1;
-	shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
-	shaderResourceViewDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-
-	device_->CreateShaderResourceView (image_.Get (), &shaderResourceViewDesc,
-		srvDescriptorHeap_->GetCPUDescriptorHandleForHeapStart ());
+	const auto pixels = LoadImageFromMemory (SampleTexture, sizeof (SampleTexture),
+		1, &width, &height);
+
+	// The packed rows are aligned for the upload buffer, so we can copy the
+	// image in one go
+	auto texture = PackTexture (pixels.data (), width, height, width * 4,
+		texturePacking_, threadPool_.get ());
+	imageData_.swap (texture.data);
+
+	std::cout << "Texture " << width << "x" << height << " stored as "
+		<< GetPixelFormatName (texture.format) << ", "
+		<< texture.packedSize / 1024 << " KiB instead of "
+		<< texture.originalSize / 1024 << " KiB ("
+		<< (texture.originalSize - texture.packedSize) / 1024 << " KiB saved)\n";
+
+	image_ = device_->CreateTexture2D (width, height,
+		texture.format, ResourceState::CopyDestination);
+
+	uploadImage_ = device_->CreateBuffer (imageData_.size (),
+		HeapType::Upload, ResourceState::GenericRead);
+
+	void* p = uploadImage_->Map ();
+	::memcpy (p, imageData_.data (), imageData_.size ());
+	uploadImage_->Unmap ();
+
+	uploadCommandList->CopyBufferToTexture (image_.get (), uploadImage_.get (),
+		0, texture.rowPitch);
+
+	const ResourceTransition barrier = {
+		image_.get (),
+		ResourceState::CopyDestination, ResourceState::PixelShaderResource
+	};
+	uploadCommandList->ResourceBarrier (&barrier, 1);
+
+	srvDescriptorHeap_->CreateShaderResourceView (0, image_.get (),
+		texture.format, texture.mapping);
 }
 
+namespace {
 ///////////////////////////////////////////////////////////////////////////////
-void D3D12Sample::CreatePipelineStateObject ()
+/**
+Use the bytecode of the precompiled permutation if there is one. If the
+build had no shader compiler, the shader is compiled at runtime instead.
+*/
+void UsePrecompiledShader (const ShaderArchive& archive, ShaderDesc& desc,
+	const std::uint64_t key)
 {
-	static const D3D12_INPUT_ELEMENT_DESC layout [] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, 
-			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, 
-			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
+	const auto shader = archive.Find (key);
+	if (shader.data) {
+		desc.bytecode = shader.data;
+		desc.bytecodeSize = shader.size;
+	}
+}
+}
 
-	ComPtr<ID3DBlob> vertexShader;
-	D3DCompile (SampleShaders, sizeof (SampleShaders),
-		"", nullptr, nullptr,
-		"VS_main", "vs_5_0", 0, 0, &vertexShader, nullptr);
-
-	ComPtr<ID3DBlob> pixelShader;
-	D3DCompile (SampleShaders, sizeof (SampleShaders),
-		"", nullptr, nullptr,
-		"PS_main", "ps_5_0", 0, 0, &pixelShader, nullptr);
-
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-	psoDesc.VS.BytecodeLength = vertexShader->GetBufferSize ();
-	psoDesc.VS.pShaderBytecode = vertexShader->GetBufferPointer ();
-	psoDesc.PS.BytecodeLength = pixelShader->GetBufferSize ();
-	psoDesc.PS.pShaderBytecode = pixelShader->GetBufferPointer ();
-	psoDesc.pRootSignature = rootSignature_.Get ();
-	psoDesc.NumRenderTargets = 1;
-	psoDesc.RTVFormats [0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-	psoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
-	psoDesc.InputLayout.NumElements = std::extent<decltype(layout)>::value;
-	psoDesc.InputLayout.pInputElementDescs = layout;
-	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC (D3D12_DEFAULT);
-	psoDesc.BlendState = CD3DX12_BLEND_DESC (D3D12_DEFAULT);
+///////////////////////////////////////////////////////////////////////////////
+void D3D12Sample::CreatePipelineStateObject ()
+{
+	PipelineStateDesc psoDesc;
+	psoDesc.rootSignature = rootSignature_;
+	psoDesc.vertexShader = { SampleShaders, sizeof (SampleShaders),
+		"VS_main", "vs_5_0", {}, nullptr, 0 };
+	psoDesc.pixelShader = { SampleShaders, sizeof (SampleShaders),
+		"PS_main", "ps_5_0", {}, nullptr, 0 };
+
+	// The keys are computed at compile time, looking up a permutation is
+	// just a search in the archive index
+	if (useShaderArchive_) {
+		const ShaderArchive shaderArchive (ShaderArchiveData, sizeof (ShaderArchiveData));
+		UsePrecompiledShader (shaderArchive, psoDesc.vertexShader,
+			GetShaderPermutationKey ("VS_main", 0));
+		UsePrecompiledShader (shaderArchive, psoDesc.pixelShader,
+			GetShaderPermutationKey ("PS_main", 0));
+	}
+	// The decode constants are only known once the mesh is loaded, but
+	// the layout only depends on the format
+	psoDesc.inputLayout = GetInputLayout (vertexFormat_);
+	psoDesc.renderTargetFormat = renderTargetFormat_;
 	// Simple alpha blending
-	psoDesc.BlendState.RenderTarget [0].BlendEnable = true;
-	psoDesc.BlendState.RenderTarget [0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
-	psoDesc.BlendState.RenderTarget [0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
-	psoDesc.BlendState.RenderTarget [0].BlendOp = D3D12_BLEND_OP_ADD;
-	psoDesc.BlendState.RenderTarget [0].SrcBlendAlpha = D3D12_BLEND_ONE;
-	psoDesc.BlendState.RenderTarget [0].DestBlendAlpha = D3D12_BLEND_ZERO;
-	psoDesc.BlendState.RenderTarget [0].BlendOpAlpha = D3D12_BLEND_OP_ADD;
-	psoDesc.BlendState.RenderTarget [0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
-	psoDesc.SampleDesc.Count = 1;
-	psoDesc.DepthStencilState.DepthEnable = false;
-	psoDesc.DepthStencilState.StencilEnable = false;
-	psoDesc.SampleMask = 0xFFFFFFFF;
-	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	psoDesc.blendMode = BlendMode::AlphaBlend;
 
-	device_->CreateGraphicsPipelineState (&psoDesc, IID_PPV_ARGS (&pso_));
-}
+	// Without a cache, the device compiles the shaders itself
+	if (! shaderCachePath_.empty ()) {
+		shaderCompiler_ = device_->CreateShaderCompiler ();
+		shaderCache_.reset (new ShaderCache (*shaderCompiler_, shaderCachePath_));
+	}
+
+	if (! pipelineCachePath_.empty ()) {
+		pipelineCache_.reset (new PipelineCache (pipelineCachePath_,
+			device_->GetAdapterIdentity ()));
+	}
+
+	pipelineStates_.reset (new PipelineStateManager (*device_, *threadPool_,
+		shaderCache_.get (), pipelineCache_.get ()));
+
+	// Shaders are compiled and the pipeline state is created in the
+	// background while the rest of Initialize runs
+	pso_ = pipelineStates_->Request (psoDesc);
 }
 
-int main (int argc, char* argv [])
+///////////////////////////////////////////////////////////////////////////////
+/**
+The sample has no simpler pipeline state to draw with in the meantime, so
+all of them have to be ready before the first frame.
+*/
+void D3D12Sample::WaitForPipelineStates ()
 {
-	anteru::D3D12Sample sample;
-	sample.Run (512);
+	TraceScope scope ("Wait for pipeline states");
+
+	pipelineStates_->WaitIdle ();
+	// Throws if the creation failed
+	pso_.Wait ();
+
+	if (shaderCache_) {
+		if (! shaderCache_->Save ()) {
+			std::cerr << "Could not write shader cache " << shaderCachePath_ << std::endl;
+		}
+
+		std::cout << "Shader cache: " << shaderCache_->GetHitCount () << " hits, "
+			<< shaderCache_->GetMissCount () << " compiled" << std::endl;
+	}
+
+	if (pipelineCache_) {
+		if (pipelineCache_->WasInvalidated ()) {
+			std::cout << "Pipeline cache was created on a different adapter "
+				"or driver, rebuilding it" << std::endl;
+		}
+
+		if (! pipelineCache_->Save ()) {
+			std::cerr << "Could not write pipeline cache " << pipelineCachePath_ << std::endl;
+		}
+
+		std::cout << "Pipeline cache: " << pipelineCache_->GetHitCount () << " hits, "
+			<< pipelineCache_->GetMissCount () << " created, "
+			<< pipelineCache_->GetPrunedCount () << " pruned" << std::endl;
+	}
+}
 }
\ No newline at end of file
@@ -0,0 +1,1120 @@
+#include "Deflate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ThreadPool.h"
+
+namespace anteru {
+namespace {
+const int MAX_CODE_BITS = 15;
+const int LITERAL_LENGTH_CODES = 288;
+const int DISTANCE_CODES = 32;
+
+const std::uint16_t LENGTH_BASE [29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+const std::uint8_t LENGTH_EXTRA [29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+const std::uint16_t DISTANCE_BASE [30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+
+const std::uint8_t DISTANCE_EXTRA [30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Order in which code length code lengths are stored
+const std::uint8_t CODE_LENGTH_ORDER [19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Canonical Huffman code, stored as the number of codes per length and the
+symbols sorted by code. Decoding walks the lengths one bit at a time, which
+is fast enough for the sizes we load at startup.
+*/
+struct Huffman
+{
+	std::uint16_t counts [MAX_CODE_BITS + 1];
+	std::uint16_t symbols [LITERAL_LENGTH_CODES];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void BuildHuffman (Huffman& huffman, const std::uint8_t* lengths, const int count)
+{
+	std::fill (huffman.counts, huffman.counts + MAX_CODE_BITS + 1, 0);
+	for (int i = 0; i < count; ++i) {
+		++huffman.counts [lengths [i]];
+	}
+	huffman.counts [0] = 0;
+
+	// Over-subscribed codes cannot be decoded, incomplete ones are allowed
+	int left = 1;
+	for (int length = 1; length <= MAX_CODE_BITS; ++length) {
+		left = left * 2 - huffman.counts [length];
+		if (left < 0) {
+			throw std::runtime_error ("Invalid Huffman code.");
+		}
+	}
+
+	std::uint16_t offsets [MAX_CODE_BITS + 1];
+	offsets [1] = 0;
+	for (int length = 1; length < MAX_CODE_BITS; ++length) {
+		offsets [length + 1] = offsets [length] + huffman.counts [length];
+	}
+
+	for (int i = 0; i < count; ++i) {
+		if (lengths [i] != 0) {
+			huffman.symbols [offsets [lengths [i]]++] = static_cast<std::uint16_t> (i);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+class BitReader
+{
+public:
+	BitReader (const std::uint8_t* data, const std::size_t size)
+		: data_ (data)
+		, size_ (size)
+	{
+	}
+
+	int GetBits (const int count)
+	{
+		while (bitCount_ < count) {
+			if (position_ == size_) {
+				throw std::runtime_error ("Unexpected end of deflate stream.");
+			}
+
+			bitBuffer_ |= static_cast<std::uint32_t> (data_ [position_++]) << bitCount_;
+			bitCount_ += 8;
+		}
+
+		const int result = static_cast<int> (bitBuffer_ & ((1u << count) - 1));
+		bitBuffer_ >>= count;
+		bitCount_ -= count;
+		return result;
+	}
+
+	int Decode (const Huffman& huffman)
+	{
+		int code = 0, first = 0, index = 0;
+		for (int length = 1; length <= MAX_CODE_BITS; ++length) {
+			code |= GetBits (1);
+			const int count = huffman.counts [length];
+			if (code - count < first) {
+				return huffman.symbols [index + (code - first)];
+			}
+
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+
+		throw std::runtime_error ("Invalid Huffman code.");
+	}
+
+	/**
+	Drop the remaining bits of the current byte.
+	*/
+	void AlignToByte ()
+	{
+		bitBuffer_ = 0;
+		bitCount_ = 0;
+	}
+
+	std::size_t GetPosition () const
+	{
+		return position_;
+	}
+
+	void Skip (const std::size_t count)
+	{
+		position_ += count;
+	}
+
+private:
+	const std::uint8_t* data_;
+	std::size_t size_;
+	std::size_t position_ = 0;
+	std::uint32_t bitBuffer_ = 0;
+	int bitCount_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void InflateBlock (BitReader& reader, std::vector<std::uint8_t>& output,
+	const Huffman& literals, const Huffman& distances)
+{
+	for (;;) {
+		const int symbol = reader.Decode (literals);
+
+		if (symbol < 256) {
+			output.push_back (static_cast<std::uint8_t> (symbol));
+		} else if (symbol == 256) {
+			return;
+		} else {
+			const int lengthCode = symbol - 257;
+			if (lengthCode >= 29) {
+				throw std::runtime_error ("Invalid deflate length code.");
+			}
+
+			const int length = LENGTH_BASE [lengthCode] +
+				reader.GetBits (LENGTH_EXTRA [lengthCode]);
+
+			const int distanceCode = reader.Decode (distances);
+			if (distanceCode >= 30) {
+				throw std::runtime_error ("Invalid deflate distance code.");
+			}
+
+			const std::size_t distance = DISTANCE_BASE [distanceCode] +
+				reader.GetBits (DISTANCE_EXTRA [distanceCode]);
+			if (distance > output.size ()) {
+				throw std::runtime_error ("Invalid deflate distance.");
+			}
+
+			// Source and target may overlap, so this has to go byte by byte
+			std::size_t source = output.size () - distance;
+			for (int i = 0; i < length; ++i) {
+				output.push_back (output [source++]);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BuildFixedHuffman (Huffman& literals, Huffman& distances)
+{
+	std::uint8_t lengths [LITERAL_LENGTH_CODES];
+	std::fill (lengths, lengths + 144, 8);
+	std::fill (lengths + 144, lengths + 256, 9);
+	std::fill (lengths + 256, lengths + 280, 7);
+	std::fill (lengths + 280, lengths + 288, 8);
+	BuildHuffman (literals, lengths, LITERAL_LENGTH_CODES);
+
+	std::fill (lengths, lengths + DISTANCE_CODES, 5);
+	BuildHuffman (distances, lengths, DISTANCE_CODES);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ReadDynamicHuffman (BitReader& reader, Huffman& literals, Huffman& distances)
+{
+	const int literalCount = reader.GetBits (5) + 257;
+	const int distanceCount = reader.GetBits (5) + 1;
+	const int codeLengthCount = reader.GetBits (4) + 4;
+
+	if (literalCount > 286 || distanceCount > 30) {
+		throw std::runtime_error ("Invalid deflate block header.");
+	}
+
+	std::uint8_t lengths [LITERAL_LENGTH_CODES + DISTANCE_CODES] = {};
+	for (int i = 0; i < codeLengthCount; ++i) {
+		lengths [CODE_LENGTH_ORDER [i]] = static_cast<std::uint8_t> (reader.GetBits (3));
+	}
+
+	Huffman codeLengths;
+	BuildHuffman (codeLengths, lengths, 19);
+
+	// Literal/length and distance code lengths are one run-length coded
+	// sequence, repeats may cross from one into the other
+	int index = 0;
+	while (index < literalCount + distanceCount) {
+		const int symbol = reader.Decode (codeLengths);
+
+		if (symbol < 16) {
+			lengths [index++] = static_cast<std::uint8_t> (symbol);
+			continue;
+		}
+
+		std::uint8_t value = 0;
+		int repeat;
+		if (symbol == 16) {
+			if (index == 0) {
+				throw std::runtime_error ("Invalid deflate code length repeat.");
+			}
+
+			value = lengths [index - 1];
+			repeat = 3 + reader.GetBits (2);
+		} else if (symbol == 17) {
+			repeat = 3 + reader.GetBits (3);
+		} else {
+			repeat = 11 + reader.GetBits (7);
+		}
+
+		if (index + repeat > literalCount + distanceCount) {
+			throw std::runtime_error ("Invalid deflate code length repeat.");
+		}
+
+		std::fill (lengths + index, lengths + index + repeat, value);
+		index += repeat;
+	}
+
+	if (lengths [256] == 0) {
+		throw std::runtime_error ("Deflate block without end-of-block code.");
+	}
+
+	BuildHuffman (literals, lengths, literalCount);
+	BuildHuffman (distances, lengths + literalCount, distanceCount);
+}
+
+const int WINDOW_SIZE = 32768;
+const int MIN_MATCH = 4;
+const int MAX_MATCH = 258;
+const int HASH_BITS = 15;
+const int END_OF_BLOCK = 256;
+const int MAX_CODE_LENGTH_BITS = 7;
+const int MAX_STORED_BLOCK_SIZE = 65535;
+
+// Candidates checked per position. Going from 4 to 16 saves about 2% on
+// rendered frames, but takes twice as long
+const int MAX_CHAIN_LENGTH = 4;
+// Positions inside longer matches are not hashed, which speeds up runs a
+// lot, and costs little ratio as the match end gets hashed anyway
+const int MAX_INSERT_LENGTH = 32;
+// Number of symbols after which a block gets new Huffman codes
+const int MAX_BLOCK_SYMBOLS = 32768;
+
+// Size of the chunks compressed in parallel by ZlibCompress
+const std::size_t COMPRESS_CHUNK_SIZE = 256 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+A literal if distance is 0, otherwise a match.
+*/
+struct Symbol
+{
+	std::uint16_t value;
+	std::uint16_t distance;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct SymbolCodeTables
+{
+	SymbolCodeTables ()
+	{
+		// Length 258 has its own code, which must take precedence over the
+		// last range of code 27, so assign in ascending order
+		for (int code = 0; code < 29; ++code) {
+			const int end = std::min (LENGTH_BASE [code] + (1 << LENGTH_EXTRA [code]),
+				MAX_MATCH + 1);
+			for (int length = LENGTH_BASE [code]; length < end; ++length) {
+				lengthCodes [length] = static_cast<std::uint8_t> (code);
+			}
+		}
+
+		for (int code = 0; code < 30; ++code) {
+			const int end = DISTANCE_BASE [code] + (1 << DISTANCE_EXTRA [code]);
+			for (int distance = DISTANCE_BASE [code]; distance < end; ++distance) {
+				distanceCodes [distance] = static_cast<std::uint8_t> (code);
+			}
+		}
+	}
+
+	std::uint8_t lengthCodes [MAX_MATCH + 1];
+	std::uint8_t distanceCodes [WINDOW_SIZE + 1];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+const SymbolCodeTables& GetSymbolCodeTables ()
+{
+	static const SymbolCodeTables tables;
+	return tables;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+class BitWriter
+{
+public:
+	explicit BitWriter (std::vector<std::uint8_t>& output)
+		: output_ (output)
+	{
+	}
+
+	/**
+	Write the lowest count bits of bits, count must not exceed 32.
+	*/
+	void PutBits (const std::uint32_t bits, const int count)
+	{
+		bitBuffer_ |= static_cast<std::uint64_t> (bits) << bitCount_;
+		bitCount_ += count;
+
+		if (bitCount_ >= 32) {
+			// Little-endian, so the first bits end up in the first byte
+			const auto size = output_.size ();
+			output_.resize (size + 4);
+			std::memcpy (output_.data () + size, &bitBuffer_, 4);
+			bitBuffer_ >>= 32;
+			bitCount_ -= 32;
+		}
+	}
+
+	/**
+	Fill the current byte with zeros.
+	*/
+	void AlignToByte ()
+	{
+		while (bitCount_ > 0) {
+			output_.push_back (static_cast<std::uint8_t> (bitBuffer_));
+			bitBuffer_ >>= 8;
+			bitCount_ -= 8;
+		}
+
+		bitBuffer_ = 0;
+		bitCount_ = 0;
+	}
+
+	/**
+	Append bytes, the writer must be byte aligned.
+	*/
+	void PutBytes (const std::uint8_t* bytes, const std::size_t count)
+	{
+		output_.insert (output_.end (), bytes, bytes + count);
+	}
+
+private:
+	std::vector<std::uint8_t>& output_;
+	std::uint64_t bitBuffer_ = 0;
+	int bitCount_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+In-place computation of minimum redundancy code lengths by Moffat and
+Katajainen. On entry, a contains the frequencies in ascending order, on
+exit the code lengths, longest first.
+*/
+void CalculateMinimumRedundancy (std::uint32_t* a, const int n)
+{
+	if (n == 1) {
+		a [0] = 1;
+		return;
+	}
+
+	// Build the tree, a [i] points to the parent of internal nodes
+	a [0] += a [1];
+	int root = 0, leaf = 2;
+	for (int next = 1; next < n - 1; ++next) {
+		if (leaf >= n || a [root] < a [leaf]) {
+			a [next] = a [root];
+			a [root++] = next;
+		} else {
+			a [next] = a [leaf++];
+		}
+
+		if (leaf >= n || (root < next && a [root] < a [leaf])) {
+			a [next] += a [root];
+			a [root++] = next;
+		} else {
+			a [next] += a [leaf++];
+		}
+	}
+
+	// Depths of the internal nodes
+	a [n - 2] = 0;
+	for (int next = n - 3; next >= 0; --next) {
+		a [next] = a [a [next]] + 1;
+	}
+
+	// Depths of the leaves
+	int available = 1, used = 0, depth = 0;
+	int root2 = n - 2, next = n - 1;
+	while (available > 0) {
+		while (root2 >= 0 && static_cast<int> (a [root2]) == depth) {
+			++used;
+			--root2;
+		}
+
+		while (available > used) {
+			a [next--] = depth;
+			--available;
+		}
+
+		available = 2 * used;
+		++depth;
+		used = 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Compute length limited Huffman code lengths for count symbols. Unused
+symbols get length 0.
+*/
+void BuildCodeLengths (const std::uint32_t* frequencies, const int count,
+	const int maxLength, std::uint8_t* lengths)
+{
+	std::fill (lengths, lengths + count, 0);
+
+	int symbols [LITERAL_LENGTH_CODES];
+	int usedCount = 0;
+	for (int i = 0; i < count; ++i) {
+		if (frequencies [i] != 0) {
+			symbols [usedCount++] = i;
+		}
+	}
+
+	if (usedCount == 0) {
+		return;
+	}
+
+	std::stable_sort (symbols, symbols + usedCount, [=] (const int a, const int b) {
+		return frequencies [a] < frequencies [b];
+	});
+
+	std::uint32_t depths [LITERAL_LENGTH_CODES];
+	for (int i = 0; i < usedCount; ++i) {
+		depths [i] = frequencies [symbols [i]];
+	}
+
+	CalculateMinimumRedundancy (depths, usedCount);
+
+	// Clamp to maxLength, then lengthen shorter codes until the code is no
+	// longer over-subscribed
+	int lengthCounts [MAX_CODE_BITS + 1] = {};
+	for (int i = 0; i < usedCount; ++i) {
+		++lengthCounts [std::min (static_cast<int> (depths [i]), maxLength)];
+	}
+
+	std::uint32_t total = 0;
+	for (int length = 1; length <= maxLength; ++length) {
+		total += static_cast<std::uint32_t> (lengthCounts [length]) << (maxLength - length);
+	}
+
+	while (total > (1u << maxLength)) {
+		--lengthCounts [maxLength];
+		for (int length = maxLength - 1; length > 0; --length) {
+			if (lengthCounts [length] != 0) {
+				--lengthCounts [length];
+				lengthCounts [length + 1] += 2;
+				break;
+			}
+		}
+
+		--total;
+	}
+
+	// Least frequent symbols get the longest codes
+	int index = 0;
+	for (int length = maxLength; length > 0; --length) {
+		for (int i = 0; i < lengthCounts [length]; ++i) {
+			lengths [symbols [index++]] = static_cast<std::uint8_t> (length);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Assign canonical codes, bit-reversed as deflate writes them starting with
+the most significant bit.
+*/
+void BuildCodes (const std::uint8_t* lengths, const int count,
+	std::uint16_t* codes)
+{
+	int lengthCounts [MAX_CODE_BITS + 1] = {};
+	for (int i = 0; i < count; ++i) {
+		++lengthCounts [lengths [i]];
+	}
+	lengthCounts [0] = 0;
+
+	int nextCode [MAX_CODE_BITS + 1];
+	int code = 0;
+	for (int length = 1; length <= MAX_CODE_BITS; ++length) {
+		code = (code + lengthCounts [length - 1]) << 1;
+		nextCode [length] = code;
+	}
+
+	for (int i = 0; i < count; ++i) {
+		const int length = lengths [i];
+		if (length == 0) {
+			continue;
+		}
+
+		int value = nextCode [length]++;
+		int reversed = 0;
+		for (int bit = 0; bit < length; ++bit) {
+			reversed = (reversed << 1) | (value & 1);
+			value >>= 1;
+		}
+
+		codes [i] = static_cast<std::uint16_t> (reversed);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WriteStoredBlocks (BitWriter& writer, const std::uint8_t* bytes,
+	const std::size_t size, const bool last)
+{
+	std::size_t offset = 0;
+	do {
+		const auto length = std::min (size - offset,
+			static_cast<std::size_t> (MAX_STORED_BLOCK_SIZE));
+		const bool lastBlock = last && (offset + length == size);
+
+		writer.PutBits (lastBlock ? 1 : 0, 1);
+		writer.PutBits (0, 2);
+		writer.AlignToByte ();
+		writer.PutBits (static_cast<std::uint32_t> (length), 16);
+		writer.PutBits (static_cast<std::uint32_t> (~length & 0xFFFF), 16);
+		writer.PutBytes (bytes + offset, length);
+
+		offset += length;
+	} while (offset < size);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Write symbols as a block with dynamic Huffman codes, or the bytes they
+encode as stored blocks if that is smaller.
+*/
+void WriteBlock (BitWriter& writer, const std::vector<Symbol>& symbols,
+	const std::uint8_t* bytes, const std::size_t size, const bool last)
+{
+	const auto& tables = GetSymbolCodeTables ();
+
+	std::uint32_t literalFrequencies [LITERAL_LENGTH_CODES] = {};
+	std::uint32_t distanceFrequencies [DISTANCE_CODES] = {};
+	std::uint64_t extraBits = 0;
+
+	for (const auto& symbol : symbols) {
+		if (symbol.distance == 0) {
+			++literalFrequencies [symbol.value];
+		} else {
+			const int lengthCode = tables.lengthCodes [symbol.value];
+			const int distanceCode = tables.distanceCodes [symbol.distance];
+			++literalFrequencies [257 + lengthCode];
+			++distanceFrequencies [distanceCode];
+			extraBits += LENGTH_EXTRA [lengthCode] + DISTANCE_EXTRA [distanceCode];
+		}
+	}
+	++literalFrequencies [END_OF_BLOCK];
+
+	std::uint8_t literalLengths [286], distanceLengths [30];
+	BuildCodeLengths (literalFrequencies, 286, MAX_CODE_BITS, literalLengths);
+	BuildCodeLengths (distanceFrequencies, 30, MAX_CODE_BITS, distanceLengths);
+
+	int literalCount = 286;
+	while (literalCount > 257 && literalLengths [literalCount - 1] == 0) {
+		--literalCount;
+	}
+
+	// A single distance code of length 0 signals that there are no matches
+	int distanceCount = 30;
+	while (distanceCount > 1 && distanceLengths [distanceCount - 1] == 0) {
+		--distanceCount;
+	}
+
+	// Both sets of lengths are coded as one sequence, and runs may cross
+	// from one into the other
+	std::uint8_t lengths [286 + 30];
+	std::copy (literalLengths, literalLengths + literalCount, lengths);
+	std::copy (distanceLengths, distanceLengths + distanceCount,
+		lengths + literalCount);
+	const int lengthCount = literalCount + distanceCount;
+
+	// Run-length encode the code lengths, packed as symbol | extra << 8
+	std::uint16_t lengthSymbols [286 + 30];
+	int lengthSymbolCount = 0;
+	std::uint32_t codeLengthFrequencies [19] = {};
+
+	for (int i = 0; i < lengthCount;) {
+		const int length = lengths [i];
+		int run = 1;
+		while (i + run < lengthCount && lengths [i + run] == length) {
+			++run;
+		}
+
+		if (length == 0 && run >= 11) {
+			run = std::min (run, 138);
+			lengthSymbols [lengthSymbolCount++] = static_cast<std::uint16_t> (18 | ((run - 11) << 8));
+			++codeLengthFrequencies [18];
+		} else if (length == 0 && run >= 3) {
+			lengthSymbols [lengthSymbolCount++] = static_cast<std::uint16_t> (17 | ((run - 3) << 8));
+			++codeLengthFrequencies [17];
+		} else if (length != 0 && run >= 4) {
+			run = std::min (run, 7);
+			lengthSymbols [lengthSymbolCount++] = static_cast<std::uint16_t> (length);
+			lengthSymbols [lengthSymbolCount++] = static_cast<std::uint16_t> (16 | ((run - 4) << 8));
+			++codeLengthFrequencies [length];
+			++codeLengthFrequencies [16];
+		} else {
+			run = 1;
+			lengthSymbols [lengthSymbolCount++] = static_cast<std::uint16_t> (length);
+			++codeLengthFrequencies [length];
+		}
+
+		i += run;
+	}
+
+	std::uint8_t codeLengthLengths [19];
+	BuildCodeLengths (codeLengthFrequencies, 19, MAX_CODE_LENGTH_BITS, codeLengthLengths);
+
+	int codeLengthCount = 19;
+	while (codeLengthCount > 4 &&
+		codeLengthLengths [CODE_LENGTH_ORDER [codeLengthCount - 1]] == 0) {
+		--codeLengthCount;
+	}
+
+	// Compare against stored blocks, which cost 5 bytes per 64 KiB plus
+	// the padding to the next byte
+	std::uint64_t dynamicBits = 3 + 14 + 3 * codeLengthCount + extraBits;
+	static const int LENGTH_SYMBOL_EXTRA [3] = { 2, 3, 7 };
+	for (int i = 0; i < lengthSymbolCount; ++i) {
+		const int symbol = lengthSymbols [i] & 0xFF;
+		dynamicBits += codeLengthLengths [symbol] +
+			(symbol >= 16 ? LENGTH_SYMBOL_EXTRA [symbol - 16] : 0);
+	}
+	for (int i = 0; i < literalCount; ++i) {
+		dynamicBits += static_cast<std::uint64_t> (literalFrequencies [i]) * literalLengths [i];
+	}
+	for (int i = 0; i < distanceCount; ++i) {
+		dynamicBits += static_cast<std::uint64_t> (distanceFrequencies [i]) * distanceLengths [i];
+	}
+
+	const std::uint64_t storedBlockCount = std::max<std::uint64_t> (1,
+		(size + MAX_STORED_BLOCK_SIZE - 1) / MAX_STORED_BLOCK_SIZE);
+	const std::uint64_t storedBits = (size + storedBlockCount * 5) * 8 + 7;
+
+	if (storedBits < dynamicBits) {
+		WriteStoredBlocks (writer, bytes, size, last);
+		return;
+	}
+
+	std::uint16_t literalCodes [286], distanceCodes [30], codeLengthCodes [19];
+	BuildCodes (literalLengths, 286, literalCodes);
+	BuildCodes (distanceLengths, 30, distanceCodes);
+	BuildCodes (codeLengthLengths, 19, codeLengthCodes);
+
+	writer.PutBits (last ? 1 : 0, 1);
+	writer.PutBits (2, 2);
+	writer.PutBits (literalCount - 257, 5);
+	writer.PutBits (distanceCount - 1, 5);
+	writer.PutBits (codeLengthCount - 4, 4);
+	for (int i = 0; i < codeLengthCount; ++i) {
+		writer.PutBits (codeLengthLengths [CODE_LENGTH_ORDER [i]], 3);
+	}
+
+	for (int i = 0; i < lengthSymbolCount; ++i) {
+		const int symbol = lengthSymbols [i] & 0xFF;
+		writer.PutBits (codeLengthCodes [symbol], codeLengthLengths [symbol]);
+		if (symbol >= 16) {
+			writer.PutBits (lengthSymbols [i] >> 8, LENGTH_SYMBOL_EXTRA [symbol - 16]);
+		}
+	}
+
+	for (const auto& symbol : symbols) {
+		if (symbol.distance == 0) {
+			writer.PutBits (literalCodes [symbol.value], literalLengths [symbol.value]);
+		} else {
+			const int lengthCode = tables.lengthCodes [symbol.value];
+			const int distanceCode = tables.distanceCodes [symbol.distance];
+
+			writer.PutBits (literalCodes [257 + lengthCode], literalLengths [257 + lengthCode]);
+			writer.PutBits (symbol.value - LENGTH_BASE [lengthCode], LENGTH_EXTRA [lengthCode]);
+			writer.PutBits (distanceCodes [distanceCode], distanceLengths [distanceCode]);
+			writer.PutBits (symbol.distance - DISTANCE_BASE [distanceCode],
+				DISTANCE_EXTRA [distanceCode]);
+		}
+	}
+
+	writer.PutBits (literalCodes [END_OF_BLOCK], literalLengths [END_OF_BLOCK]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::uint32_t HashSequence (const std::uint8_t* bytes)
+{
+	std::uint32_t value;
+	std::memcpy (&value, bytes, sizeof (value));
+	return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline int CountTrailingZeros (const std::uint64_t value)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64 (&index, value);
+	return static_cast<int> (index);
+#elif defined(__GNUC__)
+	return __builtin_ctzll (value);
+#else
+	int count = 0;
+	while (((value >> count) & 1) == 0) {
+		++count;
+	}
+	return count;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Number of equal bytes at a and b, up to maxLength. Compares eight bytes at
+a time; the first differing byte is the lowest set one on little-endian
+machines, which covers everything we run on.
+*/
+inline int GetMatchLength (const std::uint8_t* a, const std::uint8_t* b,
+	const int maxLength)
+{
+	int length = 0;
+	while (length + 8 <= maxLength) {
+		std::uint64_t x, y;
+		std::memcpy (&x, a + length, sizeof (x));
+		std::memcpy (&y, b + length, sizeof (y));
+		if (x != y) {
+			return length + CountTrailingZeros (x ^ y) / 8;
+		}
+
+		length += 8;
+	}
+
+	while (length < maxLength && a [length] == b [length]) {
+		++length;
+	}
+
+	return length;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t Adler32 (const void* data, const std::size_t size,
+	const std::uint32_t adler)
+{
+	// Largest number of bytes before the sums can overflow 32 bits
+	const std::size_t MAX_BLOCK_SIZE = 5552;
+
+	auto bytes = static_cast<const std::uint8_t*> (data);
+	std::uint32_t a = adler & 0xFFFF;
+	std::uint32_t b = adler >> 16;
+
+	for (std::size_t offset = 0; offset < size; offset += MAX_BLOCK_SIZE) {
+		const auto end = std::min (size, offset + MAX_BLOCK_SIZE);
+		for (std::size_t i = offset; i < end; ++i) {
+			a += bytes [i];
+			b += a;
+		}
+
+		a %= 65521;
+		b %= 65521;
+	}
+
+	return (b << 16) | a;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t Adler32Combine (const std::uint32_t adler1,
+	const std::uint32_t adler2, const std::size_t size2)
+{
+	const std::uint32_t MODULUS = 65521;
+
+	// The second block's a sum starts at a1 instead of 1, which adds
+	// (a1 - 1) to its a sum, and size2 * (a1 - 1) to its b sum
+	const auto remainder = static_cast<std::uint32_t> (size2 % MODULUS);
+	const std::uint32_t a1 = adler1 & 0xFFFF, b1 = adler1 >> 16;
+	const std::uint32_t a2 = adler2 & 0xFFFF, b2 = adler2 >> 16;
+
+	const std::uint32_t a = (a1 + a2 + MODULUS - 1) % MODULUS;
+	const std::uint32_t b = static_cast<std::uint32_t> ((b1 + b2 +
+		static_cast<std::uint64_t> (remainder) * (a1 + MODULUS - 1)) % MODULUS);
+
+	return (b << 16) | a;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t Crc32 (const void* data, const std::size_t size,
+	const std::uint32_t crc)
+{
+	// Slicing-by-4 tables: table [k][i] is the CRC of byte i followed by k
+	// zero bytes, which allows processing four bytes per step
+	struct Tables
+	{
+		Tables ()
+		{
+			for (std::uint32_t i = 0; i < 256; ++i) {
+				std::uint32_t value = i;
+				for (int bit = 0; bit < 8; ++bit) {
+					value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+				}
+				table [0][i] = value;
+			}
+
+			for (int k = 1; k < 4; ++k) {
+				for (int i = 0; i < 256; ++i) {
+					table [k][i] = (table [k - 1][i] >> 8) ^
+						table [0][table [k - 1][i] & 0xFF];
+				}
+			}
+		}
+
+		std::uint32_t table [4][256];
+	};
+
+	static const Tables tables;
+	const auto& table = tables.table;
+
+	auto bytes = static_cast<const std::uint8_t*> (data);
+	std::uint32_t value = ~crc;
+	std::size_t i = 0;
+
+	for (; i + 4 <= size; i += 4) {
+		value ^= bytes [i] | (bytes [i + 1] << 8) | (bytes [i + 2] << 16) |
+			(static_cast<std::uint32_t> (bytes [i + 3]) << 24);
+		value = table [3][value & 0xFF] ^ table [2][(value >> 8) & 0xFF] ^
+			table [1][(value >> 16) & 0xFF] ^ table [0][value >> 24];
+	}
+
+	for (; i < size; ++i) {
+		value = table [0][(value ^ bytes [i]) & 0xFF] ^ (value >> 8);
+	}
+
+	return ~value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> ZlibDecompress (const void* data, const std::size_t size,
+	const std::size_t expectedSize)
+{
+	auto bytes = static_cast<const std::uint8_t*> (data);
+
+	if (size < 6) {
+		throw std::runtime_error ("Invalid zlib stream.");
+	}
+
+	// Compression method 8 is deflate, preset dictionaries are not supported
+	if ((bytes [0] & 0x0F) != 8 || ((bytes [0] << 8) | bytes [1]) % 31 != 0 ||
+		(bytes [1] & 0x20) != 0) {
+		throw std::runtime_error ("Invalid zlib header.");
+	}
+
+	std::vector<std::uint8_t> output;
+	output.reserve (expectedSize);
+
+	BitReader reader (bytes + 2, size - 2);
+	Huffman literals, distances;
+
+	for (;;) {
+		const int last = reader.GetBits (1);
+		const int type = reader.GetBits (2);
+
+		if (type == 0) {
+			reader.AlignToByte ();
+			const auto position = 2 + reader.GetPosition ();
+			if (position + 4 > size) {
+				throw std::runtime_error ("Unexpected end of deflate stream.");
+			}
+
+			const int length = bytes [position] | (bytes [position + 1] << 8);
+			const int complement = bytes [position + 2] | (bytes [position + 3] << 8);
+			if (length != (~complement & 0xFFFF) || position + 4 + length > size) {
+				throw std::runtime_error ("Invalid stored deflate block.");
+			}
+
+			output.insert (output.end (), bytes + position + 4,
+				bytes + position + 4 + length);
+			reader.Skip (4 + length);
+		} else if (type == 1) {
+			BuildFixedHuffman (literals, distances);
+			InflateBlock (reader, output, literals, distances);
+		} else if (type == 2) {
+			ReadDynamicHuffman (reader, literals, distances);
+			InflateBlock (reader, output, literals, distances);
+		} else {
+			throw std::runtime_error ("Invalid deflate block type.");
+		}
+
+		if (last) {
+			break;
+		}
+	}
+
+	reader.AlignToByte ();
+	const auto position = 2 + reader.GetPosition ();
+	if (position + 4 > size) {
+		throw std::runtime_error ("Missing zlib checksum.");
+	}
+
+	const std::uint32_t checksum = (bytes [position] << 24) |
+		(bytes [position + 1] << 16) | (bytes [position + 2] << 8) | bytes [position + 3];
+	if (checksum != Adler32 (output.data (), output.size ())) {
+		throw std::runtime_error ("zlib checksum mismatch.");
+	}
+
+	return output;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Deflate (const std::uint8_t* data, const std::size_t size,
+	const std::size_t dictionarySize, const bool final,
+	std::vector<std::uint8_t>& output)
+{
+	const auto window = static_cast<std::int32_t> (std::min (dictionarySize,
+		static_cast<std::size_t> (WINDOW_SIZE)));
+
+	// Positions are relative to the start of the dictionary, chunks are
+	// small enough for them to fit into 32 bits
+	const std::uint8_t* base = data - window;
+	const auto end = static_cast<std::int32_t> (window + size);
+
+	// Hash chains: head holds the most recent position for each hash,
+	// previous the position before that with the same hash
+	std::vector<std::int32_t> head (1 << HASH_BITS, -1);
+	std::vector<std::int32_t> previous (WINDOW_SIZE);
+
+	const auto insert = [&] (const std::int32_t position) -> std::int32_t {
+		const auto hash = HashSequence (base + position);
+		const auto candidate = head [hash];
+		previous [position & (WINDOW_SIZE - 1)] = candidate;
+		head [hash] = position;
+		return candidate;
+	};
+
+	for (std::int32_t position = 0;
+		position < window && position + MIN_MATCH <= end;
+		++position) {
+		insert (position);
+	}
+
+	BitWriter writer (output);
+	std::vector<Symbol> symbols;
+	symbols.reserve (MAX_BLOCK_SYMBOLS);
+
+	auto blockStart = window;
+	auto position = blockStart;
+
+	while (position < end) {
+		int bestLength = 0, bestDistance = 0;
+
+		if (position + MIN_MATCH <= end) {
+			const int maxLength = std::min (MAX_MATCH, end - position);
+			auto candidate = insert (position);
+
+			for (int chain = 0; chain < MAX_CHAIN_LENGTH && candidate >= 0 &&
+				position - candidate <= WINDOW_SIZE; ++chain) {
+				// Checking the byte after the current best match first
+				// rejects most candidates which cannot be longer
+				if (base [candidate + bestLength] == base [position + bestLength]) {
+					const int length = GetMatchLength (base + candidate,
+						base + position, maxLength);
+					if (length > bestLength) {
+						bestLength = length;
+						bestDistance = position - candidate;
+						if (length == maxLength) {
+							break;
+						}
+					}
+				}
+
+				// Slots get overwritten once the window moves on, which
+				// shows up as a link which does not point backwards
+				const auto next = previous [candidate & (WINDOW_SIZE - 1)];
+				if (next >= candidate) {
+					break;
+				}
+				candidate = next;
+			}
+		}
+
+		if (bestLength >= MIN_MATCH) {
+			symbols.push_back ({
+				static_cast<std::uint16_t> (bestLength),
+				static_cast<std::uint16_t> (bestDistance) });
+
+			if (bestLength <= MAX_INSERT_LENGTH) {
+				for (int i = 1; i < bestLength && position + i + MIN_MATCH <= end; ++i) {
+					insert (position + i);
+				}
+			}
+
+			position += bestLength;
+		} else {
+			symbols.push_back ({ base [position], 0 });
+			++position;
+		}
+
+		if (symbols.size () == MAX_BLOCK_SYMBOLS) {
+			WriteBlock (writer, symbols, base + blockStart, position - blockStart, false);
+			symbols.clear ();
+			blockStart = position;
+		}
+	}
+
+	WriteBlock (writer, symbols, base + blockStart, end - blockStart, final);
+
+	// Sync flush, so the next chunk starts on a byte boundary
+	if (!final) {
+		WriteStoredBlocks (writer, nullptr, 0, false);
+	}
+
+	writer.AlignToByte ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> ZlibCompress (const void* data, const std::size_t size,
+	ThreadPool* threadPool)
+{
+	auto bytes = static_cast<const std::uint8_t*> (data);
+
+	const int chunkCount = static_cast<int> (std::max<std::size_t> (1,
+		(size + COMPRESS_CHUNK_SIZE - 1) / COMPRESS_CHUNK_SIZE));
+	std::vector<std::vector<std::uint8_t>> chunks (chunkCount);
+	std::vector<std::uint32_t> checksums (chunkCount);
+
+	const auto compressChunk = [&] (const int chunk) {
+		const auto begin = chunk * COMPRESS_CHUNK_SIZE;
+		const auto length = std::min (size - begin, COMPRESS_CHUNK_SIZE);
+
+		chunks [chunk].reserve (length / 2);
+		Deflate (bytes + begin, length, begin, chunk == chunkCount - 1, chunks [chunk]);
+		checksums [chunk] = Adler32 (bytes + begin, length);
+	};
+
+	if (threadPool) {
+		threadPool->ParallelFor (chunkCount, compressChunk);
+	} else {
+		for (int i = 0; i < chunkCount; ++i) {
+			compressChunk (i);
+		}
+	}
+
+	std::size_t compressedSize = 6;
+	for (const auto& chunk : chunks) {
+		compressedSize += chunk.size ();
+	}
+
+	// Deflate with a 32 KiB window, no preset dictionary, fastest level
+	std::vector<std::uint8_t> result;
+	result.reserve (compressedSize);
+	result.push_back (0x78);
+	result.push_back (0x01);
+
+	std::uint32_t checksum = checksums [0];
+	for (int i = 0; i < chunkCount; ++i) {
+		result.insert (result.end (), chunks [i].begin (), chunks [i].end ());
+
+		if (i > 0) {
+			checksum = Adler32Combine (checksum, checksums [i],
+				std::min (size - i * COMPRESS_CHUNK_SIZE, COMPRESS_CHUNK_SIZE));
+		}
+	}
+
+	result.push_back (static_cast<std::uint8_t> (checksum >> 24));
+	result.push_back (static_cast<std::uint8_t> (checksum >> 16));
+	result.push_back (static_cast<std::uint8_t> (checksum >> 8));
+	result.push_back (static_cast<std::uint8_t> (checksum));
+
+	return result;
+}
+}
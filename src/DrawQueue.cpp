@@ -0,0 +1,290 @@
+#include "DrawQueue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "ThreadPool.h"
+
+namespace anteru {
+namespace {
+const int RADIX_BITS = 8;
+const int RADIX_SIZE = 1 << RADIX_BITS;
+const int PASS_COUNT = 64 / RADIX_BITS;
+
+// Below this many keys per block, splitting the sort is not worth it
+const std::size_t MIN_KEYS_PER_BLOCK = 8192;
+// Short sequences are faster to sort directly than to build histograms for
+const std::size_t MIN_KEYS_FOR_RADIX_SORT = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+void InsertionSort (std::uint64_t* keys, std::uint32_t* values,
+	const std::size_t count)
+{
+	for (std::size_t i = 1; i < count; ++i) {
+		const auto key = keys [i];
+		const auto value = values [i];
+
+		std::size_t j = i;
+		for (; j > 0 && keys [j - 1] > key; --j) {
+			keys [j] = keys [j - 1];
+			values [j] = values [j - 1];
+		}
+
+		keys [j] = key;
+		values [j] = value;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int GetDigit (const std::uint64_t key, const int pass)
+{
+	return static_cast<int> ((key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ForEachBlock (ThreadPool* threadPool, const int blockCount,
+	const std::function<void (int)>& function)
+{
+	if (threadPool && blockCount > 1) {
+		threadPool->ParallelFor (blockCount, function);
+	} else {
+		for (int i = 0; i < blockCount; ++i) {
+			function (i);
+		}
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t DrawKey::Pack (const int layer, const int rootSignature,
+	const int pipelineState, const int material, const float depth,
+	const DepthOrder depthOrder)
+{
+	const auto field = [] (const int value, const int bits, const int shift) {
+		return (static_cast<std::uint64_t> (value) & ((1ull << bits) - 1)) << shift;
+	};
+
+	// Written such that NaN ends up as 0, converting it to an integer is
+	// undefined
+	float clampedDepth = depth > 0 ? std::min (depth, 1.0f) : 0.0f;
+	if (depthOrder == DepthOrder::BackToFront) {
+		clampedDepth = 1.0f - clampedDepth;
+	}
+
+	const int maxDepth = (1 << DEPTH_BITS) - 1;
+	const int quantizedDepth = static_cast<int> (clampedDepth * maxDepth);
+
+	return field (layer, LAYER_BITS, LAYER_SHIFT)
+		| field (rootSignature, ROOT_SIGNATURE_BITS, ROOT_SIGNATURE_SHIFT)
+		| field (pipelineState, PIPELINE_STATE_BITS, PIPELINE_STATE_SHIFT)
+		| field (material, MATERIAL_BITS, MATERIAL_SHIFT)
+		| field (quantizedDepth, DEPTH_BITS, DEPTH_SHIFT);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawStateIds::Clear ()
+{
+	rootSignatures_.clear ();
+	pipelineStates_.clear ();
+	materials_.clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int DrawStateIds::GetRootSignature (const void* rootSignature)
+{
+	return GetId (rootSignatures_, reinterpret_cast<std::uintptr_t> (rootSignature),
+		DrawKey::ROOT_SIGNATURE_BITS);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int DrawStateIds::GetPipelineState (const void* pipelineState)
+{
+	return GetId (pipelineStates_, reinterpret_cast<std::uintptr_t> (pipelineState),
+		DrawKey::PIPELINE_STATE_BITS);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int DrawStateIds::GetMaterial (const std::uint64_t material)
+{
+	return GetId (materials_, material, DrawKey::MATERIAL_BITS);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int DrawStateIds::GetId (std::unordered_map<std::uint64_t, int>& ids,
+	const std::uint64_t object, const int bits)
+{
+	const auto it = ids.find (object);
+	if (it != ids.end ()) {
+		return it->second;
+	}
+
+	const int id = static_cast<int> (ids.size ());
+	if (id >= (1 << bits)) {
+		throw std::runtime_error ("Too many distinct states for a draw key.");
+	}
+
+	ids.emplace (object, id);
+	return id;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void RadixSort (std::uint64_t* keys, std::uint32_t* values,
+	std::uint64_t* scratchKeys, std::uint32_t* scratchValues,
+	const std::size_t count, ThreadPool* threadPool)
+{
+	if (count < MIN_KEYS_FOR_RADIX_SORT) {
+		InsertionSort (keys, values, count);
+		return;
+	}
+
+	int blockCount = 1;
+	if (threadPool) {
+		blockCount = static_cast<int> (std::min<std::size_t> (
+			threadPool->GetConcurrency () * 2, count / MIN_KEYS_PER_BLOCK));
+		blockCount = std::max (blockCount, 1);
+	}
+
+	const std::size_t blockSize = (count + blockCount - 1) / blockCount;
+	const auto blockBegin = [=] (const int block) {
+		return std::min (count, block * blockSize);
+	};
+
+	// Digit counts do not depend on the order of the keys, so a single
+	// histogram over all passes tells us which passes can be skipped
+	std::vector<std::uint32_t> histograms (blockCount * PASS_COUNT * RADIX_SIZE);
+
+	ForEachBlock (threadPool, blockCount, [&] (const int block) {
+		std::uint32_t* histogram = histograms.data () + block * PASS_COUNT * RADIX_SIZE;
+		for (std::size_t i = blockBegin (block); i < blockBegin (block + 1); ++i) {
+			for (int pass = 0; pass < PASS_COUNT; ++pass) {
+				++histogram [pass * RADIX_SIZE + GetDigit (keys [i], pass)];
+			}
+		}
+	});
+
+	std::uint64_t* sourceKeys = keys;
+	std::uint32_t* sourceValues = values;
+	std::uint64_t* targetKeys = scratchKeys;
+	std::uint32_t* targetValues = scratchValues;
+
+	std::vector<std::size_t> offsets (blockCount * RADIX_SIZE);
+	bool firstPass = true;
+
+	for (int pass = 0; pass < PASS_COUNT; ++pass) {
+		std::size_t total [RADIX_SIZE] = {};
+		for (int block = 0; block < blockCount; ++block) {
+			const auto histogram = histograms.data () + (block * PASS_COUNT + pass) * RADIX_SIZE;
+			for (int digit = 0; digit < RADIX_SIZE; ++digit) {
+				total [digit] += histogram [digit];
+			}
+		}
+
+		if (std::find (total, total + RADIX_SIZE, count) != total + RADIX_SIZE) {
+			continue;
+		}
+
+		// The histograms from the initial scan match the current block
+		// contents only until the first scatter, afterwards they have to be
+		// rebuilt for the digit of this pass
+		if (! firstPass) {
+			ForEachBlock (threadPool, blockCount, [&] (const int block) {
+				std::uint32_t* histogram = histograms.data () + (block * PASS_COUNT + pass) * RADIX_SIZE;
+				std::memset (histogram, 0, RADIX_SIZE * sizeof (std::uint32_t));
+				for (std::size_t i = blockBegin (block); i < blockBegin (block + 1); ++i) {
+					++histogram [GetDigit (sourceKeys [i], pass)];
+				}
+			});
+		}
+
+		// Digit-major, block-minor prefix sum keeps the sort stable
+		std::size_t offset = 0;
+		for (int digit = 0; digit < RADIX_SIZE; ++digit) {
+			for (int block = 0; block < blockCount; ++block) {
+				offsets [block * RADIX_SIZE + digit] = offset;
+				offset += histograms [(block * PASS_COUNT + pass) * RADIX_SIZE + digit];
+			}
+		}
+
+		ForEachBlock (threadPool, blockCount, [&] (const int block) {
+			std::size_t* blockOffsets = offsets.data () + block * RADIX_SIZE;
+			for (std::size_t i = blockBegin (block); i < blockBegin (block + 1); ++i) {
+				const auto target = blockOffsets [GetDigit (sourceKeys [i], pass)]++;
+				targetKeys [target] = sourceKeys [i];
+				targetValues [target] = sourceValues [i];
+			}
+		});
+
+		std::swap (sourceKeys, targetKeys);
+		std::swap (sourceValues, targetValues);
+		firstPass = false;
+	}
+
+	if (sourceKeys != keys) {
+		std::memcpy (keys, sourceKeys, count * sizeof (std::uint64_t));
+		std::memcpy (values, sourceValues, count * sizeof (std::uint32_t));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+DrawQueue::DrawQueue (ThreadPool* threadPool)
+	: threadPool_ (threadPool)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawQueue::Clear ()
+{
+	keys_.clear ();
+	drawIndices_.clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawQueue::Add (const std::uint64_t key, const std::uint32_t drawIndex)
+{
+	keys_.push_back (key);
+	drawIndices_.push_back (drawIndex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawQueue::Sort ()
+{
+	scratchKeys_.resize (keys_.size ());
+	scratchDrawIndices_.resize (drawIndices_.size ());
+
+	RadixSort (keys_.data (), drawIndices_.data (),
+		scratchKeys_.data (), scratchDrawIndices_.data (),
+		keys_.size (), threadPool_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawQueue::Submit (const std::function<void (std::uint32_t, const StateChanges&)>& submit) const
+{
+	stateChangeCount_ = 0;
+
+	for (std::size_t i = 0; i < keys_.size (); ++i) {
+		const auto key = keys_ [i];
+
+		StateChanges changes = { true, true, true };
+
+		if (i > 0) {
+			const auto previous = keys_ [i - 1];
+			changes.rootSignature =
+				DrawKey::GetRootSignature (key) != DrawKey::GetRootSignature (previous);
+			// Pipeline state identifiers are allowed to be assigned per root
+			// signature, so a new root signature implies a new pipeline state
+			changes.pipelineState = changes.rootSignature ||
+				DrawKey::GetPipelineState (key) != DrawKey::GetPipelineState (previous);
+			// Root arguments are reset by a root signature change, so the
+			// material has to be bound again as well
+			changes.material = changes.rootSignature ||
+				DrawKey::GetMaterial (key) != DrawKey::GetMaterial (previous);
+		}
+
+		stateChangeCount_ += (changes.rootSignature ? 1 : 0)
+			+ (changes.pipelineState ? 1 : 0) + (changes.material ? 1 : 0);
+
+		submit (drawIndices_ [i], changes);
+	}
+}
+}
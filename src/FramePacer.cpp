@@ -0,0 +1,206 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace anteru {
+namespace {
+// SystemClock::SleepUntil spins for this long instead of sleeping
+const double SPIN_DURATION = 0.002;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IClock::~IClock ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+SystemClock::SystemClock ()
+	: start_ (std::chrono::steady_clock::now ().time_since_epoch ().count ())
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double SystemClock::Now ()
+{
+	using namespace std::chrono;
+	const auto ticks = steady_clock::now ().time_since_epoch ().count () - start_;
+	return static_cast<double> (ticks) *
+		steady_clock::period::num / steady_clock::period::den;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SystemClock::SleepUntil (const double time)
+{
+	const auto remaining = time - Now ();
+
+	if (remaining > SPIN_DURATION) {
+		std::this_thread::sleep_for (std::chrono::duration<double> (
+			remaining - SPIN_DURATION));
+	}
+
+	while (Now () < time) {
+		std::this_thread::yield ();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SimulatedClock::SleepUntil (const double time)
+{
+	now_ = std::max (now_, time);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FramePacer::FramePacer (IClock& clock, const FramePacingMode mode,
+	const double target, const int historyLength)
+	: clock_ (clock)
+	, mode_ (mode)
+	, target_ (target)
+	, historyLength_ (std::max (historyLength, 1))
+{
+	lastCompletionTime_ = clock_.Now ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Predict a duration from recent samples. We use a high percentile instead of
+the mean, as finishing a frame late costs more than finishing it early.
+*/
+double FramePacer::Predict (const std::vector<double>& history)
+{
+	if (history.empty ()) {
+		return 0;
+	}
+
+	std::vector<double> sorted (history);
+	const auto index = (sorted.size () * 9) / 10;
+	std::nth_element (sorted.begin (), sorted.begin () + index, sorted.end ());
+	return sorted [index];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FramePacer::AddSample (std::vector<double>& history, int& next,
+	const double value)
+{
+	if (static_cast<int> (history.size ()) < historyLength_) {
+		history.push_back (value);
+	} else {
+		history [next] = value;
+		next = (next + 1) % historyLength_;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double FramePacer::GetPredictedCpuTime () const
+{
+	return Predict (cpuTimes_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double FramePacer::GetPredictedGpuTime () const
+{
+	return Predict (gpuTimes_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The GPU processes frames in submission order, each one starting once it
+has been submitted and the previous one is done.
+*/
+double FramePacer::PredictGpuIdleTime (const double now) const
+{
+	const double gpuTime = GetPredictedGpuTime ();
+
+	double idle = lastCompletionTime_;
+	for (const auto& frame : pendingFrames_) {
+		idle = std::max (idle, frame.submitTime) + gpuTime;
+	}
+
+	return std::max (idle, now);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double FramePacer::GetPredictedFrameStart ()
+{
+	const double now = clock_.Now ();
+
+	if (mode_ == FramePacingMode::Disabled) {
+		return now;
+	}
+
+	const double gpuIdle = PredictGpuIdleTime (now);
+	const double justInTime = gpuIdle - GetPredictedCpuTime () - safetyMargin_;
+
+	double start = now;
+
+	if (mode_ == FramePacingMode::TargetLatency) {
+		// Completion is at gpuIdle + gpuTime if we are not later than just in
+		// time, starting later than that only leaves the GPU idle
+		start = std::min (gpuIdle + GetPredictedGpuTime () - target_, justInTime);
+	} else if (mode_ == FramePacingMode::TargetFrameRate) {
+		double next = scheduledStart_ + target_;
+
+		// Resynchronize if we fell behind by more than a frame
+		if (scheduledStart_ < 0 || next < now - target_) {
+			next = now;
+		}
+
+		start = std::max (next, justInTime);
+	}
+
+	return std::max (start, now);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double FramePacer::WaitForFrameStart ()
+{
+	const double start = GetPredictedFrameStart ();
+
+	clock_.SleepUntil (start);
+
+	scheduledStart_ = start;
+	frameStart_ = clock_.Now ();
+	return frameStart_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FramePacer::OnFrameSubmitted (const std::uint64_t fenceValue)
+{
+	const double now = clock_.Now ();
+
+	AddSample (cpuTimes_, nextCpuTime_, now - frameStart_);
+	pendingFrames_.push_back ({ fenceValue, now });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Completion is only observed when the fence is queried, so several frames
+may complete at once. In this case, the elapsed GPU time is split evenly
+between them.
+*/
+void FramePacer::OnFenceCompleted (const std::uint64_t completedValue)
+{
+	int completedCount = 0;
+	while (completedCount < static_cast<int> (pendingFrames_.size ()) &&
+		pendingFrames_ [completedCount].fenceValue <= completedValue) {
+		++completedCount;
+	}
+
+	if (completedCount == 0) {
+		return;
+	}
+
+	const double now = clock_.Now ();
+	const double gpuStart = std::max (lastCompletionTime_,
+		pendingFrames_.front ().submitTime);
+	const double gpuTime = (now - gpuStart) / completedCount;
+
+	for (int i = 0; i < completedCount; ++i) {
+		AddSample (gpuTimes_, nextGpuTime_, gpuTime);
+		pendingFrames_.pop_front ();
+	}
+
+	lastCompletionTime_ = now;
+}
+}
@@ -0,0 +1,95 @@
+#include "FrameReadback.h"
+
+#include <stdexcept>
+
+#include "Trace.h"
+#include "Utility.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+FrameReadback::FrameReadback (IRenderDevice& device, const int width,
+	const int height, const PixelFormat format, const int bufferCount)
+	: buffers_ (bufferCount)
+	, width_ (width)
+	, height_ (height)
+	, rowPitch_ (RoundToNextMultiple (width * GetBytesPerPixel (format),
+		TEXTURE_DATA_PITCH_ALIGNMENT))
+	, format_ (format)
+{
+	if (bufferCount < 1) {
+		throw std::runtime_error ("Invalid number of readback buffers.");
+	}
+
+	for (auto& buffer : buffers_) {
+		buffer.resource = device.CreateBuffer (
+			static_cast<std::size_t> (rowPitch_) * height,
+			HeapType::Readback, ResourceState::CopyDestination);
+		buffer.data = static_cast<const std::uint8_t*> (buffer.resource->Map ());
+		buffer.frameIndex = 0;
+		buffer.fenceValue = 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FrameReadback::~FrameReadback ()
+{
+	for (auto& buffer : buffers_) {
+		buffer.resource->Unmap ();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t FrameReadback::GetWaitValue () const
+{
+	if (pendingCount_ < static_cast<int> (buffers_.size ())) {
+		return 0;
+	}
+
+	return buffers_ [oldest_].fenceValue;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FrameReadback::Copy (ICommandList* commandList, IResource* source,
+	const std::uint64_t frameIndex, const std::uint64_t fenceValue)
+{
+	if (pendingCount_ == static_cast<int> (buffers_.size ())) {
+		throw std::runtime_error ("No free readback buffer.");
+	}
+
+	const int bufferCount = static_cast<int> (buffers_.size ());
+	auto& buffer = buffers_ [(oldest_ + pendingCount_) % bufferCount];
+	buffer.frameIndex = frameIndex;
+	buffer.fenceValue = fenceValue;
+	++pendingCount_;
+
+	commandList->CopyTextureToBuffer (buffer.resource.get (), 0, source, rowPitch_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int FrameReadback::Deliver (const std::uint64_t completedValue,
+	const ReadbackCallback& callback)
+{
+	const int bufferCount = static_cast<int> (buffers_.size ());
+
+	int delivered = 0;
+	while (pendingCount_ > 0 && buffers_ [oldest_].fenceValue <= completedValue) {
+		const auto& buffer = buffers_ [oldest_];
+
+		{
+			TraceScope scope ("Deliver frame", "frame",
+				static_cast<std::int64_t> (buffer.frameIndex));
+
+			const ReadbackFrame frame = {
+				buffer.frameIndex, width_, height_, rowPitch_, format_, buffer.data
+			};
+			callback (frame);
+		}
+
+		oldest_ = (oldest_ + 1) % bufferCount;
+		--pendingCount_;
+		++delivered;
+	}
+
+	return delivered;
+}
+}
@@ -0,0 +1,27 @@
+#include "FrameRing.h"
+
+#include <stdexcept>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+FrameRing::FrameRing (const int framesInFlight)
+{
+	if (framesInFlight < 1) {
+		throw std::runtime_error ("At least one frame must be in flight.");
+	}
+
+	slotFenceValues_.resize (framesInFlight, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FrameRing::EndFrame (const std::uint64_t fenceValue)
+{
+	if (fenceValue <= lastSubmittedValue_) {
+		throw std::runtime_error ("Frame fence values must be increasing.");
+	}
+
+	slotFenceValues_ [GetCurrentSlot ()] = fenceValue;
+	lastSubmittedValue_ = fenceValue;
+	++frameIndex_;
+}
+}
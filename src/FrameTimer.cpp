@@ -0,0 +1,247 @@
+#include "FrameTimer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace anteru {
+namespace {
+// 32 sub-buckets per power of two
+const int SUB_BUCKET_BITS = 5;
+const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+// Values are clamped to 2^40 ns, which is roughly 18 minutes
+const int MAX_VALUE_BITS = 40;
+const std::uint64_t MAX_VALUE = (1ull << MAX_VALUE_BITS) - 1;
+const int BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+///////////////////////////////////////////////////////////////////////////////
+int GetMostSignificantBit (const std::uint64_t value)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64 (&index, value);
+	return static_cast<int> (index);
+#elif defined(__GNUC__) || defined(__clang__)
+	return 63 - __builtin_clzll (value);
+#else
+	int result = 0;
+	for (auto v = value; v > 1; v >>= 1) {
+		++result;
+	}
+	return result;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Values below 2 * SUB_BUCKET_COUNT map directly to a bucket. Above, the
+value is shifted right until it is below 2 * SUB_BUCKET_COUNT, and the
+shift selects the range of buckets.
+*/
+int GetBucketIndex (const std::uint64_t value)
+{
+	if (value < 2 * SUB_BUCKET_COUNT) {
+		return static_cast<int> (value);
+	}
+
+	const int shift = GetMostSignificantBit (value) - SUB_BUCKET_BITS;
+	return shift * SUB_BUCKET_COUNT + static_cast<int> (value >> shift);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Midpoint of the range of values which map to a bucket.
+*/
+std::uint64_t GetBucketValue (const int index)
+{
+	if (index < 2 * SUB_BUCKET_COUNT) {
+		return static_cast<std::uint64_t> (index);
+	}
+
+	const int shift = index / SUB_BUCKET_COUNT - 1;
+	const auto subBucket = static_cast<std::uint64_t> (index - shift * SUB_BUCKET_COUNT);
+	return (subBucket << shift) + ((1ull << shift) >> 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double TicksToMicroseconds (const std::uint64_t ticks)
+{
+	return static_cast<double> (ticks) * 1e6 *
+		FrameTimer::Clock::period::num / FrameTimer::Clock::period::den;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+LatencyHistogram::LatencyHistogram ()
+	: buckets_ (BUCKET_COUNT, 0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void LatencyHistogram::Record (const std::uint64_t value)
+{
+	const auto clamped = std::min (value, MAX_VALUE);
+
+	++buckets_ [GetBucketIndex (clamped)];
+	++count_;
+	total_ += clamped;
+	max_ = std::max (max_, clamped);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void LatencyHistogram::Add (const LatencyHistogram& other)
+{
+	for (int i = 0; i < BUCKET_COUNT; ++i) {
+		buckets_ [i] += other.buckets_ [i];
+	}
+
+	count_ += other.count_;
+	total_ += other.total_;
+	max_ = std::max (max_, other.max_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void LatencyHistogram::Clear ()
+{
+	std::fill (buckets_.begin (), buckets_.end (), 0);
+	count_ = 0;
+	total_ = 0;
+	max_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t LatencyHistogram::GetPercentile (const double fraction) const
+{
+	if (count_ == 0) {
+		return 0;
+	}
+
+	const auto rank = std::max<std::uint64_t> (1,
+		static_cast<std::uint64_t> (fraction * static_cast<double> (count_) + 0.5));
+
+	std::uint64_t seen = 0;
+	for (int i = 0; i < BUCKET_COUNT; ++i) {
+		seen += buckets_ [i];
+
+		if (seen >= rank) {
+			return std::min (GetBucketValue (i), max_);
+		}
+	}
+
+	return max_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const char* GetFramePhaseName (const FramePhase phase)
+{
+	switch (phase) {
+	case FramePhase::WaitForFence: return "WaitForFence";
+	case FramePhase::Readback: return "Readback";
+	case FramePhase::FramePacing: return "FramePacing";
+	case FramePhase::PrepareRender: return "PrepareRender";
+	case FramePhase::UpdateConstantBuffer: return "UpdateConstantBuffer";
+	case FramePhase::RecordCommands: return "RecordCommands";
+	case FramePhase::ExecuteCommandLists: return "ExecuteCommandLists";
+	case FramePhase::Present: return "Present";
+	default: return "Unknown";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FrameTimer::FrameTimer (const int framesPerWindow, const int windowCount)
+	: histograms_ (PHASE_COUNT + 1)
+	, framesPerWindow_ (std::max (framesPerWindow, 1))
+{
+	for (auto& histograms : histograms_) {
+		histograms.windows.resize (std::max (windowCount, 1));
+	}
+
+	std::fill (currentFrame_, currentFrame_ + PHASE_COUNT, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FrameTimer::EndFrame ()
+{
+	// Start over with the oldest window once the current one is full
+	if (framesInCurrentWindow_ == framesPerWindow_) {
+		currentWindow_ = (currentWindow_ + 1) %
+			static_cast<int> (histograms_ [0].windows.size ());
+		framesInCurrentWindow_ = 0;
+
+		for (auto& histograms : histograms_) {
+			histograms.windows [currentWindow_].Clear ();
+		}
+	}
+
+	std::int64_t frameTotal = 0;
+	for (int i = 0; i <= PHASE_COUNT; ++i) {
+		std::int64_t ticks;
+		if (i < PHASE_COUNT) {
+			ticks = currentFrame_ [i];
+			frameTotal += ticks;
+			currentFrame_ [i] = 0;
+		} else {
+			ticks = frameTotal;
+		}
+
+		const auto value = static_cast<std::uint64_t> (std::max<std::int64_t> (ticks, 0));
+		histograms_ [i].total.Record (value);
+		histograms_ [i].windows [currentWindow_].Record (value);
+	}
+
+	++framesInCurrentWindow_;
+	++frameCount_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FrameTimer::WriteReport (std::ostream& output, const bool rolling) const
+{
+	char line [160];
+
+	std::snprintf (line, sizeof (line), "%-22s %10s %10s %10s %10s %10s\n",
+		"Phase [us]", "mean", "p50", "p95", "p99", "max");
+	output << line;
+
+	LatencyHistogram histogram;
+	std::uint64_t frameTotal = 0, fenceTotal = 0;
+
+	for (int i = 0; i <= PHASE_COUNT; ++i) {
+		histogram.Clear ();
+
+		if (rolling) {
+			for (const auto& window : histograms_ [i].windows) {
+				histogram.Add (window);
+			}
+		} else {
+			histogram.Add (histograms_ [i].total);
+		}
+
+		if (i == PHASE_COUNT) {
+			frameTotal = histogram.GetTotal ();
+		} else if (i == static_cast<int> (FramePhase::WaitForFence)) {
+			fenceTotal = histogram.GetTotal ();
+		}
+
+		const auto count = std::max<std::uint64_t> (histogram.GetCount (), 1);
+
+		std::snprintf (line, sizeof (line), "%-22s %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+			i < PHASE_COUNT ? GetFramePhaseName (static_cast<FramePhase> (i)) : "Frame",
+			TicksToMicroseconds (histogram.GetTotal ()) / count,
+			TicksToMicroseconds (histogram.GetPercentile (0.5)),
+			TicksToMicroseconds (histogram.GetPercentile (0.95)),
+			TicksToMicroseconds (histogram.GetPercentile (0.99)),
+			TicksToMicroseconds (histogram.GetMax ()));
+		output << line;
+	}
+
+	std::snprintf (line, sizeof (line),
+		"Fence stall: %.3f ms total, %.1f%% of frame time\n",
+		TicksToMicroseconds (fenceTotal) / 1000.0,
+		frameTotal ? 100.0 * fenceTotal / frameTotal : 0.0);
+	output << line;
+}
+}
@@ -0,0 +1,223 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+IGpuTimestampBackend::~IGpuTimestampBackend ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+NullTimestampBackend::NullTimestampBackend (const int slotCount,
+	const int queriesPerSlot, const std::uint64_t frequency,
+	const std::uint64_t ticksPerTimestamp)
+	: queriesPerSlot_ (queriesPerSlot)
+	, frequency_ (frequency)
+	, ticksPerTimestamp_ (ticksPerTimestamp)
+	, queries_ (slotCount * queriesPerSlot)
+	, readback_ (slotCount * queriesPerSlot)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void NullTimestampBackend::WriteTimestamp (const int slot, const int query)
+{
+	currentTime_ += ticksPerTimestamp_;
+	queries_ [slot * queriesPerSlot_ + query] = currentTime_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void NullTimestampBackend::Resolve (const int slot, const int queryCount)
+{
+	std::memcpy (readback_.data () + slot * queriesPerSlot_,
+		queries_.data () + slot * queriesPerSlot_,
+		queryCount * sizeof (std::uint64_t));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const std::uint64_t* NullTimestampBackend::GetResolvedTimestamps (const int slot) const
+{
+	return readback_.data () + slot * queriesPerSlot_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t NullTimestampBackend::GetFrequency () const
+{
+	return frequency_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+GpuProfiler::GpuProfiler (IGpuTimestampBackend& backend, const int slotCount,
+	const int maxScopesPerFrame)
+	: backend_ (backend)
+	, maxScopesPerFrame_ (maxScopesPerFrame)
+	, slots_ (slotCount)
+{
+	if (slotCount < 1 || maxScopesPerFrame < 1) {
+		throw std::runtime_error ("Invalid GPU profiler size.");
+	}
+
+	for (auto& slot : slots_) {
+		slot.scopes.reserve (maxScopesPerFrame);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GpuProfiler::BeginFrame (const int slot, const std::uint64_t frameIndex)
+{
+	auto& current = slots_ [slot];
+
+	if (current.pending) {
+		ReadBack (current, slot);
+	}
+
+	current.scopes.clear ();
+	current.frameIndex = frameIndex;
+	current.pending = false;
+
+	currentSlot_ = slot;
+	currentDepth_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int GpuProfiler::BeginScope (const char* name)
+{
+	if (currentSlot_ < 0) {
+		return -1;
+	}
+
+	auto& slot = slots_ [currentSlot_];
+	const int scope = static_cast<int> (slot.scopes.size ());
+
+	if (scope >= maxScopesPerFrame_) {
+		return -1;
+	}
+
+	Scope entry;
+	entry.name = name;
+	entry.depth = currentDepth_++;
+	entry.open = true;
+	slot.scopes.push_back (entry);
+
+	backend_.WriteTimestamp (currentSlot_, scope * 2);
+
+	return scope;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GpuProfiler::EndScope (const int scope)
+{
+	if (scope < 0 || currentSlot_ < 0) {
+		return;
+	}
+
+	auto& entry = slots_ [currentSlot_].scopes [scope];
+	if (! entry.open) {
+		return;
+	}
+
+	backend_.WriteTimestamp (currentSlot_, scope * 2 + 1);
+	entry.open = false;
+	--currentDepth_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GpuProfiler::EndFrame ()
+{
+	if (currentSlot_ < 0) {
+		return;
+	}
+
+	auto& slot = slots_ [currentSlot_];
+
+	// Close inner scopes first, so the end timestamps stay ordered
+	for (int i = static_cast<int> (slot.scopes.size ()) - 1; i >= 0; --i) {
+		EndScope (i);
+	}
+
+	if (! slot.scopes.empty ()) {
+		backend_.Resolve (currentSlot_,
+			static_cast<int> (slot.scopes.size ()) * 2);
+		slot.pending = true;
+	}
+
+	currentSlot_ = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GpuProfiler::ReadBack (Slot& slot, const int slotIndex)
+{
+	const auto timestamps = backend_.GetResolvedTimestamps (slotIndex);
+	const double ticksToMilliseconds = 1000.0 / backend_.GetFrequency ();
+	const double ticksToNanoseconds = 1000000000.0 / backend_.GetFrequency ();
+
+	timings_.clear ();
+	timingsFrameIndex_ = slot.frameIndex;
+
+	for (std::size_t i = 0; i < slot.scopes.size (); ++i) {
+		const auto& scope = slot.scopes [i];
+		const auto begin = timestamps [i * 2];
+		const auto end = timestamps [i * 2 + 1];
+
+		// Some drivers return garbage for queries at the very start of a
+		// command list; report those scopes as empty
+		const auto ticks = end > begin ? end - begin : 0;
+
+		GpuTiming timing;
+		timing.name = scope.name;
+		timing.depth = scope.depth;
+		timing.milliseconds = ticks * ticksToMilliseconds;
+		timings_.push_back (timing);
+
+		auto it = std::find_if (histograms_.begin (), histograms_.end (),
+			[&] (const ScopeHistogram& histogram) {
+			return histogram.name == scope.name && histogram.depth == scope.depth;
+		});
+
+		if (it == histograms_.end ()) {
+			ScopeHistogram histogram;
+			histogram.name = scope.name;
+			histogram.depth = scope.depth;
+			histograms_.push_back (histogram);
+			it = histograms_.end () - 1;
+		}
+
+		it->histogram.Record (static_cast<std::uint64_t> (ticks * ticksToNanoseconds));
+	}
+
+	slot.pending = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GpuProfiler::WriteReport (std::ostream& output) const
+{
+	char line [160];
+
+	std::snprintf (line, sizeof (line), "%-22s %10s %10s %10s %10s %10s\n",
+		"GPU scope [us]", "mean", "p50", "p95", "p99", "max");
+	output << line;
+
+	for (const auto& entry : histograms_) {
+		const auto& histogram = entry.histogram;
+		const auto count = std::max<std::uint64_t> (histogram.GetCount (), 1);
+
+		char name [32];
+		std::snprintf (name, sizeof (name), "%*s%s",
+			entry.depth * 2, "", entry.name);
+
+		std::snprintf (line, sizeof (line), "%-22s %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+			name,
+			histogram.GetTotal () / 1000.0 / count,
+			histogram.GetPercentile (0.5) / 1000.0,
+			histogram.GetPercentile (0.95) / 1000.0,
+			histogram.GetPercentile (0.99) / 1000.0,
+			histogram.GetMax () / 1000.0);
+		output << line;
+	}
+}
+}
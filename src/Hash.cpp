@@ -0,0 +1,122 @@
+#include "Hash.h"
+
+#include <cstring>
+
+namespace anteru {
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t RotateLeft (const std::uint64_t x, const int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t Mix (std::uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xFF51AFD7ED558CCDull;
+	k ^= k >> 33;
+	k *= 0xC4CEB9FE1A85EC53ull;
+	k ^= k >> 33;
+
+	return k;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t LoadLittleEndian64 (const std::uint8_t* p)
+{
+	std::uint64_t result = 0;
+	for (int i = 7; i >= 0; --i) {
+		result = (result << 8) | p [i];
+	}
+
+	return result;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Hash128 ComputeHash128 (const void* data, const std::size_t size,
+	const std::uint64_t seed)
+{
+	static const std::uint64_t C1 = 0x87C37B91114253D5ull;
+	static const std::uint64_t C2 = 0x4CF5AD432745937Full;
+
+	const auto bytes = static_cast<const std::uint8_t*> (data);
+	const std::size_t blockCount = size / 16;
+
+	std::uint64_t h1 = seed;
+	std::uint64_t h2 = seed;
+
+	for (std::size_t i = 0; i < blockCount; ++i) {
+		std::uint64_t k1 = LoadLittleEndian64 (bytes + i * 16);
+		std::uint64_t k2 = LoadLittleEndian64 (bytes + i * 16 + 8);
+
+		k1 *= C1; k1 = RotateLeft (k1, 31); k1 *= C2; h1 ^= k1;
+		h1 = RotateLeft (h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+
+		k2 *= C2; k2 = RotateLeft (k2, 33); k2 *= C1; h2 ^= k2;
+		h2 = RotateLeft (h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+	}
+
+	// The remaining 0-15 bytes, zero padded
+	std::uint8_t tail [16] = {};
+	const std::size_t tailSize = size & 15;
+	if (tailSize > 0) {
+		std::memcpy (tail, bytes + blockCount * 16, tailSize);
+
+		std::uint64_t k1 = LoadLittleEndian64 (tail);
+		std::uint64_t k2 = LoadLittleEndian64 (tail + 8);
+
+		if (tailSize > 8) {
+			k2 *= C2; k2 = RotateLeft (k2, 33); k2 *= C1; h2 ^= k2;
+		}
+
+		k1 *= C1; k1 = RotateLeft (k1, 31); k1 *= C2; h1 ^= k1;
+	}
+
+	h1 ^= size;
+	h2 ^= size;
+
+	h1 += h2;
+	h2 += h1;
+
+	h1 = Mix (h1);
+	h2 = Mix (h2);
+
+	h1 += h2;
+	h2 += h1;
+
+	return { h1, h2 };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+HashBuilder& HashBuilder::Add (const void* data, const std::size_t size)
+{
+	Add (static_cast<std::uint64_t> (size));
+	buffer_.append (static_cast<const char*> (data), size);
+
+	return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+HashBuilder& HashBuilder::Add (const char* text)
+{
+	return Add (text ? text : "", text ? std::strlen (text) : 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+HashBuilder& HashBuilder::Add (const std::string& text)
+{
+	return Add (text.data (), text.size ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+HashBuilder& HashBuilder::Add (const std::uint64_t value)
+{
+	for (int i = 0; i < 8; ++i) {
+		buffer_.push_back (static_cast<char> (value >> (i * 8)));
+	}
+
+	return *this;
+}
+}
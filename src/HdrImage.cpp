@@ -0,0 +1,1021 @@
+#include "HdrImage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "Deflate.h"
+#include "PixelConversion.h"
+#include "Utility.h"
+
+namespace anteru {
+namespace {
+// Larger images are rejected before allocating memory for them
+const std::uint64_t MAX_PIXEL_COUNT = 1ull << 28;
+
+const std::uint32_t EXR_MAGIC = 20000630;
+const std::uint32_t EXR_VERSION = 2;
+const std::uint32_t EXR_TILED_FLAG = 0x200;
+const std::uint32_t EXR_NON_IMAGE_FLAG = 0x800;
+const std::uint32_t EXR_MULTIPART_FLAG = 0x1000;
+
+enum class ExrCompression
+{
+	None = 0,
+	Rle = 1,
+	Zips = 2,
+	Zip = 3,
+	Piz = 4
+};
+
+enum class ExrPixelType
+{
+	UInt = 0,
+	Half = 1,
+	Float = 2
+};
+
+// PIZ Huffman coding, see ImfHuf.cpp in OpenEXR
+const int HUF_ENCODE_SIZE = (1 << 16) + 1;
+const int HUF_MAX_CODE_LENGTH = 58;
+const int HUF_SHORT_ZERO_RUN = 59;
+const int HUF_LONG_ZERO_RUN = 63;
+const int HUF_SHORTEST_LONG_RUN = 2 + HUF_LONG_ZERO_RUN - HUF_SHORT_ZERO_RUN;
+const int HUF_TABLE_BITS = 14;
+const std::size_t HUF_HEADER_SIZE = 20;
+
+const int PIZ_BITMAP_SIZE = (1 << 16) / 8;
+
+// PIZ wavelet, see ImfWav.cpp in OpenEXR
+const int WAVELET_A_OFFSET = 1 << 15;
+const int WAVELET_MOD_MASK = (1 << 16) - 1;
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint16_t ReadLittleEndian16 (const std::uint8_t* data)
+{
+	return static_cast<std::uint16_t> (data [0] | (data [1] << 8));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t ReadLittleEndian32 (const std::uint8_t* data)
+{
+	return data [0] | (data [1] << 8) | (data [2] << 16) |
+		(static_cast<std::uint32_t> (data [3]) << 24);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Bounds checked little-endian reads from a block of memory.
+*/
+class ByteReader
+{
+public:
+	ByteReader (const std::uint8_t* data, const std::size_t size)
+		: data_ (data)
+		, size_ (size)
+	{
+	}
+
+	const std::uint8_t* Read (const std::size_t count)
+	{
+		if (count > size_ - position_) {
+			throw std::runtime_error ("Truncated image data.");
+		}
+
+		const auto result = data_ + position_;
+		position_ += count;
+		return result;
+	}
+
+	std::uint8_t ReadUInt8 ()
+	{
+		return *Read (1);
+	}
+
+	std::uint16_t ReadUInt16 ()
+	{
+		return ReadLittleEndian16 (Read (2));
+	}
+
+	std::uint32_t ReadUInt32 ()
+	{
+		return ReadLittleEndian32 (Read (4));
+	}
+
+	std::int32_t ReadInt32 ()
+	{
+		return static_cast<std::int32_t> (ReadUInt32 ());
+	}
+
+	std::uint64_t ReadUInt64 ()
+	{
+		const std::uint64_t low = ReadUInt32 ();
+		return low | (static_cast<std::uint64_t> (ReadUInt32 ()) << 32);
+	}
+
+	/**
+	Read a null-terminated string.
+	*/
+	std::string ReadString ()
+	{
+		const auto start = data_ + position_;
+		const auto end = static_cast<const std::uint8_t*> (
+			std::memchr (start, 0, size_ - position_));
+		if (end == nullptr) {
+			throw std::runtime_error ("Truncated image data.");
+		}
+
+		position_ += end - start + 1;
+		return std::string (start, end);
+	}
+
+	/**
+	Read up to the next line feed, which is skipped.
+	*/
+	std::string ReadLine ()
+	{
+		const auto start = data_ + position_;
+		const auto end = static_cast<const std::uint8_t*> (
+			std::memchr (start, '\n', size_ - position_));
+		if (end == nullptr) {
+			throw std::runtime_error ("Truncated image data.");
+		}
+
+		position_ += end - start + 1;
+		return std::string (start, end);
+	}
+
+	std::size_t GetPosition () const
+	{
+		return position_;
+	}
+
+	void Seek (const std::size_t position)
+	{
+		if (position > size_) {
+			throw std::runtime_error ("Truncated image data.");
+		}
+
+		position_ = position;
+	}
+
+	std::size_t GetRemaining () const
+	{
+		return size_ - position_;
+	}
+
+private:
+	const std::uint8_t* data_;
+	std::size_t size_;
+	std::size_t position_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+HdrImage CreateHdrImage (const std::int64_t width, const std::int64_t height,
+	const PixelFormat format)
+{
+	if (width <= 0 || height <= 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF ||
+		static_cast<std::uint64_t> (width * height) > MAX_PIXEL_COUNT) {
+		throw std::runtime_error ("Invalid image size.");
+	}
+
+	HdrImage image;
+	image.width = static_cast<int> (width);
+	image.height = static_cast<int> (height);
+	image.rowPitch = RoundToNextMultiple (image.width * GetBytesPerPixel (format),
+		TEXTURE_DATA_PITCH_ALIGNMENT);
+	image.format = format;
+	image.data.resize (static_cast<std::size_t> (image.rowPitch) * image.height);
+	return image;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Convert one row of RGBA floats into row y of the image.
+*/
+void StoreRow (HdrImage& image, const int y, const float* rgba)
+{
+	const auto target = image.data.data () +
+		static_cast<std::size_t> (image.rowPitch) * y;
+
+	switch (image.format) {
+	case PixelFormat::R16G16B16A16_Float:
+		ConvertFloatToHalf (rgba, reinterpret_cast<std::uint16_t*> (target),
+			static_cast<std::size_t> (image.width) * 4);
+		break;
+
+	case PixelFormat::R11G11B10_Float:
+		PackR11G11B10 (rgba, reinterpret_cast<std::uint32_t*> (target),
+			image.width);
+		break;
+
+	case PixelFormat::R9G9B9E5_SharedExp:
+		PackR9G9B9E5 (rgba, reinterpret_cast<std::uint32_t*> (target),
+			image.width);
+		break;
+
+	default:
+		throw std::runtime_error ("Unsupported HDR image format.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Read one scanline of RGBE pixels. Handles the run-length encoding where
+each channel is stored separately, the older one where a pixel of
+(1, 1, 1, n) repeats the previous pixel, and flat pixels.
+*/
+void ReadRadianceScanline (ByteReader& reader, const int width,
+	std::uint8_t* scanline)
+{
+	if (width >= 8 && width < 32768 && reader.GetRemaining () >= 4) {
+		const auto start = reader.GetPosition ();
+		const auto header = reader.Read (4);
+
+		if (header [0] == 2 && header [1] == 2 &&
+			((header [2] << 8) | header [3]) == width) {
+			for (int channel = 0; channel < 4; ++channel) {
+				for (int x = 0; x < width; ) {
+					int count = reader.ReadUInt8 ();
+
+					// Counts above 128 are runs of one value, others literals
+					if (count > 128) {
+						count -= 128;
+						if (x + count > width) {
+							throw std::runtime_error ("Invalid Radiance image.");
+						}
+
+						const auto value = reader.ReadUInt8 ();
+						for (; count > 0; --count) {
+							scanline [4 * x++ + channel] = value;
+						}
+					} else {
+						if (count == 0 || x + count > width) {
+							throw std::runtime_error ("Invalid Radiance image.");
+						}
+
+						const auto values = reader.Read (count);
+						for (int i = 0; i < count; ++i) {
+							scanline [4 * x++ + channel] = values [i];
+						}
+					}
+				}
+			}
+
+			return;
+		}
+
+		reader.Seek (start);
+	}
+
+	int shift = 0;
+	for (int x = 0; x < width; ) {
+		const auto pixel = reader.Read (4);
+
+		if (pixel [0] == 1 && pixel [1] == 1 && pixel [2] == 1) {
+			const auto count = static_cast<std::int64_t> (pixel [3]) << shift;
+			if (x == 0 || shift > 24 || x + count > width) {
+				throw std::runtime_error ("Invalid Radiance image.");
+			}
+
+			for (std::int64_t i = 0; i < count; ++i, ++x) {
+				std::memcpy (scanline + 4 * x, scanline + 4 * (x - 1), 4);
+			}
+
+			shift += 8;
+		} else {
+			std::memcpy (scanline + 4 * x, pixel, 4);
+			++x;
+			shift = 0;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+HdrImage LoadRadiance (ByteReader& reader, const PixelFormat format)
+{
+	const auto signature = reader.ReadLine ();
+	if (signature != "#?RADIANCE" && signature != "#?RGBE") {
+		throw std::runtime_error ("Invalid Radiance image.");
+	}
+
+	for (;;) {
+		const auto line = reader.ReadLine ();
+		if (line.empty ()) {
+			break;
+		}
+
+		if (line.compare (0, 7, "FORMAT=") == 0 &&
+			line != "FORMAT=32-bit_rle_rgbe") {
+			throw std::runtime_error ("Unsupported Radiance pixel format.");
+		}
+	}
+
+	// Only the standard orientation is supported, optionally bottom-up
+	const auto resolution = reader.ReadLine ();
+	char yAxis [3] = {}, xAxis [3] = {};
+	long long height = 0, width = 0;
+	if (std::sscanf (resolution.c_str (), "%2s %lld %2s %lld",
+		yAxis, &height, xAxis, &width) != 4 ||
+		(std::strcmp (yAxis, "-Y") != 0 && std::strcmp (yAxis, "+Y") != 0) ||
+		std::strcmp (xAxis, "+X") != 0) {
+		throw std::runtime_error ("Unsupported Radiance image orientation.");
+	}
+
+	const bool bottomUp = yAxis [0] == '+';
+
+	// Each scanline takes at least one pixel, so a damaged size is rejected
+	// before allocating the image
+	if (height > static_cast<long long> (reader.GetRemaining () / 4)) {
+		throw std::runtime_error ("Truncated image data.");
+	}
+
+	auto image = CreateHdrImage (width, height, format);
+
+	std::vector<std::uint8_t> scanline (static_cast<std::size_t> (image.width) * 4);
+	std::vector<float> row (static_cast<std::size_t> (image.width) * 4);
+
+	for (int y = 0; y < image.height; ++y) {
+		ReadRadianceScanline (reader, image.width, scanline.data ());
+
+		for (int x = 0; x < image.width; ++x) {
+			const auto pixel = scanline.data () + 4 * x;
+			// Mantissas are stored in [0, 256) with the exponent biased by 128
+			const float scale = pixel [3] ? std::ldexp (1.0f, pixel [3] - 136) : 0;
+
+			row [4 * x + 0] = pixel [0] * scale;
+			row [4 * x + 1] = pixel [1] * scale;
+			row [4 * x + 2] = pixel [2] * scale;
+			row [4 * x + 3] = 1;
+		}
+
+		StoreRow (image, bottomUp ? image.height - 1 - y : y, row.data ());
+	}
+
+	return image;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct ExrChannel
+{
+	ExrPixelType type;
+	// Component in the RGBA output, or -1 if the channel is ignored
+	int component;
+	int bytesPerPixel;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Undo the ZIP compression, which stores the byte-wise delta of the data
+with the even bytes first and the odd bytes second.
+*/
+void DecompressExrZip (const std::uint8_t* data, const std::size_t size,
+	const std::size_t expectedSize, std::vector<std::uint8_t>& output)
+{
+	auto deltas = ZlibDecompress (data, size, expectedSize);
+	if (deltas.size () != expectedSize) {
+		throw std::runtime_error ("Invalid OpenEXR image data.");
+	}
+
+	for (std::size_t i = 1; i < expectedSize; ++i) {
+		deltas [i] = static_cast<std::uint8_t> (deltas [i - 1] + deltas [i] - 128);
+	}
+
+	output.resize (expectedSize);
+	const auto half = (expectedSize + 1) / 2;
+	for (std::size_t i = 0; i < expectedSize / 2; ++i) {
+		output [2 * i] = deltas [i];
+		output [2 * i + 1] = deltas [half + i];
+	}
+
+	if (expectedSize & 1) {
+		output [expectedSize - 1] = deltas [half - 1];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Reads bits most significant first, as written by the PIZ Huffman coder.
+Reading past the end returns zeros, which is checked once decoding is done.
+*/
+class MsbBitReader
+{
+public:
+	MsbBitReader (const std::uint8_t* data, const std::size_t size)
+		: data_ (data)
+		, size_ (size)
+	{
+	}
+
+	std::uint32_t Peek (const int count)
+	{
+		Refill ();
+
+		if (bitCount_ >= count) {
+			return static_cast<std::uint32_t> (buffer_ >> (bitCount_ - count)) &
+				((1u << count) - 1);
+		} else {
+			return static_cast<std::uint32_t> (buffer_ << (count - bitCount_)) &
+				((1u << count) - 1);
+		}
+	}
+
+	void Skip (const int count)
+	{
+		consumedBits_ += count;
+		bitCount_ = std::max (bitCount_ - count, 0);
+	}
+
+	std::uint32_t GetBits (const int count)
+	{
+		const auto result = Peek (count);
+		Skip (count);
+		return result;
+	}
+
+	std::uint64_t GetConsumedBits () const
+	{
+		return consumedBits_;
+	}
+
+private:
+	void Refill ()
+	{
+		while (bitCount_ <= 56) {
+			buffer_ <<= 8;
+			if (position_ < size_) {
+				buffer_ |= data_ [position_];
+			}
+
+			++position_;
+			bitCount_ += 8;
+		}
+	}
+
+	const std::uint8_t* data_;
+	std::size_t size_;
+	std::size_t position_ = 0;
+	std::uint64_t buffer_ = 0;
+	int bitCount_ = 0;
+	std::uint64_t consumedBits_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Decode the canonical Huffman stream of a PIZ block into count values. The
+code for the largest symbol is followed by 8 bits which repeat the previous
+value.
+*/
+void DecodePizHuffman (const std::uint8_t* data, const std::size_t size,
+	std::uint16_t* output, const std::size_t count)
+{
+	if (size < HUF_HEADER_SIZE) {
+		throw std::runtime_error ("Invalid OpenEXR image data.");
+	}
+
+	const auto minSymbol = ReadLittleEndian32 (data);
+	const auto maxSymbol = ReadLittleEndian32 (data + 4);
+	const auto dataBitCount = ReadLittleEndian32 (data + 12);
+
+	if (minSymbol > maxSymbol ||
+		maxSymbol >= static_cast<std::uint32_t> (HUF_ENCODE_SIZE)) {
+		throw std::runtime_error ("Invalid OpenEXR image data.");
+	}
+
+	// Code lengths are stored in 6 bits, with special values for runs of
+	// unused symbols
+	std::vector<std::uint8_t> codeLengths (HUF_ENCODE_SIZE, 0);
+	MsbBitReader tableReader (data + HUF_HEADER_SIZE, size - HUF_HEADER_SIZE);
+	for (std::uint32_t symbol = minSymbol; symbol <= maxSymbol; ) {
+		const int length = tableReader.GetBits (6);
+
+		if (length >= HUF_SHORT_ZERO_RUN) {
+			const std::uint32_t run = (length == HUF_LONG_ZERO_RUN)
+				? tableReader.GetBits (8) + HUF_SHORTEST_LONG_RUN
+				: length - HUF_SHORT_ZERO_RUN + 2;
+			if (symbol + run > maxSymbol + 1) {
+				throw std::runtime_error ("Invalid OpenEXR image data.");
+			}
+
+			symbol += run;
+		} else {
+			codeLengths [symbol++] = static_cast<std::uint8_t> (length);
+		}
+	}
+
+	// The table ends on a byte boundary
+	const auto tableSize = static_cast<std::size_t> (
+		(tableReader.GetConsumedBits () + 7) / 8);
+	if (tableSize > size - HUF_HEADER_SIZE ||
+		(dataBitCount + 7ull) / 8 > size - HUF_HEADER_SIZE - tableSize) {
+		throw std::runtime_error ("Invalid OpenEXR image data.");
+	}
+
+	// Canonical codes are assigned from the longest to the shortest length,
+	// in symbol order within a length
+	std::uint64_t lengthCounts [HUF_MAX_CODE_LENGTH + 1] = {};
+	for (std::uint32_t symbol = minSymbol; symbol <= maxSymbol; ++symbol) {
+		++lengthCounts [codeLengths [symbol]];
+	}
+
+	std::uint64_t firstCodes [HUF_MAX_CODE_LENGTH + 1] = {};
+	std::uint64_t code = 0;
+	for (int length = HUF_MAX_CODE_LENGTH; length > 0; --length) {
+		firstCodes [length] = code;
+		code = (code + lengthCounts [length]) >> 1;
+	}
+
+	std::uint32_t firstIndices [HUF_MAX_CODE_LENGTH + 1] = {};
+	std::uint32_t index = 0;
+	for (int length = 1; length <= HUF_MAX_CODE_LENGTH; ++length) {
+		firstIndices [length] = index;
+		index += static_cast<std::uint32_t> (lengthCounts [length]);
+
+		if (firstCodes [length] + lengthCounts [length] > (1ull << length)) {
+			throw std::runtime_error ("Invalid OpenEXR image data.");
+		}
+	}
+
+	// Symbols sorted by length, plus a lookup table for short codes, which
+	// stores symbol << 8 | length
+	std::vector<std::uint32_t> sortedSymbols (index);
+	std::vector<std::uint32_t> table (1 << HUF_TABLE_BITS, 0);
+	std::uint32_t nextIndices [HUF_MAX_CODE_LENGTH + 1];
+	std::memcpy (nextIndices, firstIndices, sizeof (nextIndices));
+
+	for (std::uint32_t symbol = minSymbol; symbol <= maxSymbol; ++symbol) {
+		const int length = codeLengths [symbol];
+		if (length == 0) {
+			continue;
+		}
+
+		const auto rank = nextIndices [length] - firstIndices [length];
+		sortedSymbols [nextIndices [length]++] = symbol;
+
+		if (length <= HUF_TABLE_BITS) {
+			const auto symbolCode = firstCodes [length] + rank;
+			const auto first = symbolCode << (HUF_TABLE_BITS - length);
+			const auto last = (symbolCode + 1) << (HUF_TABLE_BITS - length);
+			for (auto i = first; i < last; ++i) {
+				table [i] = (symbol << 8) | length;
+			}
+		}
+	}
+
+	MsbBitReader reader (data + HUF_HEADER_SIZE + tableSize, (dataBitCount + 7) / 8);
+	const auto repeatSymbol = maxSymbol;
+
+	for (std::size_t i = 0; i < count; ) {
+		std::uint32_t symbol;
+		const auto entry = table [reader.Peek (HUF_TABLE_BITS)];
+
+		if (entry != 0) {
+			reader.Skip (entry & 0xFF);
+			symbol = entry >> 8;
+		} else {
+			std::uint64_t value = reader.Peek (HUF_TABLE_BITS);
+			int length = HUF_TABLE_BITS;
+			reader.Skip (HUF_TABLE_BITS);
+
+			for (;;) {
+				value = (value << 1) | reader.GetBits (1);
+				++length;
+
+				if (length > HUF_MAX_CODE_LENGTH) {
+					throw std::runtime_error ("Invalid OpenEXR image data.");
+				}
+
+				if (value >= firstCodes [length] &&
+					value - firstCodes [length] < lengthCounts [length]) {
+					symbol = sortedSymbols [firstIndices [length] +
+						(value - firstCodes [length])];
+					break;
+				}
+			}
+		}
+
+		if (symbol == repeatSymbol) {
+			const auto run = reader.GetBits (8);
+			if (i == 0 || run > count - i) {
+				throw std::runtime_error ("Invalid OpenEXR image data.");
+			}
+
+			std::fill (output + i, output + i + run, output [i - 1]);
+			i += run;
+		} else {
+			output [i++] = static_cast<std::uint16_t> (symbol);
+		}
+	}
+
+	if (reader.GetConsumedBits () > dataBitCount) {
+		throw std::runtime_error ("Invalid OpenEXR image data.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void DecodeWavelet14 (const std::uint16_t l, const std::uint16_t h,
+	std::uint16_t& a, std::uint16_t& b)
+{
+	const int hi = static_cast<std::int16_t> (h);
+	const int ai = static_cast<std::int16_t> (l) + (hi & 1) + (hi >> 1);
+
+	a = static_cast<std::uint16_t> (ai);
+	b = static_cast<std::uint16_t> (ai - hi);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void DecodeWavelet16 (const std::uint16_t l, const std::uint16_t h,
+	std::uint16_t& a, std::uint16_t& b)
+{
+	const int bb = (l - (h >> 1)) & WAVELET_MOD_MASK;
+	const int aa = (h + bb - WAVELET_A_OFFSET) & WAVELET_MOD_MASK;
+
+	a = static_cast<std::uint16_t> (aa);
+	b = static_cast<std::uint16_t> (bb);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Inverse of the 2D Haar wavelet applied by the PIZ compressor. Values below
+2^14 use a lossless transform on signed values, larger ones a modulo
+transform.
+*/
+void DecodeWavelet (std::uint16_t* data, const int nx, const int ox,
+	const int ny, const int oy, const std::uint16_t maxValue)
+{
+	const bool use14Bit = maxValue < (1 << 14);
+	const auto decode = use14Bit ? DecodeWavelet14 : DecodeWavelet16;
+	const int n = std::min (nx, ny);
+
+	int p = 1;
+	while (p <= n) {
+		p <<= 1;
+	}
+	p >>= 1;
+	int p2 = p;
+	p >>= 1;
+
+	// Levels are undone from the coarsest to the finest
+	while (p >= 1) {
+		const int oy1 = oy * p;
+		const int oy2 = oy * p2;
+		const int ox1 = ox * p;
+		const int ox2 = ox * p2;
+
+		std::uint16_t* py = data;
+		std::uint16_t* const ey = data + oy * (ny - p2);
+
+		for (; py <= ey; py += oy2) {
+			std::uint16_t* px = py;
+			std::uint16_t* const ex = py + ox * (nx - p2);
+
+			for (; px <= ex; px += ox2) {
+				const auto p01 = px + ox1;
+				const auto p10 = px + oy1;
+				const auto p11 = p10 + ox1;
+
+				std::uint16_t i00, i01, i10, i11;
+				decode (*px, *p10, i00, i10);
+				decode (*p01, *p11, i01, i11);
+				decode (i00, i01, *px, *p01);
+				decode (i10, i11, *p10, *p11);
+			}
+
+			// Odd column
+			if (nx & p) {
+				const auto p10 = px + oy1;
+				std::uint16_t i00;
+				decode (*px, *p10, i00, *p10);
+				*px = i00;
+			}
+		}
+
+		// Odd line
+		if (ny & p) {
+			std::uint16_t* px = py;
+			std::uint16_t* const ex = py + ox * (nx - p2);
+
+			for (; px <= ex; px += ox2) {
+				const auto p01 = px + ox1;
+				std::uint16_t i00;
+				decode (*px, *p01, i00, *p01);
+				*px = i00;
+			}
+		}
+
+		p2 = p;
+		p >>= 1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Undo the PIZ compression: a bitmap of used 16-bit values which maps them
+to a dense range, a wavelet transform per channel, and Huffman coding. The
+decoded channels are interleaved line by line like uncompressed data.
+*/
+void DecompressExrPiz (const std::uint8_t* data, const std::size_t size,
+	const std::vector<ExrChannel>& channels, const int width,
+	const int lineCount, const std::size_t expectedSize,
+	std::vector<std::uint8_t>& output)
+{
+	ByteReader reader (data, size);
+
+	std::vector<std::uint8_t> bitmap (PIZ_BITMAP_SIZE, 0);
+	const int minNonZero = reader.ReadUInt16 ();
+	const int maxNonZero = reader.ReadUInt16 ();
+	if (maxNonZero >= PIZ_BITMAP_SIZE) {
+		throw std::runtime_error ("Invalid OpenEXR image data.");
+	}
+
+	if (minNonZero <= maxNonZero) {
+		const auto count = maxNonZero - minNonZero + 1;
+		std::memcpy (bitmap.data () + minNonZero, reader.Read (count), count);
+	}
+
+	// Zero is always present, but not stored in the bitmap
+	std::vector<std::uint16_t> lut (1 << 16, 0);
+	int lutSize = 0;
+	for (int i = 0; i < (1 << 16); ++i) {
+		if (i == 0 || (bitmap [i >> 3] & (1 << (i & 7)))) {
+			lut [lutSize++] = static_cast<std::uint16_t> (i);
+		}
+	}
+	const auto maxValue = static_cast<std::uint16_t> (lutSize - 1);
+
+	const auto huffmanSize = reader.ReadUInt32 ();
+	const auto huffmanData = reader.Read (huffmanSize);
+
+	std::vector<std::uint16_t> values (expectedSize / 2);
+	DecodePizHuffman (huffmanData, huffmanSize, values.data (), values.size ());
+
+	// Each channel is stored as a plane, with 32-bit channels as two
+	// interleaved 16-bit planes
+	std::vector<std::uint16_t*> planes;
+	auto plane = values.data ();
+	for (const auto& channel : channels) {
+		const int components = channel.bytesPerPixel / 2;
+		for (int i = 0; i < components; ++i) {
+			DecodeWavelet (plane + i, width, components, lineCount,
+				width * components, maxValue);
+		}
+
+		planes.push_back (plane);
+		plane += static_cast<std::size_t> (width) * lineCount * components;
+	}
+
+	for (auto& value : values) {
+		value = lut [value];
+	}
+
+	output.resize (expectedSize);
+	auto target = output.data ();
+	for (int line = 0; line < lineCount; ++line) {
+		for (std::size_t i = 0; i < channels.size (); ++i) {
+			const auto lineSize = static_cast<std::size_t> (width) *
+				channels [i].bytesPerPixel;
+
+			// Values are little-endian in the file as well as in memory
+			std::memcpy (target, planes [i], lineSize);
+			planes [i] += lineSize / 2;
+			target += lineSize;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+HdrImage LoadExr (ByteReader& reader, const PixelFormat format)
+{
+	reader.ReadUInt32 ();
+	const auto version = reader.ReadUInt32 ();
+	if ((version & 0xFF) != EXR_VERSION) {
+		throw std::runtime_error ("Unsupported OpenEXR version.");
+	}
+
+	if (version & (EXR_TILED_FLAG | EXR_NON_IMAGE_FLAG | EXR_MULTIPART_FLAG)) {
+		throw std::runtime_error ("Only scanline OpenEXR images are supported.");
+	}
+
+	std::vector<ExrChannel> channels;
+	auto compression = ExrCompression::None;
+	std::int64_t xMin = 0, yMin = 0, xMax = -1, yMax = -1;
+
+	for (;;) {
+		const auto name = reader.ReadString ();
+		if (name.empty ()) {
+			break;
+		}
+
+		reader.ReadString ();
+		const auto attributeSize = reader.ReadUInt32 ();
+		ByteReader attribute (reader.Read (attributeSize), attributeSize);
+
+		if (name == "channels") {
+			// Channels are sorted by name, so the layout of a line follows
+			for (;;) {
+				const auto channelName = attribute.ReadString ();
+				if (channelName.empty ()) {
+					break;
+				}
+
+				ExrChannel channel;
+				channel.type = static_cast<ExrPixelType> (attribute.ReadInt32 ());
+				// pLinear and reserved bytes
+				attribute.Read (4);
+				const auto xSampling = attribute.ReadInt32 ();
+				const auto ySampling = attribute.ReadInt32 ();
+
+				if (xSampling != 1 || ySampling != 1) {
+					throw std::runtime_error ("Subsampled OpenEXR channels are not supported.");
+				}
+
+				switch (channel.type) {
+				case ExrPixelType::Half:
+					channel.bytesPerPixel = 2;
+					break;
+				case ExrPixelType::UInt:
+				case ExrPixelType::Float:
+					channel.bytesPerPixel = 4;
+					break;
+				default:
+					throw std::runtime_error ("Invalid OpenEXR channel type.");
+				}
+
+				static const char* const COMPONENT_NAMES [] = { "R", "G", "B", "A" };
+				channel.component = -1;
+				for (int i = 0; i < 4; ++i) {
+					if (channelName == COMPONENT_NAMES [i]) {
+						channel.component = i;
+					}
+				}
+
+				channels.push_back (channel);
+			}
+		} else if (name == "compression") {
+			compression = static_cast<ExrCompression> (attribute.ReadUInt8 ());
+		} else if (name == "dataWindow") {
+			xMin = attribute.ReadInt32 ();
+			yMin = attribute.ReadInt32 ();
+			xMax = attribute.ReadInt32 ();
+			yMax = attribute.ReadInt32 ();
+		}
+	}
+
+	if (channels.empty ()) {
+		throw std::runtime_error ("Invalid OpenEXR image.");
+	}
+
+	int linesPerBlock;
+	switch (compression) {
+	case ExrCompression::None:
+	case ExrCompression::Zips:
+		linesPerBlock = 1;
+		break;
+	case ExrCompression::Zip:
+		linesPerBlock = 16;
+		break;
+	case ExrCompression::Piz:
+		linesPerBlock = 32;
+		break;
+	default:
+		throw std::runtime_error ("Unsupported OpenEXR compression.");
+	}
+
+	// Each block has an entry in the offset table, so a damaged data window
+	// is rejected before allocating the image
+	const auto lineCount = yMax - yMin + 1;
+	if ((lineCount + linesPerBlock - 1) / linesPerBlock >
+		static_cast<std::int64_t> (reader.GetRemaining () / 8)) {
+		throw std::runtime_error ("Truncated image data.");
+	}
+
+	auto image = CreateHdrImage (xMax - xMin + 1, lineCount, format);
+
+	std::size_t bytesPerLine = 0;
+	for (const auto& channel : channels) {
+		bytesPerLine += static_cast<std::size_t> (image.width) * channel.bytesPerPixel;
+	}
+
+	const int blockCount = (image.height + linesPerBlock - 1) / linesPerBlock;
+	std::vector<std::uint64_t> offsets (blockCount);
+	for (auto& offset : offsets) {
+		offset = reader.ReadUInt64 ();
+	}
+
+	std::vector<std::uint8_t> buffer;
+	std::vector<std::uint16_t> halfValues (image.width);
+	std::vector<float> channelValues (image.width);
+	std::vector<float> row (static_cast<std::size_t> (image.width) * 4);
+
+	for (const auto offset : offsets) {
+		reader.Seek (static_cast<std::size_t> (
+			std::min<std::uint64_t> (offset, SIZE_MAX)));
+
+		const auto firstLine = reader.ReadInt32 () - yMin;
+		const auto packedSize = reader.ReadUInt32 ();
+		const auto packed = reader.Read (packedSize);
+
+		if (firstLine < 0 || firstLine >= image.height ||
+			firstLine % linesPerBlock != 0) {
+			throw std::runtime_error ("Invalid OpenEXR image data.");
+		}
+
+		const int lineCount = std::min (linesPerBlock,
+			image.height - static_cast<int> (firstLine));
+		const auto expectedSize = bytesPerLine * lineCount;
+
+		// Blocks which do not get smaller are stored uncompressed
+		const std::uint8_t* pixels = packed;
+		if (packedSize != expectedSize) {
+			switch (compression) {
+			case ExrCompression::Zips:
+			case ExrCompression::Zip:
+				DecompressExrZip (packed, packedSize, expectedSize, buffer);
+				break;
+			case ExrCompression::Piz:
+				DecompressExrPiz (packed, packedSize, channels, image.width,
+					lineCount, expectedSize, buffer);
+				break;
+			default:
+				throw std::runtime_error ("Invalid OpenEXR image data.");
+			}
+
+			pixels = buffer.data ();
+		}
+
+		for (int line = 0; line < lineCount; ++line) {
+			for (int x = 0; x < image.width; ++x) {
+				row [4 * x + 0] = row [4 * x + 1] = row [4 * x + 2] = 0;
+				row [4 * x + 3] = 1;
+			}
+
+			for (const auto& channel : channels) {
+				const auto lineSize = static_cast<std::size_t> (image.width) *
+					channel.bytesPerPixel;
+
+				if (channel.component >= 0) {
+					switch (channel.type) {
+					case ExrPixelType::Half:
+						std::memcpy (halfValues.data (), pixels, lineSize);
+						ConvertHalfToFloat (halfValues.data (),
+							channelValues.data (), image.width);
+						break;
+					case ExrPixelType::Float:
+						std::memcpy (channelValues.data (), pixels, lineSize);
+						break;
+					case ExrPixelType::UInt:
+						for (int x = 0; x < image.width; ++x) {
+							channelValues [x] = static_cast<float> (
+								ReadLittleEndian32 (pixels + 4 * x));
+						}
+						break;
+					}
+
+					for (int x = 0; x < image.width; ++x) {
+						row [4 * x + channel.component] = channelValues [x];
+					}
+				}
+
+				pixels += lineSize;
+			}
+
+			StoreRow (image, static_cast<int> (firstLine) + line, row.data ());
+		}
+	}
+
+	return image;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+HdrImage LoadHdrImageFromMemory (const void* data, const std::size_t size,
+	const PixelFormat format)
+{
+	if (format != PixelFormat::R16G16B16A16_Float &&
+		format != PixelFormat::R11G11B10_Float &&
+		format != PixelFormat::R9G9B9E5_SharedExp) {
+		throw std::runtime_error ("Unsupported HDR image format.");
+	}
+
+	const auto bytes = static_cast<const std::uint8_t*> (data);
+	ByteReader reader (bytes, size);
+
+	if (size >= 4 && ReadLittleEndian32 (bytes) == EXR_MAGIC) {
+		return LoadExr (reader, format);
+	} else if (size >= 2 && bytes [0] == '#' && bytes [1] == '?') {
+		return LoadRadiance (reader, format);
+	}
+
+	throw std::runtime_error ("Unknown HDR image format.");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+HdrImage LoadHdrImageFromFile (const char* path, const PixelFormat format)
+{
+	const auto data = ReadFile (path);
+	return LoadHdrImageFromMemory (data.data (), data.size (), format);
+}
+}
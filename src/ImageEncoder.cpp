@@ -0,0 +1,622 @@
+#include "ImageEncoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include "Deflate.h"
+#include "ImageIO.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+namespace anteru {
+namespace {
+const std::uint8_t PNG_SIGNATURE [8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+const int PNG_BYTES_PER_PIXEL = 4;
+const int PNG_FILTER_COUNT = 5;
+const int PNG_FILTER_SUB = 1;
+const int PNG_FILTER_UP = 2;
+const int PNG_FILTER_AVERAGE = 3;
+const int PNG_FILTER_PAETH = 4;
+
+// Rows filtered per job
+const int FILTER_ROWS_PER_JOB = 32;
+// IDAT chunks are written in parallel, as each has its own checksum
+const std::size_t IDAT_CHUNK_SIZE = 256 * 1024;
+
+const std::uint8_t QOI_OP_INDEX = 0x00;
+const std::uint8_t QOI_OP_DIFF = 0x40;
+const std::uint8_t QOI_OP_LUMA = 0x80;
+const std::uint8_t QOI_OP_RUN = 0xC0;
+const std::uint8_t QOI_OP_RGB = 0xFE;
+const std::uint8_t QOI_OP_RGBA = 0xFF;
+const int QOI_MAX_RUN = 62;
+
+///////////////////////////////////////////////////////////////////////////////
+void WriteBigEndian32 (std::uint8_t* output, const std::uint32_t value)
+{
+	output [0] = static_cast<std::uint8_t> (value >> 24);
+	output [1] = static_cast<std::uint8_t> (value >> 16);
+	output [2] = static_cast<std::uint8_t> (value >> 8);
+	output [3] = static_cast<std::uint8_t> (value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WriteLittleEndian32 (std::uint8_t* output, const std::uint32_t value)
+{
+	output [0] = static_cast<std::uint8_t> (value);
+	output [1] = static_cast<std::uint8_t> (value >> 8);
+	output [2] = static_cast<std::uint8_t> (value >> 16);
+	output [3] = static_cast<std::uint8_t> (value >> 24);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ParallelFor (ThreadPool* threadPool, const int count,
+	const std::function<void (int)>& function)
+{
+	if (threadPool) {
+		threadPool->ParallelFor (count, function);
+	} else {
+		for (int i = 0; i < count; ++i) {
+			function (i);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int PaethPredictor (const int a, const int b, const int c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs (p - a);
+	const int pb = std::abs (p - b);
+	const int pc = std::abs (p - c);
+
+	if (pa <= pb && pa <= pc) {
+		return a;
+	} else if (pb <= pc) {
+		return b;
+	} else {
+		return c;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Filter byte x, given the byte to the left (a), above (b) and above left (c).
+*/
+inline int FilterByte (const int filter, const int x, const int a,
+	const int b, const int c)
+{
+	switch (filter) {
+	case PNG_FILTER_SUB:
+		return (x - a) & 0xFF;
+	case PNG_FILTER_UP:
+		return (x - b) & 0xFF;
+	case PNG_FILTER_AVERAGE:
+		return (x - ((a + b) >> 1)) & 0xFF;
+	case PNG_FILTER_PAETH:
+		return (x - PaethPredictor (a, b, c)) & 0xFF;
+	default:
+		return x;
+	}
+}
+
+#if ANTERU_SSE2 || ANTERU_NEON
+#define ANTERU_PNG_FILTER_SIMD 1
+const int VECTOR_SIZE = 16;
+
+#if ANTERU_SSE2
+typedef __m128i ByteVector;
+typedef __m128i CostVector;
+
+///////////////////////////////////////////////////////////////////////////////
+inline ByteVector Load (const std::uint8_t* data)
+{
+	return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (data));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void Store (std::uint8_t* data, const ByteVector value)
+{
+	_mm_storeu_si128 (reinterpret_cast<__m128i*> (data), value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Move the bytes one pixel to the right, shifting in zeros.
+*/
+inline ByteVector ShiftPixel (const ByteVector value)
+{
+	return _mm_slli_si128 (value, PNG_BYTES_PER_PIXEL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline ByteVector Subtract (const ByteVector a, const ByteVector b)
+{
+	return _mm_sub_epi8 (a, b);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+(a + b) >> 1 per byte. avg_epu8 rounds up, so subtract the carry-in.
+*/
+inline ByteVector Average (const ByteVector a, const ByteVector b)
+{
+	return _mm_sub_epi8 (_mm_avg_epu8 (a, b),
+		_mm_and_si128 (_mm_xor_si128 (a, b), _mm_set1_epi8 (1)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline __m128i Select (const __m128i mask, const __m128i a, const __m128i b)
+{
+	return _mm_or_si128 (_mm_and_si128 (mask, a), _mm_andnot_si128 (mask, b));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline __m128i Abs16 (const __m128i value)
+{
+	return _mm_max_epi16 (value, _mm_sub_epi16 (_mm_setzero_si128 (), value));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The Paeth predictor needs 9 bits of precision, so it works on 16-bit
+halves.
+*/
+inline ByteVector Paeth (const ByteVector a, const ByteVector b,
+	const ByteVector c)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	__m128i predictor [2];
+
+	for (int half = 0; half < 2; ++half) {
+		const __m128i a16 = half ? _mm_unpackhi_epi8 (a, zero) : _mm_unpacklo_epi8 (a, zero);
+		const __m128i b16 = half ? _mm_unpackhi_epi8 (b, zero) : _mm_unpacklo_epi8 (b, zero);
+		const __m128i c16 = half ? _mm_unpackhi_epi8 (c, zero) : _mm_unpacklo_epi8 (c, zero);
+
+		// With p = a + b - c: p - a = b - c, p - b = a - c
+		const __m128i da = _mm_sub_epi16 (b16, c16);
+		const __m128i db = _mm_sub_epi16 (a16, c16);
+		const __m128i pa = Abs16 (da);
+		const __m128i pb = Abs16 (db);
+		const __m128i pc = Abs16 (_mm_add_epi16 (da, db));
+
+		const __m128i notA = _mm_or_si128 (_mm_cmpgt_epi16 (pa, pb),
+			_mm_cmpgt_epi16 (pa, pc));
+		const __m128i useC = _mm_cmpgt_epi16 (pb, pc);
+		predictor [half] = Select (notA, Select (useC, c16, b16), a16);
+	}
+
+	return _mm_packus_epi16 (predictor [0], predictor [1]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline CostVector ZeroCost ()
+{
+	return _mm_setzero_si128 ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Add the absolute values of the filtered bytes, as signed numbers.
+*/
+inline CostVector AccumulateCost (const CostVector cost, const ByteVector value)
+{
+	const __m128i absolute = _mm_min_epu8 (value,
+		_mm_sub_epi8 (_mm_setzero_si128 (), value));
+	return _mm_add_epi64 (cost, _mm_sad_epu8 (absolute, _mm_setzero_si128 ()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::uint32_t GetTotalCost (const CostVector cost)
+{
+	return static_cast<std::uint32_t> (_mm_cvtsi128_si32 (cost) +
+		_mm_cvtsi128_si32 (_mm_srli_si128 (cost, 8)));
+}
+#elif ANTERU_NEON
+typedef uint8x16_t ByteVector;
+typedef uint32x4_t CostVector;
+
+///////////////////////////////////////////////////////////////////////////////
+inline ByteVector Load (const std::uint8_t* data)
+{
+	return vld1q_u8 (data);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline void Store (std::uint8_t* data, const ByteVector value)
+{
+	vst1q_u8 (data, value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Move the bytes one pixel to the right, shifting in zeros.
+*/
+inline ByteVector ShiftPixel (const ByteVector value)
+{
+	return vextq_u8 (vdupq_n_u8 (0), value, VECTOR_SIZE - PNG_BYTES_PER_PIXEL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline ByteVector Subtract (const ByteVector a, const ByteVector b)
+{
+	return vsubq_u8 (a, b);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline ByteVector Average (const ByteVector a, const ByteVector b)
+{
+	return vhaddq_u8 (a, b);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline ByteVector Paeth (const ByteVector a, const ByteVector b,
+	const ByteVector c)
+{
+	uint8x8_t predictor [2];
+
+	for (int half = 0; half < 2; ++half) {
+		const uint8x8_t a8 = half ? vget_high_u8 (a) : vget_low_u8 (a);
+		const uint8x8_t b8 = half ? vget_high_u8 (b) : vget_low_u8 (b);
+		const uint8x8_t c8 = half ? vget_high_u8 (c) : vget_low_u8 (c);
+
+		// With p = a + b - c: |p - a| = |b - c|, |p - b| = |a - c|
+		const uint16x8_t pa = vabdl_u8 (b8, c8);
+		const uint16x8_t pb = vabdl_u8 (a8, c8);
+		const uint16x8_t pc = vreinterpretq_u16_s16 (vabsq_s16 (vsubq_s16 (
+			vreinterpretq_s16_u16 (vaddl_u8 (a8, b8)),
+			vreinterpretq_s16_u16 (vshll_n_u8 (c8, 1)))));
+
+		const uint8x8_t useA = vmovn_u16 (vandq_u16 (vcleq_u16 (pa, pb),
+			vcleq_u16 (pa, pc)));
+		const uint8x8_t useB = vmovn_u16 (vcleq_u16 (pb, pc));
+		predictor [half] = vbsl_u8 (useA, a8, vbsl_u8 (useB, b8, c8));
+	}
+
+	return vcombine_u8 (predictor [0], predictor [1]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline CostVector ZeroCost ()
+{
+	return vdupq_n_u32 (0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Add the absolute values of the filtered bytes, as signed numbers.
+*/
+inline CostVector AccumulateCost (const CostVector cost, const ByteVector value)
+{
+	const uint8x16_t absolute = vminq_u8 (value,
+		vreinterpretq_u8_s8 (vnegq_s8 (vreinterpretq_s8_u8 (value))));
+	return vpadalq_u16 (cost, vpaddlq_u8 (absolute));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::uint32_t GetTotalCost (const CostVector cost)
+{
+	return vgetq_lane_u32 (cost, 0) + vgetq_lane_u32 (cost, 1) +
+		vgetq_lane_u32 (cost, 2) + vgetq_lane_u32 (cost, 3);
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Load x with its neighbors to the left (a), above (b) and above left (c).
+*/
+inline void LoadNeighbors (const std::uint8_t* row, const std::uint8_t* previous,
+	const int offset, ByteVector& x, ByteVector& a, ByteVector& b, ByteVector& c)
+{
+	x = Load (row + offset);
+	b = Load (previous + offset);
+
+	if (offset == 0) {
+		a = ShiftPixel (x);
+		c = ShiftPixel (b);
+	} else {
+		a = Load (row + offset - PNG_BYTES_PER_PIXEL);
+		c = Load (previous + offset - PNG_BYTES_PER_PIXEL);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline ByteVector FilterVector (const int filter, const ByteVector x,
+	const ByteVector a, const ByteVector b, const ByteVector c)
+{
+	switch (filter) {
+	case PNG_FILTER_SUB:
+		return Subtract (x, a);
+	case PNG_FILTER_UP:
+		return Subtract (x, b);
+	case PNG_FILTER_AVERAGE:
+		return Subtract (x, Average (a, b));
+	case PNG_FILTER_PAETH:
+		return Subtract (x, Paeth (a, b, c));
+	default:
+		return x;
+	}
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Pick the filter for a row: the one whose output has the smallest sum of
+absolute values, interpreted as signed bytes. This is the heuristic
+suggested by the PNG specification and used by libpng.
+*/
+int SelectFilter (const std::uint8_t* row, const std::uint8_t* previous,
+	const int rowSize)
+{
+	std::uint32_t costs [PNG_FILTER_COUNT] = {};
+	int i = 0;
+
+#if ANTERU_PNG_FILTER_SIMD
+	CostVector vectorCosts [PNG_FILTER_COUNT];
+	for (auto& cost : vectorCosts) {
+		cost = ZeroCost ();
+	}
+
+	for (; i + VECTOR_SIZE <= rowSize; i += VECTOR_SIZE) {
+		ByteVector x, a, b, c;
+		LoadNeighbors (row, previous, i, x, a, b, c);
+
+		for (int filter = 0; filter < PNG_FILTER_COUNT; ++filter) {
+			vectorCosts [filter] = AccumulateCost (vectorCosts [filter],
+				FilterVector (filter, x, a, b, c));
+		}
+	}
+
+	for (int filter = 0; filter < PNG_FILTER_COUNT; ++filter) {
+		costs [filter] = GetTotalCost (vectorCosts [filter]);
+	}
+#endif
+
+	for (; i < rowSize; ++i) {
+		const int x = row [i];
+		const int a = i >= PNG_BYTES_PER_PIXEL ? row [i - PNG_BYTES_PER_PIXEL] : 0;
+		const int b = previous [i];
+		const int c = i >= PNG_BYTES_PER_PIXEL ? previous [i - PNG_BYTES_PER_PIXEL] : 0;
+
+		for (int filter = 0; filter < PNG_FILTER_COUNT; ++filter) {
+			const int value = FilterByte (filter, x, a, b, c);
+			costs [filter] += value < 128 ? value : 256 - value;
+		}
+	}
+
+	return static_cast<int> (std::min_element (costs, costs + PNG_FILTER_COUNT) - costs);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FilterRow (const int filter, const std::uint8_t* row,
+	const std::uint8_t* previous, const int rowSize, std::uint8_t* output)
+{
+	int i = 0;
+
+#if ANTERU_PNG_FILTER_SIMD
+	for (; i + VECTOR_SIZE <= rowSize; i += VECTOR_SIZE) {
+		ByteVector x, a, b, c;
+		LoadNeighbors (row, previous, i, x, a, b, c);
+		Store (output + i, FilterVector (filter, x, a, b, c));
+	}
+#endif
+
+	for (; i < rowSize; ++i) {
+		const int a = i >= PNG_BYTES_PER_PIXEL ? row [i - PNG_BYTES_PER_PIXEL] : 0;
+		const int c = i >= PNG_BYTES_PER_PIXEL ? previous [i - PNG_BYTES_PER_PIXEL] : 0;
+		output [i] = static_cast<std::uint8_t> (FilterByte (filter, row [i], a,
+			previous [i], c));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Write a PNG chunk to output and return the position after it.
+*/
+std::uint8_t* WritePngChunk (std::uint8_t* output, const char* type,
+	const std::uint8_t* data, const std::size_t size)
+{
+	WriteBigEndian32 (output, static_cast<std::uint32_t> (size));
+	std::memcpy (output + 4, type, 4);
+	if (size > 0) {
+		std::memcpy (output + 8, data, size);
+	}
+
+	// The checksum covers the type and the data
+	WriteBigEndian32 (output + 8 + size, Crc32 (output + 4, size + 4));
+	return output + 12 + size;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> EncodePng (const void* pixels, const int width,
+	const int height, const int rowPitch, ThreadPool* threadPool)
+{
+	if (width <= 0 || height <= 0 || rowPitch < width * PNG_BYTES_PER_PIXEL) {
+		throw std::runtime_error ("Invalid image size.");
+	}
+
+	auto bytes = static_cast<const std::uint8_t*> (pixels);
+	const int rowSize = width * PNG_BYTES_PER_PIXEL;
+	const std::size_t filteredRowSize = rowSize + 1;
+
+	// Every row is prefixed with its filter type
+	std::vector<std::uint8_t> filtered (filteredRowSize * height);
+	const std::vector<std::uint8_t> emptyRow (rowSize);
+
+	const int filterJobCount = (height + FILTER_ROWS_PER_JOB - 1) / FILTER_ROWS_PER_JOB;
+	ParallelFor (threadPool, filterJobCount, [&] (const int job) {
+		const int end = std::min (height, (job + 1) * FILTER_ROWS_PER_JOB);
+		for (int y = job * FILTER_ROWS_PER_JOB; y < end; ++y) {
+			const auto row = bytes + static_cast<std::size_t> (y) * rowPitch;
+			const auto previous = y > 0 ? row - rowPitch : emptyRow.data ();
+			auto output = filtered.data () + y * filteredRowSize;
+
+			const int filter = SelectFilter (row, previous, rowSize);
+			output [0] = static_cast<std::uint8_t> (filter);
+			FilterRow (filter, row, previous, rowSize, output + 1);
+		}
+	});
+
+	const auto compressed = ZlibCompress (filtered.data (), filtered.size (),
+		threadPool);
+
+	const int idatCount = static_cast<int> (std::max<std::size_t> (1,
+		(compressed.size () + IDAT_CHUNK_SIZE - 1) / IDAT_CHUNK_SIZE));
+	const std::size_t headerSize = sizeof (PNG_SIGNATURE) + 12 + 13;
+
+	std::vector<std::uint8_t> result (headerSize + idatCount * 12 +
+		compressed.size () + 12);
+
+	// 8-bit RGBA, deflate, adaptive filtering, no interlacing
+	std::uint8_t header [13] = {};
+	WriteBigEndian32 (header, static_cast<std::uint32_t> (width));
+	WriteBigEndian32 (header + 4, static_cast<std::uint32_t> (height));
+	header [8] = 8;
+	header [9] = 6;
+
+	std::memcpy (result.data (), PNG_SIGNATURE, sizeof (PNG_SIGNATURE));
+	WritePngChunk (result.data () + sizeof (PNG_SIGNATURE), "IHDR", header, sizeof (header));
+
+	ParallelFor (threadPool, idatCount, [&] (const int chunk) {
+		const auto offset = chunk * IDAT_CHUNK_SIZE;
+		WritePngChunk (result.data () + headerSize + chunk * (IDAT_CHUNK_SIZE + 12),
+			"IDAT", compressed.data () + offset,
+			std::min (compressed.size () - offset, IDAT_CHUNK_SIZE));
+	});
+
+	WritePngChunk (result.data () + result.size () - 12, "IEND", nullptr, 0);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> EncodeQoi (const void* pixels, const int width,
+	const int height, const int rowPitch)
+{
+	if (width <= 0 || height <= 0 || rowPitch < width * 4) {
+		throw std::runtime_error ("Invalid image size.");
+	}
+
+	auto bytes = static_cast<const std::uint8_t*> (pixels);
+
+	// Header, at most 5 bytes per pixel, and the end marker
+	std::vector<std::uint8_t> result (14 +
+		static_cast<std::size_t> (width) * height * 5 + 8);
+	auto output = result.data ();
+
+	// 4 channels, sRGB with linear alpha
+	std::memcpy (output, "qoif", 4);
+	WriteBigEndian32 (output + 4, static_cast<std::uint32_t> (width));
+	WriteBigEndian32 (output + 8, static_cast<std::uint32_t> (height));
+	output [12] = 4;
+	output [13] = 0;
+	output += 14;
+
+	// Pixels are compared as 32-bit values, which is fine as they are only
+	// ever compared for equality
+	std::uint32_t index [64] = {};
+	std::uint8_t previous [4] = { 0, 0, 0, 255 };
+	std::uint32_t previousValue;
+	std::memcpy (&previousValue, previous, 4);
+	int run = 0;
+
+	for (int y = 0; y < height; ++y) {
+		const auto row = bytes + static_cast<std::size_t> (y) * rowPitch;
+
+		for (int x = 0; x < width; ++x) {
+			const auto pixel = row + x * 4;
+			std::uint32_t value;
+			std::memcpy (&value, pixel, 4);
+
+			if (value == previousValue) {
+				if (++run == QOI_MAX_RUN) {
+					*output++ = static_cast<std::uint8_t> (QOI_OP_RUN | (run - 1));
+					run = 0;
+				}
+
+				continue;
+			}
+
+			if (run > 0) {
+				*output++ = static_cast<std::uint8_t> (QOI_OP_RUN | (run - 1));
+				run = 0;
+			}
+
+			const int hash = (pixel [0] * 3 + pixel [1] * 5 + pixel [2] * 7 +
+				pixel [3] * 11) & 63;
+
+			if (index [hash] == value) {
+				*output++ = static_cast<std::uint8_t> (QOI_OP_INDEX | hash);
+			} else if (pixel [3] == previous [3]) {
+				index [hash] = value;
+
+				// Differences wrap around
+				const int dr = static_cast<std::int8_t> (pixel [0] - previous [0]);
+				const int dg = static_cast<std::int8_t> (pixel [1] - previous [1]);
+				const int db = static_cast<std::int8_t> (pixel [2] - previous [2]);
+				const int drg = dr - dg;
+				const int dbg = db - dg;
+
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+					*output++ = static_cast<std::uint8_t> (QOI_OP_DIFF |
+						((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+				} else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 &&
+					dbg >= -8 && dbg <= 7) {
+					*output++ = static_cast<std::uint8_t> (QOI_OP_LUMA | (dg + 32));
+					*output++ = static_cast<std::uint8_t> (((drg + 8) << 4) | (dbg + 8));
+				} else {
+					*output++ = QOI_OP_RGB;
+					*output++ = pixel [0];
+					*output++ = pixel [1];
+					*output++ = pixel [2];
+				}
+			} else {
+				index [hash] = value;
+
+				*output++ = QOI_OP_RGBA;
+				std::memcpy (output, pixel, 4);
+				output += 4;
+			}
+
+			std::memcpy (previous, pixel, 4);
+			previousValue = value;
+		}
+	}
+
+	if (run > 0) {
+		*output++ = static_cast<std::uint8_t> (QOI_OP_RUN | (run - 1));
+	}
+
+	static const std::uint8_t END_MARKER [8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	std::memcpy (output, END_MARKER, sizeof (END_MARKER));
+	output += sizeof (END_MARKER);
+
+	result.resize (output - result.data ());
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> EncodeRaw (const void* pixels, const int width,
+	const int height, const int rowPitch)
+{
+	if (width <= 0 || height <= 0 || rowPitch < width * 4) {
+		throw std::runtime_error ("Invalid image size.");
+	}
+
+	const std::size_t headerSize = 16;
+	const auto imageSize = static_cast<std::size_t> (rowPitch) * height;
+	std::vector<std::uint8_t> result (headerSize + imageSize);
+
+	std::memcpy (result.data (), RAW_IMAGE_MAGIC, sizeof (RAW_IMAGE_MAGIC));
+	WriteLittleEndian32 (result.data () + 4, static_cast<std::uint32_t> (width));
+	WriteLittleEndian32 (result.data () + 8, static_cast<std::uint32_t> (height));
+	WriteLittleEndian32 (result.data () + 12, static_cast<std::uint32_t> (rowPitch));
+	std::memcpy (result.data () + headerSize, pixels, imageSize);
+
+	return result;
+}
+}
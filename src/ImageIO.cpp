@@ -1,12 +1,245 @@
 #include "ImageIO.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "Simd.h"
+#include "Utility.h"
+
+namespace {
+const std::uint8_t QOI_OP_INDEX = 0x00;
+const std::uint8_t QOI_OP_DIFF = 0x40;
+const std::uint8_t QOI_OP_LUMA = 0x80;
+const std::uint8_t QOI_OP_RUN = 0xC0;
+const std::uint8_t QOI_OP_RGB = 0xFE;
+const std::uint8_t QOI_OP_RGBA = 0xFF;
+const std::size_t QOI_HEADER_SIZE = 14;
+const std::size_t QOI_END_MARKER_SIZE = 8;
+
+const std::size_t RAW_HEADER_SIZE = 16;
+
+// Larger images are rejected before allocating memory for them
+const std::uint64_t MAX_PIXEL_COUNT = 1ull << 28;
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t ReadBigEndian32 (const std::uint8_t* data)
+{
+	return (static_cast<std::uint32_t> (data [0]) << 24) | (data [1] << 16) |
+		(data [2] << 8) | data [3];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t ReadLittleEndian32 (const std::uint8_t* data)
+{
+	return data [0] | (data [1] << 8) | (data [2] << 16) |
+		(static_cast<std::uint32_t> (data [3]) << 24);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void CheckImageSize (const std::uint32_t width, const std::uint32_t height)
+{
+	if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF ||
+		static_cast<std::uint64_t> (width) * height > MAX_PIXEL_COUNT) {
+		throw std::runtime_error ("Invalid image size.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Write count copies of a 4-byte pixel.
+*/
+inline void FillPixels (std::uint8_t* target, const std::uint32_t pixel, int count)
+{
+#if ANTERU_SSE2
+	const __m128i pixels = _mm_set1_epi32 (static_cast<int> (pixel));
+	for (; count >= 4; count -= 4, target += 16) {
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (target), pixels);
+	}
+#elif ANTERU_NEON
+	const uint8x16_t pixels = vreinterpretq_u8_u32 (vdupq_n_u32 (pixel));
+	for (; count >= 4; count -= 4, target += 16) {
+		vst1q_u8 (target, pixels);
+	}
+#endif
+
+	for (; count > 0; --count, target += 4) {
+		std::memcpy (target, &pixel, 4);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Decode a QOI image into RGBA8, with each row padded to rowAlignment pixels.
+Runs are written with vector stores, everything else is inherently serial
+as each operation depends on the previous pixel.
+*/
+std::vector<std::uint8_t> LoadQoi (const std::uint8_t* data, const std::size_t size,
+	const int rowAlignment, int* outputWidth, int* outputHeight)
+{
+	if (size < QOI_HEADER_SIZE + QOI_END_MARKER_SIZE ||
+		std::memcmp (data, "qoif", 4) != 0) {
+		throw std::runtime_error ("Not a QOI image.");
+	}
+
+	const auto width = ReadBigEndian32 (data + 4);
+	const auto height = ReadBigEndian32 (data + 8);
+	CheckImageSize (width, height);
+
+	if (data [12] != 3 && data [12] != 4) {
+		throw std::runtime_error ("Unsupported QOI format.");
+	}
+
+	const std::size_t rowPitch = RoundToNextMultiple (static_cast<int> (width),
+		rowAlignment) * std::size_t (4);
+	std::vector<std::uint8_t> result (rowPitch * height);
+
+	// Pixels are kept as 32-bit values in memory order, that is, RGBA
+	std::uint32_t index [64] = {};
+	std::uint8_t pixel [4] = { 0, 0, 0, 255 };
+	std::uint32_t pixelValue;
+	std::memcpy (&pixelValue, pixel, 4);
+	int run = 0;
+
+	// The end marker is only padding, so operations must end before it
+	const auto* input = data + QOI_HEADER_SIZE;
+	const auto* inputEnd = data + size - QOI_END_MARKER_SIZE;
+
+	for (std::uint32_t y = 0; y < height; ++y) {
+		auto target = result.data () + y * rowPitch;
+		const auto rowEnd = target + width * 4;
+
+		while (target < rowEnd) {
+			if (run > 0) {
+				const int count = std::min (run, static_cast<int> ((rowEnd - target) / 4));
+				FillPixels (target, pixelValue, count);
+				target += count * 4;
+				run -= count;
+				continue;
+			}
+
+			if (input >= inputEnd) {
+				throw std::runtime_error ("Truncated QOI image.");
+			}
+
+			const int op = *input++;
+			if (op == QOI_OP_RGB) {
+				if (inputEnd - input < 3) {
+					throw std::runtime_error ("Truncated QOI image.");
+				}
+
+				std::memcpy (pixel, input, 3);
+				input += 3;
+			} else if (op == QOI_OP_RGBA) {
+				if (inputEnd - input < 4) {
+					throw std::runtime_error ("Truncated QOI image.");
+				}
+
+				std::memcpy (pixel, input, 4);
+				input += 4;
+			} else if ((op & 0xC0) == QOI_OP_INDEX) {
+				// Indexed pixels are in the index already
+				pixelValue = index [op];
+				std::memcpy (pixel, &pixelValue, 4);
+				std::memcpy (target, &pixelValue, 4);
+				target += 4;
+				continue;
+			} else if ((op & 0xC0) == QOI_OP_DIFF) {
+				pixel [0] += ((op >> 4) & 3) - 2;
+				pixel [1] += ((op >> 2) & 3) - 2;
+				pixel [2] += (op & 3) - 2;
+			} else if ((op & 0xC0) == QOI_OP_LUMA) {
+				if (input == inputEnd) {
+					throw std::runtime_error ("Truncated QOI image.");
+				}
+
+				const int next = *input++;
+				const int dg = (op & 0x3F) - 32;
+				pixel [0] += dg - 8 + (next >> 4);
+				pixel [1] += dg;
+				pixel [2] += dg - 8 + (next & 0x0F);
+			} else {
+				// The run includes the current pixel, which the decoder
+				// also has to add to the index
+				run = (op & 0x3F) + 1;
+			}
+
+			std::memcpy (&pixelValue, pixel, 4);
+			index [(pixel [0] * 3 + pixel [1] * 5 + pixel [2] * 7 + pixel [3] * 11) & 63] = pixelValue;
+
+			if (run == 0) {
+				std::memcpy (target, &pixelValue, 4);
+				target += 4;
+			}
+		}
+	}
+
+	if (outputWidth) {
+		*outputWidth = static_cast<int> (width);
+	}
+
+	if (outputHeight) {
+		*outputHeight = static_cast<int> (height);
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Load a raw RGBA8 image, see ImageIO.h for the layout.
+*/
+std::vector<std::uint8_t> LoadRaw (const std::uint8_t* data, const std::size_t size,
+	const int rowAlignment, int* outputWidth, int* outputHeight)
+{
+	if (size < RAW_HEADER_SIZE || std::memcmp (data, RAW_IMAGE_MAGIC, 4) != 0) {
+		throw std::runtime_error ("Not a raw image.");
+	}
+
+	const auto width = ReadLittleEndian32 (data + 4);
+	const auto height = ReadLittleEndian32 (data + 8);
+	const auto sourcePitch = ReadLittleEndian32 (data + 12);
+	CheckImageSize (width, height);
+
+	const std::size_t rowSize = width * std::size_t (4);
+	// The last row does not need to be padded
+	if (sourcePitch < rowSize || size - RAW_HEADER_SIZE < rowSize ||
+		(size - RAW_HEADER_SIZE - rowSize) / sourcePitch < height - 1) {
+		throw std::runtime_error ("Truncated raw image.");
+	}
+
+	const std::size_t rowPitch = RoundToNextMultiple (static_cast<int> (width),
+		rowAlignment) * std::size_t (4);
+	std::vector<std::uint8_t> result (rowPitch * height);
+
+	if (rowPitch == sourcePitch) {
+		std::memcpy (result.data (), data + RAW_HEADER_SIZE, rowPitch * (height - 1) + rowSize);
+	} else {
+		for (std::uint32_t y = 0; y < height; ++y) {
+			std::memcpy (result.data () + y * rowPitch,
+				data + RAW_HEADER_SIZE + y * std::size_t (sourcePitch), rowSize);
+		}
+	}
+
+	if (outputWidth) {
+		*outputWidth = static_cast<int> (width);
+	}
+
+	if (outputHeight) {
+		*outputHeight = static_cast<int> (height);
+	}
+
+	return result;
+}
+}
+
+#ifdef _WIN32
 #include <Windows.h>
 #include <wrl.h>
 #include <wincodec.h>
 // for _com_error
 #include <comdef.h>
 
-#include "Utility.h"
 #define SAFE_WIC(expr) do {const auto r = expr; if (FAILED(r)) {_com_error err (r); OutputDebugStringA (err.ErrorMessage()); __debugbreak ();} } while (0)
 
 using namespace Microsoft::WRL;
@@ -51,49 +284,248 @@ std::vector<std::uint8_t> LoadInternal(ComPtr<IWICImagingFactory> factory, ComPt
 
 	return result;
 }
-}
 
-std::vector<std::uint8_t> LoadImageFromFile (const char* path, const int rowAlignment,
-	int* outputWidth, int* outputHeight)
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> LoadWic (const std::uint8_t* data, const std::size_t size,
+	const int rowAlignment, int* outputWidth, int* outputHeight)
 {
 	ComPtr<IWICImagingFactory> factory;
-	HRESULT hr = CoCreateInstance (
+	HRESULT hr = CoCreateInstance(
 		CLSID_WICImagingFactory,
 		NULL,
 		CLSCTX_INPROC_SERVER,
-		IID_PPV_ARGS (&factory)
+		IID_PPV_ARGS(&factory)
 		);
 
-	ComPtr<IWICBitmapDecoder> decoder;
-
-	std::vector<wchar_t> pathWchar (::strlen (path) + 1);
-	mbstowcs (pathWchar.data (), path, pathWchar.size ());
-
 	ComPtr<IWICStream> stream;
 	factory->CreateStream(&stream);
-	stream->InitializeFromFilename(pathWchar.data (), GENERIC_READ);
+
+	// This is fine here as the memory will live on when the stream is long gone
+	stream->InitializeFromMemory(const_cast<BYTE*> (data),
+		static_cast<DWORD> (size));
 
 	return LoadInternal(factory, stream, rowAlignment, outputWidth, outputHeight);
+}
+}
+#else
+#include "Deflate.h"
 
+namespace {
+const std::uint8_t PNG_SIGNATURE [8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+///////////////////////////////////////////////////////////////////////////////
+int PaethPredictor (const int a, const int b, const int c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs (p - a);
+	const int pb = std::abs (p - b);
+	const int pc = std::abs (p - c);
+
+	if (pa <= pb && pa <= pc) {
+		return a;
+	} else if (pb <= pc) {
+		return b;
+	} else {
+		return c;
+	}
 }
 
-std::vector<std::uint8_t> LoadImageFromMemory(const void* data, const std::size_t size,  
+///////////////////////////////////////////////////////////////////////////////
+/**
+Undo the PNG filter of one row in place. previous is the already
+unfiltered row above, or nullptr for the first row.
+*/
+void UnfilterRow (const int filter, std::uint8_t* row, const std::uint8_t* previous,
+	const std::size_t rowSize, const int bytesPerPixel)
+{
+	switch (filter) {
+	case 0:
+		break;
+
+	case 1:
+		for (std::size_t i = bytesPerPixel; i < rowSize; ++i) {
+			row [i] += row [i - bytesPerPixel];
+		}
+		break;
+
+	case 2:
+		if (previous) {
+			for (std::size_t i = 0; i < rowSize; ++i) {
+				row [i] += previous [i];
+			}
+		}
+		break;
+
+	case 3:
+		for (std::size_t i = 0; i < rowSize; ++i) {
+			const int left = i >= static_cast<std::size_t> (bytesPerPixel) ? row [i - bytesPerPixel] : 0;
+			const int up = previous ? previous [i] : 0;
+			row [i] += static_cast<std::uint8_t> ((left + up) / 2);
+		}
+		break;
+
+	case 4:
+		for (std::size_t i = 0; i < rowSize; ++i) {
+			const bool hasLeft = i >= static_cast<std::size_t> (bytesPerPixel);
+			const int left = hasLeft ? row [i - bytesPerPixel] : 0;
+			const int up = previous ? previous [i] : 0;
+			const int upLeft = (hasLeft && previous) ? previous [i - bytesPerPixel] : 0;
+			row [i] += static_cast<std::uint8_t> (PaethPredictor (left, up, upLeft));
+		}
+		break;
+
+	default:
+		throw std::runtime_error ("Invalid PNG filter.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Decode a non-interlaced 8-bit PNG into RGBA8, with each row padded to
+rowAlignment pixels. This covers the images we ship with the sample, WIC
+is used on Windows to handle everything else.
+*/
+std::vector<std::uint8_t> LoadPng (const std::uint8_t* data, const std::size_t size,
 	const int rowAlignment, int* outputWidth, int* outputHeight)
 {
-	ComPtr<IWICImagingFactory> factory;
-	HRESULT hr = CoCreateInstance(
-		CLSID_WICImagingFactory,
-		NULL,
-		CLSCTX_INPROC_SERVER,
-		IID_PPV_ARGS(&factory)
-		);
+	if (size < sizeof (PNG_SIGNATURE) ||
+		std::memcmp (data, PNG_SIGNATURE, sizeof (PNG_SIGNATURE)) != 0) {
+		throw std::runtime_error ("Not a PNG image.");
+	}
 
-	ComPtr<IWICStream> stream;
-	factory->CreateStream(&stream);
+	int width = 0, height = 0, colorType = -1;
+	std::vector<std::uint8_t> palette (256 * 4, 255);
+	std::vector<std::uint8_t> compressed;
 
-	// This is fine here as the memory will live on when the stream is long gone
-	stream->InitializeFromMemory(static_cast<BYTE*> (const_cast<void*> (data)), 
-		static_cast<DWORD> (size));
+	for (std::size_t offset = sizeof (PNG_SIGNATURE); offset + 12 <= size; ) {
+		const auto length = ReadBigEndian32 (data + offset);
+		const auto type = data + offset + 4;
+		const auto chunk = data + offset + 8;
 
-	return LoadInternal(factory, stream, rowAlignment, outputWidth, outputHeight);
+		if (length > size - offset - 12) {
+			throw std::runtime_error ("Truncated PNG chunk.");
+		}
+
+		if (std::memcmp (type, "IHDR", 4) == 0) {
+			width = static_cast<int> (ReadBigEndian32 (chunk));
+			height = static_cast<int> (ReadBigEndian32 (chunk + 4));
+			colorType = chunk [9];
+
+			// Bit depth 8, deflate, adaptive filtering, no interlacing
+			if (chunk [8] != 8 || chunk [10] != 0 || chunk [11] != 0 || chunk [12] != 0) {
+				throw std::runtime_error ("Unsupported PNG format.");
+			}
+		} else if (std::memcmp (type, "PLTE", 4) == 0) {
+			for (std::uint32_t i = 0; i < length / 3 && i < 256; ++i) {
+				std::memcpy (&palette [i * 4], chunk + i * 3, 3);
+			}
+		} else if (std::memcmp (type, "tRNS", 4) == 0 && colorType == 3) {
+			for (std::uint32_t i = 0; i < length && i < 256; ++i) {
+				palette [i * 4 + 3] = chunk [i];
+			}
+		} else if (std::memcmp (type, "IDAT", 4) == 0) {
+			compressed.insert (compressed.end (), chunk, chunk + length);
+		} else if (std::memcmp (type, "IEND", 4) == 0) {
+			break;
+		}
+
+		offset += length + 12;
+	}
+
+	int channels;
+	switch (colorType) {
+	case 0: channels = 1; break;
+	case 2: channels = 3; break;
+	case 3: channels = 1; break;
+	case 4: channels = 2; break;
+	case 6: channels = 4; break;
+	default:
+		throw std::runtime_error ("Unsupported PNG color type.");
+	}
+
+	if (width <= 0 || height <= 0) {
+		throw std::runtime_error ("Invalid PNG size.");
+	}
+
+	const std::size_t rowSize = static_cast<std::size_t> (width) * channels;
+	auto pixels = anteru::ZlibDecompress (compressed.data (), compressed.size (),
+		(rowSize + 1) * height);
+	if (pixels.size () < (rowSize + 1) * height) {
+		throw std::runtime_error ("Truncated PNG image data.");
+	}
+
+	const int paddedWidth = RoundToNextMultiple (width, rowAlignment);
+	std::vector<std::uint8_t> result (static_cast<std::size_t> (paddedWidth) * height * 4);
+
+	const std::uint8_t* previous = nullptr;
+	for (int y = 0; y < height; ++y) {
+		auto row = pixels.data () + y * (rowSize + 1);
+		UnfilterRow (row [0], row + 1, previous, rowSize, channels);
+		previous = row + 1;
+
+		auto target = result.data () + static_cast<std::size_t> (y) * paddedWidth * 4;
+		const auto source = row + 1;
+		for (int x = 0; x < width; ++x) {
+			switch (colorType) {
+			case 0:
+				target [x * 4 + 0] = target [x * 4 + 1] = target [x * 4 + 2] = source [x];
+				target [x * 4 + 3] = 255;
+				break;
+			case 2:
+				std::memcpy (target + x * 4, source + x * 3, 3);
+				target [x * 4 + 3] = 255;
+				break;
+			case 3:
+				std::memcpy (target + x * 4, &palette [source [x] * 4], 4);
+				break;
+			case 4:
+				target [x * 4 + 0] = target [x * 4 + 1] = target [x * 4 + 2] = source [x * 2];
+				target [x * 4 + 3] = source [x * 2 + 1];
+				break;
+			case 6:
+				std::memcpy (target + x * 4, source + x * 4, 4);
+				break;
+			}
+		}
+	}
+
+	if (outputWidth) {
+		*outputWidth = width;
+	}
+
+	if (outputHeight) {
+		*outputHeight = height;
+	}
+
+	return result;
+}
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> LoadImageFromFile (const char* path, const int rowAlignment,
+	int* outputWidth, int* outputHeight)
+{
+	const auto data = ReadFile (path);
+	return LoadImageFromMemory (data.data (), data.size (), rowAlignment,
+		outputWidth, outputHeight);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> LoadImageFromMemory (const void* data, const std::size_t size,
+	const int rowAlignment, int* outputWidth, int* outputHeight)
+{
+	auto bytes = static_cast<const std::uint8_t*> (data);
+
+	if (size >= 4 && std::memcmp (bytes, "qoif", 4) == 0) {
+		return LoadQoi (bytes, size, rowAlignment, outputWidth, outputHeight);
+	} else if (size >= 4 && std::memcmp (bytes, RAW_IMAGE_MAGIC, 4) == 0) {
+		return LoadRaw (bytes, size, rowAlignment, outputWidth, outputHeight);
+	}
+
+#ifdef _WIN32
+	return LoadWic (bytes, size, rowAlignment, outputWidth, outputHeight);
+#else
+	return LoadPng (bytes, size, rowAlignment, outputWidth, outputHeight);
+#endif
 }
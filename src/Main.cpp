@@ -0,0 +1,248 @@
+#include "D3D12Sample.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ImageEncoder.h"
+#include "NullDevice.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#include "D3D12Device.h"
+#endif
+
+#ifdef max 
+#undef max
+#endif
+
+namespace {
+const char USAGE [] =
+	"Usage: anD3D12Sample [options] [framesInFlight] [backBufferCount] [traceFile]\n"
+	"\n"
+	"framesInFlight and backBufferCount default to 3, backBufferCount must be\n"
+	"from 2 to 16. If traceFile is given, a Chrome trace of the run is\n"
+	"written to it.\n"
+	"\n"
+	"  --null                run without a GPU, the only option outside of Windows\n"
+	"  --software            render on the CPU with the software rasterizer\n"
+	"  --offscreen file      render without a window and stream the frames into\n"
+	"                        file as raw 8-bit RGBA, one 512x512 image after the\n"
+	"                        other. If file ends in .png or .qoi, each frame is\n"
+	"                        written to its own image instead, named\n"
+	"                        file_00000.png, file_00001.png, ...\n"
+	"  --block-compression   allow storing the texture as BC1/BC3\n"
+	"  --shader-cache file   store compiled shaders in file instead of\n"
+	"                        anD3D12Sample.shadercache in the working directory\n"
+	"  --pipeline-cache file store compiled pipeline states in file instead of\n"
+	"                        anD3D12Sample.pipelinecache in the working directory\n"
+	"  --no-shader-archive   compile the shaders at runtime instead of using the\n"
+	"                        precompiled ones, through the shader cache\n"
+	"  --no-bundles          record all draws into the command list every frame\n"
+	"  --mesh file           draw the .obj or .glb mesh in file instead of a quad\n"
+	"  --float-vertices      store the vertices as floats instead of 16-bit\n"
+	"                        normalized integers\n"
+	"  --help                show this message\n";
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Parse a count. Returns false if text is not entirely a number, or the
+number is outside of [minimum, maximum].
+*/
+bool ParseCount (const char* text, const int minimum, const int maximum,
+	int& count)
+{
+	char* end = nullptr;
+	const long value = std::strtol (text, &end, 10);
+
+	if (end == text || *end != '\0' || value < minimum || value > maximum) {
+		return false;
+	}
+
+	count = static_cast<int> (value);
+	return true;
+}
+}
+
+int main (int argc, char* argv [])
+{
+#ifdef _WIN32
+	bool useNullDevice = false;
+#else
+	bool useNullDevice = true;
+#endif
+	bool useSoftwareDevice = false;
+	const char* offscreenFile = nullptr;
+	anteru::TexturePackingOptions texturePacking;
+	std::string shaderCachePath = "anD3D12Sample.shadercache";
+	std::string pipelineCachePath = "anD3D12Sample.pipelinecache";
+	bool useShaderArchive = true;
+	bool useBundles = true;
+	std::string meshPath;
+	anteru::VertexFormat vertexFormat;
+
+	std::vector<const char*> arguments;
+	for (int i = 1; i < argc; ++i) {
+		const std::string argument = argv [i];
+
+		const char* value = nullptr;
+		if (argument == "--offscreen" || argument == "--shader-cache" ||
+			argument == "--pipeline-cache" || argument == "--mesh") {
+			if (i + 1 >= argc) {
+				std::cerr << argument << " requires a file name\n\n" << USAGE;
+				return 1;
+			}
+
+			value = argv [++i];
+		}
+
+		if (argument == "--help" || argument == "-h") {
+			std::cout << USAGE;
+			return 0;
+		} else if (argument == "--null") {
+			useNullDevice = true;
+		} else if (argument == "--software") {
+			useSoftwareDevice = true;
+		} else if (argument == "--offscreen") {
+			offscreenFile = value;
+		} else if (argument == "--block-compression") {
+			texturePacking.allowBlockCompression = true;
+		} else if (argument == "--shader-cache") {
+			shaderCachePath = value;
+		} else if (argument == "--pipeline-cache") {
+			pipelineCachePath = value;
+		} else if (argument == "--no-shader-archive") {
+			useShaderArchive = false;
+		} else if (argument == "--no-bundles") {
+			useBundles = false;
+		} else if (argument == "--mesh") {
+			meshPath = value;
+		} else if (argument == "--float-vertices") {
+			vertexFormat.position = anteru::PositionEncoding::Float;
+			vertexFormat.uv = anteru::UvEncoding::Float;
+		} else if (argument.size () > 1 && argument [0] == '-') {
+			std::cerr << "Unknown option " << argument << "\n\n" << USAGE;
+			return 1;
+		} else {
+			arguments.push_back (argv [i]);
+		}
+	}
+
+	if (arguments.size () > 3) {
+		std::cerr << "Too many arguments\n\n" << USAGE;
+		return 1;
+	}
+
+	int framesInFlight = 3;
+	int backBufferCount = 3;
+	const char* traceFile = arguments.size () > 2 ? arguments [2] : nullptr;
+
+	if (arguments.size () > 0 && ! ParseCount (arguments [0], 1,
+		std::numeric_limits<int>::max (), framesInFlight)) {
+		std::cerr << "The number of frames in flight must be a number of at least 1, got "
+			<< arguments [0] << "\n\n" << USAGE;
+		return 1;
+	}
+
+	// Flip model swap chains need at least two buffers
+	if (arguments.size () > 1 && ! ParseCount (arguments [1], 2,
+		anteru::MAX_SWAP_CHAIN_BUFFERS, backBufferCount)) {
+		std::cerr << "The number of back buffers must be a number from 2 to "
+			<< anteru::MAX_SWAP_CHAIN_BUFFERS << ", got "
+			<< arguments [1] << "\n\n" << USAGE;
+		return 1;
+	}
+
+	if (traceFile) {
+		anteru::Tracer::Start ();
+	}
+
+	// The sample throws if it cannot run with the given settings, for
+	// instance an unsupported number of back buffers
+	try {
+		std::unique_ptr<anteru::IRenderDevice> device;
+		if (useSoftwareDevice) {
+			device = anteru::CreateSoftwareDevice ();
+		} else if (useNullDevice) {
+			device = anteru::CreateNullDevice ();
+		}
+#ifdef _WIN32
+		else {
+			device = anteru::CreateD3D12Device ();
+		}
+#endif
+
+		anteru::D3D12Sample sample (std::move (device), framesInFlight, backBufferCount);
+		sample.SetStatisticsInterval (128);
+		sample.SetTexturePacking (texturePacking);
+		sample.SetShaderCache (shaderCachePath);
+		sample.SetPipelineCache (pipelineCachePath);
+		sample.SetUseShaderArchive (useShaderArchive);
+		sample.SetUseBundles (useBundles);
+		sample.SetMesh (meshPath);
+		sample.SetVertexFormat (vertexFormat);
+
+		const std::string offscreenPath (offscreenFile ? offscreenFile : "");
+		const auto offscreenExtension = offscreenPath.size () > 4 ?
+			offscreenPath.substr (offscreenPath.size () - 4) : std::string ();
+
+		anteru::ThreadPool encoderPool;
+		std::ofstream frameOutput;
+		if (offscreenExtension == ".png" || offscreenExtension == ".qoi") {
+			const auto stem = offscreenPath.substr (0, offscreenPath.size () - 4);
+
+			// stem goes out of scope before the frames are delivered in Run
+			sample.SetOffscreen (512, 512, [&encoderPool, stem, offscreenExtension] (
+				const anteru::ReadbackFrame& frame) {
+				const auto image = offscreenExtension == ".png"
+					? anteru::EncodePng (frame.data, frame.width, frame.height,
+						frame.rowPitch, &encoderPool)
+					: anteru::EncodeQoi (frame.data, frame.width, frame.height,
+						frame.rowPitch);
+
+				char suffix [32];
+				std::snprintf (suffix, sizeof (suffix), "_%05d",
+					static_cast<int> (frame.frameIndex));
+				std::ofstream output (stem + suffix + offscreenExtension, std::ios::binary);
+				output.write (reinterpret_cast<const char*> (image.data ()), image.size ());
+			});
+		} else if (offscreenFile) {
+			frameOutput.open (offscreenFile, std::ios::binary);
+			if (! frameOutput) {
+				throw std::runtime_error (std::string ("Could not open ") +
+					offscreenFile + ".");
+			}
+
+			sample.SetOffscreen (512, 512, [&] (const anteru::ReadbackFrame& frame) {
+				const int rowSize = frame.width * anteru::GetBytesPerPixel (frame.format);
+				for (int y = 0; y < frame.height; ++y) {
+					frameOutput.write (reinterpret_cast<const char*> (
+						frame.data + y * frame.rowPitch), rowSize);
+				}
+			});
+		}
+
+		sample.Run (512);
+	} catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what () << std::endl;
+
+		if (traceFile) {
+			anteru::Tracer::Stop ();
+		}
+
+		return 1;
+	}
+
+	if (traceFile) {
+		anteru::Tracer::Stop ();
+		if (! anteru::Tracer::WriteChromeTrace (traceFile)) {
+			std::cerr << "Could not write trace to " << traceFile << std::endl;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <string>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace anteru {
+#if defined(_WIN32)
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile (const char* path)
+{
+	// Sharing delete allows other processes to rename a new version over
+	// the file while it is open. Windows still refuses this while the file
+	// is mapped, in which case WriteFileAtomic fails and the file stays as
+	// it is
+	const auto file = CreateFileA (path, GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (! GetFileSizeEx (file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle (file);
+		return;
+	}
+
+	const auto mapping = CreateFileMappingA (file, nullptr, PAGE_READONLY,
+		0, 0, nullptr);
+	if (! mapping) {
+		CloseHandle (file);
+		return;
+	}
+
+	const auto view = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+	if (! view) {
+		CloseHandle (mapping);
+		CloseHandle (file);
+		return;
+	}
+
+	file_ = file;
+	mapping_ = mapping;
+	data_ = static_cast<const std::uint8_t*> (view);
+	size_ = static_cast<std::size_t> (fileSize.QuadPart);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile ()
+{
+	if (data_) {
+		UnmapViewOfFile (data_);
+		CloseHandle (mapping_);
+		CloseHandle (file_);
+	}
+}
+#else
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile (const char* path)
+{
+	const int file = open (path, O_RDONLY);
+	if (file < 0) {
+		return;
+	}
+
+	struct stat status;
+	if (fstat (file, &status) == 0 && status.st_size > 0) {
+		const auto view = mmap (nullptr, static_cast<std::size_t> (status.st_size),
+			PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (view != MAP_FAILED) {
+			data_ = static_cast<const std::uint8_t*> (view);
+			size_ = static_cast<std::size_t> (status.st_size);
+		}
+	}
+
+	// The mapping keeps the file alive
+	close (file);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile ()
+{
+	if (data_) {
+		munmap (const_cast<std::uint8_t*> (data_), size_);
+	}
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+bool WriteFileAtomic (const char* path, const void* data, const std::size_t size)
+{
+	// The process id keeps concurrent writers from sharing a temporary file
+#if defined(_WIN32)
+	const auto processId = static_cast<unsigned long> (GetCurrentProcessId ());
+#else
+	const auto processId = static_cast<unsigned long> (getpid ());
+#endif
+	const auto temporaryPath = std::string (path) + ".tmp" + std::to_string (processId);
+
+	auto file = std::fopen (temporaryPath.c_str (), "wb");
+	if (! file) {
+		return false;
+	}
+
+	bool written = std::fwrite (data, 1, size, file) == size &&
+		std::fflush (file) == 0;
+#if defined(_WIN32)
+	written = written && _commit (_fileno (file)) == 0;
+#else
+	written = written && fsync (fileno (file)) == 0;
+#endif
+	written = (std::fclose (file) == 0) && written;
+
+	if (written) {
+#if defined(_WIN32)
+		written = MoveFileExA (temporaryPath.c_str (), path,
+			MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		written = std::rename (temporaryPath.c_str (), path) == 0;
+#endif
+	}
+
+	if (! written) {
+		std::remove (temporaryPath.c_str ());
+	}
+
+	return written;
+}
+}
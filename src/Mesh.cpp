@@ -0,0 +1,1087 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "MappedFile.h"
+
+namespace anteru {
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+bool IsDigit (const char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SkipSpaces (const char*& p, const char* end)
+{
+	while (p != end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+		++p;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Parse a decimal floating point number. Up to 19 significant digits are
+accumulated as an integer and scaled once, which is a lot faster than
+strtod. The result can be off in the last bit of a double, which hardly
+ever survives the rounding to float.
+*/
+bool ParseNumber (const char*& p, const char* end, double* result)
+{
+	static const double POWERS_OF_TEN [] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const char* s = p;
+	bool negative = false;
+	if (s != end && (*s == '-' || *s == '+')) {
+		negative = *s == '-';
+		++s;
+	}
+
+	std::uint64_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	for (; s != end && IsDigit (*s); ++s) {
+		anyDigits = true;
+		if (significantDigits < 19) {
+			mantissa = mantissa * 10 + (*s - '0');
+			if (mantissa != 0) {
+				++significantDigits;
+			}
+		} else {
+			++exponent;
+		}
+	}
+
+	if (s != end && *s == '.') {
+		for (++s; s != end && IsDigit (*s); ++s) {
+			anyDigits = true;
+			if (significantDigits < 19) {
+				mantissa = mantissa * 10 + (*s - '0');
+				if (mantissa != 0) {
+					++significantDigits;
+				}
+				--exponent;
+			}
+		}
+	}
+
+	if (! anyDigits) {
+		return false;
+	}
+
+	if (s != end && (*s == 'e' || *s == 'E')) {
+		const char* e = s + 1;
+		bool negativeExponent = false;
+		if (e != end && (*e == '-' || *e == '+')) {
+			negativeExponent = *e == '-';
+			++e;
+		}
+
+		if (e != end && IsDigit (*e)) {
+			int value = 0;
+			for (; e != end && IsDigit (*e); ++e) {
+				value = std::min (value * 10 + (*e - '0'), 100000);
+			}
+
+			exponent += negativeExponent ? -value : value;
+			s = e;
+		}
+	}
+
+	double value = static_cast<double> (mantissa);
+	if (exponent < 0 && exponent >= -22) {
+		value /= POWERS_OF_TEN [-exponent];
+	} else if (exponent > 0 && exponent <= 22) {
+		value *= POWERS_OF_TEN [exponent];
+	} else if (exponent != 0) {
+		value *= std::pow (10.0, exponent);
+	}
+
+	*result = negative ? -value : value;
+	p = s;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ParseFloat (const char*& p, const char* end, float* result)
+{
+	double value;
+	if (! ParseNumber (p, end, &value)) {
+		return false;
+	}
+
+	*result = static_cast<float> (value);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ParseInt (const char*& p, const char* end, int* result)
+{
+	const char* s = p;
+	bool negative = false;
+	if (s != end && (*s == '-' || *s == '+')) {
+		negative = *s == '-';
+		++s;
+	}
+
+	if (s == end || ! IsDigit (*s)) {
+		return false;
+	}
+
+	long long value = 0;
+	for (; s != end && IsDigit (*s); ++s) {
+		value = std::min (value * 10 + (*s - '0'), 1LL << 40);
+	}
+
+	// Out of range values turn into invalid indices
+	value = std::min (value, 0x7FFFFFFFLL);
+	*result = static_cast<int> (negative ? -value : value);
+	p = s;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Resolve a 1-based OBJ index, negative indices are relative to the end of
+the elements read so far. Returns -1 for invalid indices.
+*/
+int ResolveObjIndex (const int index, const std::size_t count)
+{
+	if (index > 0) {
+		return index - 1;
+	} else if (index < 0 && static_cast<std::size_t> (-static_cast<long long> (index)) <= count) {
+		return static_cast<int> (count) + index;
+	} else {
+		return -1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct ObjCorner
+{
+	int position;
+	int uv;
+	int normal;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Just enough JSON for the glTF header: objects, arrays, strings, numbers
+and literals.
+*/
+class JsonValue
+{
+public:
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Type type = Type::Null;
+	double number = 0;
+	std::string string;
+	std::vector<JsonValue> elements;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	const JsonValue* Find (const char* key) const
+	{
+		for (const auto& member : members) {
+			if (member.first == key) {
+				return &member.second;
+			}
+		}
+
+		return nullptr;
+	}
+
+	const JsonValue& operator[] (const char* key) const
+	{
+		const auto value = Find (key);
+		if (! value) {
+			throw std::runtime_error (std::string ("Missing glTF property '") + key + "'.");
+		}
+
+		return *value;
+	}
+
+	const JsonValue& operator[] (const std::size_t index) const
+	{
+		if (type != Type::Array || index >= elements.size ()) {
+			throw std::runtime_error ("Invalid glTF index.");
+		}
+
+		return elements [index];
+	}
+
+	int GetInt () const
+	{
+		if (type != Type::Number || number < 0 || number > 0x7FFFFFFF ||
+			number != std::floor (number)) {
+			throw std::runtime_error ("Invalid glTF integer.");
+		}
+
+		return static_cast<int> (number);
+	}
+
+	int GetInt (const char* key, const int defaultValue) const
+	{
+		const auto value = Find (key);
+		return value ? value->GetInt () : defaultValue;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class JsonParser
+{
+public:
+	JsonParser (const char* text, const std::size_t size)
+		: p_ (text)
+		, end_ (text + size)
+	{
+	}
+
+	JsonValue Parse ()
+	{
+		JsonValue value;
+		ParseValue (value, 0);
+		SkipWhitespace ();
+		if (p_ != end_) {
+			Fail ();
+		}
+
+		return value;
+	}
+
+private:
+	// glTF files are shallow, this only protects the stack
+	static const int MAX_DEPTH = 64;
+
+	[[noreturn]] static void Fail ()
+	{
+		throw std::runtime_error ("Invalid glTF JSON.");
+	}
+
+	void SkipWhitespace ()
+	{
+		while (p_ != end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+			++p_;
+		}
+	}
+
+	void Expect (const char c)
+	{
+		SkipWhitespace ();
+		if (p_ == end_ || *p_ != c) {
+			Fail ();
+		}
+
+		++p_;
+	}
+
+	bool Consume (const char c)
+	{
+		SkipWhitespace ();
+		if (p_ != end_ && *p_ == c) {
+			++p_;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool ConsumeLiteral (const char* literal)
+	{
+		const auto length = std::strlen (literal);
+		if (static_cast<std::size_t> (end_ - p_) >= length &&
+			std::memcmp (p_, literal, length) == 0) {
+			p_ += length;
+			return true;
+		}
+
+		return false;
+	}
+
+	void ParseValue (JsonValue& value, const int depth)
+	{
+		if (depth > MAX_DEPTH) {
+			Fail ();
+		}
+
+		SkipWhitespace ();
+		if (p_ == end_) {
+			Fail ();
+		}
+
+		if (*p_ == '{') {
+			++p_;
+			value.type = JsonValue::Type::Object;
+			if (Consume ('}')) {
+				return;
+			}
+
+			do {
+				SkipWhitespace ();
+				std::string key;
+				ParseString (key);
+				Expect (':');
+				value.members.emplace_back (std::move (key), JsonValue ());
+				ParseValue (value.members.back ().second, depth + 1);
+			} while (Consume (','));
+
+			Expect ('}');
+		} else if (*p_ == '[') {
+			++p_;
+			value.type = JsonValue::Type::Array;
+			if (Consume (']')) {
+				return;
+			}
+
+			do {
+				value.elements.emplace_back ();
+				ParseValue (value.elements.back (), depth + 1);
+			} while (Consume (','));
+
+			Expect (']');
+		} else if (*p_ == '"') {
+			value.type = JsonValue::Type::String;
+			ParseString (value.string);
+		} else if (ConsumeLiteral ("true")) {
+			value.type = JsonValue::Type::Bool;
+			value.number = 1;
+		} else if (ConsumeLiteral ("false")) {
+			value.type = JsonValue::Type::Bool;
+		} else if (ConsumeLiteral ("null")) {
+			value.type = JsonValue::Type::Null;
+		} else {
+			if (! ParseNumber (p_, end_, &value.number)) {
+				Fail ();
+			}
+
+			value.type = JsonValue::Type::Number;
+		}
+	}
+
+	void ParseString (std::string& result)
+	{
+		if (p_ == end_ || *p_ != '"') {
+			Fail ();
+		}
+
+		for (++p_; p_ != end_ && *p_ != '"'; ++p_) {
+			if (*p_ != '\\') {
+				result.push_back (*p_);
+				continue;
+			}
+
+			if (++p_ == end_) {
+				Fail ();
+			}
+
+			switch (*p_) {
+			case 'b': result.push_back ('\b'); break;
+			case 'f': result.push_back ('\f'); break;
+			case 'n': result.push_back ('\n'); break;
+			case 'r': result.push_back ('\r'); break;
+			case 't': result.push_back ('\t'); break;
+			case 'u':
+				{
+					if (end_ - p_ < 5) {
+						Fail ();
+					}
+
+					unsigned int codePoint = 0;
+					for (int i = 1; i <= 4; ++i) {
+						const char c = p_ [i];
+						codePoint <<= 4;
+						if (IsDigit (c)) {
+							codePoint |= c - '0';
+						} else if (c >= 'a' && c <= 'f') {
+							codePoint |= c - 'a' + 10;
+						} else if (c >= 'A' && c <= 'F') {
+							codePoint |= c - 'A' + 10;
+						} else {
+							Fail ();
+						}
+					}
+
+					p_ += 4;
+
+					// Property names are ASCII, so surrogate pairs don't
+					// have to be combined
+					if (codePoint < 0x80) {
+						result.push_back (static_cast<char> (codePoint));
+					} else if (codePoint < 0x800) {
+						result.push_back (static_cast<char> (0xC0 | (codePoint >> 6)));
+						result.push_back (static_cast<char> (0x80 | (codePoint & 0x3F)));
+					} else {
+						result.push_back (static_cast<char> (0xE0 | (codePoint >> 12)));
+						result.push_back (static_cast<char> (0x80 | ((codePoint >> 6) & 0x3F)));
+						result.push_back (static_cast<char> (0x80 | (codePoint & 0x3F)));
+					}
+				}
+				break;
+			default:
+				result.push_back (*p_);
+			}
+		}
+
+		if (p_ == end_) {
+			Fail ();
+		}
+
+		++p_;
+	}
+
+	const char* p_;
+	const char* end_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t ReadUInt32 (const std::uint8_t* p)
+{
+	return p [0] | (p [1] << 8) | (p [2] << 16) |
+		(static_cast<std::uint32_t> (p [3]) << 24);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Read the elements of a glTF accessor into floats, componentCount per
+element. Integers are converted as they are, or into [0,1] respectively
+[-1,1] if the accessor is normalized.
+*/
+void ReadAccessor (const JsonValue& document, const std::uint8_t* buffer,
+	const std::size_t bufferSize, const int accessorIndex,
+	const int componentCount, std::vector<float>& result)
+{
+	enum
+	{
+		BYTE = 5120,
+		UNSIGNED_BYTE = 5121,
+		SHORT = 5122,
+		UNSIGNED_SHORT = 5123,
+		UNSIGNED_INT = 5125,
+		FLOAT = 5126
+	};
+
+	const auto& accessor = document ["accessors"] [accessorIndex];
+	if (accessor.Find ("sparse")) {
+		throw std::runtime_error ("Sparse glTF accessors are not supported.");
+	}
+
+	static const char* TYPES [] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+	if (accessor ["type"].string != TYPES [componentCount - 1]) {
+		throw std::runtime_error ("Unexpected glTF accessor type.");
+	}
+
+	const int componentType = accessor ["componentType"].GetInt ();
+	int componentSize;
+	switch (componentType) {
+	case BYTE: case UNSIGNED_BYTE: componentSize = 1; break;
+	case SHORT: case UNSIGNED_SHORT: componentSize = 2; break;
+	case UNSIGNED_INT: case FLOAT: componentSize = 4; break;
+	default:
+		throw std::runtime_error ("Invalid glTF component type.");
+	}
+
+	const auto normalizedValue = accessor.Find ("normalized");
+	const bool normalized = normalizedValue && normalizedValue->number != 0;
+	const std::size_t count = accessor ["count"].GetInt ();
+	const std::size_t elementSize = componentSize * componentCount;
+
+	result.resize (count * componentCount);
+	if (count == 0) {
+		return;
+	}
+
+	// Accessors without a buffer view are all zeros
+	const auto bufferViewIndex = accessor.Find ("bufferView");
+	if (! bufferViewIndex) {
+		std::fill (result.begin (), result.end (), 0.0f);
+		return;
+	}
+
+	const auto& bufferView = document ["bufferViews"] [bufferViewIndex->GetInt ()];
+	if (bufferView.GetInt ("buffer", 0) != 0) {
+		throw std::runtime_error ("Only the binary glTF buffer is supported.");
+	}
+
+	const std::size_t viewOffset = bufferView.GetInt ("byteOffset", 0);
+	const std::size_t viewLength = bufferView ["byteLength"].GetInt ();
+	const std::size_t stride = bufferView.GetInt ("byteStride",
+		static_cast<int> (elementSize));
+	const std::size_t offset = accessor.GetInt ("byteOffset", 0);
+
+	if (viewOffset + viewLength > bufferSize || stride < elementSize ||
+		offset + (count - 1) * stride + elementSize > viewLength) {
+		throw std::runtime_error ("glTF accessor is out of bounds.");
+	}
+
+	const std::uint8_t* p = buffer + viewOffset + offset;
+	for (std::size_t i = 0; i < count; ++i, p += stride) {
+		for (int c = 0; c < componentCount; ++c) {
+			const std::uint8_t* component = p + c * componentSize;
+			float value;
+
+			switch (componentType) {
+			case BYTE:
+				value = static_cast<std::int8_t> (*component);
+				value = normalized ? std::max (value / 127.0f, -1.0f) : value;
+				break;
+			case UNSIGNED_BYTE:
+				value = *component;
+				value = normalized ? value / 255.0f : value;
+				break;
+			case SHORT:
+				{
+					std::int16_t s;
+					std::memcpy (&s, component, 2);
+					value = normalized ? std::max (s / 32767.0f, -1.0f) : s;
+				}
+				break;
+			case UNSIGNED_SHORT:
+				{
+					std::uint16_t s;
+					std::memcpy (&s, component, 2);
+					value = normalized ? s / 65535.0f : s;
+				}
+				break;
+			case UNSIGNED_INT:
+				value = static_cast<float> (ReadUInt32 (component));
+				break;
+			default:
+				std::memcpy (&value, component, 4);
+			}
+
+			result [i * componentCount + c] = value;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Indices have to be read as integers, as floats can't represent all 32-bit
+values.
+*/
+void ReadIndices (const JsonValue& document, const std::uint8_t* buffer,
+	const std::size_t bufferSize, const int accessorIndex,
+	std::vector<std::uint32_t>& result)
+{
+	const auto& accessor = document ["accessors"] [accessorIndex];
+	const int componentType = accessor ["componentType"].GetInt ();
+	const std::size_t size = componentType == 5121 ? 1 :
+		(componentType == 5123 ? 2 : 4);
+
+	if (accessor ["type"].string != "SCALAR" || (size == 4 && componentType != 5125)) {
+		throw std::runtime_error ("Invalid glTF index accessor.");
+	}
+
+	const std::size_t count = accessor ["count"].GetInt ();
+	const auto& bufferView = document ["bufferViews"] [accessor ["bufferView"].GetInt ()];
+	const std::size_t viewOffset = bufferView.GetInt ("byteOffset", 0);
+	const std::size_t viewLength = bufferView ["byteLength"].GetInt ();
+	const std::size_t offset = accessor.GetInt ("byteOffset", 0);
+
+	if (bufferView.GetInt ("buffer", 0) != 0 || viewOffset + viewLength > bufferSize ||
+		offset + count * size > viewLength) {
+		throw std::runtime_error ("glTF accessor is out of bounds.");
+	}
+
+	const std::uint8_t* p = buffer + viewOffset + offset;
+	result.resize (count);
+	for (std::size_t i = 0; i < count; ++i, p += size) {
+		if (size == 1) {
+			result [i] = *p;
+		} else if (size == 2) {
+			result [i] = p [0] | (p [1] << 8);
+		} else {
+			result [i] = ReadUInt32 (p);
+		}
+	}
+}
+///////////////////////////////////////////////////////////////////////////////
+/**
+For every vertex, the first of all vertices whose leading keySize bytes
+are identical.
+*/
+std::vector<std::uint32_t> GroupVertices (const Mesh& mesh, const std::size_t keySize)
+{
+	const auto vertexCount = mesh.vertices.size ();
+	std::vector<std::uint32_t> order (vertexCount);
+	for (std::size_t i = 0; i < vertexCount; ++i) {
+		order [i] = static_cast<std::uint32_t> (i);
+	}
+
+	std::sort (order.begin (), order.end (), [&] (const std::uint32_t a, const std::uint32_t b) {
+		return std::memcmp (&mesh.vertices [a], &mesh.vertices [b], keySize) < 0;
+	});
+
+	std::vector<std::uint32_t> group (vertexCount);
+	for (std::size_t i = 0; i < vertexCount; ++i) {
+		const bool same = i > 0 && std::memcmp (&mesh.vertices [order [i]],
+			&mesh.vertices [order [i - 1]], keySize) == 0;
+		group [order [i]] = same ? group [order [i - 1]] : order [i];
+	}
+
+	return group;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Mesh LoadObj (const char* text, const std::size_t size)
+{
+	std::vector<float> positions, uvs, normals;
+	std::vector<ObjCorner> corners;
+	std::vector<ObjCorner> face;
+
+	const char* p = text;
+	const char* end = text + size;
+
+	while (p != end) {
+		SkipSpaces (p, end);
+		const char* lineStart = p;
+		while (p != end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+			++p;
+		}
+
+		const auto keywordLength = p - lineStart;
+
+		if (keywordLength == 1 && *lineStart == 'f') {
+			face.clear ();
+
+			for (;;) {
+				SkipSpaces (p, end);
+				ObjCorner corner = { -1, -1, -1 };
+
+				int index;
+				if (! ParseInt (p, end, &index)) {
+					break;
+				}
+
+				corner.position = ResolveObjIndex (index, positions.size () / 3);
+
+				if (p != end && *p == '/') {
+					++p;
+					if (ParseInt (p, end, &index)) {
+						corner.uv = ResolveObjIndex (index, uvs.size () / 2);
+						if (corner.uv < 0) {
+							throw std::runtime_error ("Invalid OBJ face index.");
+						}
+					}
+
+					if (p != end && *p == '/') {
+						++p;
+						if (! ParseInt (p, end, &index)) {
+							throw std::runtime_error ("Invalid OBJ face.");
+						}
+
+						corner.normal = ResolveObjIndex (index, normals.size () / 3);
+						if (corner.normal < 0) {
+							throw std::runtime_error ("Invalid OBJ face index.");
+						}
+					}
+				}
+
+				if (corner.position < 0) {
+					throw std::runtime_error ("Invalid OBJ face index.");
+				}
+
+				face.push_back (corner);
+			}
+
+			for (std::size_t i = 2; i < face.size (); ++i) {
+				corners.push_back (face [0]);
+				corners.push_back (face [i - 1]);
+				corners.push_back (face [i]);
+			}
+		} else if (keywordLength >= 1 && keywordLength <= 2 && *lineStart == 'v') {
+			const char type = keywordLength == 2 ? lineStart [1] : ' ';
+			std::vector<float>* target;
+			int componentCount;
+
+			switch (type) {
+			case ' ': target = &positions; componentCount = 3; break;
+			case 't': target = &uvs; componentCount = 2; break;
+			case 'n': target = &normals; componentCount = 3; break;
+			default: target = nullptr; componentCount = 0;
+			}
+
+			for (int i = 0; i < componentCount; ++i) {
+				SkipSpaces (p, end);
+				float value = 0;
+				// Texture coordinates may omit v
+				if (! ParseFloat (p, end, &value) && ! (type == 't' && i == 1)) {
+					throw std::runtime_error ("Invalid OBJ vertex.");
+				}
+
+				target->push_back (value);
+			}
+		}
+
+		// Skip the rest of the line, including anything we don't support
+		while (p != end && *p != '\n') {
+			++p;
+		}
+
+		if (p != end) {
+			++p;
+		}
+	}
+
+	if (corners.empty ()) {
+		throw std::runtime_error ("Mesh contains no triangles.");
+	}
+
+	Mesh mesh;
+	mesh.vertices.resize (corners.size ());
+	mesh.indices.resize (corners.size ());
+
+	bool hasNormals = false;
+	for (std::size_t i = 0; i < corners.size (); ++i) {
+		const auto& corner = corners [i];
+		auto& vertex = mesh.vertices [i];
+
+		if (static_cast<std::size_t> (corner.position) >= positions.size () / 3 ||
+			(corner.uv >= 0 && static_cast<std::size_t> (corner.uv) >= uvs.size () / 2) ||
+			(corner.normal >= 0 && static_cast<std::size_t> (corner.normal) >= normals.size () / 3)) {
+			throw std::runtime_error ("Invalid OBJ face index.");
+		}
+
+		std::memcpy (vertex.position, &positions [corner.position * 3], sizeof (vertex.position));
+
+		if (corner.uv >= 0) {
+			// OBJ has the origin in the lower left corner
+			vertex.uv [0] = uvs [corner.uv * 2];
+			vertex.uv [1] = 1 - uvs [corner.uv * 2 + 1];
+		} else {
+			vertex.uv [0] = vertex.uv [1] = 0;
+		}
+
+		if (corner.normal >= 0) {
+			std::memcpy (vertex.normal, &normals [corner.normal * 3], sizeof (vertex.normal));
+			hasNormals = true;
+		} else {
+			vertex.normal [0] = vertex.normal [1] = vertex.normal [2] = 0;
+		}
+
+		vertex.tangent [0] = vertex.tangent [1] = vertex.tangent [2] = vertex.tangent [3] = 0;
+
+		mesh.indices [i] = static_cast<std::uint32_t> (i);
+	}
+
+	if (! hasNormals) {
+		ComputeNormals (mesh);
+	}
+
+	ComputeTangents (mesh);
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Mesh LoadGlb (const void* data, const std::size_t size)
+{
+	const auto bytes = static_cast<const std::uint8_t*> (data);
+
+	// Header: magic, version, total length. Chunks follow, each with its
+	// length, type and data padded to 4 bytes
+	if (size < 20 || ReadUInt32 (bytes) != 0x46546C67 ||
+		ReadUInt32 (bytes + 4) != 2 || ReadUInt32 (bytes + 8) > size) {
+		throw std::runtime_error ("Invalid binary glTF file.");
+	}
+
+	const std::size_t fileSize = ReadUInt32 (bytes + 8);
+	const char* json = nullptr;
+	std::size_t jsonSize = 0;
+	const std::uint8_t* buffer = nullptr;
+	std::size_t bufferSize = 0;
+
+	for (std::size_t offset = 12; offset + 8 <= fileSize;) {
+		const std::size_t chunkSize = ReadUInt32 (bytes + offset);
+		const auto chunkType = ReadUInt32 (bytes + offset + 4);
+		if (chunkSize > fileSize - offset - 8) {
+			throw std::runtime_error ("Invalid binary glTF file.");
+		}
+
+		if (chunkType == 0x4E4F534A && ! json) {
+			json = reinterpret_cast<const char*> (bytes + offset + 8);
+			jsonSize = chunkSize;
+		} else if (chunkType == 0x004E4942 && ! buffer) {
+			buffer = bytes + offset + 8;
+			bufferSize = chunkSize;
+		}
+
+		offset += 8 + ((chunkSize + 3) & ~static_cast<std::size_t> (3));
+	}
+
+	if (! json) {
+		throw std::runtime_error ("Invalid binary glTF file.");
+	}
+
+	const auto document = JsonParser (json, jsonSize).Parse ();
+
+	Mesh mesh;
+	const auto meshes = document.Find ("meshes");
+	if (! meshes) {
+		throw std::runtime_error ("Mesh contains no triangles.");
+	}
+
+	std::vector<float> positions, normals, uvs, tangents;
+	std::vector<std::uint32_t> indices;
+	bool hasNormals = true;
+	bool hasTangents = true;
+
+	for (const auto& gltfMesh : meshes->elements) {
+		for (const auto& primitive : gltfMesh ["primitives"].elements) {
+			if (primitive.GetInt ("mode", 4) != 4) {
+				throw std::runtime_error ("Only glTF triangle lists are supported.");
+			}
+
+			const auto& attributes = primitive ["attributes"];
+			ReadAccessor (document, buffer, bufferSize,
+				attributes ["POSITION"].GetInt (), 3, positions);
+			const auto vertexCount = positions.size () / 3;
+
+			normals.clear ();
+			if (const auto normal = attributes.Find ("NORMAL")) {
+				ReadAccessor (document, buffer, bufferSize, normal->GetInt (), 3, normals);
+			} else {
+				hasNormals = false;
+			}
+
+			uvs.clear ();
+			if (const auto uv = attributes.Find ("TEXCOORD_0")) {
+				ReadAccessor (document, buffer, bufferSize, uv->GetInt (), 2, uvs);
+			}
+
+			tangents.clear ();
+			if (const auto tangent = attributes.Find ("TANGENT")) {
+				ReadAccessor (document, buffer, bufferSize, tangent->GetInt (), 4, tangents);
+			} else {
+				hasTangents = false;
+			}
+
+			if ((! normals.empty () && normals.size () != vertexCount * 3) ||
+				(! uvs.empty () && uvs.size () != vertexCount * 2) ||
+				(! tangents.empty () && tangents.size () != vertexCount * 4)) {
+				throw std::runtime_error ("glTF attributes differ in size.");
+			}
+
+			if (const auto indexAccessor = primitive.Find ("indices")) {
+				ReadIndices (document, buffer, bufferSize, indexAccessor->GetInt (), indices);
+			} else {
+				indices.resize (vertexCount);
+				for (std::size_t i = 0; i < vertexCount; ++i) {
+					indices [i] = static_cast<std::uint32_t> (i);
+				}
+			}
+
+			const auto baseVertex = static_cast<std::uint32_t> (mesh.vertices.size ());
+			for (std::size_t i = 0; i < vertexCount; ++i) {
+				MeshVertex vertex = {};
+				std::memcpy (vertex.position, &positions [i * 3], sizeof (vertex.position));
+
+				if (! normals.empty ()) {
+					std::memcpy (vertex.normal, &normals [i * 3], sizeof (vertex.normal));
+				}
+
+				if (! uvs.empty ()) {
+					std::memcpy (vertex.uv, &uvs [i * 2], sizeof (vertex.uv));
+				}
+
+				if (! tangents.empty ()) {
+					std::memcpy (vertex.tangent, &tangents [i * 4], sizeof (vertex.tangent));
+				}
+
+				mesh.vertices.push_back (vertex);
+			}
+
+			for (std::size_t i = 0; i + 2 < indices.size (); i += 3) {
+				for (int j = 0; j < 3; ++j) {
+					if (indices [i + j] >= vertexCount) {
+						throw std::runtime_error ("Invalid glTF index.");
+					}
+
+					mesh.indices.push_back (baseVertex + indices [i + j]);
+				}
+			}
+		}
+	}
+
+	if (mesh.indices.empty ()) {
+		throw std::runtime_error ("Mesh contains no triangles.");
+	}
+
+	if (! hasNormals) {
+		ComputeNormals (mesh);
+	}
+
+	if (! hasTangents) {
+		ComputeTangents (mesh);
+	}
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Mesh LoadMeshFromFile (const char* path)
+{
+	MappedFile file (path);
+	if (! file.IsOpen ()) {
+		throw std::runtime_error (std::string ("Could not read mesh '") + path + "'.");
+	}
+
+	const std::string name (path);
+	if (name.size () > 4 && (name.compare (name.size () - 4, 4, ".glb") == 0 ||
+		name.compare (name.size () - 4, 4, ".GLB") == 0)) {
+		return LoadGlb (file.GetData (), file.GetSize ());
+	} else {
+		return LoadObj (reinterpret_cast<const char*> (file.GetData ()), file.GetSize ());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ComputeNormals (Mesh& mesh)
+{
+	// Group the vertices by position, so faces which only share a position
+	// but not the other attributes are still smoothed
+	const auto vertexCount = mesh.vertices.size ();
+	const auto group = GroupVertices (mesh, sizeof (MeshVertex::position));
+
+	std::vector<float> normals (vertexCount * 3, 0.0f);
+	for (std::size_t i = 0; i + 2 < mesh.indices.size (); i += 3) {
+		const auto& a = mesh.vertices [mesh.indices [i]].position;
+		const auto& b = mesh.vertices [mesh.indices [i + 1]].position;
+		const auto& c = mesh.vertices [mesh.indices [i + 2]].position;
+
+		const float ab [3] = { b [0] - a [0], b [1] - a [1], b [2] - a [2] };
+		const float ac [3] = { c [0] - a [0], c [1] - a [1], c [2] - a [2] };
+
+		// The length of the cross product is twice the area
+		const float normal [3] = {
+			ab [1] * ac [2] - ab [2] * ac [1],
+			ab [2] * ac [0] - ab [0] * ac [2],
+			ab [0] * ac [1] - ab [1] * ac [0]
+		};
+
+		for (int j = 0; j < 3; ++j) {
+			const auto target = group [mesh.indices [i + j]];
+			for (int k = 0; k < 3; ++k) {
+				normals [target * 3 + k] += normal [k];
+			}
+		}
+	}
+
+	for (std::size_t i = 0; i < vertexCount; ++i) {
+		const float* normal = &normals [group [i] * 3];
+		const float length = std::sqrt (normal [0] * normal [0] +
+			normal [1] * normal [1] + normal [2] * normal [2]);
+		const float scale = length > 0 ? 1 / length : 0;
+
+		for (int k = 0; k < 3; ++k) {
+			mesh.vertices [i].normal [k] = normal [k] * scale;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ComputeTangents (Mesh& mesh)
+{
+	static_assert (offsetof (MeshVertex, position) == 0 &&
+		offsetof (MeshVertex, tangent) == 8 * sizeof (float),
+		"Position, normal and texture coordinates must come first");
+
+	// Vertices which differ only in the tangent get the same one
+	const auto vertexCount = mesh.vertices.size ();
+	const auto group = GroupVertices (mesh, offsetof (MeshVertex, tangent));
+
+	// Directions of increasing u and v, see Lengyel, "Computing Tangent
+	// Space Basis Vectors for an Arbitrary Mesh"
+	std::vector<float> uDirections (vertexCount * 3, 0.0f);
+	std::vector<float> vDirections (vertexCount * 3, 0.0f);
+
+	for (std::size_t i = 0; i + 2 < mesh.indices.size (); i += 3) {
+		const auto& v0 = mesh.vertices [mesh.indices [i]];
+		const auto& v1 = mesh.vertices [mesh.indices [i + 1]];
+		const auto& v2 = mesh.vertices [mesh.indices [i + 2]];
+
+		float e1 [3], e2 [3];
+		for (int k = 0; k < 3; ++k) {
+			e1 [k] = v1.position [k] - v0.position [k];
+			e2 [k] = v2.position [k] - v0.position [k];
+		}
+
+		const float du1 = v1.uv [0] - v0.uv [0], dv1 = v1.uv [1] - v0.uv [1];
+		const float du2 = v2.uv [0] - v0.uv [0], dv2 = v2.uv [1] - v0.uv [1];
+		const float determinant = du1 * dv2 - du2 * dv1;
+		if (determinant == 0) {
+			continue;
+		}
+
+		const float r = 1 / determinant;
+		for (int j = 0; j < 3; ++j) {
+			const auto target = group [mesh.indices [i + j]];
+			for (int k = 0; k < 3; ++k) {
+				uDirections [target * 3 + k] += (e1 [k] * dv2 - e2 [k] * dv1) * r;
+				vDirections [target * 3 + k] += (e2 [k] * du1 - e1 [k] * du2) * r;
+			}
+		}
+	}
+
+	for (std::size_t i = 0; i < vertexCount; ++i) {
+		auto& vertex = mesh.vertices [i];
+		const float* n = vertex.normal;
+		const float* u = &uDirections [group [i] * 3];
+		const float* v = &vDirections [group [i] * 3];
+
+		// Gram-Schmidt, fall back to any direction orthogonal to the
+		// normal if the texture coordinates are degenerate
+		const float nu = n [0] * u [0] + n [1] * u [1] + n [2] * u [2];
+		float t [3] = { u [0] - n [0] * nu, u [1] - n [1] * nu, u [2] - n [2] * nu };
+		float length = std::sqrt (t [0] * t [0] + t [1] * t [1] + t [2] * t [2]);
+
+		if (! (length > 1e-20f)) {
+			const float axis [3] = {
+				std::abs (n [0]) < 0.9f ? 1.0f : 0.0f,
+				std::abs (n [0]) < 0.9f ? 0.0f : 1.0f,
+				0
+			};
+			const float na = n [0] * axis [0] + n [1] * axis [1];
+			for (int k = 0; k < 3; ++k) {
+				t [k] = axis [k] - n [k] * na;
+			}
+
+			length = std::sqrt (t [0] * t [0] + t [1] * t [1] + t [2] * t [2]);
+		}
+
+		for (int k = 0; k < 3; ++k) {
+			vertex.tangent [k] = length > 0 ? t [k] / length : 0;
+		}
+
+		const float bitangent [3] = {
+			n [1] * t [2] - n [2] * t [1],
+			n [2] * t [0] - n [0] * t [2],
+			n [0] * t [1] - n [1] * t [0]
+		};
+
+		vertex.tangent [3] = bitangent [0] * v [0] + bitangent [1] * v [1] +
+			bitangent [2] * v [2] < 0 ? -1.0f : 1.0f;
+	}
+}
+}
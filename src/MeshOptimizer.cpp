@@ -0,0 +1,474 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace anteru {
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t HashVertex (const MeshVertex& vertex)
+{
+	static_assert (sizeof (MeshVertex) % 4 == 0, "Vertices are hashed in 32-bit words");
+
+	std::uint32_t words [sizeof (MeshVertex) / 4];
+	std::memcpy (words, &vertex, sizeof (vertex));
+
+	// MurmurHash2 mixing
+	std::uint32_t hash = 0;
+	for (const auto word : words) {
+		std::uint32_t k = word * 0x5BD1E995;
+		k ^= k >> 24;
+		k *= 0x5BD1E995;
+		hash = (hash * 0x5BD1E995) ^ k;
+	}
+
+	hash ^= hash >> 13;
+	hash *= 0x5BD1E995;
+	return hash ^ (hash >> 15);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Timestamp based FIFO cache: a vertex is in the cache if it was inserted
+less than cacheSize insertions ago. Hits don't change the order.
+*/
+class FifoCache
+{
+public:
+	FifoCache (const std::size_t vertexCount, const int cacheSize)
+		: insertionTimes_ (vertexCount, 0)
+		, time_ (cacheSize + 1)
+		, cacheSize_ (cacheSize)
+	{
+	}
+
+	/**
+	Returns true on a miss.
+	*/
+	bool Access (const std::uint32_t vertex)
+	{
+		if (time_ - insertionTimes_ [vertex] > static_cast<std::uint32_t> (cacheSize_)) {
+			insertionTimes_ [vertex] = time_++;
+			return true;
+		}
+
+		return false;
+	}
+
+	int AccessTriangle (const std::uint32_t* triangle)
+	{
+		return Access (triangle [0]) + Access (triangle [1]) + Access (triangle [2]);
+	}
+
+	void Flush ()
+	{
+		time_ += cacheSize_ + 1;
+	}
+
+private:
+	std::vector<std::uint32_t> insertionTimes_;
+	std::uint32_t time_;
+	int cacheSize_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+void Cross (const float* a, const float* b, const float* c, float* result)
+{
+	const float ab [3] = { b [0] - a [0], b [1] - a [1], b [2] - a [2] };
+	const float ac [3] = { c [0] - a [0], c [1] - a [1], c [2] - a [2] };
+
+	result [0] = ab [1] * ac [2] - ab [2] * ac [1];
+	result [1] = ab [2] * ac [0] - ab [0] * ac [2];
+	result [2] = ab [0] * ac [1] - ab [1] * ac [0];
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DeduplicateVertices (Mesh& mesh)
+{
+	const auto vertexCount = mesh.vertices.size ();
+
+	// Open addressing with linear probing, at most half full
+	std::size_t tableSize = 16;
+	while (tableSize < vertexCount * 2) {
+		tableSize *= 2;
+	}
+
+	const std::uint32_t EMPTY = 0xFFFFFFFF;
+	std::vector<std::uint32_t> table (tableSize, EMPTY);
+	std::vector<std::uint32_t> remap (vertexCount);
+	std::vector<MeshVertex> uniqueVertices;
+	uniqueVertices.reserve (vertexCount);
+
+	for (std::size_t i = 0; i < vertexCount; ++i) {
+		const auto& vertex = mesh.vertices [i];
+		auto slot = HashVertex (vertex) & (tableSize - 1);
+
+		for (;;) {
+			const auto entry = table [slot];
+			if (entry == EMPTY) {
+				table [slot] = static_cast<std::uint32_t> (uniqueVertices.size ());
+				remap [i] = table [slot];
+				uniqueVertices.push_back (vertex);
+				break;
+			}
+
+			if (std::memcmp (&uniqueVertices [entry], &vertex, sizeof (MeshVertex)) == 0) {
+				remap [i] = entry;
+				break;
+			}
+
+			slot = (slot + 1) & (tableSize - 1);
+		}
+	}
+
+	for (auto& index : mesh.indices) {
+		index = remap [index];
+	}
+
+	mesh.vertices.swap (uniqueVertices);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OptimizeVertexCache (std::vector<std::uint32_t>& indices,
+	const std::size_t vertexCount, const int cacheSize)
+{
+	const auto triangleCount = indices.size () / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// Triangles adjacent to each vertex, and how many of them have not been
+	// emitted yet
+	std::vector<std::uint32_t> liveTriangles (vertexCount, 0);
+	for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+		++liveTriangles [indices [i]];
+	}
+
+	std::vector<std::uint32_t> adjacencyOffsets (vertexCount + 1, 0);
+	for (std::size_t i = 0; i < vertexCount; ++i) {
+		adjacencyOffsets [i + 1] = adjacencyOffsets [i] + liveTriangles [i];
+	}
+
+	std::vector<std::uint32_t> adjacency (triangleCount * 3);
+	{
+		std::vector<std::uint32_t> fill (adjacencyOffsets.begin (), adjacencyOffsets.end () - 1);
+		for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+			adjacency [fill [indices [i]]++] = static_cast<std::uint32_t> (i / 3);
+		}
+	}
+
+	std::vector<std::uint32_t> cacheTimes (vertexCount, 0);
+	std::vector<std::uint8_t> emitted (triangleCount, 0);
+	std::vector<std::uint32_t> deadEnds;
+	std::vector<std::uint32_t> candidates;
+	std::vector<std::uint32_t> result;
+	result.reserve (triangleCount * 3);
+
+	std::uint32_t time = cacheSize + 1;
+	std::size_t cursor = 0;
+
+	// Once no candidate is left, continue with the most recently used
+	// vertex which still has triangles, or the next one in input order
+	const auto skipDeadEnd = [&] () -> std::int64_t {
+		while (! deadEnds.empty ()) {
+			const auto vertex = deadEnds.back ();
+			deadEnds.pop_back ();
+			if (liveTriangles [vertex] > 0) {
+				return vertex;
+			}
+		}
+
+		for (; cursor < vertexCount; ++cursor) {
+			if (liveTriangles [cursor] > 0) {
+				return static_cast<std::int64_t> (cursor);
+			}
+		}
+
+		return -1;
+	};
+
+	auto fanningVertex = skipDeadEnd ();
+	while (fanningVertex >= 0) {
+		candidates.clear ();
+
+		for (auto i = adjacencyOffsets [fanningVertex];
+			i < adjacencyOffsets [fanningVertex + 1]; ++i) {
+			const auto triangle = adjacency [i];
+			if (emitted [triangle]) {
+				continue;
+			}
+
+			for (int j = 0; j < 3; ++j) {
+				const auto vertex = indices [triangle * 3 + j];
+				result.push_back (vertex);
+				deadEnds.push_back (vertex);
+				candidates.push_back (vertex);
+				--liveTriangles [vertex];
+
+				if (time - cacheTimes [vertex] > static_cast<std::uint32_t> (cacheSize)) {
+					cacheTimes [vertex] = time++;
+				}
+			}
+
+			emitted [triangle] = 1;
+		}
+
+		// Prefer the candidate which entered the cache first, as long as
+		// fanning around it doesn't push it out of the cache
+		std::int64_t best = -1;
+		std::int64_t bestPriority = -1;
+		for (const auto vertex : candidates) {
+			if (liveTriangles [vertex] == 0) {
+				continue;
+			}
+
+			std::int64_t priority = 0;
+			const auto age = time - cacheTimes [vertex];
+			if (age + 2 * liveTriangles [vertex] <= static_cast<std::uint32_t> (cacheSize)) {
+				priority = age;
+			}
+
+			if (priority > bestPriority) {
+				best = vertex;
+				bestPriority = priority;
+			}
+		}
+
+		fanningVertex = best >= 0 ? best : skipDeadEnd ();
+	}
+
+	std::copy (result.begin (), result.end (), indices.begin ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OptimizeOverdraw (std::vector<std::uint32_t>& indices,
+	const std::vector<MeshVertex>& vertices, const int cacheSize,
+	const float threshold)
+{
+	const auto triangleCount = indices.size () / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// Hard boundaries, where the cache has to be refilled anyway
+	std::vector<std::uint32_t> hardClusters (1, 0);
+	{
+		FifoCache cache (vertices.size (), cacheSize);
+		cache.AccessTriangle (&indices [0]);
+		for (std::size_t i = 1; i < triangleCount; ++i) {
+			if (cache.AccessTriangle (&indices [i * 3]) == 3) {
+				hardClusters.push_back (static_cast<std::uint32_t> (i));
+			}
+		}
+	}
+
+	hardClusters.push_back (static_cast<std::uint32_t> (triangleCount));
+
+	// Soft boundaries, split the clusters as soon as the cache efficiency
+	// from the start of the cluster is close enough to the one of the whole
+	// cluster. This assumes the cache is flushed at every boundary
+	std::vector<std::uint32_t> clusters;
+	{
+		FifoCache cache (vertices.size (), cacheSize);
+		for (std::size_t c = 0; c + 1 < hardClusters.size (); ++c) {
+			const auto start = hardClusters [c];
+			const auto end = hardClusters [c + 1];
+
+			cache.Flush ();
+			int clusterMisses = 0;
+			for (auto i = start; i < end; ++i) {
+				clusterMisses += cache.AccessTriangle (&indices [i * 3]);
+			}
+
+			const float maxAcmr = threshold * clusterMisses / (end - start);
+
+			cache.Flush ();
+			clusters.push_back (start);
+			auto softStart = start;
+			int misses = 0;
+			for (auto i = start; i < end; ++i) {
+				misses += cache.AccessTriangle (&indices [i * 3]);
+
+				if (i + 1 < end && misses <= maxAcmr * (i + 1 - softStart)) {
+					clusters.push_back (i + 1);
+					softStart = i + 1;
+					misses = 0;
+					cache.Flush ();
+				}
+			}
+		}
+	}
+
+	clusters.push_back (static_cast<std::uint32_t> (triangleCount));
+	const auto clusterCount = clusters.size () - 1;
+
+	// Sort by how much the cluster faces away from the center of the mesh,
+	// using area-weighted centroids and normals
+	std::vector<float> clusterCentroids (clusterCount * 3, 0.0f);
+	std::vector<float> clusterNormals (clusterCount * 3, 0.0f);
+	float meshCentroid [3] = { 0, 0, 0 };
+	float meshArea = 0;
+
+	for (std::size_t c = 0; c < clusterCount; ++c) {
+		float* centroid = &clusterCentroids [c * 3];
+		float* normal = &clusterNormals [c * 3];
+		float area = 0;
+
+		for (auto i = clusters [c]; i < clusters [c + 1]; ++i) {
+			const auto& p0 = vertices [indices [i * 3]].position;
+			const auto& p1 = vertices [indices [i * 3 + 1]].position;
+			const auto& p2 = vertices [indices [i * 3 + 2]].position;
+
+			float triangleNormal [3];
+			Cross (p0, p1, p2, triangleNormal);
+			const float triangleArea = std::sqrt (
+				triangleNormal [0] * triangleNormal [0] +
+				triangleNormal [1] * triangleNormal [1] +
+				triangleNormal [2] * triangleNormal [2]);
+
+			for (int k = 0; k < 3; ++k) {
+				centroid [k] += (p0 [k] + p1 [k] + p2 [k]) * (triangleArea / 3);
+				normal [k] += triangleNormal [k];
+			}
+
+			area += triangleArea;
+		}
+
+		for (int k = 0; k < 3; ++k) {
+			meshCentroid [k] += centroid [k];
+			centroid [k] = area > 0 ? centroid [k] / area : 0;
+		}
+
+		meshArea += area;
+	}
+
+	for (int k = 0; k < 3; ++k) {
+		meshCentroid [k] = meshArea > 0 ? meshCentroid [k] / meshArea : 0;
+	}
+
+	std::vector<float> sortKeys (clusterCount);
+	for (std::size_t c = 0; c < clusterCount; ++c) {
+		const float* centroid = &clusterCentroids [c * 3];
+		const float* normal = &clusterNormals [c * 3];
+		const float length = std::sqrt (normal [0] * normal [0] +
+			normal [1] * normal [1] + normal [2] * normal [2]);
+
+		float dot = 0;
+		for (int k = 0; k < 3; ++k) {
+			dot += (centroid [k] - meshCentroid [k]) * normal [k];
+		}
+
+		sortKeys [c] = length > 0 ? dot / length : 0;
+	}
+
+	std::vector<std::uint32_t> order (clusterCount);
+	for (std::size_t c = 0; c < clusterCount; ++c) {
+		order [c] = static_cast<std::uint32_t> (c);
+	}
+
+	std::stable_sort (order.begin (), order.end (),
+		[&] (const std::uint32_t a, const std::uint32_t b) {
+		return sortKeys [a] > sortKeys [b];
+	});
+
+	std::vector<std::uint32_t> result;
+	result.reserve (triangleCount * 3);
+	for (const auto c : order) {
+		result.insert (result.end (), indices.begin () + clusters [c] * 3,
+			indices.begin () + clusters [c + 1] * 3);
+	}
+
+	std::copy (result.begin (), result.end (), indices.begin ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OptimizeVertexFetch (Mesh& mesh)
+{
+	const std::uint32_t UNUSED = 0xFFFFFFFF;
+	std::vector<std::uint32_t> remap (mesh.vertices.size (), UNUSED);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve (mesh.vertices.size ());
+
+	for (auto& index : mesh.indices) {
+		if (remap [index] == UNUSED) {
+			remap [index] = static_cast<std::uint32_t> (vertices.size ());
+			vertices.push_back (mesh.vertices [index]);
+		}
+
+		index = remap [index];
+	}
+
+	mesh.vertices.swap (vertices);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OptimizeMesh (Mesh& mesh)
+{
+	// Trailing indices which don't form a triangle are dropped
+	mesh.indices.resize (mesh.indices.size () / 3 * 3);
+
+	DeduplicateVertices (mesh);
+	OptimizeVertexCache (mesh.indices, mesh.vertices.size ());
+	OptimizeOverdraw (mesh.indices, mesh.vertices);
+	OptimizeVertexFetch (mesh);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+VertexCacheStatistics AnalyzeVertexCache (const std::vector<std::uint32_t>& indices,
+	const std::size_t vertexCount, const int cacheSize)
+{
+	const auto triangleCount = indices.size () / 3;
+
+	FifoCache cache (vertexCount, cacheSize);
+	std::vector<std::uint8_t> used (vertexCount, 0);
+	std::size_t misses = 0;
+	std::size_t usedVertices = 0;
+
+	for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+		misses += cache.Access (indices [i]);
+		if (! used [indices [i]]) {
+			used [indices [i]] = 1;
+			++usedVertices;
+		}
+	}
+
+	VertexCacheStatistics statistics;
+	statistics.acmr = triangleCount > 0 ?
+		static_cast<float> (misses) / triangleCount : 0;
+	statistics.atvr = usedVertices > 0 ?
+		static_cast<float> (misses) / usedVertices : 0;
+	return statistics;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IndexFormat SelectIndexFormat (const std::size_t vertexCount)
+{
+	return vertexCount <= 0xFFFF ? IndexFormat::UInt16 : IndexFormat::UInt32;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> PackIndices (const std::vector<std::uint32_t>& indices,
+	const IndexFormat format)
+{
+	std::vector<std::uint8_t> result;
+
+	if (format == IndexFormat::UInt16) {
+		result.resize (indices.size () * 2);
+		auto p = result.data ();
+		for (const auto index : indices) {
+			const auto shortIndex = static_cast<std::uint16_t> (index);
+			std::memcpy (p, &shortIndex, 2);
+			p += 2;
+		}
+	} else {
+		result.resize (indices.size () * 4);
+		if (! indices.empty ()) {
+			std::memcpy (result.data (), indices.data (), result.size ());
+		}
+	}
+
+	return result;
+}
+}
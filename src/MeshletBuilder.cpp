@@ -0,0 +1,661 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+
+namespace anteru {
+namespace {
+// How much a differently facing neighbor counts as farther away. Higher
+// values give narrower cones but less compact meshlets
+const float CONE_WEIGHT = 0.5f;
+
+const std::uint8_t NOT_IN_MESHLET = 0xFF;
+const int NO_CANDIDATE = 5;
+
+///////////////////////////////////////////////////////////////////////////////
+// Kept together, as the candidates are visited in random order
+struct TriangleData
+{
+	float centroid [3];
+	// Zero for degenerate triangles
+	float normal [3];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+float Dot (const float* a, const float* b)
+{
+	return a [0] * b [0] + a [1] * b [1] + a [2] * b [2];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+float Normalize (float* vector)
+{
+	const float length = std::sqrt (Dot (vector, vector));
+	if (length > 0) {
+		for (int i = 0; i < 3; ++i) {
+			vector [i] /= length;
+		}
+	}
+
+	return length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+float GetDistanceSquared (const float* a, const float* b)
+{
+	const float d [3] = { a [0] - b [0], a [1] - b [1], a [2] - b [2] };
+	return Dot (d, d);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Ritter's bounding sphere: start with the two farthest of the extreme
+points along the axes, and grow the sphere for every point outside.
+*/
+void ComputeBoundingSphere (const std::vector<MeshVertex>& vertices,
+	const std::uint32_t* indices, const std::size_t count, Meshlet& meshlet)
+{
+	std::uint32_t minimum [3], maximum [3];
+	for (int axis = 0; axis < 3; ++axis) {
+		minimum [axis] = maximum [axis] = indices [0];
+
+		for (std::size_t i = 1; i < count; ++i) {
+			const float value = vertices [indices [i]].position [axis];
+			if (value < vertices [minimum [axis]].position [axis]) {
+				minimum [axis] = indices [i];
+			}
+
+			if (value > vertices [maximum [axis]].position [axis]) {
+				maximum [axis] = indices [i];
+			}
+		}
+	}
+
+	int widest = 0;
+	float widestDistance = -1;
+	for (int axis = 0; axis < 3; ++axis) {
+		const float distance = GetDistanceSquared (vertices [minimum [axis]].position,
+			vertices [maximum [axis]].position);
+		if (distance > widestDistance) {
+			widest = axis;
+			widestDistance = distance;
+		}
+	}
+
+	const float* a = vertices [minimum [widest]].position;
+	const float* b = vertices [maximum [widest]].position;
+	for (int i = 0; i < 3; ++i) {
+		meshlet.center [i] = (a [i] + b [i]) / 2;
+	}
+
+	float radius = std::sqrt (widestDistance) / 2;
+	for (std::size_t i = 0; i < count; ++i) {
+		const float* p = vertices [indices [i]].position;
+		const float distance = std::sqrt (GetDistanceSquared (p, meshlet.center));
+
+		if (distance > radius) {
+			// Move the center towards p, so the old sphere and p are just
+			// inside
+			const float newRadius = (radius + distance) / 2;
+			const float shift = (newRadius - radius) / distance;
+			for (int j = 0; j < 3; ++j) {
+				meshlet.center [j] += (p [j] - meshlet.center [j]) * shift;
+			}
+
+			radius = newRadius;
+		}
+	}
+
+	// Make up for rounding in the updates
+	meshlet.radius = radius * (1 + 1e-6f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The cone axis is the average of the triangle normals, and the cutoff the
+sine of the largest angle between axis and a normal. The apex is moved
+back along the axis until it is behind all triangle planes, so the test
+is conservative for perspective views.
+*/
+void ComputeNormalCone (const std::vector<MeshVertex>& vertices,
+	const std::vector<std::uint32_t>& indices,
+	const std::vector<std::uint32_t>& triangles,
+	const std::vector<TriangleData>& triangleData, Meshlet& meshlet)
+{
+	float axis [3] = { 0, 0, 0 };
+	for (const auto triangle : triangles) {
+		for (int i = 0; i < 3; ++i) {
+			axis [i] += triangleData [triangle].normal [i];
+		}
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		meshlet.coneApex [i] = meshlet.center [i];
+		meshlet.coneAxis [i] = 0;
+	}
+	meshlet.coneCutoff = 1;
+
+	if (Normalize (axis) == 0) {
+		return;
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		meshlet.coneAxis [i] = axis [i];
+	}
+
+	float minimumDot = 1;
+	for (const auto triangle : triangles) {
+		const float* n = triangleData [triangle].normal;
+		// Degenerate triangles can't be seen
+		if (Dot (n, n) > 0) {
+			minimumDot = std::min (minimumDot, Dot (axis, n));
+		}
+	}
+
+	// Spans a hemisphere or more, some triangle is always visible
+	if (minimumDot <= 0) {
+		return;
+	}
+
+	float apexDistance = 0;
+	for (const auto triangle : triangles) {
+		const float* n = triangleData [triangle].normal;
+		const float* p = vertices [indices [triangle * 3]].position;
+		const float toCenter [3] = {
+			meshlet.center [0] - p [0],
+			meshlet.center [1] - p [1],
+			meshlet.center [2] - p [2]
+		};
+
+		const float alignment = Dot (axis, n);
+		if (alignment > 0) {
+			apexDistance = std::max (apexDistance, Dot (toCenter, n) / alignment);
+		}
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		meshlet.coneApex [i] = meshlet.center [i] - axis [i] * apexDistance;
+	}
+
+	meshlet.coneCutoff = std::sqrt (1 - minimumDot * minimumDot);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Greedy meshlet construction, see BuildMeshlets.
+*/
+class MeshletBuilder
+{
+public:
+	MeshletBuilder (const std::vector<std::uint32_t>& indices,
+		const std::vector<MeshVertex>& vertices, const int maxVertices,
+		const int maxTriangles)
+		: indices_ (indices)
+		, vertices_ (vertices)
+		, maxVertices_ (maxVertices)
+		, maxTriangles_ (maxTriangles)
+		, triangleCount_ (indices.size () / 3)
+		, localIndices_ (vertices.size (), NOT_IN_MESHLET)
+		, used_ (triangleCount_, 0)
+	{
+		BuildAdjacency ();
+		ComputeTriangleData ();
+	}
+
+	MeshletData Build ()
+	{
+		MeshletData result;
+		result.vertices.reserve (triangleCount_ + maxVertices_);
+		result.triangles.reserve (triangleCount_ * 3);
+
+		std::size_t remaining = triangleCount_;
+		std::uint32_t triangle = 0;
+		while (remaining > 0) {
+			if (! meshletVertices_.empty ()) {
+				triangle = FindNextTriangle ();
+			} else {
+				triangle = FindUnusedTriangle ();
+			}
+
+			if (! Fits (triangle)) {
+				Finish (result);
+			}
+
+			Add (triangle, result);
+			--remaining;
+		}
+
+		if (! meshletVertices_.empty ()) {
+			Finish (result);
+		}
+
+		return result;
+	}
+
+private:
+	void BuildAdjacency ()
+	{
+		const auto vertexCount = vertices_.size ();
+		adjacencyOffsets_.assign (vertexCount + 1, 0);
+
+		// Trailing indices which don't form a triangle are ignored
+		for (std::size_t i = 0; i < triangleCount_ * 3; ++i) {
+			if (indices_ [i] >= vertexCount) {
+				throw std::runtime_error ("Index out of range.");
+			}
+
+			++adjacencyOffsets_ [indices_ [i] + 1];
+		}
+
+		liveTriangles_.resize (vertexCount);
+		for (std::size_t i = 0; i < vertexCount; ++i) {
+			liveTriangles_ [i] = adjacencyOffsets_ [i + 1];
+			adjacencyOffsets_ [i + 1] += adjacencyOffsets_ [i];
+		}
+
+		// Triangles end up sorted by index in each list
+		adjacency_.resize (triangleCount_ * 3);
+		auto fill = adjacencyOffsets_;
+		for (std::size_t i = 0; i < triangleCount_ * 3; ++i) {
+			adjacency_ [fill [indices_ [i]]++] = static_cast<std::uint32_t> (i / 3);
+		}
+	}
+
+	void ComputeTriangleData ()
+	{
+		triangleData_.resize (triangleCount_);
+
+		for (std::size_t i = 0; i < triangleCount_; ++i) {
+			const float* a = vertices_ [indices_ [i * 3]].position;
+			const float* b = vertices_ [indices_ [i * 3 + 1]].position;
+			const float* c = vertices_ [indices_ [i * 3 + 2]].position;
+
+			const float ab [3] = { b [0] - a [0], b [1] - a [1], b [2] - a [2] };
+			const float ac [3] = { c [0] - a [0], c [1] - a [1], c [2] - a [2] };
+
+			float* normal = triangleData_ [i].normal;
+			normal [0] = ab [1] * ac [2] - ab [2] * ac [1];
+			normal [1] = ab [2] * ac [0] - ab [0] * ac [2];
+			normal [2] = ab [0] * ac [1] - ab [1] * ac [0];
+			Normalize (normal);
+
+			for (int j = 0; j < 3; ++j) {
+				triangleData_ [i].centroid [j] = (a [j] + b [j] + c [j]) / 3;
+			}
+		}
+	}
+
+	int CountNewVertices (const std::uint32_t triangle) const
+	{
+		const auto* t = &indices_ [triangle * 3];
+		int count = 0;
+
+		for (int i = 0; i < 3; ++i) {
+			// Each vertex only counts once in degenerate triangles
+			if (localIndices_ [t [i]] == NOT_IN_MESHLET &&
+				(i < 1 || t [i] != t [0]) && (i < 2 || t [i] != t [1])) {
+				++count;
+			}
+		}
+
+		return count;
+	}
+
+	/**
+	Lower is better. Triangles which add no vertices come first, then the
+	ones which are the last unused triangle of a vertex, as they would
+	end up in a meshlet of their own otherwise, then by the number of
+	new vertices.
+	*/
+	int GetPriority (const std::uint32_t triangle) const
+	{
+		const int newVertices = CountNewVertices (triangle);
+		if (newVertices == 0) {
+			return 0;
+		}
+
+		const auto* t = &indices_ [triangle * 3];
+		if (liveTriangles_ [t [0]] == 1 || liveTriangles_ [t [1]] == 1 ||
+			liveTriangles_ [t [2]] == 1) {
+			return 1;
+		}
+
+		return 1 + newVertices;
+	}
+
+	bool Fits (const std::uint32_t triangle) const
+	{
+		return static_cast<int> (meshletTriangles_.size ()) < maxTriangles_ &&
+			static_cast<int> (meshletVertices_.size ()) + CountNewVertices (triangle) <= maxVertices_;
+	}
+
+	/**
+	Pick the best unused neighbor of the vertices of the last triangle,
+	or of the whole meshlet if there is none.
+	*/
+	std::uint32_t FindNextTriangle ()
+	{
+		float averageNormal [3] = { normalSum_ [0], normalSum_ [1], normalSum_ [2] };
+		Normalize (averageNormal);
+
+		const float inverseCount = 1.0f / meshletTriangles_.size ();
+		const float center [3] = {
+			centroidSum_ [0] * inverseCount,
+			centroidSum_ [1] * inverseCount,
+			centroidSum_ [2] * inverseCount
+		};
+
+		std::uint32_t best = 0;
+		int bestPriority = NO_CANDIDATE;
+		float bestScore = 0;
+
+		auto consider = [&] (const std::uint32_t vertex) {
+			for (auto i = adjacencyOffsets_ [vertex]; i < adjacencyOffsets_ [vertex + 1]; ++i) {
+				const auto triangle = adjacency_ [i];
+				if (used_ [triangle]) {
+					continue;
+				}
+
+				const int priority = GetPriority (triangle);
+				if (priority > bestPriority) {
+					continue;
+				}
+
+				// Squared, which keeps the order
+				const auto& data = triangleData_ [triangle];
+				const float facing = 1 + CONE_WEIGHT * (1 - Dot (data.normal, averageNormal));
+				const float score = GetDistanceSquared (data.centroid, center) * facing * facing;
+
+				// Ties go to the lower index, so the order in which the
+				// candidates are visited doesn't matter
+				if (priority < bestPriority || score < bestScore ||
+					(score == bestScore && triangle < best)) {
+					best = triangle;
+					bestPriority = priority;
+					bestScore = score;
+				}
+			}
+		};
+
+		const auto* last = &indices_ [meshletTriangles_.back () * 3];
+		for (int i = 0; i < 3; ++i) {
+			consider (last [i]);
+		}
+
+		if (bestPriority == NO_CANDIDATE) {
+			for (const auto vertex : meshletVertices_) {
+				consider (vertex);
+			}
+		}
+
+		if (bestPriority == NO_CANDIDATE) {
+			return FindUnusedTriangle ();
+		}
+
+		return best;
+	}
+
+	std::uint32_t FindUnusedTriangle ()
+	{
+		while (used_ [nextUnused_]) {
+			++nextUnused_;
+		}
+
+		return static_cast<std::uint32_t> (nextUnused_);
+	}
+
+	void Add (const std::uint32_t triangle, MeshletData& result)
+	{
+		used_ [triangle] = 1;
+		meshletTriangles_.push_back (triangle);
+
+		for (int i = 0; i < 3; ++i) {
+			const auto vertex = indices_ [triangle * 3 + i];
+			--liveTriangles_ [vertex];
+			if (localIndices_ [vertex] == NOT_IN_MESHLET) {
+				localIndices_ [vertex] = static_cast<std::uint8_t> (meshletVertices_.size ());
+				meshletVertices_.push_back (vertex);
+			}
+
+			result.triangles.push_back (localIndices_ [vertex]);
+			centroidSum_ [i] += triangleData_ [triangle].centroid [i];
+			normalSum_ [i] += triangleData_ [triangle].normal [i];
+		}
+	}
+
+	void Finish (MeshletData& result)
+	{
+		Meshlet meshlet;
+		meshlet.vertexOffset = static_cast<std::uint32_t> (result.vertices.size ());
+		meshlet.vertexCount = static_cast<std::uint32_t> (meshletVertices_.size ());
+		meshlet.triangleOffset = result.meshlets.empty () ? 0 :
+			result.meshlets.back ().triangleOffset + result.meshlets.back ().triangleCount;
+		meshlet.triangleCount = static_cast<std::uint32_t> (meshletTriangles_.size ());
+
+		ComputeBoundingSphere (vertices_, meshletVertices_.data (),
+			meshletVertices_.size (), meshlet);
+
+		ComputeNormalCone (vertices_, indices_, meshletTriangles_,
+			triangleData_, meshlet);
+
+		for (const auto vertex : meshletVertices_) {
+			localIndices_ [vertex] = NOT_IN_MESHLET;
+			result.vertices.push_back (vertex);
+		}
+
+		result.meshlets.push_back (meshlet);
+
+		meshletVertices_.clear ();
+		meshletTriangles_.clear ();
+		for (int i = 0; i < 3; ++i) {
+			centroidSum_ [i] = 0;
+			normalSum_ [i] = 0;
+		}
+	}
+
+	const std::vector<std::uint32_t>& indices_;
+	const std::vector<MeshVertex>& vertices_;
+	const int maxVertices_;
+	const int maxTriangles_;
+	const std::size_t triangleCount_;
+
+	// Triangles using each vertex, the ones of vertex i start at
+	// adjacency_ [adjacencyOffsets_ [i]]
+	std::vector<std::uint32_t> adjacencyOffsets_;
+	std::vector<std::uint32_t> adjacency_;
+	// Unused triangles of each vertex
+	std::vector<std::uint32_t> liveTriangles_;
+	std::vector<TriangleData> triangleData_;
+
+	// Index in the current meshlet, for every vertex
+	std::vector<std::uint8_t> localIndices_;
+	std::vector<std::uint8_t> used_;
+	std::size_t nextUnused_ = 0;
+
+	std::vector<std::uint32_t> meshletVertices_;
+	std::vector<std::uint32_t> meshletTriangles_;
+	float centroidSum_ [3] = { 0, 0, 0 };
+	float normalSum_ [3] = { 0, 0, 0 };
+};
+
+///////////////////////////////////////////////////////////////////////////////
+std::int8_t QuantizeSNorm8 (const float value)
+{
+	return static_cast<std::int8_t> (std::lrint (
+		std::min (std::max (value, -1.0f), 1.0f) * 127));
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MeshletData BuildMeshlets (const std::vector<std::uint32_t>& indices,
+	const std::vector<MeshVertex>& vertices, const int maxVertices,
+	const int maxTriangles)
+{
+	if (maxVertices < 3 || maxVertices > MAX_MESHLET_VERTICES ||
+		maxTriangles < 1 || maxTriangles > MAX_MESHLET_TRIANGLES) {
+		throw std::runtime_error ("Invalid meshlet size.");
+	}
+
+	return MeshletBuilder (indices, vertices, maxVertices, maxTriangles).Build ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<MeshletData> BuildMeshlets (const std::vector<const Mesh*>& meshes,
+	ThreadPool* threadPool, const int maxVertices, const int maxTriangles)
+{
+	std::vector<MeshletData> result (meshes.size ());
+	std::vector<std::exception_ptr> errors (meshes.size ());
+
+	auto build = [&] (const int i) {
+		try {
+			result [i] = BuildMeshlets (meshes [i]->indices, meshes [i]->vertices,
+				maxVertices, maxTriangles);
+		} catch (...) {
+			errors [i] = std::current_exception ();
+		}
+	};
+
+	const int count = static_cast<int> (meshes.size ());
+	if (threadPool) {
+		threadPool->ParallelFor (count, build);
+	} else {
+		for (int i = 0; i < count; ++i) {
+			build (i);
+		}
+	}
+
+	// Report the same error no matter which thread ran into it first
+	for (const auto& error : errors) {
+		if (error) {
+			std::rethrow_exception (error);
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PackedMeshlets PackMeshlets (const MeshletData& meshlets, const std::size_t vertexCount)
+{
+	PackedMeshlets result;
+	result.meshlets.reserve (meshlets.meshlets.size ());
+	result.bounds.reserve (meshlets.meshlets.size ());
+
+	for (const auto& meshlet : meshlets.meshlets) {
+		result.meshlets.push_back ({ meshlet.vertexOffset, meshlet.vertexCount,
+			meshlet.triangleOffset, meshlet.triangleCount });
+
+		GpuMeshletBounds bounds;
+		for (int i = 0; i < 3; ++i) {
+			bounds.center [i] = meshlet.center [i];
+		}
+		bounds.radius = meshlet.radius;
+
+		std::int8_t axis [3];
+		float axisError = 0;
+		for (int i = 0; i < 3; ++i) {
+			axis [i] = QuantizeSNorm8 (meshlet.coneAxis [i]);
+			axisError += std::abs (axis [i] / 127.0f - meshlet.coneAxis [i]);
+		}
+
+		// Widen the cone by the worst case error of the rounded axis, and
+		// round the cutoff up
+		int cutoff = 255;
+		if (meshlet.coneCutoff < 1) {
+			cutoff = std::min (static_cast<int> (std::ceil (
+				(meshlet.coneCutoff + axisError) * 255)), 255);
+		}
+
+		bounds.cone = static_cast<std::uint8_t> (axis [0]) |
+			(static_cast<std::uint8_t> (axis [1]) << 8) |
+			(static_cast<std::uint8_t> (axis [2]) << 16) |
+			(static_cast<std::uint32_t> (cutoff) << 24);
+
+		const float apex [3] = {
+			meshlet.center [0] - meshlet.coneApex [0],
+			meshlet.center [1] - meshlet.coneApex [1],
+			meshlet.center [2] - meshlet.coneApex [2]
+		};
+		bounds.apexOffset = std::sqrt (Dot (apex, apex));
+
+		result.bounds.push_back (bounds);
+	}
+
+	result.vertexIndexFormat = SelectIndexFormat (vertexCount);
+	result.vertexIndices = PackIndices (meshlets.vertices, result.vertexIndexFormat);
+
+	result.triangles.resize (meshlets.triangles.size () / 3);
+	for (std::size_t i = 0; i < result.triangles.size (); ++i) {
+		result.triangles [i] = meshlets.triangles [i * 3] |
+			(meshlets.triangles [i * 3 + 1] << 8) |
+			(meshlets.triangles [i * 3 + 2] << 16);
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MeshletStatistics AnalyzeMeshlets (const MeshletData& meshlets)
+{
+	MeshletStatistics statistics = {};
+	statistics.meshletCount = static_cast<int> (meshlets.meshlets.size ());
+	if (meshlets.meshlets.empty ()) {
+		return statistics;
+	}
+
+	const float count = static_cast<float> (meshlets.meshlets.size ());
+
+	std::vector<std::uint32_t> referenced (meshlets.vertices);
+	std::sort (referenced.begin (), referenced.end ());
+	const auto uniqueVertices = std::unique (referenced.begin (), referenced.end ()) -
+		referenced.begin ();
+
+	statistics.averageVertices = meshlets.vertices.size () / count;
+	statistics.averageTriangles = meshlets.triangles.size () / 3 / count;
+	statistics.vertexDuplication = static_cast<float> (meshlets.vertices.size ()) /
+		uniqueVertices;
+
+	// Directions on a Fibonacci spiral
+	const int DIRECTION_COUNT = 64;
+	float directions [DIRECTION_COUNT][3];
+	for (int i = 0; i < DIRECTION_COUNT; ++i) {
+		const float z = 1 - (2 * i + 1) / static_cast<float> (DIRECTION_COUNT);
+		const float r = std::sqrt (1 - z * z);
+		const float phi = i * 2.39996323f;
+		directions [i][0] = r * std::cos (phi);
+		directions [i][1] = r * std::sin (phi);
+		directions [i][2] = z;
+	}
+
+	int cullable = 0;
+	double coneAngles = 0;
+	std::size_t culled = 0;
+	for (const auto& meshlet : meshlets.meshlets) {
+		if (meshlet.coneCutoff >= 1) {
+			continue;
+		}
+
+		++cullable;
+		coneAngles += std::asin (meshlet.coneCutoff) * 57.29577951;
+
+		for (const auto& direction : directions) {
+			if (Dot (direction, meshlet.coneAxis) >= meshlet.coneCutoff) {
+				++culled;
+			}
+		}
+	}
+
+	statistics.cullableShare = cullable / count;
+	statistics.averageConeAngle = cullable > 0 ?
+		static_cast<float> (coneAngles / cullable) : 0;
+	statistics.backfaceCulledShare = static_cast<float> (culled) /
+		(count * DIRECTION_COUNT);
+
+	return statistics;
+}
+}
@@ -0,0 +1,1380 @@
+#include "NullDevice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "GpuProfiler.h"
+#include "PixelConversion.h"
+#include "ShaderCompiler.h"
+#include "SoftwareRasterizer.h"
+#include "SoftwareShaders.h"
+#include "TexturePacking.h"
+#include "ThreadPool.h"
+
+namespace anteru {
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+const int MAX_ROOT_PARAMETERS = 16;
+
+///////////////////////////////////////////////////////////////////////////////
+class NullResource final : public IResource
+{
+public:
+	explicit NullResource (const std::size_t size)
+		// Allocate in 8-byte units, so the memory is aligned for any element
+		// type which can be stored in a buffer
+		: memory_ ((std::max<std::size_t> (size, 1) + 7) / 8)
+	{
+	}
+
+	NullResource (const int width, const int height, const PixelFormat format)
+		: NullResource (static_cast<std::size_t> (GetRowSize (format, width)) *
+			anteru::GetRowCount (format, height))
+	{
+		width_ = width;
+		height_ = height;
+		rowPitch_ = GetRowSize (format, width);
+		format_ = format;
+	}
+
+	void* Map () override
+	{
+		return memory_.data ();
+	}
+
+	void Unmap () override
+	{
+	}
+
+	std::uint64_t GetGpuAddress () const override
+	{
+		return reinterpret_cast<std::uintptr_t> (memory_.data ());
+	}
+
+	std::uint8_t* GetData ()
+	{
+		return reinterpret_cast<std::uint8_t*> (memory_.data ());
+	}
+
+	int GetWidth () const
+	{
+		return width_;
+	}
+
+	int GetHeight () const
+	{
+		return height_;
+	}
+
+	int GetRowPitch () const
+	{
+		return rowPitch_;
+	}
+
+	/**
+	Number of rows in memory, which are rows of blocks for block
+	compressed formats.
+	*/
+	int GetRowCount () const
+	{
+		return anteru::GetRowCount (format_, height_);
+	}
+
+	/**
+	View of the texture for the software rasterizer. Textures which are not
+	RGBA8 are expanded to RGBA8 on first use after they were written.
+	*/
+	RasterImage GetImage (const PixelFormat viewFormat,
+		const ComponentMapping& mapping = IDENTITY_COMPONENT_MAPPING)
+	{
+		RasterImage image;
+		image.width = width_;
+		image.height = height_;
+		image.srgb = viewFormat == PixelFormat::R8G8B8A8_UNorm_sRGB ||
+			viewFormat == PixelFormat::BC1_UNorm_sRGB ||
+			viewFormat == PixelFormat::BC3_UNorm_sRGB;
+		image.mapping = mapping;
+
+		if (format_ == PixelFormat::R8G8B8A8_UNorm ||
+			format_ == PixelFormat::R8G8B8A8_UNorm_sRGB) {
+			image.data = GetData ();
+			image.rowPitch = rowPitch_;
+			return image;
+		}
+
+		if (expandedStale_) {
+			std::vector<std::uint8_t> expanded (static_cast<std::size_t> (width_) * height_ * 4);
+			try {
+				UnpackTexture (GetData (), width_, height_, rowPitch_, format_,
+					expanded.data ());
+			} catch (const std::runtime_error&) {
+				throw std::runtime_error ("Unsupported format for software rendering.");
+			}
+
+			expanded_.swap (expanded);
+			expandedStale_ = false;
+		}
+
+		image.data = expanded_.data ();
+		image.rowPitch = width_ * 4;
+		return image;
+	}
+
+	/**
+	Called after the texture has been written by a copy.
+	*/
+	void Invalidate ()
+	{
+		expandedStale_ = true;
+	}
+
+	PixelFormat GetFormat () const
+	{
+		return format_;
+	}
+
+private:
+	std::vector<std::uint64_t> memory_;
+	int width_ = 0, height_ = 0, rowPitch_ = 0;
+	PixelFormat format_ = PixelFormat::Unknown;
+
+	std::vector<std::uint8_t> expanded_;
+	bool expandedStale_ = true;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class NullFence final : public IFence
+{
+public:
+	explicit NullFence (const std::uint64_t initialValue)
+		: timeline_ (initialValue)
+	{
+	}
+
+	std::uint64_t GetCompletedValue () const override
+	{
+		return timeline_.GetCompletedValue ();
+	}
+
+	void SetEventOnCompletion (const std::uint64_t value,
+		WaitableEvent& event) override
+	{
+		timeline_.SetEventOnCompletion (value, event);
+	}
+
+	void CancelEventOnCompletion (WaitableEvent& event) override
+	{
+		timeline_.CancelEventOnCompletion (event);
+	}
+
+	void Signal (const std::uint64_t value)
+	{
+		timeline_.Signal (value);
+	}
+
+private:
+	CpuTimeline timeline_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Descriptors point straight at the resource, the GPU handle is the address
+of the descriptor.
+*/
+struct NullDescriptor
+{
+	NullResource* resource;
+	PixelFormat format;
+	ComponentMapping mapping;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class NullDescriptorHeap final : public IDescriptorHeap
+{
+public:
+	explicit NullDescriptorHeap (const int descriptorCount)
+		: descriptors_ (descriptorCount)
+	{
+	}
+
+	void CreateShaderResourceView (const int index, IResource* texture,
+		const PixelFormat format, const ComponentMapping& mapping) override
+	{
+		descriptors_ [index].resource = static_cast<NullResource*> (texture);
+		descriptors_ [index].format = format;
+		descriptors_ [index].mapping = mapping;
+	}
+
+	GpuDescriptorHandle GetGpuHandle (const int index) const override
+	{
+		GpuDescriptorHandle result;
+		result.ptr = reinterpret_cast<std::uintptr_t> (descriptors_.data () + index);
+		return result;
+	}
+
+private:
+	std::vector<NullDescriptor> descriptors_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class NullRootSignature final : public IRootSignature
+{
+public:
+	explicit NullRootSignature (const RootSignatureDesc& desc)
+		: desc_ (desc)
+	{
+		if (desc.parameters.size () > MAX_ROOT_PARAMETERS) {
+			throw std::runtime_error ("Too many root parameters.");
+		}
+
+		if (GetRootSignatureSize (desc) > MAX_ROOT_SIGNATURE_SIZE) {
+			throw std::runtime_error ("Root signature is too large.");
+		}
+
+		// Root constants of all parameters are stored back to back
+		int constantCount = 0;
+		for (std::size_t i = 0; i < desc.parameters.size (); ++i) {
+			constantOffsets_ [i] = constantCount;
+			if (desc.parameters [i].type == RootParameterType::Constants) {
+				constantCount += desc.parameters [i].count;
+			}
+		}
+	}
+
+	const RootSignatureDesc& GetDesc () const override
+	{
+		return desc_;
+	}
+
+	/**
+	Index of the first value of a Constants parameter in the root
+	constants of a draw.
+	*/
+	int GetConstantOffset (const int parameter) const
+	{
+		return constantOffsets_ [parameter];
+	}
+
+private:
+	RootSignatureDesc desc_;
+	int constantOffsets_ [MAX_ROOT_PARAMETERS];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Besides the description, the pipeline state keeps the C++ versions of its
+shaders for the software device, if there are any.
+*/
+class NullPipelineState final : public IPipelineState
+{
+public:
+	explicit NullPipelineState (const PipelineStateDesc& desc)
+		: desc_ (desc)
+		, vertexShader_ (FindSoftwareShader (desc.vertexShader.entryPoint))
+		, pixelShader_ (FindSoftwareShader (desc.pixelShader.entryPoint))
+	{
+		if (! vertexShader_ || ! vertexShader_->vertexShader ||
+			! pixelShader_ || ! pixelShader_->pixelShader) {
+			vertexShader_ = pixelShader_ = nullptr;
+			return;
+		}
+
+		// Inputs are matched to the input layout by semantic, like the
+		// input assembler does
+		for (int i = 0; i < vertexShader_->inputCount; ++i) {
+			inputElements_ [i] = -1;
+			for (std::size_t j = 0; j < desc.inputLayout.size (); ++j) {
+				if (std::strcmp (desc.inputLayout [j].semanticName,
+					vertexShader_->inputSemantics [i]) == 0 &&
+					desc.inputLayout [j].semanticIndex == 0) {
+					inputElements_ [i] = static_cast<int> (j);
+				}
+			}
+
+			if (inputElements_ [i] == -1) {
+				throw std::runtime_error ("Input layout does not match the vertex shader.");
+			}
+		}
+	}
+
+	const PipelineStateDesc& GetDesc () const
+	{
+		return desc_;
+	}
+
+	/**
+	There is nothing to compile, the blob only names the shaders.
+	*/
+	std::vector<std::uint8_t> GetCachedBlob () const override
+	{
+		std::string blob = "NULL";
+		blob += desc_.vertexShader.entryPoint;
+		blob.push_back ('\0');
+		blob += desc_.pixelShader.entryPoint;
+
+		return std::vector<std::uint8_t> (blob.begin (), blob.end ());
+	}
+
+	bool IsSoftwareSupported () const
+	{
+		return vertexShader_ != nullptr;
+	}
+
+	const SoftwareShader* GetVertexShader () const
+	{
+		return vertexShader_;
+	}
+
+	const SoftwareShader* GetPixelShader () const
+	{
+		return pixelShader_;
+	}
+
+	/**
+	Input layout element for each vertex shader input.
+	*/
+	const int* GetInputElements () const
+	{
+		return inputElements_;
+	}
+
+private:
+	PipelineStateDesc desc_;
+	const SoftwareShader* vertexShader_;
+	const SoftwareShader* pixelShader_;
+	int inputElements_ [MAX_SOFTWARE_SHADER_INPUTS];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Read one input element into a four component register, filling in missing
+components with (0, 0, 0, 1).
+*/
+void FetchVertexInput (const std::uint8_t* data, const PixelFormat format,
+	float* value)
+{
+	value [0] = value [1] = value [2] = 0;
+	value [3] = 1;
+
+	switch (format) {
+	case PixelFormat::R32G32B32_Float:
+		std::memcpy (value, data, 3 * sizeof (float));
+		break;
+
+	case PixelFormat::R32G32_Float:
+		std::memcpy (value, data, 2 * sizeof (float));
+		break;
+
+	case PixelFormat::R32_UInt:
+		{
+			std::uint32_t i;
+			std::memcpy (&i, data, sizeof (i));
+			value [0] = static_cast<float> (i);
+		}
+		break;
+
+	case PixelFormat::R8G8B8A8_UNorm:
+	case PixelFormat::R8G8B8A8_UNorm_sRGB:
+		for (int i = 0; i < 4; ++i) {
+			value [i] = data [i] / 255.0f;
+		}
+		break;
+
+	case PixelFormat::R16G16B16A16_Float:
+		{
+			std::uint16_t h [4];
+			std::memcpy (h, data, sizeof (h));
+			ConvertHalfToFloat (h, value, 4);
+		}
+		break;
+
+	case PixelFormat::R16G16_Float:
+		{
+			std::uint16_t h [2];
+			std::memcpy (h, data, sizeof (h));
+			ConvertHalfToFloat (h, value, 2);
+		}
+		break;
+
+	case PixelFormat::R16G16B16A16_UNorm:
+	case PixelFormat::R16G16_UNorm:
+		{
+			const int count = format == PixelFormat::R16G16_UNorm ? 2 : 4;
+			std::uint16_t u [4];
+			std::memcpy (u, data, count * sizeof (std::uint16_t));
+			for (int i = 0; i < count; ++i) {
+				value [i] = u [i] / 65535.0f;
+			}
+		}
+		break;
+
+	case PixelFormat::R16G16_SNorm:
+		{
+			// -32768 and -32767 both map to -1
+			std::int16_t s [2];
+			std::memcpy (s, data, sizeof (s));
+			for (int i = 0; i < 2; ++i) {
+				value [i] = std::max (s [i] / 32767.0f, -1.0f);
+			}
+		}
+		break;
+
+	default:
+		throw std::runtime_error ("Unsupported vertex format.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Commands are recorded together with the state they need. The null device
+only executes copies, which are needed to get data into and out of
+resources, while the software device executes everything.
+*/
+class NullCommandList final : public ICommandList
+{
+public:
+	explicit NullCommandList (const CommandListType type)
+		: type_ (type)
+	{
+	}
+
+	void Reset () override
+	{
+		commands_.clear ();
+		copies_.clear ();
+		clears_.clear ();
+		draws_.clear ();
+		timestamps_.clear ();
+		bundles_.clear ();
+		drawCount_ = 0;
+
+		current_ = DrawCall ();
+	}
+
+	void Close () override
+	{
+	}
+
+	void ResourceBarrier (const ResourceTransition*, const int) override
+	{
+		RequireDirect ();
+	}
+
+	void CopyBufferRegion (IResource* destination,
+		const std::uint64_t destinationOffset,
+		IResource* source, const std::uint64_t sourceOffset,
+		const std::uint64_t size) override
+	{
+		RequireDirect ();
+
+		Copy copy;
+		copy.type = CopyType::Buffer;
+		copy.destination = static_cast<NullResource*> (destination);
+		copy.destinationOffset = destinationOffset;
+		copy.source = static_cast<NullResource*> (source);
+		copy.sourceOffset = sourceOffset;
+		copy.size = size;
+		copy.rowPitch = 0;
+		AddCommand (CommandType::Copy, copies_, copy);
+	}
+
+	void CopyBufferToTexture (IResource* destination,
+		IResource* source, const std::uint64_t sourceOffset,
+		const int rowPitch) override
+	{
+		RequireDirect ();
+
+		Copy copy;
+		copy.type = CopyType::BufferToTexture;
+		copy.destination = static_cast<NullResource*> (destination);
+		copy.destinationOffset = 0;
+		copy.source = static_cast<NullResource*> (source);
+		copy.sourceOffset = sourceOffset;
+		copy.size = 0;
+		copy.rowPitch = rowPitch;
+		AddCommand (CommandType::Copy, copies_, copy);
+	}
+
+	void CopyTextureToBuffer (IResource* destination,
+		const std::uint64_t destinationOffset, IResource* source,
+		const int rowPitch) override
+	{
+		RequireDirect ();
+
+		Copy copy;
+		copy.type = CopyType::TextureToBuffer;
+		copy.destination = static_cast<NullResource*> (destination);
+		copy.destinationOffset = destinationOffset;
+		copy.source = static_cast<NullResource*> (source);
+		copy.sourceOffset = 0;
+		copy.size = 0;
+		copy.rowPitch = rowPitch;
+		AddCommand (CommandType::Copy, copies_, copy);
+	}
+
+	void SetRenderTarget (IResource* renderTarget) override
+	{
+		RequireDirect ();
+		current_.renderTarget = static_cast<NullResource*> (renderTarget);
+	}
+
+	void ClearRenderTarget (IResource* renderTarget, const float* color) override
+	{
+		RequireDirect ();
+
+		Clear clear;
+		clear.renderTarget = static_cast<NullResource*> (renderTarget);
+		std::copy (color, color + 4, clear.color);
+		AddCommand (CommandType::Clear, clears_, clear);
+	}
+
+	void SetViewport (const Viewport& viewport) override
+	{
+		RequireDirect ();
+		current_.viewport = viewport;
+	}
+
+	void SetScissorRect (const ScissorRect& rect) override
+	{
+		RequireDirect ();
+		current_.scissor = rect;
+	}
+
+	void SetDescriptorHeap (IDescriptorHeap*) override
+	{
+	}
+
+	void SetGraphicsRootSignature (IRootSignature* rootSignature) override
+	{
+		current_.rootSignature = static_cast<NullRootSignature*> (rootSignature);
+	}
+
+	void SetPipelineState (IPipelineState* pipelineState) override
+	{
+		current_.pipelineState = static_cast<NullPipelineState*> (pipelineState);
+	}
+
+	void SetGraphicsRootConstantBufferView (const int parameter,
+		const std::uint64_t gpuAddress) override
+	{
+		current_.rootArguments [parameter] = gpuAddress;
+		current_.rootArgumentMask |= 1u << parameter;
+	}
+
+	void SetGraphicsRootDescriptorTable (const int parameter,
+		const GpuDescriptorHandle handle) override
+	{
+		current_.rootArguments [parameter] = handle.ptr;
+		current_.rootArgumentMask |= 1u << parameter;
+	}
+
+	void SetGraphicsRoot32BitConstants (const int parameter, const int count,
+		const void* data, const int offset) override
+	{
+		if (! current_.rootSignature) {
+			throw std::runtime_error ("Root constants set without a root signature.");
+		}
+
+		std::memcpy (current_.rootConstants +
+			current_.rootSignature->GetConstantOffset (parameter) + offset,
+			data, count * sizeof (float));
+		current_.rootArgumentMask |= 1u << parameter;
+	}
+
+	void SetVertexBuffer (const VertexBufferView& view) override
+	{
+		current_.vertexBuffer = view;
+	}
+
+	void SetIndexBuffer (const IndexBufferView& view) override
+	{
+		current_.indexBuffer = view;
+	}
+
+	void DrawIndexedInstanced (const int indexCount, const int instanceCount,
+		const int startIndex, const int baseVertex, const int) override
+	{
+		current_.indexCount = indexCount;
+		current_.instanceCount = instanceCount;
+		current_.startIndex = startIndex;
+		current_.baseVertex = baseVertex;
+		AddCommand (CommandType::Draw, draws_, current_);
+
+		++drawCount_;
+	}
+
+	void ExecuteBundle (ICommandList* bundle) override
+	{
+		RequireDirect ();
+
+		const auto nullBundle = static_cast<NullCommandList*> (bundle);
+		if (nullBundle->type_ != CommandListType::Bundle) {
+			throw std::runtime_error ("Only bundles can be executed from a command list.");
+		}
+
+		// The draws are resolved at execution, with the state at this point
+		ExecutedBundle executed;
+		executed.bundle = nullBundle;
+		executed.state = current_;
+		AddCommand (CommandType::Bundle, bundles_, executed);
+
+		drawCount_ += nullBundle->drawCount_;
+
+		if (nullBundle->current_.pipelineState) {
+			current_.pipelineState = nullBundle->current_.pipelineState;
+		}
+	}
+
+	/**
+	Store the time at which the command list execution reaches this point,
+	used for timestamp queries on the software device.
+	*/
+	void WriteTimestamp (std::uint64_t* target)
+	{
+		AddCommand (CommandType::Timestamp, timestamps_, target);
+	}
+
+	/**
+	Execute the recorded commands, returns the number of draws. Clears,
+	draws and timestamps are skipped without a rasterizer.
+	*/
+	int Execute (SoftwareRasterizer* rasterizer) const
+	{
+		for (const auto& command : commands_) {
+			switch (command.type) {
+			case CommandType::Copy:
+				// Copies may read a render target
+				if (rasterizer) {
+					rasterizer->Flush ();
+				}
+
+				ExecuteCopy (copies_ [command.index]);
+				break;
+
+			case CommandType::Clear:
+				if (rasterizer) {
+					const auto& clear = clears_ [command.index];
+					rasterizer->SetRenderTarget (clear.renderTarget->GetImage (
+						clear.renderTarget->GetFormat ()));
+					rasterizer->Clear (clear.color);
+				}
+				break;
+
+			case CommandType::Draw:
+				if (rasterizer) {
+					ExecuteDraw (*rasterizer, draws_ [command.index]);
+				}
+				break;
+
+			case CommandType::Bundle:
+				if (rasterizer) {
+					const auto& executed = bundles_ [command.index];
+					for (const auto& draw : executed.bundle->draws_) {
+						ExecuteDraw (*rasterizer, Inherit (executed.state, draw));
+					}
+				}
+				break;
+
+			case CommandType::Timestamp:
+				if (rasterizer) {
+					rasterizer->Flush ();
+					*timestamps_ [command.index] = static_cast<std::uint64_t> (
+						std::chrono::duration_cast<std::chrono::nanoseconds> (
+						Clock::now ().time_since_epoch ()).count ());
+				}
+				break;
+			}
+		}
+
+		if (rasterizer) {
+			rasterizer->Flush ();
+		}
+
+		return drawCount_;
+	}
+
+private:
+	enum class CommandType
+	{
+		Copy,
+		Clear,
+		Draw,
+		Timestamp,
+		Bundle
+	};
+
+	struct Command
+	{
+		CommandType type;
+		// Index into the array for the command type
+		int index;
+	};
+
+	enum class CopyType
+	{
+		Buffer,
+		BufferToTexture,
+		TextureToBuffer
+	};
+
+	struct Copy
+	{
+		CopyType type;
+		NullResource* destination;
+		std::uint64_t destinationOffset;
+		NullResource* source;
+		std::uint64_t sourceOffset;
+		std::uint64_t size;
+		// Row pitch of the buffer for texture copies
+		int rowPitch;
+	};
+
+	struct Clear
+	{
+		NullResource* renderTarget;
+		float color [4];
+	};
+
+	/**
+	A draw with all state set at the time it was recorded.
+	*/
+	struct DrawCall
+	{
+		DrawCall ()
+		{
+			std::memset (this, 0, sizeof (*this));
+		}
+
+		NullResource* renderTarget;
+		NullRootSignature* rootSignature;
+		NullPipelineState* pipelineState;
+		Viewport viewport;
+		ScissorRect scissor;
+		VertexBufferView vertexBuffer;
+		IndexBufferView indexBuffer;
+		std::uint64_t rootArguments [MAX_ROOT_PARAMETERS];
+		// Raw 32-bit values, stored as float as that's how shaders read them
+		float rootConstants [MAX_ROOT_SIGNATURE_SIZE];
+		// Root parameters set on this list, the others are inherited when
+		// the list is executed as a bundle
+		std::uint32_t rootArgumentMask;
+
+		int indexCount;
+		int instanceCount;
+		int startIndex;
+		int baseVertex;
+	};
+
+	struct ExecutedBundle
+	{
+		const NullCommandList* bundle;
+		DrawCall state;
+	};
+
+	void RequireDirect () const
+	{
+		if (type_ == CommandListType::Bundle) {
+			throw std::runtime_error ("Command is not allowed in a bundle.");
+		}
+	}
+
+	/**
+	A draw from a bundle with the state of the command list which executes
+	the bundle filled in.
+	*/
+	static DrawCall Inherit (const DrawCall& caller, const DrawCall& draw)
+	{
+		DrawCall result = draw;
+		result.renderTarget = caller.renderTarget;
+		result.viewport = caller.viewport;
+		result.scissor = caller.scissor;
+
+		if (! result.rootSignature) {
+			result.rootSignature = caller.rootSignature;
+		}
+
+		if (! result.vertexBuffer.gpuAddress) {
+			result.vertexBuffer = caller.vertexBuffer;
+		}
+
+		if (! result.indexBuffer.gpuAddress) {
+			result.indexBuffer = caller.indexBuffer;
+		}
+
+		if (! result.rootSignature) {
+			return result;
+		}
+
+		const auto& parameters = result.rootSignature->GetDesc ().parameters;
+		for (std::size_t i = 0; i < parameters.size (); ++i) {
+			if (draw.rootArgumentMask & (1u << i)) {
+				continue;
+			}
+
+			result.rootArguments [i] = caller.rootArguments [i];
+
+			if (parameters [i].type == RootParameterType::Constants) {
+				const auto offset = result.rootSignature->GetConstantOffset (
+					static_cast<int> (i));
+				std::copy (caller.rootConstants + offset,
+					caller.rootConstants + offset + parameters [i].count,
+					result.rootConstants + offset);
+			}
+		}
+
+		return result;
+	}
+
+	template <typename T>
+	void AddCommand (const CommandType type, std::vector<T>& commands, const T& command)
+	{
+		Command entry;
+		entry.type = type;
+		entry.index = static_cast<int> (commands.size ());
+		commands_.push_back (entry);
+		commands.push_back (command);
+	}
+
+	static void ExecuteCopy (const Copy& copy)
+	{
+		switch (copy.type) {
+		case CopyType::Buffer:
+			std::memcpy (copy.destination->GetData () + copy.destinationOffset,
+				copy.source->GetData () + copy.sourceOffset, copy.size);
+			break;
+
+		// Textures themselves are stored tightly packed
+		case CopyType::BufferToTexture:
+			{
+				const auto destination = copy.destination;
+				for (int y = 0; y < destination->GetRowCount (); ++y) {
+					std::memcpy (destination->GetData () + y * destination->GetRowPitch (),
+						copy.source->GetData () + copy.sourceOffset + y * copy.rowPitch,
+						destination->GetRowPitch ());
+				}
+
+				destination->Invalidate ();
+			}
+			break;
+
+		case CopyType::TextureToBuffer:
+			{
+				const auto source = copy.source;
+				for (int y = 0; y < source->GetRowCount (); ++y) {
+					std::memcpy (copy.destination->GetData () + copy.destinationOffset + y * copy.rowPitch,
+						source->GetData () + y * source->GetRowPitch (),
+						source->GetRowPitch ());
+				}
+			}
+			break;
+		}
+	}
+
+	static void ExecuteDraw (SoftwareRasterizer& rasterizer, const DrawCall& draw);
+
+	std::vector<Command> commands_;
+	std::vector<Copy> copies_;
+	std::vector<Clear> clears_;
+	std::vector<DrawCall> draws_;
+	std::vector<std::uint64_t*> timestamps_;
+	std::vector<ExecutedBundle> bundles_;
+	int drawCount_ = 0;
+
+	CommandListType type_;
+
+	DrawCall current_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Bind the resources from the root arguments, run the vertex shader for all
+vertices referenced by the draw and hand the triangles to the rasterizer.
+*/
+void NullCommandList::ExecuteDraw (SoftwareRasterizer& rasterizer,
+	const DrawCall& draw)
+{
+	const auto pipelineState = draw.pipelineState;
+	if (! pipelineState || ! pipelineState->IsSoftwareSupported ()) {
+		throw std::runtime_error ("Pipeline state is not supported by the software device.");
+	}
+
+	RasterState state;
+	std::memset (&state.bindings, 0, sizeof (state.bindings));
+
+	const auto& rootSignature = draw.rootSignature->GetDesc ();
+	for (std::size_t i = 0; i < rootSignature.parameters.size (); ++i) {
+		const auto& parameter = rootSignature.parameters [i];
+		const auto argument = draw.rootArguments [i];
+
+		if (parameter.type == RootParameterType::ConstantBufferView) {
+			state.bindings.constantBuffers [parameter.shaderRegister] =
+				reinterpret_cast<const float*> (static_cast<std::uintptr_t> (argument));
+		} else if (parameter.type == RootParameterType::Constants) {
+			state.bindings.constantBuffers [parameter.shaderRegister] =
+				draw.rootConstants +
+					draw.rootSignature->GetConstantOffset (static_cast<int> (i));
+		} else {
+			const auto descriptors = reinterpret_cast<const NullDescriptor*> (
+				static_cast<std::uintptr_t> (argument));
+			for (int j = 0; j < parameter.count; ++j) {
+				state.bindings.textures [parameter.shaderRegister + j] =
+					descriptors [j].resource->GetImage (descriptors [j].format,
+						descriptors [j].mapping);
+			}
+		}
+	}
+
+	for (const auto& sampler : rootSignature.staticSamplers) {
+		state.bindings.samplers [sampler.shaderRegister] = sampler.filter;
+	}
+
+	const auto vertexShader = pipelineState->GetVertexShader ();
+	state.pixelShader = pipelineState->GetPixelShader ()->pixelShader;
+	state.varyingCount = vertexShader->varyingCount;
+	state.blendMode = pipelineState->GetDesc ().blendMode;
+	state.viewport = draw.viewport;
+	state.scissor = draw.scissor;
+
+	// Indices relative to the first vertex used by the draw, so only those
+	// vertices have to be transformed
+	const auto indexData = reinterpret_cast<const std::uint8_t*> (
+		static_cast<std::uintptr_t> (draw.indexBuffer.gpuAddress));
+	const bool shortIndices = draw.indexBuffer.format == IndexFormat::UInt16;
+
+	std::vector<std::uint32_t> indices (draw.indexCount);
+	for (int i = 0; i < draw.indexCount; ++i) {
+		const int index = draw.startIndex + i;
+		if (shortIndices) {
+			indices [i] = reinterpret_cast<const std::uint16_t*> (indexData) [index];
+		} else {
+			indices [i] = reinterpret_cast<const std::uint32_t*> (indexData) [index];
+		}
+	}
+
+	if (indices.empty ()) {
+		return;
+	}
+
+	const auto minIndex = *std::min_element (indices.begin (), indices.end ());
+	const auto maxIndex = *std::max_element (indices.begin (), indices.end ());
+	for (auto& index : indices) {
+		index -= minIndex;
+	}
+
+	const auto vertexData = reinterpret_cast<const std::uint8_t*> (
+		static_cast<std::uintptr_t> (draw.vertexBuffer.gpuAddress));
+	const auto& inputLayout = pipelineState->GetDesc ().inputLayout;
+	const auto inputElements = pipelineState->GetInputElements ();
+
+	std::vector<RasterVertex> vertices (maxIndex - minIndex + 1);
+	for (std::size_t i = 0; i < vertices.size (); ++i) {
+		const auto vertex = vertexData + (static_cast<std::int64_t> (minIndex + i) +
+			draw.baseVertex) * draw.vertexBuffer.stride;
+
+		float inputs [MAX_SOFTWARE_SHADER_INPUTS][4];
+		for (int j = 0; j < vertexShader->inputCount; ++j) {
+			const auto& element = inputLayout [inputElements [j]];
+			FetchVertexInput (vertex + element.offset, element.format, inputs [j]);
+		}
+
+		vertexShader->vertexShader (state.bindings, inputs, vertices [i]);
+	}
+
+	rasterizer.SetRenderTarget (draw.renderTarget->GetImage (
+		pipelineState->GetDesc ().renderTargetFormat));
+
+	// Shaders don't see the instance, so all instances are identical
+	for (int instance = 0; instance < draw.instanceCount; ++instance) {
+		rasterizer.DrawTriangles (state, vertices.data (), indices.data (),
+			static_cast<int> (indices.size ()));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Without a rasterizer, work is executed on the CPU right away, but the queue
+keeps track of when a GPU would have finished it. A thread signals fences
+once that point in time is reached.
+
+With a rasterizer, the thread executes the command lists instead, so the
+application can record the next frame while the current one is rendered,
+and fences are signaled once the preceding command lists are done.
+*/
+class NullCommandQueue final : public ICommandQueue
+{
+public:
+	NullCommandQueue (const double commandListTime, const double drawTime,
+		SoftwareRasterizer* rasterizer)
+		: commandListTime_ (ToDuration (commandListTime))
+		, drawTime_ (ToDuration (drawTime))
+		, rasterizer_ (rasterizer)
+		, busyUntil_ (Clock::now ())
+	{
+		thread_ = std::thread ([this] () { ThreadMain (); });
+	}
+
+	~NullCommandQueue ()
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			shutdown_ = true;
+		}
+
+		wake_.notify_all ();
+		thread_.join ();
+	}
+
+	void ExecuteCommandLists (ICommandList* const* commandLists,
+		const int count) override
+	{
+		if (rasterizer_) {
+			{
+				std::lock_guard<std::mutex> lock (mutex_);
+				for (int i = 0; i < count; ++i) {
+					PendingWork work = {};
+					work.commandList = static_cast<NullCommandList*> (commandLists [i]);
+					pending_.push_back (work);
+				}
+			}
+
+			wake_.notify_one ();
+			return;
+		}
+
+		Clock::duration duration (0);
+
+		for (int i = 0; i < count; ++i) {
+			const auto drawCount = static_cast<NullCommandList*> (commandLists [i])->Execute (nullptr);
+			duration += commandListTime_ + drawTime_ * drawCount;
+		}
+
+		std::lock_guard<std::mutex> lock (mutex_);
+		busyUntil_ = std::max (busyUntil_, Clock::now ()) + duration;
+	}
+
+	void Signal (IFence* fence, const std::uint64_t value) override
+	{
+		auto nullFence = static_cast<NullFence*> (fence);
+
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+
+			// Fast path if the simulated GPU is idle, so a queue without GPU
+			// time never has to wake up the thread
+			if (pending_.empty () && busyUntil_ <= Clock::now ()) {
+				nullFence->Signal (value);
+				return;
+			}
+
+			PendingWork work = {};
+			work.time = busyUntil_;
+			work.fence = nullFence;
+			work.value = value;
+			pending_.push_back (work);
+		}
+
+		wake_.notify_one ();
+	}
+
+private:
+	/**
+	Either a command list to execute or a fence to signal.
+	*/
+	struct PendingWork
+	{
+		NullCommandList* commandList;
+		Clock::time_point time;
+		NullFence* fence;
+		std::uint64_t value;
+	};
+
+	static Clock::duration ToDuration (const double microseconds)
+	{
+		return std::chrono::duration_cast<Clock::duration> (
+			std::chrono::duration<double, std::micro> (microseconds));
+	}
+
+	void ThreadMain ()
+	{
+		std::unique_lock<std::mutex> lock (mutex_);
+
+		for (;;) {
+			wake_.wait (lock, [this] () {
+				return shutdown_ || ! pending_.empty ();
+			});
+
+			if (shutdown_) {
+				return;
+			}
+
+			const auto work = pending_.front ();
+
+			// The command list stays queued until it is done, so fences
+			// signaled meanwhile can't take the fast path
+			if (work.commandList) {
+				lock.unlock ();
+				work.commandList->Execute (rasterizer_);
+				lock.lock ();
+
+				pending_.pop_front ();
+				continue;
+			}
+
+			// Signals are queued in submission order, so their times are
+			// increasing and we only ever have to wait for the first one
+			if (wake_.wait_until (lock, work.time, [this] () { return shutdown_; })) {
+				return;
+			}
+
+			pending_.pop_front ();
+			work.fence->Signal (work.value);
+		}
+	}
+
+	Clock::duration commandListTime_;
+	Clock::duration drawTime_;
+	SoftwareRasterizer* rasterizer_;
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	Clock::time_point busyUntil_;
+	std::deque<PendingWork> pending_;
+	bool shutdown_ = false;
+
+	std::thread thread_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class NullSwapChain final : public ISwapChain
+{
+public:
+	NullSwapChain (const int width, const int height, const int bufferCount)
+		: width_ (width)
+		, height_ (height)
+	{
+		for (int i = 0; i < bufferCount; ++i) {
+			buffers_.emplace_back (new NullResource (width, height,
+				PixelFormat::R8G8B8A8_UNorm_sRGB));
+		}
+	}
+
+	int GetBufferCount () const override
+	{
+		return static_cast<int> (buffers_.size ());
+	}
+
+	IResource* GetBuffer (const int index) override
+	{
+		return buffers_ [index].get ();
+	}
+
+	int GetCurrentBufferIndex () const override
+	{
+		return currentBuffer_;
+	}
+
+	PixelFormat GetRenderTargetFormat () const override
+	{
+		return PixelFormat::R8G8B8A8_UNorm_sRGB;
+	}
+
+	int GetWidth () const override
+	{
+		return width_;
+	}
+
+	int GetHeight () const override
+	{
+		return height_;
+	}
+
+	/**
+	There is no display, so presenting never blocks.
+	*/
+	void Present (const int) override
+	{
+		currentBuffer_ = (currentBuffer_ + 1) % GetBufferCount ();
+	}
+
+private:
+	std::vector<std::unique_ptr<NullResource>> buffers_;
+	int currentBuffer_ = 0;
+	int width_, height_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Timestamps are written by the command lists when they are executed, which
+places them directly in host memory, so resolving has nothing to do.
+*/
+class SoftwareTimestampBackend final : public IGpuTimestampBackend
+{
+public:
+	SoftwareTimestampBackend (const std::vector<ICommandList*>& commandLists,
+		const int queriesPerSlot)
+		: queriesPerSlot_ (queriesPerSlot)
+		, timestamps_ (commandLists.size () * queriesPerSlot)
+	{
+		for (auto commandList : commandLists) {
+			commandLists_.push_back (static_cast<NullCommandList*> (commandList));
+		}
+	}
+
+	void WriteTimestamp (const int slot, const int query) override
+	{
+		commandLists_ [slot]->WriteTimestamp (
+			&timestamps_ [slot * queriesPerSlot_ + query]);
+	}
+
+	void Resolve (const int, const int) override
+	{
+	}
+
+	const std::uint64_t* GetResolvedTimestamps (const int slot) const override
+	{
+		return timestamps_.data () + slot * queriesPerSlot_;
+	}
+
+	std::uint64_t GetFrequency () const override
+	{
+		return 1000000000;
+	}
+
+private:
+	std::vector<NullCommandList*> commandLists_;
+	int queriesPerSlot_;
+	std::vector<std::uint64_t> timestamps_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+class NullRenderDevice final : public IRenderDevice
+{
+public:
+	NullRenderDevice (const double commandListTime, const double drawTime,
+		const bool software, const int threadCount = -1)
+		: threadPool_ (software ? new ThreadPool (threadCount) : nullptr)
+		, rasterizer_ (software ? new SoftwareRasterizer (threadPool_.get ()) : nullptr)
+		, queue_ (commandListTime, drawTime, rasterizer_.get ())
+	{
+	}
+
+	ICommandQueue* GetQueue () override
+	{
+		return &queue_;
+	}
+
+	std::unique_ptr<ISwapChain> CreateSwapChain (const int width,
+		const int height, const int bufferCount) override
+	{
+		return std::unique_ptr<ISwapChain> (
+			new NullSwapChain (width, height, bufferCount));
+	}
+
+	std::unique_ptr<IFence> CreateFence (const std::uint64_t initialValue) override
+	{
+		return std::unique_ptr<IFence> (new NullFence (initialValue));
+	}
+
+	std::unique_ptr<ICommandList> CreateCommandList (
+		const CommandListType type) override
+	{
+		return std::unique_ptr<ICommandList> (new NullCommandList (type));
+	}
+
+	std::unique_ptr<IResource> CreateBuffer (const std::size_t size,
+		const HeapType, const ResourceState) override
+	{
+		return std::unique_ptr<IResource> (new NullResource (size));
+	}
+
+	std::unique_ptr<IResource> CreateTexture2D (const int width,
+		const int height, const PixelFormat format,
+		const ResourceState, const bool) override
+	{
+		if (GetRowSize (format, 1) == 0) {
+			throw std::runtime_error ("Unsupported texture format.");
+		}
+
+		return std::unique_ptr<IResource> (new NullResource (width, height, format));
+	}
+
+	std::unique_ptr<IDescriptorHeap> CreateDescriptorHeap (
+		const int descriptorCount) override
+	{
+		return std::unique_ptr<IDescriptorHeap> (
+			new NullDescriptorHeap (descriptorCount));
+	}
+
+	std::unique_ptr<IRootSignature> CreateRootSignature (
+		const RootSignatureDesc& desc) override
+	{
+		return std::unique_ptr<IRootSignature> (new NullRootSignature (desc));
+	}
+
+	std::unique_ptr<IPipelineState> CreatePipelineState (
+		const PipelineStateDesc& desc) override
+	{
+		std::unique_ptr<NullPipelineState> pipelineState (new NullPipelineState (desc));
+
+		if (rasterizer_ && ! pipelineState->IsSoftwareSupported ()) {
+			throw std::runtime_error ("Shader not supported by the software device.");
+		}
+
+		return pipelineState;
+	}
+
+	std::unique_ptr<IShaderCompiler> CreateShaderCompiler () override
+	{
+		// Shaders run as C++ code, so the bytecode is never used
+		return std::unique_ptr<IShaderCompiler> (new StubShaderCompiler);
+	}
+
+	std::string GetAdapterIdentity () const override
+	{
+		return rasterizer_ ? "software device" : "null device";
+	}
+
+	std::unique_ptr<IGpuTimestampBackend> CreateTimestampBackend (
+		const std::vector<ICommandList*>& commandLists,
+		const int queriesPerSlot) override
+	{
+		if (rasterizer_) {
+			return std::unique_ptr<IGpuTimestampBackend> (
+				new SoftwareTimestampBackend (commandLists, queriesPerSlot));
+		}
+
+		return std::unique_ptr<IGpuTimestampBackend> (new NullTimestampBackend (
+			static_cast<int> (commandLists.size ()), queriesPerSlot));
+	}
+
+private:
+	std::unique_ptr<ThreadPool> threadPool_;
+	std::unique_ptr<SoftwareRasterizer> rasterizer_;
+	// Destroyed first, as the queue thread may still use the rasterizer
+	NullCommandQueue queue_;
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IRenderDevice> CreateNullDevice (const double commandListTime,
+	const double drawTime)
+{
+	return std::unique_ptr<IRenderDevice> (
+		new NullRenderDevice (commandListTime, drawTime, false));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IRenderDevice> CreateSoftwareDevice (const int threadCount)
+{
+	return std::unique_ptr<IRenderDevice> (
+		new NullRenderDevice (0, 0, true, threadCount));
+}
+}
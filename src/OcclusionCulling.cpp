@@ -0,0 +1,527 @@
+#include "OcclusionCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Utility.h"
+
+namespace anteru {
+namespace {
+// Anything closer to the eye than this is treated as crossing the near plane
+const float MIN_W = 1e-5f;
+
+///////////////////////////////////////////////////////////////////////////////
+void MultiplyMatrix (const float* a, const float* b, float* result)
+{
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			float sum = 0;
+			for (int k = 0; k < 4; ++k) {
+				sum += a [row * 4 + k] * b [k * 4 + column];
+			}
+			result [row * 4 + column] = sum;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void TransformPoint (const float* m, const float x, const float y, const float z,
+	float* clip)
+{
+	for (int row = 0; row < 4; ++row) {
+		clip [row] = m [row * 4 + 0] * x + m [row * 4 + 1] * y
+			+ m [row * 4 + 2] * z + m [row * 4 + 3];
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+OcclusionBuffer::OcclusionBuffer (const int width, const int height,
+	ThreadPool* threadPool)
+	: width_ (RoundToNextMultiple (width, TILE_WIDTH))
+	, height_ (RoundToNextMultiple (height, TILE_HEIGHT))
+	, threadPool_ (threadPool)
+{
+	tilesX_ = width_ / TILE_WIDTH;
+	tilesY_ = height_ / TILE_HEIGHT;
+
+	depth_.resize (width_ * height_);
+	tileRowBins_.resize (tilesY_);
+
+	// Halve the resolution until a single entry is left
+	int levelWidth = tilesX_, levelHeight = tilesY_;
+	for (;;) {
+		DepthLevel level;
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.maxDepth.resize (levelWidth * levelHeight);
+		levels_.push_back (std::move (level));
+
+		if (levelWidth == 1 && levelHeight == 1) {
+			break;
+		}
+
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+
+	static const float identity [16] = {
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	};
+
+	SetViewProjection (identity);
+	Clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::Clear ()
+{
+	std::fill (depth_.begin (), depth_.end (), 1.0f);
+	for (auto& level : levels_) {
+		std::fill (level.maxDepth.begin (), level.maxDepth.end (), 1.0f);
+	}
+	triangles_.clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::SetViewProjection (const float* matrix)
+{
+	std::memcpy (viewProjection_, matrix, sizeof (viewProjection_));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Transform the occluder into screen space and set up one Triangle per
+visible input triangle. Triangles are stored with a consistent winding so
+the rasterizer does not have to care about the orientation.
+*/
+void OcclusionBuffer::AddOccluder (const float* positions, const int positionStride,
+	const int vertexCount,
+	const std::uint32_t* indices, const int indexCount,
+	const float* worldMatrix)
+{
+	float matrix [16];
+	if (worldMatrix) {
+		MultiplyMatrix (viewProjection_, worldMatrix, matrix);
+	} else {
+		std::memcpy (matrix, viewProjection_, sizeof (matrix));
+	}
+
+	// x, y, z in screen space and a flag whether the vertex can be used
+	struct ScreenVertex
+	{
+		float x, y, z;
+		bool valid;
+	};
+
+	std::vector<ScreenVertex> screenVertices (vertexCount);
+	const auto base = reinterpret_cast<const unsigned char*> (positions);
+
+	for (int i = 0; i < vertexCount; ++i) {
+		const auto p = reinterpret_cast<const float*> (base + i * positionStride);
+
+		float clip [4];
+		TransformPoint (matrix, p [0], p [1], p [2], clip);
+
+		auto& v = screenVertices [i];
+		v.valid = clip [3] > MIN_W && clip [2] >= 0;
+
+		if (v.valid) {
+			const float invW = 1.0f / clip [3];
+			v.x = (clip [0] * invW * 0.5f + 0.5f) * width_;
+			v.y = (0.5f - clip [1] * invW * 0.5f) * height_;
+			v.z = std::min (clip [2] * invW, 1.0f);
+		}
+	}
+
+	for (int i = 0; i + 2 < indexCount; i += 3) {
+		const ScreenVertex* v [3] = {
+			&screenVertices [indices [i + 0]],
+			&screenVertices [indices [i + 1]],
+			&screenVertices [indices [i + 2]]
+		};
+
+		if (! (v [0]->valid && v [1]->valid && v [2]->valid)) {
+			continue;
+		}
+
+		const float area = (v [1]->x - v [0]->x) * (v [2]->y - v [0]->y)
+			- (v [2]->x - v [0]->x) * (v [1]->y - v [0]->y);
+
+		if (area == 0) {
+			continue;
+		}
+
+		// Occluders are rasterized double-sided, we only normalize the
+		// winding here
+		if (area < 0) {
+			std::swap (v [1], v [2]);
+		}
+
+		Triangle triangle;
+		for (int j = 0; j < 3; ++j) {
+			triangle.x [j] = v [j]->x;
+			triangle.y [j] = v [j]->y;
+			triangle.z [j] = v [j]->z;
+		}
+
+		const auto minX = std::min ({ triangle.x [0], triangle.x [1], triangle.x [2] });
+		const auto maxX = std::max ({ triangle.x [0], triangle.x [1], triangle.x [2] });
+		const auto minY = std::min ({ triangle.y [0], triangle.y [1], triangle.y [2] });
+		const auto maxY = std::max ({ triangle.y [0], triangle.y [1], triangle.y [2] });
+
+		// Pixel x is covered if its center x + 0.5 lies inside the triangle
+		triangle.minX = std::max (static_cast<int> (std::ceil (minX - 0.5f)), 0);
+		triangle.maxX = std::min (static_cast<int> (std::floor (maxX - 0.5f)), width_ - 1);
+		triangle.minY = std::max (static_cast<int> (std::ceil (minY - 0.5f)), 0);
+		triangle.maxY = std::min (static_cast<int> (std::floor (maxY - 0.5f)), height_ - 1);
+
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+			continue;
+		}
+
+		triangles_.push_back (triangle);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::Rasterize ()
+{
+	for (auto& bin : tileRowBins_) {
+		bin.clear ();
+	}
+
+	for (int i = 0; i < static_cast<int> (triangles_.size ()); ++i) {
+		const auto& triangle = triangles_ [i];
+		for (int row = triangle.minY / TILE_HEIGHT;
+			row <= triangle.maxY / TILE_HEIGHT; ++row) {
+			tileRowBins_ [row].push_back (i);
+		}
+	}
+
+	if (threadPool_) {
+		threadPool_->ParallelFor (tilesY_, [this] (const int tileRow) {
+			RasterizeTileRow (tileRow);
+		});
+	} else {
+		for (int tileRow = 0; tileRow < tilesY_; ++tileRow) {
+			RasterizeTileRow (tileRow);
+		}
+	}
+
+	triangles_.clear ();
+
+	UpdateHierarchy ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Reduce the tile depths into the levels above. The pyramid is tiny compared
+to the depth buffer, so this runs on the calling thread.
+*/
+void OcclusionBuffer::UpdateHierarchy ()
+{
+	for (std::size_t i = 1; i < levels_.size (); ++i) {
+		const auto& below = levels_ [i - 1];
+		auto& level = levels_ [i];
+
+		for (int y = 0; y < level.height; ++y) {
+			for (int x = 0; x < level.width; ++x) {
+				const int x1 = std::min (2 * x + 1, below.width - 1);
+				const int y1 = std::min (2 * y + 1, below.height - 1);
+
+				level.maxDepth [y * level.width + x] = std::max (
+					std::max (below.maxDepth [2 * y * below.width + 2 * x],
+						below.maxDepth [2 * y * below.width + x1]),
+					std::max (below.maxDepth [y1 * below.width + 2 * x],
+						below.maxDepth [y1 * below.width + x1]));
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Rasterize all triangles binned to this row of tiles, then update the
+per-tile maximum depth. Each row of tiles is owned by exactly one task.
+*/
+void OcclusionBuffer::RasterizeTileRow (const int tileRow)
+{
+	const auto& bin = tileRowBins_ [tileRow];
+
+	if (bin.empty ()) {
+		return;
+	}
+
+	for (const auto index : bin) {
+		RasterizeTriangle (triangles_ [index], tileRow);
+	}
+
+	auto& tileMaxDepth = levels_ [0].maxDepth;
+	for (int tileX = 0; tileX < tilesX_; ++tileX) {
+		const float* tile = GetTile (tileX, tileRow);
+		tileMaxDepth [tileRow * tilesX_ + tileX] =
+			*std::max_element (tile, tile + TILE_WIDTH * TILE_HEIGHT);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Rasterize the part of a triangle which overlaps one row of tiles, using
+edge functions evaluated at pixel centers, four pixels at a time.
+*/
+void OcclusionBuffer::RasterizeTriangle (const Triangle& t, const int tileRow)
+{
+	const int startY = std::max (t.minY, tileRow * TILE_HEIGHT);
+	const int endY = std::min (t.maxY, (tileRow + 1) * TILE_HEIGHT - 1);
+
+	// Edge i goes from vertex i to vertex i + 1, E (x, y) = a*x + b*y + c
+	// is non-negative inside the triangle
+	float a [3], b [3], c [3];
+	for (int i = 0; i < 3; ++i) {
+		const int j = (i + 1) % 3;
+		a [i] = t.y [i] - t.y [j];
+		b [i] = t.x [j] - t.x [i];
+		c [i] = -(a [i] * t.x [i] + b [i] * t.y [i]);
+	}
+
+	// Depth plane z = z0 + dzdx * (x - x0) + dzdy * (y - y0)
+	const float det = (t.x [1] - t.x [0]) * (t.y [2] - t.y [0])
+		- (t.x [2] - t.x [0]) * (t.y [1] - t.y [0]);
+	const float dzdx = ((t.z [1] - t.z [0]) * (t.y [2] - t.y [0])
+		- (t.z [2] - t.z [0]) * (t.y [1] - t.y [0])) / det;
+	const float dzdy = ((t.z [2] - t.z [0]) * (t.x [1] - t.x [0])
+		- (t.z [1] - t.z [0]) * (t.x [2] - t.x [0])) / det;
+	const float zc = t.z [0] - dzdx * t.x [0] - dzdy * t.y [0];
+
+	// Interpolation can overshoot slightly outside of the triangle, so clamp
+	// to the vertex depth range
+	const float minZ = std::min ({ t.z [0], t.z [1], t.z [2] });
+	const float maxZ = std::max ({ t.z [0], t.z [1], t.z [2] });
+
+	const int startTileX = t.minX / TILE_WIDTH;
+	const int endTileX = t.maxX / TILE_WIDTH;
+
+#if ANTERU_SSE2
+	const __m128 laneOffset = _mm_setr_ps (0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 a0 = _mm_set1_ps (a [0]);
+	const __m128 a1 = _mm_set1_ps (a [1]);
+	const __m128 a2 = _mm_set1_ps (a [2]);
+	const __m128 zero = _mm_setzero_ps ();
+	const __m128 dzdxV = _mm_set1_ps (dzdx);
+	const __m128 minZV = _mm_set1_ps (minZ);
+	const __m128 maxZV = _mm_set1_ps (maxZ);
+#endif
+
+	for (int tileX = startTileX; tileX <= endTileX; ++tileX) {
+		float* tile = GetTile (tileX, tileRow);
+
+		for (int y = startY; y <= endY; ++y) {
+			const float py = static_cast<float> (y) + 0.5f;
+			float* row = tile + (y % TILE_HEIGHT) * TILE_WIDTH;
+
+			const float rowE0 = b [0] * py + c [0];
+			const float rowE1 = b [1] * py + c [1];
+			const float rowE2 = b [2] * py + c [2];
+			const float rowZ = dzdy * py + zc;
+
+			for (int column = 0; column < TILE_WIDTH; column += 4) {
+				const float x = static_cast<float> (tileX * TILE_WIDTH + column);
+
+#if ANTERU_SSE2
+				const __m128 px = _mm_add_ps (_mm_set1_ps (x), laneOffset);
+				const __m128 e0 = _mm_add_ps (_mm_mul_ps (a0, px), _mm_set1_ps (rowE0));
+				const __m128 e1 = _mm_add_ps (_mm_mul_ps (a1, px), _mm_set1_ps (rowE1));
+				const __m128 e2 = _mm_add_ps (_mm_mul_ps (a2, px), _mm_set1_ps (rowE2));
+
+				const __m128 inside = _mm_and_ps (_mm_cmpge_ps (e0, zero),
+					_mm_and_ps (_mm_cmpge_ps (e1, zero), _mm_cmpge_ps (e2, zero)));
+
+				if (_mm_movemask_ps (inside) == 0) {
+					continue;
+				}
+
+				__m128 z = _mm_add_ps (_mm_mul_ps (dzdxV, px), _mm_set1_ps (rowZ));
+				z = _mm_min_ps (_mm_max_ps (z, minZV), maxZV);
+
+				const __m128 old = _mm_loadu_ps (row + column);
+				const __m128 updated = _mm_min_ps (old, z);
+				_mm_storeu_ps (row + column, _mm_or_ps (
+					_mm_and_ps (inside, updated), _mm_andnot_ps (inside, old)));
+#else
+				for (int lane = 0; lane < 4; ++lane) {
+					const float px = x + static_cast<float> (lane) + 0.5f;
+
+					if (a [0] * px + rowE0 < 0 || a [1] * px + rowE1 < 0 ||
+						a [2] * px + rowE2 < 0) {
+						continue;
+					}
+
+					const float z = std::min (std::max (dzdx * px + rowZ, minZ), maxZ);
+					row [column + lane] = std::min (row [column + lane], z);
+				}
+#endif
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool OcclusionBuffer::IsVisible (const BoundingBox& box) const
+{
+	float minX = static_cast<float> (width_), maxX = 0;
+	float minY = static_cast<float> (height_), maxY = 0;
+	float minZ = 1.0f;
+
+	for (int corner = 0; corner < 8; ++corner) {
+		float clip [4];
+		TransformPoint (viewProjection_,
+			(corner & 1) ? box.max [0] : box.min [0],
+			(corner & 2) ? box.max [1] : box.min [1],
+			(corner & 4) ? box.max [2] : box.min [2],
+			clip);
+
+		if (clip [3] <= MIN_W) {
+			return true;
+		}
+
+		const float invW = 1.0f / clip [3];
+		const float x = (clip [0] * invW * 0.5f + 0.5f) * width_;
+		const float y = (0.5f - clip [1] * invW * 0.5f) * height_;
+
+		minX = std::min (minX, x);
+		maxX = std::max (maxX, x);
+		minY = std::min (minY, y);
+		maxY = std::max (maxY, y);
+		minZ = std::min (minZ, clip [2] * invW);
+	}
+
+	if (minZ <= 0) {
+		return true;
+	}
+
+	// All pixels touched by the screen space rectangle
+	const int startX = std::max (static_cast<int> (std::floor (minX)), 0);
+	const int endX = std::min (static_cast<int> (std::ceil (maxX)) - 1, width_ - 1);
+	const int startY = std::max (static_cast<int> (std::floor (minY)), 0);
+	const int endY = std::min (static_cast<int> (std::ceil (maxY)) - 1, height_ - 1);
+
+	if (startX > endX || startY > endY) {
+		return true;
+	}
+
+	const int pixelRect [4] = { startX, startY, endX, endY };
+
+	// Start at the first level where the box covers at most 2x2 entries
+	const int startTileX = startX / TILE_WIDTH, endTileX = endX / TILE_WIDTH;
+	const int startTileY = startY / TILE_HEIGHT, endTileY = endY / TILE_HEIGHT;
+
+	int level = 0;
+	while ((endTileX >> level) - (startTileX >> level) > 1 ||
+		(endTileY >> level) - (startTileY >> level) > 1) {
+		++level;
+	}
+
+	for (int y = startTileY >> level; y <= endTileY >> level; ++y) {
+		for (int x = startTileX >> level; x <= endTileX >> level; ++x) {
+			if (IsRegionVisible (level, x, y, pixelRect, minZ)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Test the part of pixelRect (x0, y0, x1, y1, inclusive) which lies in entry
+(x, y) of a level. Entries which are entirely closer than minZ hide
+everything below them, otherwise the test continues with the four entries
+of the level below, and finally with the pixels of a tile.
+*/
+bool OcclusionBuffer::IsRegionVisible (const int level, const int x, const int y,
+	const int* pixelRect, const float minZ) const
+{
+	const auto& depthLevel = levels_ [level];
+	if (depthLevel.maxDepth [y * depthLevel.width + x] < minZ) {
+		return false;
+	}
+
+	if (level == 0) {
+		const float* tile = GetTile (x, y);
+		const int x0 = std::max (pixelRect [0], x * TILE_WIDTH);
+		const int x1 = std::min (pixelRect [2], x * TILE_WIDTH + TILE_WIDTH - 1);
+		const int y0 = std::max (pixelRect [1], y * TILE_HEIGHT);
+		const int y1 = std::min (pixelRect [3], y * TILE_HEIGHT + TILE_HEIGHT - 1);
+
+		for (int py = y0; py <= y1; ++py) {
+			const float* row = tile + (py % TILE_HEIGHT) * TILE_WIDTH;
+			for (int px = x0; px <= x1; ++px) {
+				if (row [px % TILE_WIDTH] >= minZ) {
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	// Children which overlap the rectangle, in tiles of the level below
+	const int shift = level - 1;
+	const auto& below = levels_ [level - 1];
+	const int childX0 = std::max (2 * x, (pixelRect [0] / TILE_WIDTH) >> shift);
+	const int childX1 = std::min ({ 2 * x + 1, (pixelRect [2] / TILE_WIDTH) >> shift,
+		below.width - 1 });
+	const int childY0 = std::max (2 * y, (pixelRect [1] / TILE_HEIGHT) >> shift);
+	const int childY1 = std::min ({ 2 * y + 1, (pixelRect [3] / TILE_HEIGHT) >> shift,
+		below.height - 1 });
+
+	for (int childY = childY0; childY <= childY1; ++childY) {
+		for (int childX = childX0; childX <= childX1; ++childX) {
+			if (IsRegionVisible (level - 1, childX, childY, pixelRect, minZ)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::TestVisibility (const BoundingBox* boxes, const int count,
+	std::uint8_t* visible) const
+{
+	static const int BOXES_PER_TASK = 64;
+
+	const auto testRange = [=] (const int task) {
+		const int end = std::min (count, (task + 1) * BOXES_PER_TASK);
+		for (int i = task * BOXES_PER_TASK; i < end; ++i) {
+			visible [i] = IsVisible (boxes [i]) ? 1 : 0;
+		}
+	};
+
+	const int taskCount = (count + BOXES_PER_TASK - 1) / BOXES_PER_TASK;
+
+	if (threadPool_) {
+		threadPool_->ParallelFor (taskCount, testRange);
+	} else {
+		for (int task = 0; task < taskCount; ++task) {
+			testRange (task);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+float OcclusionBuffer::GetDepth (const int x, const int y) const
+{
+	const float* tile = GetTile (x / TILE_WIDTH, y / TILE_HEIGHT);
+	return tile [(y % TILE_HEIGHT) * TILE_WIDTH + x % TILE_WIDTH];
+}
+}
@@ -0,0 +1,277 @@
+#include "PipelineCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Deflate.h"
+
+namespace anteru {
+namespace {
+// File layout, in native byte order: a header, the entries sorted by key,
+// then the blobs of all entries
+const std::uint32_t CACHE_MAGIC = 0x434C5041; // 'APLC'
+const std::uint32_t CACHE_VERSION = 1;
+
+struct FileHeader
+{
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t generation;
+	std::uint32_t entryCount;
+	Hash128 identity;
+};
+
+const std::size_t FILE_ENTRY_SIZE = 40;
+
+static_assert (sizeof (FileHeader) == 32, "Unexpected header size");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PipelineCache::PipelineCache (const std::string& path,
+	const std::string& adapterIdentity, const int maxUnusedGenerations,
+	const std::size_t maxSize)
+	: path_ (path)
+	, identity_ (ComputeHash128 (adapterIdentity.data (), adapterIdentity.size ()))
+	, maxUnusedGenerations_ (maxUnusedGenerations)
+	, maxSize_ (maxSize)
+{
+	OpenFile ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PipelineCache::~PipelineCache ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PipelineCache::OpenFile ()
+{
+	static_assert (sizeof (Entry) == FILE_ENTRY_SIZE, "Unexpected entry size");
+
+	file_.reset (new MappedFile (path_.c_str ()));
+	fileEntryCount_ = 0;
+	fileGeneration_ = 0;
+
+	if (! file_->IsOpen ()) {
+		return;
+	}
+
+	FileHeader header = {};
+	if (file_->GetSize () >= sizeof (FileHeader)) {
+		std::memcpy (&header, file_->GetData (), sizeof (header));
+	}
+
+	if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+		header.identity != identity_ ||
+		header.entryCount > (file_->GetSize () - sizeof (FileHeader)) / FILE_ENTRY_SIZE) {
+		invalidated_ = true;
+		return;
+	}
+
+	fileEntryCount_ = static_cast<int> (header.entryCount);
+	fileGeneration_ = header.generation;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PipelineCache::Entry PipelineCache::GetFileEntry (const int index) const
+{
+	Entry entry;
+	std::memcpy (&entry, file_->GetData () + sizeof (FileHeader) +
+		index * FILE_ENTRY_SIZE, FILE_ENTRY_SIZE);
+
+	return entry;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool PipelineCache::IsEntryValid (const Entry& entry) const
+{
+	return entry.offset <= file_->GetSize () &&
+		entry.size <= file_->GetSize () - entry.offset &&
+		Crc32 (file_->GetData () + entry.offset, entry.size) == entry.checksum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool PipelineCache::Find (const Hash128& key, std::vector<std::uint8_t>& blob)
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+
+	const auto added = addedEntries_.find (key);
+	if (added != addedEntries_.end ()) {
+		blob = added->second;
+		++hitCount_;
+		return true;
+	}
+
+	int first = 0;
+	int last = fileEntryCount_;
+	while (first < last) {
+		const int middle = first + (last - first) / 2;
+		const auto entry = GetFileEntry (middle);
+
+		if (entry.key < key) {
+			first = middle + 1;
+		} else if (key < entry.key) {
+			last = middle;
+		} else {
+			if (! IsEntryValid (entry)) {
+				break;
+			}
+
+			const auto data = file_->GetData () + entry.offset;
+			blob.assign (data, data + entry.size);
+			usedKeys_.insert (key);
+			++hitCount_;
+			return true;
+		}
+	}
+
+	++missCount_;
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PipelineCache::Add (const Hash128& key, std::vector<std::uint8_t> blob)
+{
+	if (blob.empty ()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock (mutex_);
+	addedEntries_ [key] = std::move (blob);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool PipelineCache::Save ()
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+
+	prunedCount_ = 0;
+	if (addedEntries_.empty ()) {
+		return true;
+	}
+
+	// Merge with the file as it is now, which may have been updated by
+	// another process in the meantime
+	OpenFile ();
+	const std::uint32_t generation = fileGeneration_ + 1;
+
+	struct Blob
+	{
+		Hash128 key;
+		const std::uint8_t* data;
+		std::uint32_t size;
+		std::uint32_t lastUsed;
+	};
+
+	std::map<Hash128, Blob> blobs;
+	for (int i = 0; i < fileEntryCount_; ++i) {
+		const auto entry = GetFileEntry (i);
+		if (! IsEntryValid (entry)) {
+			continue;
+		}
+
+		const auto lastUsed = usedKeys_.count (entry.key) ? generation : entry.lastUsed;
+		if (generation - lastUsed > static_cast<std::uint32_t> (maxUnusedGenerations_)) {
+			++prunedCount_;
+			continue;
+		}
+
+		blobs [entry.key] = { entry.key, file_->GetData () + entry.offset,
+			entry.size, lastUsed };
+	}
+
+	for (const auto& added : addedEntries_) {
+		blobs [added.first] = { added.first, added.second.data (),
+			static_cast<std::uint32_t> (added.second.size ()), generation };
+	}
+
+	// Keep the most recently used blobs which fit into maxSize_
+	std::vector<Blob> kept;
+	for (const auto& blob : blobs) {
+		kept.push_back (blob.second);
+	}
+
+	std::stable_sort (kept.begin (), kept.end (), [] (const Blob& a, const Blob& b) {
+		return a.lastUsed > b.lastUsed;
+	});
+
+	std::size_t totalSize = sizeof (FileHeader);
+	std::size_t keptCount = 0;
+	for (; keptCount < kept.size (); ++keptCount) {
+		const auto entrySize = FILE_ENTRY_SIZE + kept [keptCount].size;
+		if (totalSize + entrySize > maxSize_) {
+			break;
+		}
+
+		totalSize += entrySize;
+	}
+
+	prunedCount_ += static_cast<int> (kept.size () - keptCount);
+	kept.resize (keptCount);
+
+	std::sort (kept.begin (), kept.end (), [] (const Blob& a, const Blob& b) {
+		return a.key < b.key;
+	});
+
+	std::vector<std::uint8_t> output (sizeof (FileHeader) + kept.size () * FILE_ENTRY_SIZE);
+
+	FileHeader header = {
+		CACHE_MAGIC, CACHE_VERSION, generation,
+		static_cast<std::uint32_t> (kept.size ()), identity_
+	};
+	std::memcpy (output.data (), &header, sizeof (header));
+
+	for (std::size_t i = 0; i < kept.size (); ++i) {
+		const auto& blob = kept [i];
+		const Entry entry = {
+			blob.key, output.size (), blob.size, Crc32 (blob.data, blob.size),
+			blob.lastUsed, 0
+		};
+		std::memcpy (output.data () + sizeof (FileHeader) + i * FILE_ENTRY_SIZE,
+			&entry, FILE_ENTRY_SIZE);
+		output.insert (output.end (), blob.data, blob.data + blob.size);
+	}
+
+	// The mapping has to be closed before the file can be replaced on Windows
+	file_.reset ();
+
+	const bool written = WriteFileAtomic (path_.c_str (), output.data (), output.size ());
+	if (written) {
+		addedEntries_.clear ();
+		usedKeys_.clear ();
+		invalidated_ = false;
+	}
+
+	OpenFile ();
+
+	return written;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int PipelineCache::GetHitCount () const
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+	return hitCount_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int PipelineCache::GetMissCount () const
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+	return missCount_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int PipelineCache::GetPrunedCount () const
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+	return prunedCount_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool PipelineCache::WasInvalidated () const
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+	return invalidated_;
+}
+}
@@ -0,0 +1,208 @@
+#include "PipelineStateManager.h"
+
+#include <chrono>
+#include <exception>
+#include <vector>
+
+#include "PipelineCache.h"
+#include "RootSignatureBuilder.h"
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+namespace anteru {
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+void AddShader (HashBuilder& builder, const ShaderDesc& desc)
+{
+	// Precompiled bytecode is all that matters, the source is ignored
+	if (desc.bytecode) {
+		builder.Add (desc.bytecode, desc.bytecodeSize);
+		return;
+	}
+
+	builder.Add (desc.source, desc.sourceSize)
+		.Add (desc.entryPoint)
+		.Add (desc.profile)
+		.Add (static_cast<std::uint64_t> (desc.defines.size ()));
+
+	for (const auto& define : desc.defines) {
+		builder.Add (define.name).Add (define.value);
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool PipelineStateHandle::IsReady () const
+{
+	return entry_->done.wait_for (std::chrono::seconds (0)) == std::future_status::ready;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IPipelineState* PipelineStateHandle::Get (IPipelineState* fallback) const
+{
+	const auto pipelineState = entry_->pipelineState.load (std::memory_order_acquire);
+	return pipelineState ? pipelineState : fallback;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IPipelineState* PipelineStateHandle::Wait () const
+{
+	entry_->done.get ();
+	return entry_->pipelineState.load (std::memory_order_acquire);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PipelineStateManager::PipelineStateManager (IRenderDevice& device,
+	ThreadPool& threadPool, ShaderCache* shaderCache,
+	PipelineCache* pipelineCache)
+	: device_ (device)
+	, threadPool_ (threadPool)
+	, shaderCache_ (shaderCache)
+	, pipelineCache_ (pipelineCache)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PipelineStateManager::~PipelineStateManager ()
+{
+	WaitIdle ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Hash128 PipelineStateManager::ComputeHash (const PipelineStateDesc& desc)
+{
+	HashBuilder builder;
+
+	const auto rootSignature = SerializeRootSignature (desc.rootSignature->GetDesc ());
+	builder.Add (rootSignature.data (), rootSignature.size ());
+
+	AddShader (builder, desc.vertexShader);
+	AddShader (builder, desc.pixelShader);
+
+	builder.Add (static_cast<std::uint64_t> (desc.inputLayout.size ()));
+	for (const auto& element : desc.inputLayout) {
+		builder.Add (element.semanticName)
+			.Add (static_cast<std::uint64_t> (element.semanticIndex))
+			.Add (static_cast<std::uint64_t> (element.format))
+			.Add (static_cast<std::uint64_t> (element.offset));
+	}
+
+	builder.Add (static_cast<std::uint64_t> (desc.renderTargetFormat))
+		.Add (static_cast<std::uint64_t> (desc.blendMode));
+
+	return builder.Get ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PipelineStateHandle PipelineStateManager::Request (const PipelineStateDesc& desc)
+{
+	const auto hash = ComputeHash (desc);
+
+	PipelineStateHandle::Entry* entry = nullptr;
+	// The future is set up before the entry becomes visible, so handles
+	// for the same hash can wait on it right away
+	const auto promise = std::make_shared<std::promise<void>> ();
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+		++requestCount_;
+
+		auto& slot = entries_ [hash];
+		if (slot) {
+			return PipelineStateHandle (slot.get ());
+		}
+
+		slot.reset (new PipelineStateHandle::Entry);
+		entry = slot.get ();
+		entry->done = promise->get_future ().share ();
+	}
+
+	threadPool_.Submit ([this, desc, entry, promise] () {
+		try {
+			Create (desc, entry);
+			promise->set_value ();
+		} catch (...) {
+			promise->set_exception (std::current_exception ());
+		}
+	});
+
+	return PipelineStateHandle (entry);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PipelineStateManager::Create (PipelineStateDesc desc,
+	PipelineStateHandle::Entry* entry)
+{
+	TraceScope scope ("Create pipeline state");
+
+	// Must outlive the CreatePipelineState call below
+	std::vector<std::uint8_t> vertexShader;
+	std::vector<std::uint8_t> pixelShader;
+
+	if (shaderCache_) {
+		if (! desc.vertexShader.bytecode) {
+			vertexShader = shaderCache_->GetBytecode (desc.vertexShader);
+			desc.vertexShader.bytecode = vertexShader.data ();
+			desc.vertexShader.bytecodeSize = vertexShader.size ();
+		}
+
+		if (! desc.pixelShader.bytecode) {
+			pixelShader = shaderCache_->GetBytecode (desc.pixelShader);
+			desc.pixelShader.bytecode = pixelShader.data ();
+			desc.pixelShader.bytecodeSize = pixelShader.size ();
+		}
+	}
+
+	// The key covers the bytecode if the shaders went through the cache,
+	// so blobs of outdated shaders are not picked up
+	Hash128 key;
+	std::vector<std::uint8_t> cachedBlob;
+	if (pipelineCache_) {
+		key = ComputeHash (desc);
+
+		if (pipelineCache_->Find (key, cachedBlob)) {
+			desc.cachedBlob = cachedBlob.data ();
+			desc.cachedBlobSize = cachedBlob.size ();
+		}
+	}
+
+	entry->owner = device_.CreatePipelineState (desc);
+
+	if (pipelineCache_ && ! desc.cachedBlob) {
+		pipelineCache_->Add (key, entry->owner->GetCachedBlob ());
+	}
+
+	entry->pipelineState.store (entry->owner.get (), std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PipelineStateManager::WaitIdle ()
+{
+	std::vector<std::shared_future<void>> pending;
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+		for (const auto& entry : entries_) {
+			pending.push_back (entry.second->done);
+		}
+	}
+
+	// Failures are reported through the handles
+	for (const auto& future : pending) {
+		future.wait ();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int PipelineStateManager::GetRequestCount () const
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+	return requestCount_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int PipelineStateManager::GetPipelineStateCount () const
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+	return static_cast<int> (entries_.size ());
+}
+}
@@ -0,0 +1,380 @@
+#include "PixelConversion.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Simd.h"
+
+namespace anteru {
+namespace {
+// Half and the 11/10-bit floats all have a 5-bit exponent with bias 15,
+// and differ only in their mantissa width and sign bit
+const int HALF_MANTISSA_BITS = 10;
+const int R11_MANTISSA_BITS = 6;
+const int B10_MANTISSA_BITS = 5;
+
+// Smallest float which is a normal number in the 5-bit exponent formats
+const std::uint32_t SMALL_FLOAT_MIN_NORMAL = 113u << 23;
+// Smallest float which overflows the half range
+const std::uint32_t HALF_OVERFLOW = 143u << 23;
+const std::uint32_t FLOAT_INFINITY = 255u << 23;
+
+const int RGB9E5_MANTISSA_BITS = 9;
+const int RGB9E5_EXPONENT_BIAS = 15;
+const int RGB9E5_MAX_EXPONENT = 31;
+// 511/512 * 2^16
+const float RGB9E5_MAX_VALUE = 65408.0f;
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::uint32_t FloatToBits (const float value)
+{
+	std::uint32_t bits;
+	std::memcpy (&bits, &value, sizeof (bits));
+	return bits;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline float BitsToFloat (const std::uint32_t bits)
+{
+	float value;
+	std::memcpy (&value, &bits, sizeof (value));
+	return value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Adding this to a float below the smallest normal number of the target
+format shifts its mantissa into place, rounding to nearest even, as the
+sum has the right exponent to make the lowest mantissa bit a denormal ulp.
+*/
+inline std::uint32_t GetDenormalMagic (const int mantissaBits)
+{
+	return static_cast<std::uint32_t> ((127 - 15) + (23 - mantissaBits) + 1) << 23;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Convert the bits of a non-negative float which is small enough for the
+target format to a float with a 5-bit exponent and mantissaBits bits of
+mantissa, rounding to nearest even.
+*/
+inline std::uint32_t ToSmallFloat (const std::uint32_t bits, const int mantissaBits)
+{
+	const int shift = 23 - mantissaBits;
+
+	if (bits < SMALL_FLOAT_MIN_NORMAL) {
+		const auto magic = GetDenormalMagic (mantissaBits);
+		return FloatToBits (BitsToFloat (bits) + BitsToFloat (magic)) - magic;
+	}
+
+	// Rebias the exponent and round, ties go to the even mantissa
+	const std::uint32_t odd = (bits >> shift) & 1;
+	return (bits + (static_cast<std::uint32_t> (15 - 127) << 23) +
+		((1u << (shift - 1)) - 1) + odd) >> shift;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::uint16_t FloatToHalf (const float value)
+{
+	const auto bits = FloatToBits (value);
+	const auto sign = bits & 0x80000000u;
+	const auto magnitude = bits ^ sign;
+
+	std::uint32_t result;
+	if (magnitude >= HALF_OVERFLOW) {
+		// NaN stays NaN, everything else becomes infinity
+		result = magnitude > FLOAT_INFINITY ? 0x7E00 : 0x7C00;
+	} else {
+		result = ToSmallFloat (magnitude, HALF_MANTISSA_BITS);
+	}
+
+	return static_cast<std::uint16_t> (result | (sign >> 16));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline float HalfToFloat (const std::uint16_t value)
+{
+	const std::uint32_t exponentMask = 0x7C00u << 13;
+	std::uint32_t bits = (value & 0x7FFFu) << 13;
+	const auto exponent = bits & exponentMask;
+
+	// Rebias the exponent
+	bits += static_cast<std::uint32_t> (127 - 15) << 23;
+
+	if (exponent == exponentMask) {
+		// Infinity and NaN get the maximum exponent
+		bits += static_cast<std::uint32_t> (128 - 16) << 23;
+	} else if (exponent == 0) {
+		// Denormals get normalized by the float unit
+		bits += 1u << 23;
+		bits = FloatToBits (BitsToFloat (bits) - BitsToFloat (SMALL_FLOAT_MIN_NORMAL));
+	}
+
+	return BitsToFloat (bits | ((value & 0x8000u) << 16));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Clamp to the range of an unsigned small float, mapping NaN to 0.
+*/
+inline std::uint32_t ClampUnsignedSmallFloat (const float value,
+	const int mantissaBits)
+{
+	// Largest finite value: exponent 30, all mantissa bits set
+	const auto maxValue = (30u << mantissaBits) | ((1u << mantissaBits) - 1);
+
+	if (! (value > 0)) {
+		return 0;
+	}
+
+	const auto bits = FloatToBits (value);
+	if (bits >= (static_cast<std::uint32_t> (127 + 15) << 23 | (((1u << mantissaBits) - 1) << (23 - mantissaBits)))) {
+		return maxValue;
+	}
+
+	return ToSmallFloat (bits, mantissaBits);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+inline std::uint32_t PackR11G11B10 (const float* rgb)
+{
+	return ClampUnsignedSmallFloat (rgb [0], R11_MANTISSA_BITS) |
+		(ClampUnsignedSmallFloat (rgb [1], R11_MANTISSA_BITS) << 11) |
+		(ClampUnsignedSmallFloat (rgb [2], B10_MANTISSA_BITS) << 22);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Shared exponent packing as described in the D3D functional specification:
+the exponent is chosen for the largest component, and bumped by one if
+its mantissa rounds up to 512.
+*/
+inline std::uint32_t PackR9G9B9E5 (const float* rgb)
+{
+	// std::max returns the first argument if the comparison fails, which
+	// maps NaN to 0
+	float values [3];
+	for (int i = 0; i < 3; ++i) {
+		values [i] = std::min (std::max (0.0f, rgb [i]), RGB9E5_MAX_VALUE);
+	}
+
+	const float maxValue = std::max (std::max (values [0], values [1]), values [2]);
+
+	// floor (log2 (maxValue)), clamped so the exponent does not underflow
+	const int log2 = std::max (static_cast<int> (FloatToBits (maxValue) >> 23) - 127,
+		-RGB9E5_EXPONENT_BIAS - 1);
+	int exponent = log2 + 1 + RGB9E5_EXPONENT_BIAS;
+
+	// Scale to the mantissa range, exact as it is a power of two
+	float scale = BitsToFloat (static_cast<std::uint32_t> (
+		127 + RGB9E5_EXPONENT_BIAS + RGB9E5_MANTISSA_BITS - exponent) << 23);
+	if (static_cast<int> (maxValue * scale + 0.5f) == (1 << RGB9E5_MANTISSA_BITS)) {
+		scale *= 0.5f;
+		++exponent;
+	}
+
+	std::uint32_t result = static_cast<std::uint32_t> (exponent) << 27;
+	for (int i = 0; i < 3; ++i) {
+		result |= static_cast<std::uint32_t> (values [i] * scale + 0.5f) <<
+			(i * RGB9E5_MANTISSA_BITS);
+	}
+
+	return result;
+}
+
+#if ANTERU_SSE2
+///////////////////////////////////////////////////////////////////////////////
+inline __m128i Select (const __m128i mask, const __m128i a, const __m128i b)
+{
+	return _mm_or_si128 (_mm_and_si128 (mask, a), _mm_andnot_si128 (mask, b));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Four lanes of ToSmallFloat.
+*/
+inline __m128i ToSmallFloat (const __m128i bits, const int mantissaBits)
+{
+	const int shift = 23 - mantissaBits;
+
+	const __m128i magic = _mm_set1_epi32 (static_cast<int> (GetDenormalMagic (mantissaBits)));
+	const __m128i denormal = _mm_sub_epi32 (_mm_castps_si128 (_mm_add_ps (
+		_mm_castsi128_ps (bits), _mm_castsi128_ps (magic))), magic);
+
+	const __m128i odd = _mm_and_si128 (_mm_srli_epi32 (bits, shift), _mm_set1_epi32 (1));
+	const __m128i normal = _mm_srli_epi32 (_mm_add_epi32 (_mm_add_epi32 (bits,
+		_mm_set1_epi32 (static_cast<int> ((static_cast<std::uint32_t> (15 - 127) << 23) +
+			((1u << (shift - 1)) - 1)))), odd), shift);
+
+	const __m128i isDenormal = _mm_cmplt_epi32 (bits,
+		_mm_set1_epi32 (static_cast<int> (SMALL_FLOAT_MIN_NORMAL)));
+	return Select (isDenormal, denormal, normal);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Four lanes of ClampUnsignedSmallFloat.
+*/
+inline __m128i ClampUnsignedSmallFloat (const __m128 value, const int mantissaBits)
+{
+	const float maxValue = BitsToFloat (static_cast<std::uint32_t> (127 + 15) << 23 |
+		(((1u << mantissaBits) - 1) << (23 - mantissaBits)));
+
+	// max returns the second operand for NaN
+	const __m128 clamped = _mm_min_ps (_mm_max_ps (value, _mm_setzero_ps ()),
+		_mm_set1_ps (maxValue));
+	return ToSmallFloat (_mm_castps_si128 (clamped), mantissaBits);
+}
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ConvertFloatToHalf (const float* input, std::uint16_t* output,
+	const std::size_t count)
+{
+	std::size_t i = 0;
+
+#if ANTERU_F16C
+	for (; i + 8 <= count; i += 8) {
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (output + i), _mm256_cvtps_ph (
+			_mm256_loadu_ps (input + i), _MM_FROUND_TO_NEAREST_INT));
+	}
+#elif ANTERU_NEON && (defined(__aarch64__) || defined(_M_ARM64))
+	for (; i + 4 <= count; i += 4) {
+		vst1_u16 (output + i, vreinterpret_u16_f16 (vcvt_f16_f32 (vld1q_f32 (input + i))));
+	}
+#elif ANTERU_SSE2
+	for (; i + 8 <= count; i += 8) {
+		__m128i halves [2];
+		for (int j = 0; j < 2; ++j) {
+			const __m128i bits = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (input + i + j * 4));
+			const __m128i sign = _mm_and_si128 (bits, _mm_set1_epi32 (static_cast<int> (0x80000000u)));
+			const __m128i magnitude = _mm_xor_si128 (bits, sign);
+
+			const __m128i special = Select (
+				_mm_cmpgt_epi32 (magnitude, _mm_set1_epi32 (static_cast<int> (FLOAT_INFINITY))),
+				_mm_set1_epi32 (0x7E00), _mm_set1_epi32 (0x7C00));
+			const __m128i overflow = _mm_cmpgt_epi32 (magnitude,
+				_mm_set1_epi32 (static_cast<int> (HALF_OVERFLOW - 1)));
+			const __m128i result = _mm_or_si128 (Select (overflow, special,
+				ToSmallFloat (magnitude, HALF_MANTISSA_BITS)), _mm_srli_epi32 (sign, 16));
+
+			// Sign extend from 16 bits, so the saturating pack keeps the bits
+			halves [j] = _mm_srai_epi32 (_mm_slli_epi32 (result, 16), 16);
+		}
+
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (output + i),
+			_mm_packs_epi32 (halves [0], halves [1]));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		output [i] = FloatToHalf (input [i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ConvertHalfToFloat (const std::uint16_t* input, float* output,
+	const std::size_t count)
+{
+	std::size_t i = 0;
+
+#if ANTERU_F16C
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps (output + i, _mm256_cvtph_ps (
+			_mm_loadu_si128 (reinterpret_cast<const __m128i*> (input + i))));
+	}
+#elif ANTERU_NEON && (defined(__aarch64__) || defined(_M_ARM64))
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32 (output + i, vcvt_f32_f16 (vreinterpret_f16_u16 (vld1_u16 (input + i))));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		output [i] = HalfToFloat (input [i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PackR11G11B10 (const float* input, std::uint32_t* output,
+	const std::size_t pixelCount)
+{
+	std::size_t i = 0;
+
+#if ANTERU_SSE2
+	for (; i + 4 <= pixelCount; i += 4) {
+		__m128 r = _mm_loadu_ps (input + i * 4);
+		__m128 g = _mm_loadu_ps (input + i * 4 + 4);
+		__m128 b = _mm_loadu_ps (input + i * 4 + 8);
+		__m128 a = _mm_loadu_ps (input + i * 4 + 12);
+		_MM_TRANSPOSE4_PS (r, g, b, a);
+
+		const __m128i packed = _mm_or_si128 (_mm_or_si128 (
+			ClampUnsignedSmallFloat (r, R11_MANTISSA_BITS),
+			_mm_slli_epi32 (ClampUnsignedSmallFloat (g, R11_MANTISSA_BITS), 11)),
+			_mm_slli_epi32 (ClampUnsignedSmallFloat (b, B10_MANTISSA_BITS), 22));
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (output + i), packed);
+	}
+#endif
+
+	for (; i < pixelCount; ++i) {
+		output [i] = PackR11G11B10 (input + i * 4);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PackR9G9B9E5 (const float* input, std::uint32_t* output,
+	const std::size_t pixelCount)
+{
+	std::size_t i = 0;
+
+#if ANTERU_SSE2
+	const __m128 zero = _mm_setzero_ps ();
+	const __m128 maxValue = _mm_set1_ps (RGB9E5_MAX_VALUE);
+	const __m128 half = _mm_set1_ps (0.5f);
+
+	for (; i + 4 <= pixelCount; i += 4) {
+		__m128 r = _mm_loadu_ps (input + i * 4);
+		__m128 g = _mm_loadu_ps (input + i * 4 + 4);
+		__m128 b = _mm_loadu_ps (input + i * 4 + 8);
+		__m128 a = _mm_loadu_ps (input + i * 4 + 12);
+		_MM_TRANSPOSE4_PS (r, g, b, a);
+
+		r = _mm_min_ps (_mm_max_ps (r, zero), maxValue);
+		g = _mm_min_ps (_mm_max_ps (g, zero), maxValue);
+		b = _mm_min_ps (_mm_max_ps (b, zero), maxValue);
+		const __m128 largest = _mm_max_ps (_mm_max_ps (r, g), b);
+
+		// The exponent of the largest component, clamped at -16. The
+		// values are non-negative, so there is no sign bit to mask off
+		__m128i exponent = _mm_sub_epi32 (_mm_srli_epi32 (_mm_castps_si128 (largest), 23),
+			_mm_set1_epi32 (127));
+		const __m128i minExponent = _mm_set1_epi32 (-RGB9E5_EXPONENT_BIAS - 1);
+		exponent = Select (_mm_cmplt_epi32 (exponent, minExponent), minExponent, exponent);
+		exponent = _mm_add_epi32 (exponent, _mm_set1_epi32 (1 + RGB9E5_EXPONENT_BIAS));
+
+		__m128 scale = _mm_castsi128_ps (_mm_slli_epi32 (_mm_sub_epi32 (_mm_set1_epi32 (
+			127 + RGB9E5_EXPONENT_BIAS + RGB9E5_MANTISSA_BITS), exponent), 23));
+		const __m128i roundsUp = _mm_cmpeq_epi32 (
+			_mm_cvttps_epi32 (_mm_add_ps (_mm_mul_ps (largest, scale), half)),
+			_mm_set1_epi32 (1 << RGB9E5_MANTISSA_BITS));
+		scale = _mm_castsi128_ps (Select (roundsUp,
+			_mm_castps_si128 (_mm_mul_ps (scale, half)), _mm_castps_si128 (scale)));
+		exponent = _mm_sub_epi32 (exponent, roundsUp);
+
+		const __m128i rm = _mm_cvttps_epi32 (_mm_add_ps (_mm_mul_ps (r, scale), half));
+		const __m128i gm = _mm_cvttps_epi32 (_mm_add_ps (_mm_mul_ps (g, scale), half));
+		const __m128i bm = _mm_cvttps_epi32 (_mm_add_ps (_mm_mul_ps (b, scale), half));
+
+		const __m128i packed = _mm_or_si128 (_mm_or_si128 (rm,
+			_mm_slli_epi32 (gm, RGB9E5_MANTISSA_BITS)), _mm_or_si128 (
+			_mm_slli_epi32 (bm, 2 * RGB9E5_MANTISSA_BITS), _mm_slli_epi32 (exponent, 27)));
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (output + i), packed);
+	}
+#endif
+
+	for (; i < pixelCount; ++i) {
+		output [i] = PackR9G9B9E5 (input + i * 4);
+	}
+}
+}
@@ -0,0 +1,158 @@
+#include "RenderDevice.h"
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+int GetBytesPerPixel (const PixelFormat format)
+{
+	switch (format) {
+	case PixelFormat::R8G8B8A8_UNorm:
+	case PixelFormat::R8G8B8A8_UNorm_sRGB:
+	case PixelFormat::R32_UInt:
+	case PixelFormat::R11G11B10_Float:
+	case PixelFormat::R9G9B9E5_SharedExp:
+	case PixelFormat::R16G16_UNorm:
+	case PixelFormat::R16G16_SNorm:
+	case PixelFormat::R16G16_Float:
+		return 4;
+	case PixelFormat::R32G32_Float:
+	case PixelFormat::R16G16B16A16_Float:
+	case PixelFormat::R16G16B16A16_UNorm:
+		return 8;
+	case PixelFormat::R32G32B32_Float:
+		return 12;
+	case PixelFormat::R8_UNorm:
+		return 1;
+	case PixelFormat::R8G8_UNorm:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool IsBlockCompressed (const PixelFormat format)
+{
+	switch (format) {
+	case PixelFormat::BC1_UNorm:
+	case PixelFormat::BC1_UNorm_sRGB:
+	case PixelFormat::BC3_UNorm:
+	case PixelFormat::BC3_UNorm_sRGB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int GetRowSize (const PixelFormat format, const int width)
+{
+	switch (format) {
+	case PixelFormat::BC1_UNorm:
+	case PixelFormat::BC1_UNorm_sRGB:
+		return (width + 3) / 4 * 8;
+	case PixelFormat::BC3_UNorm:
+	case PixelFormat::BC3_UNorm_sRGB:
+		return (width + 3) / 4 * 16;
+	default:
+		return width * GetBytesPerPixel (format);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int GetRowCount (const PixelFormat format, const int height)
+{
+	return IsBlockCompressed (format) ? (height + 3) / 4 : height;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const char* GetPixelFormatName (const PixelFormat format)
+{
+	switch (format) {
+	case PixelFormat::R8G8B8A8_UNorm: return "R8G8B8A8_UNorm";
+	case PixelFormat::R8G8B8A8_UNorm_sRGB: return "R8G8B8A8_UNorm_sRGB";
+	case PixelFormat::R32_UInt: return "R32_UInt";
+	case PixelFormat::R32G32_Float: return "R32G32_Float";
+	case PixelFormat::R32G32B32_Float: return "R32G32B32_Float";
+	case PixelFormat::R16G16B16A16_Float: return "R16G16B16A16_Float";
+	case PixelFormat::R11G11B10_Float: return "R11G11B10_Float";
+	case PixelFormat::R9G9B9E5_SharedExp: return "R9G9B9E5_SharedExp";
+	case PixelFormat::R8_UNorm: return "R8_UNorm";
+	case PixelFormat::R8G8_UNorm: return "R8G8_UNorm";
+	case PixelFormat::R16G16B16A16_UNorm: return "R16G16B16A16_UNorm";
+	case PixelFormat::R16G16_UNorm: return "R16G16_UNorm";
+	case PixelFormat::R16G16_SNorm: return "R16G16_SNorm";
+	case PixelFormat::R16G16_Float: return "R16G16_Float";
+	case PixelFormat::BC1_UNorm: return "BC1_UNorm";
+	case PixelFormat::BC1_UNorm_sRGB: return "BC1_UNorm_sRGB";
+	case PixelFormat::BC3_UNorm: return "BC3_UNorm";
+	case PixelFormat::BC3_UNorm_sRGB: return "BC3_UNorm_sRGB";
+	default: return "Unknown";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int GetRootParameterSize (const RootParameter& parameter)
+{
+	switch (parameter.type) {
+	case RootParameterType::DescriptorTable:
+		return 1;
+	case RootParameterType::ConstantBufferView:
+		return 2;
+	case RootParameterType::Constants:
+		return parameter.count;
+	default:
+		return 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int GetRootSignatureSize (const RootSignatureDesc& desc)
+{
+	int size = 0;
+	for (const auto& parameter : desc.parameters) {
+		size += GetRootParameterSize (parameter);
+	}
+
+	return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IResource::~IResource ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IDescriptorHeap::~IDescriptorHeap ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IRootSignature::~IRootSignature ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IPipelineState::~IPipelineState ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ICommandList::~ICommandList ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ICommandQueue::~ICommandQueue ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ISwapChain::~ISwapChain ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IRenderDevice::~IRenderDevice ()
+{
+}
+}
@@ -0,0 +1,242 @@
+#include "RootSignatureBuilder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace anteru {
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+A root parameter in the making, with the bindings which go into it.
+*/
+struct Candidate
+{
+	RootParameter parameter;
+	UpdateFrequency frequency;
+	std::vector<int> bindings;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+bool IsRootConstantCandidate (const ShaderBinding& binding)
+{
+	return binding.type == BindingType::ConstantBuffer &&
+		binding.frequency != UpdateFrequency::Static &&
+		binding.size <= MAX_ROOT_CONSTANT_BUFFER_SIZE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void AddValue (std::vector<std::uint8_t>& output, const std::uint32_t value)
+{
+	for (int i = 0; i < 4; ++i) {
+		output.push_back (static_cast<std::uint8_t> (value >> (i * 8)));
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+RootSignatureLayout BuildRootSignatureLayout (
+	const std::vector<ShaderBinding>& bindings,
+	const std::vector<StaticSampler>& staticSamplers,
+	const int maxSize)
+{
+	const int bindingCount = static_cast<int> (bindings.size ());
+
+	for (const auto& binding : bindings) {
+		if (binding.size <= 0) {
+			throw std::runtime_error ("Invalid shader binding.");
+		}
+	}
+
+	// Textures sorted by frequency, visibility and register, so the ones
+	// which can share a table are next to each other
+	std::vector<int> textures;
+	for (int i = 0; i < bindingCount; ++i) {
+		if (bindings [i].type == BindingType::Texture) {
+			textures.push_back (i);
+		}
+	}
+
+	std::sort (textures.begin (), textures.end (), [&] (const int a, const int b) {
+		const auto& left = bindings [a];
+		const auto& right = bindings [b];
+		if (left.frequency != right.frequency) {
+			return left.frequency < right.frequency;
+		} else if (left.visibility != right.visibility) {
+			return left.visibility < right.visibility;
+		} else {
+			return left.shaderRegister < right.shaderRegister;
+		}
+	});
+
+	std::vector<Candidate> candidates;
+	for (const auto index : textures) {
+		const auto& binding = bindings [index];
+
+		if (! candidates.empty ()) {
+			auto& table = candidates.back ();
+			if (table.frequency == binding.frequency &&
+				table.parameter.visibility == binding.visibility &&
+				table.parameter.shaderRegister + table.parameter.count == binding.shaderRegister) {
+				table.parameter.count += binding.size;
+				table.bindings.push_back (index);
+				continue;
+			}
+		}
+
+		Candidate table;
+		table.parameter = { RootParameterType::DescriptorTable,
+			binding.shaderRegister, binding.size, binding.visibility };
+		table.frequency = binding.frequency;
+		table.bindings.push_back (index);
+		candidates.push_back (table);
+	}
+
+	// All constant buffers start out as root descriptors, which is the
+	// smallest possible layout
+	std::vector<int> rootConstants;
+	for (int i = 0; i < bindingCount; ++i) {
+		const auto& binding = bindings [i];
+		if (binding.type != BindingType::ConstantBuffer) {
+			continue;
+		}
+
+		Candidate rootDescriptor;
+		rootDescriptor.parameter = { RootParameterType::ConstantBufferView,
+			binding.shaderRegister, 0, binding.visibility };
+		rootDescriptor.frequency = binding.frequency;
+		rootDescriptor.bindings.push_back (i);
+		candidates.push_back (rootDescriptor);
+
+		if (IsRootConstantCandidate (binding)) {
+			rootConstants.push_back (static_cast<int> (candidates.size () - 1));
+		}
+	}
+
+	int size = 0;
+	for (const auto& candidate : candidates) {
+		size += GetRootParameterSize (candidate.parameter);
+	}
+
+	if (size > maxSize) {
+		throw std::runtime_error ("Shader bindings don't fit into a root signature.");
+	}
+
+	// Promote to root constants while they fit. Buffers of up to two
+	// values are never larger than a root descriptor, so they go first.
+	// Otherwise a frequently changing buffer benefits most, and for the
+	// same frequency, smaller buffers leave room for more of them
+	std::stable_sort (rootConstants.begin (), rootConstants.end (),
+		[&] (const int a, const int b) {
+		const auto& left = bindings [candidates [a].bindings [0]];
+		const auto& right = bindings [candidates [b].bindings [0]];
+		const bool leftFree = left.size <= 8;
+		const bool rightFree = right.size <= 8;
+		if (leftFree != rightFree) {
+			return leftFree;
+		} else if (left.frequency != right.frequency) {
+			return left.frequency < right.frequency;
+		} else {
+			return left.size < right.size;
+		}
+	});
+
+	for (const auto index : rootConstants) {
+		auto& parameter = candidates [index].parameter;
+		const int count = (bindings [candidates [index].bindings [0]].size + 3) / 4;
+
+		const int newSize = size - GetRootParameterSize (parameter) + count;
+		if (newSize <= maxSize) {
+			parameter.type = RootParameterType::Constants;
+			parameter.count = count;
+			size = newSize;
+		}
+	}
+
+	// Most frequently changing first, otherwise in the order of the first
+	// binding, so the result is stable
+	std::stable_sort (candidates.begin (), candidates.end (),
+		[] (const Candidate& a, const Candidate& b) {
+		if (a.frequency != b.frequency) {
+			return a.frequency < b.frequency;
+		} else {
+			return a.bindings [0] < b.bindings [0];
+		}
+	});
+
+	RootSignatureLayout layout;
+	layout.bindings.resize (bindings.size ());
+	for (std::size_t i = 0; i < candidates.size (); ++i) {
+		const auto& parameter = candidates [i].parameter;
+		layout.desc.parameters.push_back (parameter);
+
+		for (const auto index : candidates [i].bindings) {
+			layout.bindings [index].parameter = static_cast<int> (i);
+			layout.bindings [index].type = parameter.type;
+			layout.bindings [index].tableOffset =
+				parameter.type == RootParameterType::DescriptorTable
+				? bindings [index].shaderRegister - parameter.shaderRegister : 0;
+		}
+	}
+
+	layout.desc.staticSamplers = staticSamplers;
+
+	return layout;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> SerializeRootSignature (const RootSignatureDesc& desc)
+{
+	std::vector<std::uint8_t> result;
+
+	AddValue (result, static_cast<std::uint32_t> (desc.parameters.size ()));
+	for (const auto& parameter : desc.parameters) {
+		AddValue (result, static_cast<std::uint32_t> (parameter.type));
+		AddValue (result, static_cast<std::uint32_t> (parameter.shaderRegister));
+		// The count is ignored for root descriptors
+		AddValue (result, parameter.type == RootParameterType::ConstantBufferView
+			? 0 : static_cast<std::uint32_t> (parameter.count));
+		AddValue (result, static_cast<std::uint32_t> (parameter.visibility));
+	}
+
+	AddValue (result, static_cast<std::uint32_t> (desc.staticSamplers.size ()));
+	for (const auto& sampler : desc.staticSamplers) {
+		AddValue (result, static_cast<std::uint32_t> (sampler.filter));
+		AddValue (result, static_cast<std::uint32_t> (sampler.shaderRegister));
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+RootSignatureCache::RootSignatureCache (IRenderDevice& device)
+	: device_ (device)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+RootSignatureCache::~RootSignatureCache ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+IRootSignature* RootSignatureCache::Get (const RootSignatureDesc& desc)
+{
+	auto key = SerializeRootSignature (desc);
+
+	std::lock_guard<std::mutex> lock (mutex_);
+	auto it = rootSignatures_.find (key);
+	if (it == rootSignatures_.end ()) {
+		it = rootSignatures_.emplace (std::move (key),
+			device_.CreateRootSignature (desc)).first;
+	}
+
+	return it->second.get ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int RootSignatureCache::GetRootSignatureCount () const
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+	return static_cast<int> (rootSignatures_.size ());
+}
+}
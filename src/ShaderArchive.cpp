@@ -0,0 +1,87 @@
+#include "ShaderArchive.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace anteru {
+namespace {
+// Layout written by buildShaderArchive.py, little endian: a header, the
+// entries sorted by key, then the bytecode
+const std::uint32_t ARCHIVE_MAGIC = 0x52415341; // 'ASAR'
+const std::uint32_t ARCHIVE_VERSION = 1;
+
+struct ArchiveHeader
+{
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t count;
+	std::uint32_t reserved;
+};
+
+struct ArchiveEntry
+{
+	std::uint64_t key;
+	std::uint32_t offset;
+	std::uint32_t size;
+};
+
+static_assert (sizeof (ArchiveHeader) == 16, "Unexpected header size");
+static_assert (sizeof (ArchiveEntry) == 16, "Unexpected entry size");
+
+ArchiveEntry ReadEntry (const std::uint8_t* data, const int index)
+{
+	ArchiveEntry entry;
+	std::memcpy (&entry, data + sizeof (ArchiveHeader) +
+		index * sizeof (ArchiveEntry), sizeof (entry));
+	return entry;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ShaderArchive::ShaderArchive (const void* data, const std::size_t size)
+	: data_ (static_cast<const std::uint8_t*> (data))
+	, size_ (size)
+{
+	ArchiveHeader header;
+	if (size < sizeof (header)) {
+		throw std::runtime_error ("Invalid shader archive.");
+	}
+
+	std::memcpy (&header, data_, sizeof (header));
+	if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION ||
+		header.count > (size - sizeof (header)) / sizeof (ArchiveEntry)) {
+		throw std::runtime_error ("Invalid shader archive.");
+	}
+
+	count_ = static_cast<int> (header.count);
+
+	// Validate everything up front so Find can trust the index
+	for (int i = 0; i < count_; ++i) {
+		const auto entry = ReadEntry (data_, i);
+		if (entry.offset > size || entry.size > size - entry.offset ||
+			(i > 0 && ReadEntry (data_, i - 1).key >= entry.key)) {
+			throw std::runtime_error ("Invalid shader archive.");
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ShaderArchive::Shader ShaderArchive::Find (const std::uint64_t key) const
+{
+	int first = 0, last = count_;
+	while (first < last) {
+		const int middle = first + (last - first) / 2;
+		const auto entry = ReadEntry (data_, middle);
+
+		if (entry.key == key) {
+			return { data_ + entry.offset, entry.size };
+		} else if (entry.key < key) {
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+
+	return { nullptr, 0 };
+}
+}
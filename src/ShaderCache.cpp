@@ -0,0 +1,239 @@
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Deflate.h"
+#include "ShaderCompiler.h"
+#include "Trace.h"
+
+namespace anteru {
+namespace {
+// File layout, in native byte order (little endian on all supported
+// platforms): a header, the entries sorted by key, then
+// the bytecode of all entries
+const std::uint32_t CACHE_MAGIC = 0x43485341; // 'ASHC'
+const std::uint32_t CACHE_VERSION = 1;
+
+struct FileHeader
+{
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t entryCount;
+	std::uint32_t reserved;
+};
+
+const std::size_t FILE_ENTRY_SIZE = 32;
+
+static_assert (sizeof (FileHeader) == 16, "Unexpected header size");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ShaderCache::ShaderCache (IShaderCompiler& compiler, const std::string& path)
+	: compiler_ (compiler)
+	, compilerVersion_ (compiler.GetVersion ())
+	, path_ (path)
+{
+	OpenFile ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ShaderCache::~ShaderCache ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ShaderCache::OpenFile ()
+{
+	static_assert (sizeof (Entry) == FILE_ENTRY_SIZE, "Unexpected entry size");
+
+	file_.reset (new MappedFile (path_.c_str ()));
+	fileEntryCount_ = 0;
+
+	if (! file_->IsOpen () || file_->GetSize () < sizeof (FileHeader)) {
+		return;
+	}
+
+	FileHeader header;
+	std::memcpy (&header, file_->GetData (), sizeof (header));
+
+	if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+		header.entryCount > (file_->GetSize () - sizeof (FileHeader)) / FILE_ENTRY_SIZE) {
+		return;
+	}
+
+	fileEntryCount_ = static_cast<int> (header.entryCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Hash128 ShaderCache::GetKey (const ShaderDesc& desc) const
+{
+	HashBuilder builder;
+	builder.Add (compilerVersion_)
+		.Add (compiler_.Preprocess (desc))
+		.Add (desc.entryPoint)
+		.Add (desc.profile)
+		.Add (static_cast<std::uint64_t> (desc.defines.size ()));
+
+	for (const auto& define : desc.defines) {
+		builder.Add (define.name).Add (define.value);
+	}
+
+	return builder.Get ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Binary search in the entry table of the mapped file. Entries which point
+outside of the file or fail their checksum are treated as missing.
+*/
+bool ShaderCache::FindInFile (const Hash128& key,
+	std::vector<std::uint8_t>& bytecode) const
+{
+	const auto data = file_->GetData ();
+	const auto entries = data + sizeof (FileHeader);
+
+	int first = 0;
+	int last = fileEntryCount_;
+	while (first < last) {
+		const int middle = first + (last - first) / 2;
+
+		Entry entry;
+		std::memcpy (&entry, entries + middle * FILE_ENTRY_SIZE, FILE_ENTRY_SIZE);
+
+		if (entry.key < key) {
+			first = middle + 1;
+		} else if (key < entry.key) {
+			last = middle;
+		} else {
+			if (entry.offset > file_->GetSize () ||
+				entry.size > file_->GetSize () - entry.offset ||
+				Crc32 (data + entry.offset, entry.size) != entry.checksum) {
+				return false;
+			}
+
+			bytecode.assign (data + entry.offset, data + entry.offset + entry.size);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> ShaderCache::GetBytecode (const ShaderDesc& desc)
+{
+	const auto key = GetKey (desc);
+
+	std::vector<std::uint8_t> bytecode;
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+
+		const auto added = addedEntries_.find (key);
+		if (added != addedEntries_.end ()) {
+			++hitCount_;
+			return added->second;
+		}
+
+		if (FindInFile (key, bytecode)) {
+			++hitCount_;
+			return bytecode;
+		}
+
+		++missCount_;
+	}
+
+	// Compile without holding the lock, so other shaders can be looked up
+	// or compiled in the meantime
+	{
+		TraceScope scope ("Compile shader");
+		bytecode = compiler_.Compile (desc);
+	}
+
+	std::lock_guard<std::mutex> lock (mutex_);
+	addedEntries_ [key] = bytecode;
+
+	return bytecode;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ShaderCache::Save ()
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+
+	if (addedEntries_.empty ()) {
+		return true;
+	}
+
+	// Merge with the file as it is now, which may contain entries written
+	// by another process since this one was opened
+	OpenFile ();
+
+	std::map<Hash128, std::pair<const std::uint8_t*, std::uint32_t>> entries;
+	const auto data = file_->GetData ();
+	for (int i = 0; i < fileEntryCount_; ++i) {
+		Entry entry;
+		std::memcpy (&entry, data + sizeof (FileHeader) + i * FILE_ENTRY_SIZE,
+			FILE_ENTRY_SIZE);
+
+		// Damaged entries are dropped instead of getting a new checksum
+		if (entry.offset <= file_->GetSize () &&
+			entry.size <= file_->GetSize () - entry.offset &&
+			Crc32 (data + entry.offset, entry.size) == entry.checksum) {
+			entries [entry.key] = std::make_pair (data + entry.offset, entry.size);
+		}
+	}
+
+	for (const auto& added : addedEntries_) {
+		entries [added.first] = std::make_pair (added.second.data (),
+			static_cast<std::uint32_t> (added.second.size ()));
+	}
+
+	const std::size_t tableSize = sizeof (FileHeader) + entries.size () * FILE_ENTRY_SIZE;
+	std::vector<std::uint8_t> output (tableSize);
+
+	const FileHeader header = {
+		CACHE_MAGIC, CACHE_VERSION, static_cast<std::uint32_t> (entries.size ()), 0
+	};
+	std::memcpy (output.data (), &header, sizeof (header));
+
+	// std::map iterates in key order, which is the order FindInFile expects
+	std::size_t index = 0;
+	for (const auto& e : entries) {
+		const Entry entry = {
+			e.first, output.size (), e.second.second,
+			Crc32 (e.second.first, e.second.second)
+		};
+		std::memcpy (output.data () + sizeof (FileHeader) + index * FILE_ENTRY_SIZE,
+			&entry, FILE_ENTRY_SIZE);
+		output.insert (output.end (), e.second.first, e.second.first + e.second.second);
+		++index;
+	}
+
+	// The mapping has to be closed before the file can be replaced on Windows
+	file_.reset ();
+
+	const bool written = WriteFileAtomic (path_.c_str (), output.data (), output.size ());
+	if (written) {
+		addedEntries_.clear ();
+	}
+
+	OpenFile ();
+
+	return written;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int ShaderCache::GetHitCount () const
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+	return hitCount_;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int ShaderCache::GetMissCount () const
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+	return missCount_;
+}
+}
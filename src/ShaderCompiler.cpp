@@ -0,0 +1,78 @@
+#include "ShaderCompiler.h"
+
+#include <algorithm>
+
+namespace anteru {
+///////////////////////////////////////////////////////////////////////////////
+IShaderCompiler::~IShaderCompiler ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::string StubShaderCompiler::GetVersion () const
+{
+	return "stub 1";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::string StubShaderCompiler::Preprocess (const ShaderDesc& desc)
+{
+	std::string result;
+
+	for (const auto& define : desc.defines) {
+		result += "#define ";
+		result += define.name;
+		result += " ";
+		result += define.value ? define.value : "1";
+		result += "\n";
+	}
+
+	// Strip comments, but leave string literals alone
+	const char* p = desc.source;
+	const char* end = desc.source + desc.sourceSize;
+	while (p < end && *p) {
+		if (*p == '"') {
+			const char* literalEnd = p + 1;
+			while (literalEnd < end && *literalEnd != '"' && *literalEnd != '\n') {
+				literalEnd += (*literalEnd == '\\' && literalEnd + 1 < end) ? 2 : 1;
+			}
+
+			literalEnd = std::min (literalEnd + 1, end);
+			result.append (p, literalEnd);
+			p = literalEnd;
+		} else if (p + 1 < end && p [0] == '/' && p [1] == '/') {
+			while (p < end && *p != '\n') {
+				++p;
+			}
+		} else if (p + 1 < end && p [0] == '/' && p [1] == '*') {
+			p += 2;
+			while (p + 1 < end && ! (p [0] == '*' && p [1] == '/')) {
+				++p;
+			}
+
+			p = std::min (p + 2, end);
+			// Like the real preprocessor, a block comment separates tokens
+			result.push_back (' ');
+		} else {
+			result.push_back (*p++);
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> StubShaderCompiler::Compile (const ShaderDesc& desc)
+{
+	++compileCount_;
+
+	std::string bytecode = "STUB";
+	bytecode += desc.entryPoint;
+	bytecode.push_back ('\0');
+	bytecode += desc.profile;
+	bytecode.push_back ('\0');
+	bytecode += Preprocess (desc);
+
+	return std::vector<std::uint8_t> (bytecode.begin (), bytecode.end ());
+}
+}
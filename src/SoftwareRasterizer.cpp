@@ -0,0 +1,806 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Simd.h"
+#include "ThreadPool.h"
+
+namespace anteru {
+namespace {
+const int SUBPIXEL_BITS = 8;
+const int SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+const int HALF_PIXEL = SUBPIXEL_SCALE / 2;
+
+// Triangles are clipped to this many pixels around the viewport, which
+// keeps the fixed point edge setup within 64 bits
+const float GUARD_BAND_PIXELS = 8192.0f;
+// Anything closer to the eye than this is treated as crossing the near plane
+const float MIN_W = 1e-5f;
+
+const std::uint32_t CLEAR_COMMAND = 0x80000000u;
+
+// Up to five clip planes can add one vertex each
+const int MAX_CLIPPED_VERTICES = 8;
+
+// Linear to sRGB conversion goes through a table indexed by the linear
+// value, followed by a correction against the exact rounding thresholds
+const int SRGB_ENCODE_TABLE_SIZE = 4096;
+
+///////////////////////////////////////////////////////////////////////////////
+float SrgbToLinear (const float value)
+{
+	if (value <= 0.04045f) {
+		return value / 12.92f;
+	} else {
+		return std::pow ((value + 0.055f) / 1.055f, 2.4f);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+float LinearToSrgb (const float value)
+{
+	if (value <= 0.0031308f) {
+		return value * 12.92f;
+	} else {
+		return 1.055f * std::pow (value, 1.0f / 2.4f) - 0.055f;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct SrgbTables
+{
+	SrgbTables ()
+	{
+		for (int i = 0; i < 256; ++i) {
+			decode [i] = SrgbToLinear (i / 255.0f);
+			unorm [i] = i / 255.0f;
+		}
+
+		// Linear value at which the 8-bit sRGB code i + 1 becomes the closest
+		for (int i = 0; i < 255; ++i) {
+			thresholds [i] = SrgbToLinear ((i + 0.5f) / 255.0f);
+		}
+		thresholds [255] = 2.0f;
+
+		for (int i = 0; i < SRGB_ENCODE_TABLE_SIZE; ++i) {
+			encode [i] = static_cast<std::uint8_t> (LinearToSrgb (
+				static_cast<float> (i) / (SRGB_ENCODE_TABLE_SIZE - 1)) * 255.0f + 0.5f);
+		}
+	}
+
+	float decode [256];
+	float unorm [256];
+	float thresholds [256];
+	std::uint8_t encode [SRGB_ENCODE_TABLE_SIZE];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+const SrgbTables& GetSrgbTables ()
+{
+	static const SrgbTables tables;
+	return tables;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+float Saturate (const float value)
+{
+	// Also maps NaN to 0
+	return value > 0 ? (value < 1 ? value : 1) : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint8_t EncodeUnorm (const float value)
+{
+	return static_cast<std::uint8_t> (Saturate (value) * 255.0f + 0.5f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint8_t EncodeSrgb (const SrgbTables& tables, const float value)
+{
+	const float v = Saturate (value);
+	int code = tables.encode [static_cast<int> (v * (SRGB_ENCODE_TABLE_SIZE - 1))];
+
+	// The table entry is exact for the start of the bucket, at most one
+	// threshold falls within a bucket
+	while (v >= tables.thresholds [code]) {
+		++code;
+	}
+
+	while (code > 0 && v < tables.thresholds [code - 1]) {
+		--code;
+	}
+
+	return static_cast<std::uint8_t> (code);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FetchTexel (const RasterImage& image, const SrgbTables& tables,
+	const int x, const int y, float* color)
+{
+	const auto texel = image.data + y * image.rowPitch + x * 4;
+	const float* rgb = image.srgb ? tables.decode : tables.unorm;
+
+	color [0] = rgb [texel [0]];
+	color [1] = rgb [texel [1]];
+	color [2] = rgb [texel [2]];
+	color [3] = tables.unorm [texel [3]];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ApplyComponentMapping (const ComponentMapping& mapping, float* color)
+{
+	if (mapping.red == ComponentSource::Red &&
+		mapping.green == ComponentSource::Green &&
+		mapping.blue == ComponentSource::Blue &&
+		mapping.alpha == ComponentSource::Alpha) {
+		return;
+	}
+
+	const float source [6] = { color [0], color [1], color [2], color [3], 0, 1 };
+	color [0] = source [static_cast<int> (mapping.red)];
+	color [1] = source [static_cast<int> (mapping.green)];
+	color [2] = source [static_cast<int> (mapping.blue)];
+	color [3] = source [static_cast<int> (mapping.alpha)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::int64_t FloorDivide (const std::int64_t value, const std::int64_t divisor)
+{
+	return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int PopCount4 (const int mask)
+{
+	return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Coverage of four pixels for one edge, starting with value at the first
+pixel and increasing by step per pixel.
+*/
+int GetEdgeMask (const std::int32_t value, const std::int32_t step)
+{
+#if ANTERU_SSE2
+	const __m128i e = _mm_add_epi32 (_mm_set1_epi32 (value),
+		_mm_setr_epi32 (0, step, 2 * step, 3 * step));
+	return _mm_movemask_ps (_mm_castsi128_ps (
+		_mm_cmpgt_epi32 (e, _mm_set1_epi32 (-1))));
+#elif ANTERU_NEON
+	static const std::int32_t laneIndices [4] = { 0, 1, 2, 3 };
+	const int32x4_t e = vmlaq_n_s32 (vdupq_n_s32 (value),
+		vld1q_s32 (laneIndices), step);
+	static const std::uint32_t laneBits [4] = { 1, 2, 4, 8 };
+	const uint32x4_t inside = vandq_u32 (vcgeq_s32 (e, vdupq_n_s32 (0)),
+		vld1q_u32 (laneBits));
+	const uint32x2_t sum = vpadd_u32 (vget_low_u32 (inside), vget_high_u32 (inside));
+	return static_cast<int> (vget_lane_u32 (vpadd_u32 (sum, sum), 0));
+#else
+	int mask = 0;
+	for (int lane = 0; lane < 4; ++lane) {
+		if (value + lane * step >= 0) {
+			mask |= 1 << lane;
+		}
+	}
+	return mask;
+#endif
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SampleTexture (const RasterImage& texture, const SamplerFilter filter,
+	const float u, const float v, float* color)
+{
+	const auto& tables = GetSrgbTables ();
+
+	// Wrap into [0,1) first, so large coordinates can't overflow the
+	// conversion to integers
+	const float fu = (u - std::floor (u)) * texture.width;
+	const float fv = (v - std::floor (v)) * texture.height;
+
+	if (filter == SamplerFilter::Point) {
+		FetchTexel (texture, tables,
+			std::min (static_cast<int> (fu), texture.width - 1),
+			std::min (static_cast<int> (fv), texture.height - 1), color);
+		ApplyComponentMapping (texture.mapping, color);
+		return;
+	}
+
+	const float x = fu - 0.5f;
+	const float y = fv - 0.5f;
+	const float x0 = std::floor (x);
+	const float y0 = std::floor (y);
+	const float wx = x - x0;
+	const float wy = y - y0;
+
+	// The coordinates are already wrapped, so the footprint can only cross
+	// the left or right border by one texel
+	const int ix = static_cast<int> (x0);
+	const int iy = static_cast<int> (y0);
+	const int left = ix < 0 ? texture.width - 1 : ix;
+	const int right = ix + 1 >= texture.width ? 0 : ix + 1;
+	const int top = iy < 0 ? texture.height - 1 : iy;
+	const int bottom = iy + 1 >= texture.height ? 0 : iy + 1;
+
+	float texels [4][4];
+	FetchTexel (texture, tables, left, top, texels [0]);
+	FetchTexel (texture, tables, right, top, texels [1]);
+	FetchTexel (texture, tables, left, bottom, texels [2]);
+	FetchTexel (texture, tables, right, bottom, texels [3]);
+
+	for (int i = 0; i < 4; ++i) {
+		const float upper = texels [0][i] + (texels [1][i] - texels [0][i]) * wx;
+		const float lower = texels [2][i] + (texels [3][i] - texels [2][i]) * wx;
+		color [i] = upper + (lower - upper) * wy;
+	}
+
+	ApplyComponentMapping (texture.mapping, color);
+}
+
+const int SoftwareRasterizer::TILE_SIZE;
+const int SoftwareRasterizer::BLOCK_SIZE;
+
+///////////////////////////////////////////////////////////////////////////////
+SoftwareRasterizer::SoftwareRasterizer (ThreadPool* threadPool)
+	: threadPool_ (threadPool)
+{
+	target_.data = nullptr;
+	target_.width = 0;
+	target_.height = 0;
+	target_.rowPitch = 0;
+	target_.srgb = false;
+	target_.mapping = IDENTITY_COMPONENT_MAPPING;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SoftwareRasterizer::SetRenderTarget (const RasterImage& target)
+{
+	if (target.data == target_.data && target.width == target_.width &&
+		target.height == target_.height && target.rowPitch == target_.rowPitch &&
+		target.srgb == target_.srgb) {
+		return;
+	}
+
+	Flush ();
+
+	target_ = target;
+	tilesX_ = (target.width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY_ = (target.height + TILE_SIZE - 1) / TILE_SIZE;
+
+	bins_.clear ();
+	bins_.resize (tilesX_ * tilesY_);
+	shadedPixelCounts_.resize (tilesX_ * tilesY_, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SoftwareRasterizer::Clear (const float* color)
+{
+	const auto command = CLEAR_COMMAND |
+		static_cast<std::uint32_t> (clearColors_.size () / 4);
+	clearColors_.insert (clearColors_.end (), color, color + 4);
+
+	for (int i = 0; i < static_cast<int> (bins_.size ()); ++i) {
+		if (bins_ [i].empty ()) {
+			activeTiles_.push_back (i);
+		}
+
+		bins_ [i].push_back (command);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SoftwareRasterizer::DrawTriangles (const RasterState& state,
+	const RasterVertex* vertices, const std::uint32_t* indices, const int indexCount)
+{
+	if (! target_.data) {
+		return;
+	}
+
+	const int stateIndex = static_cast<int> (states_.size ());
+	states_.push_back (state);
+	states_.back ().varyingCount = std::min (state.varyingCount, MAX_VARYINGS);
+
+	for (int i = 0; i + 2 < indexCount; i += 3) {
+		ClipAndSetupTriangle (vertices [indices [i]], vertices [indices [i + 1]],
+			vertices [indices [i + 2]], stateIndex);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Clip against the near plane and the guard band. Most triangles are
+completely inside and go straight to the setup, the rest is clipped as a
+polygon in clip space and split into a fan.
+*/
+void SoftwareRasterizer::ClipAndSetupTriangle (const RasterVertex& v0,
+	const RasterVertex& v1, const RasterVertex& v2, const int state)
+{
+	const auto& viewport = states_ [state].viewport;
+	const int varyingCount = states_ [state].varyingCount;
+
+	// Guard band in normalized device coordinates
+	const float guardBand = std::max (2.0f * GUARD_BAND_PIXELS /
+		std::max (std::max (viewport.width, viewport.height), 1.0f) - 1.0f, 1.0f);
+
+	const auto getDistance = [=] (const RasterVertex& v, const int plane) {
+		const float* p = v.position;
+		switch (plane) {
+		case 0: return p [3] - MIN_W;
+		case 1: return guardBand * p [3] - p [0];
+		case 2: return guardBand * p [3] + p [0];
+		case 3: return guardBand * p [3] - p [1];
+		default: return guardBand * p [3] + p [1];
+		}
+	};
+
+	const RasterVertex* input [3] = { &v0, &v1, &v2 };
+
+	int outside = 0;
+	for (int plane = 0; plane < 5; ++plane) {
+		int count = 0;
+		for (int i = 0; i < 3; ++i) {
+			if (getDistance (*input [i], plane) < 0) {
+				++count;
+			}
+		}
+
+		if (count == 3) {
+			return;
+		}
+
+		outside += count;
+	}
+
+	if (outside == 0) {
+		SetupTriangle (input, state);
+		return;
+	}
+
+	RasterVertex buffers [2][MAX_CLIPPED_VERTICES];
+	int count = 3;
+	for (int i = 0; i < 3; ++i) {
+		buffers [0][i] = *input [i];
+	}
+
+	int current = 0;
+	for (int plane = 0; plane < 5 && count >= 3; ++plane) {
+		const RasterVertex* polygon = buffers [current];
+		RasterVertex* clipped = buffers [1 - current];
+		int clippedCount = 0;
+
+		for (int i = 0; i < count; ++i) {
+			const auto& a = polygon [i];
+			const auto& b = polygon [(i + 1) % count];
+			const float da = getDistance (a, plane);
+			const float db = getDistance (b, plane);
+
+			if (da >= 0) {
+				clipped [clippedCount++] = a;
+			}
+
+			if ((da >= 0) != (db >= 0)) {
+				const float t = da / (da - db);
+				auto& v = clipped [clippedCount++];
+				for (int j = 0; j < 4; ++j) {
+					v.position [j] = a.position [j] + (b.position [j] - a.position [j]) * t;
+				}
+
+				for (int j = 0; j < varyingCount; ++j) {
+					v.varyings [j] = a.varyings [j] + (b.varyings [j] - a.varyings [j]) * t;
+				}
+			}
+		}
+
+		count = clippedCount;
+		current = 1 - current;
+	}
+
+	for (int i = 1; i + 1 < count; ++i) {
+		const RasterVertex* triangle [3] = {
+			&buffers [current][0], &buffers [current][i], &buffers [current][i + 1]
+		};
+		SetupTriangle (triangle, state);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SoftwareRasterizer::SetupTriangle (const RasterVertex* vertices [3],
+	const int state)
+{
+	const auto& rasterState = states_ [state];
+	const auto& viewport = rasterState.viewport;
+
+	std::int64_t x [3], y [3];
+	float invW [3];
+
+	for (int i = 0; i < 3; ++i) {
+		const float* p = vertices [i]->position;
+		invW [i] = 1.0f / p [3];
+
+		const float screenX = (p [0] * invW [i] * 0.5f + 0.5f) * viewport.width + viewport.x;
+		const float screenY = (0.5f - p [1] * invW [i] * 0.5f) * viewport.height + viewport.y;
+
+		x [i] = static_cast<std::int64_t> (std::floor (screenX * SUBPIXEL_SCALE + 0.5f));
+		y [i] = static_cast<std::int64_t> (std::floor (screenY * SUBPIXEL_SCALE + 0.5f));
+	}
+
+	// Clockwise triangles have a positive area as y points down, anything
+	// else is back facing or degenerate
+	const std::int64_t area = (x [1] - x [0]) * (y [2] - y [0])
+		- (x [2] - x [0]) * (y [1] - y [0]);
+	if (area <= 0) {
+		return;
+	}
+
+	Triangle triangle;
+
+	// Pixel (px, py) is covered if its center lies within the bounds
+	const auto minX = std::min ({ x [0], x [1], x [2] });
+	const auto maxX = std::max ({ x [0], x [1], x [2] });
+	const auto minY = std::min ({ y [0], y [1], y [2] });
+	const auto maxY = std::max ({ y [0], y [1], y [2] });
+
+	const auto& scissor = rasterState.scissor;
+	const int viewportMinX = static_cast<int> (std::ceil (viewport.x - 0.5f));
+	const int viewportMaxX = static_cast<int> (std::ceil (viewport.x + viewport.width - 0.5f)) - 1;
+	const int viewportMinY = static_cast<int> (std::ceil (viewport.y - 0.5f));
+	const int viewportMaxY = static_cast<int> (std::ceil (viewport.y + viewport.height - 0.5f)) - 1;
+
+	triangle.minX = static_cast<int> (std::max<std::int64_t> ({
+		-FloorDivide (HALF_PIXEL - minX, SUBPIXEL_SCALE),
+		viewportMinX, scissor.left, 0 }));
+	triangle.maxX = static_cast<int> (std::min<std::int64_t> ({
+		FloorDivide (maxX - HALF_PIXEL, SUBPIXEL_SCALE),
+		viewportMaxX, scissor.right - 1, target_.width - 1 }));
+	triangle.minY = static_cast<int> (std::max<std::int64_t> ({
+		-FloorDivide (HALF_PIXEL - minY, SUBPIXEL_SCALE),
+		viewportMinY, scissor.top, 0 }));
+	triangle.maxY = static_cast<int> (std::min<std::int64_t> ({
+		FloorDivide (maxY - HALF_PIXEL, SUBPIXEL_SCALE),
+		viewportMaxY, scissor.bottom - 1, target_.height - 1 }));
+
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+		return;
+	}
+
+	// Edge i goes from vertex i to vertex i + 1, E (x, y) = a*x + b*y + c is
+	// positive inside. Pixels exactly on an edge belong to the triangle if
+	// the edge is a top or left edge, otherwise the bias excludes them
+	triangle.smallEdges = true;
+	for (int i = 0; i < 3; ++i) {
+		const int j = (i + 1) % 3;
+		triangle.a [i] = y [i] - y [j];
+		triangle.b [i] = x [j] - x [i];
+		triangle.c [i] = -(triangle.a [i] * x [i] + triangle.b [i] * y [i]);
+
+		const bool topLeft = triangle.a [i] > 0 ||
+			(triangle.a [i] == 0 && triangle.b [i] > 0);
+		if (! topLeft) {
+			triangle.c [i] -= 1;
+		}
+
+		// Within a block crossed by the edge, values are bounded by the
+		// change over the block
+		const auto change = (std::abs (triangle.a [i]) + std::abs (triangle.b [i]))
+			* BLOCK_SIZE * SUBPIXEL_SCALE;
+		triangle.smallEdges = triangle.smallEdges && change < (1ll << 31);
+	}
+
+	// Attributes divided by w interpolate linearly in screen space
+	const float x0 = static_cast<float> (x [0]) / SUBPIXEL_SCALE;
+	const float y0 = static_cast<float> (y [0]) / SUBPIXEL_SCALE;
+	const float dx1 = static_cast<float> (x [1] - x [0]) / SUBPIXEL_SCALE;
+	const float dy1 = static_cast<float> (y [1] - y [0]) / SUBPIXEL_SCALE;
+	const float dx2 = static_cast<float> (x [2] - x [0]) / SUBPIXEL_SCALE;
+	const float dy2 = static_cast<float> (y [2] - y [0]) / SUBPIXEL_SCALE;
+	const float invDet = 1.0f / (dx1 * dy2 - dx2 * dy1);
+
+	triangle.x0 = x0;
+	triangle.y0 = y0;
+
+	for (int i = 0; i <= rasterState.varyingCount; ++i) {
+		float f [3];
+		for (int j = 0; j < 3; ++j) {
+			f [j] = (i == 0) ? invW [j] : vertices [j]->varyings [i - 1] * invW [j];
+		}
+
+		triangle.planes [i][0] = f [0];
+		triangle.planes [i][1] = ((f [1] - f [0]) * dy2 - (f [2] - f [0]) * dy1) * invDet;
+		triangle.planes [i][2] = ((f [2] - f [0]) * dx1 - (f [1] - f [0]) * dx2) * invDet;
+	}
+
+	triangle.state = state;
+
+	const auto index = static_cast<std::uint32_t> (triangles_.size ());
+	triangles_.push_back (triangle);
+
+	// Bin into all tiles which are not completely outside of an edge
+	for (int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; ++tileY) {
+		for (int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; ++tileX) {
+			const std::int64_t left = std::max (triangle.minX, tileX * TILE_SIZE);
+			const std::int64_t right = std::min (triangle.maxX, tileX * TILE_SIZE + TILE_SIZE - 1);
+			const std::int64_t top = std::max (triangle.minY, tileY * TILE_SIZE);
+			const std::int64_t bottom = std::min (triangle.maxY, tileY * TILE_SIZE + TILE_SIZE - 1);
+
+			bool covered = true;
+			for (int i = 0; i < 3 && covered; ++i) {
+				const auto px = (triangle.a [i] > 0 ? right : left) * SUBPIXEL_SCALE + HALF_PIXEL;
+				const auto py = (triangle.b [i] > 0 ? bottom : top) * SUBPIXEL_SCALE + HALF_PIXEL;
+				covered = triangle.a [i] * px + triangle.b [i] * py + triangle.c [i] >= 0;
+			}
+
+			if (! covered) {
+				continue;
+			}
+
+			const int tile = tileY * tilesX_ + tileX;
+			if (bins_ [tile].empty ()) {
+				activeTiles_.push_back (tile);
+			}
+
+			bins_ [tile].push_back (index);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SoftwareRasterizer::Flush ()
+{
+	if (activeTiles_.empty ()) {
+		states_.clear ();
+		triangles_.clear ();
+		return;
+	}
+
+	const auto processTile = [this] (const int i) {
+		float pixels [TILE_SIZE * TILE_SIZE * 4];
+		ProcessTile (activeTiles_ [i], pixels);
+	};
+
+	const int tileCount = static_cast<int> (activeTiles_.size ());
+	if (threadPool_) {
+		threadPool_->ParallelFor (tileCount, processTile);
+	} else {
+		for (int i = 0; i < tileCount; ++i) {
+			processTile (i);
+		}
+	}
+
+	for (const auto tile : activeTiles_) {
+		bins_ [tile].clear ();
+	}
+
+	activeTiles_.clear ();
+	states_.clear ();
+	triangles_.clear ();
+	clearColors_.clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t SoftwareRasterizer::GetShadedPixelCount ()
+{
+	std::uint64_t result = 0;
+	for (auto& count : shadedPixelCounts_) {
+		result += count;
+		count = 0;
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Load the tile into linear floating point, run all commands binned to it
+and write it back. Loading is skipped if the tile starts with a clear.
+*/
+void SoftwareRasterizer::ProcessTile (const int tile, float* pixels) const
+{
+	const auto& tables = GetSrgbTables ();
+	const auto& bin = bins_ [tile];
+
+	const int tileX = tile % tilesX_;
+	const int tileY = tile / tilesX_;
+	const int width = std::min (TILE_SIZE, target_.width - tileX * TILE_SIZE);
+	const int height = std::min (TILE_SIZE, target_.height - tileY * TILE_SIZE);
+
+	const auto getRow = [&] (const int y) {
+		return target_.data + (tileY * TILE_SIZE + y) * target_.rowPitch
+			+ tileX * TILE_SIZE * 4;
+	};
+
+	if (! (bin.front () & CLEAR_COMMAND)) {
+		const float* rgb = target_.srgb ? tables.decode : tables.unorm;
+
+		for (int y = 0; y < height; ++y) {
+			const auto source = getRow (y);
+			auto row = pixels + y * TILE_SIZE * 4;
+			for (int x = 0; x < width * 4; x += 4) {
+				row [x + 0] = rgb [source [x + 0]];
+				row [x + 1] = rgb [source [x + 1]];
+				row [x + 2] = rgb [source [x + 2]];
+				row [x + 3] = tables.unorm [source [x + 3]];
+			}
+		}
+	}
+
+	for (const auto command : bin) {
+		if (command & CLEAR_COMMAND) {
+			const float* color = clearColors_.data () + (command & ~CLEAR_COMMAND) * 4;
+			for (int i = 0; i < TILE_SIZE * TILE_SIZE; ++i) {
+				std::copy (color, color + 4, pixels + i * 4);
+			}
+		} else {
+			RasterizeTriangle (triangles_ [command], tileX, tileY, pixels);
+		}
+	}
+
+	for (int y = 0; y < height; ++y) {
+		auto target = getRow (y);
+		const auto row = pixels + y * TILE_SIZE * 4;
+		for (int x = 0; x < width * 4; x += 4) {
+			if (target_.srgb) {
+				target [x + 0] = EncodeSrgb (tables, row [x + 0]);
+				target [x + 1] = EncodeSrgb (tables, row [x + 1]);
+				target [x + 2] = EncodeSrgb (tables, row [x + 2]);
+			} else {
+				target [x + 0] = EncodeUnorm (row [x + 0]);
+				target [x + 1] = EncodeUnorm (row [x + 1]);
+				target [x + 2] = EncodeUnorm (row [x + 2]);
+			}
+			target [x + 3] = EncodeUnorm (row [x + 3]);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Walk the part of the triangle inside the tile in 8x8 blocks. Blocks which
+are completely inside all edges are shaded without any coverage tests,
+blocks crossed by an edge test only the crossing edges, four pixels at a
+time.
+*/
+void SoftwareRasterizer::RasterizeTriangle (const Triangle& t, const int tileX,
+	const int tileY, float* pixels) const
+{
+	const int left = std::max (t.minX, tileX * TILE_SIZE);
+	const int right = std::min (t.maxX, tileX * TILE_SIZE + TILE_SIZE - 1);
+	const int top = std::max (t.minY, tileY * TILE_SIZE);
+	const int bottom = std::min (t.maxY, tileY * TILE_SIZE + TILE_SIZE - 1);
+
+	if (left > right || top > bottom) {
+		return;
+	}
+
+	const auto edgeValue = [&t] (const int edge, const std::int64_t x, const std::int64_t y) {
+		return t.a [edge] * (x * SUBPIXEL_SCALE + HALF_PIXEL)
+			+ t.b [edge] * (y * SUBPIXEL_SCALE + HALF_PIXEL) + t.c [edge];
+	};
+
+	for (int blockY = top & ~(BLOCK_SIZE - 1); blockY <= bottom; blockY += BLOCK_SIZE) {
+		for (int blockX = left & ~(BLOCK_SIZE - 1); blockX <= right; blockX += BLOCK_SIZE) {
+			int crossingEdges = 0;
+			bool outside = false;
+
+			for (int i = 0; i < 3 && ! outside; ++i) {
+				const auto origin = edgeValue (i, blockX, blockY);
+				const auto stepX = t.a [i] * (BLOCK_SIZE - 1) * SUBPIXEL_SCALE;
+				const auto stepY = t.b [i] * (BLOCK_SIZE - 1) * SUBPIXEL_SCALE;
+
+				const auto minValue = origin + std::min<std::int64_t> (stepX, 0)
+					+ std::min<std::int64_t> (stepY, 0);
+				const auto maxValue = origin + std::max<std::int64_t> (stepX, 0)
+					+ std::max<std::int64_t> (stepY, 0);
+
+				if (maxValue < 0) {
+					outside = true;
+				} else if (minValue < 0) {
+					crossingEdges |= 1 << i;
+				}
+			}
+
+			if (outside) {
+				continue;
+			}
+
+			const int startY = std::max (blockY, top);
+			const int endY = std::min (blockY + BLOCK_SIZE - 1, bottom);
+
+			for (int y = startY; y <= endY; ++y) {
+				for (int x = blockX; x < blockX + BLOCK_SIZE; x += 4) {
+					int mask = 0;
+					for (int lane = 0; lane < 4; ++lane) {
+						if (x + lane >= left && x + lane <= right) {
+							mask |= 1 << lane;
+						}
+					}
+
+					for (int i = 0; i < 3 && mask; ++i) {
+						if (! (crossingEdges & (1 << i))) {
+							continue;
+						}
+
+						const auto value = edgeValue (i, x, y);
+
+						if (t.smallEdges) {
+							mask &= GetEdgeMask (static_cast<std::int32_t> (value),
+								static_cast<std::int32_t> (t.a [i] * SUBPIXEL_SCALE));
+						} else {
+							for (int lane = 0; lane < 4; ++lane) {
+								if (value + t.a [i] * SUBPIXEL_SCALE * lane < 0) {
+									mask &= ~(1 << lane);
+								}
+							}
+						}
+					}
+
+					if (mask) {
+						ShadePixels (t, x, y, mask, pixels +
+							((y - tileY * TILE_SIZE) * TILE_SIZE + (x - tileX * TILE_SIZE)) * 4);
+					}
+				}
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Interpolate the varyings for four pixels starting at (x, y), run the pixel
+shader and blend the covered pixels into the tile.
+*/
+void SoftwareRasterizer::ShadePixels (const Triangle& t, const int x, const int y,
+	const int mask, float* pixels) const
+{
+	const auto& state = states_ [t.state];
+
+	const float dy = static_cast<float> (y) + 0.5f - t.y0;
+	float dx [4], w [4];
+	for (int lane = 0; lane < 4; ++lane) {
+		dx [lane] = static_cast<float> (x + lane) + 0.5f - t.x0;
+		w [lane] = 1.0f / (t.planes [0][0] + t.planes [0][1] * dx [lane]
+			+ t.planes [0][2] * dy);
+	}
+
+	float varyings [MAX_VARYINGS * 4];
+	for (int i = 0; i < state.varyingCount; ++i) {
+		const float* plane = t.planes [i + 1];
+		for (int lane = 0; lane < 4; ++lane) {
+			varyings [i * 4 + lane] = (plane [0] + plane [1] * dx [lane]
+				+ plane [2] * dy) * w [lane];
+		}
+	}
+
+	float color [16];
+	state.pixelShader (state.bindings, varyings, color);
+
+	for (int lane = 0; lane < 4; ++lane) {
+		if (! (mask & (1 << lane))) {
+			continue;
+		}
+
+		float* pixel = pixels + lane * 4;
+		const float r = Saturate (color [0 + lane]);
+		const float g = Saturate (color [4 + lane]);
+		const float b = Saturate (color [8 + lane]);
+		const float a = Saturate (color [12 + lane]);
+
+		if (state.blendMode == BlendMode::AlphaBlend) {
+			pixel [0] = r * a + pixel [0] * (1 - a);
+			pixel [1] = g * a + pixel [1] * (1 - a);
+			pixel [2] = b * a + pixel [2] * (1 - a);
+		} else {
+			pixel [0] = r;
+			pixel [1] = g;
+			pixel [2] = b;
+		}
+
+		pixel [3] = a;
+	}
+
+	const int tile = (y / TILE_SIZE) * tilesX_ + x / TILE_SIZE;
+	shadedPixelCounts_ [tile] += PopCount4 (mask);
+}
+}
@@ -0,0 +1,67 @@
+#include "SoftwareShaders.h"
+
+#include <cstring>
+
+namespace anteru {
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+VS_main: decode position and texture coordinate with the scale and offset
+in b1, then scale the position by the first component of b0.
+*/
+void VertexShaderMain (const ShaderBindings& bindings, const float (*inputs) [4],
+	RasterVertex& output)
+{
+	const float scale = bindings.constantBuffers [0][0];
+	const float* positionScale = bindings.constantBuffers [1];
+	const float* positionOffset = bindings.constantBuffers [1] + 4;
+	const float* uvScaleOffset = bindings.constantBuffers [1] + 8;
+
+	for (int i = 0; i < 3; ++i) {
+		output.position [i] = inputs [0][i] * positionScale [i] + positionOffset [i];
+	}
+
+	output.position [0] *= scale;
+	output.position [1] *= scale;
+	output.position [3] = 1;
+
+	output.varyings [0] = inputs [1][0] * uvScaleOffset [0] + uvScaleOffset [2];
+	output.varyings [1] = inputs [1][1] * uvScaleOffset [1] + uvScaleOffset [3];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+PS_main: sample t0 with s0.
+*/
+void PixelShaderMain (const ShaderBindings& bindings, const float* varyings,
+	float* color)
+{
+	for (int lane = 0; lane < 4; ++lane) {
+		float texel [4];
+		SampleTexture (bindings.textures [0], bindings.samplers [0],
+			varyings [0 * 4 + lane], varyings [1 * 4 + lane], texel);
+
+		for (int i = 0; i < 4; ++i) {
+			color [i * 4 + lane] = texel [i];
+		}
+	}
+}
+
+const SoftwareShader SHADERS [] = {
+	{ "VS_main", VertexShaderMain, nullptr, { "POSITION", "TEXCOORD" }, 2, 2 },
+	{ "PS_main", nullptr, PixelShaderMain, {}, 0, 2 }
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const SoftwareShader* FindSoftwareShader (const char* entryPoint)
+{
+	for (const auto& shader : SHADERS) {
+		if (std::strcmp (shader.entryPoint, entryPoint) == 0) {
+			return &shader;
+		}
+	}
+
+	return nullptr;
+}
+}
@@ -0,0 +1,354 @@
+#include "TexturePacking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "BlockCompression.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Utility.h"
+
+namespace anteru {
+namespace {
+const int BLOCK_SIZE = 4;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+If a channel is constant 0 or 255 everywhere, the view can supply it.
+*/
+bool GetConstantSource (const TextureContent& content, const int channel,
+	ComponentSource& source)
+{
+	if (content.minimum [channel] != content.maximum [channel]) {
+		return false;
+	} else if (content.minimum [channel] == 0) {
+		source = ComponentSource::Zero;
+		return true;
+	} else if (content.minimum [channel] == 255) {
+		source = ComponentSource::One;
+		return true;
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void AllocateTexture (PackedTexture& texture, const PixelFormat format)
+{
+	texture.format = format;
+	texture.rowPitch = RoundToNextMultiple (GetRowSize (format, texture.width),
+		TEXTURE_DATA_PITCH_ALIGNMENT);
+	texture.data.assign (static_cast<std::size_t> (texture.rowPitch) *
+		GetRowCount (format, texture.height), 0);
+	texture.packedSize = static_cast<std::size_t> (GetRowSize (format, texture.width)) *
+		GetRowCount (format, texture.height);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Store channels first and second of each pixel, second only if it is not
+negative.
+*/
+void PackChannels (const std::uint8_t* pixels, const int rowPitch,
+	const int first, const int second, PackedTexture& texture)
+{
+	const int channelCount = second < 0 ? 1 : 2;
+
+	for (int y = 0; y < texture.height; ++y) {
+		const auto source = pixels + static_cast<std::size_t> (y) * rowPitch;
+		const auto target = texture.data.data () +
+			static_cast<std::size_t> (y) * texture.rowPitch;
+
+		for (int x = 0; x < texture.width; ++x) {
+			target [channelCount * x] = source [4 * x + first];
+			if (second >= 0) {
+				target [channelCount * x + 1] = source [4 * x + second];
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Compress the image into texture, which must already use a BC format.
+Returns the root mean square error per stored channel.
+*/
+double CompressBlocks (const std::uint8_t* pixels, const int rowPitch,
+	PackedTexture& texture, ThreadPool* threadPool)
+{
+	const bool bc3 = texture.format == PixelFormat::BC3_UNorm ||
+		texture.format == PixelFormat::BC3_UNorm_sRGB;
+	const int blockSize = bc3 ? 16 : 8;
+	const int blocksX = texture.width / BLOCK_SIZE;
+	const int blocksY = texture.height / BLOCK_SIZE;
+
+	// Errors are summed per row of blocks and added up in order afterwards,
+	// so the result does not depend on the thread count
+	std::vector<std::uint64_t> rowErrors (blocksY, 0);
+
+	const auto compressRow = [&] (const int blockY) {
+		std::uint8_t blockPixels [BLOCK_SIZE * BLOCK_SIZE * 4];
+		const auto target = texture.data.data () +
+			static_cast<std::size_t> (blockY) * texture.rowPitch;
+
+		std::uint64_t error = 0;
+		for (int blockX = 0; blockX < blocksX; ++blockX) {
+			for (int y = 0; y < BLOCK_SIZE; ++y) {
+				std::memcpy (blockPixels + y * BLOCK_SIZE * 4,
+					pixels + static_cast<std::size_t> (blockY * BLOCK_SIZE + y) * rowPitch +
+						blockX * BLOCK_SIZE * 4,
+					BLOCK_SIZE * 4);
+			}
+
+			error += bc3
+				? EncodeBc3Block (blockPixels, target + blockX * blockSize)
+				: EncodeBc1Block (blockPixels, target + blockX * blockSize);
+		}
+
+		rowErrors [blockY] = error;
+	};
+
+	if (threadPool) {
+		threadPool->ParallelFor (blocksY, compressRow);
+	} else {
+		for (int y = 0; y < blocksY; ++y) {
+			compressRow (y);
+		}
+	}
+
+	std::uint64_t error = 0;
+	for (const auto rowError : rowErrors) {
+		error += rowError;
+	}
+
+	const int channelCount = bc3 ? 4 : 3;
+	return std::sqrt (static_cast<double> (error) /
+		(static_cast<double> (texture.width) * texture.height * channelCount));
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TextureContent AnalyzeTextureContent (const std::uint8_t* pixels,
+	const int width, const int height, const int rowPitch)
+{
+	std::uint8_t minimum [4] = { 255, 255, 255, 255 };
+	std::uint8_t maximum [4] = { 0, 0, 0, 0 };
+	std::uint32_t colorDifference = 0;
+
+#if ANTERU_SSE2
+	__m128i minimum4 = _mm_set1_epi8 (-1);
+	__m128i maximum4 = _mm_setzero_si128 ();
+	__m128i difference4 = _mm_setzero_si128 ();
+#elif ANTERU_NEON
+	uint8x16_t minimum4 = vdupq_n_u8 (0xFF);
+	uint8x16_t maximum4 = vdupq_n_u8 (0);
+	uint32x4_t difference4 = vdupq_n_u32 (0);
+#endif
+
+	for (int y = 0; y < height; ++y) {
+		const auto row = pixels + static_cast<std::size_t> (y) * rowPitch;
+		int x = 0;
+
+		// Four pixels at a time. Shifting each pixel down by one channel and
+		// comparing puts r ^ g and g ^ b into the lowest two bytes
+#if ANTERU_SSE2
+		for (; x + 4 <= width; x += 4) {
+			const __m128i p = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (row + 4 * x));
+			minimum4 = _mm_min_epu8 (minimum4, p);
+			maximum4 = _mm_max_epu8 (maximum4, p);
+			difference4 = _mm_or_si128 (difference4,
+				_mm_xor_si128 (p, _mm_srli_epi32 (p, 8)));
+		}
+#elif ANTERU_NEON
+		for (; x + 4 <= width; x += 4) {
+			const uint8x16_t p = vld1q_u8 (row + 4 * x);
+			const uint32x4_t p32 = vreinterpretq_u32_u8 (p);
+			minimum4 = vminq_u8 (minimum4, p);
+			maximum4 = vmaxq_u8 (maximum4, p);
+			difference4 = vorrq_u32 (difference4,
+				veorq_u32 (p32, vshrq_n_u32 (p32, 8)));
+		}
+#endif
+
+		for (; x < width; ++x) {
+			const auto pixel = row + 4 * x;
+			for (int c = 0; c < 4; ++c) {
+				minimum [c] = std::min (minimum [c], pixel [c]);
+				maximum [c] = std::max (maximum [c], pixel [c]);
+			}
+
+			colorDifference |= (pixel [0] ^ pixel [1]) | (pixel [1] ^ pixel [2]);
+		}
+	}
+
+#if ANTERU_SSE2 || ANTERU_NEON
+	std::uint8_t minimumLanes [16], maximumLanes [16];
+	std::uint32_t differenceLanes [4];
+#if ANTERU_SSE2
+	_mm_storeu_si128 (reinterpret_cast<__m128i*> (minimumLanes), minimum4);
+	_mm_storeu_si128 (reinterpret_cast<__m128i*> (maximumLanes), maximum4);
+	_mm_storeu_si128 (reinterpret_cast<__m128i*> (differenceLanes), difference4);
+#else
+	vst1q_u8 (minimumLanes, minimum4);
+	vst1q_u8 (maximumLanes, maximum4);
+	vst1q_u32 (differenceLanes, difference4);
+#endif
+
+	for (int i = 0; i < 16; ++i) {
+		minimum [i % 4] = std::min (minimum [i % 4], minimumLanes [i]);
+		maximum [i % 4] = std::max (maximum [i % 4], maximumLanes [i]);
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		colorDifference |= differenceLanes [i] & 0xFFFF;
+	}
+#endif
+
+	TextureContent content;
+	std::memcpy (content.minimum, minimum, sizeof (minimum));
+	std::memcpy (content.maximum, maximum, sizeof (maximum));
+	content.grayscale = colorDifference == 0;
+	return content;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PackedTexture PackTexture (const std::uint8_t* pixels, const int width,
+	const int height, const int rowPitch, const TexturePackingOptions& options,
+	ThreadPool* threadPool)
+{
+	if (width <= 0 || height <= 0) {
+		throw std::runtime_error ("Invalid texture size.");
+	}
+
+	const auto content = AnalyzeTextureContent (pixels, width, height, rowPitch);
+
+	PackedTexture texture;
+	texture.width = width;
+	texture.height = height;
+	texture.mapping = IDENTITY_COMPONENT_MAPPING;
+	texture.originalSize = static_cast<std::size_t> (width) * height * 4;
+
+	ComponentSource blueSource, alphaSource;
+	const bool constantBlue = GetConstantSource (content, 2, blueSource);
+	const bool constantAlpha = GetConstantSource (content, 3, alphaSource);
+
+	if (! options.srgb) {
+		if (content.grayscale && constantAlpha) {
+			AllocateTexture (texture, PixelFormat::R8_UNorm);
+			PackChannels (pixels, rowPitch, 0, -1, texture);
+			texture.mapping = { ComponentSource::Red, ComponentSource::Red,
+				ComponentSource::Red, alphaSource };
+			return texture;
+		} else if (content.grayscale) {
+			AllocateTexture (texture, PixelFormat::R8G8_UNorm);
+			PackChannels (pixels, rowPitch, 0, 3, texture);
+			texture.mapping = { ComponentSource::Red, ComponentSource::Red,
+				ComponentSource::Red, ComponentSource::Green };
+			return texture;
+		} else if (constantBlue && constantAlpha) {
+			AllocateTexture (texture, PixelFormat::R8G8_UNorm);
+			PackChannels (pixels, rowPitch, 0, 1, texture);
+			texture.mapping = { ComponentSource::Red, ComponentSource::Green,
+				blueSource, alphaSource };
+			return texture;
+		}
+	}
+
+	if (options.allowBlockCompression &&
+		width % BLOCK_SIZE == 0 && height % BLOCK_SIZE == 0) {
+		const bool opaque = content.minimum [3] == 255;
+		const PixelFormat format = opaque
+			? (options.srgb ? PixelFormat::BC1_UNorm_sRGB : PixelFormat::BC1_UNorm)
+			: (options.srgb ? PixelFormat::BC3_UNorm_sRGB : PixelFormat::BC3_UNorm);
+
+		AllocateTexture (texture, format);
+		const auto error = CompressBlocks (pixels, rowPitch, texture, threadPool);
+		if (error <= options.maxBlockCompressionError) {
+			return texture;
+		}
+	}
+
+	AllocateTexture (texture, options.srgb
+		? PixelFormat::R8G8B8A8_UNorm_sRGB : PixelFormat::R8G8B8A8_UNorm);
+	for (int y = 0; y < height; ++y) {
+		std::memcpy (texture.data.data () + static_cast<std::size_t> (y) * texture.rowPitch,
+			pixels + static_cast<std::size_t> (y) * rowPitch,
+			static_cast<std::size_t> (width) * 4);
+	}
+
+	return texture;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UnpackTexture (const std::uint8_t* data, const int width,
+	const int height, const int rowPitch, const PixelFormat format,
+	std::uint8_t* pixels)
+{
+	switch (format) {
+	case PixelFormat::R8G8B8A8_UNorm:
+	case PixelFormat::R8G8B8A8_UNorm_sRGB:
+		for (int y = 0; y < height; ++y) {
+			std::memcpy (pixels + static_cast<std::size_t> (y) * width * 4,
+				data + static_cast<std::size_t> (y) * rowPitch,
+				static_cast<std::size_t> (width) * 4);
+		}
+		break;
+
+	case PixelFormat::R8_UNorm:
+	case PixelFormat::R8G8_UNorm:
+		{
+			const int channelCount = GetBytesPerPixel (format);
+			for (int y = 0; y < height; ++y) {
+				const auto source = data + static_cast<std::size_t> (y) * rowPitch;
+				const auto target = pixels + static_cast<std::size_t> (y) * width * 4;
+
+				for (int x = 0; x < width; ++x) {
+					target [4 * x + 0] = source [channelCount * x];
+					target [4 * x + 1] = channelCount > 1 ? source [channelCount * x + 1] : 0;
+					target [4 * x + 2] = 0;
+					target [4 * x + 3] = 255;
+				}
+			}
+		}
+		break;
+
+	case PixelFormat::BC1_UNorm:
+	case PixelFormat::BC1_UNorm_sRGB:
+	case PixelFormat::BC3_UNorm:
+	case PixelFormat::BC3_UNorm_sRGB:
+		{
+			const bool bc3 = format == PixelFormat::BC3_UNorm ||
+				format == PixelFormat::BC3_UNorm_sRGB;
+			const int blockSize = bc3 ? 16 : 8;
+
+			std::uint8_t blockPixels [BLOCK_SIZE * BLOCK_SIZE * 4];
+			for (int blockY = 0; blockY * BLOCK_SIZE < height; ++blockY) {
+				for (int blockX = 0; blockX * BLOCK_SIZE < width; ++blockX) {
+					const auto block = data + static_cast<std::size_t> (blockY) * rowPitch +
+						blockX * blockSize;
+					if (bc3) {
+						DecodeBc3Block (block, blockPixels);
+					} else {
+						DecodeBc1Block (block, blockPixels);
+					}
+
+					// Blocks may extend past the edge of the texture
+					const int columns = std::min (BLOCK_SIZE, width - blockX * BLOCK_SIZE);
+					const int rows = std::min (BLOCK_SIZE, height - blockY * BLOCK_SIZE);
+					for (int y = 0; y < rows; ++y) {
+						std::memcpy (pixels + (static_cast<std::size_t> (blockY * BLOCK_SIZE + y) * width +
+								blockX * BLOCK_SIZE) * 4,
+							blockPixels + y * BLOCK_SIZE * 4, columns * 4);
+					}
+				}
+			}
+		}
+		break;
+
+	default:
+		throw std::runtime_error ("Unsupported texture format.");
+	}
+}
+}
@@ -0,0 +1,198 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#include "Trace.h"
+
+namespace anteru {
+namespace {
+// The pool whose work the current thread is executing. Used to run nested
+// calls inline, which would deadlock otherwise
+thread_local const ThreadPool* currentPool = nullptr;
+
+///////////////////////////////////////////////////////////////////////////////
+class CurrentPoolScope final
+{
+public:
+	explicit CurrentPoolScope (const ThreadPool* pool)
+		: previous_ (currentPool)
+	{
+		currentPool = pool;
+	}
+
+	~CurrentPoolScope ()
+	{
+		currentPool = previous_;
+	}
+
+private:
+	const ThreadPool* previous_;
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ThreadPool::ThreadPool (int threadCount)
+{
+	if (threadCount < 0) {
+		threadCount = std::max (static_cast<int> (
+			std::thread::hardware_concurrency ()) - 1, 0);
+	}
+
+	for (int i = 0; i < threadCount; ++i) {
+		workers_.emplace_back ([this] () { WorkerMain (); });
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ThreadPool::~ThreadPool ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+		shutdown_ = true;
+	}
+
+	wakeWorkers_.notify_all ();
+
+	for (auto& worker : workers_) {
+		worker.join ();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ThreadPool::Execute (Job& job)
+{
+	TraceScope scope ("ParallelFor", "count", job.count);
+
+	for (;;) {
+		const auto index = job.next.fetch_add (1);
+		if (index >= job.count) {
+			break;
+		}
+
+		try {
+			(*job.function) (index);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock (job.errorMutex);
+			if (! job.error) {
+				job.error = std::current_exception ();
+			}
+
+			// Stop handing out indices, the remaining ones are skipped
+			job.next = job.count;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ThreadPool::WorkerMain ()
+{
+	Tracer::SetThreadName ("ThreadPool worker");
+	CurrentPoolScope poolScope (this);
+
+	std::uint64_t seenGeneration = 0;
+
+	for (;;) {
+		Job* job = nullptr;
+
+		{
+			std::unique_lock<std::mutex> lock (mutex_);
+			wakeWorkers_.wait (lock, [&] () {
+				return shutdown_ || ! tasks_.empty () ||
+					(currentJob_ && jobGeneration_ != seenGeneration);
+			});
+
+			if (currentJob_ && jobGeneration_ != seenGeneration) {
+				seenGeneration = jobGeneration_;
+				job = currentJob_;
+				++activeWorkers_;
+			} else if (! tasks_.empty ()) {
+				const auto task = std::move (tasks_.front ());
+				tasks_.pop_front ();
+				lock.unlock ();
+
+				TraceScope scope ("Task");
+				task ();
+				continue;
+			} else {
+				return;
+			}
+		}
+
+		Execute (*job);
+
+		{
+			std::lock_guard<std::mutex> lock (mutex_);
+			--activeWorkers_;
+		}
+
+		jobDone_.notify_all ();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ThreadPool::Enqueue (std::function<void ()> task)
+{
+	if (workers_.empty ()) {
+		task ();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+		tasks_.push_back (std::move (task));
+	}
+
+	wakeWorkers_.notify_one ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ThreadPool::ParallelFor (const int count,
+	const std::function<void (int)>& function)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	if (workers_.empty () || count == 1 || currentPool == this) {
+		for (int i = 0; i < count; ++i) {
+			function (i);
+		}
+
+		return;
+	}
+
+	std::lock_guard<std::mutex> submitLock (submitMutex_);
+	CurrentPoolScope poolScope (this);
+
+	Job job;
+	job.function = &function;
+	job.next = 0;
+	job.count = count;
+
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+		currentJob_ = &job;
+		++jobGeneration_;
+	}
+
+	wakeWorkers_.notify_all ();
+
+	Execute (job);
+
+	// Workers which picked up the job may still hold a pointer to it, so we
+	// have to wait for all of them before the job goes out of scope. All
+	// indices have been handed out at this point, so once no worker is
+	// active, all invocations have finished
+	{
+		std::unique_lock<std::mutex> lock (mutex_);
+		jobDone_.wait (lock, [&] () {
+			return activeWorkers_ == 0;
+		});
+		currentJob_ = nullptr;
+	}
+
+	if (job.error) {
+		std::rethrow_exception (job.error);
+	}
+}
+}
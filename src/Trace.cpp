@@ -0,0 +1,401 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace anteru {
+namespace {
+// Events per thread, must be a power of two. At 64 bytes per event, this is
+// 1 MiB per thread which covers several frames between two flushes
+const std::uint64_t BUFFER_CAPACITY = 16384;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Single producer, single consumer ring. Only the owning thread pushes, only
+the thread holding drainMutex pops.
+*/
+struct TraceBuffer
+{
+	TraceBuffer (const std::uint32_t id)
+		: events (BUFFER_CAPACITY), threadId (id)
+	{
+		writeIndex = 0;
+		readIndex = 0;
+		dropped = 0;
+	}
+
+	void Push (const TraceEvent& event)
+	{
+		const auto write = writeIndex.load (std::memory_order_relaxed);
+		const auto read = readIndex.load (std::memory_order_acquire);
+
+		if (write - read >= BUFFER_CAPACITY) {
+			dropped.fetch_add (1, std::memory_order_relaxed);
+			return;
+		}
+
+		events [write & (BUFFER_CAPACITY - 1)] = event;
+		writeIndex.store (write + 1, std::memory_order_release);
+	}
+
+	void Drain (std::vector<TraceEvent>& output)
+	{
+		auto read = readIndex.load (std::memory_order_relaxed);
+		const auto write = writeIndex.load (std::memory_order_acquire);
+
+		for (; read < write; ++read) {
+			output.push_back (events [read & (BUFFER_CAPACITY - 1)]);
+		}
+
+		readIndex.store (write, std::memory_order_release);
+	}
+
+	std::vector<TraceEvent> events;
+	// Keep what the producer writes and what the consumer writes on
+	// separate cache lines, so a full buffer dropping events does not
+	// disturb the consumer polling readIndex
+	std::atomic<std::uint64_t> writeIndex;
+	std::atomic<std::uint64_t> dropped;
+	char padding [64 - 2 * sizeof (std::atomic<std::uint64_t>)];
+	std::atomic<std::uint64_t> readIndex;
+
+	std::uint32_t threadId;
+	// Protected by TracerState::registryMutex
+	std::string threadName;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct TracerState
+{
+	// Buffers stay alive until the process exits, so events of threads
+	// which have finished can still be flushed
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<TraceBuffer>> buffers;
+
+	std::mutex drainMutex;
+	std::vector<TraceEvent> events;
+
+	std::mutex flusherMutex;
+	std::condition_variable flusherWake;
+	std::thread flusher;
+	bool stopFlusher = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+TracerState& GetState ()
+{
+	static TracerState state;
+	return state;
+}
+
+thread_local TraceBuffer* threadBuffer = nullptr;
+thread_local std::string threadName;
+
+///////////////////////////////////////////////////////////////////////////////
+TraceBuffer* GetThreadBuffer ()
+{
+	if (threadBuffer == nullptr) {
+		auto& state = GetState ();
+		std::lock_guard<std::mutex> lock (state.registryMutex);
+		state.buffers.emplace_back (new TraceBuffer (
+			static_cast<std::uint32_t> (state.buffers.size () + 1)));
+		threadBuffer = state.buffers.back ().get ();
+		threadBuffer->threadName = threadName;
+	}
+
+	return threadBuffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::int64_t GetTimestamp ()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds> (
+		std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PushEvent (const std::int64_t timestamp, const TraceEventType type,
+	const char* name,
+	const char* argName0, const std::int64_t argValue0,
+	const char* argName1, const std::int64_t argValue1)
+{
+	auto buffer = GetThreadBuffer ();
+
+	TraceEvent event;
+	event.name = name;
+	event.argNames [0] = argName0;
+	event.argNames [1] = argName1;
+	event.argValues [0] = argValue0;
+	event.argValues [1] = argValue1;
+	event.timestamp = timestamp;
+	event.threadId = buffer->threadId;
+	event.type = type;
+
+	buffer->Push (event);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrainBuffers (TracerState& state)
+{
+	std::lock_guard<std::mutex> drainLock (state.drainMutex);
+	std::lock_guard<std::mutex> registryLock (state.registryMutex);
+
+	for (auto& buffer : state.buffers) {
+		buffer->Drain (state.events);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FlusherMain (TracerState& state, const std::chrono::milliseconds interval)
+{
+	std::unique_lock<std::mutex> lock (state.flusherMutex);
+	while (! state.stopFlusher) {
+		state.flusherWake.wait_for (lock, interval);
+
+		lock.unlock ();
+		DrainBuffers (state);
+		lock.lock ();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WriteJsonString (std::ostream& output, const char* str)
+{
+	output << '"';
+	for (; *str; ++str) {
+		const char c = *str;
+		if (c == '"' || c == '\\') {
+			output << '\\' << c;
+		} else if (static_cast<unsigned char> (c) < 0x20) {
+			output << ' ';
+		} else {
+			output << c;
+		}
+	}
+	output << '"';
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const char* GetPhase (const TraceEventType type)
+{
+	switch (type) {
+	case TraceEventType::Begin: return "B";
+	case TraceEventType::End: return "E";
+	case TraceEventType::Instant: return "i";
+	case TraceEventType::Counter: return "C";
+	}
+
+	return "i";
+}
+}
+
+std::atomic<bool> Tracer::enabled_ (false);
+
+///////////////////////////////////////////////////////////////////////////////
+void Tracer::Start (const int flushInterval)
+{
+	auto& state = GetState ();
+
+	{
+		std::lock_guard<std::mutex> lock (state.flusherMutex);
+		if (state.flusher.joinable ()) {
+			return;
+		}
+
+		state.stopFlusher = false;
+	}
+
+	if (flushInterval > 0) {
+		state.flusher = std::thread (FlusherMain, std::ref (state),
+			std::chrono::milliseconds (flushInterval));
+	}
+
+	enabled_.store (true, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Tracer::Stop ()
+{
+	enabled_.store (false, std::memory_order_relaxed);
+
+	auto& state = GetState ();
+
+	{
+		std::lock_guard<std::mutex> lock (state.flusherMutex);
+		state.stopFlusher = true;
+	}
+
+	state.flusherWake.notify_all ();
+
+	if (state.flusher.joinable ()) {
+		state.flusher.join ();
+	}
+
+	DrainBuffers (state);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Tracer::Clear ()
+{
+	auto& state = GetState ();
+	DrainBuffers (state);
+
+	std::lock_guard<std::mutex> lock (state.drainMutex);
+	state.events.clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Tracer::SetThreadName (const char* name)
+{
+	// The buffer is only allocated once the thread records an event, so
+	// naming threads which never trace costs no memory
+	threadName = name;
+
+	if (threadBuffer) {
+		auto& state = GetState ();
+		std::lock_guard<std::mutex> lock (state.registryMutex);
+		threadBuffer->threadName = name;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Tracer::RecordImpl (const TraceEventType type, const char* name,
+	const char* argName0, const std::int64_t argValue0,
+	const char* argName1, const std::int64_t argValue1)
+{
+	PushEvent (GetTimestamp (), type, name,
+		argName0, argValue0, argName1, argValue1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Tracer::RecordAtImpl (const std::int64_t timestamp,
+	const TraceEventType type, const char* name)
+{
+	PushEvent (timestamp, type, name, nullptr, 0, nullptr, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Tracer::Flush ()
+{
+	DrainBuffers (GetState ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t Tracer::GetDroppedEventCount ()
+{
+	auto& state = GetState ();
+	std::lock_guard<std::mutex> lock (state.registryMutex);
+
+	std::uint64_t result = 0;
+	for (const auto& buffer : state.buffers) {
+		result += buffer->dropped.load (std::memory_order_relaxed);
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Tracer::WriteChromeTrace (std::ostream& output)
+{
+	auto& state = GetState ();
+	DrainBuffers (state);
+
+	std::lock_guard<std::mutex> drainLock (state.drainMutex);
+
+	output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+	bool first = true;
+	const auto separator = [&] () {
+		if (! first) {
+			output << ",\n";
+		}
+		first = false;
+	};
+
+	{
+		std::lock_guard<std::mutex> registryLock (state.registryMutex);
+		for (const auto& buffer : state.buffers) {
+			if (buffer->threadName.empty ()) {
+				continue;
+			}
+
+			separator ();
+			output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+				<< buffer->threadId << ",\"args\":{\"name\":";
+			WriteJsonString (output, buffer->threadName.c_str ());
+			output << "}}";
+		}
+	}
+
+	// Timestamps are relative to the first event, as the steady clock epoch
+	// is arbitrary and large values lose precision in trace viewers
+	std::int64_t origin = 0;
+	if (! state.events.empty ()) {
+		origin = state.events.front ().timestamp;
+		for (const auto& event : state.events) {
+			origin = std::min (origin, event.timestamp);
+		}
+	}
+
+	for (const auto& event : state.events) {
+		separator ();
+
+		const auto relative = event.timestamp - origin;
+		char timestamp [32];
+		std::snprintf (timestamp, sizeof (timestamp), "%lld.%03lld",
+			static_cast<long long> (relative / 1000),
+			static_cast<long long> (relative % 1000));
+
+		output << "{\"name\":";
+		WriteJsonString (output, event.name);
+		output << ",\"ph\":\"" << GetPhase (event.type) << "\",\"ts\":"
+			<< timestamp << ",\"pid\":1,\"tid\":" << event.threadId;
+
+		if (event.type == TraceEventType::Instant) {
+			output << ",\"s\":\"t\"";
+		}
+
+		if (event.argNames [0] || event.argNames [1]) {
+			output << ",\"args\":{";
+			for (int i = 0; i < 2; ++i) {
+				if (event.argNames [i] == nullptr) {
+					continue;
+				}
+
+				if (i > 0 && event.argNames [0]) {
+					output << ',';
+				}
+
+				WriteJsonString (output, event.argNames [i]);
+				output << ':' << event.argValues [i];
+			}
+			output << '}';
+		}
+
+		output << '}';
+	}
+
+	output << "\n]}\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool Tracer::WriteChromeTrace (const char* filename)
+{
+	std::ofstream output (filename);
+	if (! output) {
+		return false;
+	}
+
+	WriteChromeTrace (output);
+	return static_cast<bool> (output);
+}
+}
@@ -1,6 +1,6 @@
 #include "Utility.h"
 
-#include <stdio.h>
+#include <cstdio>
 
 ///////////////////////////////////////////////////////////////////////////////
 std::vector<std::uint8_t> ReadFile (const char* filename)
@@ -0,0 +1,520 @@
+#include "VertexQuantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include "PixelConversion.h"
+#include "Simd.h"
+
+namespace anteru {
+namespace {
+const float UNORM16_MAX = 65535.0f;
+const float SNORM16_MAX = 32767.0f;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Round to nearest even and clamp, like the SSE2 conversion below.
+*/
+std::uint16_t QuantizeUNorm16 (const float value)
+{
+	const float clamped = std::min (std::max (value, 0.0f), UNORM16_MAX);
+	return static_cast<std::uint16_t> (std::lrint (clamped));
+}
+
+std::int16_t QuantizeSNorm16 (const float value)
+{
+	const float clamped = std::min (std::max (value * SNORM16_MAX, -SNORM16_MAX), SNORM16_MAX);
+	return static_cast<std::int16_t> (std::lrint (clamped));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Per-axis bounds of count values of size components, starting at values
+and stride floats apart. The scale maps [0,1] onto the bounds.
+*/
+void ComputeBounds (const float* values, const std::size_t count,
+	const std::size_t stride, const int size, float* scale, float* offset)
+{
+	for (int i = 0; i < size; ++i) {
+		float minimum = count > 0 ? values [i] : 0;
+		float maximum = minimum;
+
+		for (std::size_t j = 1; j < count; ++j) {
+			minimum = std::min (minimum, values [j * stride + i]);
+			maximum = std::max (maximum, values [j * stride + i]);
+		}
+
+		scale [i] = maximum - minimum;
+		offset [i] = minimum;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Store the positions as UNorm16, with the tangent handedness in w.
+*/
+void QuantizePositions (const std::vector<MeshVertex>& vertices,
+	const float* scale, const float* offset, const bool tangents,
+	std::uint8_t* target, const int stride)
+{
+	float inverseScale [3];
+	for (int i = 0; i < 3; ++i) {
+		inverseScale [i] = scale [i] > 0 ? UNORM16_MAX / scale [i] : 0;
+	}
+
+	const auto count = vertices.size ();
+
+#if ANTERU_SSE2
+	// The fourth lane is cleared by the scale 0, then set to the
+	// handedness
+	const __m128 vectorScale = _mm_setr_ps (inverseScale [0], inverseScale [1],
+		inverseScale [2], 0);
+	const __m128 vectorOffset = _mm_setr_ps (offset [0], offset [1], offset [2], 0);
+	const __m128 zero = _mm_setzero_ps ();
+	const __m128 one = _mm_set1_ps (UNORM16_MAX);
+	// packs_epi32 saturates to signed 16-bit, so the values are moved
+	// into the signed range first and back after packing
+	const __m128i bias = _mm_set1_epi32 (32768);
+	const __m128i flip = _mm_set1_epi16 (static_cast<short> (0x8000));
+
+	for (std::size_t i = 0; i < count; ++i) {
+		const auto& vertex = vertices [i];
+		const float w = (! tangents || vertex.tangent [3] >= 0) ? UNORM16_MAX : 0;
+
+		// position and the first component of the normal
+		__m128 value = _mm_loadu_ps (vertex.position);
+		value = _mm_mul_ps (_mm_sub_ps (value, vectorOffset), vectorScale);
+		value = _mm_add_ps (value, _mm_setr_ps (0, 0, 0, w));
+		value = _mm_min_ps (_mm_max_ps (value, zero), one);
+
+		const __m128i integers = _mm_sub_epi32 (_mm_cvtps_epi32 (value), bias);
+		const __m128i packed = _mm_xor_si128 (_mm_packs_epi32 (integers, integers), flip);
+		_mm_storel_epi64 (reinterpret_cast<__m128i*> (target + i * stride), packed);
+	}
+#else
+	for (std::size_t i = 0; i < count; ++i) {
+		const auto& vertex = vertices [i];
+		std::uint16_t packed [4];
+
+		for (int j = 0; j < 3; ++j) {
+			packed [j] = QuantizeUNorm16 ((vertex.position [j] - offset [j]) * inverseScale [j]);
+		}
+
+		packed [3] = (! tangents || vertex.tangent [3] >= 0) ? 65535 : 0;
+		std::memcpy (target + i * stride, packed, sizeof (packed));
+	}
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Store the normals or tangents, the three floats at byte offset member in
+each vertex, as octahedral SNorm16.
+*/
+void QuantizeDirections (const std::vector<MeshVertex>& vertices,
+	const std::size_t member, std::uint8_t* target, const int stride)
+{
+	const auto count = vertices.size ();
+	std::size_t i = 0;
+
+	auto get = [&] (const std::size_t vertex, const int component) {
+		return reinterpret_cast<const float*> (reinterpret_cast<const std::uint8_t*> (
+			&vertices [vertex]) + member) [component];
+	};
+
+#if ANTERU_SSE2
+	// Four vectors at a time, one per lane
+	const __m128 signMask = _mm_set1_ps (-0.0f);
+	const __m128 one = _mm_set1_ps (1.0f);
+	const __m128 smallest = _mm_set1_ps (1e-30f);
+	const __m128 range = _mm_set1_ps (SNORM16_MAX);
+
+	for (; i + 4 <= count; i += 4) {
+		const __m128 x = _mm_setr_ps (get (i, 0), get (i + 1, 0), get (i + 2, 0), get (i + 3, 0));
+		const __m128 y = _mm_setr_ps (get (i, 1), get (i + 1, 1), get (i + 2, 1), get (i + 3, 1));
+		const __m128 z = _mm_setr_ps (get (i, 2), get (i + 1, 2), get (i + 2, 2), get (i + 3, 2));
+
+		const __m128 sum = _mm_max_ps (_mm_add_ps (_mm_add_ps (
+			_mm_andnot_ps (signMask, x), _mm_andnot_ps (signMask, y)),
+			_mm_andnot_ps (signMask, z)), smallest);
+		const __m128 inverseSum = _mm_div_ps (one, sum);
+		const __m128 u = _mm_mul_ps (x, inverseSum);
+		const __m128 v = _mm_mul_ps (y, inverseSum);
+
+		// Fold the lower hemisphere, keeping the signs of u and v
+		const __m128 foldedU = _mm_or_ps (_mm_sub_ps (one, _mm_andnot_ps (signMask, v)),
+			_mm_and_ps (u, signMask));
+		const __m128 foldedV = _mm_or_ps (_mm_sub_ps (one, _mm_andnot_ps (signMask, u)),
+			_mm_and_ps (v, signMask));
+		const __m128 lower = _mm_cmplt_ps (z, _mm_setzero_ps ());
+		const __m128 encodedU = _mm_or_ps (_mm_and_ps (lower, foldedU), _mm_andnot_ps (lower, u));
+		const __m128 encodedV = _mm_or_ps (_mm_and_ps (lower, foldedV), _mm_andnot_ps (lower, v));
+
+		// The encoded values are within [-1,1], so packing never saturates
+		// beyond the SNorm range. Interleave into u0 v0 u1 v1 ...
+		const __m128i packed = _mm_packs_epi32 (
+			_mm_cvtps_epi32 (_mm_mul_ps (encodedU, range)),
+			_mm_cvtps_epi32 (_mm_mul_ps (encodedV, range)));
+		const __m128i interleaved = _mm_unpacklo_epi16 (packed, _mm_srli_si128 (packed, 8));
+
+		std::uint32_t values [4];
+		_mm_storeu_si128 (reinterpret_cast<__m128i*> (values), interleaved);
+		for (int j = 0; j < 4; ++j) {
+			std::memcpy (target + (i + j) * stride, &values [j], sizeof (values [j]));
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		const float vector [3] = { get (i, 0), get (i, 1), get (i, 2) };
+		float encoded [2];
+		EncodeOctahedral (vector, encoded);
+
+		const std::int16_t packed [2] = {
+			QuantizeSNorm16 (encoded [0]), QuantizeSNorm16 (encoded [1])
+		};
+		std::memcpy (target + i * stride, packed, sizeof (packed));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int FindOffset (const std::vector<InputElement>& layout, const char* semanticName)
+{
+	for (const auto& element : layout) {
+		if (std::strcmp (element.semanticName, semanticName) == 0) {
+			return element.offset;
+		}
+	}
+
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+float GetLength (const float* vector)
+{
+	return std::sqrt (vector [0] * vector [0] + vector [1] * vector [1] +
+		vector [2] * vector [2]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Angle between two unit vectors in degrees. Computed from the length of
+the difference, as the arc cosine is inaccurate for small angles.
+*/
+float GetAngle (const float* a, const float* b)
+{
+	const float difference [3] = { a [0] - b [0], a [1] - b [1], a [2] - b [2] };
+	const float chord = std::min (GetLength (difference) / 2, 1.0f);
+
+	return 2 * std::asin (chord) * 57.29577951f;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void EncodeOctahedral (const float* vector, float* encoded)
+{
+	const float sum = std::max (std::abs (vector [0]) + std::abs (vector [1]) +
+		std::abs (vector [2]), 1e-30f);
+	const float inverseSum = 1 / sum;
+	const float u = vector [0] * inverseSum;
+	const float v = vector [1] * inverseSum;
+
+	if (vector [2] < 0) {
+		encoded [0] = std::copysign (1 - std::abs (v), u);
+		encoded [1] = std::copysign (1 - std::abs (u), v);
+	} else {
+		encoded [0] = u;
+		encoded [1] = v;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DecodeOctahedral (const float* encoded, float* vector)
+{
+	vector [0] = encoded [0];
+	vector [1] = encoded [1];
+	vector [2] = 1 - std::abs (encoded [0]) - std::abs (encoded [1]);
+
+	// Unfold the lower hemisphere
+	const float fold = std::max (-vector [2], 0.0f);
+	vector [0] += vector [0] >= 0 ? -fold : fold;
+	vector [1] += vector [1] >= 0 ? -fold : fold;
+
+	const float length = GetLength (vector);
+	for (int i = 0; i < 3; ++i) {
+		vector [i] /= length;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<InputElement> GetInputLayout (const VertexFormat& format)
+{
+	std::vector<InputElement> layout;
+	int offset = 0;
+
+	if (format.position == PositionEncoding::UNorm16) {
+		layout.push_back ({ "POSITION", 0, PixelFormat::R16G16B16A16_UNorm, offset });
+	} else {
+		layout.push_back ({ "POSITION", 0, PixelFormat::R32G32B32_Float, offset });
+	}
+
+	offset += GetBytesPerPixel (layout.back ().format);
+
+	if (format.normals) {
+		layout.push_back ({ "NORMAL", 0, PixelFormat::R16G16_SNorm, offset });
+		offset += 4;
+	}
+
+	if (format.tangents) {
+		layout.push_back ({ "TANGENT", 0, PixelFormat::R16G16_SNorm, offset });
+		offset += 4;
+	}
+
+	switch (format.uv) {
+	case UvEncoding::Float:
+		layout.push_back ({ "TEXCOORD", 0, PixelFormat::R32G32_Float, offset });
+		break;
+	case UvEncoding::Half:
+		layout.push_back ({ "TEXCOORD", 0, PixelFormat::R16G16_Float, offset });
+		break;
+	case UvEncoding::UNorm16:
+		layout.push_back ({ "TEXCOORD", 0, PixelFormat::R16G16_UNorm, offset });
+		break;
+	}
+
+	return layout;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int GetVertexStride (const VertexFormat& format)
+{
+	const auto layout = GetInputLayout (format);
+	return layout.back ().offset + GetBytesPerPixel (layout.back ().format);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+QuantizedVertices QuantizeVertices (const std::vector<MeshVertex>& vertices,
+	const VertexFormat& format)
+{
+	if (format.tangents && format.position != PositionEncoding::UNorm16) {
+		throw std::runtime_error ("Tangents require UNorm16 positions.");
+	}
+
+	QuantizedVertices result;
+	result.format = format;
+	result.stride = GetVertexStride (format);
+
+	const auto layout = GetInputLayout (format);
+	const int positionOffset = FindOffset (layout, "POSITION");
+	const int normalOffset = FindOffset (layout, "NORMAL");
+	const int tangentOffset = FindOffset (layout, "TANGENT");
+	const int uvOffset = FindOffset (layout, "TEXCOORD");
+
+	const auto count = vertices.size ();
+	const auto stride = result.stride;
+	result.data.assign (count * stride, 0);
+	auto data = result.data.data ();
+
+	const auto vertexFloats = sizeof (MeshVertex) / sizeof (float);
+	const float* first = count > 0 ? vertices [0].position : nullptr;
+
+	if (format.position == PositionEncoding::UNorm16) {
+		ComputeBounds (first, count, vertexFloats, 3,
+			result.positionScale, result.positionOffset);
+		QuantizePositions (vertices, result.positionScale, result.positionOffset,
+			format.tangents, data + positionOffset, stride);
+	} else {
+		for (int i = 0; i < 3; ++i) {
+			result.positionScale [i] = 1;
+			result.positionOffset [i] = 0;
+		}
+
+		for (std::size_t i = 0; i < count; ++i) {
+			std::memcpy (data + i * stride + positionOffset, vertices [i].position,
+				sizeof (MeshVertex::position));
+		}
+	}
+
+	if (format.normals) {
+		QuantizeDirections (vertices, offsetof (MeshVertex, normal),
+			data + normalOffset, stride);
+	}
+
+	if (format.tangents) {
+		QuantizeDirections (vertices, offsetof (MeshVertex, tangent),
+			data + tangentOffset, stride);
+	}
+
+	if (format.uv == UvEncoding::UNorm16) {
+		ComputeBounds (first ? vertices [0].uv : nullptr, count, vertexFloats, 2,
+			result.uvScale, result.uvOffset);
+
+		float inverseScale [2];
+		for (int i = 0; i < 2; ++i) {
+			inverseScale [i] = result.uvScale [i] > 0 ? UNORM16_MAX / result.uvScale [i] : 0;
+		}
+
+		for (std::size_t i = 0; i < count; ++i) {
+			const std::uint16_t packed [2] = {
+				QuantizeUNorm16 ((vertices [i].uv [0] - result.uvOffset [0]) * inverseScale [0]),
+				QuantizeUNorm16 ((vertices [i].uv [1] - result.uvOffset [1]) * inverseScale [1])
+			};
+			std::memcpy (data + i * stride + uvOffset, packed, sizeof (packed));
+		}
+	} else {
+		for (int i = 0; i < 2; ++i) {
+			result.uvScale [i] = 1;
+			result.uvOffset [i] = 0;
+		}
+
+		if (format.uv == UvEncoding::Half) {
+			// Gathered first, so the conversion can use F16C
+			std::vector<float> uvs (count * 2);
+			for (std::size_t i = 0; i < count; ++i) {
+				uvs [i * 2] = vertices [i].uv [0];
+				uvs [i * 2 + 1] = vertices [i].uv [1];
+			}
+
+			std::vector<std::uint16_t> halves (count * 2);
+			ConvertFloatToHalf (uvs.data (), halves.data (), halves.size ());
+
+			for (std::size_t i = 0; i < count; ++i) {
+				std::memcpy (data + i * stride + uvOffset, &halves [i * 2], 4);
+			}
+		} else {
+			for (std::size_t i = 0; i < count; ++i) {
+				std::memcpy (data + i * stride + uvOffset, vertices [i].uv,
+					sizeof (MeshVertex::uv));
+			}
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MeshVertex DecodeVertex (const QuantizedVertices& vertices, const std::size_t index)
+{
+	const auto& format = vertices.format;
+	const auto source = vertices.data.data () + index * vertices.stride;
+	const auto layout = GetInputLayout (format);
+
+	MeshVertex vertex = {};
+	vertex.tangent [3] = 1;
+
+	const auto positionOffset = FindOffset (layout, "POSITION");
+	if (format.position == PositionEncoding::UNorm16) {
+		std::uint16_t packed [4];
+		std::memcpy (packed, source + positionOffset, sizeof (packed));
+
+		for (int i = 0; i < 3; ++i) {
+			vertex.position [i] = packed [i] / UNORM16_MAX *
+				vertices.positionScale [i] + vertices.positionOffset [i];
+		}
+
+		if (format.tangents) {
+			vertex.tangent [3] = packed [3] / UNORM16_MAX * 2 - 1;
+		}
+	} else {
+		std::memcpy (vertex.position, source + positionOffset, sizeof (vertex.position));
+	}
+
+	const struct
+	{
+		bool stored;
+		const char* semanticName;
+		float* target;
+	} directions [2] = {
+		{ format.normals, "NORMAL", vertex.normal },
+		{ format.tangents, "TANGENT", vertex.tangent }
+	};
+
+	for (const auto& direction : directions) {
+		if (! direction.stored) {
+			continue;
+		}
+
+		std::int16_t packed [2];
+		std::memcpy (packed, source + FindOffset (layout, direction.semanticName),
+			sizeof (packed));
+
+		const float encoded [2] = {
+			std::max (packed [0] / SNORM16_MAX, -1.0f),
+			std::max (packed [1] / SNORM16_MAX, -1.0f)
+		};
+		DecodeOctahedral (encoded, direction.target);
+	}
+
+	const auto uvOffset = FindOffset (layout, "TEXCOORD");
+	if (format.uv == UvEncoding::Float) {
+		std::memcpy (vertex.uv, source + uvOffset, sizeof (vertex.uv));
+	} else {
+		std::uint16_t packed [2];
+		std::memcpy (packed, source + uvOffset, sizeof (packed));
+
+		if (format.uv == UvEncoding::Half) {
+			ConvertHalfToFloat (packed, vertex.uv, 2);
+		} else {
+			for (int i = 0; i < 2; ++i) {
+				vertex.uv [i] = packed [i] / UNORM16_MAX *
+					vertices.uvScale [i] + vertices.uvOffset [i];
+			}
+		}
+	}
+
+	return vertex;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+QuantizationError MeasureQuantizationError (const std::vector<MeshVertex>& vertices,
+	const QuantizedVertices& quantized)
+{
+	QuantizationError error = {};
+
+	float scale [3], offset [3];
+	ComputeBounds (vertices.empty () ? nullptr : vertices [0].position,
+		vertices.size (), sizeof (MeshVertex) / sizeof (float), 3, scale, offset);
+	const float diagonal = GetLength (scale);
+	const float inverseDiagonal = diagonal > 0 ? 1 / diagonal : 0;
+
+	double squaredSum = 0;
+	for (std::size_t i = 0; i < vertices.size (); ++i) {
+		const auto& original = vertices [i];
+		const auto decoded = DecodeVertex (quantized, i);
+
+		const float difference [3] = {
+			decoded.position [0] - original.position [0],
+			decoded.position [1] - original.position [1],
+			decoded.position [2] - original.position [2]
+		};
+		const float distance = GetLength (difference) * inverseDiagonal;
+		error.maxPosition = std::max (error.maxPosition, distance);
+		squaredSum += static_cast<double> (distance) * distance;
+
+		for (int j = 0; j < 2; ++j) {
+			error.maxUv = std::max (error.maxUv, std::abs (decoded.uv [j] - original.uv [j]));
+		}
+
+		if (quantized.format.normals) {
+			error.maxNormal = std::max (error.maxNormal,
+				GetAngle (decoded.normal, original.normal));
+		}
+
+		if (quantized.format.tangents) {
+			// A flipped handedness counts as half a turn
+			const bool flipped = (decoded.tangent [3] < 0) != (original.tangent [3] < 0);
+			error.maxTangent = std::max (error.maxTangent,
+				flipped ? 180.0f : GetAngle (decoded.tangent, original.tangent));
+		}
+	}
+
+	if (! vertices.empty ()) {
+		error.rmsPosition = static_cast<float> (std::sqrt (squaredSum / vertices.size ()));
+	}
+
+	return error;
+}
+}
@@ -0,0 +1,300 @@
+#include "WaitableEvent.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "Simd.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+namespace anteru {
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+void CpuRelax ()
+{
+#if ANTERU_SSE2
+	_mm_pause ();
+#elif ANTERU_NEON && (defined(__GNUC__) || defined(__clang__))
+	__asm__ __volatile__ ("yield");
+#else
+	std::this_thread::yield ();
+#endif
+}
+
+#if defined(__linux__)
+///////////////////////////////////////////////////////////////////////////////
+void FutexWait (std::atomic<std::uint32_t>* address, const std::uint32_t expected)
+{
+	syscall (SYS_futex, reinterpret_cast<std::uint32_t*> (address),
+		FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FutexWake (std::atomic<std::uint32_t>* address, const int count)
+{
+	syscall (SYS_futex, reinterpret_cast<std::uint32_t*> (address),
+		FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+#endif
+}
+
+#if defined(_WIN32)
+///////////////////////////////////////////////////////////////////////////////
+WaitableEvent::WaitableEvent ()
+{
+	handle_ = CreateEvent (nullptr, FALSE, FALSE, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaitableEvent::~WaitableEvent ()
+{
+	CloseHandle (handle_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaitableEvent::Signal ()
+{
+	SetEvent (handle_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaitableEvent::Wait ()
+{
+	WaitForSingleObject (handle_, INFINITE);
+}
+#elif defined(__linux__)
+///////////////////////////////////////////////////////////////////////////////
+WaitableEvent::WaitableEvent ()
+	: state_ (0)
+	, waiters_ (0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaitableEvent::~WaitableEvent ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+state_ is 1 while signaled. The waiter count lets Signal skip the system
+call when nobody is sleeping; a waiter registers itself before it checks
+the state, so a concurrent Signal will always see it.
+*/
+void WaitableEvent::Signal ()
+{
+	state_.store (1);
+
+	if (waiters_.load () > 0) {
+		FutexWake (&state_, 1);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaitableEvent::Wait ()
+{
+	std::uint32_t expected = 1;
+	if (state_.compare_exchange_strong (expected, 0)) {
+		return;
+	}
+
+	waiters_.fetch_add (1);
+
+	for (;;) {
+		expected = 1;
+		if (state_.compare_exchange_strong (expected, 0)) {
+			break;
+		}
+
+		// Returns immediately if the state is not 0 any more
+		FutexWait (&state_, 0);
+	}
+
+	waiters_.fetch_sub (1);
+}
+#else
+///////////////////////////////////////////////////////////////////////////////
+WaitableEvent::WaitableEvent ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WaitableEvent::~WaitableEvent ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaitableEvent::Signal ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+		signaled_ = true;
+	}
+
+	condition_.notify_one ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaitableEvent::Wait ()
+{
+	std::unique_lock<std::mutex> lock (mutex_);
+	condition_.wait (lock, [this] () { return signaled_; });
+	signaled_ = false;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+ITimeline::~ITimeline ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+CpuTimeline::CpuTimeline (const std::uint64_t initialValue)
+	: completedValue_ (initialValue)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+CpuTimeline::~CpuTimeline ()
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t CpuTimeline::GetCompletedValue () const
+{
+	return completedValue_.load (std::memory_order_acquire);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void CpuTimeline::SetEventOnCompletion (const std::uint64_t value,
+	WaitableEvent& event)
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+
+	if (completedValue_.load () >= value) {
+		event.Signal ();
+		return;
+	}
+
+	pendingEvents_.push_back ({ value, &event });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void CpuTimeline::CancelEventOnCompletion (WaitableEvent& event)
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+
+	pendingEvents_.erase (std::remove_if (pendingEvents_.begin (), pendingEvents_.end (),
+		[&event] (const PendingEvent& pending) {
+		return pending.event == &event;
+	}), pendingEvents_.end ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void CpuTimeline::Signal (const std::uint64_t value)
+{
+	std::lock_guard<std::mutex> lock (mutex_);
+
+	if (value <= completedValue_.load ()) {
+		return;
+	}
+
+	completedValue_.store (value, std::memory_order_release);
+
+	auto it = std::remove_if (pendingEvents_.begin (), pendingEvents_.end (),
+		[value] (const PendingEvent& pending) {
+		if (pending.value <= value) {
+			pending.event->Signal ();
+			return true;
+		}
+
+		return false;
+	});
+
+	pendingEvents_.erase (it, pendingEvents_.end ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WaitForValue (ITimeline& timeline, const std::uint64_t value,
+	WaitableEvent& event, const WaitStrategy strategy, const int spinCount)
+{
+	const TimelineWait wait = { &timeline, value };
+	WaitForAny (&wait, 1, event, strategy, spinCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+As the timelines only move forward, waiting for each one in turn is the
+same as waiting for all of them at once.
+*/
+void WaitForAll (const TimelineWait* waits, const int count,
+	WaitableEvent& event, const WaitStrategy strategy, const int spinCount)
+{
+	for (int i = 0; i < count; ++i) {
+		WaitForValue (*waits [i].timeline, waits [i].value, event,
+			strategy, spinCount);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int WaitForAny (const TimelineWait* waits, const int count,
+	WaitableEvent& event, const WaitStrategy strategy, const int spinCount)
+{
+	const auto findCompleted = [=] () {
+		for (int i = 0; i < count; ++i) {
+			if (waits [i].timeline->GetCompletedValue () >= waits [i].value) {
+				return i;
+			}
+		}
+
+		return -1;
+	};
+
+	int completed = findCompleted ();
+	if (completed >= 0) {
+		return completed;
+	}
+
+	if (strategy == WaitStrategy::Spin) {
+		while ((completed = findCompleted ()) < 0) {
+			CpuRelax ();
+		}
+
+		return completed;
+	}
+
+	if (strategy == WaitStrategy::SpinThenBlock) {
+		for (int i = 0; i < spinCount; ++i) {
+			CpuRelax ();
+
+			if ((completed = findCompleted ()) >= 0) {
+				return completed;
+			}
+		}
+	}
+
+	for (int i = 0; i < count; ++i) {
+		waits [i].timeline->SetEventOnCompletion (waits [i].value, event);
+	}
+
+	while ((completed = findCompleted ()) < 0) {
+		event.Wait ();
+	}
+
+	// The other timelines would otherwise signal the event later, when the
+	// caller may have destroyed it already
+	for (int i = 0; i < count; ++i) {
+		waits [i].timeline->CancelEventOnCompletion (event);
+	}
+
+	return completed;
+}
+}
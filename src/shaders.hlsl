@@ -1,8 +1,33 @@
+// Permutations, precompiled by tools/buildShaderArchive.py. Every
+// combination of the keywords after the profile is compiled, with the
+// active keywords defined to 1
+//!permutation VS_main vs_5_0
+//!permutation PS_main ps_5_0 ALPHA_TEST GRAYSCALE
+
 cbuffer PerFrameConstants : register (b0)
 {
 	float4 scale;
 }
 
+// Decodes the quantized vertex attributes, see VertexQuantization.h
+cbuffer MeshConstants : register (b1)
+{
+	float4 positionScale;
+	float4 positionOffset;
+	// Scale in xy, offset in zw
+	float4 uvScaleOffset;
+}
+
+// Inverse of EncodeOctahedral in VertexQuantization.cpp, for shaders which
+// read normals or tangents
+float3 DecodeOctahedral (float2 encoded)
+{
+	float3 v = float3 (encoded, 1 - abs (encoded.x) - abs (encoded.y));
+	float fold = saturate (-v.z);
+	v.xy += v.xy >= 0 ? -fold : fold;
+	return normalize (v);
+}
+
 struct VertexShaderOutput
 {
 	float4 position : SV_POSITION;
@@ -15,9 +40,9 @@ VertexShaderOutput VS_main(
 {
 	VertexShaderOutput output;
 
-	output.position = position;
+	output.position = float4 (position.xyz * positionScale.xyz + positionOffset.xyz, 1);
 	output.position.xy *= scale.x;
-	output.uv = uv;
+	output.uv = uv * uvScaleOffset.xy + uvScaleOffset.zw;
 
 	return output;
 }
@@ -28,5 +53,15 @@ SamplerState texureSampler      : register(s0);
 float4 PS_main (float4 position : SV_POSITION,
 				float2 uv : TEXCOORD) : SV_TARGET
 {
-	return anteruTexture.Sample (texureSampler, uv);
+	float4 color = anteruTexture.Sample (texureSampler, uv);
+
+#if ALPHA_TEST
+	clip (color.a - 0.5);
+#endif
+
+#if GRAYSCALE
+	color.rgb = dot (color.rgb, float3 (0.2126, 0.7152, 0.0722));
+#endif
+
+	return color;
 }
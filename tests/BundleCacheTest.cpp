@@ -0,0 +1,185 @@
+#include "Test.h"
+
+#include <vector>
+
+#include "BundleCache.h"
+#include "CountingDevice.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Get the bundle for key and count how often it gets recorded.
+*/
+ICommandList* GetBundle (BundleCache& cache, const std::uint64_t key,
+	const std::vector<const void*>& dependencies, int& recordCount)
+{
+	return cache.Get (key, dependencies, [&recordCount] (ICommandList*) {
+		++recordCount;
+	});
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (BundlesAreReusedWhileNothingChanges)
+{
+	test::CountingDevice device;
+	BundleCache cache (device);
+	const int buffer = 0, pipelineState = 0;
+	int recordCount = 0;
+
+	ICommandList* bundle = nullptr;
+	for (std::uint64_t frame = 1; frame <= 4; ++frame) {
+		cache.BeginFrame (frame, frame - 1);
+
+		const auto current = GetBundle (cache, 1, { &buffer, &pipelineState },
+			recordCount);
+		CHECK (! bundle || current == bundle);
+		bundle = current;
+	}
+
+	CHECK (recordCount == 1);
+	CHECK (cache.GetRecordCount () == 1);
+	CHECK (device.commandListCount == 1);
+
+	// The cache closes the bundle, so it can be executed right away
+	auto commandList = device.CreateCommandList (CommandListType::Direct);
+	commandList->Reset ();
+	commandList->ExecuteBundle (bundle);
+	commandList->Close ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidatedBundlesAreRecordedAgain)
+{
+	test::CountingDevice device;
+	BundleCache cache (device);
+	const int buffer = 0, other = 0;
+	int recordCount = 0;
+
+	cache.BeginFrame (1, 0);
+	const auto first = GetBundle (cache, 1, { &buffer }, recordCount);
+
+	// Unrelated objects don't matter
+	cache.Invalidate (&other);
+	CHECK (GetBundle (cache, 1, { &buffer }, recordCount) == first);
+	CHECK (recordCount == 1);
+
+	cache.Invalidate (&buffer);
+	CHECK (cache.GetBundleCount () == 0);
+
+	GetBundle (cache, 1, { &buffer }, recordCount);
+	CHECK (recordCount == 2);
+	CHECK (device.commandListCount == 2);
+
+	// Once recorded again, the bundle is current until the next change
+	cache.BeginFrame (2, 1);
+	GetBundle (cache, 1, { &buffer }, recordCount);
+	CHECK (recordCount == 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ObjectAtTheAddressOfAnInvalidatedOneIsNotCurrent)
+{
+	test::CountingDevice device;
+	BundleCache cache (device);
+	int recordCount = 0;
+
+	// Like a resource which is destroyed and recreated at the same
+	// address, invalidated in between
+	std::vector<int> storage (1);
+	const void* resource = storage.data ();
+
+	cache.BeginFrame (1, 0);
+	GetBundle (cache, 1, { resource }, recordCount);
+	cache.Invalidate (resource);
+
+	cache.BeginFrame (2, 1);
+	GetBundle (cache, 1, { resource }, recordCount);
+	CHECK (recordCount == 2);
+	CHECK (cache.GetBundleCount () == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ChangedDependenciesAreRecordedAgain)
+{
+	test::CountingDevice device;
+	BundleCache cache (device);
+	const int a = 0, b = 0, c = 0;
+	int recordCount = 0;
+
+	cache.BeginFrame (1, 0);
+	GetBundle (cache, 1, { &a, &b }, recordCount);
+	GetBundle (cache, 1, { &a, &c }, recordCount);
+	CHECK (recordCount == 2);
+
+	// Order matters, as the draws which use them do
+	GetBundle (cache, 1, { &c, &a }, recordCount);
+	CHECK (recordCount == 3);
+
+	GetBundle (cache, 1, { &c, &a, &b }, recordCount);
+	GetBundle (cache, 1, {}, recordCount);
+	CHECK (recordCount == 5);
+
+	// Other keys have their own bundles
+	GetBundle (cache, 2, {}, recordCount);
+	CHECK (recordCount == 6);
+	CHECK (cache.GetBundleCount () == 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ReplacedBundlesLiveUntilTheirFrameCompletes)
+{
+	test::CountingDevice device;
+	BundleCache cache (device);
+	const int buffer = 0;
+	int recordCount = 0;
+
+	// Used by the frames which signal 1 and 2
+	cache.BeginFrame (1, 0);
+	const auto first = GetBundle (cache, 1, { &buffer }, recordCount);
+	cache.BeginFrame (2, 0);
+	CHECK (GetBundle (cache, 1, { &buffer }, recordCount) == first);
+
+	cache.Invalidate (&buffer);
+	cache.BeginFrame (3, 0);
+	GetBundle (cache, 1, { &buffer }, recordCount);
+	CHECK (device.liveCommandListCount == 2);
+
+	// Frame 1 is done, but frame 2 still executes the first bundle
+	cache.BeginFrame (4, 1);
+	CHECK (device.liveCommandListCount == 2);
+
+	cache.BeginFrame (5, 2);
+	CHECK (device.liveCommandListCount == 1);
+	CHECK (cache.GetBundleCount () == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (UnusedBundlesAreRemoved)
+{
+	test::CountingDevice device;
+	BundleCache cache (device, 2);
+	int recordCount = 0;
+
+	cache.BeginFrame (1, 0);
+	GetBundle (cache, 1, {}, recordCount);
+	GetBundle (cache, 2, {}, recordCount);
+
+	// Bundle 2 is used by every frame, bundle 1 only by the first one
+	for (std::uint64_t frame = 2; frame <= 3; ++frame) {
+		cache.BeginFrame (frame, frame - 1);
+		GetBundle (cache, 2, {}, recordCount);
+	}
+	CHECK (cache.GetBundleCount () == 2);
+
+	// Frame 1 completed before, so bundle 1 is destroyed right away
+	cache.BeginFrame (4, 3);
+	CHECK (cache.GetBundleCount () == 1);
+	CHECK (device.liveCommandListCount == 1);
+
+	// Used again, it has to be recorded again
+	GetBundle (cache, 1, {}, recordCount);
+	CHECK (recordCount == 3);
+}
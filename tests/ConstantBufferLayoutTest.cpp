@@ -0,0 +1,152 @@
+#include "Test.h"
+
+#include <cstring>
+#include <vector>
+
+#include "ConstantBufferLayout.h"
+
+using namespace anteru;
+using namespace anteru::hlsl;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+float ReadFloat (const void* data, const std::size_t offset)
+{
+	float result;
+	std::memcpy (&result, static_cast<const std::uint8_t*> (data) + offset,
+		sizeof (result));
+	return result;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ScalarsFillUpTheRegisterOfAVector)
+{
+	using Layout = ConstantBufferLayout<float3, float>;
+	CHECK (Layout::GetOffset (1) == 12);
+	CHECK (Layout::SIZE == 16);
+
+	using Scalars = ConstantBufferLayout<float, std::uint32_t, std::int32_t, float>;
+	CHECK (Scalars::GetOffset (1) == 4);
+	CHECK (Scalars::GetOffset (2) == 8);
+	CHECK (Scalars::GetOffset (3) == 12);
+	CHECK (Scalars::SIZE == 16);
+
+	// A fifth scalar starts the next register, which pads the buffer
+	using Five = ConstantBufferLayout<float4, float>;
+	CHECK (Five::GetOffset (1) == 16);
+	CHECK (Five::SIZE == 32);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FieldsDoNotStraddleRegisters)
+{
+	using Float3Float2 = ConstantBufferLayout<float3, float2>;
+	CHECK (Float3Float2::GetOffset (1) == 16);
+	CHECK (Float3Float2::SIZE == 32);
+
+	using Float2Float3 = ConstantBufferLayout<float2, float3>;
+	CHECK (Float2Float3::GetOffset (1) == 16);
+
+	using FloatFloat4 = ConstantBufferLayout<float, float4>;
+	CHECK (FloatFloat4::GetOffset (1) == 16);
+
+	// Exactly filling the register is fine
+	using Float2Float2 = ConstantBufferLayout<float2, float2>;
+	CHECK (Float2Float2::GetOffset (1) == 8);
+	CHECK (Float2Float2::SIZE == 16);
+
+	using FloatFloat3 = ConstantBufferLayout<float, float3>;
+	CHECK (FloatFloat3::GetOffset (1) == 4);
+	CHECK (FloatFloat3::SIZE == 16);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ArrayElementsArePaddedToRegisters)
+{
+	// The array starts a new register even though the float would fit,
+	// and the last element is not padded, so the float after it packs
+	using Layout = ConstantBufferLayout<float, Array<float, 4>, float>;
+	CHECK (Layout::GetOffset (1) == 16);
+	CHECK (Layout::GetSize<1> () == 3 * 16 + 4);
+	CHECK (Layout::GetOffset (2) == 68);
+	CHECK (Layout::SIZE == 80);
+
+	using Float2Array = ConstantBufferLayout<Array<float2, 2>, float2, float3>;
+	CHECK (Float2Array::GetOffset (1) == 24);
+	CHECK (Float2Array::GetOffset (2) == 32);
+	CHECK (Float2Array::SIZE == 48);
+
+	// Elements which fill a register need no padding
+	using Float4Array = ConstantBufferLayout<Array<float4, 3>, float>;
+	CHECK (Float4Array::GetOffset (1) == 48);
+	CHECK (Float4Array::SIZE == 64);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (MatricesUseOneRegisterPerColumn)
+{
+	using ColumnMajor = ConstantBufferLayout<float, float3x4, float>;
+	CHECK (ColumnMajor::GetOffset (1) == 16);
+	CHECK (ColumnMajor::GetSize<1> () == 3 * 16 + 12);
+	CHECK (ColumnMajor::GetOffset (2) == 76);
+
+	using RowMajor = ConstantBufferLayout<Matrix<float, 3, 4, true>, float>;
+	CHECK (RowMajor::GetSize<0> () == 2 * 16 + 16);
+	CHECK (RowMajor::GetOffset (1) == 48);
+	CHECK (RowMajor::SIZE == 64);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (WriterPlacesFieldsAndZeroesThePadding)
+{
+	using Layout = ConstantBufferLayout<float3, Array<float, 2>, Matrix<float, 2, 2>>;
+	ConstantBufferWriter<Layout> writer;
+
+	writer.Set<0> ({ { 1, 2, 3 } });
+	writer.Set<1> ({ { 4, 5 } });
+	writer.Set<2> ({ { { 6, 7 }, { 8, 9 } } });
+
+	const auto data = writer.GetData ();
+	CHECK (ReadFloat (data, 0) == 1);
+	CHECK (ReadFloat (data, 8) == 3);
+	CHECK (ReadFloat (data, 12) == 0);
+	CHECK (ReadFloat (data, 16) == 4);
+	CHECK (ReadFloat (data, 20) == 0);
+	CHECK (ReadFloat (data, 32) == 5);
+
+	// Column major, so the first register holds the first column
+	CHECK (Layout::GetOffset (2) == 48);
+	CHECK (ReadFloat (data, 48) == 6);
+	CHECK (ReadFloat (data, 52) == 8);
+	CHECK (ReadFloat (data, 56) == 0);
+	CHECK (ReadFloat (data, 64) == 7);
+	CHECK (ReadFloat (data, 68) == 9);
+	CHECK (ReadFloat (data, 76) == 0);
+	CHECK (Layout::SIZE == 80);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (WriteToCopiesToAlignedAndUnalignedMemory)
+{
+	using Layout = ConstantBufferLayout<float4, float4, float3>;
+	ConstantBufferWriter<Layout> writer;
+	writer.Set<0> ({ { 1, 2, 3, 4 } });
+	writer.Set<1> ({ { 5, 6, 7, 8 } });
+	writer.Set<2> ({ { 9, 10, 11 } });
+
+	// Unaligned destinations can't use streaming stores
+	for (const std::size_t offset : { 0, 4 }) {
+		alignas (16) std::uint8_t destination [Layout::SIZE + 32];
+		std::memset (destination, 0xFF, sizeof (destination));
+
+		writer.WriteTo (destination + offset);
+		FlushConstantBufferWrites ();
+
+		CHECK (std::memcmp (destination + offset, writer.GetData (), Layout::SIZE) == 0);
+		CHECK (destination [offset + Layout::SIZE] == 0xFF);
+		if (offset > 0) {
+			CHECK (destination [offset - 1] == 0xFF);
+		}
+	}
+}
@@ -0,0 +1,255 @@
+#include "CountingDevice.h"
+
+#include "GpuProfiler.h"
+#include "NullDevice.h"
+#include "ShaderCompiler.h"
+
+namespace anteru {
+namespace test {
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Forwards to a command list of the null device, and keeps the number of
+live command lists of the device up to date.
+*/
+class CountingCommandList final : public ICommandList
+{
+public:
+	CountingCommandList (std::unique_ptr<ICommandList> commandList,
+		std::atomic<int>& liveCount)
+		: commandList_ (std::move (commandList))
+		, liveCount_ (liveCount)
+	{
+		++liveCount_;
+	}
+
+	~CountingCommandList ()
+	{
+		--liveCount_;
+	}
+
+	void Reset () override
+	{
+		commandList_->Reset ();
+	}
+
+	void Close () override
+	{
+		commandList_->Close ();
+	}
+
+	void ResourceBarrier (const ResourceTransition* transitions,
+		const int count) override
+	{
+		commandList_->ResourceBarrier (transitions, count);
+	}
+
+	void CopyBufferRegion (IResource* destination,
+		const std::uint64_t destinationOffset,
+		IResource* source, const std::uint64_t sourceOffset,
+		const std::uint64_t size) override
+	{
+		commandList_->CopyBufferRegion (destination, destinationOffset,
+			source, sourceOffset, size);
+	}
+
+	void CopyBufferToTexture (IResource* destination,
+		IResource* source, const std::uint64_t sourceOffset,
+		const int rowPitch) override
+	{
+		commandList_->CopyBufferToTexture (destination, source, sourceOffset,
+			rowPitch);
+	}
+
+	void CopyTextureToBuffer (IResource* destination,
+		const std::uint64_t destinationOffset, IResource* source,
+		const int rowPitch) override
+	{
+		commandList_->CopyTextureToBuffer (destination, destinationOffset,
+			source, rowPitch);
+	}
+
+	void SetRenderTarget (IResource* renderTarget) override
+	{
+		commandList_->SetRenderTarget (renderTarget);
+	}
+
+	void ClearRenderTarget (IResource* renderTarget,
+		const float* color) override
+	{
+		commandList_->ClearRenderTarget (renderTarget, color);
+	}
+
+	void SetViewport (const Viewport& viewport) override
+	{
+		commandList_->SetViewport (viewport);
+	}
+
+	void SetScissorRect (const ScissorRect& rect) override
+	{
+		commandList_->SetScissorRect (rect);
+	}
+
+	void SetDescriptorHeap (IDescriptorHeap* heap) override
+	{
+		commandList_->SetDescriptorHeap (heap);
+	}
+
+	void SetGraphicsRootSignature (IRootSignature* rootSignature) override
+	{
+		commandList_->SetGraphicsRootSignature (rootSignature);
+	}
+
+	void SetPipelineState (IPipelineState* pipelineState) override
+	{
+		commandList_->SetPipelineState (pipelineState);
+	}
+
+	void SetGraphicsRootConstantBufferView (const int parameter,
+		const std::uint64_t gpuAddress) override
+	{
+		commandList_->SetGraphicsRootConstantBufferView (parameter, gpuAddress);
+	}
+
+	void SetGraphicsRootDescriptorTable (const int parameter,
+		const GpuDescriptorHandle handle) override
+	{
+		commandList_->SetGraphicsRootDescriptorTable (parameter, handle);
+	}
+
+	void SetGraphicsRoot32BitConstants (const int parameter,
+		const int count, const void* data, const int offset) override
+	{
+		commandList_->SetGraphicsRoot32BitConstants (parameter, count, data,
+			offset);
+	}
+
+	void SetVertexBuffer (const VertexBufferView& view) override
+	{
+		commandList_->SetVertexBuffer (view);
+	}
+
+	void SetIndexBuffer (const IndexBufferView& view) override
+	{
+		commandList_->SetIndexBuffer (view);
+	}
+
+	void DrawIndexedInstanced (const int indexCountPerInstance,
+		const int instanceCount, const int startIndex,
+		const int baseVertex, const int startInstance) override
+	{
+		commandList_->DrawIndexedInstanced (indexCountPerInstance,
+			instanceCount, startIndex, baseVertex, startInstance);
+	}
+
+	// The null device only executes its own bundles
+	void ExecuteBundle (ICommandList* bundle) override
+	{
+		commandList_->ExecuteBundle (
+			static_cast<CountingCommandList*> (bundle)->commandList_.get ());
+	}
+
+private:
+	std::unique_ptr<ICommandList> commandList_;
+	std::atomic<int>& liveCount_;
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+CountingDevice::CountingDevice ()
+	: device_ (CreateNullDevice ())
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ICommandQueue* CountingDevice::GetQueue ()
+{
+	return device_->GetQueue ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<ISwapChain> CountingDevice::CreateSwapChain (const int width,
+	const int height, const int bufferCount)
+{
+	return device_->CreateSwapChain (width, height, bufferCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IFence> CountingDevice::CreateFence (const std::uint64_t initialValue)
+{
+	return device_->CreateFence (initialValue);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<ICommandList> CountingDevice::CreateCommandList (
+	const CommandListType type)
+{
+	++commandListCount;
+
+	return std::unique_ptr<ICommandList> (new CountingCommandList (
+		device_->CreateCommandList (type), liveCommandListCount));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IResource> CountingDevice::CreateBuffer (const std::size_t size,
+	const HeapType heapType, const ResourceState initialState)
+{
+	return device_->CreateBuffer (size, heapType, initialState);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IResource> CountingDevice::CreateTexture2D (const int width,
+	const int height, const PixelFormat format,
+	const ResourceState initialState, const bool renderTarget)
+{
+	return device_->CreateTexture2D (width, height, format, initialState,
+		renderTarget);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IDescriptorHeap> CountingDevice::CreateDescriptorHeap (
+	const int descriptorCount)
+{
+	return device_->CreateDescriptorHeap (descriptorCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IRootSignature> CountingDevice::CreateRootSignature (
+	const RootSignatureDesc& desc)
+{
+	return device_->CreateRootSignature (desc);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IPipelineState> CountingDevice::CreatePipelineState (
+	const PipelineStateDesc& desc)
+{
+	++pipelineStateCount;
+
+	if (onCreatePipelineState) {
+		onCreatePipelineState (desc);
+	}
+
+	return device_->CreatePipelineState (desc);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IShaderCompiler> CountingDevice::CreateShaderCompiler ()
+{
+	return device_->CreateShaderCompiler ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::string CountingDevice::GetAdapterIdentity () const
+{
+	return device_->GetAdapterIdentity ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IGpuTimestampBackend> CountingDevice::CreateTimestampBackend (
+	const std::vector<ICommandList*>& commandLists, const int queriesPerSlot)
+{
+	return device_->CreateTimestampBackend (commandLists, queriesPerSlot);
+}
+}
+}
@@ -0,0 +1,62 @@
+#ifndef ANTERU_D3D12_SAMPLE_COUNTINGDEVICE_H_
+#define ANTERU_D3D12_SAMPLE_COUNTINGDEVICE_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "RenderDevice.h"
+
+namespace anteru {
+namespace test {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Device for tests which forwards everything to a null device and counts the
+pipeline states and command lists it creates. onCreatePipelineState runs
+before the null device is called, so a test can block or fail the
+creation from it. Command lists are counted until they are destroyed, so
+they must not outlive the device. They wrap the ones of the null device,
+which means they can be executed as bundles, but not submitted to the
+queue.
+*/
+class CountingDevice final : public IRenderDevice
+{
+public:
+	CountingDevice ();
+
+	ICommandQueue* GetQueue () override;
+	std::unique_ptr<ISwapChain> CreateSwapChain (const int width,
+		const int height, const int bufferCount) override;
+	std::unique_ptr<IFence> CreateFence (const std::uint64_t initialValue) override;
+	std::unique_ptr<ICommandList> CreateCommandList (
+		const CommandListType type) override;
+	std::unique_ptr<IResource> CreateBuffer (const std::size_t size,
+		const HeapType heapType, const ResourceState initialState) override;
+	std::unique_ptr<IResource> CreateTexture2D (const int width,
+		const int height, const PixelFormat format,
+		const ResourceState initialState, const bool renderTarget) override;
+	std::unique_ptr<IDescriptorHeap> CreateDescriptorHeap (
+		const int descriptorCount) override;
+	std::unique_ptr<IRootSignature> CreateRootSignature (
+		const RootSignatureDesc& desc) override;
+	std::unique_ptr<IPipelineState> CreatePipelineState (
+		const PipelineStateDesc& desc) override;
+	std::unique_ptr<IShaderCompiler> CreateShaderCompiler () override;
+	std::string GetAdapterIdentity () const override;
+	std::unique_ptr<IGpuTimestampBackend> CreateTimestampBackend (
+		const std::vector<ICommandList*>& commandLists,
+		const int queriesPerSlot) override;
+
+	std::atomic<int> pipelineStateCount { 0 };
+	std::function<void (const PipelineStateDesc&)> onCreatePipelineState;
+
+	std::atomic<int> commandListCount { 0 };
+	std::atomic<int> liveCommandListCount { 0 };
+
+private:
+	std::unique_ptr<IRenderDevice> device_;
+};
+}
+}
+
+#endif
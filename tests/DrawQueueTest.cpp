@@ -0,0 +1,179 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "DrawQueue.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+void CheckRadixSort (const std::vector<std::uint64_t>& input, ThreadPool* threadPool)
+{
+	const auto count = input.size ();
+
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> expected;
+	for (std::size_t i = 0; i < count; ++i) {
+		expected.emplace_back (input [i], static_cast<std::uint32_t> (i));
+	}
+	std::stable_sort (expected.begin (), expected.end (),
+		[] (const std::pair<std::uint64_t, std::uint32_t>& a,
+			const std::pair<std::uint64_t, std::uint32_t>& b) {
+		return a.first < b.first;
+	});
+
+	auto keys = input;
+	std::vector<std::uint32_t> values (count);
+	for (std::size_t i = 0; i < count; ++i) {
+		values [i] = static_cast<std::uint32_t> (i);
+	}
+	std::vector<std::uint64_t> scratchKeys (count);
+	std::vector<std::uint32_t> scratchValues (count);
+
+	RadixSort (keys.data (), values.data (), scratchKeys.data (),
+		scratchValues.data (), count, threadPool);
+
+	bool matches = true;
+	for (std::size_t i = 0; i < count; ++i) {
+		matches = matches && keys [i] == expected [i].first &&
+			values [i] == expected [i].second;
+	}
+	CHECK (matches);
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (PackRoundTripsFields)
+{
+	const auto key = DrawKey::Pack (3, 17, 513, 99999, 0.25f);
+
+	CHECK (DrawKey::GetLayer (key) == 3);
+	CHECK (DrawKey::GetRootSignature (key) == 17);
+	CHECK (DrawKey::GetPipelineState (key) == 513);
+	CHECK (DrawKey::GetMaterial (key) == 99999);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (PackOrdersByDepth)
+{
+	CHECK (DrawKey::Pack (0, 0, 0, 0, 0.1f) < DrawKey::Pack (0, 0, 0, 0, 0.2f));
+	CHECK (DrawKey::Pack (0, 0, 0, 0, 0.1f, DrawKey::DepthOrder::BackToFront) >
+		DrawKey::Pack (0, 0, 0, 0, 0.2f, DrawKey::DepthOrder::BackToFront));
+	// State is more significant than depth
+	CHECK (DrawKey::Pack (0, 0, 1, 0, 0.0f) > DrawKey::Pack (0, 0, 0, 0, 1.0f));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (PackClampsDepth)
+{
+	const auto nearest = DrawKey::Pack (0, 0, 0, 0, 0.0f);
+	const auto farthest = DrawKey::Pack (0, 0, 0, 0, 1.0f);
+
+	CHECK (DrawKey::Pack (0, 0, 0, 0, -5.0f) == nearest);
+	CHECK (DrawKey::Pack (0, 0, 0, 0, 5.0f) == farthest);
+	CHECK (DrawKey::Pack (0, 0, 0, 0,
+		std::numeric_limits<float>::infinity ()) == farthest);
+	CHECK (DrawKey::Pack (0, 0, 0, 0,
+		-std::numeric_limits<float>::infinity ()) == nearest);
+	CHECK (DrawKey::Pack (0, 0, 0, 0,
+		std::numeric_limits<float>::quiet_NaN ()) == nearest);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (StateIdsAreDenseAndDistinct)
+{
+	DrawStateIds ids;
+	int a = 0, b = 0;
+
+	CHECK (ids.GetPipelineState (&a) == 0);
+	CHECK (ids.GetPipelineState (&b) == 1);
+	CHECK (ids.GetPipelineState (&a) == 0);
+	// Fields are numbered independently
+	CHECK (ids.GetRootSignature (&b) == 0);
+	CHECK (ids.GetMaterial (1234) == 0);
+	CHECK (ids.GetMaterial (5678) == 1);
+
+	ids.Clear ();
+	CHECK (ids.GetPipelineState (&b) == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (StateIdsThrowWhenFull)
+{
+	DrawStateIds ids;
+	std::vector<char> objects ((1 << DrawKey::ROOT_SIGNATURE_BITS) + 1);
+
+	for (int i = 0; i < (1 << DrawKey::ROOT_SIGNATURE_BITS); ++i) {
+		CHECK (ids.GetRootSignature (&objects [i]) == i);
+	}
+
+	CHECK_THROWS (ids.GetRootSignature (&objects.back ()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (RadixSortMatchesStableSort)
+{
+	ThreadPool pool (3);
+	std::mt19937_64 random (1);
+
+	// Around the insertion sort threshold, and large enough to be split into
+	// blocks
+	for (const std::size_t count : { 0, 1, 63, 64, 65, 1000, 100000 }) {
+		std::vector<std::uint64_t> keys (count);
+
+		// Full 64-bit keys
+		for (auto& key : keys) {
+			key = random ();
+		}
+		CheckRadixSort (keys, nullptr);
+		CheckRadixSort (keys, &pool);
+
+		// Few distinct values, many duplicates and skipped passes
+		for (auto& key : keys) {
+			key = DrawKey::Pack (0, 0, static_cast<int> (random () % 4), 0,
+				static_cast<float> (random () % 8) / 8);
+		}
+		CheckRadixSort (keys, nullptr);
+		CheckRadixSort (keys, &pool);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SubmitReportsStateChanges)
+{
+	DrawStateIds ids;
+	int rootSignature = 0, psoA = 0, psoB = 0;
+
+	// Two pipeline states and two materials, queued interleaved
+	DrawQueue queue;
+	for (std::uint32_t i = 0; i < 8; ++i) {
+		const auto key = DrawKey::Pack (0, ids.GetRootSignature (&rootSignature),
+			ids.GetPipelineState ((i & 1) ? &psoB : &psoA),
+			ids.GetMaterial (100 + (i & 2)),
+			static_cast<float> (i) / 8);
+		queue.Add (key, i);
+	}
+	queue.Sort ();
+
+	std::vector<std::uint32_t> order;
+	int rootSignatureChanges = 0, pipelineStateChanges = 0, materialChanges = 0;
+	queue.Submit ([&] (const std::uint32_t draw, const DrawQueue::StateChanges& changes) {
+		order.push_back (draw);
+		rootSignatureChanges += changes.rootSignature ? 1 : 0;
+		pipelineStateChanges += changes.pipelineState ? 1 : 0;
+		materialChanges += changes.material ? 1 : 0;
+	});
+
+	const std::vector<std::uint32_t> expected = { 0, 4, 2, 6, 1, 5, 3, 7 };
+	CHECK (order == expected);
+	CHECK (rootSignatureChanges == 1);
+	CHECK (pipelineStateChanges == 2);
+	CHECK (materialChanges == 4);
+	CHECK (queue.GetStateChangeCount () == 7);
+}
@@ -0,0 +1,168 @@
+#include "Test.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "FrameReadback.h"
+#include "NullDevice.h"
+#include "WaitableEvent.h"
+
+using namespace anteru;
+
+namespace {
+const int WIDTH = 8;
+const int HEIGHT = 4;
+const int ROW_PITCH = TEXTURE_DATA_PITCH_ALIGNMENT;
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint8_t GetPixelByte (const std::uint64_t frame, const int x, const int y,
+	const int component)
+{
+	return static_cast<std::uint8_t> (frame * 64 + y * 16 + x * 4 + component);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Render target whose content is uploaded from the CPU, so every frame has
+known pixels.
+*/
+struct FrameSource
+{
+	explicit FrameSource (IRenderDevice& device)
+		: texture (device.CreateTexture2D (WIDTH, HEIGHT,
+			PixelFormat::R8G8B8A8_UNorm, ResourceState::CopySource, true))
+		, upload (device.CreateBuffer (ROW_PITCH * HEIGHT, HeapType::Upload,
+			ResourceState::GenericRead))
+	{
+	}
+
+	/**
+	Record an upload of the pixels of frame into texture. The upload
+	buffer is shared between frames, so the command list must have
+	executed before the next call.
+	*/
+	void Upload (ICommandList* commandList, const std::uint64_t frame)
+	{
+		auto data = static_cast<std::uint8_t*> (upload->Map ());
+		for (int y = 0; y < HEIGHT; ++y) {
+			for (int x = 0; x < WIDTH; ++x) {
+				for (int c = 0; c < 4; ++c) {
+					data [y * ROW_PITCH + x * 4 + c] = GetPixelByte (frame, x, y, c);
+				}
+			}
+		}
+		upload->Unmap ();
+
+		ResourceTransition transition = { texture.get (),
+			ResourceState::CopySource, ResourceState::CopyDestination };
+		commandList->ResourceBarrier (&transition, 1);
+		commandList->CopyBufferToTexture (texture.get (), upload.get (), 0, ROW_PITCH);
+		std::swap (transition.before, transition.after);
+		commandList->ResourceBarrier (&transition, 1);
+	}
+
+	std::unique_ptr<IResource> texture;
+	std::unique_ptr<IResource> upload;
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FramesAreDeliveredInOrderWithTheirPixels)
+{
+	auto device = CreateNullDevice ();
+	auto fence = device->CreateFence (0);
+	auto commandList = device->CreateCommandList ();
+	WaitableEvent event;
+
+	FrameSource source (*device);
+	FrameReadback readback (*device, WIDTH, HEIGHT,
+		PixelFormat::R8G8B8A8_UNorm, 3);
+
+	std::vector<std::uint64_t> delivered;
+	bool pixelsMatch = true;
+	const auto callback = [&] (const ReadbackFrame& frame) {
+		delivered.push_back (frame.frameIndex);
+
+		CHECK (frame.width == WIDTH);
+		CHECK (frame.height == HEIGHT);
+		CHECK (frame.rowPitch == ROW_PITCH);
+		CHECK (frame.format == PixelFormat::R8G8B8A8_UNorm);
+
+		for (int y = 0; y < HEIGHT; ++y) {
+			for (int x = 0; x < WIDTH; ++x) {
+				for (int c = 0; c < 4; ++c) {
+					pixelsMatch &= frame.data [y * frame.rowPitch + x * 4 + c] ==
+						GetPixelByte (frame.frameIndex, x, y, c);
+				}
+			}
+		}
+	};
+
+	for (std::uint64_t frame = 0; frame < 3; ++frame) {
+		commandList->Reset ();
+		source.Upload (commandList.get (), frame);
+		readback.Copy (commandList.get (), source.texture.get (), frame, frame + 1);
+		commandList->Close ();
+
+		ICommandList* commandLists [] = { commandList.get () };
+		device->GetQueue ()->ExecuteCommandLists (commandLists, 1);
+		device->GetQueue ()->Signal (fence.get (), frame + 1);
+		WaitForValue (*fence, frame + 1, event);
+	}
+
+	CHECK (readback.GetPendingCount () == 3);
+
+	// Only frames whose fence value has been reached are handed out
+	CHECK (readback.Deliver (2, callback) == 2);
+	CHECK (readback.GetPendingCount () == 1);
+	CHECK (readback.Deliver (fence->GetCompletedValue (), callback) == 1);
+	CHECK (readback.GetPendingCount () == 0);
+
+	CHECK ((delivered == std::vector<std::uint64_t> { 0, 1, 2 }));
+	CHECK (pixelsMatch);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FullRingReportsWaitValueAndRejectsCopies)
+{
+	auto device = CreateNullDevice ();
+	auto commandList = device->CreateCommandList ();
+
+	FrameSource source (*device);
+	FrameReadback readback (*device, WIDTH, HEIGHT,
+		PixelFormat::R8G8B8A8_UNorm, 2);
+
+	commandList->Reset ();
+
+	CHECK (readback.GetWaitValue () == 0);
+	readback.Copy (commandList.get (), source.texture.get (), 0, 10);
+	CHECK (readback.GetWaitValue () == 0);
+	readback.Copy (commandList.get (), source.texture.get (), 1, 11);
+
+	// Both buffers are in use, the next copy has to wait for the oldest one
+	CHECK (readback.GetWaitValue () == 10);
+	CHECK_THROWS (readback.Copy (commandList.get (), source.texture.get (), 2, 12));
+
+	const auto ignore = [] (const ReadbackFrame&) {};
+	CHECK (readback.Deliver (9, ignore) == 0);
+	CHECK (readback.Deliver (10, ignore) == 1);
+	CHECK (readback.GetWaitValue () == 0);
+
+	// The ring wraps around
+	readback.Copy (commandList.get (), source.texture.get (), 2, 12);
+	CHECK (readback.GetWaitValue () == 11);
+	CHECK (readback.Deliver (12, ignore) == 2);
+
+	commandList->Close ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (EmptyRingThrows)
+{
+	auto device = CreateNullDevice ();
+
+	CHECK_THROWS (FrameReadback (*device, WIDTH, HEIGHT,
+		PixelFormat::R8G8B8A8_UNorm, 0));
+}
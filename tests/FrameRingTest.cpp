@@ -0,0 +1,142 @@
+#include "Test.h"
+
+#include <cstdint>
+#include <memory>
+
+#include "FrameRing.h"
+#include "NullDevice.h"
+#include "WaitableEvent.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Frames on the null device with simulated GPU time, driven the way the
+sample drives its ring: wait for the slot, submit, signal, end the frame.
+*/
+class FrameLoop final
+{
+public:
+	FrameLoop (const int framesInFlight, const double frameTime)
+		: device (CreateNullDevice (frameTime))
+		, fence (device->CreateFence (0))
+		, commandList (device->CreateCommandList ())
+		, ring (framesInFlight)
+	{
+		commandList->Close ();
+	}
+
+	/**
+	Returns whether the GPU was still busy with the frame which used the
+	slot before.
+	*/
+	bool BeginFrame ()
+	{
+		const bool busy = fence->GetCompletedValue () < ring.GetWaitValue ();
+		WaitForValue (*fence, ring.GetWaitValue (), event);
+		return busy;
+	}
+
+	void EndFrame ()
+	{
+		ICommandList* commandLists [] = { commandList.get () };
+		device->GetQueue ()->ExecuteCommandLists (commandLists, 1);
+		device->GetQueue ()->Signal (fence.get (), ++fenceValue);
+		ring.EndFrame (fenceValue);
+	}
+
+	std::unique_ptr<IRenderDevice> device;
+	std::unique_ptr<IFence> fence;
+	std::unique_ptr<ICommandList> commandList;
+	WaitableEvent event;
+	FrameRing ring;
+	std::uint64_t fenceValue = 0;
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (RejectsEmptyRing)
+{
+	CHECK_THROWS (FrameRing (0));
+	CHECK_THROWS (FrameRing (-1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SlotsAreReusedInOrder)
+{
+	FrameRing ring (3);
+	CHECK (ring.GetFramesInFlight () == 3);
+
+	for (std::uint64_t frame = 0; frame < 8; ++frame) {
+		CHECK (ring.GetFrameIndex () == frame);
+		CHECK (ring.GetCurrentSlot () == static_cast<int> (frame % 3));
+		// The slot has to wait for the frame three before, which was
+		// signaled with fence value frame - 2
+		CHECK (ring.GetWaitValue () == (frame < 3 ? 0 : frame - 2));
+
+		ring.EndFrame (frame + 1);
+		CHECK (ring.GetLastSubmittedValue () == frame + 1);
+		CHECK (ring.GetSlotFenceValue (static_cast<int> (frame % 3)) == frame + 1);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (RejectsFenceValuesWhichDoNotIncrease)
+{
+	FrameRing ring (2);
+	CHECK_THROWS (ring.EndFrame (0));
+
+	ring.EndFrame (5);
+	CHECK_THROWS (ring.EndFrame (5));
+	CHECK_THROWS (ring.EndFrame (4));
+
+	// Rejected values leave the ring untouched
+	CHECK (ring.GetFrameIndex () == 1);
+	CHECK (ring.GetCurrentSlot () == 1);
+	CHECK (ring.GetLastSubmittedValue () == 5);
+
+	// Values may skip, for instance if other work signals the same fence
+	ring.EndFrame (9);
+	CHECK (ring.GetWaitValue () == 5);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (WaitsForTheOldestFrameOnly)
+{
+	// 50 ms per frame, submitting three frames takes far less
+	FrameLoop loop (3, 50000);
+
+	for (int frame = 0; frame < 3; ++frame) {
+		CHECK (! loop.BeginFrame ());
+		loop.EndFrame ();
+	}
+
+	CHECK (loop.fence->GetCompletedValue () == 0);
+
+	for (int frame = 3; frame < 6; ++frame) {
+		// All slots are taken, so the frame blocks until the oldest one
+		// is done, while the two after it are still running
+		CHECK (loop.BeginFrame ());
+		const auto completedValue = loop.fence->GetCompletedValue ();
+		CHECK (completedValue >= loop.ring.GetWaitValue ());
+		CHECK (completedValue < loop.ring.GetLastSubmittedValue ());
+		loop.EndFrame ();
+	}
+
+	WaitForValue (*loop.fence, loop.ring.GetLastSubmittedValue (), loop.event);
+	CHECK (loop.fence->GetCompletedValue () == 6);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (IdleQueueNeverBlocks)
+{
+	// Without GPU time, every fence completes when it is signaled
+	FrameLoop loop (2, 0);
+
+	for (int frame = 0; frame < 16; ++frame) {
+		CHECK (! loop.BeginFrame ());
+		loop.EndFrame ();
+		CHECK (loop.fence->GetCompletedValue () == loop.ring.GetLastSubmittedValue ());
+	}
+}
@@ -0,0 +1,163 @@
+#include "Test.h"
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#include "GpuProfiler.h"
+
+using namespace anteru;
+
+namespace {
+const int SLOT_COUNT = 2;
+const int MAX_SCOPES = 4;
+
+///////////////////////////////////////////////////////////////////////////////
+bool IsClose (const double a, const double b)
+{
+	return std::abs (a - b) < 1e-9;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (TimingsArriveOnceTheSlotComesAround)
+{
+	NullTimestampBackend backend (SLOT_COUNT,
+		GpuProfiler::GetQueryCount (MAX_SCOPES));
+	GpuProfiler profiler (backend, SLOT_COUNT, MAX_SCOPES);
+
+	for (std::uint64_t frame = 0; frame < 2; ++frame) {
+		profiler.BeginFrame (static_cast<int> (frame % SLOT_COUNT), frame);
+		ScopedGpuMarker marker (profiler, "Frame");
+		profiler.EndFrame ();
+	}
+
+	// Nothing was read back yet, both slots are still in flight
+	CHECK (profiler.GetTimings ().empty ());
+	CHECK (profiler.GetTimingsFrameIndex () == UINT64_MAX);
+
+	profiler.BeginFrame (0, 2);
+	CHECK (profiler.GetTimingsFrameIndex () == 0);
+	CHECK (profiler.GetTimings ().size () == 1);
+	profiler.EndFrame ();
+
+	profiler.BeginFrame (1, 3);
+	CHECK (profiler.GetTimingsFrameIndex () == 1);
+	profiler.EndFrame ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (NestedScopesReportDepthAndDuration)
+{
+	// 1 GHz, 1 us per timestamp
+	NullTimestampBackend backend (SLOT_COUNT,
+		GpuProfiler::GetQueryCount (MAX_SCOPES), 1000000000, 1000);
+	GpuProfiler profiler (backend, SLOT_COUNT, MAX_SCOPES);
+
+	profiler.BeginFrame (0, 0);
+	{
+		ScopedGpuMarker outer (profiler, "Outer");
+		{
+			ScopedGpuMarker inner (profiler, "Inner");
+		}
+		ScopedGpuMarker sibling (profiler, "Sibling");
+	}
+	profiler.EndFrame ();
+
+	profiler.BeginFrame (0, 1);
+
+	const auto& timings = profiler.GetTimings ();
+	CHECK (timings.size () == 3);
+	if (timings.size () != 3) {
+		return;
+	}
+
+	// Outer: 1 -> 6 us, inner: 2 -> 3 us, sibling: 4 -> 5 us
+	CHECK (std::strcmp (timings [0].name, "Outer") == 0);
+	CHECK (timings [0].depth == 0);
+	CHECK (IsClose (timings [0].milliseconds, 0.005));
+	CHECK (std::strcmp (timings [1].name, "Inner") == 0);
+	CHECK (timings [1].depth == 1);
+	CHECK (IsClose (timings [1].milliseconds, 0.001));
+	CHECK (std::strcmp (timings [2].name, "Sibling") == 0);
+	CHECK (timings [2].depth == 1);
+	CHECK (IsClose (timings [2].milliseconds, 0.001));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (EndFrameClosesOpenScopes)
+{
+	NullTimestampBackend backend (SLOT_COUNT,
+		GpuProfiler::GetQueryCount (MAX_SCOPES), 1000000000, 1000);
+	GpuProfiler profiler (backend, SLOT_COUNT, MAX_SCOPES);
+
+	profiler.BeginFrame (0, 0);
+	profiler.BeginScope ("Outer");
+	profiler.BeginScope ("Inner");
+	profiler.EndFrame ();
+
+	profiler.BeginFrame (0, 1);
+
+	const auto& timings = profiler.GetTimings ();
+	CHECK (timings.size () == 2);
+	if (timings.size () != 2) {
+		return;
+	}
+
+	// Inner scopes are closed first: outer 1 -> 4 us, inner 2 -> 3 us
+	CHECK (IsClose (timings [0].milliseconds, 0.003));
+	CHECK (IsClose (timings [1].milliseconds, 0.001));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ScopesBeyondTheLimitAreNotMeasured)
+{
+	NullTimestampBackend backend (SLOT_COUNT,
+		GpuProfiler::GetQueryCount (1));
+	GpuProfiler profiler (backend, SLOT_COUNT, 1);
+
+	profiler.BeginFrame (0, 0);
+	const int first = profiler.BeginScope ("First");
+	const int second = profiler.BeginScope ("Second");
+	CHECK (first == 0);
+	CHECK (second == -1);
+	profiler.EndScope (second);
+	profiler.EndScope (first);
+	profiler.EndFrame ();
+
+	// Outside of a frame, scopes are ignored as well
+	CHECK (profiler.BeginScope ("Outside") == -1);
+
+	profiler.BeginFrame (0, 1);
+	CHECK (profiler.GetTimings ().size () == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ReportListsEveryScope)
+{
+	NullTimestampBackend backend (SLOT_COUNT,
+		GpuProfiler::GetQueryCount (MAX_SCOPES));
+	GpuProfiler profiler (backend, SLOT_COUNT, MAX_SCOPES);
+
+	for (std::uint64_t frame = 0; frame < 8; ++frame) {
+		profiler.BeginFrame (static_cast<int> (frame % SLOT_COUNT), frame);
+		ScopedGpuMarker draw (profiler, "Draw");
+		ScopedGpuMarker copy (profiler, "Copy");
+		profiler.EndFrame ();
+	}
+
+	std::ostringstream report;
+	profiler.WriteReport (report);
+
+	CHECK (report.str ().find ("Draw") != std::string::npos);
+	CHECK (report.str ().find ("  Copy") != std::string::npos);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidSizesThrow)
+{
+	NullTimestampBackend backend (1, 2);
+
+	CHECK_THROWS (GpuProfiler (backend, 0, 1));
+	CHECK_THROWS (GpuProfiler (backend, 1, 0));
+}
@@ -0,0 +1,1267 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Deflate.h"
+#include "HdrImage.h"
+#include "PixelConversion.h"
+
+using namespace anteru;
+
+// Radiance and OpenEXR files are written by the test, with minimal encoders
+// which follow the reference implementations, so the decoders can be
+// checked against the pixels which went in.
+
+namespace {
+typedef std::vector<std::uint8_t> Bytes;
+
+const PixelFormat HDR_FORMATS [] = {
+	PixelFormat::R16G16B16A16_Float,
+	PixelFormat::R11G11B10_Float,
+	PixelFormat::R9G9B9E5_SharedExp
+};
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t FloatToBits (const float value)
+{
+	std::uint32_t bits;
+	std::memcpy (&bits, &value, sizeof (bits));
+	return bits;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void Append (Bytes& output, const std::string& text)
+{
+	output.insert (output.end (), text.begin (), text.end ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void AppendLittleEndian (Bytes& output, const T value)
+{
+	for (std::size_t i = 0; i < sizeof (T); ++i) {
+		output.push_back (static_cast<std::uint8_t> (
+			static_cast<std::uint64_t> (value) >> (8 * i)));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Pixels as RGBA floats, and the expected texels for each format, computed
+with the conversion functions, which have their own test.
+*/
+struct FloatImage
+{
+	int width;
+	int height;
+	std::vector<float> rgba;
+
+	Bytes GetTexels (const PixelFormat format, const int rowPitch) const
+	{
+		Bytes result (static_cast<std::size_t> (rowPitch) * height);
+
+		for (int y = 0; y < height; ++y) {
+			const auto source = rgba.data () + static_cast<std::size_t> (y) * width * 4;
+			const auto target = result.data () + static_cast<std::size_t> (y) * rowPitch;
+
+			if (format == PixelFormat::R16G16B16A16_Float) {
+				ConvertFloatToHalf (source, reinterpret_cast<std::uint16_t*> (target),
+					static_cast<std::size_t> (width) * 4);
+			} else if (format == PixelFormat::R11G11B10_Float) {
+				PackR11G11B10 (source, reinterpret_cast<std::uint32_t*> (target), width);
+			} else {
+				PackR9G9B9E5 (source, reinterpret_cast<std::uint32_t*> (target), width);
+			}
+		}
+
+		return result;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Load data as every HDR format, and check the size, the pitch and the texels.
+*/
+bool LoadsAs (const Bytes& data, const FloatImage& expected)
+{
+	for (const auto format : HDR_FORMATS) {
+		const auto image = LoadHdrImageFromMemory (data.data (), data.size (), format);
+		const int bytesPerPixel = (format == PixelFormat::R16G16B16A16_Float) ? 8 : 4;
+
+		if (image.width != expected.width || image.height != expected.height ||
+			image.format != format || image.rowPitch % 256 != 0 ||
+			image.rowPitch < image.width * bytesPerPixel ||
+			image.data != expected.GetTexels (format, image.rowPitch)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Random RGBE pixels, with runs of identical pixels and of identical values
+in single channels so the run-length encoding gets used.
+*/
+Bytes CreateRgbePixels (const int width, const int height, const std::uint32_t seed)
+{
+	std::mt19937 random (seed);
+	std::uniform_int_distribution<int> byte (0, 255);
+	std::uniform_int_distribution<int> exponent (120, 140);
+	std::uniform_int_distribution<int> choice (0, 9);
+
+	Bytes result (static_cast<std::size_t> (width) * height * 4);
+	for (std::size_t i = 0; i < result.size (); i += 4) {
+		const int c = choice (random);
+		if (i > 0 && c < 4) {
+			std::memcpy (&result [i], &result [i - 4], 4);
+		} else {
+			for (int channel = 0; channel < 3; ++channel) {
+				result [i + channel] = static_cast<std::uint8_t> (
+					(c == 4 && i > 0) ? result [i - 4 + channel] : byte (random));
+			}
+			result [i + 3] = static_cast<std::uint8_t> (c == 9 ? 0 : exponent (random));
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FloatImage DecodeRgbe (const Bytes& pixels, const int width, const int height,
+	const bool bottomUp)
+{
+	FloatImage result = { width, height, std::vector<float> (pixels.size ()) };
+
+	for (int y = 0; y < height; ++y) {
+		const int row = bottomUp ? height - 1 - y : y;
+		for (int x = 0; x < width; ++x) {
+			const auto source = &pixels [(static_cast<std::size_t> (y) * width + x) * 4];
+			const auto target = &result.rgba [(static_cast<std::size_t> (row) * width + x) * 4];
+			const double scale = source [3] ? std::ldexp (1.0, source [3] - 136) : 0;
+
+			for (int c = 0; c < 3; ++c) {
+				target [c] = static_cast<float> (source [c] * scale);
+			}
+			target [3] = 1;
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Bytes CreateRadianceHeader (const int width, const int height, const bool bottomUp)
+{
+	Bytes result;
+	Append (result, "#?RADIANCE\n# Written by HdrImageTest\nFORMAT=32-bit_rle_rgbe\n"
+		"EXPOSURE=1.0\n\n");
+	Append (result, (bottomUp ? "+Y " : "-Y ") + std::to_string (height) +
+		" +X " + std::to_string (width) + "\n");
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Bytes CreateFlatRadiance (const Bytes& pixels, const int width, const int height,
+	const bool bottomUp = false)
+{
+	auto result = CreateRadianceHeader (width, height, bottomUp);
+	result.insert (result.end (), pixels.begin (), pixels.end ());
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Write scanlines with the run-length encoding which stores each channel
+separately: runs of at least three identical values become a count above
+128 and the value, everything else literals of up to 128 values.
+*/
+Bytes CreateRleRadiance (const Bytes& pixels, const int width, const int height,
+	const bool bottomUp = false)
+{
+	auto result = CreateRadianceHeader (width, height, bottomUp);
+
+	for (int y = 0; y < height; ++y) {
+		result.push_back (2);
+		result.push_back (2);
+		result.push_back (static_cast<std::uint8_t> (width >> 8));
+		result.push_back (static_cast<std::uint8_t> (width));
+
+		for (int channel = 0; channel < 4; ++channel) {
+			const auto value = [&] (const int x) {
+				return pixels [(static_cast<std::size_t> (y) * width + x) * 4 + channel];
+			};
+
+			for (int x = 0; x < width; ) {
+				int run = 1;
+				while (x + run < width && run < 127 && value (x + run) == value (x)) {
+					++run;
+				}
+
+				if (run >= 3) {
+					result.push_back (static_cast<std::uint8_t> (128 + run));
+					result.push_back (value (x));
+					x += run;
+					continue;
+				}
+
+				// Literals up to the start of the next run
+				int count = 0;
+				while (x + count < width && count < 128 &&
+					! (x + count + 2 < width && value (x + count) == value (x + count + 1) &&
+						value (x + count) == value (x + count + 2))) {
+					++count;
+				}
+
+				count = std::max (count, 1);
+				result.push_back (static_cast<std::uint8_t> (count));
+				for (int i = 0; i < count; ++i) {
+					result.push_back (value (x + i));
+				}
+				x += count;
+			}
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Bytes CreateRadianceHeader (const std::string& format, const std::string& resolution)
+{
+	Bytes result;
+	Append (result, "#?RADIANCE\n" + format + "\n\n" + resolution + "\n");
+	return result;
+}
+
+enum class ExrCompression
+{
+	None = 0,
+	Rle = 1,
+	Zips = 2,
+	Zip = 3,
+	Piz = 4
+};
+
+enum class ExrPixelType
+{
+	UInt = 0,
+	Half = 1,
+	Float = 2
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+A channel of an OpenEXR image, with the values of each pixel stored as in
+the file.
+*/
+struct ExrChannel
+{
+	std::string name;
+	ExrPixelType type;
+	Bytes data;
+
+	int GetBytesPerPixel () const
+	{
+		return type == ExrPixelType::Half ? 2 : 4;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct ExrImage
+{
+	int width;
+	int height;
+	int xMin;
+	int yMin;
+	// Sorted by name, as in the file
+	std::vector<ExrChannel> channels;
+
+	FloatImage Decode () const;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+FloatImage ExrImage::Decode () const
+{
+	FloatImage result = { width, height,
+		std::vector<float> (static_cast<std::size_t> (width) * height * 4) };
+	for (std::size_t i = 3; i < result.rgba.size (); i += 4) {
+		result.rgba [i] = 1;
+	}
+
+	for (const auto& channel : channels) {
+		const char* const names = "RGBA";
+		const auto component = std::strchr (names, channel.name [0]);
+		if (channel.name.size () != 1 || component == nullptr) {
+			continue;
+		}
+
+		for (std::size_t i = 0; i < result.rgba.size () / 4; ++i) {
+			float value;
+			if (channel.type == ExrPixelType::Half) {
+				std::uint16_t half;
+				std::memcpy (&half, &channel.data [i * 2], 2);
+				ConvertHalfToFloat (&half, &value, 1);
+			} else if (channel.type == ExrPixelType::Float) {
+				std::memcpy (&value, &channel.data [i * 4], 4);
+			} else {
+				std::uint32_t integer;
+				std::memcpy (&integer, &channel.data [i * 4], 4);
+				value = static_cast<float> (integer);
+			}
+
+			result.rgba [i * 4 + (component - names)] = value;
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Reorder into even and odd bytes and store the deltas, then deflate, like
+the ZIP compressor.
+*/
+Bytes CompressExrZip (const Bytes& data)
+{
+	Bytes reordered (data.size ());
+	const auto half = (data.size () + 1) / 2;
+	for (std::size_t i = 0; i < data.size (); ++i) {
+		reordered [(i & 1) ? half + i / 2 : i / 2] = data [i];
+	}
+
+	for (std::size_t i = reordered.size (); i-- > 1; ) {
+		reordered [i] = static_cast<std::uint8_t> (reordered [i] - reordered [i - 1] + 128);
+	}
+
+	return ZlibCompress (reordered.data (), reordered.size ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Writes bits most significant first.
+*/
+class MsbBitWriter
+{
+public:
+	explicit MsbBitWriter (Bytes& output)
+		: output_ (output)
+	{
+	}
+
+	void Write (const std::uint64_t value, const int count)
+	{
+		for (int i = count - 1; i >= 0; --i) {
+			if (bitCount_ % 8 == 0) {
+				output_.push_back (0);
+			}
+
+			if ((value >> i) & 1) {
+				output_.back () |= static_cast<std::uint8_t> (0x80 >> (bitCount_ % 8));
+			}
+
+			++bitCount_;
+		}
+	}
+
+	std::uint64_t GetBitCount () const
+	{
+		return bitCount_;
+	}
+
+private:
+	Bytes& output_;
+	std::uint64_t bitCount_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Huffman code the values like the PIZ compressor, see ImfHuf.cpp in
+OpenEXR. The code lengths are not optimal: the most frequent symbols get
+lengths 1, 2, 3 and so on up to 16, the remaining ones share the rest of
+the code space, which also yields codes longer than the decoder's lookup
+table. Repeats of the previous value are run-length encoded with the
+largest symbol.
+*/
+Bytes EncodePizHuffman (const std::vector<std::uint16_t>& values)
+{
+	const std::uint32_t minSymbol = *std::min_element (values.begin (), values.end ());
+	const std::uint32_t runSymbol = *std::max_element (values.begin (), values.end ()) + 1u;
+
+	// Symbols and runs, a run repeats the previous value count times
+	std::vector<std::pair<std::uint32_t, int>> symbols;
+	for (std::size_t i = 0; i < values.size (); ) {
+		symbols.emplace_back (values [i], 0);
+		std::size_t run = 1;
+		while (i + run < values.size () && run <= 255 && values [i + run] == values [i]) {
+			++run;
+		}
+
+		if (run >= 4) {
+			symbols.emplace_back (runSymbol, static_cast<int> (run - 1));
+			i += run;
+		} else {
+			++i;
+		}
+	}
+
+	std::vector<std::uint64_t> frequencies (runSymbol + 1, 0);
+	for (const auto& symbol : symbols) {
+		++frequencies [symbol.first];
+	}
+	++frequencies [runSymbol];
+
+	std::vector<std::uint32_t> used;
+	for (std::uint32_t symbol = minSymbol; symbol <= runSymbol; ++symbol) {
+		if (frequencies [symbol] > 0) {
+			used.push_back (symbol);
+		}
+	}
+	std::stable_sort (used.begin (), used.end (), [&] (const std::uint32_t a, const std::uint32_t b) {
+		return frequencies [a] > frequencies [b];
+	});
+
+	// The code space has to be filled completely, as the canonical codes
+	// are assigned from the longest length down
+	std::vector<int> lengths (runSymbol + 1, 0);
+	const int unary = static_cast<int> (std::min<std::size_t> (used.size () - 1, 16));
+	for (int i = 0; i < unary; ++i) {
+		lengths [used [i]] = i + 1;
+	}
+
+	const auto rest = used.size () - unary;
+	int restBits = 0;
+	while ((std::size_t (2) << restBits) <= rest) {
+		++restBits;
+	}
+	const auto longer = 2 * (rest - (std::size_t (1) << restBits));
+	for (std::size_t i = 0; i < rest; ++i) {
+		lengths [used [unary + i]] = unary + restBits + (i >= rest - longer ? 1 : 0);
+	}
+
+	std::uint64_t lengthCounts [59] = {};
+	for (const auto symbol : used) {
+		++lengthCounts [lengths [symbol]];
+	}
+
+	std::uint64_t nextCodes [59] = {};
+	std::uint64_t code = 0;
+	for (int length = 58; length > 0; --length) {
+		nextCodes [length] = code;
+		code = (code + lengthCounts [length]) >> 1;
+	}
+
+	std::vector<std::uint64_t> codes (runSymbol + 1, 0);
+	for (std::uint32_t symbol = minSymbol; symbol <= runSymbol; ++symbol) {
+		if (lengths [symbol] > 0) {
+			codes [symbol] = nextCodes [lengths [symbol]]++;
+		}
+	}
+
+	// Table of 6-bit lengths, with zero runs packed into codes 59 to 63
+	Bytes table;
+	MsbBitWriter tableWriter (table);
+	for (std::uint32_t symbol = minSymbol; symbol <= runSymbol; ) {
+		std::uint32_t zeros = 0;
+		while (symbol + zeros <= runSymbol && lengths [symbol + zeros] == 0 && zeros < 255 + 6) {
+			++zeros;
+		}
+
+		if (zeros >= 6) {
+			tableWriter.Write (63, 6);
+			tableWriter.Write (zeros - 6, 8);
+			symbol += zeros;
+		} else if (zeros >= 2) {
+			tableWriter.Write (59 + zeros - 2, 6);
+			symbol += zeros;
+		} else {
+			tableWriter.Write (lengths [symbol], 6);
+			++symbol;
+		}
+	}
+
+	Bytes data;
+	MsbBitWriter dataWriter (data);
+	for (const auto& symbol : symbols) {
+		dataWriter.Write (codes [symbol.first], lengths [symbol.first]);
+		if (symbol.first == runSymbol) {
+			dataWriter.Write (symbol.second, 8);
+		}
+	}
+
+	Bytes result;
+	AppendLittleEndian (result, minSymbol);
+	AppendLittleEndian (result, runSymbol);
+	AppendLittleEndian (result, static_cast<std::uint32_t> (table.size ()));
+	AppendLittleEndian (result, static_cast<std::uint32_t> (dataWriter.GetBitCount ()));
+	AppendLittleEndian (result, std::uint32_t (0));
+	result.insert (result.end (), table.begin (), table.end ());
+	result.insert (result.end (), data.begin (), data.end ());
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void EncodeWavelet14 (const std::uint16_t a, const std::uint16_t b,
+	std::uint16_t& l, std::uint16_t& h)
+{
+	const int as = static_cast<std::int16_t> (a);
+	const int bs = static_cast<std::int16_t> (b);
+
+	l = static_cast<std::uint16_t> ((as + bs) >> 1);
+	h = static_cast<std::uint16_t> (as - bs);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void EncodeWavelet16 (const std::uint16_t a, const std::uint16_t b,
+	std::uint16_t& l, std::uint16_t& h)
+{
+	const int ao = (a + (1 << 15)) & 0xFFFF;
+	int m = (ao + b) >> 1;
+	const int d = ao - b;
+
+	if (d < 0) {
+		m = (m + (1 << 15)) & 0xFFFF;
+	}
+
+	l = static_cast<std::uint16_t> (m);
+	h = static_cast<std::uint16_t> (d & 0xFFFF);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The 2D Haar wavelet of the PIZ compressor, see ImfWav.cpp in OpenEXR.
+*/
+void EncodeWavelet (std::uint16_t* data, const int nx, const int ox,
+	const int ny, const int oy, const std::uint16_t maxValue)
+{
+	const auto encode = (maxValue < (1 << 14)) ? EncodeWavelet14 : EncodeWavelet16;
+	const int n = std::min (nx, ny);
+
+	for (int p = 1, p2 = 2; p2 <= n; p = p2, p2 <<= 1) {
+		const int oy1 = oy * p, oy2 = oy * p2;
+		const int ox1 = ox * p, ox2 = ox * p2;
+
+		std::uint16_t* py = data;
+		std::uint16_t* const ey = data + oy * (ny - p2);
+
+		for (; py <= ey; py += oy2) {
+			std::uint16_t* px = py;
+			std::uint16_t* const ex = py + ox * (nx - p2);
+
+			for (; px <= ex; px += ox2) {
+				const auto p01 = px + ox1;
+				const auto p10 = px + oy1;
+				const auto p11 = p10 + ox1;
+
+				std::uint16_t i00, i01, i10, i11;
+				encode (*px, *p01, i00, i01);
+				encode (*p10, *p11, i10, i11);
+				encode (i00, i10, *px, *p10);
+				encode (i01, i11, *p01, *p11);
+			}
+
+			if (nx & p) {
+				const auto p10 = px + oy1;
+				std::uint16_t i00;
+				encode (*px, *p10, i00, *p10);
+				*px = i00;
+			}
+		}
+
+		if (ny & p) {
+			std::uint16_t* px = py;
+			std::uint16_t* const ex = py + ox * (nx - p2);
+
+			for (; px <= ex; px += ox2) {
+				const auto p01 = px + ox1;
+				std::uint16_t i00;
+				encode (*px, *p01, i00, *p01);
+				*px = i00;
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Compress lineCount lines of the image like the PIZ compressor: map the used
+values to a dense range, apply the wavelet per channel plane, and Huffman
+code the result.
+*/
+Bytes CompressExrPiz (const ExrImage& image, const int firstLine, const int lineCount)
+{
+	// Each channel as a plane, 32-bit values as two interleaved halves
+	std::vector<std::uint16_t> values;
+	for (const auto& channel : image.channels) {
+		const auto lineSize = static_cast<std::size_t> (image.width) *
+			channel.GetBytesPerPixel ();
+		const auto start = values.size ();
+		values.resize (start + lineSize * lineCount / 2);
+		std::memcpy (&values [start], &channel.data [lineSize * firstLine],
+			lineSize * lineCount);
+	}
+
+	// Zero is always part of the mapping, and not stored in the bitmap
+	Bytes bitmap (8192, 0);
+	for (const auto value : values) {
+		bitmap [value >> 3] |= static_cast<std::uint8_t> (1 << (value & 7));
+	}
+	bitmap [0] &= 0xFE;
+
+	std::vector<std::uint16_t> lut (1 << 16, 0);
+	int lutSize = 0;
+	for (int i = 0; i < (1 << 16); ++i) {
+		if (i == 0 || (bitmap [i >> 3] & (1 << (i & 7)))) {
+			lut [i] = static_cast<std::uint16_t> (lutSize++);
+		}
+	}
+
+	for (auto& value : values) {
+		value = lut [value];
+	}
+
+	auto plane = values.data ();
+	for (const auto& channel : image.channels) {
+		const int components = channel.GetBytesPerPixel () / 2;
+		for (int i = 0; i < components; ++i) {
+			EncodeWavelet (plane + i, image.width, components, lineCount,
+				image.width * components, static_cast<std::uint16_t> (lutSize - 1));
+		}
+		plane += static_cast<std::size_t> (image.width) * lineCount * components;
+	}
+
+	int minNonZero = 8191, maxNonZero = 0;
+	for (int i = 0; i < 8192; ++i) {
+		if (bitmap [i]) {
+			minNonZero = std::min (minNonZero, i);
+			maxNonZero = std::max (maxNonZero, i);
+		}
+	}
+
+	Bytes result;
+	AppendLittleEndian (result, static_cast<std::uint16_t> (minNonZero));
+	AppendLittleEndian (result, static_cast<std::uint16_t> (maxNonZero));
+	if (minNonZero <= maxNonZero) {
+		result.insert (result.end (), bitmap.begin () + minNonZero,
+			bitmap.begin () + maxNonZero + 1);
+	}
+
+	const auto huffman = EncodePizHuffman (values);
+	AppendLittleEndian (result, static_cast<std::uint32_t> (huffman.size ()));
+	result.insert (result.end (), huffman.begin (), huffman.end ());
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void AppendAttribute (Bytes& output, const std::string& name,
+	const std::string& type, const Bytes& value)
+{
+	output.insert (output.end (), name.c_str (), name.c_str () + name.size () + 1);
+	output.insert (output.end (), type.c_str (), type.c_str () + type.size () + 1);
+	AppendLittleEndian (output, static_cast<std::uint32_t> (value.size ()));
+	output.insert (output.end (), value.begin (), value.end ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Write a single-part scanline OpenEXR file. The header declares
+compression, the blocks are compressed with blockCompression, which can be
+None to store every block uncompressed like the compressors do for blocks
+which do not get smaller.
+*/
+Bytes CreateExr (const ExrImage& image, const ExrCompression compression,
+	const ExrCompression blockCompression)
+{
+	Bytes result;
+	AppendLittleEndian (result, std::uint32_t (20000630));
+	AppendLittleEndian (result, std::uint32_t (2));
+
+	Bytes channels;
+	for (const auto& channel : image.channels) {
+		Append (channels, channel.name);
+		channels.push_back (0);
+		AppendLittleEndian (channels, static_cast<std::int32_t> (channel.type));
+		AppendLittleEndian (channels, std::uint32_t (0));
+		AppendLittleEndian (channels, std::int32_t (1));
+		AppendLittleEndian (channels, std::int32_t (1));
+	}
+	channels.push_back (0);
+
+	Bytes dataWindow;
+	AppendLittleEndian (dataWindow, static_cast<std::int32_t> (image.xMin));
+	AppendLittleEndian (dataWindow, static_cast<std::int32_t> (image.yMin));
+	AppendLittleEndian (dataWindow, static_cast<std::int32_t> (image.xMin + image.width - 1));
+	AppendLittleEndian (dataWindow, static_cast<std::int32_t> (image.yMin + image.height - 1));
+
+	Bytes pixelAspectRatio;
+	AppendLittleEndian (pixelAspectRatio, std::uint32_t (0x3F800000));
+
+	AppendAttribute (result, "channels", "chlist", channels);
+	AppendAttribute (result, "compression", "compression",
+		{ static_cast<std::uint8_t> (compression) });
+	AppendAttribute (result, "dataWindow", "box2i", dataWindow);
+	AppendAttribute (result, "displayWindow", "box2i", dataWindow);
+	AppendAttribute (result, "lineOrder", "lineOrder", { 0 });
+	AppendAttribute (result, "pixelAspectRatio", "float", pixelAspectRatio);
+	result.push_back (0);
+
+	const int linesPerBlock = (compression == ExrCompression::Piz) ? 32
+		: (compression == ExrCompression::Zip) ? 16 : 1;
+	const int blockCount = (image.height + linesPerBlock - 1) / linesPerBlock;
+
+	const auto offsetTable = result.size ();
+	result.resize (result.size () + 8 * blockCount);
+
+	for (int block = 0; block < blockCount; ++block) {
+		const int firstLine = block * linesPerBlock;
+		const int lineCount = std::min (linesPerBlock, image.height - firstLine);
+
+		Bytes lines;
+		for (int line = firstLine; line < firstLine + lineCount; ++line) {
+			for (const auto& channel : image.channels) {
+				const auto lineSize = static_cast<std::size_t> (image.width) *
+					channel.GetBytesPerPixel ();
+				lines.insert (lines.end (), channel.data.begin () + lineSize * line,
+					channel.data.begin () + lineSize * (line + 1));
+			}
+		}
+
+		Bytes packed;
+		if (blockCompression == ExrCompression::Piz) {
+			packed = CompressExrPiz (image, firstLine, lineCount);
+		} else if (blockCompression != ExrCompression::None) {
+			packed = CompressExrZip (lines);
+		} else {
+			packed = lines;
+		}
+
+		const auto offset = static_cast<std::uint64_t> (result.size ());
+		for (int i = 0; i < 8; ++i) {
+			result [offsetTable + 8 * block + i] = static_cast<std::uint8_t> (offset >> (8 * i));
+		}
+
+		AppendLittleEndian (result, static_cast<std::int32_t> (image.yMin + firstLine));
+		AppendLittleEndian (result, static_cast<std::uint32_t> (packed.size ()));
+		result.insert (result.end (), packed.begin (), packed.end ());
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Random halves without NaN, as a smooth gradient with some noise, and a few
+negative values, denormals and infinities.
+*/
+Bytes CreateHalfChannel (const int width, const int height, const std::uint32_t seed)
+{
+	std::mt19937 random (seed);
+	std::uniform_int_distribution<int> noise (0, 15);
+	std::uniform_int_distribution<int> special (0, 63);
+
+	Bytes result;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			std::uint16_t value = static_cast<std::uint16_t> (0x3000 + x * 40 + y * 16 + noise (random));
+
+			switch (special (random)) {
+			case 0: value |= 0x8000; break;
+			case 1: value = static_cast<std::uint16_t> (noise (random)); break;
+			case 2: value = 0x7C00; break;
+			case 3: value = 0xFC00; break;
+			case 4: value = 0x8000; break;
+			}
+
+			AppendLittleEndian (result, value);
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+RGBA halves, plus a float channel which is not part of the output.
+*/
+ExrImage CreateHalfExr (const int width, const int height)
+{
+	ExrImage image = { width, height, 3, -5, {} };
+	const char* names [] = { "A", "B", "G", "R" };
+	for (int i = 0; i < 4; ++i) {
+		image.channels.push_back ({ names [i], ExrPixelType::Half,
+			CreateHalfChannel (width, height, 42 + i) });
+	}
+
+	Bytes depth;
+	for (int i = 0; i < width * height; ++i) {
+		AppendLittleEndian (depth, static_cast<std::uint32_t> (0x3F000000 + i * 4099));
+	}
+	image.channels.push_back ({ "Z", ExrPixelType::Float, depth });
+
+	return image;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Float red and blue and an integer green channel, and no alpha. The values
+are exact in half precision, so every output format sees the same values.
+*/
+ExrImage CreateFloatExr (const int width, const int height)
+{
+	ExrImage image = { width, height, -7, 11, {} };
+
+	Bytes red, green, blue;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			AppendLittleEndian (blue, FloatToBits (std::ldexp (static_cast<float> (x + 1), y % 16 - 8)));
+			AppendLittleEndian (green, static_cast<std::uint32_t> (x * y));
+			AppendLittleEndian (red, FloatToBits (x * 0.25f - y * 0.125f));
+		}
+	}
+
+	image.channels.push_back ({ "B", ExrPixelType::Float, blue });
+	image.channels.push_back ({ "G", ExrPixelType::UInt, green });
+	image.channels.push_back ({ "R", ExrPixelType::Float, red });
+	return image;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Four half channels which together use 32768 different values, more than
+the 14-bit wavelet can handle, as ramps which still compress well.
+*/
+ExrImage CreateWideRangeExr ()
+{
+	ExrImage image = { 256, 40, 0, 0, {} };
+	const char* names [] = { "A", "B", "G", "R" };
+	const std::uint16_t starts [] = { 0, 8192, 0x8000, 0x8000 + 8192 };
+
+	for (int i = 0; i < 4; ++i) {
+		Bytes data;
+		for (int j = 0; j < image.width * image.height; ++j) {
+			AppendLittleEndian (data, static_cast<std::uint16_t> (starts [i] + j % 8192));
+		}
+		image.channels.push_back ({ names [i], ExrPixelType::Half, data });
+	}
+
+	return image;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Decode data, and return whether it was rejected. Either outcome is fine for
+damaged images, as long as the decoder stays within its buffers, which the
+sanitizer builds check.
+*/
+bool IsRejected (const Bytes& data)
+{
+	try {
+		LoadHdrImageFromMemory (data.data (), data.size (), PixelFormat::R16G16B16A16_Float);
+		return false;
+	} catch (...) {
+		return true;
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FlatRadianceScanlinesDecode)
+{
+	// Too narrow for the run-length encoding, so pixels are stored as-is,
+	// with (1, 1, 1, n) repeating the previous pixel n times
+	const std::uint8_t scanlines [] = {
+		128, 64, 32, 129,	255, 0, 1, 140,		1, 1, 1, 3,
+		10, 20, 30, 0,		0, 0, 0, 0,			1, 2, 3, 100,	200, 100, 50, 128,	0, 128, 0, 130,
+		7, 7, 7, 136,		1, 1, 1, 2,			1, 1, 1, 0,		9, 9, 9, 135,		9, 9, 9, 135
+	};
+
+	auto data = CreateRadianceHeader (5, 3, false);
+	data.insert (data.end (), std::begin (scanlines), std::end (scanlines));
+
+	const Bytes pixels = {
+		128, 64, 32, 129,	255, 0, 1, 140,		255, 0, 1, 140,		255, 0, 1, 140,		255, 0, 1, 140,
+		10, 20, 30, 0,		0, 0, 0, 0,			1, 2, 3, 100,		200, 100, 50, 128,	0, 128, 0, 130,
+		7, 7, 7, 136,		7, 7, 7, 136,		7, 7, 7, 136,		9, 9, 9, 135,		9, 9, 9, 135
+	};
+	const auto expected = DecodeRgbe (pixels, 5, 3, false);
+
+	CHECK (LoadsAs (data, expected));
+	CHECK (LoadsAs (CreateFlatRadiance (pixels, 5, 3), expected));
+
+	// Spot checks of the RGBE scaling
+	CHECK (expected.rgba [0] == 1.0f && expected.rgba [1] == 0.5f && expected.rgba [2] == 0.25f);
+	CHECK (expected.rgba [4] == 4080.0f && expected.rgba [6] == 16.0f);
+	CHECK (expected.rgba [20] == 0.0f && expected.rgba [23] == 1.0f);
+
+	// Bottom-up images are flipped
+	CHECK (LoadsAs (CreateFlatRadiance (pixels, 5, 3, true),
+		DecodeRgbe (pixels, 5, 3, true)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (RleRadianceScanlinesDecode)
+{
+	// The narrowest width which is encoded, and widths with full and partial
+	// literals and long runs
+	for (const int width : { 8, 37, 300 }) {
+		const auto pixels = CreateRgbePixels (width, 7, width);
+		const auto expected = DecodeRgbe (pixels, width, 7, false);
+
+		const auto rle = CreateRleRadiance (pixels, width, 7);
+		CHECK (LoadsAs (rle, expected));
+		CHECK (LoadsAs (CreateRleRadiance (pixels, width, 7, true),
+			DecodeRgbe (pixels, width, 7, true)));
+	}
+
+	// Scanlines may mix both encodings
+	const auto pixels = CreateRgbePixels (16, 2, 3);
+	const auto rle = CreateRleRadiance (Bytes (pixels.begin (), pixels.begin () + 16 * 4), 16, 1);
+	auto data = CreateRadianceHeader (16, 2, false);
+	data.insert (data.end (), rle.begin () + CreateRadianceHeader (16, 1, false).size (),
+		rle.end ());
+	data.insert (data.end (), pixels.begin () + 16 * 4, pixels.end ());
+	CHECK (LoadsAs (data, DecodeRgbe (pixels, 16, 2, false)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidRadianceImagesThrow)
+{
+	const auto pixels = CreateRgbePixels (37, 3, 1);
+	const auto rle = CreateRleRadiance (pixels, 37, 3);
+
+	for (std::size_t size = 0; size < rle.size (); ++size) {
+		CHECK_THROWS (LoadHdrImageFromMemory (rle.data (), size,
+			PixelFormat::R16G16B16A16_Float));
+	}
+
+	const auto flat = CreateFlatRadiance (pixels, 37, 3);
+	CHECK_THROWS (LoadHdrImageFromMemory (flat.data (), flat.size () - 1,
+		PixelFormat::R16G16B16A16_Float));
+
+	// The output format has to be one of the HDR formats
+	CHECK_THROWS (LoadHdrImageFromMemory (rle.data (), rle.size (),
+		PixelFormat::R8G8B8A8_UNorm));
+
+	const char* const headers [][2] = {
+		{ "FORMAT=32-bit_rle_xyze", "-Y 3 +X 37" },
+		{ "FORMAT=32-bit_rle_rgbe", "+X 37 -Y 3" },
+		{ "FORMAT=32-bit_rle_rgbe", "-Y 3 -X 37" },
+		{ "FORMAT=32-bit_rle_rgbe", "-Y 3" },
+		{ "FORMAT=32-bit_rle_rgbe", "-Y 0 +X 37" },
+		{ "FORMAT=32-bit_rle_rgbe", "-Y 3 +X -37" },
+		{ "FORMAT=32-bit_rle_rgbe", "-Y 100000 +X 100000" },
+		// Within the size limit, but with fewer bytes than scanlines
+		{ "FORMAT=32-bit_rle_rgbe", "-Y 16000 +X 16000" }
+	};
+
+	for (const auto& header : headers) {
+		auto data = CreateRadianceHeader (header [0], header [1]);
+		data.insert (data.end (), pixels.begin (), pixels.end ());
+		CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+			PixelFormat::R16G16B16A16_Float));
+	}
+
+	auto data = CreateFlatRadiance (pixels, 37, 3);
+	data [1] = '!';
+	CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+		PixelFormat::R16G16B16A16_Float));
+
+	// Runs and literals beyond the end of the scanline, an empty literal,
+	// and repeats without a previous pixel or beyond the end
+	const std::vector<Bytes> scanlines = {
+		{ 2, 2, 0, 8, 128 + 9, 1 },
+		{ 2, 2, 0, 8, 9, 1, 2, 3, 4, 5, 6, 7, 8, 9 },
+		{ 2, 2, 0, 8, 0 },
+		{ 1, 1, 1, 1, 1, 1, 1, 1 },
+		{ 1, 2, 3, 4, 1, 1, 1, 8 },
+		{ 1, 2, 3, 4, 1, 1, 1, 1, 1, 1, 1, 1 }
+	};
+
+	for (const auto& scanline : scanlines) {
+		auto data = CreateRadianceHeader (8, 1, false);
+		data.insert (data.end (), scanline.begin (), scanline.end ());
+		data.resize (data.size () + 64, 0);
+		CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+			PixelFormat::R16G16B16A16_Float));
+	}
+
+	CHECK_THROWS (LoadHdrImageFromMemory ("P6", 2, PixelFormat::R16G16B16A16_Float));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (UncompressedExrDecodes)
+{
+	const auto halfImage = CreateHalfExr (13, 37);
+	const auto expected = halfImage.Decode ();
+	CHECK (LoadsAs (CreateExr (halfImage, ExrCompression::None, ExrCompression::None),
+		expected));
+
+	// The half channels go straight through
+	const auto file = CreateExr (halfImage, ExrCompression::None, ExrCompression::None);
+	const auto image = LoadHdrImageFromMemory (file.data (), file.size (),
+		PixelFormat::R16G16B16A16_Float);
+	bool exact = true;
+	for (int y = 0; y < 37; ++y) {
+		for (int x = 0; x < 13; ++x) {
+			for (int c = 0; c < 4; ++c) {
+				exact = exact && std::memcmp (&image.data [y * image.rowPitch + x * 8 + c * 2],
+					&halfImage.channels [3 - c].data [(y * 13 + x) * 2], 2) == 0;
+			}
+		}
+	}
+	CHECK (exact);
+
+	// Missing green and alpha are 0 and 1
+	const auto floatImage = CreateFloatExr (9, 20);
+	CHECK (LoadsAs (CreateExr (floatImage, ExrCompression::None, ExrCompression::None),
+		floatImage.Decode ()));
+
+	auto withoutGreen = floatImage;
+	withoutGreen.channels.erase (withoutGreen.channels.begin () + 1);
+	const auto decoded = withoutGreen.Decode ();
+	CHECK (decoded.rgba [1] == 0 && decoded.rgba [3] == 1);
+	CHECK (LoadsAs (CreateExr (withoutGreen, ExrCompression::None, ExrCompression::None),
+		decoded));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ZipExrDecodes)
+{
+	for (const auto& image : { CreateHalfExr (13, 37), CreateFloatExr (9, 40) }) {
+		const auto expected = image.Decode ();
+
+		for (const auto compression : { ExrCompression::Zips, ExrCompression::Zip }) {
+			// Single lines of a narrow image are too short to compress well
+			const auto file = CreateExr (image, compression, compression);
+			if (compression == ExrCompression::Zip) {
+				CHECK (file.size () < CreateExr (image, ExrCompression::None,
+					ExrCompression::None).size ());
+			}
+			CHECK (LoadsAs (file, expected));
+
+			// Blocks which do not get smaller are stored uncompressed
+			CHECK (LoadsAs (CreateExr (image, compression, ExrCompression::None), expected));
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (PizExrDecodes)
+{
+	// Two blocks, the second one partial, with 14-bit and 16-bit wavelets
+	// and float channels split into two 16-bit planes
+	for (const auto& image : { CreateHalfExr (13, 37), CreateFloatExr (9, 40),
+		CreateWideRangeExr (), CreateHalfExr (1, 1) }) {
+		const auto expected = image.Decode ();
+
+		const auto file = CreateExr (image, ExrCompression::Piz, ExrCompression::Piz);
+		CHECK (LoadsAs (file, expected));
+		CHECK (LoadsAs (CreateExr (image, ExrCompression::Piz, ExrCompression::None),
+			expected));
+
+		if (image.width == 256) {
+			CHECK (file.size () < CreateExr (image, ExrCompression::None,
+				ExrCompression::None).size () / 2);
+		}
+	}
+
+	// Only zeros, where the bitmap is empty
+	auto zeros = CreateHalfExr (13, 37);
+	for (auto& channel : zeros.channels) {
+		std::fill (channel.data.begin (), channel.data.end (), 0);
+	}
+	CHECK (LoadsAs (CreateExr (zeros, ExrCompression::Piz, ExrCompression::Piz),
+		zeros.Decode ()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidExrImagesThrow)
+{
+	const auto image = CreateHalfExr (13, 37);
+
+	// A smaller image with two blocks of each compression, every PIZ block
+	// decode sets up tables for all 16-bit values
+	for (const auto compression : { ExrCompression::None, ExrCompression::Zip,
+		ExrCompression::Piz }) {
+		const auto file = CreateExr (CreateHalfExr (3, 33), compression, compression);
+
+		for (std::size_t size = 0; size < file.size (); ++size) {
+			CHECK_THROWS (LoadHdrImageFromMemory (file.data (), size,
+				PixelFormat::R16G16B16A16_Float));
+		}
+	}
+
+	// Unsupported versions and flags, RLE and PXR24 compression
+	const auto file = CreateExr (image, ExrCompression::None, ExrCompression::None);
+	for (const auto version : { 1u, 3u, 2u | 0x200u, 2u | 0x800u, 2u | 0x1000u }) {
+		auto data = file;
+		std::memcpy (&data [4], &version, 4);
+		CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+			PixelFormat::R16G16B16A16_Float));
+	}
+
+	for (const auto compression : { ExrCompression::Rle, static_cast<ExrCompression> (5) }) {
+		const auto data = CreateExr (image, compression, ExrCompression::None);
+		CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+			PixelFormat::R16G16B16A16_Float));
+	}
+
+	// No channels, an invalid channel type, subsampling
+	auto damaged = image;
+	damaged.channels.clear ();
+	const auto withoutChannels = CreateExr (damaged, ExrCompression::None,
+		ExrCompression::None);
+	CHECK_THROWS (LoadHdrImageFromMemory (withoutChannels.data (), withoutChannels.size (),
+		PixelFormat::R16G16B16A16_Float));
+
+	const auto replace = [&] (const Bytes& pattern, const Bytes& replacement) {
+		auto data = file;
+		const auto position = std::search (data.begin (), data.end (),
+			pattern.begin (), pattern.end ());
+		CHECK (position != data.end ());
+		std::copy (replacement.begin (), replacement.end (), position);
+		return data;
+	};
+
+	// The channel list entry of the depth channel: name, type 2, pLinear
+	// and reserved, sampling 1 and 1
+	const Bytes depth = { 'Z', 0, 2, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0 };
+	for (const auto& replacement : {
+		Bytes { 'Z', 0, 3 }, Bytes { 'Z', 0, 2, 0, 0, 0, 0, 0, 0, 0, 2 },
+		Bytes { 'Z', 0, 2, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0 } }) {
+		const auto data = replace (depth, replacement);
+		CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+			PixelFormat::R16G16B16A16_Float));
+	}
+
+	// The data window is (3, -5) to (15, 31). An empty one, and one which
+	// is within the size limit, but has more lines than the file has
+	// entries in its offset table
+	const Bytes dataWindow = { 3, 0, 0, 0, 0xFB, 0xFF, 0xFF, 0xFF, 15, 0, 0, 0, 31, 0, 0, 0 };
+	for (const auto& replacement : {
+		Bytes { 3, 0, 0, 0, 0xFB, 0xFF, 0xFF, 0xFF, 1, 0, 0, 0 },
+		Bytes { 3, 0, 0, 0, 0xFB, 0xFF, 0xFF, 0xFF, 15, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0 } }) {
+		const auto data = replace (dataWindow, replacement);
+		CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+			PixelFormat::R16G16B16A16_Float));
+	}
+
+	// Blocks pointing outside the file, and blocks for lines outside the
+	// image or with the wrong size
+	const auto headerSize = file.size () - 37 * (8 + 8 + 13 * 2 * 4 + 13 * 4);
+	const auto damage = [&] (const std::size_t offset, const std::uint32_t value) {
+		auto data = file;
+		std::memcpy (&data [offset], &value, 4);
+		CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+			PixelFormat::R16G16B16A16_Float));
+	};
+
+	damage (headerSize, static_cast<std::uint32_t> (file.size ()));
+	damage (headerSize + 4, 1);
+	const auto firstBlock = headerSize + 37 * 8;
+	damage (firstBlock, static_cast<std::uint32_t> (-6));
+	damage (firstBlock, 32);
+	damage (firstBlock + 4, 13 * 2 * 4 + 13 * 4 - 1);
+
+	// Single-block images, with the block replaced by a ZIP stream of the
+	// wrong size, and PIZ streams with invalid Huffman headers and bitmaps
+	const auto smallImage = CreateHalfExr (13, 16);
+	const std::size_t blockSize = 16 * 13 * (2 * 4 + 4);
+	const auto replaceBlock = [&] (const ExrCompression compression, const Bytes& block) {
+		auto data = CreateExr (smallImage, compression, compression);
+
+		// The only entry of the offset table points right behind itself
+		std::size_t offsetTable = 8;
+		for (;; ++offsetTable) {
+			std::uint64_t offset;
+			std::memcpy (&offset, &data [offsetTable], 8);
+			if (offset == offsetTable + 8) {
+				break;
+			}
+		}
+
+		data.resize (offsetTable + 8 + 4);
+		AppendLittleEndian (data, static_cast<std::uint32_t> (block.size ()));
+		data.insert (data.end (), block.begin (), block.end ());
+		return data;
+	};
+
+	for (const auto size : { blockSize - 1, blockSize + 1 }) {
+		const Bytes zeros (size, 0);
+		const auto data = replaceBlock (ExrCompression::Zip,
+			ZlibCompress (zeros.data (), zeros.size ()));
+		CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+			PixelFormat::R16G16B16A16_Float));
+	}
+
+	// An empty bitmap, followed by a Huffman stream
+	const auto createPizBlock = [] (const std::uint32_t minSymbol,
+		const std::uint32_t maxSymbol, const std::uint32_t bitCount, const Bytes& table) {
+		Bytes result = { 0xFF, 0x1F, 0, 0 };
+		AppendLittleEndian (result, static_cast<std::uint32_t> (20 + table.size ()));
+		AppendLittleEndian (result, minSymbol);
+		AppendLittleEndian (result, maxSymbol);
+		AppendLittleEndian (result, static_cast<std::uint32_t> (table.size ()));
+		AppendLittleEndian (result, bitCount);
+		AppendLittleEndian (result, std::uint32_t (0));
+		result.insert (result.end (), table.begin (), table.end ());
+		return result;
+	};
+
+	// Symbols 0 and 1 with one-bit codes
+	const Bytes table = { 0x04, 0x10 };
+	const std::vector<Bytes> pizBlocks = {
+		// Bitmap beyond 8 KiB, and a Huffman stream larger than the block
+		{ 0, 0, 0, 0x20, 0, 0, 0, 0 },
+		{ 0xFF, 0x1F, 0, 0, 0xE8, 0x03, 0, 0, 0 },
+		createPizBlock (0, 65537, 0, table),
+		createPizBlock (5, 3, 0, table),
+		// More bits than the stream has, and too few values
+		createPizBlock (0, 1, 1000, table),
+		createPizBlock (0, 1, 8, { 0x04, 0x10, 0x00 }),
+		// A run at the start, and a code length table which is cut off
+		createPizBlock (0, 1, 9, { 0x04, 0x10, 0x80, 0x00 }),
+		createPizBlock (0, 1, 0, { 0x04 })
+	};
+
+	for (const auto& block : pizBlocks) {
+		const auto data = replaceBlock (ExrCompression::Piz, block);
+		CHECK_THROWS (LoadHdrImageFromMemory (data.data (), data.size (),
+			PixelFormat::R16G16B16A16_Float));
+	}
+
+	// The same with a valid stream decodes
+	CHECK (LoadsAs (replaceBlock (ExrCompression::Piz,
+		CompressExrPiz (smallImage, 0, 16)), smallImage.Decode ()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (DamagedExrStaysInBounds)
+{
+	std::mt19937 random (42);
+	std::uniform_int_distribution<int> byte (0, 255);
+
+	for (const auto compression : { ExrCompression::Zip, ExrCompression::Piz }) {
+		const auto file = CreateExr (CreateHalfExr (13, 37), compression, compression);
+		std::uniform_int_distribution<std::size_t> position (0, file.size () - 1);
+
+		int rejected = 0;
+		for (int i = 0; i < 300; ++i) {
+			auto damaged = file;
+			damaged [position (random)] = static_cast<std::uint8_t> (byte (random));
+			if (IsRejected (damaged)) {
+				++rejected;
+			}
+		}
+
+		// Most damage hits pixel data, which is not checked by the format
+		CHECK (rejected > 0 && rejected < 300);
+	}
+}
@@ -0,0 +1,308 @@
+#include "Test.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Deflate.h"
+#include "ImageEncoder.h"
+#include "ImageIO.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+typedef std::vector<std::uint8_t> Bytes;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Pixels with flat areas, gradients and noise, so all PNG filters and
+QOI operations get used. The padding after each row is filled with
+garbage, which must not end up in the image.
+*/
+Bytes CreatePixels (const int width, const int height, const int rowPitch,
+	const std::uint32_t seed = 42)
+{
+	std::mt19937 random (seed);
+	std::uniform_int_distribution<int> byte (0, 255);
+
+	Bytes pixels (rowPitch * height);
+	for (auto& value : pixels) {
+		value = static_cast<std::uint8_t> (byte (random));
+	}
+
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			auto pixel = &pixels [y * rowPitch + x * 4];
+			if (x < width / 3) {
+				pixel [0] = 200; pixel [1] = 80; pixel [2] = 64; pixel [3] = 255;
+			} else if (x < 2 * width / 3) {
+				pixel [0] = static_cast<std::uint8_t> (x);
+				pixel [1] = static_cast<std::uint8_t> (y);
+				pixel [2] = static_cast<std::uint8_t> (x + y);
+				pixel [3] = static_cast<std::uint8_t> (255 - y);
+			}
+		}
+	}
+
+	return pixels;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Bytes CreateRandomBytes (const std::size_t size, const int range,
+	const std::uint32_t seed = 42)
+{
+	std::mt19937 random (seed);
+	std::uniform_int_distribution<int> byte (0, range - 1);
+
+	Bytes result (size);
+	for (auto& value : result) {
+		value = static_cast<std::uint8_t> (byte (random));
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t ReadBigEndian (const std::uint8_t* data)
+{
+	return (static_cast<std::uint32_t> (data [0]) << 24) |
+		(static_cast<std::uint32_t> (data [1]) << 16) |
+		(static_cast<std::uint32_t> (data [2]) << 8) | data [3];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Decode with LoadImageFromMemory without row padding and compare against
+the source pixels, ignoring the padding of the source rows.
+*/
+bool RoundTrips (const Bytes& encoded, const Bytes& pixels,
+	const int width, const int height, const int rowPitch)
+{
+	int decodedWidth = 0, decodedHeight = 0;
+	const auto decoded = LoadImageFromMemory (encoded.data (), encoded.size (),
+		1, &decodedWidth, &decodedHeight);
+
+	if (decodedWidth != width || decodedHeight != height ||
+		decoded.size () != static_cast<std::size_t> (width * height * 4)) {
+		return false;
+	}
+
+	for (int y = 0; y < height; ++y) {
+		if (std::memcmp (decoded.data () + y * width * 4,
+			pixels.data () + y * rowPitch, width * 4) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Walk the chunks of a PNG, check their CRCs and the header, and return the
+decompressed image data.
+*/
+Bytes ReadPngImageData (const Bytes& png, const int width, const int height)
+{
+	const std::uint8_t signature [] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	CHECK (png.size () > 8 && std::memcmp (png.data (), signature, 8) == 0);
+
+	std::vector<std::string> chunkTypes;
+	Bytes imageData;
+
+	for (std::size_t offset = 8; offset + 12 <= png.size (); ) {
+		const auto length = ReadBigEndian (&png [offset]);
+		CHECK (offset + 12 + length <= png.size ());
+		if (offset + 12 + length > png.size ()) {
+			break;
+		}
+
+		const auto type = &png [offset + 4];
+		const auto data = &png [offset + 8];
+		chunkTypes.emplace_back (reinterpret_cast<const char*> (type), 4);
+
+		// The CRC covers the type and the data
+		CHECK (Crc32 (type, length + 4) == ReadBigEndian (data + length));
+
+		if (chunkTypes.back () == "IHDR") {
+			CHECK (length == 13);
+			CHECK (ReadBigEndian (data) == static_cast<std::uint32_t> (width));
+			CHECK (ReadBigEndian (data + 4) == static_cast<std::uint32_t> (height));
+			// 8 bits, RGBA, deflate, adaptive filtering, not interlaced
+			CHECK (data [8] == 8 && data [9] == 6);
+			CHECK (data [10] == 0 && data [11] == 0 && data [12] == 0);
+		} else if (chunkTypes.back () == "IDAT") {
+			imageData.insert (imageData.end (), data, data + length);
+		}
+
+		offset += 12 + length;
+	}
+
+	CHECK (chunkTypes.size () >= 3);
+	CHECK (chunkTypes.front () == "IHDR");
+	CHECK (chunkTypes.back () == "IEND");
+
+	const auto rows = ZlibDecompress (imageData.data (), imageData.size ());
+	CHECK (rows.size () == static_cast<std::size_t> (height * (1 + width * 4)));
+
+	// Each row starts with its filter type
+	for (std::size_t row = 0; row < rows.size (); row += 1 + width * 4) {
+		CHECK (rows [row] <= 4);
+	}
+
+	return rows;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ChecksumsMatchReferenceValues)
+{
+	const char text [] = "123456789";
+	CHECK (Crc32 (text, 9) == 0xCBF43926);
+	CHECK (Adler32 (text, 9) == 0x091E01DE);
+	CHECK (Adler32 ("Wikipedia", 9) == 0x11E60398);
+	CHECK (Adler32 (text, 0) == 1);
+
+	// Incremental checksums continue where the previous call stopped
+	CHECK (Crc32 (text + 4, 5, Crc32 (text, 4)) == 0xCBF43926);
+	CHECK (Adler32 (text + 4, 5, Adler32 (text, 4)) == 0x091E01DE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (Adler32CombineMatchesChecksumOfConcatenation)
+{
+	// All bytes 255 maximize the sums, large blocks wrap the modulus many
+	// times
+	Bytes data = CreateRandomBytes (300000, 256);
+	std::fill (data.begin () + 100000, data.begin () + 200000, 255);
+
+	const std::size_t splits [] = { 0, 1, 5552, 65521, 100000, 150000, 299999, 300000 };
+	for (const auto split : splits) {
+		const auto first = Adler32 (data.data (), split);
+		const auto second = Adler32 (data.data () + split, data.size () - split);
+
+		CHECK (Adler32Combine (first, second, data.size () - split) ==
+			Adler32 (data.data (), data.size ()));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ZlibStreamsRoundTrip)
+{
+	ThreadPool threadPool (3);
+
+	// Sizes around the 256 KiB chunks which are compressed in parallel
+	const std::size_t sizes [] = { 0, 1, 1000, 256 * 1024, 256 * 1024 + 1, 1000000 };
+	for (const auto size : sizes) {
+		// Incompressible, and with few symbols and long matches
+		for (const int range : { 256, 4 }) {
+			const auto data = CreateRandomBytes (size, range);
+			const auto compressed = ZlibCompress (data.data (), data.size ());
+
+			// Deflate with a 32 KiB window, and a valid header check
+			CHECK (compressed.size () >= 6);
+			CHECK (compressed [0] == 0x78);
+			CHECK (((compressed [0] << 8) | compressed [1]) % 31 == 0);
+			CHECK (ReadBigEndian (&compressed [compressed.size () - 4]) ==
+				Adler32 (data.data (), data.size ()));
+
+			CHECK (ZlibDecompress (compressed.data (), compressed.size ()) == data);
+
+			// The chunks do not depend on the thread pool
+			CHECK (ZlibCompress (data.data (), data.size (), &threadPool) == compressed);
+
+			// Two bits of entropy per byte, and incompressible data falls
+			// back to stored blocks
+			if (range == 4) {
+				CHECK (compressed.size () < size * 2 / 5 + 16);
+			} else {
+				CHECK (compressed.size () < size + size / 1000 + 16);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (DamagedZlibStreamsThrow)
+{
+	const auto data = CreateRandomBytes (10000, 16);
+	auto compressed = ZlibCompress (data.data (), data.size ());
+
+	CHECK_THROWS (ZlibDecompress (compressed.data (), compressed.size () - 5));
+	CHECK_THROWS (ZlibDecompress (compressed.data (), 1));
+
+	compressed.back () ^= 1;
+	CHECK_THROWS (ZlibDecompress (compressed.data (), compressed.size ()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (PngRoundTrips)
+{
+	ThreadPool threadPool (3);
+
+	// Odd widths, padded rows, and an image large enough to be compressed
+	// in several chunks
+	const int sizes [][3] = {
+		{ 1, 1, 4 }, { 37, 13, 37 * 4 }, { 37, 13, 256 }, { 301, 517, 1216 }
+	};
+
+	for (const auto& size : sizes) {
+		const int width = size [0], height = size [1], rowPitch = size [2];
+		const auto pixels = CreatePixels (width, height, rowPitch);
+
+		const auto png = EncodePng (pixels.data (), width, height, rowPitch);
+		const auto rows = ReadPngImageData (png, width, height);
+		CHECK (RoundTrips (png, pixels, width, height, rowPitch));
+
+		const auto parallel = EncodePng (pixels.data (), width, height,
+			rowPitch, &threadPool);
+		CHECK (parallel == png);
+
+		if (width == 301) {
+			CHECK (rows.size () > 2 * 256 * 1024);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (QoiRoundTrips)
+{
+	const int sizes [][3] = {
+		{ 1, 1, 4 }, { 37, 13, 37 * 4 }, { 37, 13, 256 }, { 301, 517, 1216 }
+	};
+
+	for (const auto& size : sizes) {
+		const int width = size [0], height = size [1], rowPitch = size [2];
+		const auto pixels = CreatePixels (width, height, rowPitch);
+
+		const auto qoi = EncodeQoi (pixels.data (), width, height, rowPitch);
+		CHECK (qoi.size () > 14 + 8);
+		CHECK (std::memcmp (qoi.data (), "qoif", 4) == 0);
+		CHECK (ReadBigEndian (&qoi [4]) == static_cast<std::uint32_t> (width));
+		CHECK (ReadBigEndian (&qoi [8]) == static_cast<std::uint32_t> (height));
+		CHECK (qoi [12] == 4);
+
+		// The stream ends with seven zeros and a one
+		const std::uint8_t end [] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+		CHECK (std::memcmp (&qoi [qoi.size () - 8], end, 8) == 0);
+
+		CHECK (RoundTrips (qoi, pixels, width, height, rowPitch));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (RawImagesKeepThePadding)
+{
+	const int width = 37, height = 13, rowPitch = 256;
+	const auto pixels = CreatePixels (width, height, rowPitch);
+
+	const auto raw = EncodeRaw (pixels.data (), width, height, rowPitch);
+	CHECK (raw.size () == 16 + static_cast<std::size_t> (rowPitch * height));
+	CHECK (std::memcmp (raw.data (), RAW_IMAGE_MAGIC, 4) == 0);
+	CHECK (std::memcmp (raw.data () + 16, pixels.data (), pixels.size ()) == 0);
+
+	CHECK (RoundTrips (raw, pixels, width, height, rowPitch));
+}
@@ -0,0 +1,286 @@
+#include "Test.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ImageEncoder.h"
+#include "ImageIO.h"
+
+using namespace anteru;
+
+namespace {
+typedef std::vector<std::uint8_t> Bytes;
+
+///////////////////////////////////////////////////////////////////////////////
+void WriteBigEndian (Bytes& output, const std::uint32_t value)
+{
+	output.push_back (static_cast<std::uint8_t> (value >> 24));
+	output.push_back (static_cast<std::uint8_t> (value >> 16));
+	output.push_back (static_cast<std::uint8_t> (value >> 8));
+	output.push_back (static_cast<std::uint8_t> (value));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WriteLittleEndian (Bytes& output, const std::uint32_t value)
+{
+	output.push_back (static_cast<std::uint8_t> (value));
+	output.push_back (static_cast<std::uint8_t> (value >> 8));
+	output.push_back (static_cast<std::uint8_t> (value >> 16));
+	output.push_back (static_cast<std::uint8_t> (value >> 24));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Bytes CreateQoi (const std::uint32_t width, const std::uint32_t height,
+	const int channels, const Bytes& operations)
+{
+	Bytes result = { 'q', 'o', 'i', 'f' };
+	WriteBigEndian (result, width);
+	WriteBigEndian (result, height);
+	result.push_back (static_cast<std::uint8_t> (channels));
+	result.push_back (0);
+	result.insert (result.end (), operations.begin (), operations.end ());
+
+	const std::uint8_t endMarker [] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	result.insert (result.end (), endMarker, endMarker + 8);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+Bytes CreateRaw (const std::uint32_t width, const std::uint32_t height,
+	const std::uint32_t rowPitch, const Bytes& pixels)
+{
+	Bytes result (RAW_IMAGE_MAGIC, RAW_IMAGE_MAGIC + 4);
+	WriteLittleEndian (result, width);
+	WriteLittleEndian (result, height);
+	WriteLittleEndian (result, rowPitch);
+	result.insert (result.end (), pixels.begin (), pixels.end ());
+	return result;
+}
+
+// A 4x3 image using every QOI operation, with a run which continues into
+// the next row, and a difference which wraps around
+const Bytes QOI_OPERATIONS = {
+	0xFE, 10, 20, 30,			// RGB
+	0x72,						// DIFF +1 -2 +0
+	0xA5, 0x5F,					// LUMA dg +5, dr -3, db +7
+	0xFF, 200, 100, 50, 128,	// RGBA
+	0x09,						// INDEX of (10, 20, 30, 255)
+	0xC4,						// RUN of 5
+	0xFE, 0, 255, 0,			// RGB
+	0x5C						// DIFF -1 +1 -2
+};
+
+const std::uint8_t QOI_PIXELS [12][4] = {
+	{ 10, 20, 30, 255 }, { 11, 18, 30, 255 }, { 13, 23, 42, 255 }, { 200, 100, 50, 128 },
+	{ 10, 20, 30, 255 }, { 10, 20, 30, 255 }, { 10, 20, 30, 255 }, { 10, 20, 30, 255 },
+	{ 10, 20, 30, 255 }, { 10, 20, 30, 255 }, { 0, 255, 0, 255 }, { 255, 0, 254, 255 }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+bool MatchesQoiPixels (const Bytes& image, const int rowPitch)
+{
+	for (int i = 0; i < 12; ++i) {
+		if (std::memcmp (&image [(i / 4) * rowPitch + (i % 4) * 4],
+			QOI_PIXELS [i], 4) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Decode data, and return whether it was rejected. Either outcome is fine for
+damaged images, as long as the decoder stays within its buffers, which the
+sanitizer builds check.
+*/
+bool IsRejected (const Bytes& data)
+{
+	try {
+		int width = 0, height = 0;
+		const auto image = LoadImageFromMemory (data.data (), data.size (), 1,
+			&width, &height);
+		return image.size () != static_cast<std::size_t> (width * height * 4);
+	} catch (...) {
+		return true;
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (EveryQoiOperationDecodes)
+{
+	const auto qoi = CreateQoi (4, 3, 4, QOI_OPERATIONS);
+
+	int width = 0, height = 0;
+	const auto image = LoadImageFromMemory (qoi.data (), qoi.size (), 1,
+		&width, &height);
+	CHECK (width == 4 && height == 3);
+	CHECK (image.size () == 4 * 3 * 4);
+	CHECK (MatchesQoiPixels (image, 16));
+
+	// Rows padded to 64 pixels
+	const auto padded = LoadImageFromMemory (qoi.data (), qoi.size (), 64,
+		nullptr, nullptr);
+	CHECK (padded.size () == 64 * 3 * 4);
+	CHECK (MatchesQoiPixels (padded, 256));
+
+	// The channel count is informative only, RGBA operations still set alpha
+	const auto rgb = CreateQoi (4, 3, 3, QOI_OPERATIONS);
+	CHECK (MatchesQoiPixels (LoadImageFromMemory (rgb.data (), rgb.size (), 1,
+		nullptr, nullptr), 16));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (QoiRunsFillTheImage)
+{
+	// Runs of 62, 62 and 1 pixels cover several rows each, without
+	// any other operation the pixel stays opaque black
+	const auto qoi = CreateQoi (5, 25, 4, { 0xFD, 0xFD, 0xC0 });
+	const auto image = LoadImageFromMemory (qoi.data (), qoi.size (), 1,
+		nullptr, nullptr);
+	CHECK (image.size () == 5 * 25 * 4);
+
+	bool black = true;
+	for (std::size_t i = 0; i < image.size (); i += 4) {
+		black = black && image [i] == 0 && image [i + 1] == 0 &&
+			image [i + 2] == 0 && image [i + 3] == 255;
+	}
+	CHECK (black);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (TruncatedQoiThrows)
+{
+	const auto qoi = CreateQoi (4, 3, 4, QOI_OPERATIONS);
+
+	// Every prefix is missing at least one operation, as the last 8 bytes
+	// are treated as the end marker
+	for (std::size_t size = 0; size < qoi.size (); ++size) {
+		CHECK_THROWS (LoadImageFromMemory (qoi.data (), size, 1, nullptr, nullptr));
+	}
+
+	// Operations which are cut off by the end marker
+	for (const auto& operations : { Bytes { 0xFE, 1, 2 }, Bytes { 0xFF, 1, 2, 3 },
+		Bytes { 0xA5 } }) {
+		const auto cut = CreateQoi (1, 1, 4, operations);
+		CHECK_THROWS (LoadImageFromMemory (cut.data (), cut.size (), 1, nullptr, nullptr));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidQoiHeadersThrow)
+{
+	// More pixels than operations
+	auto qoi = CreateQoi (4, 4, 4, QOI_OPERATIONS);
+	CHECK_THROWS (LoadImageFromMemory (qoi.data (), qoi.size (), 1, nullptr, nullptr));
+
+	// Empty and oversized images are rejected before allocating memory
+	const std::uint32_t sizes [][2] = {
+		{ 0, 3 }, { 4, 0 }, { 0x80000000u, 1 }, { 0xFFFFFFFFu, 0xFFFFFFFFu }, { 65536, 65536 }
+	};
+
+	for (const auto& size : sizes) {
+		qoi = CreateQoi (size [0], size [1], 4, QOI_OPERATIONS);
+		CHECK_THROWS (LoadImageFromMemory (qoi.data (), qoi.size (), 1, nullptr, nullptr));
+	}
+
+	qoi = CreateQoi (4, 3, 5, QOI_OPERATIONS);
+	CHECK_THROWS (LoadImageFromMemory (qoi.data (), qoi.size (), 1, nullptr, nullptr));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (DamagedQoiStaysInBounds)
+{
+	std::mt19937 random (42);
+	std::uniform_int_distribution<int> byte (0, 255);
+
+	Bytes pixels (16 * 16 * 4);
+	for (std::size_t i = 0; i < pixels.size (); ++i) {
+		pixels [i] = static_cast<std::uint8_t> ((i % 7 == 0) ? byte (random) : i / 64);
+	}
+
+	const auto qoi = EncodeQoi (pixels.data (), 16, 16, 16 * 4);
+	std::uniform_int_distribution<std::size_t> position (14, qoi.size () - 1);
+
+	int rejected = 0;
+	for (int i = 0; i < 2000; ++i) {
+		auto damaged = qoi;
+		damaged [position (random)] = static_cast<std::uint8_t> (byte (random));
+		damaged [position (random)] = static_cast<std::uint8_t> (byte (random));
+		damaged.resize (damaged.size () - (i % 4) * 5);
+
+		if (IsRejected (damaged)) {
+			++rejected;
+		}
+	}
+
+	// Damaged operations often turn into runs, which cover the image no
+	// matter what follows, so about half of the images still decode
+	CHECK (rejected > 0 && rejected < 2000);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (RawImagesHonorTheRowPitch)
+{
+	// 3x2 pixels, with rows every 20 bytes and garbage in between
+	Bytes pixels (20 + 12);
+	for (std::size_t i = 0; i < pixels.size (); ++i) {
+		pixels [i] = static_cast<std::uint8_t> (i + 1);
+	}
+	std::memset (&pixels [12], 0xEE, 8);
+
+	// The last row does not need to be padded
+	const auto raw = CreateRaw (3, 2, 20, pixels);
+
+	int width = 0, height = 0;
+	auto image = LoadImageFromMemory (raw.data (), raw.size (), 1, &width, &height);
+	CHECK (width == 3 && height == 2);
+	CHECK (image.size () == 24);
+	CHECK (std::memcmp (image.data (), &pixels [0], 12) == 0);
+	CHECK (std::memcmp (image.data () + 12, &pixels [20], 12) == 0);
+
+	// Decoding into padded rows, and with a pitch which matches them
+	image = LoadImageFromMemory (raw.data (), raw.size (), 64, nullptr, nullptr);
+	CHECK (image.size () == 256 * 2);
+	CHECK (std::memcmp (image.data (), &pixels [0], 12) == 0);
+	CHECK (std::memcmp (image.data () + 256, &pixels [20], 12) == 0);
+
+	Bytes aligned (256 + 12, 0x55);
+	const auto alignedRaw = CreateRaw (3, 2, 256, aligned);
+	image = LoadImageFromMemory (alignedRaw.data (), alignedRaw.size (), 64, nullptr, nullptr);
+	CHECK (image.size () == 256 * 2);
+	CHECK (std::memcmp (image.data (), aligned.data (), 12) == 0);
+	CHECK (std::memcmp (image.data () + 256, aligned.data () + 256, 12) == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidRawImagesThrow)
+{
+	const Bytes pixels (20 + 12, 0x11);
+
+	// Missing the last byte, rows overlapping each other, and too many rows
+	auto raw = CreateRaw (3, 2, 20, pixels);
+	CHECK_THROWS (LoadImageFromMemory (raw.data (), raw.size () - 1, 1, nullptr, nullptr));
+
+	raw = CreateRaw (3, 2, 8, pixels);
+	CHECK_THROWS (LoadImageFromMemory (raw.data (), raw.size (), 1, nullptr, nullptr));
+
+	raw = CreateRaw (3, 3, 20, pixels);
+	CHECK_THROWS (LoadImageFromMemory (raw.data (), raw.size (), 1, nullptr, nullptr));
+
+	raw = CreateRaw (0, 2, 20, pixels);
+	CHECK_THROWS (LoadImageFromMemory (raw.data (), raw.size (), 1, nullptr, nullptr));
+
+	// A pitch which would overflow when multiplied with the height
+	raw = CreateRaw (3, 0x10000, 0xFFFFFFFFu, pixels);
+	CHECK_THROWS (LoadImageFromMemory (raw.data (), raw.size (), 1, nullptr, nullptr));
+
+	// Only the header
+	raw = CreateRaw (3, 2, 20, {});
+	CHECK_THROWS (LoadImageFromMemory (raw.data (), 15, 1, nullptr, nullptr));
+	CHECK_THROWS (LoadImageFromMemory (raw.data (), raw.size (), 1, nullptr, nullptr));
+}
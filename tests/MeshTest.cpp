@@ -0,0 +1,204 @@
+#include "Test.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+Mesh LoadObj (const std::string& text)
+{
+	return anteru::LoadObj (text.data (), text.size ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void AddUInt32 (std::vector<std::uint8_t>& output, const std::uint32_t value)
+{
+	for (int i = 0; i < 4; ++i) {
+		output.push_back (static_cast<std::uint8_t> (value >> (i * 8)));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Binary glTF file with a JSON and a binary chunk, each padded to four
+bytes.
+*/
+std::vector<std::uint8_t> CreateGlb (std::string json,
+	std::vector<std::uint8_t> buffer)
+{
+	json.resize ((json.size () + 3) & ~std::size_t (3), ' ');
+	buffer.resize ((buffer.size () + 3) & ~std::size_t (3), 0);
+
+	std::vector<std::uint8_t> result;
+	AddUInt32 (result, 0x46546C67);
+	AddUInt32 (result, 2);
+	AddUInt32 (result, static_cast<std::uint32_t> (12 + 8 + json.size () + 8 + buffer.size ()));
+
+	AddUInt32 (result, static_cast<std::uint32_t> (json.size ()));
+	AddUInt32 (result, 0x4E4F534A);
+	result.insert (result.end (), json.begin (), json.end ());
+
+	AddUInt32 (result, static_cast<std::uint32_t> (buffer.size ()));
+	AddUInt32 (result, 0x004E4942);
+	result.insert (result.end (), buffer.begin (), buffer.end ());
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+One primitive with three float positions and indexCount 32-bit indices,
+all pointing at the first vertices.
+*/
+std::vector<std::uint8_t> CreateTriangleGlb (const int indexCount)
+{
+	std::vector<std::uint8_t> buffer;
+	const float positions [] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+	for (const auto position : positions) {
+		std::uint32_t bits;
+		std::memcpy (&bits, &position, sizeof (bits));
+		AddUInt32 (buffer, bits);
+	}
+
+	for (int i = 0; i < indexCount; ++i) {
+		AddUInt32 (buffer, i % 3);
+	}
+
+	const auto indexSize = std::to_string (indexCount * 4);
+	const auto json =
+		"{\"asset\":{\"version\":\"2.0\"},"
+		"\"buffers\":[{\"byteLength\":" + std::to_string (buffer.size ()) + "}],"
+		"\"bufferViews\":[{\"buffer\":0,\"byteLength\":36},"
+		"{\"buffer\":0,\"byteOffset\":36,\"byteLength\":" + indexSize + "}],"
+		"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+		"{\"bufferView\":1,\"componentType\":5125,\"count\":" + std::to_string (indexCount) +
+		",\"type\":\"SCALAR\"}],"
+		"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1}]}]}";
+
+	return CreateGlb (json, buffer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The message of the exception function throws, or an empty string.
+*/
+template <typename Function>
+std::string GetError (const Function& function)
+{
+	try {
+		function ();
+	} catch (const std::runtime_error& error) {
+		return error.what ();
+	}
+
+	return std::string ();
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ObjPolygonsAreSplitIntoTriangles)
+{
+	const auto mesh = LoadObj (
+		"# Quad\n"
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vt 0.25 0.75\n"
+		"f 1/1 2/1 3/1 4/1\n");
+
+	CHECK (mesh.indices.size () == 6);
+	CHECK (mesh.vertices.size () == 6);
+
+	// Not indexed yet, every corner has its own vertex
+	CHECK (mesh.vertices [3].position [0] == 0);
+	CHECK (mesh.vertices [5].position [1] == 1);
+
+	// The origin moves to the upper left corner
+	CHECK (mesh.vertices [0].uv [0] == 0.25f);
+	CHECK (mesh.vertices [0].uv [1] == 0.25f);
+
+	// Without normals in the file, they are computed from the faces
+	CHECK (std::abs (mesh.vertices [0].normal [2]) == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ObjFacesWithInvalidIndicesThrow)
+{
+	CHECK (GetError ([] () { LoadObj ("v 0 0 0\nv 1 0 0\nf 1 2 3\n"); }) ==
+		"Invalid OBJ face index.");
+	CHECK (GetError ([] () { LoadObj ("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 -4\n"); }) ==
+		"Invalid OBJ face index.");
+	CHECK (GetError ([] () { LoadObj ("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1/1 2 3\n"); }) ==
+		"Invalid OBJ face index.");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ObjWithoutTrianglesThrows)
+{
+	const char* texts [] = {
+		"",
+		"# Nothing but a comment\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\n",
+		// Lines and points are not faces
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2\nl 1 2 3\np 1\n"
+	};
+
+	for (const auto text : texts) {
+		CHECK (GetError ([=] () { LoadObj (text); }) == "Mesh contains no triangles.");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (GlbTrianglesAreLoaded)
+{
+	const auto glb = CreateTriangleGlb (6);
+	const auto mesh = LoadGlb (glb.data (), glb.size ());
+
+	CHECK (mesh.vertices.size () == 3);
+	CHECK (mesh.indices.size () == 6);
+	CHECK (mesh.vertices [1].position [0] == 1);
+	CHECK (std::abs (mesh.vertices [0].normal [2]) == 1);
+
+	// Trailing indices which don't form a triangle are dropped
+	const auto partial = CreateTriangleGlb (5);
+	CHECK (LoadGlb (partial.data (), partial.size ()).indices.size () == 3);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (GlbWithoutTrianglesThrows)
+{
+	for (const int indexCount : { 0, 2 }) {
+		const auto glb = CreateTriangleGlb (indexCount);
+		CHECK (GetError ([&] () { LoadGlb (glb.data (), glb.size ()); }) ==
+			"Mesh contains no triangles.");
+	}
+
+	const auto empty = CreateGlb ("{\"asset\":{\"version\":\"2.0\"}}", {});
+	CHECK (GetError ([&] () { LoadGlb (empty.data (), empty.size ()); }) ==
+		"Mesh contains no triangles.");
+
+	const auto noPrimitives = CreateGlb (
+		"{\"asset\":{\"version\":\"2.0\"},\"meshes\":[{\"primitives\":[]}]}", {});
+	CHECK (GetError ([&] () { LoadGlb (noPrimitives.data (), noPrimitives.size ()); }) ==
+		"Mesh contains no triangles.");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidGlbThrows)
+{
+	auto glb = CreateTriangleGlb (3);
+	glb [0] ^= 1;
+	CHECK (GetError ([&] () { LoadGlb (glb.data (), glb.size ()); }) ==
+		"Invalid binary glTF file.");
+
+	// Index past the three vertices
+	glb = CreateTriangleGlb (3);
+	glb [glb.size () - 4] = 3;
+	CHECK (GetError ([&] () { LoadGlb (glb.data (), glb.size ()); }) ==
+		"Invalid glTF index.");
+}
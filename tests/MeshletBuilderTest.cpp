@@ -0,0 +1,374 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "MeshletBuilder.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+typedef std::array<std::uint32_t, 3> Triangle;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Flat grid of size x size quads in the z = 0 plane, facing +z.
+*/
+Mesh CreateGrid (const int size)
+{
+	Mesh mesh;
+	for (int y = 0; y <= size; ++y) {
+		for (int x = 0; x <= size; ++x) {
+			MeshVertex vertex = {};
+			vertex.position [0] = static_cast<float> (x);
+			vertex.position [1] = static_cast<float> (y);
+			vertex.normal [2] = 1;
+			mesh.vertices.push_back (vertex);
+		}
+	}
+
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			const std::uint32_t a = y * (size + 1) + x;
+			const std::uint32_t b = a + 1;
+			const std::uint32_t c = a + size + 1;
+			const std::uint32_t d = c + 1;
+			mesh.indices.insert (mesh.indices.end (), { a, b, c, b, d, c });
+		}
+	}
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Sphere with shared vertices, so triangles face in all directions.
+*/
+Mesh CreateSphere (const int segments, const int rings)
+{
+	Mesh mesh;
+	for (int ring = 0; ring <= rings; ++ring) {
+		const float theta = ring * 3.14159265f / rings;
+		for (int segment = 0; segment <= segments; ++segment) {
+			const float phi = segment * 2 * 3.14159265f / segments;
+
+			MeshVertex vertex = {};
+			vertex.normal [0] = std::sin (theta) * std::cos (phi);
+			vertex.normal [1] = std::sin (theta) * std::sin (phi);
+			vertex.normal [2] = std::cos (theta);
+			for (int i = 0; i < 3; ++i) {
+				vertex.position [i] = vertex.normal [i] * 10 + 5;
+			}
+			mesh.vertices.push_back (vertex);
+		}
+	}
+
+	for (int ring = 0; ring < rings; ++ring) {
+		for (int segment = 0; segment < segments; ++segment) {
+			const std::uint32_t a = ring * (segments + 1) + segment;
+			const std::uint32_t b = a + 1;
+			const std::uint32_t c = a + segments + 1;
+			const std::uint32_t d = c + 1;
+			mesh.indices.insert (mesh.indices.end (), { a, c, b, b, c, d });
+		}
+	}
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+A sphere with its triangles in random order, plus the cases the greedy
+growth has to cope with: degenerate triangles, a duplicate triangle and
+triangles which share no vertex with anything else.
+*/
+Mesh CreateScrambledMesh (std::mt19937& random)
+{
+	auto mesh = CreateSphere (23, 17);
+
+	std::vector<Triangle> triangles;
+	for (std::size_t i = 0; i < mesh.indices.size (); i += 3) {
+		triangles.push_back ({ mesh.indices [i], mesh.indices [i + 1], mesh.indices [i + 2] });
+	}
+
+	triangles.push_back ({ 7, 7, 8 });
+	triangles.push_back ({ 9, 9, 9 });
+	const auto duplicate = triangles [3];
+	triangles.push_back (duplicate);
+
+	for (int i = 0; i < 5; ++i) {
+		const auto first = static_cast<std::uint32_t> (mesh.vertices.size ());
+		for (int j = 0; j < 3; ++j) {
+			MeshVertex vertex = {};
+			vertex.position [0] = 100.0f + i;
+			vertex.position [1] = static_cast<float> (j);
+			vertex.position [2] = static_cast<float> (j == 2);
+			mesh.vertices.push_back (vertex);
+		}
+		triangles.push_back ({ first, first + 1, first + 2 });
+	}
+
+	std::shuffle (triangles.begin (), triangles.end (), random);
+
+	mesh.indices.clear ();
+	for (const auto& triangle : triangles) {
+		mesh.indices.insert (mesh.indices.end (), triangle.begin (), triangle.end ());
+	}
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+float GetDistance (const float* a, const float* b)
+{
+	float sum = 0;
+	for (int i = 0; i < 3; ++i) {
+		sum += (a [i] - b [i]) * (a [i] - b [i]);
+	}
+
+	return std::sqrt (sum);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Check everything the meshlets promise about their layout and contents.
+*/
+void CheckMeshlets (const Mesh& mesh, const MeshletData& data,
+	const int maxVertices, const int maxTriangles)
+{
+	CHECK (! data.meshlets.empty ());
+
+	bool layoutValid = true;
+	bool indicesValid = true;
+	bool spheresValid = true;
+	std::uint32_t vertexOffset = 0, triangleOffset = 0;
+	std::vector<Triangle> emitted;
+
+	for (const auto& meshlet : data.meshlets) {
+		layoutValid = layoutValid &&
+			meshlet.vertexOffset == vertexOffset &&
+			meshlet.triangleOffset == triangleOffset &&
+			meshlet.vertexCount >= 1 &&
+			meshlet.vertexCount <= static_cast<std::uint32_t> (maxVertices) &&
+			meshlet.triangleCount >= 1 &&
+			meshlet.triangleCount <= static_cast<std::uint32_t> (maxTriangles);
+		if (! layoutValid) {
+			break;
+		}
+
+		const auto vertices = &data.vertices [meshlet.vertexOffset];
+
+		// Each vertex appears once per meshlet
+		std::vector<std::uint32_t> sorted (vertices, vertices + meshlet.vertexCount);
+		std::sort (sorted.begin (), sorted.end ());
+		indicesValid = indicesValid &&
+			std::unique (sorted.begin (), sorted.end ()) == sorted.end ();
+
+		for (std::uint32_t i = 0; i < meshlet.triangleCount; ++i) {
+			Triangle triangle;
+			for (int j = 0; j < 3; ++j) {
+				const auto local = data.triangles [(meshlet.triangleOffset + i) * 3 + j];
+				indicesValid = indicesValid && local < meshlet.vertexCount;
+				triangle [j] = local < meshlet.vertexCount ? vertices [local] : 0;
+			}
+			emitted.push_back (triangle);
+		}
+
+		for (std::uint32_t i = 0; i < meshlet.vertexCount; ++i) {
+			spheresValid = spheresValid && GetDistance (
+				mesh.vertices [vertices [i]].position, meshlet.center) <= meshlet.radius;
+		}
+
+		vertexOffset += meshlet.vertexCount;
+		triangleOffset += meshlet.triangleCount;
+	}
+
+	CHECK (layoutValid);
+	CHECK (indicesValid);
+	CHECK (spheresValid);
+	CHECK (data.vertices.size () == vertexOffset);
+	CHECK (data.triangles.size () == triangleOffset * std::size_t (3));
+
+	// Every input triangle comes out exactly once, with its corners in the
+	// same order
+	std::vector<Triangle> input;
+	for (std::size_t i = 0; i + 2 < mesh.indices.size (); i += 3) {
+		input.push_back ({ mesh.indices [i], mesh.indices [i + 1], mesh.indices [i + 2] });
+	}
+
+	std::sort (input.begin (), input.end ());
+	std::sort (emitted.begin (), emitted.end ());
+	CHECK (input == emitted);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool operator== (const MeshletData& a, const MeshletData& b)
+{
+	return a.meshlets.size () == b.meshlets.size () &&
+		std::memcmp (a.meshlets.data (), b.meshlets.data (),
+			a.meshlets.size () * sizeof (Meshlet)) == 0 &&
+		a.vertices == b.vertices && a.triangles == b.triangles;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (MeshletsStayWithinTheLimits)
+{
+	std::mt19937 random (1);
+	const Mesh meshes [] = { CreateGrid (20), CreateSphere (32, 16),
+		CreateScrambledMesh (random) };
+
+	const int limits [][2] = {
+		{ MAX_MESHLET_VERTICES, MAX_MESHLET_TRIANGLES },
+		{ 3, 1 }, { 3, 124 }, { 4, 2 }, { 16, 8 }, { 64, 1 }, { 32, 124 }
+	};
+
+	for (const auto& mesh : meshes) {
+		for (const auto& limit : limits) {
+			const auto data = BuildMeshlets (mesh.indices, mesh.vertices,
+				limit [0], limit [1]);
+			CheckMeshlets (mesh, data, limit [0], limit [1]);
+
+			if (limit [1] == 1) {
+				CHECK (data.meshlets.size () == mesh.indices.size () / 3);
+			}
+		}
+	}
+
+	// Connected meshes fill their meshlets
+	const auto grid = CreateGrid (32);
+	const auto data = BuildMeshlets (grid.indices, grid.vertices);
+	CHECK (AnalyzeMeshlets (data).averageTriangles > 48);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (TrailingIndicesAreIgnored)
+{
+	auto mesh = CreateGrid (4);
+	const auto expected = BuildMeshlets (mesh.indices, mesh.vertices);
+
+	// Out of range, but never read as part of a triangle
+	mesh.indices.push_back (0);
+	mesh.indices.push_back (1000);
+	CHECK (BuildMeshlets (mesh.indices, mesh.vertices) == expected);
+
+	mesh.indices.resize (2);
+	CHECK (BuildMeshlets (mesh.indices, mesh.vertices).meshlets.empty ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (NormalConesContainTheTriangleNormals)
+{
+	// A flat grid faces exactly one way
+	const auto grid = CreateGrid (8);
+	for (const auto& meshlet : BuildMeshlets (grid.indices, grid.vertices).meshlets) {
+		CHECK (std::abs (meshlet.coneAxis [2] - 1) < 1e-6f);
+		CHECK (meshlet.coneCutoff < 1e-3f);
+	}
+
+	std::mt19937 random (2);
+	const auto mesh = CreateScrambledMesh (random);
+	const auto data = BuildMeshlets (mesh.indices, mesh.vertices);
+
+	int cullable = 0;
+	bool conesValid = true;
+	for (const auto& meshlet : data.meshlets) {
+		if (meshlet.coneCutoff >= 1) {
+			continue;
+		}
+		++cullable;
+
+		const float minimumDot = std::sqrt (1 - meshlet.coneCutoff * meshlet.coneCutoff);
+		for (std::uint32_t i = 0; i < meshlet.triangleCount; ++i) {
+			const auto t = &data.triangles [(meshlet.triangleOffset + i) * 3];
+			const float* a = mesh.vertices [data.vertices [meshlet.vertexOffset + t [0]]].position;
+			const float* b = mesh.vertices [data.vertices [meshlet.vertexOffset + t [1]]].position;
+			const float* c = mesh.vertices [data.vertices [meshlet.vertexOffset + t [2]]].position;
+
+			const float ab [3] = { b [0] - a [0], b [1] - a [1], b [2] - a [2] };
+			const float ac [3] = { c [0] - a [0], c [1] - a [1], c [2] - a [2] };
+			const float normal [3] = {
+				ab [1] * ac [2] - ab [2] * ac [1],
+				ab [2] * ac [0] - ab [0] * ac [2],
+				ab [0] * ac [1] - ab [1] * ac [0]
+			};
+
+			const float length = std::sqrt (normal [0] * normal [0] +
+				normal [1] * normal [1] + normal [2] * normal [2]);
+			if (length == 0) {
+				continue;
+			}
+
+			const float dot = (normal [0] * meshlet.coneAxis [0] +
+				normal [1] * meshlet.coneAxis [1] + normal [2] * meshlet.coneAxis [2]) / length;
+			conesValid = conesValid && dot >= minimumDot - 1e-4f;
+		}
+	}
+
+	CHECK (cullable > 0);
+	CHECK (conesValid);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ThreadPoolGivesTheSameResult)
+{
+	std::mt19937 random (3);
+	std::vector<Mesh> meshes;
+	for (int i = 0; i < 6; ++i) {
+		meshes.push_back (CreateScrambledMesh (random));
+	}
+	meshes.push_back (CreateGrid (25));
+	meshes.push_back (CreateSphere (40, 20));
+
+	std::vector<const Mesh*> pointers;
+	for (const auto& mesh : meshes) {
+		pointers.push_back (&mesh);
+	}
+
+	for (const auto& limit : { std::make_pair (64, 124), std::make_pair (16, 20) }) {
+		ThreadPool threadPool (4);
+		const auto parallel = BuildMeshlets (pointers, &threadPool,
+			limit.first, limit.second);
+		const auto serial = BuildMeshlets (pointers, nullptr,
+			limit.first, limit.second);
+
+		CHECK (parallel.size () == meshes.size ());
+		CHECK (serial.size () == meshes.size ());
+		for (std::size_t i = 0; i < meshes.size () && i < parallel.size (); ++i) {
+			const auto expected = BuildMeshlets (meshes [i].indices,
+				meshes [i].vertices, limit.first, limit.second);
+			CHECK (parallel [i] == expected);
+			CHECK (serial [i] == expected);
+		}
+	}
+
+	ThreadPool threadPool (2);
+	CHECK (BuildMeshlets (std::vector<const Mesh*> (), &threadPool).empty ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidInputThrows)
+{
+	auto mesh = CreateGrid (3);
+	CHECK_THROWS (BuildMeshlets (mesh.indices, mesh.vertices, 2, 124));
+	CHECK_THROWS (BuildMeshlets (mesh.indices, mesh.vertices, 65, 124));
+	CHECK_THROWS (BuildMeshlets (mesh.indices, mesh.vertices, 64, 0));
+	CHECK_THROWS (BuildMeshlets (mesh.indices, mesh.vertices, 64, 125));
+
+	const auto valid = mesh;
+	mesh.indices [7] = static_cast<std::uint32_t> (mesh.vertices.size ());
+	CHECK_THROWS (BuildMeshlets (mesh.indices, mesh.vertices));
+
+	// From any of the meshes built in parallel
+	const std::vector<const Mesh*> meshes = { &valid, &valid, &mesh, &valid };
+	ThreadPool threadPool (3);
+	CHECK_THROWS (BuildMeshlets (meshes, &threadPool));
+	CHECK_THROWS (BuildMeshlets (meshes, nullptr));
+}
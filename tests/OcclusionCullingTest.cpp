@@ -0,0 +1,232 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "OcclusionCulling.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+const int WIDTH = 256;
+const int HEIGHT = 128;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Add an axis aligned rectangle at depth z, in clip space coordinates.
+*/
+void AddRectangle (OcclusionBuffer& buffer, const float x0, const float y0,
+	const float x1, const float y1, const float z)
+{
+	const float positions [] = {
+		x0, y0, z,
+		x1, y0, z,
+		x1, y1, z,
+		x0, y1, z
+	};
+	const std::uint32_t indices [] = { 0, 1, 2, 0, 2, 3 };
+
+	buffer.AddOccluder (positions, 3 * sizeof (float), 4, indices, 6);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+BoundingBox MakeBox (const float x0, const float y0, const float z0,
+	const float x1, const float y1, const float z1)
+{
+	return { { x0, y0, z0 }, { x1, y1, z1 } };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Visibility of a box under the identity view projection, computed by
+looking at every pixel the box covers.
+*/
+bool IsVisibleReference (const OcclusionBuffer& buffer, const BoundingBox& box)
+{
+	const float minX = (box.min [0] * 0.5f + 0.5f) * buffer.GetWidth ();
+	const float maxX = (box.max [0] * 0.5f + 0.5f) * buffer.GetWidth ();
+	const float minY = (0.5f - box.max [1] * 0.5f) * buffer.GetHeight ();
+	const float maxY = (0.5f - box.min [1] * 0.5f) * buffer.GetHeight ();
+
+	if (box.min [2] <= 0) {
+		return true;
+	}
+
+	const int startX = std::max (static_cast<int> (std::floor (minX)), 0);
+	const int endX = std::min (static_cast<int> (std::ceil (maxX)) - 1, buffer.GetWidth () - 1);
+	const int startY = std::max (static_cast<int> (std::floor (minY)), 0);
+	const int endY = std::min (static_cast<int> (std::ceil (maxY)) - 1, buffer.GetHeight () - 1);
+
+	if (startX > endX || startY > endY) {
+		return true;
+	}
+
+	for (int y = startY; y <= endY; ++y) {
+		for (int x = startX; x <= endX; ++x) {
+			if (buffer.GetDepth (x, y) >= box.min [2]) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (EmptyBufferHidesNothing)
+{
+	OcclusionBuffer buffer (WIDTH, HEIGHT);
+	buffer.Rasterize ();
+
+	CHECK (buffer.IsVisible (MakeBox (-0.5f, -0.5f, 0.5f, 0.5f, 0.5f, 0.9f)));
+	CHECK (buffer.IsVisible (MakeBox (-1, -1, 0.99f, 1, 1, 1)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (WallHidesBoxesBehindIt)
+{
+	OcclusionBuffer buffer (WIDTH, HEIGHT);
+	AddRectangle (buffer, -1, -1, 1, 1, 0.5f);
+	buffer.Rasterize ();
+
+	CHECK (buffer.GetDepth (0, 0) == 0.5f);
+	CHECK (buffer.GetDepth (WIDTH - 1, HEIGHT - 1) == 0.5f);
+
+	// Behind the wall, small and screen-sized
+	CHECK (! buffer.IsVisible (MakeBox (-0.1f, -0.1f, 0.6f, 0.1f, 0.1f, 0.7f)));
+	CHECK (! buffer.IsVisible (MakeBox (-1, -1, 0.6f, 1, 1, 0.7f)));
+	// In front of the wall, and intersecting it
+	CHECK (buffer.IsVisible (MakeBox (-0.1f, -0.1f, 0.2f, 0.1f, 0.1f, 0.3f)));
+	CHECK (buffer.IsVisible (MakeBox (-0.1f, -0.1f, 0.4f, 0.1f, 0.1f, 0.6f)));
+	// Only the part on the screen matters, boxes entirely outside of it are
+	// left to frustum culling
+	CHECK (! buffer.IsVisible (MakeBox (0.9f, -0.1f, 0.6f, 1.5f, 0.1f, 0.7f)));
+	CHECK (buffer.IsVisible (MakeBox (1.1f, -0.1f, 0.6f, 1.5f, 0.1f, 0.7f)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (PartialOccluderLeavesBoxVisible)
+{
+	OcclusionBuffer buffer (WIDTH, HEIGHT);
+	// Covers the left half of the screen
+	AddRectangle (buffer, -1, -1, 0, 1, 0.5f);
+	buffer.Rasterize ();
+
+	CHECK (! buffer.IsVisible (MakeBox (-0.9f, -0.5f, 0.6f, -0.1f, 0.5f, 0.7f)));
+	// Reaches a single pixel column past the occluder
+	CHECK (buffer.IsVisible (MakeBox (-0.9f, -0.5f, 0.6f, 0.5f / WIDTH * 2, 0.5f, 0.7f)));
+	CHECK (buffer.IsVisible (MakeBox (0.1f, -0.5f, 0.6f, 0.9f, 0.5f, 0.7f)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (BoxCrossingNearPlaneIsVisible)
+{
+	// Perspective projection looking down +z, near plane at 0.1, far plane
+	// at 100
+	const float n = 0.1f, f = 100.0f;
+	const float projection [16] = {
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, f / (f - n), -n * f / (f - n),
+		0, 0, 1, 0
+	};
+
+	OcclusionBuffer buffer (WIDTH, HEIGHT);
+	buffer.SetViewProjection (projection);
+	AddRectangle (buffer, -10, -10, 10, 10, 1);
+	buffer.Rasterize ();
+
+	CHECK (! buffer.IsVisible (MakeBox (-0.5f, -0.5f, 2, 0.5f, 0.5f, 3)));
+	CHECK (buffer.IsVisible (MakeBox (-0.5f, -0.5f, 0.05f, 0.5f, 0.5f, 3)));
+	CHECK (buffer.IsVisible (MakeBox (-0.5f, -0.5f, -1, 0.5f, 0.5f, 3)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (HierarchyMatchesPixelTest)
+{
+	std::mt19937 random (42);
+	std::uniform_real_distribution<float> position (-1.2f, 1.2f);
+	std::uniform_real_distribution<float> depth (0.05f, 0.95f);
+	std::uniform_real_distribution<float> extent (0.0f, 0.6f);
+
+	for (int scene = 0; scene < 8; ++scene) {
+		OcclusionBuffer buffer (WIDTH, HEIGHT);
+
+		for (int i = 0; i < 20; ++i) {
+			const float x = position (random), y = position (random);
+			AddRectangle (buffer, x, y, x + extent (random), y + extent (random),
+				depth (random));
+		}
+		buffer.Rasterize ();
+
+		int hidden = 0;
+		for (int i = 0; i < 2000; ++i) {
+			const float x = position (random), y = position (random);
+			const float z = depth (random);
+			const float size = extent (random) * extent (random);
+			const auto box = MakeBox (x, y, z, x + size, y + size, z + 0.01f);
+
+			const bool visible = buffer.IsVisible (box);
+			CHECK (visible == IsVisibleReference (buffer, box));
+			hidden += visible ? 0 : 1;
+		}
+
+		// Make sure the scenes actually hide something
+		CHECK (hidden > 0);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ParallelMatchesSerial)
+{
+	ThreadPool pool (3);
+	OcclusionBuffer serial (WIDTH, HEIGHT);
+	OcclusionBuffer parallel (WIDTH, HEIGHT, &pool);
+
+	std::mt19937 random (7);
+	std::uniform_real_distribution<float> position (-1.0f, 1.0f);
+	std::uniform_real_distribution<float> depth (0.05f, 0.95f);
+
+	// Random triangles, not just rectangles, to exercise all edge cases of
+	// the rasterizer
+	std::vector<float> positions;
+	std::vector<std::uint32_t> indices;
+	for (int i = 0; i < 300; ++i) {
+		positions.push_back (position (random));
+		positions.push_back (position (random));
+		positions.push_back (depth (random));
+		indices.push_back (static_cast<std::uint32_t> (i));
+	}
+
+	for (auto buffer : { &serial, &parallel }) {
+		buffer->AddOccluder (positions.data (), 3 * sizeof (float), 300,
+			indices.data (), 300);
+		buffer->Rasterize ();
+	}
+
+	for (int y = 0; y < HEIGHT; ++y) {
+		for (int x = 0; x < WIDTH; ++x) {
+			CHECK (serial.GetDepth (x, y) == parallel.GetDepth (x, y));
+		}
+	}
+
+	std::vector<BoundingBox> boxes;
+	for (int i = 0; i < 1000; ++i) {
+		const float x = position (random), y = position (random);
+		const float z = depth (random);
+		boxes.push_back (MakeBox (x, y, z, x + 0.1f, y + 0.1f, z + 0.01f));
+	}
+
+	std::vector<std::uint8_t> visible (boxes.size ());
+	parallel.TestVisibility (boxes.data (), static_cast<int> (boxes.size ()),
+		visible.data ());
+
+	for (std::size_t i = 0; i < boxes.size (); ++i) {
+		CHECK ((visible [i] != 0) == serial.IsVisible (boxes [i]));
+	}
+}
@@ -0,0 +1,368 @@
+#include "Test.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "CountingDevice.h"
+#include "PipelineCache.h"
+#include "PipelineStateManager.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "TemporaryFile.h"
+#include "ThreadPool.h"
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using namespace anteru;
+
+namespace {
+const char ADAPTER [] = "test adapter";
+
+const char SHADER_SOURCE [] =
+	"float4 VS_test (float3 p : POSITION) : SV_Position { return float4 (p, 1); }\n"
+	"float4 PS_test () : SV_Target { return 1; }\n";
+
+///////////////////////////////////////////////////////////////////////////////
+Hash128 CreateKey (const std::string& name)
+{
+	return ComputeHash128 (name.data (), name.size ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<std::uint8_t> CreateBlob (const std::uint8_t value,
+	const std::size_t size = 100)
+{
+	return std::vector<std::uint8_t> (size, value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Return true if cache holds the blob of CreateBlob (value) under the key
+of name.
+*/
+bool Contains (PipelineCache& cache, const std::string& name,
+	const std::uint8_t value)
+{
+	std::vector<std::uint8_t> blob;
+	return cache.Find (CreateKey (name), blob) && blob == CreateBlob (value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Fill a cache file with the blobs "a" and "b".
+*/
+void CreateCacheFile (const test::TemporaryFile& file)
+{
+	PipelineCache cache (file.GetPath (), ADAPTER);
+	cache.Add (CreateKey ("a"), CreateBlob (1));
+	cache.Add (CreateKey ("b"), CreateBlob (2));
+	CHECK (cache.Save ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Open the cache file for another run, add the blob of name and save.
+*/
+void SaveGeneration (const test::TemporaryFile& file,
+	const std::string& name, const std::uint8_t value,
+	const std::vector<std::string>& used, const int maxUnusedGenerations,
+	const std::size_t maxSize, int* prunedCount = nullptr)
+{
+	PipelineCache cache (file.GetPath (), ADAPTER, maxUnusedGenerations, maxSize);
+	std::vector<std::uint8_t> blob;
+	for (const auto& key : used) {
+		CHECK (cache.Find (CreateKey (key), blob));
+	}
+
+	cache.Add (CreateKey (name), CreateBlob (value));
+	CHECK (cache.Save ());
+
+	if (prunedCount) {
+		*prunedCount = cache.GetPrunedCount ();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PipelineStateDesc CreatePipelineStateDesc (IRootSignature* rootSignature)
+{
+	PipelineStateDesc desc;
+	desc.rootSignature = rootSignature;
+	desc.vertexShader = { SHADER_SOURCE, sizeof (SHADER_SOURCE) - 1,
+		"VS_test", "vs_5_0", {}, nullptr, 0 };
+	desc.pixelShader = { SHADER_SOURCE, sizeof (SHADER_SOURCE) - 1,
+		"PS_test", "ps_5_0", {}, nullptr, 0 };
+	desc.inputLayout = { { "POSITION", 0, PixelFormat::R32G32B32_Float, 0 } };
+	desc.renderTargetFormat = PixelFormat::R8G8B8A8_UNorm;
+	desc.blendMode = BlendMode::Opaque;
+	return desc;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (AddedBlobsAreFoundBeforeSaving)
+{
+	test::TemporaryFile file ("PipelineCacheTest.Added");
+	PipelineCache cache (file.GetPath (), ADAPTER);
+
+	CHECK (! Contains (cache, "a", 1));
+	CHECK (cache.GetMissCount () == 1);
+
+	cache.Add (CreateKey ("a"), CreateBlob (1));
+	CHECK (Contains (cache, "a", 1));
+	CHECK (cache.GetHitCount () == 1);
+
+	// Devices without blobs return empty ones, which are not stored
+	cache.Add (CreateKey ("b"), {});
+	CHECK (! Contains (cache, "b", 0));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SavedBlobsAreFoundByTheNextRun)
+{
+	test::TemporaryFile file ("PipelineCacheTest.Persistent");
+	CreateCacheFile (file);
+
+	PipelineCache cache (file.GetPath (), ADAPTER);
+	CHECK (! cache.WasInvalidated ());
+	CHECK (Contains (cache, "a", 1));
+	CHECK (Contains (cache, "b", 2));
+	CHECK (! Contains (cache, "c", 3));
+	CHECK (cache.GetHitCount () == 2);
+	CHECK (cache.GetMissCount () == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FileOfAnotherAdapterIsIgnored)
+{
+	test::TemporaryFile file ("PipelineCacheTest.Adapter");
+	CreateCacheFile (file);
+
+	{
+		PipelineCache cache (file.GetPath (), "other adapter");
+		CHECK (cache.WasInvalidated ());
+		CHECK (! Contains (cache, "a", 1));
+
+		// Saving replaces the file with one for the new adapter
+		cache.Add (CreateKey ("c"), CreateBlob (3));
+		CHECK (cache.Save ());
+		CHECK (! cache.WasInvalidated ());
+	}
+
+	PipelineCache other (file.GetPath (), "other adapter");
+	CHECK (! other.WasInvalidated ());
+	CHECK (Contains (other, "c", 3));
+	CHECK (! Contains (other, "a", 1));
+
+	PipelineCache original (file.GetPath (), ADAPTER);
+	CHECK (original.WasInvalidated ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (GarbageFileIsTreatedAsEmpty)
+{
+	test::TemporaryFile file ("PipelineCacheTest.Garbage");
+	file.Write (std::vector<char> (4096, 'x'));
+
+	PipelineCache cache (file.GetPath (), ADAPTER);
+	CHECK (cache.WasInvalidated ());
+	CHECK (! Contains (cache, "a", 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (EntryCountBeyondTheFileIsRejected)
+{
+	test::TemporaryFile file ("PipelineCacheTest.EntryCount");
+	CreateCacheFile (file);
+
+	// The entry count follows the magic, version and generation
+	auto contents = file.Read ();
+	const std::uint32_t entryCount = 1000000;
+	std::memcpy (contents.data () + 12, &entryCount, sizeof (entryCount));
+	file.Write (contents);
+
+	PipelineCache cache (file.GetPath (), ADAPTER);
+	CHECK (cache.WasInvalidated ());
+	CHECK (! Contains (cache, "a", 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (TruncatedAndDamagedBlobsAreRejected)
+{
+	test::TemporaryFile file ("PipelineCacheTest.Damaged");
+	CreateCacheFile (file);
+
+	// Blobs are stored in key order, damage the first one and cut off the
+	// last one; the index stays intact
+	auto contents = file.Read ();
+	contents [32 + 2 * 40] ^= 1;
+	contents.resize (contents.size () - 8);
+	file.Write (contents);
+
+	{
+		PipelineCache cache (file.GetPath (), ADAPTER);
+		CHECK (! cache.WasInvalidated ());
+		CHECK (! Contains (cache, "a", 1));
+		CHECK (! Contains (cache, "b", 2));
+		CHECK (cache.GetMissCount () == 2);
+
+		// Saving drops the damaged blobs and stores the new ones
+		cache.Add (CreateKey ("a"), CreateBlob (1));
+		CHECK (cache.Save ());
+	}
+
+	PipelineCache cache (file.GetPath (), ADAPTER);
+	CHECK (Contains (cache, "a", 1));
+	CHECK (! Contains (cache, "b", 2));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (UnusedBlobsArePrunedAfterMaxUnusedGenerations)
+{
+	test::TemporaryFile file ("PipelineCacheTest.Generations");
+	const std::size_t maxSize = 1 << 20;
+	int prunedCount = 0;
+
+	// "a" is added in the first generation and never used again, "b" is
+	// used by every run
+	SaveGeneration (file, "a", 1, {}, 2, maxSize);
+	SaveGeneration (file, "b", 2, {}, 2, maxSize);
+	SaveGeneration (file, "c", 3, { "b" }, 2, maxSize, &prunedCount);
+	CHECK (prunedCount == 0);
+
+	// Generation 4 is the third one without a use of "a"
+	SaveGeneration (file, "d", 4, { "b" }, 2, maxSize, &prunedCount);
+	CHECK (prunedCount == 1);
+
+	PipelineCache cache (file.GetPath (), ADAPTER);
+	CHECK (! Contains (cache, "a", 1));
+	CHECK (Contains (cache, "b", 2));
+	CHECK (Contains (cache, "c", 3));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (LeastRecentlyUsedBlobsArePrunedAboveMaxSize)
+{
+	test::TemporaryFile file ("PipelineCacheTest.Size");
+
+	// The header and two entries with 100 byte blobs
+	const std::size_t maxSize = 32 + 2 * (40 + 100);
+	int prunedCount = 0;
+
+	SaveGeneration (file, "a", 1, {}, 8, maxSize);
+	SaveGeneration (file, "b", 2, {}, 8, maxSize);
+
+	// "a" is used by this run, so "b" is the least recently used blob
+	SaveGeneration (file, "c", 3, { "a" }, 8, maxSize, &prunedCount);
+	CHECK (prunedCount == 1);
+
+	{
+		PipelineCache cache (file.GetPath (), ADAPTER);
+		CHECK (Contains (cache, "a", 1));
+		CHECK (! Contains (cache, "b", 2));
+		CHECK (Contains (cache, "c", 3));
+	}
+
+	// Now "a" was last used a generation before "c"
+	SaveGeneration (file, "d", 4, { "c" }, 8, maxSize, &prunedCount);
+	CHECK (prunedCount == 1);
+
+	PipelineCache cache (file.GetPath (), ADAPTER);
+	CHECK (! Contains (cache, "a", 1));
+	CHECK (Contains (cache, "c", 3));
+	CHECK (Contains (cache, "d", 4));
+	CHECK (file.Read ().size () <= maxSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SaveReplacesTheFileAtomically)
+{
+	test::TemporaryFile file ("PipelineCacheTest.Atomic");
+	CreateCacheFile (file);
+
+	PipelineCache reader (file.GetPath (), ADAPTER);
+	PipelineCache writer (file.GetPath (), ADAPTER);
+
+	writer.Add (CreateKey ("c"), CreateBlob (3));
+	const bool saved = writer.Save ();
+
+	// The temporary file is gone, whether the rename worked or not; on
+	// Windows, it fails while reader maps the file
+	const auto temporaryPath = file.GetPath () + ".tmp" +
+		std::to_string (static_cast<unsigned long> (getpid ()));
+	CHECK (! std::ifstream (temporaryPath).good ());
+
+	// A cache which had the old file open still reads consistent blobs
+	CHECK (Contains (reader, "a", 1));
+	CHECK (Contains (reader, "b", 2));
+
+	// Another process may have saved in the meantime, its blobs are merged
+	// with the ones of this one
+	reader.Add (CreateKey ("d"), CreateBlob (4));
+	CHECK (reader.Save () == saved);
+
+	PipelineCache next (file.GetPath (), ADAPTER);
+	CHECK (Contains (next, "a", 1));
+	CHECK (Contains (next, "b", 2));
+	if (saved) {
+		CHECK (Contains (next, "c", 3));
+		CHECK (Contains (next, "d", 4));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FailedSaveKeepsTheBlobs)
+{
+	PipelineCache cache ("PipelineCacheTest.missing/cache", ADAPTER);
+
+	cache.Add (CreateKey ("a"), CreateBlob (1));
+	CHECK (! cache.Save ());
+	CHECK (Contains (cache, "a", 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ManagerCreatesPipelineStatesFromCachedBlobs)
+{
+	test::TemporaryFile file ("PipelineCacheTest.Manager");
+	test::TemporaryFile shaderFile ("PipelineCacheTest.shadercache");
+
+	test::CountingDevice device;
+	ThreadPool threadPool (0);
+	StubShaderCompiler compiler;
+	const auto rootSignature = device.CreateRootSignature (RootSignatureDesc ());
+
+	std::vector<std::string> blobs;
+	device.onCreatePipelineState = [&blobs] (const PipelineStateDesc& desc) {
+		const auto blob = static_cast<const char*> (desc.cachedBlob);
+		blobs.push_back (std::string (blob, blob + desc.cachedBlobSize));
+	};
+
+	// Cold start: the shaders are compiled, the pipeline state is created
+	// without a blob and its blob is stored
+	for (int run = 0; run < 2; ++run) {
+		ShaderCache shaderCache (compiler, shaderFile.GetPath ());
+		PipelineCache pipelineCache (file.GetPath (), device.GetAdapterIdentity ());
+		PipelineStateManager manager (device, threadPool, &shaderCache,
+			&pipelineCache);
+
+		CHECK (manager.Request (CreatePipelineStateDesc (rootSignature.get ())).Wait ());
+		CHECK (pipelineCache.GetHitCount () == run);
+		CHECK (pipelineCache.GetMissCount () == 1 - run);
+
+		CHECK (shaderCache.Save ());
+		CHECK (pipelineCache.Save ());
+	}
+
+	// Warm start: the blob of the first run is passed to the device
+	CHECK (compiler.GetCompileCount () == 2);
+	CHECK (device.pipelineStateCount == 2);
+	CHECK (blobs.size () == 2);
+	CHECK (blobs [0].empty ());
+	CHECK (blobs [1] == std::string ("NULLVS_test\0PS_test", 19));
+}
@@ -0,0 +1,260 @@
+#include "Test.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#include "CountingDevice.h"
+#include "PipelineStateManager.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+const char SHADER_SOURCE [] =
+	"float4 VS_test (float3 p : POSITION) : SV_Position { return float4 (p, 1); }\n"
+	"float4 PS_test () : SV_Target { return COLOR; }\n";
+
+///////////////////////////////////////////////////////////////////////////////
+RootSignatureDesc CreateRootSignatureDesc (const int constantCount)
+{
+	RootSignatureDesc desc;
+	desc.parameters.push_back ({ RootParameterType::Constants, 0,
+		constantCount, ShaderVisibility::Vertex });
+	desc.parameters.push_back ({ RootParameterType::DescriptorTable, 0,
+		1, ShaderVisibility::Pixel });
+	desc.staticSamplers.push_back ({ SamplerFilter::Linear, 0 });
+	return desc;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+PipelineStateDesc CreatePipelineStateDesc (IRootSignature* rootSignature)
+{
+	PipelineStateDesc desc;
+	desc.rootSignature = rootSignature;
+	desc.vertexShader = { SHADER_SOURCE, sizeof (SHADER_SOURCE) - 1,
+		"VS_test", "vs_5_0", {}, nullptr, 0 };
+	desc.pixelShader = { SHADER_SOURCE, sizeof (SHADER_SOURCE) - 1,
+		"PS_test", "ps_5_0", { { "COLOR", "1" } }, nullptr, 0 };
+	desc.inputLayout = {
+		{ "POSITION", 0, PixelFormat::R32G32B32_Float, 0 },
+		{ "TEXCOORD", 0, PixelFormat::R32G32_Float, 12 }
+	};
+	desc.renderTargetFormat = PixelFormat::R8G8B8A8_UNorm;
+	desc.blendMode = BlendMode::Opaque;
+	return desc;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Holds pipeline state creation on the device until Release is called.
+*/
+class CreationGate final
+{
+public:
+	explicit CreationGate (test::CountingDevice& device)
+	{
+		device.onCreatePipelineState = [this] (const PipelineStateDesc&) {
+			std::unique_lock<std::mutex> lock (mutex_);
+			condition_.wait (lock, [this] () { return released_; });
+		};
+	}
+
+	~CreationGate ()
+	{
+		Release ();
+	}
+
+	void Release ()
+	{
+		std::lock_guard<std::mutex> lock (mutex_);
+		released_ = true;
+		condition_.notify_all ();
+	}
+
+private:
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	bool released_ = false;
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (IdenticalRequestsShareOnePipelineState)
+{
+	test::CountingDevice device;
+	ThreadPool threadPool (2);
+	PipelineStateManager manager (device, threadPool);
+
+	const auto rootSignature = device.CreateRootSignature (CreateRootSignatureDesc (4));
+
+	const auto first = manager.Request (CreatePipelineStateDesc (rootSignature.get ()));
+	const auto second = manager.Request (CreatePipelineStateDesc (rootSignature.get ()));
+
+	auto other = CreatePipelineStateDesc (rootSignature.get ());
+	other.blendMode = BlendMode::AlphaBlend;
+	const auto third = manager.Request (other);
+
+	manager.WaitIdle ();
+
+	CHECK (first.Wait () == second.Wait ());
+	CHECK (first.Wait () != third.Wait ());
+	CHECK (device.pipelineStateCount == 2);
+	CHECK (manager.GetRequestCount () == 3);
+	CHECK (manager.GetPipelineStateCount () == 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (HashCoversTheWholeDescription)
+{
+	test::CountingDevice device;
+	const auto rootSignature = device.CreateRootSignature (CreateRootSignatureDesc (4));
+	const auto base = CreatePipelineStateDesc (rootSignature.get ());
+	const auto baseHash = PipelineStateManager::ComputeHash (base);
+
+	// Root signatures with the same layout are interchangeable
+	const auto sameLayout = device.CreateRootSignature (CreateRootSignatureDesc (4));
+	auto desc = base;
+	desc.rootSignature = sameLayout.get ();
+	CHECK (PipelineStateManager::ComputeHash (desc) == baseHash);
+
+	const auto otherLayout = device.CreateRootSignature (CreateRootSignatureDesc (8));
+	desc = base;
+	desc.rootSignature = otherLayout.get ();
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	desc = base;
+	desc.vertexShader.sourceSize -= 1;
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	desc = base;
+	desc.pixelShader.entryPoint = "PS_other";
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	desc = base;
+	desc.pixelShader.profile = "ps_5_1";
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	desc = base;
+	desc.pixelShader.defines [0].value = "0";
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	desc = base;
+	desc.inputLayout [1].format = PixelFormat::R16G16_UNorm;
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	desc = base;
+	desc.inputLayout [1].offset = 16;
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	desc = base;
+	desc.inputLayout.pop_back ();
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	desc = base;
+	desc.renderTargetFormat = PixelFormat::R8G8B8A8_UNorm_sRGB;
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	desc = base;
+	desc.blendMode = BlendMode::AlphaBlend;
+	CHECK (PipelineStateManager::ComputeHash (desc) != baseHash);
+
+	// With bytecode, the source no longer matters
+	const char bytecode [] = "bytecode";
+	auto precompiled = base;
+	precompiled.pixelShader.bytecode = bytecode;
+	precompiled.pixelShader.bytecodeSize = sizeof (bytecode);
+	desc = precompiled;
+	desc.pixelShader.defines [0].value = "0";
+	CHECK (PipelineStateManager::ComputeHash (desc) ==
+		PipelineStateManager::ComputeHash (precompiled));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FallbackIsUsedWhileCreating)
+{
+	test::CountingDevice device;
+	ThreadPool threadPool (2);
+	PipelineStateManager manager (device, threadPool);
+
+	const auto rootSignature = device.CreateRootSignature (CreateRootSignatureDesc (4));
+
+	auto fallbackDesc = CreatePipelineStateDesc (rootSignature.get ());
+	fallbackDesc.pixelShader.entryPoint = "PS_fallback";
+	const auto fallback = device.CreatePipelineState (fallbackDesc);
+
+	CreationGate gate (device);
+	const auto handle = manager.Request (CreatePipelineStateDesc (rootSignature.get ()));
+
+	CHECK (! handle.IsReady ());
+	CHECK (handle.Get () == nullptr);
+	CHECK (handle.Get (fallback.get ()) == fallback.get ());
+
+	// A duplicate while the first one is still being created shares it
+	const auto duplicate = manager.Request (CreatePipelineStateDesc (rootSignature.get ()));
+
+	gate.Release ();
+
+	const auto pipelineState = handle.Wait ();
+	CHECK (pipelineState != nullptr);
+	CHECK (handle.IsReady ());
+	CHECK (handle.Get (fallback.get ()) == pipelineState);
+	CHECK (duplicate.Wait () == pipelineState);
+	// The fallback and the requested one
+	CHECK (device.pipelineStateCount == 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FailedCreationIsReportedThroughTheHandle)
+{
+	test::CountingDevice device;
+	device.onCreatePipelineState = [] (const PipelineStateDesc& desc) {
+		if (std::strcmp (desc.pixelShader.entryPoint, "PS_broken") == 0) {
+			throw std::runtime_error ("Pipeline state creation failed.");
+		}
+	};
+
+	ThreadPool threadPool (2);
+	PipelineStateManager manager (device, threadPool);
+
+	const auto rootSignature = device.CreateRootSignature (CreateRootSignatureDesc (4));
+	auto desc = CreatePipelineStateDesc (rootSignature.get ());
+	desc.pixelShader.entryPoint = "PS_broken";
+	const auto broken = manager.Request (desc);
+	const auto working = manager.Request (CreatePipelineStateDesc (rootSignature.get ()));
+
+	manager.WaitIdle ();
+
+	CHECK (broken.IsReady ());
+	CHECK_THROWS (broken.Wait ());
+	CHECK (broken.Get (working.Wait ()) == working.Wait ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ShadersAreCompiledThroughTheShaderCache)
+{
+	test::CountingDevice device;
+	// A single worker creates the pipeline states one after the other
+	ThreadPool threadPool (1);
+	StubShaderCompiler compiler;
+	// Never saved, so the file is not created
+	ShaderCache shaderCache (compiler, "PipelineStateManagerTest.shadercache");
+	PipelineStateManager manager (device, threadPool, &shaderCache);
+
+	const auto rootSignature = device.CreateRootSignature (CreateRootSignatureDesc (4));
+
+	// Same shaders, different pipeline states
+	manager.Request (CreatePipelineStateDesc (rootSignature.get ()));
+	auto desc = CreatePipelineStateDesc (rootSignature.get ());
+	desc.blendMode = BlendMode::AlphaBlend;
+	manager.Request (desc);
+
+	manager.WaitIdle ();
+
+	CHECK (device.pipelineStateCount == 2);
+	CHECK (compiler.GetCompileCount () == 2);
+	CHECK (shaderCache.GetHitCount () == 2);
+}
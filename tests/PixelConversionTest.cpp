@@ -0,0 +1,398 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "PixelConversion.h"
+
+using namespace anteru;
+
+// The conversions pick their code path at compile time. This test is built
+// once with the default flags, once with only the scalar fallbacks and, on
+// x86, once with F16C. Each build checks its vector code against a
+// reference and against its scalar tail loop, which runs for the elements
+// which do not fill a whole vector.
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+float BitsToFloat (const std::uint32_t bits)
+{
+	float value;
+	std::memcpy (&value, &bits, sizeof (value));
+	return value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool IsHalfNaN (const std::uint16_t value)
+{
+	return (value & 0x7C00) == 0x7C00 && (value & 0x3FF) != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Value of a float with a 5-bit exponent with bias 15 and mantissaBits bits of
+mantissa, without a sign bit. The infinity encoding is treated as 2^16,
+which is where rounding switches over to it.
+*/
+double SmallFloatToDouble (const std::uint32_t value, const int mantissaBits)
+{
+	const int exponent = static_cast<int> (value >> mantissaBits);
+	const double mantissa = value & ((1u << mantissaBits) - 1);
+
+	if (exponent == 0) {
+		return std::ldexp (mantissa, -14 - mantissaBits);
+	}
+
+	return std::ldexp (1 + mantissa / (1 << mantissaBits), exponent - 15);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Round a non-negative value to the nearest encoding in [0, maxValue], with
+ties going to the even encoding, by a binary search over all encodings.
+*/
+std::uint32_t RoundToSmallFloat (const double value, const int mantissaBits,
+	const std::uint32_t maxValue)
+{
+	std::uint32_t low = 0, high = maxValue;
+	while (low < high) {
+		const auto middle = (low + high) / 2;
+		if (SmallFloatToDouble (middle, mantissaBits) < value) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	// low is the first encoding which is not below the value
+	const auto above = SmallFloatToDouble (low, mantissaBits);
+	if (above == value || low == 0) {
+		return low;
+	}
+
+	const auto below = SmallFloatToDouble (low - 1, mantissaBits);
+	if (value - below < above - value) {
+		return low - 1;
+	} else if (value - below > above - value) {
+		return low;
+	}
+
+	return (low & 1) ? low - 1 : low;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint16_t ReferenceFloatToHalf (const float value)
+{
+	if (std::isnan (value)) {
+		return 0x7E00;
+	}
+
+	const std::uint16_t sign = std::signbit (value) ? 0x8000 : 0;
+	const double magnitude = std::fabs (static_cast<double> (value));
+
+	// Halfway between the largest half and 2^16 rounds to infinity
+	if (magnitude >= 65520) {
+		return sign | 0x7C00;
+	}
+
+	return static_cast<std::uint16_t> (sign |
+		RoundToSmallFloat (magnitude, 10, 0x7C00));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+double ReferenceHalfToDouble (const std::uint16_t value)
+{
+	const double sign = (value & 0x8000) ? -1 : 1;
+
+	if ((value & 0x7C00) == 0x7C00) {
+		return (value & 0x3FF) ? std::numeric_limits<double>::quiet_NaN ()
+			: sign * std::numeric_limits<double>::infinity ();
+	}
+
+	return sign * SmallFloatToDouble (value & 0x7FFF, 10);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+R11G11B10 components have no sign, so negative values and NaN become 0,
+and everything at or above the largest finite value is clamped to it.
+*/
+std::uint32_t ReferenceUnsignedSmallFloat (const float value, const int mantissaBits)
+{
+	const auto maxValue = (30u << mantissaBits) | ((1u << mantissaBits) - 1);
+
+	if (! (value > 0)) {
+		return 0;
+	} else if (value >= SmallFloatToDouble (maxValue, mantissaBits)) {
+		return maxValue;
+	}
+
+	return RoundToSmallFloat (value, mantissaBits, maxValue);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint32_t ReferencePackR11G11B10 (const float* rgb)
+{
+	return ReferenceUnsignedSmallFloat (rgb [0], 6) |
+		(ReferenceUnsignedSmallFloat (rgb [1], 6) << 11) |
+		(ReferenceUnsignedSmallFloat (rgb [2], 5) << 22);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Shared exponent packing as written in the D3D functional specification, in
+double precision.
+*/
+std::uint32_t ReferencePackR9G9B9E5 (const float* rgb)
+{
+	const double maxValue = 511.0 / 512 * 65536;
+
+	double values [3];
+	for (int i = 0; i < 3; ++i) {
+		values [i] = (rgb [i] > 0) ? std::fmin (rgb [i], maxValue) : 0;
+	}
+
+	const double largest = std::fmax (std::fmax (values [0], values [1]), values [2]);
+	int exponent = (largest > 0)
+		? std::max (-16, static_cast<int> (std::floor (std::log2 (largest)))) + 16
+		: 0;
+
+	if (std::floor (largest / std::ldexp (1, exponent - 24) + 0.5) == 512) {
+		++exponent;
+	}
+
+	std::uint32_t result = static_cast<std::uint32_t> (exponent) << 27;
+	for (int i = 0; i < 3; ++i) {
+		result |= static_cast<std::uint32_t> (
+			std::floor (values [i] / std::ldexp (1, exponent - 24) + 0.5)) << (9 * i);
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Floats which hit the interesting cases of all formats: zeros, denormals,
+infinities, NaN, values beyond every range, and random values with
+exponents from well below to well above the half range, with either sign.
+*/
+std::vector<float> CreateTestValues (const std::size_t count)
+{
+	std::vector<float> result = {
+		0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 65504.0f, 65519.0f, 65520.0f, 65536.0f,
+		65408.0f, 65409.0f, 64512.0f, 65024.0f, 1e10f, -1e10f,
+		std::numeric_limits<float>::max (),
+		std::numeric_limits<float>::min (),
+		std::numeric_limits<float>::denorm_min (),
+		-std::numeric_limits<float>::denorm_min (),
+		std::numeric_limits<float>::infinity (),
+		-std::numeric_limits<float>::infinity (),
+		std::numeric_limits<float>::quiet_NaN (),
+		-std::numeric_limits<float>::quiet_NaN (),
+		BitsToFloat (0x7F800001u),
+		// The smallest half denormal, half of it, and just above half of it
+		std::ldexp (1.0f, -24), std::ldexp (1.0f, -25),
+		std::nextafter (std::ldexp (1.0f, -25), 1.0f),
+		std::ldexp (1.0f, -14), std::ldexp (1.0f, -15), std::ldexp (1.0f, -17)
+	};
+
+	std::mt19937 random (42);
+	std::uniform_real_distribution<float> mantissa (1.0f, 2.0f);
+	std::uniform_int_distribution<int> exponent (-30, 20);
+	std::uniform_int_distribution<int> sign (0, 7);
+
+	while (result.size () < count) {
+		const auto value = std::ldexp (mantissa (random), exponent (random));
+		result.push_back (sign (random) == 0 ? -value : value);
+	}
+
+	return result;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (EveryHalfConvertsToFloat)
+{
+	std::vector<std::uint16_t> halves (1 << 16);
+	for (std::size_t i = 0; i < halves.size (); ++i) {
+		halves [i] = static_cast<std::uint16_t> (i);
+	}
+
+	std::vector<float> vector (halves.size ()), scalar (halves.size ());
+	ConvertHalfToFloat (halves.data (), vector.data (), halves.size ());
+	for (std::size_t i = 0; i < halves.size (); ++i) {
+		ConvertHalfToFloat (&halves [i], &scalar [i], 1);
+	}
+
+	std::vector<std::uint16_t> roundTrip (halves.size ());
+	ConvertFloatToHalf (vector.data (), roundTrip.data (), vector.size ());
+
+	int mismatches = 0;
+	for (std::size_t i = 0; i < halves.size (); ++i) {
+		const auto expected = ReferenceHalfToDouble (halves [i]);
+
+		if (IsHalfNaN (halves [i])) {
+			if (! std::isnan (vector [i]) || ! std::isnan (scalar [i]) ||
+				! IsHalfNaN (roundTrip [i])) {
+				++mismatches;
+			}
+		} else if (vector [i] != expected || scalar [i] != expected ||
+			std::signbit (vector [i]) != std::signbit (expected) ||
+			std::signbit (scalar [i]) != std::signbit (expected) ||
+			roundTrip [i] != halves [i]) {
+			// Also compares the sign of zero, and covers denormals
+			++mismatches;
+		}
+	}
+
+	CHECK (mismatches == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FloatToHalfRoundsToNearestEven)
+{
+	auto values = CreateTestValues (100000);
+
+	// Every finite half, the midpoints to the next one and their neighbors,
+	// with both signs
+	for (std::uint32_t half = 0; half < 0x7C00; ++half) {
+		const auto value = static_cast<float> (SmallFloatToDouble (half, 10));
+		const auto midpoint = static_cast<float> ((SmallFloatToDouble (half, 10) +
+			SmallFloatToDouble (half + 1, 10)) / 2);
+
+		for (const auto v : { value, midpoint,
+			std::nextafter (midpoint, 0.0f), std::nextafter (midpoint, 1e30f) }) {
+			values.push_back (v);
+			values.push_back (-v);
+		}
+	}
+
+	std::vector<std::uint16_t> vector (values.size ()), scalar (values.size ());
+	ConvertFloatToHalf (values.data (), vector.data (), values.size ());
+	for (std::size_t i = 0; i < values.size (); ++i) {
+		ConvertFloatToHalf (&values [i], &scalar [i], 1);
+	}
+
+	int mismatches = 0;
+	for (std::size_t i = 0; i < values.size (); ++i) {
+		if (std::isnan (values [i])) {
+			// NaN stays NaN, the payload may differ between code paths
+			if (! IsHalfNaN (vector [i]) || ! IsHalfNaN (scalar [i])) {
+				++mismatches;
+			}
+		} else {
+			const auto expected = ReferenceFloatToHalf (values [i]);
+			if (vector [i] != expected || scalar [i] != expected) {
+				++mismatches;
+			}
+		}
+	}
+
+	CHECK (mismatches == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (R11G11B10ClampsAndRoundsToNearestEven)
+{
+	auto values = CreateTestValues (3 * 40000);
+
+	// Every finite value of the 6 and 5-bit mantissa formats and the
+	// midpoints to the next one
+	for (const int mantissaBits : { 6, 5 }) {
+		for (std::uint32_t value = 0; value < (31u << mantissaBits); ++value) {
+			values.push_back (static_cast<float> (SmallFloatToDouble (value, mantissaBits)));
+			values.push_back (static_cast<float> ((SmallFloatToDouble (value, mantissaBits) +
+				SmallFloatToDouble (value + 1, mantissaBits)) / 2));
+		}
+	}
+
+	// RGBA pixels, three more than a multiple of four so the scalar tail
+	// runs as well
+	while (values.size () % 16 != 12) {
+		values.push_back (1.0f);
+	}
+	const auto pixelCount = values.size () / 4;
+
+	std::vector<std::uint32_t> vector (pixelCount), scalar (pixelCount);
+	PackR11G11B10 (values.data (), vector.data (), pixelCount);
+	for (std::size_t i = 0; i < pixelCount; ++i) {
+		PackR11G11B10 (&values [i * 4], &scalar [i], 1);
+	}
+
+	int mismatches = 0;
+	for (std::size_t i = 0; i < pixelCount; ++i) {
+		const auto expected = ReferencePackR11G11B10 (&values [i * 4]);
+		if (vector [i] != expected || scalar [i] != expected) {
+			++mismatches;
+		}
+	}
+
+	CHECK (mismatches == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (R9G9B9E5RoundTrips)
+{
+	auto values = CreateTestValues (4 * 40000);
+
+	// Pixels whose largest component rounds up to the next exponent, and
+	// pixels with components far below the largest one
+	for (int exponent = -24; exponent <= 16; ++exponent) {
+		const float pixels [][4] = {
+			{ std::ldexp (511.75f, exponent - 9), 1.0f, 0.0f, 1.0f },
+			{ std::ldexp (511.25f, exponent - 9), 0.0f, 1e-20f, 1.0f },
+			{ std::ldexp (1.0f, exponent), std::ldexp (1.0f, exponent - 12), -1.0f, 1.0f }
+		};
+
+		for (const auto& pixel : pixels) {
+			values.insert (values.end (), pixel, pixel + 4);
+		}
+	}
+
+	while (values.size () % 16 != 12) {
+		values.push_back (1.0f);
+	}
+	const auto pixelCount = values.size () / 4;
+
+	std::vector<std::uint32_t> vector (pixelCount), scalar (pixelCount);
+	PackR9G9B9E5 (values.data (), vector.data (), pixelCount);
+	for (std::size_t i = 0; i < pixelCount; ++i) {
+		PackR9G9B9E5 (&values [i * 4], &scalar [i], 1);
+	}
+
+	int mismatches = 0, inaccurate = 0;
+	for (std::size_t i = 0; i < pixelCount; ++i) {
+		const auto pixel = &values [i * 4];
+		if (vector [i] != ReferencePackR9G9B9E5 (pixel) || scalar [i] != vector [i]) {
+			++mismatches;
+		}
+
+		// Decoded components are within half a step of the shared exponent
+		// of the clamped input, and the exponent fits the largest component
+		const int exponent = static_cast<int> (vector [i] >> 27);
+		const double step = std::ldexp (1, exponent - 24);
+		bool fits = exponent == 0;
+		for (int c = 0; c < 3; ++c) {
+			const double clamped = (pixel [c] > 0) ? std::fmin (pixel [c], 65408.0) : 0;
+			const double decoded = ((vector [i] >> (9 * c)) & 511) * step;
+
+			if (std::fabs (decoded - clamped) > step / 2) {
+				++inaccurate;
+			}
+
+			fits = fits || clamped >= step * 255.5;
+		}
+
+		if (! fits) {
+			++inaccurate;
+		}
+	}
+
+	CHECK (mismatches == 0);
+	CHECK (inaccurate == 0);
+}
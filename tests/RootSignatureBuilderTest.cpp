@@ -0,0 +1,229 @@
+#include "Test.h"
+
+#include <vector>
+
+#include "CountingDevice.h"
+#include "RootSignatureBuilder.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+ShaderBinding Texture (const int shaderRegister, const int count,
+	const UpdateFrequency frequency,
+	const ShaderVisibility visibility = ShaderVisibility::Pixel)
+{
+	return { BindingType::Texture, shaderRegister, count, frequency, visibility };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ShaderBinding ConstantBuffer (const int shaderRegister, const int size,
+	const UpdateFrequency frequency)
+{
+	return { BindingType::ConstantBuffer, shaderRegister, size, frequency,
+		ShaderVisibility::All };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Six constant buffers, which take 12 DWORDs as root descriptors. In the
+order they are promoted to root constants, with their extra cost:
+b2 (8 bytes, 0), b3 (per draw, 32 bytes, 6), b0 (per draw, 64 bytes, 14),
+b1 (per frame, 16 bytes, 2). b4 is static and b5 is too large, so both
+stay root descriptors.
+*/
+std::vector<ShaderBinding> CreateConstantBuffers ()
+{
+	return {
+		ConstantBuffer (0, 64, UpdateFrequency::PerDraw),
+		ConstantBuffer (1, 16, UpdateFrequency::PerFrame),
+		ConstantBuffer (2, 8, UpdateFrequency::PerMaterial),
+		ConstantBuffer (3, 32, UpdateFrequency::PerDraw),
+		ConstantBuffer (4, 16, UpdateFrequency::Static),
+		ConstantBuffer (5, 128, UpdateFrequency::PerDraw)
+	};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+RootParameterType GetType (const RootSignatureLayout& layout, const int binding)
+{
+	return layout.bindings [binding].type;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ConsecutiveTexturesShareATable)
+{
+	const std::vector<ShaderBinding> bindings = {
+		Texture (3, 1, UpdateFrequency::PerMaterial),
+		Texture (0, 1, UpdateFrequency::PerMaterial),
+		Texture (1, 2, UpdateFrequency::PerMaterial),
+		// Gap after t3
+		Texture (5, 1, UpdateFrequency::PerMaterial),
+		// Other frequency, other visibility
+		Texture (4, 1, UpdateFrequency::PerFrame),
+		Texture (4, 1, UpdateFrequency::PerMaterial, ShaderVisibility::Vertex)
+	};
+
+	const auto layout = BuildRootSignatureLayout (bindings, {});
+	const auto& parameters = layout.desc.parameters;
+	CHECK (parameters.size () == 4);
+
+	// t0 to t3 end up in one table, in register order
+	CHECK (parameters [0].type == RootParameterType::DescriptorTable);
+	CHECK (parameters [0].shaderRegister == 0);
+	CHECK (parameters [0].count == 4);
+	CHECK (layout.bindings [1].parameter == 0);
+	CHECK (layout.bindings [1].tableOffset == 0);
+	CHECK (layout.bindings [2].parameter == 0);
+	CHECK (layout.bindings [2].tableOffset == 1);
+	CHECK (layout.bindings [0].parameter == 0);
+	CHECK (layout.bindings [0].tableOffset == 3);
+
+	CHECK (parameters [1].shaderRegister == 5);
+	CHECK (parameters [1].count == 1);
+	CHECK (layout.bindings [3].parameter == 1);
+
+	CHECK (parameters [2].visibility == ShaderVisibility::Vertex);
+	CHECK (layout.bindings [5].parameter == 2);
+
+	// The per frame table comes after all per material ones
+	CHECK (parameters [3].shaderRegister == 4);
+	CHECK (parameters [3].visibility == ShaderVisibility::Pixel);
+	CHECK (layout.bindings [4].parameter == 3);
+	CHECK (layout.bindings [4].tableOffset == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (EverythingFitsWithoutLimit)
+{
+	const auto layout = BuildRootSignatureLayout (CreateConstantBuffers (), {});
+
+	CHECK (GetType (layout, 0) == RootParameterType::Constants);
+	CHECK (GetType (layout, 1) == RootParameterType::Constants);
+	CHECK (GetType (layout, 2) == RootParameterType::Constants);
+	CHECK (GetType (layout, 3) == RootParameterType::Constants);
+	CHECK (GetType (layout, 4) == RootParameterType::ConstantBufferView);
+	CHECK (GetType (layout, 5) == RootParameterType::ConstantBufferView);
+	CHECK (GetRootSignatureSize (layout.desc) == 34);
+
+	// Root constants hold one value per DWORD
+	CHECK (layout.desc.parameters [layout.bindings [0].parameter].count == 16);
+	CHECK (layout.desc.parameters [layout.bindings [2].parameter].count == 2);
+
+	// Per draw in binding order, then per material, per frame and static
+	CHECK (layout.bindings [0].parameter == 0);
+	CHECK (layout.bindings [3].parameter == 1);
+	CHECK (layout.bindings [5].parameter == 2);
+	CHECK (layout.bindings [2].parameter == 3);
+	CHECK (layout.bindings [1].parameter == 4);
+	CHECK (layout.bindings [4].parameter == 5);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (PromotionOrderUnderATightLimit)
+{
+	// b0 doesn't fit after b2 and b3, but the smaller b1 still does
+	auto layout = BuildRootSignatureLayout (CreateConstantBuffers (), {}, 20);
+	CHECK (GetType (layout, 2) == RootParameterType::Constants);
+	CHECK (GetType (layout, 3) == RootParameterType::Constants);
+	CHECK (GetType (layout, 0) == RootParameterType::ConstantBufferView);
+	CHECK (GetType (layout, 1) == RootParameterType::Constants);
+	CHECK (GetRootSignatureSize (layout.desc) == 20);
+
+	// One DWORD less, and b1 stays a root descriptor too
+	layout = BuildRootSignatureLayout (CreateConstantBuffers (), {}, 19);
+	CHECK (GetType (layout, 3) == RootParameterType::Constants);
+	CHECK (GetType (layout, 1) == RootParameterType::ConstantBufferView);
+	CHECK (GetRootSignatureSize (layout.desc) == 18);
+
+	// The two value buffer is free, so it's promoted even without room
+	layout = BuildRootSignatureLayout (CreateConstantBuffers (), {}, 12);
+	CHECK (GetType (layout, 2) == RootParameterType::Constants);
+	CHECK (GetType (layout, 3) == RootParameterType::ConstantBufferView);
+	CHECK (GetRootSignatureSize (layout.desc) == 12);
+
+	// With enough room for b0 but not b3 and b0, the cheaper b3 wins
+	layout = BuildRootSignatureLayout (CreateConstantBuffers (), {}, 26);
+	CHECK (GetType (layout, 3) == RootParameterType::Constants);
+	CHECK (GetType (layout, 0) == RootParameterType::ConstantBufferView);
+	CHECK (GetType (layout, 1) == RootParameterType::Constants);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (BindingsWhichDontFitThrow)
+{
+	CHECK_THROWS (BuildRootSignatureLayout (CreateConstantBuffers (), {}, 11));
+
+	// 32 root descriptors take exactly the 64 DWORDs, one more doesn't fit
+	std::vector<ShaderBinding> bindings;
+	for (int i = 0; i < 32; ++i) {
+		bindings.push_back (ConstantBuffer (i, 256, UpdateFrequency::PerFrame));
+	}
+	CHECK (GetRootSignatureSize (BuildRootSignatureLayout (bindings, {}).desc) == 64);
+
+	bindings.push_back (ConstantBuffer (32, 256, UpdateFrequency::PerFrame));
+	CHECK_THROWS (BuildRootSignatureLayout (bindings, {}));
+
+	CHECK_THROWS (BuildRootSignatureLayout (
+		{ Texture (0, 0, UpdateFrequency::Static) }, {}));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SerializationIsStable)
+{
+	RootSignatureDesc desc;
+	desc.parameters.push_back ({ RootParameterType::Constants, 1, 4,
+		ShaderVisibility::Vertex });
+	desc.parameters.push_back ({ RootParameterType::ConstantBufferView, 2, 0,
+		ShaderVisibility::All });
+	desc.staticSamplers.push_back ({ SamplerFilter::Linear, 3 });
+
+	// Little endian DWORDs: the parameter count, then type, register,
+	// count and visibility of each, the sampler count, then filter and
+	// register of each
+	const std::vector<std::uint8_t> expected = {
+		2, 0, 0, 0,
+		2, 0, 0, 0, 1, 0, 0, 0, 4, 0, 0, 0, 1, 0, 0, 0,
+		1, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 0, 0, 0,
+		2, 0, 0, 0, 3, 0, 0, 0
+	};
+	CHECK (SerializeRootSignature (desc) == expected);
+
+	// The count of root descriptors is ignored
+	auto other = desc;
+	other.parameters [1].count = 7;
+	CHECK (SerializeRootSignature (other) == expected);
+
+	other = desc;
+	other.parameters [0].count = 5;
+	CHECK (SerializeRootSignature (other) != expected);
+
+	other = desc;
+	other.staticSamplers [0].filter = SamplerFilter::Point;
+	CHECK (SerializeRootSignature (other) != expected);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (CacheSharesIdenticalRootSignatures)
+{
+	test::CountingDevice device;
+	RootSignatureCache cache (device);
+
+	// Different bindings, but both become one per draw constant buffer
+	const auto first = BuildRootSignatureLayout (
+		{ ConstantBuffer (0, 16, UpdateFrequency::PerDraw) }, {});
+	const auto second = BuildRootSignatureLayout (
+		{ ConstantBuffer (0, 12, UpdateFrequency::PerMaterial) }, {});
+	CHECK (first.desc.parameters [0].count == 4);
+	CHECK (second.desc.parameters [0].count == 3);
+
+	auto third = first;
+	third.desc.parameters [0].count = 3;
+
+	CHECK (cache.Get (first.desc) == cache.Get (first.desc));
+	CHECK (cache.Get (second.desc) == cache.Get (third.desc));
+	CHECK (cache.Get (first.desc) != cache.Get (second.desc));
+	CHECK (cache.GetRootSignatureCount () == 2);
+}
@@ -0,0 +1,166 @@
+#include "Test.h"
+
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ShaderArchive.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Write an archive like WriteArchive in buildShaderArchive.py: the header,
+the entries sorted by key, then the bytecode.
+*/
+std::vector<std::uint8_t> CreateArchive (
+	const std::map<std::uint64_t, std::string>& shaders)
+{
+	const std::uint32_t header [] = {
+		0x52415341, 1, static_cast<std::uint32_t> (shaders.size ()), 0
+	};
+
+	std::vector<std::uint8_t> archive (sizeof (header) + 16 * shaders.size ());
+	std::memcpy (archive.data (), header, sizeof (header));
+
+	std::size_t entryOffset = sizeof (header);
+	for (const auto& shader : shaders) {
+		const std::uint32_t offset = static_cast<std::uint32_t> (archive.size ());
+		const std::uint32_t size = static_cast<std::uint32_t> (shader.second.size ());
+
+		std::memcpy (archive.data () + entryOffset, &shader.first, 8);
+		std::memcpy (archive.data () + entryOffset + 8, &offset, 4);
+		std::memcpy (archive.data () + entryOffset + 12, &size, 4);
+		entryOffset += 16;
+
+		archive.insert (archive.end (), shader.second.begin (), shader.second.end ());
+	}
+
+	return archive;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::map<std::uint64_t, std::string> CreateShaders ()
+{
+	return {
+		{ GetShaderPermutationKey ("VS_main", 0), "vertex" },
+		{ GetShaderPermutationKey ("PS_main", 0), "pixel" },
+		{ GetShaderPermutationKey ("PS_main", 1), "pixel, alpha test" },
+		{ GetShaderPermutationKey ("PS_main", 3), "pixel, alpha test, grayscale" }
+	};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::string Find (const ShaderArchive& archive, const std::uint64_t key)
+{
+	const auto shader = archive.Find (key);
+	if (! shader.data) {
+		return "missing";
+	}
+
+	return std::string (static_cast<const char*> (shader.data), shader.size);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Entry field at byte offset within entry index of archive.
+*/
+void PatchEntry (std::vector<std::uint8_t>& archive, const int index,
+	const int offset, const std::uint32_t value)
+{
+	std::memcpy (archive.data () + 16 + 16 * index + offset, &value, 4);
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (KeysMatchTheArchiveTool)
+{
+	// Computed with GetPermutationKey in buildShaderArchive.py
+	static_assert (GetShaderPermutationKey ("VS_main", 0) == 0x605E38B200000000ull,
+		"Key differs from the archive tool");
+	CHECK (GetShaderPermutationKey ("PS_main", 3) == 0x9FEBB7B400000003ull);
+	CHECK (GetShaderPermutationKey ("", 0) == 0x811C9DC500000000ull);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FindReturnsTheBytecodeOfEachPermutation)
+{
+	const auto archiveData = CreateArchive (CreateShaders ());
+	const ShaderArchive archive (archiveData.data (), archiveData.size ());
+
+	CHECK (archive.GetShaderCount () == 4);
+	for (const auto& shader : CreateShaders ()) {
+		CHECK (Find (archive, shader.first) == shader.second);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (MissingPermutationsAreNotFound)
+{
+	const auto archiveData = CreateArchive (CreateShaders ());
+	const ShaderArchive archive (archiveData.data (), archiveData.size ());
+
+	CHECK (Find (archive, GetShaderPermutationKey ("PS_main", 2)) == "missing");
+	CHECK (Find (archive, GetShaderPermutationKey ("PS_other", 0)) == "missing");
+	CHECK (Find (archive, 0) == "missing");
+	CHECK (Find (archive, ~0ull) == "missing");
+
+	// Archives built without a compiler are empty
+	const auto emptyData = CreateArchive ({});
+	const ShaderArchive empty (emptyData.data (), emptyData.size ());
+	CHECK (empty.GetShaderCount () == 0);
+	CHECK (Find (empty, GetShaderPermutationKey ("VS_main", 0)) == "missing");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidHeadersThrow)
+{
+	const auto valid = CreateArchive (CreateShaders ());
+
+	// Shorter than the header
+	CHECK_THROWS (ShaderArchive (valid.data (), 15));
+
+	auto archive = valid;
+	archive [0] ^= 1;
+	CHECK_THROWS (ShaderArchive (archive.data (), archive.size ()));
+
+	archive = valid;
+	archive [4] = 2;
+	CHECK_THROWS (ShaderArchive (archive.data (), archive.size ()));
+
+	// More entries than fit into the archive
+	archive = valid;
+	const std::uint32_t count = 1000000;
+	std::memcpy (archive.data () + 8, &count, sizeof (count));
+	CHECK_THROWS (ShaderArchive (archive.data (), archive.size ()));
+
+	// The index is intact, but the last bytecode is cut off
+	CHECK_THROWS (ShaderArchive (valid.data (), valid.size () - 1));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidEntriesThrow)
+{
+	const auto valid = CreateArchive (CreateShaders ());
+
+	auto archive = valid;
+	PatchEntry (archive, 1, 8, static_cast<std::uint32_t> (archive.size () + 1));
+	CHECK_THROWS (ShaderArchive (archive.data (), archive.size ()));
+
+	// The size must not wrap around the offset
+	archive = valid;
+	PatchEntry (archive, 1, 12, 0xFFFFFFFF);
+	CHECK_THROWS (ShaderArchive (archive.data (), archive.size ()));
+
+	// Keys must be sorted and unique for the binary search
+	archive = valid;
+	std::memcpy (archive.data () + 16 + 16 * 2, archive.data () + 16, 8);
+	CHECK_THROWS (ShaderArchive (archive.data (), archive.size ()));
+
+	archive = valid;
+	std::memcpy (archive.data () + 16 + 16 * 1, archive.data () + 16, 8);
+	CHECK_THROWS (ShaderArchive (archive.data (), archive.size ()));
+}
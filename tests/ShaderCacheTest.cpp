@@ -0,0 +1,243 @@
+#include "Test.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "TemporaryFile.h"
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using namespace anteru;
+
+namespace {
+const char SHADER_SOURCE [] =
+	"// Pixel shader\n"
+	"float4 PS_main () : SV_Target { return COLOR; }\n"
+	"float4 PS_other () : SV_Target { return 0; }\n";
+
+///////////////////////////////////////////////////////////////////////////////
+ShaderDesc CreateShaderDesc (const char* source, const char* entryPoint,
+	const char* color)
+{
+	ShaderDesc desc = {
+		source, std::strlen (source), entryPoint, "ps_5_0",
+		{ { "COLOR", color } }, nullptr, 0
+	};
+	return desc;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Fill a cache file with the two shaders of SHADER_SOURCE.
+*/
+void CreateCacheFile (const test::TemporaryFile& file)
+{
+	StubShaderCompiler compiler;
+	ShaderCache cache (compiler, file.GetPath ());
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_other", "1"));
+	CHECK (cache.Save ());
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (MissCompilesAndHitReturnsTheSameBytecode)
+{
+	test::TemporaryFile file ("ShaderCacheTest.MissAndHit");
+	StubShaderCompiler compiler;
+	ShaderCache cache (compiler, file.GetPath ());
+
+	const auto desc = CreateShaderDesc (SHADER_SOURCE, "PS_main", "1");
+	const auto compiled = cache.GetBytecode (desc);
+	CHECK (compiler.GetCompileCount () == 1);
+	CHECK (cache.GetMissCount () == 1);
+
+	CHECK (cache.GetBytecode (desc) == compiled);
+	CHECK (compiler.GetCompileCount () == 1);
+	CHECK (cache.GetHitCount () == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (KeyCoversEverythingWhichAffectsTheBytecode)
+{
+	test::TemporaryFile file ("ShaderCacheTest.Key");
+	StubShaderCompiler compiler;
+	ShaderCache cache (compiler, file.GetPath ());
+
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+
+	// Other entry point, other define value, other profile
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_other", "1"));
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "0"));
+	auto desc = CreateShaderDesc (SHADER_SOURCE, "PS_main", "1");
+	desc.profile = "ps_5_1";
+	cache.GetBytecode (desc);
+	CHECK (compiler.GetCompileCount () == 4);
+
+	// Comments don't change the preprocessed source
+	const char commented [] =
+		"// Pixel shader, now with more comments\n"
+		"float4 PS_main () : SV_Target { return/* red */COLOR; }\n"
+		"float4 PS_other () : SV_Target { return 0; }// Unused\n";
+	cache.GetBytecode (CreateShaderDesc (commented, "PS_main", "1"));
+	CHECK (compiler.GetCompileCount () == 4);
+	CHECK (cache.GetHitCount () == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SavedEntriesAreFoundByTheNextRun)
+{
+	test::TemporaryFile file ("ShaderCacheTest.Persistent");
+	CreateCacheFile (file);
+
+	StubShaderCompiler compiler;
+	ShaderCache cache (compiler, file.GetPath ());
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_other", "1"));
+
+	CHECK (compiler.GetCompileCount () == 0);
+	CHECK (cache.GetHitCount () == 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (GarbageFileIsTreatedAsEmpty)
+{
+	test::TemporaryFile file ("ShaderCacheTest.Garbage");
+	file.Write (std::vector<char> (4096, 'x'));
+
+	StubShaderCompiler compiler;
+	{
+		ShaderCache cache (compiler, file.GetPath ());
+		cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+		CHECK (compiler.GetCompileCount () == 1);
+
+		// Saving replaces the damaged file with a valid one
+		CHECK (cache.Save ());
+	}
+
+	ShaderCache cache (compiler, file.GetPath ());
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+	CHECK (compiler.GetCompileCount () == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (EntryCountBeyondTheFileIsRejected)
+{
+	test::TemporaryFile file ("ShaderCacheTest.EntryCount");
+	CreateCacheFile (file);
+
+	// The entry count follows the magic and version in the header
+	auto contents = file.Read ();
+	const std::uint32_t entryCount = 1000000;
+	std::memcpy (contents.data () + 8, &entryCount, sizeof (entryCount));
+	file.Write (contents);
+
+	StubShaderCompiler compiler;
+	ShaderCache cache (compiler, file.GetPath ());
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+	CHECK (compiler.GetCompileCount () == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (TruncatedFileIsRejected)
+{
+	test::TemporaryFile file ("ShaderCacheTest.Truncated");
+	CreateCacheFile (file);
+
+	// The entries stay, but the bytecode of the last one is cut off
+	auto contents = file.Read ();
+	contents.resize (contents.size () - 8);
+	file.Write (contents);
+
+	StubShaderCompiler compiler;
+	ShaderCache cache (compiler, file.GetPath ());
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_other", "1"));
+
+	// The entry whose bytecode is cut off gets compiled again
+	CHECK (compiler.GetCompileCount () == 1);
+	CHECK (cache.GetHitCount () == 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (DamagedBytecodeFailsTheChecksum)
+{
+	test::TemporaryFile file ("ShaderCacheTest.Checksum");
+	CreateCacheFile (file);
+
+	auto contents = file.Read ();
+	contents.back () ^= 1;
+	file.Write (contents);
+
+	StubShaderCompiler compiler;
+	{
+		ShaderCache cache (compiler, file.GetPath ());
+		cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+		cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_other", "1"));
+		CHECK (compiler.GetCompileCount () == 1);
+
+		// The damaged entry is replaced by the freshly compiled one
+		CHECK (cache.Save ());
+	}
+
+	ShaderCache cache (compiler, file.GetPath ());
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+	cache.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_other", "1"));
+	CHECK (compiler.GetCompileCount () == 1);
+	CHECK (cache.GetHitCount () == 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SaveReplacesTheFileAtomically)
+{
+	test::TemporaryFile file ("ShaderCacheTest.Atomic");
+	CreateCacheFile (file);
+
+	StubShaderCompiler compiler;
+	ShaderCache reader (compiler, file.GetPath ());
+	ShaderCache writer (compiler, file.GetPath ());
+
+	writer.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "2"));
+	const bool saved = writer.Save ();
+
+	// The temporary file is gone, whether the rename worked or not; on
+	// Windows, it fails while reader maps the file
+	const auto temporaryPath = file.GetPath () + ".tmp" +
+		std::to_string (static_cast<unsigned long> (getpid ()));
+	CHECK (! std::ifstream (temporaryPath).good ());
+
+	// A cache which had the old file open still reads consistent entries
+	reader.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+	reader.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_other", "1"));
+	CHECK (reader.GetHitCount () == 2);
+
+	// The new file holds the old entries, merged with the new one
+	ShaderCache next (compiler, file.GetPath ());
+	next.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "1"));
+	next.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_other", "1"));
+	next.GetBytecode (CreateShaderDesc (SHADER_SOURCE, "PS_main", "2"));
+	CHECK (next.GetHitCount () == (saved ? 3 : 2));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FailedSaveKeepsTheEntries)
+{
+	StubShaderCompiler compiler;
+	ShaderCache cache (compiler, "ShaderCacheTest.missing/cache");
+
+	const auto desc = CreateShaderDesc (SHADER_SOURCE, "PS_main", "1");
+	cache.GetBytecode (desc);
+	CHECK (! cache.Save ());
+
+	cache.GetBytecode (desc);
+	CHECK (compiler.GetCompileCount () == 1);
+}
@@ -0,0 +1,100 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "D3D12Sample.h"
+#include "NullDevice.h"
+
+using namespace anteru;
+
+namespace {
+const int SIZE = 512;
+const int FRAME_COUNT = 48;
+
+typedef std::vector<std::uint8_t> Image;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Render the sample offscreen on the software device, whose pool has
+threadCount workers besides the queue thread, and return all frames
+tightly packed.
+*/
+std::vector<Image> RenderSample (const int threadCount)
+{
+	D3D12Sample sample (CreateSoftwareDevice (threadCount));
+	sample.SetStatisticsInterval (0);
+	sample.SetFramePacing (FramePacingMode::Disabled, 0);
+	sample.SetShaderCache ("");
+	sample.SetPipelineCache ("");
+
+	std::vector<Image> frames;
+	sample.SetOffscreen (SIZE, SIZE, [&] (const ReadbackFrame& frame) {
+		Image image (SIZE * SIZE * 4);
+		for (int y = 0; y < SIZE; ++y) {
+			std::copy (frame.data + y * frame.rowPitch,
+				frame.data + y * frame.rowPitch + SIZE * 4,
+				image.begin () + y * SIZE * 4);
+		}
+		frames.push_back (std::move (image));
+	});
+
+	sample.Run (FRAME_COUNT);
+	return frames;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Compare a pixel with its expected sRGB value, allowing for one step of
+rounding so the check survives other compilers.
+*/
+bool IsPixel (const Image& image, const int x, const int y,
+	const int r, const int g, const int b, const int a)
+{
+	const int expected [] = { r, g, b, a };
+	const auto pixel = image.data () + (y * SIZE + x) * 4;
+
+	for (int i = 0; i < 4; ++i) {
+		if (std::abs (pixel [i] - expected [i]) > 1) {
+			return false;
+		}
+	}
+
+	return true;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (OutputDoesNotDependOnThreadCount)
+{
+	const auto serial = RenderSample (0);
+	const auto parallel = RenderSample (3);
+
+	CHECK (serial.size () == FRAME_COUNT);
+	CHECK (parallel.size () == FRAME_COUNT);
+
+	for (std::size_t i = 0; i < std::min (serial.size (), parallel.size ()); ++i) {
+		CHECK (serial [i] == parallel [i]);
+	}
+
+	if (serial.size () != FRAME_COUNT) {
+		return;
+	}
+
+	// In the last frame the quad covers pixels 81 to 429 in both directions
+	const auto& frame = serial.back ();
+
+	// The clear color 0.042 in linear space, written as sRGB
+	CHECK (IsPixel (frame, 0, 0, 58, 58, 58, 255));
+	CHECK (IsPixel (frame, 511, 511, 58, 58, 58, 255));
+	// Opaque texels, minified with bilinear filtering
+	CHECK (IsPixel (frame, 232, 256, 235, 162, 162, 255));
+	CHECK (IsPixel (frame, 107, 98, 210, 94, 94, 255));
+	// A partially transparent texel blended over the clear color, and a
+	// transparent one which leaves the color alone. Blending writes the
+	// source alpha
+	CHECK (IsPixel (frame, 106, 98, 101, 56, 56, 137));
+	CHECK (IsPixel (frame, 88, 256, 58, 58, 58, 0));
+}
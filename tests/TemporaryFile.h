@@ -0,0 +1,57 @@
+#ifndef ANTERU_D3D12_SAMPLE_TEMPORARYFILE_H_
+#define ANTERU_D3D12_SAMPLE_TEMPORARYFILE_H_
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace anteru {
+namespace test {
+///////////////////////////////////////////////////////////////////////////////
+/**
+File in the working directory, which is deleted before and after the test.
+*/
+class TemporaryFile final
+{
+public:
+	explicit TemporaryFile (const std::string& path)
+		: path_ (path)
+	{
+		std::remove (path_.c_str ());
+	}
+
+	~TemporaryFile ()
+	{
+		std::remove (path_.c_str ());
+	}
+
+	TemporaryFile (const TemporaryFile&) = delete;
+	TemporaryFile& operator= (const TemporaryFile&) = delete;
+
+	const std::string& GetPath () const
+	{
+		return path_;
+	}
+
+	std::vector<char> Read () const
+	{
+		std::ifstream input (path_, std::ios::binary);
+		return std::vector<char> (std::istreambuf_iterator<char> (input),
+			std::istreambuf_iterator<char> ());
+	}
+
+	void Write (const std::vector<char>& contents) const
+	{
+		std::ofstream output (path_, std::ios::binary);
+		output.write (contents.data (), contents.size ());
+	}
+
+private:
+	std::string path_;
+};
+}
+}
+
+#endif
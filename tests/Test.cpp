@@ -0,0 +1,83 @@
+#include "Test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+namespace anteru {
+namespace test {
+namespace {
+struct TestCase
+{
+	const char* name;
+	void (*function) ();
+};
+
+std::vector<TestCase>& GetTestCases ()
+{
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+int failedChecks = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TestRegistration::TestRegistration (const char* name, void (*function) ())
+{
+	GetTestCases ().push_back ({ name, function });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ReportFailure (const char* file, const int line, const std::string& message)
+{
+	std::fprintf (stderr, "%s(%d): check failed: %s\n", file, line,
+		message.c_str ());
+	++failedChecks;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int RunTests (const char* filter)
+{
+	int failedTests = 0;
+	int testCount = 0;
+
+	for (const auto& testCase : GetTestCases ()) {
+		if (filter && ! std::strstr (testCase.name, filter)) {
+			continue;
+		}
+
+		++testCount;
+		const int previousFailedChecks = failedChecks;
+
+		try {
+			testCase.function ();
+		} catch (const std::exception& e) {
+			ReportFailure (testCase.name, 0,
+				std::string ("unexpected exception: ") + e.what ());
+		} catch (...) {
+			ReportFailure (testCase.name, 0, "unexpected exception");
+		}
+
+		const bool passed = failedChecks == previousFailedChecks;
+		std::printf ("%s %s\n", passed ? "[ OK ]" : "[FAIL]", testCase.name);
+
+		if (! passed) {
+			++failedTests;
+		}
+	}
+
+	std::printf ("%d of %d test cases passed\n", testCount - failedTests,
+		testCount);
+
+	return failedTests;
+}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main (int argc, char* argv [])
+{
+	return anteru::test::RunTests (argc > 1 ? argv [1] : nullptr) == 0 ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+#ifndef ANTERU_D3D12_SAMPLE_TEST_H_
+#define ANTERU_D3D12_SAMPLE_TEST_H_
+
+#include <string>
+
+namespace anteru {
+namespace test {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Registers a test case at static initialization time. Use TEST_CASE instead
+of instantiating this directly.
+*/
+class TestRegistration final
+{
+public:
+	TestRegistration (const char* name, void (*function) ());
+};
+
+void ReportFailure (const char* file, const int line, const std::string& message);
+
+/**
+Run all registered test cases, or only those whose name contains filter.
+Returns the number of failed test cases.
+*/
+int RunTests (const char* filter = nullptr);
+}
+}
+
+#define TEST_CASE(name) \
+	static void name (); \
+	static const ::anteru::test::TestRegistration name##Registration (#name, &name); \
+	static void name ()
+
+#define CHECK(expression) \
+	do { \
+		if (! (expression)) { \
+			::anteru::test::ReportFailure (__FILE__, __LINE__, #expression); \
+		} \
+	} while (0)
+
+#define CHECK_THROWS(expression) \
+	do { \
+		bool thrown = false; \
+		try { \
+			expression; \
+		} catch (...) { \
+			thrown = true; \
+		} \
+		if (! thrown) { \
+			::anteru::test::ReportFailure (__FILE__, __LINE__, \
+				"expected an exception from " #expression); \
+		} \
+	} while (0)
+
+#endif
@@ -0,0 +1,513 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "RenderDevice.h"
+#include "TexturePacking.h"
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+namespace {
+typedef std::vector<std::uint8_t> Pixels;
+
+// Odd sizes and padded rows, so every row goes through the tails of the
+// vectorized analysis
+const int WIDTH = 37;
+const int HEIGHT = 13;
+const int ROW_PITCH = WIDTH * 4 + 12;
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+An image with padded rows, where the padding holds values which would
+change the analysis if it was read.
+*/
+template <typename Function>
+Pixels CreateImage (const int width, const int height, const int rowPitch,
+	Function function)
+{
+	Pixels result (static_cast<std::size_t> (rowPitch) * height, 0x5A);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			function (x, y, &result [static_cast<std::size_t> (y) * rowPitch + x * 4]);
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::uint8_t ApplySource (const ComponentSource source, const std::uint8_t* pixel)
+{
+	switch (source) {
+	case ComponentSource::Red: return pixel [0];
+	case ComponentSource::Green: return pixel [1];
+	case ComponentSource::Blue: return pixel [2];
+	case ComponentSource::Alpha: return pixel [3];
+	case ComponentSource::Zero: return 0;
+	case ComponentSource::One: return 255;
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool operator== (const ComponentMapping& a, const ComponentMapping& b)
+{
+	return a.red == b.red && a.green == b.green &&
+		a.blue == b.blue && a.alpha == b.alpha;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Unpack a texture and apply its mapping, which gives the RGBA values a
+shader would see, tightly packed.
+*/
+Pixels Sample (const PackedTexture& texture)
+{
+	Pixels unpacked (static_cast<std::size_t> (texture.width) * texture.height * 4);
+	UnpackTexture (texture.data.data (), texture.width, texture.height,
+		texture.rowPitch, texture.format, unpacked.data ());
+
+	Pixels result (unpacked.size ());
+	for (std::size_t i = 0; i < unpacked.size (); i += 4) {
+		result [i + 0] = ApplySource (texture.mapping.red, &unpacked [i]);
+		result [i + 1] = ApplySource (texture.mapping.green, &unpacked [i]);
+		result [i + 2] = ApplySource (texture.mapping.blue, &unpacked [i]);
+		result [i + 3] = ApplySource (texture.mapping.alpha, &unpacked [i]);
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Sum of squared differences between a padded image and tightly packed
+pixels, over the first channelCount channels.
+*/
+std::int64_t GetSquaredError (const Pixels& image, const int width,
+	const int height, const int rowPitch, const Pixels& pixels,
+	const int channelCount)
+{
+	std::int64_t error = 0;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			for (int c = 0; c < channelCount; ++c) {
+				const int difference =
+					image [static_cast<std::size_t> (y) * rowPitch + x * 4 + c] -
+					pixels [(static_cast<std::size_t> (y) * width + x) * 4 + c];
+				error += difference * difference;
+			}
+		}
+	}
+
+	return error;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Pack an image, check the layout of the result and that it reads back as
+the input, and return it.
+*/
+PackedTexture PackLossless (const Pixels& image, const int width,
+	const int height, const int rowPitch, const TexturePackingOptions& options)
+{
+	const auto texture = PackTexture (image.data (), width, height, rowPitch, options);
+
+	const auto bytesPerPixel = GetBytesPerPixel (texture.format);
+	CHECK (bytesPerPixel > 0);
+	CHECK (texture.width == width);
+	CHECK (texture.height == height);
+	CHECK (texture.rowPitch % TEXTURE_DATA_PITCH_ALIGNMENT == 0);
+	CHECK (texture.rowPitch >= width * bytesPerPixel);
+	CHECK (texture.data.size () ==
+		static_cast<std::size_t> (texture.rowPitch) * height);
+	CHECK (texture.originalSize == static_cast<std::size_t> (width) * height * 4);
+	CHECK (texture.packedSize ==
+		static_cast<std::size_t> (width) * height * bytesPerPixel);
+
+	CHECK (GetSquaredError (image, width, height, rowPitch, Sample (texture), 4) == 0);
+
+	return texture;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TexturePackingOptions LinearOptions ()
+{
+	TexturePackingOptions options;
+	options.srgb = false;
+	return options;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Smooth image without sharp edges, which block compresses well.
+*/
+Pixels CreateGradient (const int width, const int height, const int rowPitch,
+	const bool opaque)
+{
+	return CreateImage (width, height, rowPitch,
+		[=] (const int x, const int y, std::uint8_t* pixel) {
+			pixel [0] = static_cast<std::uint8_t> (64 + x * 2);
+			pixel [1] = static_cast<std::uint8_t> (32 + y * 3);
+			pixel [2] = static_cast<std::uint8_t> (128 + (x + y) / 2);
+			pixel [3] = static_cast<std::uint8_t> (opaque ? 255 : 100 + x + y);
+		});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+The smallest error with which a single value can be represented in a BC1
+block, over all pairs of endpoints with bits bits, by either endpoint or
+the color interpolated between them.
+*/
+int GetSingleValueError (const int value, const int bits)
+{
+	int result = 255;
+	for (int a = 0; a < (1 << bits); ++a) {
+		for (int b = 0; b < (1 << bits); ++b) {
+			const int expandedA = (a << (8 - bits)) | (a >> (2 * bits - 8));
+			const int expandedB = (b << (8 - bits)) | (b >> (2 * bits - 8));
+			result = std::min (result, std::abs (expandedA - value));
+			result = std::min (result, std::abs ((2 * expandedA + expandedB + 1) / 3 - value));
+		}
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int GetBlockError (const std::uint8_t* a, const std::uint8_t* b,
+	const int channelCount)
+{
+	int error = 0;
+	for (int i = 0; i < 16; ++i) {
+		for (int c = 0; c < channelCount; ++c) {
+			const int difference = a [4 * i + c] - b [4 * i + c];
+			error += difference * difference;
+		}
+	}
+
+	return error;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (GrayscalePicksR8)
+{
+	for (const int alpha : { 255, 0 }) {
+		const auto image = CreateImage (WIDTH, HEIGHT, ROW_PITCH,
+			[=] (const int x, const int y, std::uint8_t* pixel) {
+				pixel [0] = pixel [1] = pixel [2] =
+					static_cast<std::uint8_t> (x * 7 + y * 13);
+				pixel [3] = static_cast<std::uint8_t> (alpha);
+			});
+
+		const auto texture = PackLossless (image, WIDTH, HEIGHT, ROW_PITCH,
+			LinearOptions ());
+		CHECK (texture.format == PixelFormat::R8_UNorm);
+		CHECK (texture.packedSize == static_cast<std::size_t> (WIDTH) * HEIGHT);
+
+		const ComponentMapping mapping = { ComponentSource::Red,
+			ComponentSource::Red, ComponentSource::Red,
+			alpha == 255 ? ComponentSource::One : ComponentSource::Zero };
+		CHECK (texture.mapping == mapping);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (GrayscaleWithAlphaPicksR8G8)
+{
+	const auto image = CreateImage (WIDTH, HEIGHT, ROW_PITCH,
+		[] (const int x, const int y, std::uint8_t* pixel) {
+			pixel [0] = pixel [1] = pixel [2] = static_cast<std::uint8_t> (x * 5);
+			pixel [3] = static_cast<std::uint8_t> (y * 19);
+		});
+
+	const auto texture = PackLossless (image, WIDTH, HEIGHT, ROW_PITCH,
+		LinearOptions ());
+	CHECK (texture.format == PixelFormat::R8G8_UNorm);
+
+	const ComponentMapping mapping = { ComponentSource::Red,
+		ComponentSource::Red, ComponentSource::Red, ComponentSource::Green };
+	CHECK (texture.mapping == mapping);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ConstantBlueAndAlphaPicksR8G8)
+{
+	for (const int blue : { 0, 255 }) {
+		for (const int alpha : { 0, 255 }) {
+			const auto image = CreateImage (WIDTH, HEIGHT, ROW_PITCH,
+				[=] (const int x, const int y, std::uint8_t* pixel) {
+					pixel [0] = static_cast<std::uint8_t> (x * 7);
+					pixel [1] = static_cast<std::uint8_t> (y * 11);
+					pixel [2] = static_cast<std::uint8_t> (blue);
+					pixel [3] = static_cast<std::uint8_t> (alpha);
+				});
+
+			const auto texture = PackLossless (image, WIDTH, HEIGHT, ROW_PITCH,
+				LinearOptions ());
+			CHECK (texture.format == PixelFormat::R8G8_UNorm);
+
+			const ComponentMapping mapping = { ComponentSource::Red,
+				ComponentSource::Green,
+				blue == 255 ? ComponentSource::One : ComponentSource::Zero,
+				alpha == 255 ? ComponentSource::One : ComponentSource::Zero };
+			CHECK (texture.mapping == mapping);
+		}
+	}
+
+	// Constants other than 0 and 255 cannot come from the view
+	const auto image = CreateImage (WIDTH, HEIGHT, ROW_PITCH,
+		[] (const int x, const int y, std::uint8_t* pixel) {
+			pixel [0] = static_cast<std::uint8_t> (x * 7);
+			pixel [1] = static_cast<std::uint8_t> (y * 11);
+			pixel [2] = 128;
+			pixel [3] = 255;
+		});
+
+	const auto texture = PackLossless (image, WIDTH, HEIGHT, ROW_PITCH,
+		LinearOptions ());
+	CHECK (texture.format == PixelFormat::R8G8B8A8_UNorm);
+	CHECK (texture.mapping == IDENTITY_COMPONENT_MAPPING);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SrgbStaysRgba8)
+{
+	// Grayscale would fit R8, but there is no sRGB variant of it
+	const auto image = CreateImage (WIDTH, HEIGHT, ROW_PITCH,
+		[] (const int x, const int y, std::uint8_t* pixel) {
+			pixel [0] = pixel [1] = pixel [2] = static_cast<std::uint8_t> (x + y);
+			pixel [3] = 255;
+		});
+
+	TexturePackingOptions options;
+	options.allowBlockCompression = true;
+
+	const auto texture = PackLossless (image, WIDTH, HEIGHT, ROW_PITCH, options);
+	CHECK (texture.format == PixelFormat::R8G8B8A8_UNorm_sRGB);
+	CHECK (texture.mapping == IDENTITY_COMPONENT_MAPPING);
+	CHECK (texture.packedSize == texture.originalSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (AnalysisFindsEveryPixel)
+{
+	// A single differing pixel at each position, for every width up to a few
+	// vectors, so the vector loops and the scalar tails are both covered
+	for (int width = 1; width <= 9; ++width) {
+		const int height = 3;
+		const int rowPitch = width * 4 + 4;
+
+		for (int position = 0; position < width * height; ++position) {
+			const auto image = CreateImage (width, height, rowPitch,
+				[=] (const int x, const int y, std::uint8_t* pixel) {
+					pixel [0] = pixel [1] = pixel [2] = 100;
+					pixel [3] = 200;
+					if (y * width + x == position) {
+						pixel [1] = 101;
+						pixel [3] = 7;
+					}
+				});
+
+			const auto content = AnalyzeTextureContent (image.data (),
+				width, height, rowPitch);
+			CHECK (! content.grayscale);
+			CHECK (content.minimum [0] == 100 && content.maximum [0] == 100);
+			CHECK (content.minimum [1] == 100 && content.maximum [1] == 101);
+			CHECK (content.minimum [2] == 100 && content.maximum [2] == 100);
+			CHECK (content.minimum [3] == 7 && content.maximum [3] == 200);
+		}
+
+		const auto image = CreateImage (width, height, rowPitch,
+			[] (const int x, const int y, std::uint8_t* pixel) {
+				pixel [0] = pixel [1] = pixel [2] = static_cast<std::uint8_t> (x * 30 + y);
+				pixel [3] = 255;
+			});
+		CHECK (AnalyzeTextureContent (image.data (), width, height, rowPitch).grayscale);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SmoothImagesAreBlockCompressed)
+{
+	const int width = 32;
+	const int height = 16;
+	const int rowPitch = width * 4 + 16;
+
+	for (const bool srgb : { false, true }) {
+		for (const bool opaque : { true, false }) {
+			const auto image = CreateGradient (width, height, rowPitch, opaque);
+
+			TexturePackingOptions options;
+			options.srgb = srgb;
+			options.allowBlockCompression = true;
+
+			const auto texture = PackTexture (image.data (), width, height,
+				rowPitch, options);
+			const auto format = opaque
+				? (srgb ? PixelFormat::BC1_UNorm_sRGB : PixelFormat::BC1_UNorm)
+				: (srgb ? PixelFormat::BC3_UNorm_sRGB : PixelFormat::BC3_UNorm);
+			CHECK (texture.format == format);
+			CHECK (texture.mapping == IDENTITY_COMPONENT_MAPPING);
+			CHECK (texture.rowPitch % TEXTURE_DATA_PITCH_ALIGNMENT == 0);
+			CHECK (texture.data.size () ==
+				static_cast<std::size_t> (texture.rowPitch) * (height / 4));
+			CHECK (texture.packedSize ==
+				static_cast<std::size_t> (width / 4) * (height / 4) * (opaque ? 8 : 16));
+
+			const int channelCount = opaque ? 3 : 4;
+			const auto error = GetSquaredError (image, width, height, rowPitch,
+				Sample (texture), channelCount);
+			CHECK (std::sqrt (static_cast<double> (error) /
+				(width * height * channelCount)) <= options.maxBlockCompressionError);
+
+			ThreadPool threadPool (3);
+			const auto parallel = PackTexture (image.data (), width, height,
+				rowPitch, options, &threadPool);
+			CHECK (parallel.format == texture.format);
+			CHECK (parallel.data == texture.data);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (NoisyImagesAreNotBlockCompressed)
+{
+	std::mt19937 random (42);
+	const auto noise = CreateImage (16, 16, 64,
+		[&] (const int, const int, std::uint8_t* pixel) {
+			for (int c = 0; c < 4; ++c) {
+				pixel [c] = static_cast<std::uint8_t> (random ());
+			}
+		});
+
+	TexturePackingOptions options;
+	options.srgb = false;
+	options.allowBlockCompression = true;
+
+	auto texture = PackLossless (noise, 16, 16, 64, options);
+	CHECK (texture.format == PixelFormat::R8G8B8A8_UNorm);
+
+	// Sizes which are not a multiple of 4 cannot be block compressed
+	const auto gradient = CreateGradient (WIDTH, HEIGHT, ROW_PITCH, true);
+	texture = PackLossless (gradient, WIDTH, HEIGHT, ROW_PITCH, options);
+	CHECK (texture.format == PixelFormat::R8G8B8A8_UNorm);
+
+	// Neither can anything without the option
+	options.allowBlockCompression = false;
+	const auto smooth = CreateGradient (16, 16, 64, true);
+	texture = PackLossless (smooth, 16, 16, 64, options);
+	CHECK (texture.format == PixelFormat::R8G8B8A8_UNorm);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (InvalidTexturesThrow)
+{
+	const Pixels image (64, 0);
+	CHECK_THROWS (PackTexture (image.data (), 0, 4, 16, TexturePackingOptions ()));
+	CHECK_THROWS (PackTexture (image.data (), 4, 0, 16, TexturePackingOptions ()));
+
+	Pixels pixels (64);
+	CHECK_THROWS (UnpackTexture (image.data (), 4, 4, 16,
+		PixelFormat::R32_UInt, pixels.data ()));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (BlockErrorsMatchDecodedBlocks)
+{
+	std::mt19937 random (7);
+	std::vector<Pixels> blocks;
+
+	for (int i = 0; i < 200; ++i) {
+		Pixels block (64);
+		for (auto& value : block) {
+			value = static_cast<std::uint8_t> (random ());
+		}
+		blocks.push_back (block);
+	}
+
+	for (int i = 0; i < 50; ++i) {
+		// Gradients, two colors and alpha which is either 0 or 255
+		Pixels gradient (64), twoColors (64);
+		const int start = random () % 200, step = random () % 4;
+		for (int p = 0; p < 16; ++p) {
+			for (int c = 0; c < 4; ++c) {
+				gradient [4 * p + c] = static_cast<std::uint8_t> (start + p * step + c);
+				twoColors [4 * p + c] = static_cast<std::uint8_t> (
+					(p & 1) ? start + c * 10 : 255 - start);
+			}
+			twoColors [4 * p + 3] = (p & 2) ? 255 : 0;
+		}
+		blocks.push_back (gradient);
+		blocks.push_back (twoColors);
+	}
+
+	for (int value = 0; value < 256; value += 3) {
+		blocks.push_back (Pixels (64, static_cast<std::uint8_t> (value)));
+	}
+
+	for (const auto& pixels : blocks) {
+		std::uint8_t block [16], decoded [64];
+
+		const int bc1Error = EncodeBc1Block (pixels.data (), block);
+		DecodeBc1Block (block, decoded);
+		CHECK (bc1Error == GetBlockError (pixels.data (), decoded, 3));
+
+		const int bc3Error = EncodeBc3Block (pixels.data (), block);
+		DecodeBc3Block (block, decoded);
+		CHECK (bc3Error == GetBlockError (pixels.data (), decoded, 4));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (SolidBlocksUseOptimalEndpoints)
+{
+	int optimal5 [256], optimal6 [256];
+	for (int value = 0; value < 256; ++value) {
+		optimal5 [value] = GetSingleValueError (value, 5);
+		optimal6 [value] = GetSingleValueError (value, 6);
+	}
+
+	std::mt19937 random (11);
+	for (int i = 0; i < 2000; ++i) {
+		// All gray levels first, then random colors
+		std::uint8_t color [4];
+		for (int c = 0; c < 4; ++c) {
+			color [c] = static_cast<std::uint8_t> (i < 256 ? i : random ());
+		}
+
+		std::uint8_t pixels [64];
+		for (int p = 0; p < 16; ++p) {
+			std::copy (color, color + 4, pixels + 4 * p);
+		}
+
+		const int expected = 16 * (
+			optimal5 [color [0]] * optimal5 [color [0]] +
+			optimal6 [color [1]] * optimal6 [color [1]] +
+			optimal5 [color [2]] * optimal5 [color [2]]);
+
+		std::uint8_t block [16], decoded [64];
+		CHECK (EncodeBc1Block (pixels, block) == expected);
+		DecodeBc1Block (block, decoded);
+		CHECK (GetBlockError (pixels, decoded, 3) == expected);
+
+		// Solid alpha is always exact
+		CHECK (EncodeBc3Block (pixels, block) == expected);
+	}
+
+	// Lies exactly between two 5-bit endpoints
+	std::uint8_t pixels [64];
+	std::fill (pixels, pixels + 64, std::uint8_t (77));
+
+	std::uint8_t block [8];
+	CHECK (EncodeBc1Block (pixels, block) == 0);
+}
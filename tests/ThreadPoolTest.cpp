@@ -0,0 +1,137 @@
+#include "Test.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+
+using namespace anteru;
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ParallelForVisitsEveryIndexOnce)
+{
+	ThreadPool pool (3);
+
+	std::vector<std::atomic<int>> visits (1000);
+	for (auto& visit : visits) {
+		visit = 0;
+	}
+
+	pool.ParallelFor (1000, [&] (const int i) {
+		++visits [i];
+	});
+
+	for (const auto& visit : visits) {
+		CHECK (visit == 1);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ParallelForRethrowsOnCallingThread)
+{
+	ThreadPool pool (3);
+
+	for (int thrower = 0; thrower < 64; thrower += 7) {
+		std::atomic<int> finished (0);
+
+		CHECK_THROWS (pool.ParallelFor (64, [&] (const int i) {
+			// Keep workers busy so some of them are still running when the
+			// exception is thrown
+			std::this_thread::sleep_for (std::chrono::microseconds (100));
+			if (i == thrower) {
+				throw std::runtime_error ("Task failed.");
+			}
+			++finished;
+		}));
+
+		CHECK (finished < 64);
+	}
+
+	// The pool stays usable
+	std::atomic<int> count (0);
+	pool.ParallelFor (100, [&] (const int) {
+		++count;
+	});
+	CHECK (count == 100);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ParallelForRethrowsFirstException)
+{
+	ThreadPool pool (2);
+
+	bool caught = false;
+	try {
+		pool.ParallelFor (16, [&] (const int) {
+			throw std::runtime_error ("Every task fails.");
+		});
+	} catch (const std::runtime_error&) {
+		caught = true;
+	}
+
+	CHECK (caught);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (NestedParallelForRunsInline)
+{
+	ThreadPool pool (3);
+
+	std::atomic<int> count (0);
+	pool.ParallelFor (8, [&] (const int) {
+		pool.ParallelFor (8, [&] (const int) {
+			++count;
+		});
+	});
+
+	CHECK (count == 64);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ParallelForInsideTask)
+{
+	ThreadPool pool (2);
+
+	auto result = pool.Submit ([&] () {
+		std::atomic<int> count (0);
+		pool.ParallelFor (100, [&] (const int) {
+			++count;
+		});
+		return count.load ();
+	});
+
+	CHECK (result.get () == 100);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (TaskExceptionReachesFuture)
+{
+	ThreadPool pool (1);
+
+	auto result = pool.Submit ([] () -> int {
+		throw std::runtime_error ("Task failed.");
+	});
+
+	CHECK_THROWS (result.get ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ZeroWorkersRunInline)
+{
+	ThreadPool pool (0);
+	CHECK (pool.GetConcurrency () == 1);
+
+	const auto caller = std::this_thread::get_id ();
+	bool ranInline = true;
+	pool.ParallelFor (10, [&] (const int) {
+		ranInline = ranInline && std::this_thread::get_id () == caller;
+	});
+	CHECK (ranInline);
+
+	CHECK_THROWS (pool.ParallelFor (10, [] (const int) {
+		throw std::runtime_error ("Task failed.");
+	}));
+}
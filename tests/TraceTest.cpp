@@ -0,0 +1,353 @@
+#include "Test.h"
+
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Trace.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Just enough JSON to read the trace back: an exported event is an object
+of strings, numbers and one nested object for the arguments. Nested
+objects are flattened into "args.name" keys.
+*/
+class TraceReader final
+{
+public:
+	typedef std::map<std::string, std::string> Event;
+
+	/**
+	Returns false if text is not valid JSON of the expected structure.
+	*/
+	bool Read (const std::string& text)
+	{
+		p_ = text.c_str ();
+		end_ = p_ + text.size ();
+		events.clear ();
+
+		Event root;
+		if (! ReadObject (root, "", true) || (SkipWhitespace (), p_ != end_)) {
+			return false;
+		}
+
+		return root.count ("displayTimeUnit") == 1;
+	}
+
+	std::vector<Event> events;
+
+private:
+	void SkipWhitespace ()
+	{
+		while (p_ != end_ && (*p_ == ' ' || *p_ == '\n')) {
+			++p_;
+		}
+	}
+
+	bool Consume (const char c)
+	{
+		SkipWhitespace ();
+		if (p_ != end_ && *p_ == c) {
+			++p_;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool ReadString (std::string& result)
+	{
+		if (! Consume ('"')) {
+			return false;
+		}
+
+		for (; p_ != end_ && *p_ != '"'; ++p_) {
+			if (static_cast<unsigned char> (*p_) < 0x20) {
+				return false;
+			}
+
+			if (*p_ == '\\') {
+				if (++p_ == end_ || (*p_ != '"' && *p_ != '\\')) {
+					return false;
+				}
+			}
+
+			result.push_back (*p_);
+		}
+
+		return p_ != end_ && *p_++ == '"';
+	}
+
+	bool ReadNumber (std::string& result)
+	{
+		char* end = nullptr;
+		std::strtod (p_, &end);
+		if (end == p_ || end > end_) {
+			return false;
+		}
+
+		result.assign (p_, end - p_);
+		p_ = end;
+		return true;
+	}
+
+	/**
+	The trace events array is only allowed at the top level, and collected
+	into events.
+	*/
+	bool ReadObject (Event& object, const std::string& prefix, const bool root)
+	{
+		if (! Consume ('{')) {
+			return false;
+		}
+
+		if (Consume ('}')) {
+			return true;
+		}
+
+		do {
+			std::string key;
+			if (! ReadString (key) || ! Consume (':')) {
+				return false;
+			}
+
+			SkipWhitespace ();
+			if (p_ == end_) {
+				return false;
+			}
+
+			std::string value;
+			if (*p_ == '{') {
+				if (! ReadObject (object, prefix + key + ".", false)) {
+					return false;
+				}
+				continue;
+			} else if (*p_ == '[') {
+				if (! root || key != "traceEvents" || ! ReadEvents ()) {
+					return false;
+				}
+			} else if (*p_ == '"') {
+				if (! ReadString (value)) {
+					return false;
+				}
+			} else if (! ReadNumber (value)) {
+				return false;
+			}
+
+			if (! object.insert (std::make_pair (prefix + key, value)).second) {
+				return false;
+			}
+		} while (Consume (','));
+
+		return Consume ('}');
+	}
+
+	bool ReadEvents ()
+	{
+		Consume ('[');
+		if (Consume (']')) {
+			return true;
+		}
+
+		do {
+			events.emplace_back ();
+			if (! ReadObject (events.back (), "", false)) {
+				return false;
+			}
+		} while (Consume (','));
+
+		return Consume (']');
+	}
+
+	const char* p_;
+	const char* end_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+std::string ExportTrace ()
+{
+	std::ostringstream output;
+	Tracer::WriteChromeTrace (output);
+	return output.str ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void RecordNestedScopes (const int depth)
+{
+	TraceScope scope ("Scope", "depth", depth);
+	TraceCounter ("Depth", depth);
+
+	if (depth > 0) {
+		RecordNestedScopes (depth - 1);
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (ScopesFromManyThreadsAreBalanced)
+{
+	Tracer::Clear ();
+	// Flush often, so the flusher drains while the threads record
+	Tracer::Start (1);
+
+	const int THREAD_COUNT = 4;
+	// 12000 events per thread, which fit into the buffer even if the
+	// flusher never gets to run
+	const int ITERATIONS = 1000;
+	const int DEPTH = 4;
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < THREAD_COUNT; ++i) {
+		threads.emplace_back ([] () {
+			Tracer::SetThreadName ("Worker");
+			for (int j = 0; j < ITERATIONS; ++j) {
+				RecordNestedScopes (DEPTH - 1);
+			}
+		});
+	}
+
+	for (auto& thread : threads) {
+		thread.join ();
+	}
+
+	Tracer::Stop ();
+	CHECK (Tracer::GetDroppedEventCount () == 0);
+
+	TraceReader reader;
+	CHECK (reader.Read (ExportTrace ()));
+
+	// Per thread, the events must be in recording order, so every end
+	// closes the innermost open scope
+	std::map<std::string, std::vector<std::string>> openScopes;
+	std::map<std::string, int> scopeCounts;
+	int threadNames = 0;
+
+	for (const auto& event : reader.events) {
+		const auto& phase = event.at ("ph");
+		const auto& thread = event.at ("tid");
+
+		if (phase == "M") {
+			threadNames += event.at ("args.name") == "Worker" ? 1 : 0;
+		} else if (phase == "B") {
+			CHECK (event.at ("name") == "Scope");
+			CHECK (event.count ("args.depth") == 1);
+			openScopes [thread].push_back (event.at ("args.depth"));
+			++scopeCounts [thread];
+		} else if (phase == "E") {
+			CHECK (! openScopes [thread].empty ());
+			if (! openScopes [thread].empty ()) {
+				openScopes [thread].pop_back ();
+			}
+		} else {
+			CHECK (phase == "C");
+			CHECK (event.at ("name") == "Depth");
+		}
+	}
+
+	CHECK (threadNames == THREAD_COUNT);
+	CHECK (scopeCounts.size () == THREAD_COUNT);
+	for (const auto& count : scopeCounts) {
+		CHECK (count.second == ITERATIONS * DEPTH);
+		CHECK (openScopes [count.first].empty ());
+	}
+
+	Tracer::Clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (NamesAreEscaped)
+{
+	Tracer::Clear ();
+	Tracer::Start (0);
+
+	std::thread thread ([] () {
+		Tracer::SetThreadName ("Thread \"1\"");
+		TraceInstant ("Quote \" backslash \\ newline\n tab\t", "a\\b", 42);
+	});
+	thread.join ();
+
+	Tracer::Stop ();
+
+	TraceReader reader;
+	CHECK (reader.Read (ExportTrace ()));
+
+	int found = 0;
+	for (const auto& event : reader.events) {
+		if (event.at ("ph") == "M" && event.at ("args.name") == "Thread \"1\"") {
+			found |= 1;
+		} else if (event.at ("ph") == "i") {
+			// Control characters become spaces
+			CHECK (event.at ("name") == "Quote \" backslash \\ newline  tab ");
+			CHECK (event.at ("args.a\\b") == "42");
+			CHECK (event.at ("s") == "t");
+			found |= 2;
+		}
+	}
+
+	CHECK (found == 3);
+
+	Tracer::Clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FullBufferDropsEvents)
+{
+	// Without the flusher, nothing empties the buffer
+	Tracer::Clear ();
+	Tracer::Start (0);
+
+	const int CAPACITY = 16384;
+	const auto droppedBefore = Tracer::GetDroppedEventCount ();
+
+	// A new thread starts with an empty buffer
+	std::thread thread ([] () {
+		for (int i = 0; i < CAPACITY + 100; ++i) {
+			TraceInstant ("Event");
+		}
+	});
+	thread.join ();
+
+	CHECK (Tracer::GetDroppedEventCount () - droppedBefore == 100);
+
+	// Once drained, there is room again
+	Tracer::Flush ();
+	TraceInstant ("After flush");
+	Tracer::Stop ();
+
+	CHECK (Tracer::GetDroppedEventCount () - droppedBefore == 100);
+
+	TraceReader reader;
+	CHECK (reader.Read (ExportTrace ()));
+	int instants = 0;
+	for (const auto& event : reader.events) {
+		instants += event.at ("ph") == "i" ? 1 : 0;
+	}
+	CHECK (instants == CAPACITY + 1);
+
+	Tracer::Clear ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (StoppedTracerRecordsNothing)
+{
+	Tracer::Clear ();
+	CHECK (! Tracer::IsEnabled ());
+
+	TraceInstant ("Ignored");
+	{
+		TraceScope scope ("Ignored");
+	}
+
+	TraceReader reader;
+	CHECK (reader.Read (ExportTrace ()));
+
+	for (const auto& event : reader.events) {
+		CHECK (event.at ("ph") == "M");
+	}
+}
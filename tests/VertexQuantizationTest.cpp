@@ -0,0 +1,412 @@
+#include "Test.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "VertexQuantization.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+void Normalize (float* vector)
+{
+	const float length = std::sqrt (vector [0] * vector [0] +
+		vector [1] * vector [1] + vector [2] * vector [2]);
+	for (int i = 0; i < 3; ++i) {
+		vector [i] /= length;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Angle between two unit vectors in degrees, computed in double precision
+from the length of their difference.
+*/
+double GetAngle (const float* a, const float* b)
+{
+	double squaredChord = 0;
+	for (int i = 0; i < 3; ++i) {
+		const double difference = static_cast<double> (a [i]) - b [i];
+		squaredChord += difference * difference;
+	}
+
+	return 2 * std::asin (std::min (std::sqrt (squaredChord) / 2, 1.0)) *
+		57.295779513082323;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Unit vectors which are hard for the octahedral mapping: the axes, the
+diagonals, vectors just above and below the equator and close to the
+poles, followed by random ones.
+*/
+std::vector<std::vector<float>> CreateDirections (std::mt19937& random,
+	const int randomCount)
+{
+	std::vector<std::vector<float>> result;
+
+	for (const float x : { -1.0f, -0.5f, 0.0f, 0.5f, 1.0f }) {
+		for (const float y : { -1.0f, -0.5f, 0.0f, 0.5f, 1.0f }) {
+			for (const float z : { -1.0f, -1e-4f, 0.0f, 1e-4f, 1.0f }) {
+				if (x != 0 || y != 0 || z != 0) {
+					std::vector<float> vector = { x, y, z };
+					Normalize (vector.data ());
+					result.push_back (vector);
+				}
+			}
+		}
+	}
+
+	for (const float z : { -1.0f, 1.0f }) {
+		std::vector<float> vector = { 1e-5f, -2e-5f, z };
+		Normalize (vector.data ());
+		result.push_back (vector);
+	}
+
+	std::normal_distribution<float> distribution;
+	for (int i = 0; i < randomCount; ++i) {
+		std::vector<float> vector = { distribution (random),
+			distribution (random), distribution (random) };
+		Normalize (vector.data ());
+		result.push_back (vector);
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Vertices with random attributes, with a different extent and position
+for each axis.
+*/
+std::vector<MeshVertex> CreateVertices (std::mt19937& random, const int count)
+{
+	std::uniform_real_distribution<float> x (-100.0f, 300.0f);
+	std::uniform_real_distribution<float> y (1000.0f, 1001.0f);
+	std::uniform_real_distribution<float> z (-1e-3f, 1e-3f);
+	std::uniform_real_distribution<float> uv (-1.5f, 4.0f);
+
+	const auto directions = CreateDirections (random, count);
+
+	std::vector<MeshVertex> result (count);
+	for (int i = 0; i < count; ++i) {
+		auto& vertex = result [i];
+		vertex.position [0] = x (random);
+		vertex.position [1] = y (random);
+		vertex.position [2] = z (random);
+
+		const auto& normal = directions [i % directions.size ()];
+		const auto& tangent = directions [(i * 7 + 3) % directions.size ()];
+		std::copy (normal.begin (), normal.end (), vertex.normal);
+		std::copy (tangent.begin (), tangent.end (), vertex.tangent);
+		vertex.tangent [3] = (i % 3 == 0) ? -1.0f : 1.0f;
+
+		vertex.uv [0] = uv (random);
+		vertex.uv [1] = uv (random);
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+VertexFormat CreateFormat (const bool normals, const bool tangents)
+{
+	VertexFormat format;
+	format.normals = normals;
+	format.tangents = tangents;
+	return format;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int GetOffset (const VertexFormat& format, const char* semanticName)
+{
+	for (const auto& element : GetInputLayout (format)) {
+		if (std::strcmp (element.semanticName, semanticName) == 0) {
+			return element.offset;
+		}
+	}
+
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+Scalar reference of the SNorm16 octahedral encoding.
+*/
+void QuantizeDirection (const float* vector, std::int16_t* packed)
+{
+	float encoded [2];
+	EncodeOctahedral (vector, encoded);
+
+	for (int i = 0; i < 2; ++i) {
+		packed [i] = static_cast<std::int16_t> (std::lrint (
+			std::min (std::max (encoded [i] * 32767.0f, -32767.0f), 32767.0f)));
+	}
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (LayoutMatchesTheFormat)
+{
+	CHECK (GetVertexStride (VertexFormat ()) == 12);
+	CHECK (GetVertexStride (CreateFormat (true, true)) == 20);
+
+	VertexFormat format;
+	format.position = PositionEncoding::Float;
+	format.uv = UvEncoding::Float;
+	format.normals = true;
+	CHECK (GetVertexStride (format) == 24);
+
+	const auto layout = GetInputLayout (CreateFormat (true, true));
+	CHECK (layout.size () == 4);
+	CHECK (std::strcmp (layout [0].semanticName, "POSITION") == 0 && layout [0].offset == 0);
+	CHECK (std::strcmp (layout [1].semanticName, "NORMAL") == 0 && layout [1].offset == 8);
+	CHECK (std::strcmp (layout [2].semanticName, "TANGENT") == 0 && layout [2].offset == 12);
+	CHECK (std::strcmp (layout [3].semanticName, "TEXCOORD") == 0 && layout [3].offset == 16);
+	CHECK (layout [0].format == PixelFormat::R16G16B16A16_UNorm);
+	CHECK (layout [1].format == PixelFormat::R16G16_SNorm);
+	CHECK (layout [3].format == PixelFormat::R16G16_UNorm);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (PositionErrorStaysWithinBound)
+{
+	std::mt19937 random (1);
+	const auto vertices = CreateVertices (random, 5000);
+	const auto quantized = QuantizeVertices (vertices, CreateFormat (true, true));
+	CHECK (quantized.data.size () == vertices.size () * 20);
+
+	float minimum [3], maximum [3];
+	for (int axis = 0; axis < 3; ++axis) {
+		minimum [axis] = maximum [axis] = vertices [0].position [axis];
+		for (const auto& vertex : vertices) {
+			minimum [axis] = std::min (minimum [axis], vertex.position [axis]);
+			maximum [axis] = std::max (maximum [axis], vertex.position [axis]);
+		}
+
+		CHECK (quantized.positionOffset [axis] == minimum [axis]);
+		CHECK (quantized.positionScale [axis] == maximum [axis] - minimum [axis]);
+	}
+
+	int failures = 0;
+	for (std::size_t i = 0; i < vertices.size (); ++i) {
+		const auto decoded = DecodeVertex (quantized, i);
+
+		for (int axis = 0; axis < 3; ++axis) {
+			// Half a step of 65535, plus the rounding of the float math,
+			// which dominates for axes far from the origin
+			const float magnitude = std::max (std::abs (minimum [axis]),
+				std::abs (maximum [axis]));
+			const double bound = (maximum [axis] - minimum [axis]) / 131070.0 * 1.01 +
+				2 * magnitude * FLT_EPSILON;
+			if (std::abs (static_cast<double> (decoded.position [axis]) -
+				vertices [i].position [axis]) > bound) {
+				++failures;
+			}
+		}
+
+		// The handedness is stored exactly
+		if (decoded.tangent [3] != vertices [i].tangent [3]) {
+			++failures;
+		}
+	}
+	CHECK (failures == 0);
+
+	// The bounds themselves are exact
+	for (int axis = 0; axis < 3; ++axis) {
+		for (std::size_t i = 0; i < vertices.size (); ++i) {
+			const auto value = vertices [i].position [axis];
+			if (value == minimum [axis]) {
+				CHECK (DecodeVertex (quantized, i).position [axis] == value);
+			}
+		}
+	}
+
+	const auto error = MeasureQuantizationError (vertices, quantized);
+	CHECK (error.maxPosition > 0);
+	CHECK (error.maxPosition < 1.0f / 65535);
+	CHECK (error.rmsPosition <= error.maxPosition);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (OctahedralErrorIsBelowBound)
+{
+	std::mt19937 random (2);
+	const auto directions = CreateDirections (random, 20000);
+
+	double maxAngle = 0;
+	for (const auto& direction : directions) {
+		std::int16_t packed [2];
+		QuantizeDirection (direction.data (), packed);
+
+		const float encoded [2] = {
+			std::max (packed [0] / 32767.0f, -1.0f),
+			std::max (packed [1] / 32767.0f, -1.0f)
+		};
+		float decoded [3];
+		DecodeOctahedral (encoded, decoded);
+		maxAngle = std::max (maxAngle, GetAngle (direction.data (), decoded));
+
+		// Without quantization, only the float rounding remains
+		float exact [2], unquantized [3];
+		EncodeOctahedral (direction.data (), exact);
+		CHECK (std::abs (exact [0]) <= 1 && std::abs (exact [1]) <= 1);
+		DecodeOctahedral (exact, unquantized);
+		CHECK (GetAngle (direction.data (), unquantized) < 1e-4);
+	}
+	CHECK (maxAngle > 0);
+	CHECK (maxAngle < 0.005);
+
+	const auto vertices = CreateVertices (random, 5000);
+	const auto error = MeasureQuantizationError (vertices,
+		QuantizeVertices (vertices, CreateFormat (true, true)));
+	CHECK (error.maxNormal > 0 && error.maxNormal < 0.005f);
+	CHECK (error.maxTangent > 0 && error.maxTangent < 0.005f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (TextureCoordinatesStayWithinBound)
+{
+	std::mt19937 random (3);
+	auto vertices = CreateVertices (random, 1000);
+
+	VertexFormat format;
+	const auto quantized = QuantizeVertices (vertices, format);
+	const auto error = MeasureQuantizationError (vertices, quantized);
+	CHECK (error.maxUv <= std::max (quantized.uvScale [0], quantized.uvScale [1]) /
+		131070 * 1.01f + 8 * FLT_EPSILON);
+	CHECK (error.maxNormal == 0 && error.maxTangent == 0);
+
+	// Half floats are exact for multiples of 1/1024 in [-2,2]
+	for (auto& vertex : vertices) {
+		for (auto& uv : vertex.uv) {
+			uv = static_cast<float> (static_cast<int> (random () % 4097) - 2048) / 1024;
+		}
+	}
+
+	format.uv = UvEncoding::Half;
+	CHECK (MeasureQuantizationError (vertices, QuantizeVertices (vertices, format)).maxUv == 0);
+
+	format.position = PositionEncoding::Float;
+	format.uv = UvEncoding::Float;
+	const auto exact = MeasureQuantizationError (vertices, QuantizeVertices (vertices, format));
+	CHECK (exact.maxPosition == 0 && exact.maxUv == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (FlatAxesAndSingleVerticesAreExact)
+{
+	std::mt19937 random (4);
+	auto vertices = CreateVertices (random, 100);
+	for (auto& vertex : vertices) {
+		vertex.position [2] = 5.25f;
+		vertex.uv [1] = -0.75f;
+	}
+
+	auto quantized = QuantizeVertices (vertices, CreateFormat (true, true));
+	CHECK (quantized.positionScale [2] == 0);
+	CHECK (quantized.uvScale [1] == 0);
+	for (std::size_t i = 0; i < vertices.size (); ++i) {
+		const auto decoded = DecodeVertex (quantized, i);
+		CHECK (decoded.position [2] == 5.25f);
+		CHECK (decoded.uv [1] == -0.75f);
+		CHECK (std::isfinite (decoded.position [0]) && std::isfinite (decoded.position [1]));
+	}
+
+	vertices.resize (1);
+	quantized = QuantizeVertices (vertices, CreateFormat (true, true));
+	CHECK (quantized.data.size () == 20);
+	const auto decoded = DecodeVertex (quantized, 0);
+	for (int i = 0; i < 3; ++i) {
+		CHECK (decoded.position [i] == vertices [0].position [i]);
+	}
+	CHECK (decoded.uv [0] == vertices [0].uv [0] && decoded.uv [1] == vertices [0].uv [1]);
+
+	const auto error = MeasureQuantizationError (vertices, quantized);
+	CHECK (error.maxPosition == 0 && error.rmsPosition == 0 && error.maxUv == 0);
+
+	CHECK (QuantizeVertices (std::vector<MeshVertex> (), CreateFormat (true, true)).data.empty ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (TangentsRequireUNorm16Positions)
+{
+	std::mt19937 random (5);
+	const auto vertices = CreateVertices (random, 10);
+
+	auto format = CreateFormat (true, true);
+	format.position = PositionEncoding::Float;
+	CHECK_THROWS (QuantizeVertices (vertices, format));
+
+	format.tangents = false;
+	CHECK (QuantizeVertices (vertices, format).stride == 20);
+
+	// Without tangents, w is always 1
+	const auto quantized = QuantizeVertices (vertices, CreateFormat (true, false));
+	for (std::size_t i = 0; i < vertices.size (); ++i) {
+		std::uint16_t packed [4];
+		std::memcpy (packed, quantized.data.data () + i * quantized.stride, sizeof (packed));
+		CHECK (packed [3] == 65535);
+		CHECK (DecodeVertex (quantized, i).tangent [3] == 1);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/**
+This test is also built with ANTERU_NO_SIMD, so both the vector and the
+scalar code paths have to produce exactly the data of the reference.
+*/
+TEST_CASE (QuantizedDataMatchesScalarReference)
+{
+	std::mt19937 random (6);
+	const auto format = CreateFormat (true, true);
+	const int normalOffset = GetOffset (format, "NORMAL");
+	const int tangentOffset = GetOffset (format, "TANGENT");
+
+	// Counts around the vector width, so the tails are covered
+	for (const int count : { 1, 2, 3, 4, 5, 7, 8, 9, 1001 }) {
+		const auto vertices = CreateVertices (random, count);
+		const auto quantized = QuantizeVertices (vertices, format);
+
+		float inverseScale [3];
+		for (int axis = 0; axis < 3; ++axis) {
+			inverseScale [axis] = quantized.positionScale [axis] > 0
+				? 65535.0f / quantized.positionScale [axis] : 0;
+		}
+
+		int mismatches = 0;
+		for (int i = 0; i < count; ++i) {
+			const auto& vertex = vertices [i];
+			const auto source = quantized.data.data () + i * quantized.stride;
+
+			std::uint16_t position [4];
+			std::memcpy (position, source, sizeof (position));
+			for (int axis = 0; axis < 3; ++axis) {
+				const float value = (vertex.position [axis] -
+					quantized.positionOffset [axis]) * inverseScale [axis];
+				if (position [axis] != std::lrint (std::min (std::max (value, 0.0f), 65535.0f))) {
+					++mismatches;
+				}
+			}
+			if (position [3] != (vertex.tangent [3] >= 0 ? 65535 : 0)) {
+				++mismatches;
+			}
+
+			std::int16_t expected [2], actual [2];
+			QuantizeDirection (vertex.normal, expected);
+			std::memcpy (actual, source + normalOffset, sizeof (actual));
+			mismatches += expected [0] != actual [0] || expected [1] != actual [1];
+
+			QuantizeDirection (vertex.tangent, expected);
+			std::memcpy (actual, source + tangentOffset, sizeof (actual));
+			mismatches += expected [0] != actual [0] || expected [1] != actual [1];
+		}
+		CHECK (mismatches == 0);
+	}
+}
@@ -0,0 +1,143 @@
+#include "Test.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "WaitableEvent.h"
+
+using namespace anteru;
+
+namespace {
+///////////////////////////////////////////////////////////////////////////////
+/**
+Timeline which records the events registered with it. If completeOnSet is
+set, it completes while the event is being registered, which is the race
+WaitForAny has to handle.
+*/
+class RecordingTimeline final : public ITimeline
+{
+public:
+	std::uint64_t GetCompletedValue () const override
+	{
+		return completedValue;
+	}
+
+	void SetEventOnCompletion (const std::uint64_t value,
+		WaitableEvent& event) override
+	{
+		if (completeOnSet) {
+			completedValue = value;
+			event.Signal ();
+			return;
+		}
+
+		events.push_back (&event);
+	}
+
+	void CancelEventOnCompletion (WaitableEvent& event) override
+	{
+		for (auto it = events.begin (); it != events.end ();) {
+			it = *it == &event ? events.erase (it) : it + 1;
+		}
+	}
+
+	std::uint64_t completedValue = 0;
+	bool completeOnSet = false;
+	std::vector<WaitableEvent*> events;
+};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (EventStaysSignaledUntilWait)
+{
+	WaitableEvent event;
+	event.Signal ();
+	event.Wait ();
+
+	// Auto-reset, a second Signal is needed for the next Wait
+	event.Signal ();
+	event.Wait ();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (CpuTimelineSignalsOnCompletion)
+{
+	CpuTimeline timeline (1);
+	WaitableEvent event;
+
+	CHECK (timeline.GetCompletedValue () == 1);
+
+	std::thread signaler ([&] () {
+		std::this_thread::sleep_for (std::chrono::milliseconds (10));
+		timeline.Signal (3);
+	});
+
+	WaitForValue (timeline, 3, event, WaitStrategy::Block);
+	CHECK (timeline.GetCompletedValue () == 3);
+	signaler.join ();
+
+	// Lower values are ignored
+	timeline.Signal (2);
+	CHECK (timeline.GetCompletedValue () == 3);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (WaitForAnyReturnsCompletedTimeline)
+{
+	for (const auto strategy : { WaitStrategy::Block, WaitStrategy::Spin,
+		WaitStrategy::SpinThenBlock }) {
+		CpuTimeline first, second;
+		WaitableEvent event;
+
+		std::thread signaler ([&] () {
+			std::this_thread::sleep_for (std::chrono::milliseconds (10));
+			second.Signal (1);
+		});
+
+		const TimelineWait waits [] = { { &first, 1 }, { &second, 1 } };
+		CHECK (WaitForAny (waits, 2, event, strategy) == 1);
+		signaler.join ();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (WaitForAnyDeregistersEvent)
+{
+	RecordingTimeline pending, completing;
+	completing.completeOnSet = true;
+
+	WaitableEvent event;
+	const TimelineWait waits [] = { { &pending, 1 }, { &completing, 1 } };
+	CHECK (WaitForAny (waits, 2, event, WaitStrategy::Block) == 1);
+
+	CHECK (pending.events.empty ());
+	CHECK (completing.events.empty ());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TEST_CASE (TimelineSignalAfterEventDestroyed)
+{
+	CpuTimeline first, second;
+
+	{
+		// The event goes away right after the wait, while second still has
+		// not reached its value
+		std::unique_ptr<WaitableEvent> event (new WaitableEvent);
+
+		std::thread signaler ([&] () {
+			std::this_thread::sleep_for (std::chrono::milliseconds (10));
+			first.Signal (1);
+		});
+
+		const TimelineWait waits [] = { { &first, 1 }, { &second, 1 } };
+		CHECK (WaitForAny (waits, 2, *event, WaitStrategy::Block) == 0);
+		signaler.join ();
+	}
+
+	// Would write to the destroyed event if it was still registered, which
+	// the address sanitizer reports
+	second.Signal (1);
+	CHECK (second.GetCompletedValue () == 1);
+}
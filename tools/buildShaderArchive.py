@@ -0,0 +1,120 @@
+import argparse
+import itertools
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+from binaryToHeader import BinaryToHeader
+
+# Must match inc/ShaderArchive.h
+ARCHIVE_MAGIC = 0x52415341 # 'ASAR'
+ARCHIVE_VERSION = 1
+MAX_KEYWORDS = 8
+
+def HashEntryPoint (entryPoint):
+    '''32-bit FNV-1a, like GetShaderPermutationKey.'''
+    h = 2166136261
+    for c in entryPoint.encode ('ascii'):
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+def GetPermutationKey (entryPoint, keywordMask):
+    return (HashEntryPoint (entryPoint) << 32) | keywordMask
+
+def ParsePermutations (source):
+    '''Find all //!permutation entryPoint profile [keywords...] lines.'''
+    permutations = []
+    for line in source.splitlines ():
+        parts = line.split ()
+        if not parts or parts [0] != '//!permutation':
+            continue
+        if len (parts) < 3:
+            raise Exception ('Invalid permutation declaration: ' + line)
+        entryPoint, profile, keywords = parts [1], parts [2], parts [3:]
+        if len (keywords) > MAX_KEYWORDS:
+            raise Exception ('Too many keywords for ' + entryPoint)
+        permutations.append ((entryPoint, profile, keywords))
+    return permutations
+
+def EnumerateCombinations (keywords):
+    '''Yield (mask, active keywords) for all combinations.'''
+    for mask in range (1 << len (keywords)):
+        yield mask, [k for i, k in enumerate (keywords) if mask & (1 << i)]
+
+def CompileFxc (compiler, sourceFile, entryPoint, profile, defines):
+    handle, outputFile = tempfile.mkstemp (suffix='.cso')
+    os.close (handle)
+    try:
+        command = [compiler, '/nologo', '/T', profile, '/E', entryPoint,
+            '/Fo', outputFile]
+        for define in defines:
+            command += ['/D', define + '=1']
+        command.append (sourceFile)
+        subprocess.check_call (command, stdout=subprocess.DEVNULL)
+        return open (outputFile, 'rb').read ()
+    finally:
+        os.remove (outputFile)
+
+def CompileStub (source, entryPoint, profile, defines):
+    '''Placeholder bytecode for devices which do not execute it.'''
+    text = ''.join (['#define {} 1\n'.format (d) for d in defines]) + source
+    return b'STUB' + entryPoint.encode () + b'\0' + profile.encode () + b'\0' + text.encode ()
+
+def WriteArchive (shaders):
+    '''shaders is a dictionary of key to bytecode. The layout is a header,
+    the entries sorted by key and then the bytecode, all little endian.'''
+    keys = sorted (shaders.keys ())
+    header = struct.pack ('<IIII', ARCHIVE_MAGIC, ARCHIVE_VERSION, len (keys), 0)
+    offset = len (header) + 16 * len (keys)
+    entries = b''
+    blobs = b''
+    for key in keys:
+        entries += struct.pack ('<QII', key, offset + len (blobs), len (shaders [key]))
+        blobs += shaders [key]
+    return header + entries + blobs
+
+def WriteKeywords (permutations, sourceName):
+    print ('// Generated by buildShaderArchive.py from {}, do not edit'.format (sourceName))
+    print ('namespace ShaderKeywords {')
+    for entryPoint, _, keywords in permutations:
+        print ('namespace {} {{'.format (entryPoint))
+        for i, keyword in enumerate (keywords):
+            print ('const unsigned int {} = 1u << {};'.format (keyword, i))
+        print ('}')
+    print ('}')
+
+if __name__=='__main__':
+    parser = argparse.ArgumentParser (description='Precompile all shader '
+        'permutations into an archive, which is written as a C++ header.')
+    parser.add_argument ('source')
+    parser.add_argument ('variablename')
+    parser.add_argument ('--compiler', help='Path to fxc.exe')
+    parser.add_argument ('--stub', action='store_true',
+        help='Store placeholder bytecode instead of compiling')
+    parser.add_argument ('--archive', help='Also write the raw archive here')
+    args = parser.parse_args ()
+
+    source = open (args.source, 'r').read ()
+    permutations = ParsePermutations (source)
+
+    # Without a compiler, the archive stays empty and all shaders are
+    # compiled at runtime
+    shaders = {}
+    if args.compiler or args.stub:
+        for entryPoint, profile, keywords in permutations:
+            for mask, defines in EnumerateCombinations (keywords):
+                if args.stub:
+                    bytecode = CompileStub (source, entryPoint, profile, defines)
+                else:
+                    bytecode = CompileFxc (args.compiler, args.source,
+                        entryPoint, profile, defines)
+                shaders [GetPermutationKey (entryPoint, mask)] = bytecode
+
+    archive = WriteArchive (shaders)
+    if args.archive:
+        open (args.archive, 'wb').write (archive)
+
+    WriteKeywords (permutations, os.path.basename (args.source))
+    BinaryToHeader (archive, args.variablename)
@@ -0,0 +1,98 @@
+import argparse
+import re
+import sys
+
+# Computes the layout of the cbuffers in a HLSL source file with the
+# packing rules of the shader compiler, so C++ code can check its mirror of
+# a constant buffer against it at compile time. See ConstantBufferLayout.h.
+
+REGISTER_SIZE = 16
+
+CBUFFER = re.compile (r'cbuffer\s+(\w+)\s*(?::\s*register\s*\([^)]*\))?\s*\{([^}]*)\}')
+FIELD = re.compile (r'^(?:(row_major|column_major)\s+)?'
+    r'(float|int|uint|bool|dword)([1-4])?(?:x([1-4]))?\s+(\w+)\s*(?:\[\s*(\d+)\s*\])?$')
+
+def StripComments (source):
+    source = re.sub (r'/\*.*?\*/', ' ', source, flags=re.DOTALL)
+    return re.sub (r'//[^\n]*', ' ', source)
+
+def AlignToRegister (offset):
+    return (offset + REGISTER_SIZE - 1) & ~(REGISTER_SIZE - 1)
+
+def GetTypeLayout (majority, rows, columns, arraySize):
+    '''Returns the size without trailing padding, and whether the type
+    starts a new register.'''
+    if columns is None:
+        size = 4 * rows
+        newRegister = False
+    else:
+        registers, components = (rows, columns) if majority == 'row_major' else (columns, rows)
+        size = (registers - 1) * REGISTER_SIZE + 4 * components
+        newRegister = True
+
+    if arraySize is not None:
+        size = (arraySize - 1) * AlignToRegister (size) + size
+        newRegister = True
+
+    return size, newRegister
+
+def ParseField (declaration):
+    match = FIELD.match (declaration)
+    if not match:
+        raise Exception ('Unsupported cbuffer field: ' + declaration)
+    majority, _, rows, columns, name, arraySize = match.groups ()
+    return name, GetTypeLayout (majority,
+        int (rows) if rows else 1,
+        int (columns) if columns else None,
+        int (arraySize) if arraySize else None)
+
+def ComputeLayouts (source):
+    '''Returns a list of (cbuffer name, size, [(field, offset, size)]).'''
+    layouts = []
+    for match in CBUFFER.finditer (StripComments (source)):
+        fields = []
+        offset = 0
+        for declaration in match.group (2).split (';'):
+            declaration = ' '.join (declaration.split ())
+            if not declaration:
+                continue
+            name, (size, newRegister) = ParseField (declaration)
+            inRegister = offset % REGISTER_SIZE
+            if inRegister != 0 and (newRegister or inRegister + size > REGISTER_SIZE):
+                offset = AlignToRegister (offset)
+            fields.append ((name, offset, size))
+            offset += size
+        layouts.append ((match.group (1), AlignToRegister (offset), fields))
+    return layouts
+
+def PrintHeader (layouts, sourceName):
+    print ('// Generated by cbufferLayout.py from {}, do not edit'.format (sourceName))
+    print ('namespace ShaderLayouts {')
+    for name, size, fields in layouts:
+        print ('namespace {} {{'.format (name))
+        print ('const unsigned int SIZE = {}, FIELD_COUNT = {};'.format (size, len (fields)))
+        for fieldName, offset, fieldSize in fields:
+            print ('namespace {} {{ const unsigned int OFFSET = {}, SIZE = {}; }}'.format (
+                fieldName, offset, fieldSize))
+        print ('}')
+    print ('}')
+
+def PrintTable (layouts):
+    for name, size, fields in layouts:
+        print ('cbuffer {} ({} bytes)'.format (name, size))
+        for fieldName, offset, fieldSize in fields:
+            print ('  {:<24} offset {:>5}  size {:>5}'.format (fieldName, offset, fieldSize))
+
+if __name__=='__main__':
+    parser = argparse.ArgumentParser (description='Compute the layout of '
+        'the cbuffers in a HLSL file, written as a C++ header.')
+    parser.add_argument ('source')
+    parser.add_argument ('--table', action='store_true',
+        help='Print a readable table instead of the header')
+    args = parser.parse_args ()
+
+    layouts = ComputeLayouts (open (args.source, 'r').read ())
+    if args.table:
+        PrintTable (layouts)
+    else:
+        PrintHeader (layouts, args.source.replace ('\\', '/').split ('/') [-1])